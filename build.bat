@@ -64,7 +64,7 @@ REM Compile resource file (icon)
 rc.exe /nologo /fo "bin\lwsr.res" "src\lwsr.rc"
 
 REM Source files (single source of truth)
-set SOURCES=src\main.c src\config.c src\capture.c src\encoder.c src\overlay.c src\action_toolbar.c src\border.c src\replay_buffer.c src\nvenc_encoder.c src\sample_buffer.c src\mp4_muxer.c src\util.c src\logger.c src\audio_device.c src\audio_capture.c src\aac_encoder.c src\gpu_converter.c src\crash_handler.c
+set SOURCES=src\main.c src\config.c src\capture.c src\recorder.c src\overlay.c src\action_toolbar.c src\border.c src\replay_buffer.c src\nvenc_encoder.c src\sample_buffer.c src\audio_store.c src\mp4_muxer.c src\util.c src\logger.c src\audio_device.c src\audio_capture.c src\aac_encoder.c src\gpu_converter.c src\crash_handler.c src\video_encoder.c src\sw_encoder.c src\cpu_converter.c src\image_encoder.c src\frame_hub.c src\frame_source.c src\frame_pacer.c src\backpressure.c src\media_clock.c src\quality_controller.c src\pipeline_latency.c src\trace.c src\flight_recorder.c src\mem_tracker.c src\ram_estimator.c src\metrics.c src\metrics_server.c src\control.c src\control_server.c src\headless.c src\thread_registry.c src\platform.c
 
 REM Resource file
 set RESOURCES=bin\lwsr.res
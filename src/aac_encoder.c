@@ -4,6 +4,8 @@
  */
 
 #include "aac_encoder.h"
+#include "media_clock.h"
+#include "mem_tracker.h"
 #include <mfapi.h>
 #include <mftransform.h>
 #include <mferror.h>
@@ -16,6 +18,10 @@ static const GUID CLSID_AACEncoder = {
     0x93AF0C51, 0x2275, 0x45d2, {0xA3, 0x5B, 0xF2, 0xBA, 0x21, 0xCA, 0xED, 0x00}
 };
 
+// Fed timestamps further than this from the sample count re-anchor the
+// input timeline (capture glitch or clock drift), 100ns units
+#define AAC_RESYNC_THRESHOLD (40 * MEDIA_CLOCK_UNITS_PER_SECOND / 1000)
+
 struct AACEncoder {
     IMFTransform* transform;
     IMFMediaType* inputType;
@@ -33,8 +39,10 @@ struct AACEncoder {
     int samplesPerFrame;
     int bytesPerFrame;
     
-    // Timing
-    LONGLONG nextTimestamp;
+    // Timing (media clock)
+    LONGLONG inputTimestamp;    // Time of inputBuffer[0]
+    BOOL hasTimestamp;
+    LONGLONG nextTimestamp;     // Output time if the MFT doesn't carry one
     LONGLONG frameDuration;  // Duration of one AAC frame in 100ns
     
     // Encoder config (AudioSpecificConfig)
@@ -127,6 +135,12 @@ static void ProcessOutput(AACEncoder* encoder) {
                 buffer->lpVtbl->Lock(buffer, &data, NULL, &dataLen);
                 
                 if (data && dataLen > 0 && encoder->callback) {
+                    // The MFT passes the input sample time through
+                    LONGLONG sampleTime = 0;
+                    if (SUCCEEDED(outputBuffer.pSample->lpVtbl->GetSampleTime(outputBuffer.pSample, &sampleTime))) {
+                        encoder->nextTimestamp = sampleTime;
+                    }
+                    
                     AACSample sample = {0};
                     sample.data = data;
                     sample.size = dataLen;
@@ -166,7 +180,7 @@ AACEncoder* AACEncoder_Create(void) {
     
     // Allocate input buffer (hold multiple frames worth)
     encoder->inputBufferSize = encoder->bytesPerFrame * 4;
-    encoder->inputBuffer = (BYTE*)malloc(encoder->inputBufferSize);
+    encoder->inputBuffer = (BYTE*)MemTracker_Alloc(MEM_TAG_AUDIO_ENCODER, encoder->inputBufferSize);
     if (!encoder->inputBuffer) {
         free(encoder);
         return NULL;
@@ -213,7 +227,7 @@ AACEncoder* AACEncoder_Create(void) {
     }
     
     if (!encoder->transform) {
-        free(encoder->inputBuffer);
+        MemTracker_Free(encoder->inputBuffer);
         free(encoder);
         return NULL;
     }
@@ -302,7 +316,7 @@ void AACEncoder_Destroy(AACEncoder* encoder) {
     
     if (encoder->inputType) encoder->inputType->lpVtbl->Release(encoder->inputType);
     if (encoder->outputType) encoder->outputType->lpVtbl->Release(encoder->outputType);
-    if (encoder->inputBuffer) free(encoder->inputBuffer);
+    if (encoder->inputBuffer) MemTracker_Free(encoder->inputBuffer);
     if (encoder->configData) free(encoder->configData);
     
     free(encoder);
@@ -317,9 +331,16 @@ void AACEncoder_SetCallback(AACEncoder* encoder, AACEncoderCallback callback, vo
 BOOL AACEncoder_Feed(AACEncoder* encoder, const BYTE* pcmData, int pcmSize, LONGLONG timestamp) {
     if (!encoder || !encoder->transform || !pcmData || pcmSize <= 0) return FALSE;
     
-    // Set initial timestamp if not set
-    if (encoder->nextTimestamp == 0 && timestamp > 0) {
-        encoder->nextTimestamp = timestamp;
+    // Anchor the input timeline on the first chunk; afterwards the sample
+    // count is authoritative unless the clock disagrees by more than jitter
+    LONGLONG buffered = MediaClock_FromSamples(encoder->inputBufferUsed / (AAC_CHANNELS * 2), AAC_SAMPLE_RATE);
+    LONGLONG expected = encoder->inputTimestamp + buffered;
+    if (!encoder->hasTimestamp) {
+        encoder->inputTimestamp = timestamp - buffered;
+        encoder->nextTimestamp = encoder->inputTimestamp;
+        encoder->hasTimestamp = TRUE;
+    } else if (MediaClock_Drifted(expected, timestamp, AAC_RESYNC_THRESHOLD)) {
+        encoder->inputTimestamp = timestamp - buffered;
     }
     
     // Add to input buffer
@@ -349,7 +370,7 @@ BOOL AACEncoder_Feed(AACEncoder* encoder, const BYTE* pcmData, int pcmSize, LONG
             buffer->lpVtbl->SetCurrentLength(buffer, encoder->bytesPerFrame);
             
             sample->lpVtbl->AddBuffer(sample, buffer);
-            sample->lpVtbl->SetSampleTime(sample, encoder->nextTimestamp);
+            sample->lpVtbl->SetSampleTime(sample, encoder->inputTimestamp);
             sample->lpVtbl->SetSampleDuration(sample, encoder->frameDuration);
             
             // Feed to encoder
@@ -359,6 +380,7 @@ BOOL AACEncoder_Feed(AACEncoder* encoder, const BYTE* pcmData, int pcmSize, LONG
             sample->lpVtbl->Release(sample);
             
             // Shift input buffer
+            encoder->inputTimestamp += encoder->frameDuration;
             encoder->inputBufferUsed -= encoder->bytesPerFrame;
             if (encoder->inputBufferUsed > 0) {
                 memmove(encoder->inputBuffer, encoder->inputBuffer + encoder->bytesPerFrame, encoder->inputBufferUsed);
@@ -40,7 +40,8 @@ void AACEncoder_SetCallback(AACEncoder* encoder, AACEncoderCallback callback, vo
 // Feed PCM samples to encoder
 // pcmData: 16-bit stereo PCM at 48kHz
 // pcmSize: size in bytes
-// timestamp: presentation time in 100ns units
+// timestamp: media clock time of the first sample in pcmData (100ns units).
+// The first call anchors the timeline; later ones only re-anchor on drift.
 BOOL AACEncoder_Feed(AACEncoder* encoder, const BYTE* pcmData, int pcmSize, LONGLONG timestamp);
 
 // Flush any remaining samples
@@ -10,6 +10,9 @@
 #include "audio_guids.h"
 #include "util.h"
 #include "logger.h"
+#include "flight_recorder.h"
+#include "thread_registry.h"
+#include "mem_tracker.h"
 #include <mmdeviceapi.h>
 #include <audioclient.h>
 #include <functiondiscoverykeys_devpkey.h>
@@ -44,6 +47,10 @@ struct AudioCaptureSource {
     LARGE_INTEGER lastPacketTime;   // Last time we received a packet from this source
     LARGE_INTEGER perfFreq;         // Performance counter frequency
     BOOL hasReceivedPacket;         // TRUE once we've received at least one packet
+    
+    // Health counters (updated with interlocked ops, read without the lock)
+    volatile LONG64 discontinuities;    // Packets flagged as a glitch by the device
+    volatile LONG64 overflowBytes;      // Oldest data dropped because the ring was full
 };
 
 // Global enumerator
@@ -149,7 +156,7 @@ static AudioCaptureSource* CreateSource(const char* deviceId) {
     
     // Allocate buffer
     src->bufferSize = SOURCE_BUFFER_SIZE;
-    src->buffer = (BYTE*)malloc(src->bufferSize);
+    src->buffer = (BYTE*)MemTracker_Alloc(MEM_TAG_AUDIO_CAPTURE, src->bufferSize);
     if (!src->buffer) {
         CoTaskMemFree(src->deviceFormat);
         src->audioClient->lpVtbl->Release(src->audioClient);
@@ -179,7 +186,7 @@ static void DestroySource(AudioCaptureSource* src) {
         src->device->lpVtbl->Release(src->device);
     }
     if (src->buffer) {
-        free(src->buffer);
+        MemTracker_Free(src->buffer);
     }
     
     DeleteCriticalSection(&src->lock);
@@ -351,10 +358,13 @@ static DWORD WINAPI SourceCaptureThread(LPVOID param) {
     if (!src) return 0;
     
     // Temporary buffer for format conversion
-    BYTE* convBuffer = (BYTE*)malloc(SOURCE_BUFFER_SIZE);
+    BYTE* convBuffer = (BYTE*)MemTracker_Alloc(MEM_TAG_AUDIO_CAPTURE, SOURCE_BUFFER_SIZE);
     if (!convBuffer) return 0;
     
+    FlightRecorder_RegisterThread("Audio source");
+    ThreadRegistry_Register("Audio source", THREAD_ROLE_AUDIO_CAPTURE);
     while (src->active) {
+        FlightRecorder_SetStage("capture", FR_STAGE_DEADLINE_MS);
         UINT32 packetLength = 0;
         HRESULT hr = src->captureClient->lpVtbl->GetNextPacketSize(
             src->captureClient, &packetLength
@@ -381,6 +391,10 @@ static DWORD WINAPI SourceCaptureThread(LPVOID param) {
             
             if (FAILED(hr)) break;
             
+            if (flags & AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY) {
+                InterlockedIncrement64(&src->discontinuities);
+            }
+            
             if (numFrames > 0 && data) {
                 int convertedBytes = 0;
                 
@@ -412,6 +426,7 @@ static DWORD WINAPI SourceCaptureThread(LPVOID param) {
                         // Buffer full - drop oldest data
                         int toDrop = convertedBytes - spaceAvailable;
                         src->bufferAvailable -= toDrop;
+                        InterlockedExchangeAdd64(&src->overflowBytes, toDrop);
                     }
                     
                     // Write in possibly two parts (ring buffer wrap)
@@ -447,7 +462,9 @@ static DWORD WINAPI SourceCaptureThread(LPVOID param) {
         Sleep(5);  // ~5ms between checks
     }
     
-    free(convBuffer);
+    MemTracker_Free(convBuffer);
+    FlightRecorder_ReleaseThread();
+    ThreadRegistry_Unregister();
     return 0;
 }
 
@@ -468,7 +485,7 @@ AudioCaptureContext* AudioCapture_Create(
     
     // Allocate mix buffer
     ctx->mixBufferSize = MIX_BUFFER_SIZE;
-    ctx->mixBuffer = (BYTE*)malloc(ctx->mixBufferSize);
+    ctx->mixBuffer = (BYTE*)MemTracker_Alloc(MEM_TAG_AUDIO_CAPTURE, ctx->mixBufferSize);
     if (!ctx->mixBuffer) {
         DeleteCriticalSection(&ctx->mixLock);
         free(ctx);
@@ -500,14 +517,18 @@ AudioCaptureContext* AudioCapture_Create(
 void AudioCapture_Destroy(AudioCaptureContext* ctx) {
     if (!ctx) return;
     
-    AudioCapture_Stop(ctx);
+    if (!AudioCapture_Stop(ctx)) {
+        // A thread still reads from the sources and mix buffer: leak them
+        Logger_Log("AudioCapture: leaking context with a running thread\n");
+        return;
+    }
     
     for (int i = 0; i < ctx->sourceCount; i++) {
         DestroySource(ctx->sources[i]);
     }
     
     if (ctx->mixBuffer) {
-        free(ctx->mixBuffer);
+        MemTracker_Free(ctx->mixBuffer);
     }
     
     DeleteCriticalSection(&ctx->mixLock);
@@ -529,7 +550,7 @@ static DWORD WINAPI MixCaptureThread(LPVOID param) {
     BOOL srcDormant[MAX_AUDIO_SOURCES] = {0};  // TRUE if source is event-driven and currently silent
     
     for (int i = 0; i < ctx->sourceCount; i++) {
-        srcBuffers[i] = (BYTE*)malloc(4096);
+        srcBuffers[i] = (BYTE*)MemTracker_Alloc(MEM_TAG_AUDIO_CAPTURE, 4096);
     }
     
     const int chunkSize = 4096;  // Process in chunks
@@ -540,7 +561,10 @@ static DWORD WINAPI MixCaptureThread(LPVOID param) {
     QueryPerformanceCounter(&rateStartTime);
     LONGLONG totalBytesOutput = 0;  // Total bytes we've written to mix buffer
     
+    FlightRecorder_RegisterThread("Audio mixer");
+    ThreadRegistry_Register("Audio mixer", THREAD_ROLE_MIXER);
     while (ctx->running) {
+        FlightRecorder_SetStage("mix", FR_STAGE_DEADLINE_MS);
         LARGE_INTEGER now;
         QueryPerformanceCounter(&now);
         
@@ -655,7 +679,7 @@ static DWORD WINAPI MixCaptureThread(LPVOID param) {
         
         // Mix sources - each source contributes what it has, silence for the rest
         if (bytesToMix > 0) {
-            BYTE* mixChunk = (BYTE*)malloc(bytesToMix);
+            BYTE* mixChunk = (BYTE*)MemTracker_Alloc(MEM_TAG_AUDIO_CAPTURE, bytesToMix);
             if (mixChunk) {
                 int numSamples = bytesToMix / AUDIO_BLOCK_ALIGN;
                 
@@ -704,11 +728,11 @@ static DWORD WINAPI MixCaptureThread(LPVOID param) {
                     float peakPctR = (float)peakRight / 32767.0f * 100.0f;
                     double rateElapsed = (double)(now.QuadPart - rateStartTime.QuadPart) / ctx->perfFreq.QuadPart;
                     double actualRate = (rateElapsed > 0) ? (totalBytesOutput / rateElapsed) : 0;
-                    Logger_Log("Audio: L=%.1f%% R=%.1f%% bytes=[%d,%d,%d] dormant=[%d,%d,%d] rate=%.0f/s (target=%d)\n", 
-                               peakPctL, peakPctR,
-                               srcBytes[0], srcBytes[1], srcBytes[2],
-                               srcDormant[0], srcDormant[1], srcDormant[2],
-                               actualRate, AUDIO_BYTES_PER_SEC);
+                    LOG_DEBUG("Audio: L=%.1f%% R=%.1f%% bytes=[%d,%d,%d] dormant=[%d,%d,%d] rate=%.0f/s (target=%d)\n", 
+                              peakPctL, peakPctR,
+                              srcBytes[0], srcBytes[1], srcBytes[2],
+                              srcDormant[0], srcDormant[1], srcDormant[2],
+                              actualRate, AUDIO_BYTES_PER_SEC);
                     peakLeft = 0;
                     peakRight = 0;
                 }
@@ -721,6 +745,7 @@ static DWORD WINAPI MixCaptureThread(LPVOID param) {
                     // Drop oldest
                     int toDrop = bytesToMix - spaceAvailable;
                     ctx->mixBufferAvailable -= toDrop;
+                    InterlockedExchangeAdd64(&ctx->mixOverflowBytes, toDrop);
                     ctx->mixBufferReadPos = (ctx->mixBufferReadPos + toDrop) % ctx->mixBufferSize;
                 }
                 
@@ -742,21 +767,29 @@ static DWORD WINAPI MixCaptureThread(LPVOID param) {
                 // Track total output for rate limiting
                 totalBytesOutput += bytesToMix;
                 
-                free(mixChunk);
+                MemTracker_Free(mixChunk);
             }
         }
     }
     
     for (int i = 0; i < ctx->sourceCount; i++) {
-        if (srcBuffers[i]) free(srcBuffers[i]);
+        if (srcBuffers[i]) MemTracker_Free(srcBuffers[i]);
     }
     
+    FlightRecorder_ReleaseThread();
+    ThreadRegistry_Unregister();
     return 0;
 }
 
-BOOL AudioCapture_Start(AudioCaptureContext* ctx) {
+BOOL AudioCapture_Start(AudioCaptureContext* ctx, const MediaClock* clock) {
     if (!ctx || ctx->running) return FALSE;
     
+    if (clock) {
+        ctx->clock = *clock;
+    } else {
+        MediaClock_Init(&ctx->clock, NULL, NULL);
+    }
+    
     // Initialize and start each source
     for (int i = 0; i < ctx->sourceCount; i++) {
         AudioCaptureSource* src = ctx->sources[i];
@@ -784,9 +817,6 @@ BOOL AudioCapture_Start(AudioCaptureContext* ctx) {
         src->captureThread = CreateThread(NULL, 0, SourceCaptureThread, src, 0, NULL);
     }
     
-    // Record start time
-    QueryPerformanceCounter(&ctx->startTime);
-    
     // Start mix thread
     ctx->running = TRUE;
     ctx->captureThread = CreateThread(NULL, 0, MixCaptureThread, ctx, 0, NULL);
@@ -794,9 +824,10 @@ BOOL AudioCapture_Start(AudioCaptureContext* ctx) {
     return TRUE;
 }
 
-void AudioCapture_Stop(AudioCaptureContext* ctx) {
-    if (!ctx) return;
+BOOL AudioCapture_Stop(AudioCaptureContext* ctx) {
+    if (!ctx) return TRUE;
     
+    BOOL exited = TRUE;
     ctx->running = FALSE;
     
     // Stop sources and wait for their threads
@@ -812,18 +843,27 @@ void AudioCapture_Stop(AudioCaptureContext* ctx) {
         
         // Wait for source capture thread to finish
         if (src->captureThread) {
-            WaitForSingleObject(src->captureThread, 1000);
-            CloseHandle(src->captureThread);
-            src->captureThread = NULL;
+            if (WaitForSingleObject(src->captureThread, 1000) == WAIT_OBJECT_0) {
+                CloseHandle(src->captureThread);
+                src->captureThread = NULL;
+            } else {
+                Logger_Log("AudioCapture: source %d thread still running after 1s\n", i);
+                exited = FALSE;
+            }
         }
     }
     
     // Wait for mix thread
     if (ctx->captureThread) {
-        WaitForSingleObject(ctx->captureThread, 1000);
-        CloseHandle(ctx->captureThread);
-        ctx->captureThread = NULL;
+        if (WaitForSingleObject(ctx->captureThread, 1000) == WAIT_OBJECT_0) {
+            CloseHandle(ctx->captureThread);
+            ctx->captureThread = NULL;
+        } else {
+            Logger_Log("AudioCapture: mix thread still running after 1s\n");
+            exited = FALSE;
+        }
     }
+    return exited;
 }
 
 int AudioCapture_Read(AudioCaptureContext* ctx, BYTE* buffer, int maxBytes, LONGLONG* timestamp) {
@@ -831,7 +871,12 @@ int AudioCapture_Read(AudioCaptureContext* ctx, BYTE* buffer, int maxBytes, LONG
     
     EnterCriticalSection(&ctx->mixLock);
     
-    int available = ctx->mixBufferAvailable;
+    // Everything buffered was mixed by now, so the oldest byte is that much
+    // older than the clock
+    int buffered = ctx->mixBufferAvailable;
+    LONGLONG readTime = MediaClock_Now(&ctx->clock);
+    
+    int available = buffered;
     if (available > maxBytes) available = maxBytes;
     
     if (available > 0) {
@@ -851,23 +896,22 @@ int AudioCapture_Read(AudioCaptureContext* ctx, BYTE* buffer, int maxBytes, LONG
     
     LeaveCriticalSection(&ctx->mixLock);
     
-    // Calculate timestamp
+    LONGLONG chunkTime = readTime - MediaClock_FromSamples(buffered / AUDIO_BLOCK_ALIGN, AUDIO_SAMPLE_RATE);
     if (timestamp) {
-        *timestamp = AudioCapture_GetTimestamp(ctx);
+        *timestamp = chunkTime;
     }
     
+    FlightRecorder_SetGauge(FR_GAUGE_AUDIO_BUFFERED, buffered - available);
+    if (available > 0) {
+        FlightRecorder_Event(FR_EVENT_AUDIO_READ, chunkTime, available);
+    }
     return available;
 }
 
 LONGLONG AudioCapture_GetTimestamp(AudioCaptureContext* ctx) {
     if (!ctx) return 0;
     
-    LARGE_INTEGER now;
-    QueryPerformanceCounter(&now);
-    
-    // Return time since start in 100ns units
-    LONGLONG elapsed = now.QuadPart - ctx->startTime.QuadPart;
-    return (elapsed * 10000000) / ctx->perfFreq.QuadPart;
+    return MediaClock_Now(&ctx->clock);
 }
 
 BOOL AudioCapture_HasData(AudioCaptureContext* ctx) {
@@ -879,3 +923,17 @@ BOOL AudioCapture_HasData(AudioCaptureContext* ctx) {
     
     return hasData;
 }
+
+void AudioCapture_GetHealth(AudioCaptureContext* ctx, AudioCaptureHealth* health) {
+    if (!health) return;
+    ZeroMemory(health, sizeof(*health));
+    if (!ctx) return;
+    
+    health->overflowBytes = (UINT64)InterlockedCompareExchange64(&ctx->mixOverflowBytes, 0, 0);
+    for (int i = 0; i < ctx->sourceCount; i++) {
+        AudioCaptureSource* src = ctx->sources[i];
+        if (!src) continue;
+        health->discontinuities += (UINT64)InterlockedCompareExchange64(&src->discontinuities, 0, 0);
+        health->overflowBytes += (UINT64)InterlockedCompareExchange64(&src->overflowBytes, 0, 0);
+    }
+}
@@ -8,6 +8,7 @@
 
 #include <windows.h>
 #include "audio_device.h"
+#include "media_clock.h"
 
 // Audio format (fixed for simplicity - all sources resampled to this)
 #define AUDIO_SAMPLE_RATE       48000
@@ -37,13 +38,14 @@ typedef struct {
     int mixBufferReadPos;
     int mixBufferAvailable;
     CRITICAL_SECTION mixLock;
+    volatile LONG64 mixOverflowBytes;   // Mixed audio dropped unread (ring full)
     
     // Capture thread
     HANDLE captureThread;
     BOOL running;
     
     // Timing
-    LARGE_INTEGER startTime;
+    MediaClock clock;           // Session clock all reads are stamped against
     LARGE_INTEGER perfFreq;
 } AudioCaptureContext;
 
@@ -62,23 +64,32 @@ AudioCaptureContext* AudioCapture_Create(
     const char* deviceId3, int volume3
 );
 
-// Destroy capture context
+// Destroy capture context (stops it first; leaks it if a thread won't exit)
 void AudioCapture_Destroy(AudioCaptureContext* ctx);
 
-// Start capturing audio
-BOOL AudioCapture_Start(AudioCaptureContext* ctx);
+// Start capturing audio, stamping reads against the session's media clock
+BOOL AudioCapture_Start(AudioCaptureContext* ctx, const MediaClock* clock);
 
-// Stop capturing audio
-void AudioCapture_Stop(AudioCaptureContext* ctx);
+// Stop capturing audio. Returns FALSE if a capture thread did not exit in
+// time; its handle is kept and the context must not be destroyed.
+BOOL AudioCapture_Stop(AudioCaptureContext* ctx);
 
 // Read mixed audio data (returns bytes read)
-// Timestamp is in 100ns units (same as video)
+// Timestamp is the media clock time of the first byte returned
 int AudioCapture_Read(AudioCaptureContext* ctx, BYTE* buffer, int maxBytes, LONGLONG* timestamp);
 
-// Get current capture timestamp (100ns units)
+// Current media clock time (100ns units)
 LONGLONG AudioCapture_GetTimestamp(AudioCaptureContext* ctx);
 
 // Check if audio data is available
 BOOL AudioCapture_HasData(AudioCaptureContext* ctx);
 
+// Capture health since the context was created (lock-free read)
+typedef struct {
+    UINT64 discontinuities;     // Device-reported glitches, all sources
+    UINT64 overflowBytes;       // PCM dropped because a source or mix ring was full
+} AudioCaptureHealth;
+
+void AudioCapture_GetHealth(AudioCaptureContext* ctx, AudioCaptureHealth* health);
+
 #endif // AUDIO_CAPTURE_H
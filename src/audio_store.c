@@ -0,0 +1,244 @@
+/*
+ * Audio Store Implementation
+ */
+
+#include "audio_store.h"
+#include "logger.h"
+#include "flight_recorder.h"
+#include "mem_tracker.h"
+#include <string.h>
+
+// Alias for logging
+#define AudioLog Logger_Log
+
+// Time-based eviction: remove frames that would put the span over maxDuration
+// (matches video buffer eviction behavior)
+static void EvictOldSamples(AudioStore* store, LONGLONG newTimestamp) {
+    if (store->count == 0 || store->maxDuration <= 0) return;
+
+    int evicted = 0;
+    while (store->count > 0) {
+        LONGLONG span = newTimestamp - store->samples[0].timestamp;
+        if (span <= store->maxDuration) {
+            break;  // Within duration limit
+        }
+
+        // Evict oldest sample
+        if (store->samples[0].data) {
+            MemTracker_Free(store->samples[0].data);
+        }
+        memmove(store->samples, store->samples + 1,
+                (store->count - 1) * sizeof(MuxerAudioSample));
+        store->count--;
+        evicted++;
+    }
+
+    // Log eviction periodically
+    static int evictLogCounter = 0;
+    evictLogCounter++;
+    if (evicted > 0 && (evictLogCounter % 500) == 0) {
+        double spanSec = 0;
+        if (store->count > 0) {
+            spanSec = (newTimestamp - store->samples[0].timestamp) / 10000000.0;
+        }
+        AudioLog("Audio eviction: removed %d samples, count=%d, span=%.2fs\n",
+                 evicted, store->count, spanSec);
+    }
+}
+
+// Make room for one more frame (grow, or drop the oldest quarter when at the cap)
+static void EnsureCapacity(AudioStore* store) {
+    if (store->count < store->capacity) return;
+
+    int newCapacity = store->capacity == 0 ? 1024 : store->capacity * 2;
+    if (newCapacity > AUDIO_STORE_MAX_SAMPLES) newCapacity = AUDIO_STORE_MAX_SAMPLES;
+
+    if (store->count >= newCapacity) {
+        // Still full after time eviction - emergency capacity eviction
+        int toKeep = newCapacity * 3 / 4;
+        int toRemove = store->count - toKeep;
+
+        for (int i = 0; i < toRemove && i < store->count; i++) {
+            if (store->samples[i].data) {
+                MemTracker_Free(store->samples[i].data);
+            }
+        }
+
+        memmove(store->samples, store->samples + toRemove,
+                toKeep * sizeof(MuxerAudioSample));
+        store->count = toKeep;
+        return;
+    }
+
+    MuxerAudioSample* newArr = MemTracker_Realloc(MEM_TAG_AUDIO_SAMPLES, store->samples,
+                                                  newCapacity * sizeof(MuxerAudioSample));
+    if (newArr) {
+        store->samples = newArr;
+        store->capacity = newCapacity;
+    } else {
+        // realloc failed - log and drop sample
+        static int reallocFailCount = 0;
+        if (++reallocFailCount <= 5) {
+            AudioLog("WARNING: Audio buffer realloc failed (count=%d, capacity=%d)\n",
+                     store->count, newCapacity);
+        }
+    }
+}
+
+static void FreeSamples(AudioStore* store) {
+    for (int i = 0; i < store->count; i++) {
+        if (store->samples[i].data) {
+            MemTracker_Free(store->samples[i].data);
+            store->samples[i].data = NULL;
+        }
+    }
+    store->count = 0;
+}
+
+void AudioStore_Init(AudioStore* store) {
+    if (!store) return;
+    memset(store, 0, sizeof(AudioStore));
+    Platform_MutexInit(&store->lock);
+    store->initialized = TRUE;
+}
+
+void AudioStore_Shutdown(AudioStore* store) {
+    if (!store || !store->initialized) return;
+
+    Platform_MutexLock(&store->lock);
+    FreeSamples(store);
+    MemTracker_Free(store->samples);
+    store->samples = NULL;
+    store->capacity = 0;
+    store->maxDuration = 0;
+    Platform_MutexUnlock(&store->lock);
+
+    Platform_MutexDestroy(&store->lock);
+    store->initialized = FALSE;
+}
+
+void AudioStore_Clear(AudioStore* store) {
+    if (!store || !store->initialized) return;
+
+    Platform_MutexLock(&store->lock);
+    FreeSamples(store);
+    store->maxDuration = 0;
+    Platform_MutexUnlock(&store->lock);
+}
+
+void AudioStore_SetMaxDuration(AudioStore* store, LONGLONG maxDuration) {
+    if (!store || !store->initialized) return;
+
+    Platform_MutexLock(&store->lock);
+    store->maxDuration = maxDuration;
+    Platform_MutexUnlock(&store->lock);
+}
+
+BOOL AudioStore_Add(AudioStore* store, const BYTE* data, DWORD size,
+                    LONGLONG timestamp, LONGLONG duration) {
+    if (!store || !store->initialized || !data || size == 0) return FALSE;
+
+    Platform_MutexLock(&store->lock);
+
+    EvictOldSamples(store, timestamp);
+    EnsureCapacity(store);
+
+    BOOL added = FALSE;
+    if (store->count < store->capacity) {
+        MuxerAudioSample* dst = &store->samples[store->count];
+        dst->data = (BYTE*)MemTracker_Alloc(MEM_TAG_AUDIO_SAMPLES, size);
+        if (dst->data) {
+            memcpy(dst->data, data, size);
+            dst->size = size;
+            dst->timestamp = timestamp;
+            dst->duration = duration;
+            store->count++;
+            FlightRecorder_SetGauge(FR_GAUGE_AUDIO_SAMPLES, store->count);
+            added = TRUE;
+        }
+    }
+
+    Platform_MutexUnlock(&store->lock);
+    return added;
+}
+
+int AudioStore_GetCount(AudioStore* store) {
+    if (!store || !store->initialized) return 0;
+
+    Platform_MutexLock(&store->lock);
+    int count = store->count;
+    Platform_MutexUnlock(&store->lock);
+
+    return count;
+}
+
+double AudioStore_GetDuration(AudioStore* store) {
+    if (!store || !store->initialized) return 0.0;
+
+    Platform_MutexLock(&store->lock);
+    double duration = 0.0;
+    if (store->count > 0) {
+        const MuxerAudioSample* last = &store->samples[store->count - 1];
+        duration = (double)(last->timestamp + last->duration - store->samples[0].timestamp) / 10000000.0;
+    }
+    Platform_MutexUnlock(&store->lock);
+
+    return duration;
+}
+
+BOOL AudioStore_GetSamplesForMuxing(AudioStore* store, LONGLONG baseTimestamp,
+                                    MuxerAudioSample** outSamples, int* outCount) {
+    if (!store || !store->initialized || !outSamples || !outCount) return FALSE;
+
+    *outSamples = NULL;
+    *outCount = 0;
+
+    Platform_MutexLock(&store->lock);
+
+    if (store->count == 0) {
+        Platform_MutexUnlock(&store->lock);
+        return FALSE;
+    }
+
+    // Deep copy under the lock (audio from before baseTimestamp is cut)
+    MuxerAudioSample* copy = (MuxerAudioSample*)MemTracker_Alloc(MEM_TAG_SAVE, store->count * sizeof(MuxerAudioSample));
+    if (!copy) {
+        Platform_MutexUnlock(&store->lock);
+        return FALSE;
+    }
+
+    int copied = 0;
+    for (int i = 0; i < store->count; i++) {
+        const MuxerAudioSample* src = &store->samples[i];
+        if (src->timestamp < baseTimestamp) continue;
+
+        MuxerAudioSample* dst = &copy[copied];
+        dst->data = (BYTE*)MemTracker_Alloc(MEM_TAG_SAVE, src->size);
+        if (!dst->data) {
+            // malloc failed - free all previous copies and abort
+            AudioLog("WARNING: Audio copy malloc failed at sample %d/%d\n", i, store->count);
+            for (int j = 0; j < copied; j++) {
+                if (copy[j].data) MemTracker_Free(copy[j].data);
+            }
+            MemTracker_Free(copy);
+            Platform_MutexUnlock(&store->lock);
+            return FALSE;
+        }
+        memcpy(dst->data, src->data, src->size);
+        dst->size = src->size;
+        dst->timestamp = src->timestamp - baseTimestamp;
+        dst->duration = src->duration;
+        copied++;
+    }
+
+    Platform_MutexUnlock(&store->lock);
+
+    if (copied == 0) {
+        MemTracker_Free(copy);
+        return FALSE;
+    }
+
+    *outSamples = copy;
+    *outCount = copied;
+    return TRUE;
+}
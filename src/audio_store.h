@@ -0,0 +1,59 @@
+/*
+ * Audio Store - Encoded AAC frames for instant replay
+ * Portable C; duration-based eviction like the video sample buffer
+ *
+ * A growable array of AAC frames in timestamp order. Adding a frame first
+ * evicts everything older than the configured duration, then grows the
+ * array (doubling, up to AUDIO_STORE_MAX_SAMPLES); if it is still full the
+ * oldest quarter is dropped. Frames are copied in, so the encoder's output
+ * buffer can be reused as soon as AudioStore_Add returns.
+ */
+
+#ifndef AUDIO_STORE_H
+#define AUDIO_STORE_H
+
+#include "platform.h"
+#include "mp4_muxer.h"
+
+// Most encoded audio frames kept (~5.8 min of 48 kHz AAC)
+#define AUDIO_STORE_MAX_SAMPLES 16384
+
+typedef struct {
+    MuxerAudioSample* samples;  // Oldest first
+    int count;
+    int capacity;
+
+    LONGLONG maxDuration;       // Eviction span (100-ns units, 0 = keep until full)
+
+    PlatformMutex lock;
+    BOOL initialized;
+} AudioStore;
+
+// Initialize an empty store with no eviction span
+void AudioStore_Init(AudioStore* store);
+
+// Free all frames and the lock
+void AudioStore_Shutdown(AudioStore* store);
+
+// Free all frames (the array is kept) and clear the eviction span
+void AudioStore_Clear(AudioStore* store);
+
+// Keep at most this much audio (100-ns units, 0 = keep until full)
+void AudioStore_SetMaxDuration(AudioStore* store, LONGLONG maxDuration);
+
+// Copy one encoded frame in, evicting old frames first
+BOOL AudioStore_Add(AudioStore* store, const BYTE* data, DWORD size,
+                    LONGLONG timestamp, LONGLONG duration);
+
+int AudioStore_GetCount(AudioStore* store);
+
+// Seconds covered from the oldest frame's start to the newest frame's end
+double AudioStore_GetDuration(AudioStore* store);
+
+// Get copies of the frames at or after baseTimestamp, rebased so it is 0
+// (pass the video base so both streams share an origin). The caller releases
+// the array and each frame's data with MemTracker_Free.
+BOOL AudioStore_GetSamplesForMuxing(AudioStore* store, LONGLONG baseTimestamp,
+                                    MuxerAudioSample** samples, int* count);
+
+#endif // AUDIO_STORE_H
@@ -0,0 +1,283 @@
+/*
+ * Backpressure Implementation
+ * In-flight FIFO, latency/service estimates and error-diffused dropping
+ */
+
+#include "backpressure.h"
+#include "platform.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Smoothing for latency/service averages (new = old + (sample - old) / 8)
+#define EWMA_SHIFT 3
+
+// Service times within 1/16 of the frame interval don't trigger drops
+#define SERVICE_DEADBAND_DIV 16
+
+// Extra drop credit per frame of backlog beyond the target depth
+#define BACKLOG_CREDIT 0.25
+
+typedef struct {
+    int64_t timestamp;
+    int64_t submitTime;
+    bool unloaded;          // Pipeline was empty when submitted
+} InFlightFrame;
+
+struct Backpressure {
+    PlatformMutex lock;
+    int maxInFlight;
+    int64_t frameInterval;
+
+    InFlightFrame flight[BACKPRESSURE_MAX_IN_FLIGHT];
+    int head;
+    int count;
+
+    int64_t lastCompletion;
+    bool haveCompletion;
+    int64_t unloadedLatency;    // Latency of frames that didn't queue (sizes the depth)
+    bool haveUnloaded;
+    bool haveLatency;
+    bool haveService;
+
+    double dropCredit;          // Error diffusion accumulator
+    TimelineGap gapHistory[BACKPRESSURE_GAP_HISTORY];
+    int gapHead;                // Next write position
+    int gapCount;
+
+    BackpressureStats stats;
+};
+
+// ============================================================================
+// Internal (lock held)
+// ============================================================================
+
+static void Ewma(int64_t* avg, bool* have, int64_t sample) {
+    if (!*have) {
+        *avg = sample;
+        *have = true;
+    } else {
+        *avg += (sample - *avg) / (1 << EWMA_SHIFT);
+    }
+}
+
+static void RecordGap(Backpressure* bp, int64_t timestamp, DropReason reason) {
+    bp->stats.dropped[reason]++;
+    bp->stats.gapTime += bp->frameInterval;
+
+    // Extend the latest gap when this drop directly follows it
+    if (bp->gapCount > 0) {
+        TimelineGap* last = &bp->gapHistory[(bp->gapHead - 1 + BACKPRESSURE_GAP_HISTORY) % BACKPRESSURE_GAP_HISTORY];
+        int64_t slack = bp->frameInterval / 2;
+        if (timestamp >= last->start && timestamp <= last->end + slack) {
+            if (timestamp + bp->frameInterval > last->end) last->end = timestamp + bp->frameInterval;
+            last->frames++;
+            return;
+        }
+    }
+
+    TimelineGap* gap = &bp->gapHistory[bp->gapHead];
+    gap->start = timestamp;
+    gap->end = timestamp + bp->frameInterval;
+    gap->frames = 1;
+    gap->reason = reason;
+    bp->gapHead = (bp->gapHead + 1) % BACKPRESSURE_GAP_HISTORY;
+    if (bp->gapCount < BACKPRESSURE_GAP_HISTORY) bp->gapCount++;
+    bp->stats.gaps++;
+}
+
+static void PopFlight(Backpressure* bp) {
+    bp->head = (bp->head + 1) % BACKPRESSURE_MAX_IN_FLIGHT;
+    bp->count--;
+}
+
+// Re-derive depth and drop ratio from the latest estimates
+static void UpdatePolicy(Backpressure* bp) {
+    BackpressureStats* s = &bp->stats;
+
+    // Enough in flight to cover one unqueued encode, plus the frame being captured
+    int depth = 2;
+    if (bp->haveUnloaded) {
+        depth = (int)((bp->unloadedLatency + bp->frameInterval - 1) / bp->frameInterval) + 1;
+    }
+    if (depth < 1) depth = 1;
+    if (depth > bp->maxInFlight) depth = bp->maxInFlight;
+    s->targetDepth = depth;
+
+    // Encoder needs serviceAvg per frame but gets one every frameInterval:
+    // keep frameInterval / serviceAvg of them. Small overshoots are timing
+    // noise and left to the backlog term.
+    int64_t deadband = bp->frameInterval + bp->frameInterval / SERVICE_DEADBAND_DIV;
+    if (bp->haveService && s->serviceAvg > deadband) {
+        s->dropRatio = 1.0 - (double)bp->frameInterval / (double)s->serviceAvg;
+    } else {
+        s->dropRatio = 0.0;
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+Backpressure* Backpressure_Create(int maxInFlight, int64_t frameInterval) {
+    if (maxInFlight <= 0 || frameInterval <= 0) return NULL;
+
+    Backpressure* bp = (Backpressure*)calloc(1, sizeof(Backpressure));
+    if (!bp) return NULL;
+
+    Platform_MutexInit(&bp->lock);
+    bp->maxInFlight = maxInFlight < BACKPRESSURE_MAX_IN_FLIGHT ? maxInFlight : BACKPRESSURE_MAX_IN_FLIGHT;
+    bp->frameInterval = frameInterval;
+    bp->stats.maxInFlight = bp->maxInFlight;
+    UpdatePolicy(bp);
+    return bp;
+}
+
+void Backpressure_Destroy(Backpressure* bp) {
+    if (!bp) return;
+    Platform_MutexDestroy(&bp->lock);
+    free(bp);
+}
+
+DropReason Backpressure_Admit(Backpressure* bp, int64_t timestamp, int64_t now) {
+    if (!bp) return DROP_NONE;
+    (void)now;
+
+    Platform_MutexLock(&bp->lock);
+    DropReason reason = DROP_NONE;
+
+    if (bp->count >= bp->maxInFlight) {
+        reason = DROP_FULL;
+    } else {
+        int backlog = bp->count - bp->stats.targetDepth;
+        if (bp->stats.dropRatio <= 0.0 && backlog <= 0) {
+            bp->dropCredit = 0.0;   // Keeping up: no debt carried into the next overload
+        } else {
+            bp->dropCredit += bp->stats.dropRatio;
+            if (backlog > 0) bp->dropCredit += BACKLOG_CREDIT * backlog;
+            if (bp->dropCredit > 2.0) bp->dropCredit = 2.0;
+            if (bp->dropCredit >= 1.0) {
+                bp->dropCredit -= 1.0;
+                reason = DROP_PACED;
+            }
+        }
+    }
+
+    if (reason != DROP_NONE) RecordGap(bp, timestamp, reason);
+    Platform_MutexUnlock(&bp->lock);
+    return reason;
+}
+
+void Backpressure_SubmitResult(Backpressure* bp, int64_t timestamp, int64_t now, bool accepted) {
+    if (!bp) return;
+
+    Platform_MutexLock(&bp->lock);
+    if (!accepted) {
+        RecordGap(bp, timestamp, DROP_REJECTED);
+    } else {
+        if (bp->count == BACKPRESSURE_MAX_IN_FLIGHT) {
+            PopFlight(bp);      // Caller skipped Admit; forget the oldest
+        }
+        InFlightFrame* f = &bp->flight[(bp->head + bp->count) % BACKPRESSURE_MAX_IN_FLIGHT];
+        f->timestamp = timestamp;
+        f->submitTime = now;
+        f->unloaded = bp->count == 0;
+        bp->count++;
+        bp->stats.submitted++;
+    }
+    bp->stats.inFlight = bp->count;
+    Platform_MutexUnlock(&bp->lock);
+}
+
+void Backpressure_Completed(Backpressure* bp, int64_t timestamp, int64_t now) {
+    if (!bp) return;
+
+    Platform_MutexLock(&bp->lock);
+
+    // Frames submitted before this one that never came out were lost
+    while (bp->count > 0 && bp->flight[bp->head].timestamp < timestamp) {
+        RecordGap(bp, bp->flight[bp->head].timestamp, DROP_REJECTED);
+        PopFlight(bp);
+    }
+
+    if (bp->count > 0 && bp->flight[bp->head].timestamp == timestamp) {
+        InFlightFrame* f = &bp->flight[bp->head];
+        BackpressureStats* s = &bp->stats;
+
+        int64_t latency = now - f->submitTime;
+        Ewma(&s->latencyAvg, &bp->haveLatency, latency);
+        if (latency > s->latencyMax) s->latencyMax = latency;
+        if (f->unloaded) Ewma(&bp->unloadedLatency, &bp->haveUnloaded, latency);
+
+        // Encoder throughput: completion spacing, but only while frames were
+        // queued behind each other (otherwise it's just the arrival rate). A
+        // frame that found the encoder idle shows it is keeping up, so the
+        // estimate relaxes toward the frame interval.
+        if (bp->haveCompletion && bp->lastCompletion > f->submitTime) {
+            Ewma(&s->serviceAvg, &bp->haveService, now - bp->lastCompletion);
+        } else if (bp->haveService && s->serviceAvg > bp->frameInterval) {
+            s->serviceAvg -= (s->serviceAvg - bp->frameInterval) / (1 << EWMA_SHIFT);
+        }
+
+        bp->lastCompletion = now;
+        bp->haveCompletion = true;
+        PopFlight(bp);
+        s->completed++;
+        UpdatePolicy(bp);
+    }
+
+    bp->stats.inFlight = bp->count;
+    Platform_MutexUnlock(&bp->lock);
+}
+
+void Backpressure_GetStats(Backpressure* bp, BackpressureStats* stats) {
+    if (!bp || !stats) return;
+    Platform_MutexLock(&bp->lock);
+    *stats = bp->stats;
+    Platform_MutexUnlock(&bp->lock);
+}
+
+int Backpressure_GetGaps(Backpressure* bp, TimelineGap* gaps, int maxGaps) {
+    if (!bp || !gaps || maxGaps <= 0) return 0;
+    Platform_MutexLock(&bp->lock);
+    int n = bp->gapCount < maxGaps ? bp->gapCount : maxGaps;
+    int first = (bp->gapHead - n + BACKPRESSURE_GAP_HISTORY) % BACKPRESSURE_GAP_HISTORY;
+    for (int i = 0; i < n; i++) {
+        gaps[i] = bp->gapHistory[(first + i) % BACKPRESSURE_GAP_HISTORY];
+    }
+    Platform_MutexUnlock(&bp->lock);
+    return n;
+}
+
+const char* Backpressure_ReasonName(DropReason reason) {
+    switch (reason) {
+        case DROP_NONE:     return "none";
+        case DROP_PACED:    return "paced";
+        case DROP_FULL:     return "full";
+        case DROP_REJECTED: return "rejected";
+        default:            return "?";
+    }
+}
+
+void Backpressure_FormatStats(const BackpressureStats* stats, char* buffer, size_t size) {
+    if (!buffer || size == 0) return;
+    if (!stats) {
+        buffer[0] = '\0';
+        return;
+    }
+
+    uint64_t dropped = 0;
+    for (int r = DROP_NONE + 1; r < DROP_REASON_COUNT; r++) dropped += stats->dropped[r];
+
+    int len = snprintf(buffer, size, "depth=%d/%d inflight=%d latency avg=%.1fms max=%.1fms service=%.1fms dropped=%llu",
+                       stats->targetDepth, stats->maxInFlight, stats->inFlight,
+                       stats->latencyAvg / 10000.0, stats->latencyMax / 10000.0, stats->serviceAvg / 10000.0,
+                       (unsigned long long)dropped);
+    if (dropped > 0 && len > 0 && (size_t)len < size) {
+        snprintf(buffer + len, size - (size_t)len, " (paced=%llu full=%llu rejected=%llu) ratio=%.2f gaps=%llu",
+                 (unsigned long long)stats->dropped[DROP_PACED],
+                 (unsigned long long)stats->dropped[DROP_FULL],
+                 (unsigned long long)stats->dropped[DROP_REJECTED],
+                 stats->dropRatio, (unsigned long long)stats->gaps);
+    }
+}
@@ -0,0 +1,89 @@
+/*
+ * Backpressure - Encoder admission control and even frame dropping
+ * Portable C; the caller supplies timestamps and clock readings
+ *
+ * Sits between the capture loop and a video encoder:
+ * - Measures encode latency (submit → completion) and service time
+ *   (completion to completion while the encoder is busy)
+ * - Sizes the in-flight depth from latency: enough frames to cover one
+ *   encode, never more than the backend's ring
+ * - When the encoder can't keep up, drops frames evenly at the measured
+ *   overload ratio (e.g. every third frame at 1.5x) instead of letting the
+ *   ring fill and then losing a burst
+ * - Every dropped frame is recorded as a timeline gap (adjacent drops merge)
+ *
+ * Admit/SubmitResult run on the capture thread; Completed may run on the
+ * encoder's output thread.
+ */
+
+#ifndef BACKPRESSURE_H
+#define BACKPRESSURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BACKPRESSURE_MAX_IN_FLIGHT  16
+#define BACKPRESSURE_GAP_HISTORY    64
+
+typedef enum {
+    DROP_NONE = 0,          // Admitted: submit the frame
+    DROP_PACED,             // Overload: dropped to keep up
+    DROP_FULL,              // In-flight limit reached
+    DROP_REJECTED,          // Encoder refused the frame (or lost it)
+    DROP_REASON_COUNT
+} DropReason;
+
+// Span of timeline with no encoded frames (100-ns units)
+typedef struct {
+    int64_t start;          // Timestamp of the first dropped frame
+    int64_t end;            // Timestamp after the last dropped frame
+    int frames;
+    DropReason reason;      // Reason of the first drop
+} TimelineGap;
+
+typedef struct {
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t dropped[DROP_REASON_COUNT];    // By reason (DROP_NONE unused)
+    int inFlight;
+    int targetDepth;        // Auto-sized in-flight depth
+    int maxInFlight;        // Backend limit
+    double dropRatio;       // Current fraction of frames being dropped
+    int64_t latencyAvg;     // Submit → completion, 100-ns units
+    int64_t latencyMax;
+    int64_t serviceAvg;     // Encoder time per frame, 100-ns units
+    uint64_t gaps;          // Gaps recorded (including ones evicted from history)
+    int64_t gapTime;        // Total timeline covered by gaps
+} BackpressureStats;
+
+typedef struct Backpressure Backpressure;
+
+// maxInFlight: frames the encoder can hold (clamped to BACKPRESSURE_MAX_IN_FLIGHT)
+// frameInterval: nominal time between frames (100-ns units)
+Backpressure* Backpressure_Create(int maxInFlight, int64_t frameInterval);
+void Backpressure_Destroy(Backpressure* bp);
+
+// Decide whether to submit the frame at 'timestamp'. DROP_NONE means submit
+// and report the outcome with Backpressure_SubmitResult; any other value means
+// the frame was dropped and its gap recorded.
+DropReason Backpressure_Admit(Backpressure* bp, int64_t timestamp, int64_t now);
+
+// Outcome of submitting an admitted frame (rejections are recorded as gaps)
+void Backpressure_SubmitResult(Backpressure* bp, int64_t timestamp, int64_t now, bool accepted);
+
+// Encoder delivered the frame with this timestamp. Earlier in-flight frames
+// that never completed are counted as rejected.
+void Backpressure_Completed(Backpressure* bp, int64_t timestamp, int64_t now);
+
+void Backpressure_GetStats(Backpressure* bp, BackpressureStats* stats);
+
+// Copy up to maxGaps of the most recent gaps, oldest first. Returns count.
+int Backpressure_GetGaps(Backpressure* bp, TimelineGap* gaps, int maxGaps);
+
+const char* Backpressure_ReasonName(DropReason reason);
+
+// One-line summary for logs, e.g. "depth=3/8 inflight=2 latency avg=9.1ms max=14.0ms dropped=12 (paced=12) ratio=0.33"
+void Backpressure_FormatStats(const BackpressureStats* stats, char* buffer, size_t size);
+
+#endif // BACKPRESSURE_H
@@ -4,8 +4,14 @@
  */
 
 #include "capture.h"
+#include "mem_tracker.h"
+#include <d3d10.h>
 #include <stdio.h>
 
+// ID3D10Multithread {9B7E4E00-342C-4106-A19F-4F2704F689F0}
+static const GUID IID_ID3D10Multithread_Local =
+    { 0x9B7E4E00, 0x342C, 0x4106, { 0xA1, 0x9F, 0x4F, 0x27, 0x04, 0xF6, 0x89, 0xF0 } };
+
 // Monitor enumeration data
 typedef struct {
     int targetIndex;
@@ -257,6 +263,15 @@ BOOL Capture_Init(CaptureState* state) {
         return FALSE;
     }
     
+    // The immediate context is shared by the frame hub thread and every
+    // consumer's color converter - let D3D serialize access to it
+    ID3D10Multithread* multithread = NULL;
+    hr = state->context->lpVtbl->QueryInterface(state->context, &IID_ID3D10Multithread_Local, (void**)&multithread);
+    if (SUCCEEDED(hr)) {
+        multithread->lpVtbl->SetMultithreadProtected(multithread, TRUE);
+        multithread->lpVtbl->Release(multithread);
+    }
+    
     // Get DXGI device
     IDXGIDevice* dxgiDevice = NULL;
     hr = state->device->lpVtbl->QueryInterface(state->device, &IID_IDXGIDevice, (void**)&dxgiDevice);
@@ -308,8 +323,12 @@ BOOL Capture_SetRegion(CaptureState* state, RECT region) {
         return FALSE;
     }
     
+    int oldWidth = state->captureWidth;
+    int oldHeight = state->captureHeight;
+    
     state->captureWidth = state->captureRect.right - state->captureRect.left;
     state->captureHeight = state->captureRect.bottom - state->captureRect.top;
+    state->needFullCopy = TRUE;
     
     // Ensure even dimensions for video encoding
     state->captureWidth &= ~1;
@@ -317,11 +336,17 @@ BOOL Capture_SetRegion(CaptureState* state, RECT region) {
     state->captureRect.right = state->captureRect.left + state->captureWidth;
     state->captureRect.bottom = state->captureRect.top + state->captureHeight;
     
+    // GPU texture is sized to the region - recreate on next frame
+    if (state->gpuTexture && (state->captureWidth != oldWidth || state->captureHeight != oldHeight)) {
+        state->gpuTexture->lpVtbl->Release(state->gpuTexture);
+        state->gpuTexture = NULL;
+    }
+    
     // Reallocate frame buffer if needed
     size_t newSize = (size_t)state->captureWidth * state->captureHeight * 4;
     if (newSize > state->frameBufferSize) {
-        free(state->frameBuffer);
-        state->frameBuffer = (BYTE*)malloc(newSize);
+        MemTracker_Free(state->frameBuffer);
+        state->frameBuffer = (BYTE*)MemTracker_Alloc(MEM_TAG_CAPTURE, newSize);
         state->frameBufferSize = newSize;
     }
     
@@ -464,6 +489,54 @@ BYTE* Capture_GetFrame(CaptureState* state, UINT64* timestamp) {
     return state->frameBuffer;
 }
 
+// Check whether an acquired frame updated any pixel inside the capture region.
+// LastPresentTime == 0 means only the pointer moved. Otherwise the dirty and
+// move rects (output-relative) are intersected with the capture box.
+// Any failure to read metadata is treated as "changed".
+static BOOL FrameTouchesCaptureRect(CaptureState* state, const DXGI_OUTDUPL_FRAME_INFO* frameInfo) {
+    if (frameInfo->LastPresentTime.QuadPart == 0) return FALSE;
+    if (frameInfo->TotalMetadataBufferSize == 0) return TRUE;
+    
+    if (frameInfo->TotalMetadataBufferSize > state->metadataBufferSize) {
+        BYTE* newBuf = (BYTE*)MemTracker_Realloc(MEM_TAG_CAPTURE, state->metadataBuffer, frameInfo->TotalMetadataBufferSize);
+        if (!newBuf) return TRUE;
+        state->metadataBuffer = newBuf;
+        state->metadataBufferSize = frameInfo->TotalMetadataBufferSize;
+    }
+    
+    RECT box;
+    box.left = state->captureRect.left - state->outputDesc.DesktopCoordinates.left;
+    box.top = state->captureRect.top - state->outputDesc.DesktopCoordinates.top;
+    box.right = box.left + state->captureWidth;
+    box.bottom = box.top + state->captureHeight;
+    
+    RECT hit;
+    UINT bytesUsed = 0;
+    
+    // Move rects: destination region changes
+    HRESULT hr = state->duplication->lpVtbl->GetFrameMoveRects(state->duplication,
+        state->metadataBufferSize, (DXGI_OUTDUPL_MOVE_RECT*)state->metadataBuffer, &bytesUsed);
+    if (FAILED(hr)) return TRUE;
+    
+    DXGI_OUTDUPL_MOVE_RECT* moves = (DXGI_OUTDUPL_MOVE_RECT*)state->metadataBuffer;
+    UINT moveCount = bytesUsed / sizeof(DXGI_OUTDUPL_MOVE_RECT);
+    for (UINT i = 0; i < moveCount; i++) {
+        if (IntersectRect(&hit, &moves[i].DestinationRect, &box)) return TRUE;
+    }
+    
+    hr = state->duplication->lpVtbl->GetFrameDirtyRects(state->duplication,
+        state->metadataBufferSize, (RECT*)state->metadataBuffer, &bytesUsed);
+    if (FAILED(hr)) return TRUE;
+    
+    RECT* dirty = (RECT*)state->metadataBuffer;
+    UINT dirtyCount = bytesUsed / sizeof(RECT);
+    for (UINT i = 0; i < dirtyCount; i++) {
+        if (IntersectRect(&hit, &dirty[i], &box)) return TRUE;
+    }
+    
+    return FALSE;
+}
+
 ID3D11Texture2D* Capture_GetFrameTexture(CaptureState* state, UINT64* timestamp) {
     if (!state->initialized || !state->duplication) return NULL;
     
@@ -474,6 +547,8 @@ ID3D11Texture2D* Capture_GetFrameTexture(CaptureState* state, UINT64* timestamp)
     HRESULT hr = state->duplication->lpVtbl->AcquireNextFrame(
         state->duplication, 0, &frameInfo, &desktopResource);
     
+    state->frameChanged = FALSE;
+    
     if (hr == DXGI_ERROR_WAIT_TIMEOUT) {
         // No new frame available - return last texture to maintain frame rate
         if (state->gpuTexture) {
@@ -498,6 +573,15 @@ ID3D11Texture2D* Capture_GetFrameTexture(CaptureState* state, UINT64* timestamp)
         return NULL;
     }
     
+    // Skip the copy when nothing inside the capture region was updated
+    // (pointer-only updates, or changes on another part of the output)
+    if (state->gpuTexture && !state->needFullCopy && !FrameTouchesCaptureRect(state, &frameInfo)) {
+        desktopResource->lpVtbl->Release(desktopResource);
+        state->duplication->lpVtbl->ReleaseFrame(state->duplication);
+        if (timestamp) *timestamp = state->lastFrameTime;
+        return state->gpuTexture;
+    }
+    
     ID3D11Texture2D* desktopTexture = NULL;
     hr = desktopResource->lpVtbl->QueryInterface(desktopResource, &IID_ID3D11Texture2D, 
                                                   (void**)&desktopTexture);
@@ -551,12 +635,140 @@ ID3D11Texture2D* Capture_GetFrameTexture(CaptureState* state, UINT64* timestamp)
     desktopTexture->lpVtbl->Release(desktopTexture);
     state->duplication->lpVtbl->ReleaseFrame(state->duplication);
     
-    state->lastFrameTime = frameInfo.LastPresentTime.QuadPart;
+    if (frameInfo.LastPresentTime.QuadPart != 0) {
+        state->lastFrameTime = frameInfo.LastPresentTime.QuadPart;
+    }
     if (timestamp) *timestamp = state->lastFrameTime;
+    state->frameChanged = TRUE;
+    state->needFullCopy = FALSE;
     
     return state->gpuTexture;
 }
 
+BYTE* Capture_MapFrameTexture(CaptureState* state, ID3D11Texture2D* texture, const RECT* crop,
+                              ID3D11Texture2D** readback, int* pitch) {
+    if (!state->initialized || !texture || !readback) return NULL;
+    
+    D3D11_TEXTURE2D_DESC desc;
+    texture->lpVtbl->GetDesc(texture, &desc);
+    
+    D3D11_BOX box;
+    box.left = crop ? crop->left : 0;
+    box.top = crop ? crop->top : 0;
+    box.right = crop ? crop->right : desc.Width;
+    box.bottom = crop ? crop->bottom : desc.Height;
+    box.front = 0;
+    box.back = 1;
+    UINT width = box.right - box.left;
+    UINT height = box.bottom - box.top;
+    
+    // Recreate readback texture when the size changed
+    if (*readback) {
+        D3D11_TEXTURE2D_DESC current;
+        (*readback)->lpVtbl->GetDesc(*readback, &current);
+        if (current.Width != width || current.Height != height) {
+            (*readback)->lpVtbl->Release(*readback);
+            *readback = NULL;
+        }
+    }
+    
+    if (!*readback) {
+        D3D11_TEXTURE2D_DESC stagingDesc = {0};
+        stagingDesc.Width = width;
+        stagingDesc.Height = height;
+        stagingDesc.MipLevels = 1;
+        stagingDesc.ArraySize = 1;
+        stagingDesc.Format = desc.Format;
+        stagingDesc.SampleDesc.Count = 1;
+        stagingDesc.Usage = D3D11_USAGE_STAGING;
+        stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+        
+        HRESULT hr = state->device->lpVtbl->CreateTexture2D(state->device, &stagingDesc, NULL, readback);
+        if (FAILED(hr)) return NULL;
+    }
+    
+    state->context->lpVtbl->CopySubresourceRegion(state->context,
+        (ID3D11Resource*)*readback, 0, 0, 0, 0, (ID3D11Resource*)texture, 0, &box);
+    
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    HRESULT hr = state->context->lpVtbl->Map(state->context, (ID3D11Resource*)*readback,
+                                              0, D3D11_MAP_READ, 0, &mapped);
+    if (FAILED(hr)) return NULL;
+    
+    if (pitch) *pitch = (int)mapped.RowPitch;
+    return (BYTE*)mapped.pData;
+}
+
+void Capture_UnmapFrameTexture(CaptureState* state, ID3D11Texture2D* readback) {
+    if (!readback) return;
+    state->context->lpVtbl->Unmap(state->context, (ID3D11Resource*)readback, 0);
+}
+
+// ============================================================================
+// Frame hub source
+// ============================================================================
+
+static bool HubSource_SetRegion(void* userData, const HubRect* requested, HubRect* actual) {
+    CaptureState* state = (CaptureState*)userData;
+    if (requested->width <= 0 || requested->height <= 0) return false;
+    
+    RECT region = { requested->x, requested->y,
+                    requested->x + requested->width, requested->y + requested->height };
+    if (!Capture_SetRegion(state, region)) return false;
+    
+    actual->x = state->captureRect.left;
+    actual->y = state->captureRect.top;
+    actual->width = state->captureWidth;
+    actual->height = state->captureHeight;
+    state->hubPrimed = FALSE;
+    return true;
+}
+
+static void* HubSource_CreatePayload(void* userData) {
+    CaptureState* state = (CaptureState*)userData;
+    
+    D3D11_TEXTURE2D_DESC desc = {0};
+    desc.Width = state->captureWidth;
+    desc.Height = state->captureHeight;
+    desc.MipLevels = 1;
+    desc.ArraySize = 1;
+    desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+    desc.SampleDesc.Count = 1;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+    
+    ID3D11Texture2D* texture = NULL;
+    HRESULT hr = state->device->lpVtbl->CreateTexture2D(state->device, &desc, NULL, &texture);
+    return SUCCEEDED(hr) ? texture : NULL;
+}
+
+static void HubSource_DestroyPayload(void* userData, void* payload) {
+    (void)userData;
+    ID3D11Texture2D* texture = (ID3D11Texture2D*)payload;
+    if (texture) texture->lpVtbl->Release(texture);
+}
+
+static HubGrabResult HubSource_Grab(void* userData, void* payload) {
+    CaptureState* state = (CaptureState*)userData;
+    
+    ID3D11Texture2D* frame = Capture_GetFrameTexture(state, NULL);
+    if (!frame) return HUB_GRAB_NONE;
+    if (!state->frameChanged && state->hubPrimed) return HUB_GRAB_SAME;
+    
+    // gpuTexture is rewritten by the next acquire - consumers get their own copy
+    state->context->lpVtbl->CopyResource(state->context, (ID3D11Resource*)payload, (ID3D11Resource*)frame);
+    state->hubPrimed = TRUE;
+    return HUB_GRAB_NEW;
+}
+
+void Capture_GetHubSource(CaptureState* state, FrameHubSource* source) {
+    source->userData = state;
+    source->setRegion = HubSource_SetRegion;
+    source->createPayload = HubSource_CreatePayload;
+    source->destroyPayload = HubSource_DestroyPayload;
+    source->grab = HubSource_Grab;
+}
+
 void Capture_ReleaseFrame(CaptureState* state) {
     (void)state; // Frame is already released in GetFrame
 }
@@ -567,10 +779,16 @@ int Capture_GetRefreshRate(CaptureState* state) {
 
 void Capture_Shutdown(CaptureState* state) {
     if (state->frameBuffer) {
-        free(state->frameBuffer);
+        MemTracker_Free(state->frameBuffer);
         state->frameBuffer = NULL;
     }
     
+    if (state->metadataBuffer) {
+        MemTracker_Free(state->metadataBuffer);
+        state->metadataBuffer = NULL;
+        state->metadataBufferSize = 0;
+    }
+    
     if (state->gpuTexture) {
         state->gpuTexture->lpVtbl->Release(state->gpuTexture);
         state->gpuTexture = NULL;
@@ -9,6 +9,7 @@
 #include <windows.h>
 #include <d3d11.h>
 #include <dxgi1_2.h>
+#include "frame_hub.h"
 
 typedef struct {
     // D3D11 resources
@@ -36,6 +37,13 @@ typedef struct {
     size_t frameBufferSize;
     UINT64 lastFrameTime;
     
+    // Change tracking (for variable frame rate consumers)
+    BOOL frameChanged;                    // Last GetFrameTexture produced new content
+    BOOL needFullCopy;                    // Next acquired frame must be copied regardless of dirty rects
+    BYTE* metadataBuffer;                 // Dirty/move rect scratch buffer
+    UINT metadataBufferSize;
+    BOOL hubPrimed;                       // Frame hub has a copy of the current region's content
+    
     // State
     BOOL initialized;
     BOOL capturing;
@@ -69,8 +77,22 @@ void Capture_Shutdown(CaptureState* state);
 // Get frame as GPU texture (stays on GPU, no CPU copy)
 // Returns a BGRA texture that can be used for GPU processing
 // Caller must NOT release the texture - it's owned by capture state
+// state->frameChanged tells whether the capture region changed since the last call
 ID3D11Texture2D* Capture_GetFrameTexture(CaptureState* state, UINT64* timestamp);
 
+// Map a BGRA capture texture (or the crop rect of it, NULL = whole) for CPU reads.
+// *readback is a caller-owned staging texture, created/resized on demand;
+// release it when done. Returns NULL on failure.
+// Must be paired with Capture_UnmapFrameTexture.
+BYTE* Capture_MapFrameTexture(CaptureState* state, ID3D11Texture2D* texture, const RECT* crop,
+                              ID3D11Texture2D** readback, int* pitch);
+void Capture_UnmapFrameTexture(CaptureState* state, ID3D11Texture2D* readback);
+
+// Frame hub source over this capture state. Hub payloads are ID3D11Texture2D*
+// (BGRA, capture size) on state->device; frames with no change in the region
+// are re-delivered without a copy.
+void Capture_GetHubSource(CaptureState* state, FrameHubSource* source);
+
 // Helper: Get window rect for window capture mode
 BOOL Capture_GetWindowRect(HWND hwnd, RECT* rect);
 
@@ -9,6 +9,11 @@
 static const char* FORMAT_EXTENSIONS[] = { ".mp4", ".avi", ".wmv" };
 static const char* FORMAT_NAMES[] = { "MP4 (H.264)", "AVI", "WMV" };
 
+// [Threads] key prefix per ThreadRole
+static const char* THREAD_ROLE_KEYS[THREAD_ROLE_COUNT] = {
+    "Capture", "Encode", "EncoderOutput", "AudioCapture", "Mixer", "Save", "Logger"
+};
+
 void Config_GetPath(char* buffer, size_t size) {
     // Store config next to executable
     GetModuleFileNameA(NULL, buffer, (DWORD)size);
@@ -44,6 +49,10 @@ void Config_Load(AppConfig* config) {
     config->replayAreaRect.bottom = 0;
     config->replayAspectRatio = 0;  // Native (no aspect ratio cropping)
     config->replayFPS = 60;          // 60 FPS default
+    config->replayVFR = FALSE;       // Constant frame rate by default
+    config->replayEncoder = ENCODER_BACKEND_AUTO;
+    config->replayMemoryMB = 0;      // Fixed quality, memory follows content
+    config->replayTrace = FALSE;
     
     // Audio defaults (disabled, no sources selected)
     config->audioEnabled = FALSE;
@@ -54,6 +63,11 @@ void Config_Load(AppConfig* config) {
     config->audioVolume2 = 100;
     config->audioVolume3 = 100;
     
+    // Thread defaults come from the registry's built-in policies
+    for (int i = 0; i < THREAD_ROLE_COUNT; i++) {
+        ThreadRegistry_GetDefaultPolicy((ThreadRole)i, &config->threadPolicy[i]);
+    }
+    
     // Default save path to Videos folder
     if (SUCCEEDED(SHGetFolderPathA(NULL, CSIDL_MYVIDEO, NULL, 0, config->savePath))) {
         strcat(config->savePath, "\\Recordings");
@@ -102,6 +116,14 @@ void Config_Load(AppConfig* config) {
             "ReplayBuffer", "AspectRatio", 0, configPath);
         config->replayFPS = GetPrivateProfileIntA(
             "ReplayBuffer", "FPS", 60, configPath);
+        config->replayVFR = GetPrivateProfileIntA(
+            "ReplayBuffer", "VariableFrameRate", FALSE, configPath);
+        config->replayEncoder = (EncoderBackend)GetPrivateProfileIntA(
+            "ReplayBuffer", "Encoder", ENCODER_BACKEND_AUTO, configPath);
+        config->replayMemoryMB = GetPrivateProfileIntA(
+            "ReplayBuffer", "MemoryBudgetMB", 0, configPath);
+        config->replayTrace = GetPrivateProfileIntA(
+            "ReplayBuffer", "Trace", FALSE, configPath);
         
         // Audio settings
         config->audioEnabled = GetPrivateProfileIntA(
@@ -116,6 +138,18 @@ void Config_Load(AppConfig* config) {
         config->audioVolume2 = GetPrivateProfileIntA("Audio", "Volume2", 100, configPath);
         config->audioVolume3 = GetPrivateProfileIntA("Audio", "Volume3", 100, configPath);
         
+        // Thread policies: priority -1 (below normal) to 3 (time critical),
+        // affinity as a CPU bit mask ("0x0F" = CPUs 0-3, 0 = any)
+        for (int i = 0; i < THREAD_ROLE_COUNT; i++) {
+            char key[48], value[32];
+            ThreadPolicy* policy = &config->threadPolicy[i];
+            sprintf(key, "%sPriority", THREAD_ROLE_KEYS[i]);
+            policy->level = (ThreadLevel)GetPrivateProfileIntA("Threads", key, policy->level, configPath);
+            sprintf(key, "%sAffinity", THREAD_ROLE_KEYS[i]);
+            GetPrivateProfileStringA("Threads", key, "0", value, sizeof(value), configPath);
+            policy->affinity = _strtoui64(value, NULL, 0);
+        }
+        
         GetPrivateProfileStringA("Recording", "SavePath", config->savePath,
             config->savePath, MAX_PATH, configPath);
         
@@ -190,6 +224,18 @@ void Config_Save(const AppConfig* config) {
     sprintf(buffer, "%d", config->replayFPS);
     WritePrivateProfileStringA("ReplayBuffer", "FPS", buffer, configPath);
     
+    sprintf(buffer, "%d", config->replayVFR);
+    WritePrivateProfileStringA("ReplayBuffer", "VariableFrameRate", buffer, configPath);
+    
+    sprintf(buffer, "%d", config->replayEncoder);
+    WritePrivateProfileStringA("ReplayBuffer", "Encoder", buffer, configPath);
+    
+    sprintf(buffer, "%d", config->replayMemoryMB);
+    WritePrivateProfileStringA("ReplayBuffer", "MemoryBudgetMB", buffer, configPath);
+    
+    sprintf(buffer, "%d", config->replayTrace);
+    WritePrivateProfileStringA("ReplayBuffer", "Trace", buffer, configPath);
+    
     // Audio settings
     sprintf(buffer, "%d", config->audioEnabled);
     WritePrivateProfileStringA("Audio", "Enabled", buffer, configPath);
@@ -203,6 +249,23 @@ void Config_Save(const AppConfig* config) {
     sprintf(buffer, "%d", config->audioVolume3);
     WritePrivateProfileStringA("Audio", "Volume3", buffer, configPath);
     
+    // Thread policies: only what differs from the built-in default, so a
+    // role left alone follows the default of whichever build reads the file
+    // (a NULL value deletes the key)
+    for (int i = 0; i < THREAD_ROLE_COUNT; i++) {
+        char key[48];
+        ThreadPolicy defaults;
+        ThreadRegistry_GetDefaultPolicy((ThreadRole)i, &defaults);
+        sprintf(key, "%sPriority", THREAD_ROLE_KEYS[i]);
+        sprintf(buffer, "%d", config->threadPolicy[i].level);
+        WritePrivateProfileStringA("Threads", key,
+            config->threadPolicy[i].level != defaults.level ? buffer : NULL, configPath);
+        sprintf(key, "%sAffinity", THREAD_ROLE_KEYS[i]);
+        sprintf(buffer, "0x%llX", (unsigned long long)config->threadPolicy[i].affinity);
+        WritePrivateProfileStringA("Threads", key,
+            config->threadPolicy[i].affinity != defaults.affinity ? buffer : NULL, configPath);
+    }
+    
     WritePrivateProfileStringA("Recording", "SavePath", config->savePath, configPath);
     
     sprintf(buffer, "%ld", config->lastCaptureRect.left);
@@ -6,7 +6,8 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
-#include <windows.h>
+#include "platform.h"
+#include "thread_registry.h"
 
 // Output formats
 typedef enum {
@@ -33,6 +34,19 @@ typedef enum {
     QUALITY_LOSSLESS
 } QualityPreset;
 
+// Video encoder backend preference
+typedef enum {
+    ENCODER_BACKEND_AUTO = 0,   // NVENC if available, else software
+    ENCODER_BACKEND_NVENC,      // NVIDIA hardware encoder only
+    ENCODER_BACKEND_SOFTWARE    // CPU encoder (Media Foundation MFT)
+} EncoderBackend;
+
+// Encoded video codecs
+typedef enum {
+    VIDEO_CODEC_HEVC = 0,
+    VIDEO_CODEC_H264
+} VideoCodec;
+
 typedef struct {
     // Recording settings
     OutputFormat outputFormat;
@@ -53,6 +67,10 @@ typedef struct {
     RECT replayAreaRect;             // Custom area for replay (if MODE_AREA)
     int replayAspectRatio;           // 0=Native, 1=16:9, 2=16:10, 3=4:3, 4=21:9, 5=32:9
     int replayFPS;                   // 30 or 60
+    BOOL replayVFR;                  // Variable frame rate: skip unchanged frames
+    EncoderBackend replayEncoder;    // Encoder backend preference
+    int replayMemoryMB;              // RAM budget for the buffer (0 = no limit, fixed quality)
+    BOOL replayTrace;                // Record pipeline trace; each save writes <clip>.trace.json
     
     // Audio capture settings
     BOOL audioEnabled;               // Enable audio capture
@@ -63,6 +81,9 @@ typedef struct {
     int audioVolume2;                // Volume 0-100 for source 2
     int audioVolume3;                // Volume 0-100 for source 3
     
+    // Pipeline thread scheduling, per role ([Threads] <Role>Priority / <Role>Affinity)
+    ThreadPolicy threadPolicy[THREAD_ROLE_COUNT];
+    
     // Save location
     char savePath[MAX_PATH];
     
@@ -0,0 +1,414 @@
+/*
+ * Control Implementation
+ */
+
+#include "control.h"
+#include "metrics.h"
+#include "platform.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define UNITS_PER_MS 10000LL
+
+struct ControlQueue {
+    PlatformMutex lock;
+    PlatformEvent queued;                   // Auto-reset: a job was added
+    ControlJob jobs[CONTROL_HISTORY];       // Job n lives in slot n % CONTROL_HISTORY
+    uint32_t nextId;
+    uint32_t nextRun;                       // Oldest job not yet taken
+    uint32_t running;                       // 0 = idle
+    uint64_t completed;
+    uint64_t failed;
+    uint64_t refused;                       // Requests turned away while full
+};
+
+static const char* g_commandNames[CONTROL_COMMAND_COUNT] = {
+    "start", "stop", "restart", "save", "reconfigure", "status", "result", "quit"
+};
+
+static const char* g_jobStateNames[] = { "queued", "running", "done", "failed" };
+
+static const char* g_qualityNames[] = { "low", "medium", "high", "lossless" };
+
+const char* Control_CommandName(ControlCommandType type) {
+    return (int)type >= 0 && (int)type < CONTROL_COMMAND_COUNT ? g_commandNames[type] : "unknown";
+}
+
+// ============================================================================
+// Parsing
+// ============================================================================
+
+static bool Equals(const char* a, const char* b) {
+    while (*a && *b) {
+        if (tolower((unsigned char)*a) != tolower((unsigned char)*b)) return false;
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+// Next whitespace-separated token ("quoted" tokens may contain spaces).
+// Returns false at the end of the line.
+static bool NextToken(const char** cursor, char* token, size_t size, bool* tooLong) {
+    const char* p = *cursor;
+    while (*p == ' ' || *p == '\t') p++;
+    if (*p == '\0') return false;
+
+    bool quoted = *p == '"';
+    if (quoted) p++;
+    size_t n = 0;
+    *tooLong = false;
+    while (*p && (quoted ? *p != '"' : (*p != ' ' && *p != '\t'))) {
+        if (n + 1 < size) token[n++] = *p;
+        else *tooLong = true;
+        p++;
+    }
+    if (quoted && *p == '"') p++;
+    token[n] = '\0';
+    *cursor = p;
+    return true;
+}
+
+// Whole-token integer in [min, max]
+static bool ParseInt(const char* text, int min, int max, int* value) {
+    if (!*text) return false;
+    char* end = NULL;
+    long v = strtol(text, &end, 10);
+    if (*end != '\0' || v < min || v > max) return false;
+    *value = (int)v;
+    return true;
+}
+
+static bool ParseSwitch(const char* text, int* value) {
+    if (Equals(text, "on") || Equals(text, "true") || Equals(text, "1")) { *value = 1; return true; }
+    if (Equals(text, "off") || Equals(text, "false") || Equals(text, "0")) { *value = 0; return true; }
+    return false;
+}
+
+static bool ParseQuality(const char* text, int* value) {
+    for (int i = 0; i < (int)(sizeof(g_qualityNames) / sizeof(g_qualityNames[0])); i++) {
+        if (Equals(text, g_qualityNames[i])) {
+            *value = i;
+            return true;
+        }
+    }
+    return ParseInt(text, 0, 3, value);
+}
+
+static bool ParseSetting(const char* token, ControlSettings* s) {
+    char key[32];
+    const char* eq = strchr(token, '=');
+    if (!eq || eq == token || (size_t)(eq - token) >= sizeof(key)) return false;
+    memcpy(key, token, eq - token);
+    key[eq - token] = '\0';
+    const char* value = eq + 1;
+
+    if (Equals(key, "duration")) return ParseInt(value, 5, 1200, &s->durationSeconds);
+    if (Equals(key, "fps"))      return ParseInt(value, 30, 120, &s->fps);
+    if (Equals(key, "quality"))  return ParseQuality(value, &s->quality);
+    if (Equals(key, "memory"))   return ParseInt(value, 0, 1024 * 1024, &s->memoryMB);
+    if (Equals(key, "vfr"))      return ParseSwitch(value, &s->vfr);
+    if (Equals(key, "audio"))    return ParseSwitch(value, &s->audio);
+    if (Equals(key, "monitor"))  return ParseInt(value, 0, 15, &s->monitor);
+    return false;
+}
+
+bool Control_Parse(const char* line, ControlCommand* command, char* error, size_t errorSize) {
+    memset(command, 0, sizeof(*command));
+    ControlSettings* s = &command->settings;
+    s->durationSeconds = s->fps = s->quality = s->memoryMB = s->vfr = s->audio = s->monitor = -1;
+
+    const char* cursor = line ? line : "";
+    char token[CONTROL_MAX_REQUEST];
+    bool tooLong = false;
+    if (!NextToken(&cursor, token, sizeof(token), &tooLong)) {
+        snprintf(error, errorSize, "empty request");
+        return false;
+    }
+
+    int type = 0;
+    while (type < CONTROL_COMMAND_COUNT && !Equals(token, g_commandNames[type])) type++;
+    if (type == CONTROL_COMMAND_COUNT) {
+        snprintf(error, errorSize, "unknown command");
+        return false;
+    }
+    command->type = (ControlCommandType)type;
+
+    int args = 0;
+    bool haveSeconds = false;
+    while (NextToken(&cursor, token, sizeof(token), &tooLong)) {
+        args++;
+        switch (command->type) {
+            case CONTROL_SAVE: {
+                // A bare number is the clip length, never a file name
+                int seconds;
+                if (strspn(token, "0123456789") == strlen(token)) {
+                    if (haveSeconds || !ParseInt(token, 1, 24 * 3600, &seconds)) {
+                        snprintf(error, errorSize, "save: seconds must be 1..%d", 24 * 3600);
+                        return false;
+                    }
+                    command->seconds = seconds;
+                    haveSeconds = true;
+                } else if (!command->path[0] && !tooLong && strlen(token) < CONTROL_MAX_PATH) {
+                    strcpy(command->path, token);
+                } else {
+                    snprintf(error, errorSize, "usage: save [path] [seconds]");
+                    return false;
+                }
+                break;
+            }
+            case CONTROL_RESULT: {
+                int id;
+                if (args > 1 || !ParseInt(token, 1, 0x7FFFFFFF, &id)) {
+                    snprintf(error, errorSize, "usage: result <id>");
+                    return false;
+                }
+                command->id = (uint32_t)id;
+                break;
+            }
+            case CONTROL_RECONFIGURE:
+                if (!ParseSetting(token, s)) {
+                    snprintf(error, errorSize, "bad setting '%.64s'", token);
+                    return false;
+                }
+                break;
+            default:
+                snprintf(error, errorSize, "%s takes no arguments", g_commandNames[type]);
+                return false;
+        }
+    }
+
+    if (command->type == CONTROL_RESULT && args == 0) {
+        snprintf(error, errorSize, "usage: result <id>");
+        return false;
+    }
+    if (command->type == CONTROL_RECONFIGURE && args == 0) {
+        snprintf(error, errorSize, "usage: reconfigure key=value ...");
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Responses
+// ============================================================================
+
+typedef struct {
+    char* buffer;
+    size_t size;
+    size_t length;              // Chars that would have been written
+} ControlWriter;
+
+static void Append(ControlWriter* w, const char* format, ...) {
+    size_t offset = w->length < w->size ? w->length : w->size;
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(w->buffer + offset, w->size - offset, format, args);
+    va_end(args);
+    if (n > 0) w->length += (size_t)n;
+}
+
+static void AppendString(ControlWriter* w, const char* text) {
+    Append(w, "\"");
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        if (*p == '"' || *p == '\\') Append(w, "\\%c", *p);
+        else if (*p < 0x20) Append(w, "\\u%04x", *p);
+        else Append(w, "%c", *p);
+    }
+    Append(w, "\"");
+}
+
+static void AppendError(ControlWriter* w, const char* error) {
+    Append(w, "{\"ok\":false,\"error\":");
+    AppendString(w, error);
+    Append(w, "}\n");
+}
+
+static double Ms(int64_t units) {
+    return (double)units / UNITS_PER_MS;
+}
+
+static void AppendJob(ControlWriter* w, const ControlJob* job, int64_t now) {
+    int64_t started = job->state == CONTROL_JOB_QUEUED ? now : job->startedAt;
+    int64_t finished = job->state == CONTROL_JOB_DONE || job->state == CONTROL_JOB_FAILED ? job->finishedAt : now;
+    Append(w, "{\"ok\":true,\"id\":%u,\"command\":\"%s\",\"state\":\"%s\",\"queued_ms\":%.1f,\"run_ms\":%.1f",
+           job->id, Control_CommandName(job->command.type), g_jobStateNames[job->state],
+           Ms(started - job->queuedAt), job->state == CONTROL_JOB_QUEUED ? 0.0 : Ms(finished - started));
+    if (job->command.type == CONTROL_SAVE && job->command.seconds > 0) {
+        Append(w, ",\"seconds\":%d", job->command.seconds);
+    }
+    if (job->detail[0]) {
+        Append(w, ",\"detail\":");
+        AppendString(w, job->detail);
+    }
+    Append(w, "}\n");
+}
+
+static void AppendStatus(ControlQueue* queue, ControlWriter* w) {
+    Platform_MutexLock(&queue->lock);
+    Append(w, "{\"ok\":true,\"jobs\":{\"queued\":%u,\"running\":%u,\"last\":%u,"
+              "\"completed\":%llu,\"failed\":%llu,\"refused\":%llu},",
+           queue->nextId - queue->nextRun, queue->running, queue->nextId - 1,
+           (unsigned long long)queue->completed, (unsigned long long)queue->failed,
+           (unsigned long long)queue->refused);
+    Platform_MutexUnlock(&queue->lock);
+
+    // The replay thread's last snapshot (null before the first publish)
+    MetricsSnapshot snapshot;
+    int64_t ageMs = 0;
+    Append(w, "\"metrics\":");
+    if (Metrics_Read(&snapshot, &ageMs)) {
+        size_t offset = w->length < w->size ? w->length : w->size;
+        int n = Metrics_FormatJson(&snapshot, ageMs, w->buffer + offset, w->size - offset);
+        if (n > 0) {
+            // Drop the formatter's trailing newline to nest the object
+            if ((size_t)n < w->size - offset && w->buffer[offset + n - 1] == '\n') {
+                w->buffer[offset + --n] = '\0';
+            }
+            w->length += (size_t)n;
+        }
+    } else {
+        Append(w, "null");
+    }
+    Append(w, "}\n");
+}
+
+// ============================================================================
+// Queue
+// ============================================================================
+
+ControlQueue* ControlQueue_Create(void) {
+    ControlQueue* queue = (ControlQueue*)calloc(1, sizeof(ControlQueue));
+    if (!queue) return NULL;
+    if (!Platform_EventCreate(&queue->queued, false, false)) {
+        free(queue);
+        return NULL;
+    }
+    Platform_MutexInit(&queue->lock);
+    queue->nextId = 1;
+    queue->nextRun = 1;
+    return queue;
+}
+
+void ControlQueue_Destroy(ControlQueue* queue) {
+    if (!queue) return;
+    Platform_MutexDestroy(&queue->lock);
+    Platform_EventDestroy(&queue->queued);
+    free(queue);
+}
+
+static uint32_t Enqueue(ControlQueue* queue, const ControlCommand* command, uint32_t* position) {
+    Platform_MutexLock(&queue->lock);
+    uint32_t pending = queue->nextId - queue->nextRun;
+    if (pending >= CONTROL_MAX_PENDING) {
+        queue->refused++;
+        Platform_MutexUnlock(&queue->lock);
+        return 0;
+    }
+
+    uint32_t id = queue->nextId++;
+    ControlJob* job = &queue->jobs[id % CONTROL_HISTORY];
+    memset(job, 0, sizeof(*job));
+    job->id = id;
+    job->command = *command;
+    job->state = CONTROL_JOB_QUEUED;
+    job->queuedAt = Platform_Now();
+    if (position) *position = pending + (queue->running ? 1 : 0);
+    Platform_MutexUnlock(&queue->lock);
+
+    Platform_EventSet(&queue->queued);
+    return id;
+}
+
+int ControlQueue_Handle(ControlQueue* queue, const char* request, char* response, size_t size) {
+    if (!queue || !response || size == 0) return 0;
+    ControlWriter w = { response, size, 0 };
+    response[0] = '\0';
+
+    ControlCommand command;
+    char error[128];
+    if (!Control_Parse(request, &command, error, sizeof(error))) {
+        AppendError(&w, error);
+        return (int)w.length;
+    }
+
+    if (command.type == CONTROL_STATUS) {
+        AppendStatus(queue, &w);
+    } else if (command.type == CONTROL_RESULT) {
+        ControlJob job;
+        if (ControlQueue_GetJob(queue, command.id, &job)) {
+            AppendJob(&w, &job, Platform_Now());
+        } else {
+            AppendError(&w, "unknown job");
+        }
+    } else {
+        uint32_t position = 0;
+        uint32_t id = Enqueue(queue, &command, &position);
+        if (id) {
+            // Jobs ahead of this one, including the one running
+            Append(&w, "{\"ok\":true,\"id\":%u,\"command\":\"%s\",\"state\":\"queued\",\"ahead\":%u}\n",
+                   id, Control_CommandName(command.type), position);
+        } else {
+            AppendError(&w, "busy");
+        }
+    }
+    return (int)w.length;
+}
+
+uint32_t ControlQueue_Post(ControlQueue* queue, const ControlCommand* command) {
+    if (!queue || !command) return 0;
+    return Enqueue(queue, command, NULL);
+}
+
+bool ControlQueue_Wait(ControlQueue* queue, int timeoutMs) {
+    if (!queue) return false;
+    return Platform_EventWait(&queue->queued, timeoutMs);
+}
+
+bool ControlQueue_Take(ControlQueue* queue, ControlJob* job) {
+    if (!queue || !job) return false;
+    Platform_MutexLock(&queue->lock);
+    if (queue->nextRun == queue->nextId) {
+        Platform_MutexUnlock(&queue->lock);
+        return false;
+    }
+    ControlJob* next = &queue->jobs[queue->nextRun % CONTROL_HISTORY];
+    next->state = CONTROL_JOB_RUNNING;
+    next->startedAt = Platform_Now();
+    queue->running = next->id;
+    queue->nextRun++;
+    *job = *next;
+    Platform_MutexUnlock(&queue->lock);
+    return true;
+}
+
+void ControlQueue_Finish(ControlQueue* queue, uint32_t id, bool ok, const char* detail) {
+    if (!queue) return;
+    Platform_MutexLock(&queue->lock);
+    ControlJob* job = &queue->jobs[id % CONTROL_HISTORY];
+    if (job->id == id && job->state == CONTROL_JOB_RUNNING) {
+        job->state = ok ? CONTROL_JOB_DONE : CONTROL_JOB_FAILED;
+        job->finishedAt = Platform_Now();
+        if (detail) {
+            strncpy(job->detail, detail, sizeof(job->detail) - 1);
+            job->detail[sizeof(job->detail) - 1] = '\0';
+        }
+        if (ok) queue->completed++;
+        else queue->failed++;
+    }
+    if (queue->running == id) queue->running = 0;
+    Platform_MutexUnlock(&queue->lock);
+}
+
+bool ControlQueue_GetJob(ControlQueue* queue, uint32_t id, ControlJob* job) {
+    if (!queue || !job || id == 0) return false;
+    Platform_MutexLock(&queue->lock);
+    const ControlJob* slot = &queue->jobs[id % CONTROL_HISTORY];
+    bool found = slot->id == id;
+    if (found) *job = *slot;
+    Platform_MutexUnlock(&queue->lock);
+    return found;
+}
@@ -0,0 +1,114 @@
+/*
+ * Control - Command protocol and job queue for the headless daemon
+ * Portable C; the transport (control_server.c) and the thread that runs the
+ * jobs (headless.c) live elsewhere
+ *
+ * One request line in, one JSON object out:
+ *   start | stop | restart
+ *   save [path] [seconds]          seconds: clip length (default: whole buffer)
+ *   reconfigure key=value ...      duration, fps, quality, memory, vfr, audio, monitor
+ *   status                         job queue plus the metrics snapshot
+ *   result <id>                    state and timings of one job
+ *   quit
+ *
+ * Commands that act on the replay buffer become jobs. ControlQueue_Handle
+ * answers at once with the job id, and the owning thread runs jobs in order
+ * (Take/Finish), so a client never waits behind a save; it polls
+ * "result <id>". status and result are answered from the job table and the
+ * published metrics (metrics.h), without touching the pipeline. At most
+ * CONTROL_MAX_PENDING jobs wait at a time; beyond that requests are refused
+ * ("busy") rather than queued without bound.
+ */
+
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define CONTROL_MAX_REQUEST     1024
+#define CONTROL_MAX_PATH        260
+#define CONTROL_MAX_PENDING     16
+#define CONTROL_HISTORY         64      // Jobs kept for "result" (pending included)
+#define CONTROL_RESPONSE_SIZE   (64 * 1024)
+
+typedef enum {
+    CONTROL_START,
+    CONTROL_STOP,
+    CONTROL_RESTART,
+    CONTROL_SAVE,
+    CONTROL_RECONFIGURE,
+    CONTROL_STATUS,
+    CONTROL_RESULT,
+    CONTROL_QUIT,
+    CONTROL_COMMAND_COUNT
+} ControlCommandType;
+
+// Replay settings to change (-1 = unchanged)
+typedef struct {
+    int durationSeconds;
+    int fps;
+    int quality;                // QualityPreset
+    int memoryMB;               // 0 = fixed quality
+    int vfr;
+    int audio;
+    int monitor;
+} ControlSettings;
+
+typedef struct {
+    ControlCommandType type;
+    char path[CONTROL_MAX_PATH];    // save: empty = default name in the save folder
+    int seconds;                    // save: clip length, 0 = whole buffer
+    uint32_t id;                    // result: job to report
+    ControlSettings settings;       // reconfigure
+} ControlCommand;
+
+typedef enum {
+    CONTROL_JOB_QUEUED,
+    CONTROL_JOB_RUNNING,
+    CONTROL_JOB_DONE,
+    CONTROL_JOB_FAILED
+} ControlJobState;
+
+typedef struct {
+    uint32_t id;                    // From 1
+    ControlCommand command;
+    ControlJobState state;
+    int64_t queuedAt;               // Platform_Now (100-ns units)
+    int64_t startedAt;
+    int64_t finishedAt;
+    char detail[CONTROL_MAX_PATH];  // Saved file, or why the job failed
+} ControlJob;
+
+typedef struct ControlQueue ControlQueue;
+
+// Parse one request line. False (with a message in 'error') if malformed.
+bool Control_Parse(const char* line, ControlCommand* command, char* error, size_t errorSize);
+
+const char* Control_CommandName(ControlCommandType type);
+
+ControlQueue* ControlQueue_Create(void);
+void ControlQueue_Destroy(ControlQueue* queue);
+
+// Transport side: parse a request, queue it or answer it, and render the
+// JSON response. Returns chars written (snprintf rules).
+int ControlQueue_Handle(ControlQueue* queue, const char* request, char* response, size_t size);
+
+// Queue a job from inside the process (e.g. a restart after a stall).
+// Returns the job id, 0 if the queue is full.
+uint32_t ControlQueue_Post(ControlQueue* queue, const ControlCommand* command);
+
+// Owner side: wait up to timeoutMs for a job to be queued
+bool ControlQueue_Wait(ControlQueue* queue, int timeoutMs);
+
+// Oldest queued job, marked running. False if none is waiting.
+bool ControlQueue_Take(ControlQueue* queue, ControlJob* job);
+
+// Complete the running job; 'detail' (optional) is reported by "result"
+void ControlQueue_Finish(ControlQueue* queue, uint32_t id, bool ok, const char* detail);
+
+// Copy of a job still in the table
+bool ControlQueue_GetJob(ControlQueue* queue, uint32_t id, ControlJob* job);
+
+#endif // CONTROL_H
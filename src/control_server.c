@@ -0,0 +1,188 @@
+/*
+ * Control Server Implementation
+ * One overlapped pipe instance, served a client at a time on its own thread
+ */
+
+#include "control_server.h"
+#include "mem_tracker.h"
+#include "logger.h"
+#include <stdio.h>
+#include <string.h>
+
+// How long a response write may take
+#define CONTROL_WRITE_TIMEOUT_MS 1000
+
+// Alias for logging
+#define ControlLog Logger_Log
+
+static HANDLE g_serverThread = NULL;
+static HANDLE g_stopEvent = NULL;
+static ControlQueue* g_queue = NULL;
+static char g_pipeName[128];
+
+// ============================================================================
+// Pipe I/O
+// ============================================================================
+
+// Wait for an overlapped operation. FALSE on stop, timeout or error (the
+// operation is cancelled, so the OVERLAPPED can be reused).
+static BOOL WaitIo(HANDLE pipe, OVERLAPPED* ov, DWORD timeoutMs, DWORD* bytes) {
+    HANDLE handles[2] = { ov->hEvent, g_stopEvent };
+    DWORD result = WaitForMultipleObjects(2, handles, FALSE, timeoutMs);
+    if (result != WAIT_OBJECT_0) {
+        CancelIo(pipe);
+        GetOverlappedResult(pipe, ov, bytes, TRUE);
+        return FALSE;
+    }
+    return GetOverlappedResult(pipe, ov, bytes, FALSE);
+}
+
+static BOOL WaitForClient(HANDLE pipe, OVERLAPPED* ov) {
+    DWORD bytes;
+    ResetEvent(ov->hEvent);
+    if (ConnectNamedPipe(pipe, ov)) return TRUE;
+
+    switch (GetLastError()) {
+        case ERROR_PIPE_CONNECTED:  return TRUE;    // Connected between create and connect
+        case ERROR_IO_PENDING:      return WaitIo(pipe, ov, INFINITE, &bytes);
+        default:                    return FALSE;
+    }
+}
+
+// One request line. A client may write it in pieces, so read until a newline,
+// the buffer is full, the client closes its end, or the deadline passes.
+// Returns FALSE if nothing usable arrived.
+static BOOL ReadRequest(HANDLE pipe, OVERLAPPED* ov, char* request, DWORD size) {
+    DWORD length = 0;
+    ULONGLONG deadline = GetTickCount64() + CONTROL_REQUEST_TIMEOUT_MS;
+    request[0] = '\0';
+
+    while (length < size - 1 && !memchr(request, '\n', length)) {
+        ULONGLONG now = GetTickCount64();
+        if (now >= deadline) break;
+
+        DWORD bytes = 0;
+        ResetEvent(ov->hEvent);
+        if (!ReadFile(pipe, request + length, size - 1 - length, &bytes, ov)) {
+            if (GetLastError() != ERROR_IO_PENDING) break;  // Client closed its end
+            if (!WaitIo(pipe, ov, (DWORD)(deadline - now), &bytes)) break;
+        }
+        if (bytes == 0) break;
+        length += bytes;
+    }
+    request[length] = '\0';
+
+    // The line ends at the first CR/LF; an unterminated line counts as whole
+    request[strcspn(request, "\r\n")] = '\0';
+    return length > 0;
+}
+
+static BOOL WriteResponse(HANDLE pipe, OVERLAPPED* ov, const char* response, DWORD size) {
+    DWORD bytes = 0;
+    ResetEvent(ov->hEvent);
+    if (!WriteFile(pipe, response, size, &bytes, ov)) {
+        if (GetLastError() != ERROR_IO_PENDING) return FALSE;
+        if (!WaitIo(pipe, ov, CONTROL_WRITE_TIMEOUT_MS, &bytes)) return FALSE;
+    }
+    return bytes == size;
+}
+
+// ============================================================================
+// Server thread
+// ============================================================================
+
+static void Serve(HANDLE pipe, OVERLAPPED* ov, char* response) {
+    char request[CONTROL_MAX_REQUEST];
+    if (!ReadRequest(pipe, ov, request, sizeof(request))) return;
+
+    int length = ControlQueue_Handle(g_queue, request, response, CONTROL_RESPONSE_SIZE);
+    if (length >= CONTROL_RESPONSE_SIZE) {
+        ControlLog("Control: response truncated (%d bytes needed)\n", length);
+        length = CONTROL_RESPONSE_SIZE - 1;
+    }
+
+    // DisconnectNamedPipe discards what the client hasn't read yet, so wait
+    // until it has (ControlServer_Stop cancels this for a client that never reads)
+    if (length > 0 && WriteResponse(pipe, ov, response, (DWORD)length)) {
+        FlushFileBuffers(pipe);
+    }
+}
+
+static DWORD WINAPI ServerThread(LPVOID param) {
+    (void)param;
+    char* response = (char*)MemTracker_Alloc(MEM_TAG_DIAGNOSTICS, CONTROL_RESPONSE_SIZE);
+    OVERLAPPED ov = {0};
+    ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!response || !ov.hEvent) {
+        ControlLog("Control: server thread setup failed\n");
+        MemTracker_Free(response);
+        if (ov.hEvent) CloseHandle(ov.hEvent);
+        return 1;
+    }
+
+    while (WaitForSingleObject(g_stopEvent, 0) != WAIT_OBJECT_0) {
+        HANDLE pipe = CreateNamedPipeA(g_pipeName,
+            PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED,
+            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+            1, CONTROL_RESPONSE_SIZE, CONTROL_MAX_REQUEST, 0, NULL);
+        if (pipe == INVALID_HANDLE_VALUE) {
+            ControlLog("Control: CreateNamedPipe failed (%lu), retrying\n", GetLastError());
+            WaitForSingleObject(g_stopEvent, 1000);
+            continue;
+        }
+
+        if (WaitForClient(pipe, &ov)) {
+            Serve(pipe, &ov, response);
+        }
+        DisconnectNamedPipe(pipe);
+        CloseHandle(pipe);
+    }
+
+    CloseHandle(ov.hEvent);
+    MemTracker_Free(response);
+    return 0;
+}
+
+// ============================================================================
+// Lifecycle
+// ============================================================================
+
+BOOL ControlServer_Start(const char* pipeName, ControlQueue* queue) {
+    if (g_serverThread) return TRUE;
+    if (!pipeName || !pipeName[0] || !queue) return FALSE;
+
+    strncpy(g_pipeName, pipeName, sizeof(g_pipeName) - 1);
+    g_pipeName[sizeof(g_pipeName) - 1] = '\0';
+    g_queue = queue;
+
+    g_stopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!g_stopEvent) return FALSE;
+
+    g_serverThread = CreateThread(NULL, 0, ServerThread, NULL, 0, NULL);
+    if (!g_serverThread) {
+        CloseHandle(g_stopEvent);
+        g_stopEvent = NULL;
+        return FALSE;
+    }
+
+    ControlLog("Control: serving on %s\n", g_pipeName);
+    return TRUE;
+}
+
+BOOL ControlServer_Stop(void) {
+    if (!g_serverThread) return TRUE;
+
+    SetEvent(g_stopEvent);
+    CancelSynchronousIo(g_serverThread);    // A flush waiting on a stuck client
+    if (WaitForSingleObject(g_serverThread, 2000) != WAIT_OBJECT_0) {
+        // It still waits on g_stopEvent and posts to g_queue: leak them
+        ControlLog("Control: server thread did not exit, leaking it\n");
+        return FALSE;
+    }
+    CloseHandle(g_serverThread);
+    CloseHandle(g_stopEvent);
+    g_serverThread = NULL;
+    g_stopEvent = NULL;
+    g_queue = NULL;
+    return TRUE;
+}
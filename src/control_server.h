@@ -0,0 +1,25 @@
+/*
+ * Control Server - Serves the control protocol on a local named pipe
+ *
+ * Off unless started (--headless). A client connects to CONTROL_PIPE_NAME,
+ * writes one request line (control.h), and reads one JSON line until the
+ * server closes its end. The server only parses and queues: a job id comes
+ * back at once and the work runs on the daemon's thread, so a slow save
+ * never holds the pipe. Remote clients are rejected.
+ */
+
+#ifndef CONTROL_SERVER_H
+#define CONTROL_SERVER_H
+
+#include <windows.h>
+#include "control.h"
+
+#define CONTROL_PIPE_NAME           "\\\\.\\pipe\\lwsr-control"
+#define CONTROL_REQUEST_TIMEOUT_MS  1000
+
+BOOL ControlServer_Start(const char* pipeName, ControlQueue* queue);
+// FALSE if the server thread did not exit within 2s: its handles are
+// leaked and the queue must stay alive
+BOOL ControlServer_Stop(void);
+
+#endif // CONTROL_SERVER_H
@@ -0,0 +1,84 @@
+/*
+ * CPU Color Converter Implementation
+ * BGRA → NV12, two rows per pass so each 2x2 block is read once
+ */
+
+#include "cpu_converter.h"
+#include "mem_tracker.h"
+#include <stdlib.h>
+#include <string.h>
+
+// BT.601 limited range, 8-bit fixed point (coefficients scaled by 256)
+#define RGB_TO_Y(r, g, b)  ((( 66 * (r) + 129 * (g) +  25 * (b) + 128) >> 8) + 16)
+#define RGB_TO_U(r, g, b)  (((-38 * (r) -  74 * (g) + 112 * (b) + 128) >> 8) + 128)
+#define RGB_TO_V(r, g, b)  (((112 * (r) -  94 * (g) -  18 * (b) + 128) >> 8) + 128)
+
+void CPUConverter_BGRAToNV12(const BYTE* bgra, int bgraPitch, int width, int height,
+                             BYTE* yPlane, int yPitch, BYTE* uvPlane, int uvPitch) {
+    for (int y = 0; y + 1 < height; y += 2) {
+        const BYTE* row0 = bgra + (size_t)y * bgraPitch;
+        const BYTE* row1 = row0 + bgraPitch;
+        BYTE* y0 = yPlane + (size_t)y * yPitch;
+        BYTE* y1 = y0 + yPitch;
+        BYTE* uv = uvPlane + (size_t)(y / 2) * uvPitch;
+        
+        for (int x = 0; x + 1 < width; x += 2) {
+            const BYTE* p00 = row0 + x * 4;
+            const BYTE* p01 = p00 + 4;
+            const BYTE* p10 = row1 + x * 4;
+            const BYTE* p11 = p10 + 4;
+            
+            y0[x]     = (BYTE)RGB_TO_Y(p00[2], p00[1], p00[0]);
+            y0[x + 1] = (BYTE)RGB_TO_Y(p01[2], p01[1], p01[0]);
+            y1[x]     = (BYTE)RGB_TO_Y(p10[2], p10[1], p10[0]);
+            y1[x + 1] = (BYTE)RGB_TO_Y(p11[2], p11[1], p11[0]);
+            
+            // Chroma from the 2x2 average (rounded)
+            int b = (p00[0] + p01[0] + p10[0] + p11[0] + 2) >> 2;
+            int g = (p00[1] + p01[1] + p10[1] + p11[1] + 2) >> 2;
+            int r = (p00[2] + p01[2] + p10[2] + p11[2] + 2) >> 2;
+            uv[x]     = (BYTE)RGB_TO_U(r, g, b);
+            uv[x + 1] = (BYTE)RGB_TO_V(r, g, b);
+        }
+    }
+}
+
+BOOL CPUConverter_Init(CPUConverter* conv, int width, int height) {
+    if (!conv || width <= 0 || height <= 0 || (width & 1) || (height & 1)) return FALSE;
+    
+    memset(conv, 0, sizeof(CPUConverter));
+    
+    size_t size = (size_t)width * height * 3 / 2;
+    conv->nv12 = (BYTE*)MemTracker_Alloc(MEM_TAG_VIDEO_ENCODER, size);
+    if (!conv->nv12) return FALSE;
+    
+    conv->width = width;
+    conv->height = height;
+    conv->yPitch = width;
+    conv->uvPitch = width;
+    conv->initialized = TRUE;
+    return TRUE;
+}
+
+BYTE* CPUConverter_Convert(CPUConverter* conv, const BYTE* bgra, int bgraPitch) {
+    if (!conv || !conv->initialized || !bgra) return NULL;
+    
+    CPUConverter_BGRAToNV12(bgra, bgraPitch, conv->width, conv->height,
+                            conv->nv12, conv->yPitch,
+                            CPUConverter_GetUVPlane(conv), conv->uvPitch);
+    return conv->nv12;
+}
+
+BYTE* CPUConverter_GetUVPlane(CPUConverter* conv) {
+    if (!conv || !conv->nv12) return NULL;
+    return conv->nv12 + (size_t)conv->yPitch * conv->height;
+}
+
+void CPUConverter_Shutdown(CPUConverter* conv) {
+    if (!conv) return;
+    if (conv->nv12) {
+        MemTracker_Free(conv->nv12);
+        conv->nv12 = NULL;
+    }
+    conv->initialized = FALSE;
+}
@@ -0,0 +1,39 @@
+/*
+ * CPU Color Converter
+ * BGRA → NV12 in system memory, for encoders without a GPU input path
+ * Uses the same BT.601 limited-range matrix as the D3D11 Video Processor default
+ */
+
+#ifndef CPU_CONVERTER_H
+#define CPU_CONVERTER_H
+
+#include "platform.h"
+
+typedef struct {
+    BYTE* nv12;         // Output: Y plane followed by interleaved UV plane
+    int yPitch;         // Bytes per Y row (== width)
+    int uvPitch;        // Bytes per UV row (== width)
+    int width;
+    int height;
+    BOOL initialized;
+} CPUConverter;
+
+// Initialize converter for given frame size (width and height must be even)
+BOOL CPUConverter_Init(CPUConverter* conv, int width, int height);
+
+// Convert a BGRA frame (rows of bgraPitch bytes) to NV12
+// Returns pointer to the Y plane (owned by converter); UV plane follows at
+// CPUConverter_GetUVPlane()
+BYTE* CPUConverter_Convert(CPUConverter* conv, const BYTE* bgra, int bgraPitch);
+
+// Get the UV plane of the last conversion
+BYTE* CPUConverter_GetUVPlane(CPUConverter* conv);
+
+// Stateless conversion into caller-provided planes
+void CPUConverter_BGRAToNV12(const BYTE* bgra, int bgraPitch, int width, int height,
+                             BYTE* yPlane, int yPitch, BYTE* uvPlane, int uvPitch);
+
+// Shutdown and free resources
+void CPUConverter_Shutdown(CPUConverter* conv);
+
+#endif // CPU_CONVERTER_H
@@ -10,6 +10,7 @@
  * - Stack overflows (via guard page and alternate stack)
  * - Heap corruption
  * - Application hangs/deadlocks (via watchdog thread)
+ * - Pipeline threads stuck in a stage past its deadline (via watchdog thread)
  *
  * Best Practices Implemented:
  * 1. Vectored Exception Handler for early catch
@@ -17,6 +18,8 @@
  * 3. Separate stack for stack overflow handling
  * 4. Watchdog thread for hang detection
  * 5. Multiple CRT error handlers
+ * 6. Flight recorder (recent pipeline activity) appended to the crash log
+ * 7. Per-stage stall detection with an optional recovery hook
  */
 
 #define WIN32_LEAN_AND_MEAN
@@ -27,6 +30,8 @@
 #include <signal.h>
 #include <time.h>
 #include "crash_handler.h"
+#include "logger.h"
+#include "flight_recorder.h"
 
 #pragma comment(lib, "dbghelp.lib")
 
@@ -35,7 +40,7 @@
 // ============================================================================
 
 #define WATCHDOG_TIMEOUT_MS     30000   // 30 seconds without heartbeat = hang
-#define WATCHDOG_CHECK_INTERVAL 5000    // Check every 5 seconds
+#define WATCHDOG_CHECK_INTERVAL 1000    // Check every second (stage deadlines are a few seconds)
 #define STACK_OVERFLOW_RESERVE  65536   // 64KB reserved for stack overflow handling
 
 // Heap corruption status code (not always defined)
@@ -56,6 +61,12 @@ static HANDLE g_watchdogThread = NULL;
 static volatile BOOL g_watchdogRunning = FALSE;
 static BOOL g_crashHandlerInitialized = FALSE;
 
+// Stage stall detection (watchdog thread only, except the hook)
+static StallRecoveryFn g_stallRecovery = NULL;
+static void* g_stallRecoveryData = NULL;
+static int64_t g_reportedStall[FLIGHT_RECORDER_THREADS];   // 'since' of the stall last reported per slot
+static char g_stallReason[160];
+
 // Stack overflow handling - reserve memory for guard page restoration
 static LPVOID g_stackOverflowGuard = NULL;
 
@@ -88,6 +99,18 @@ static void GetCrashFilePaths(char* dumpPath, char* logPath, size_t size) {
     snprintf(logPath, size, "%s\\lwsr_crash_%s.txt", exeDir, timestamp);
 }
 
+static void GetStallReportPath(char* reportPath, size_t size) {
+    char exeDir[MAX_PATH];
+    GetExeDirectory(exeDir, sizeof(exeDir));
+    
+    time_t now = time(NULL);
+    struct tm* t = localtime(&now);
+    char timestamp[32];
+    strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", t);
+    
+    snprintf(reportPath, size, "%s\\lwsr_stall_%s.txt", exeDir, timestamp);
+}
+
 static const char* GetExceptionName(DWORD code) {
     switch (code) {
         case EXCEPTION_ACCESS_VIOLATION:         return "ACCESS_VIOLATION";
@@ -211,6 +234,10 @@ static DWORD WINAPI DumpWriterThread(LPVOID param) {
             fprintf(logFile, "No exception context available (hang/abort detected)\n");
         }
         
+        fprintf(logFile, "\n");
+        
+        // What the pipeline was doing (static memory, safe to read here)
+        FlightRecorder_Dump(logFile);
         fprintf(logFile, "\n");
         fprintf(logFile, "Minidump saved to: %s\n", dumpPath);
         fprintf(logFile, "\nPlease report this crash at:\n");
@@ -253,6 +280,10 @@ static void HandleCrash(EXCEPTION_POINTERS* exInfo, const char* reason) {
     // Stop the watchdog immediately
     g_watchdogRunning = FALSE;
     
+    // Get queued log lines onto disk (the writer thread is still running
+    // unless it is the one that crashed)
+    Logger_Flush(500);
+    
     // Create event for synchronization
     g_dumpCompleteEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
     
@@ -424,6 +455,69 @@ static void SignalHandler(int signum) {
 // Watchdog Thread - Detects Hangs/Deadlocks
 // ============================================================================
 
+static void ReportHang(const char* reason) {
+    CONTEXT ctx;
+    RtlCaptureContext(&ctx);
+    
+    EXCEPTION_RECORD rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.ExceptionCode = 0xDEADDEAD;  // Custom code for hang
+    rec.ExceptionFlags = EXCEPTION_NONCONTINUABLE;
+    
+    EXCEPTION_POINTERS ex;
+    ex.ContextRecord = &ctx;
+    ex.ExceptionRecord = &rec;
+    
+    HandleCrash(&ex, reason);
+}
+
+// First sighting of a stall: report it and try the recovery hook
+static void ReportStall(const FlightRecorderStall* stall) {
+    BOOL recovering = FALSE;
+    if (g_stallRecovery) {
+        recovering = g_stallRecovery(stall->name, stall->stage, g_stallRecoveryData);
+    }
+    
+    FlightRecorder_Event(FR_EVENT_STALL, stall->threadId, stall->elapsedMs);
+    LOG_ERROR("WATCHDOG: %s stuck in '%s' for %lldms (deadline %dms)%s\n",
+              stall->name, stall->stage, (long long)stall->elapsedMs, stall->deadlineMs,
+              recovering ? ", recovering" : "");
+    
+    char reportPath[MAX_PATH];
+    GetStallReportPath(reportPath, sizeof(reportPath));
+    FILE* report = fopen(reportPath, "w");
+    if (!report) return;
+    
+    time_t now = time(NULL);
+    fprintf(report, "=== LWSR Stall Report ===\n");
+    fprintf(report, "Time: %s", ctime(&now));
+    fprintf(report, "Thread: %s (ID %u)\n", stall->name, stall->threadId);
+    fprintf(report, "Stage: %s for %lldms (deadline %dms)\n",
+            stall->stage, (long long)stall->elapsedMs, stall->deadlineMs);
+    fprintf(report, "Recovery: %s\n", recovering ? "started" : (g_stallRecovery ? "declined" : "none"));
+    fprintf(report, "\n");
+    FlightRecorder_Dump(report);
+    fclose(report);
+}
+
+static void CheckStalls(void) {
+    FlightRecorderStall stalls[FLIGHT_RECORDER_THREADS];
+    int count = FlightRecorder_GetStalls(stalls, FLIGHT_RECORDER_THREADS);
+    
+    for (int i = 0; i < count; i++) {
+        const FlightRecorderStall* stall = &stalls[i];
+        if (g_reportedStall[stall->slot] != stall->since) {
+            g_reportedStall[stall->slot] = stall->since;
+            ReportStall(stall);
+        } else if (stall->elapsedMs > stall->deadlineMs + WATCHDOG_TIMEOUT_MS) {
+            // Recovery didn't unstick it (or there was none)
+            snprintf(g_stallReason, sizeof(g_stallReason), "STAGE_STALL - %s stuck in '%s' for %llds",
+                     stall->name, stall->stage, (long long)(stall->elapsedMs / 1000));
+            ReportHang(g_stallReason);
+        }
+    }
+}
+
 static DWORD WINAPI WatchdogThread(LPVOID param) {
     (void)param;
     
@@ -435,25 +529,15 @@ static DWORD WINAPI WatchdogThread(LPVOID param) {
         
         if (!g_watchdogRunning) break;
         
+        CheckStalls();
+        
         LONG currentHeartbeat = InterlockedCompareExchange(&g_heartbeatCounter, 0, 0);
         
         if (currentHeartbeat == lastHeartbeat) {
             missedCount++;
             if (missedCount >= (WATCHDOG_TIMEOUT_MS / WATCHDOG_CHECK_INTERVAL)) {
                 // Hang detected!
-                CONTEXT ctx;
-                RtlCaptureContext(&ctx);
-                
-                EXCEPTION_RECORD rec;
-                memset(&rec, 0, sizeof(rec));
-                rec.ExceptionCode = 0xDEADDEAD;  // Custom code for hang
-                rec.ExceptionFlags = EXCEPTION_NONCONTINUABLE;
-                
-                EXCEPTION_POINTERS ex;
-                ex.ContextRecord = &ctx;
-                ex.ExceptionRecord = &rec;
-                
-                HandleCrash(&ex, "HANG_DETECTED - Application not responding");
+                ReportHang("HANG_DETECTED - Application not responding");
             }
         } else {
             lastHeartbeat = currentHeartbeat;
@@ -521,6 +605,11 @@ void CrashHandler_Heartbeat(void) {
     InterlockedIncrement(&g_heartbeatCounter);
 }
 
+void CrashHandler_SetStallRecovery(StallRecoveryFn fn, void* userData) {
+    g_stallRecoveryData = userData;
+    g_stallRecovery = fn;
+}
+
 void CrashHandler_Shutdown(void) {
     if (!g_crashHandlerInitialized) return;
     
@@ -1,6 +1,8 @@
 #ifndef CRASH_HANDLER_H
 #define CRASH_HANDLER_H
 
+#include <windows.h>
+
 /*
  * Comprehensive Crash Handler API
  * 
@@ -21,6 +23,15 @@ void CrashHandler_StartWatchdog(void);
 void CrashHandler_StopWatchdog(void);
 void CrashHandler_Heartbeat(void);
 
+// The watchdog also checks every pipeline thread's flight recorder stage
+// against the deadline it was entered with. A stalled stage gets a report
+// (lwsr_stall_*.txt next to the exe) and one call to the recovery hook;
+// still stuck 30 seconds past its deadline, it is reported as a hang.
+// The hook runs on the watchdog thread and returns TRUE if it started a
+// recovery (e.g. posted a restart to the UI thread).
+typedef BOOL (*StallRecoveryFn)(const char* threadName, const char* stage, void* userData);
+void CrashHandler_SetStallRecovery(StallRecoveryFn fn, void* userData);
+
 // Force crash for testing (triggers access violation)
 void CrashHandler_ForceCrash(void);
 
@@ -0,0 +1,269 @@
+/*
+ * Flight Recorder Implementation
+ * Sequence-stamped event ring, thread slots and gauges in static memory
+ */
+
+#include "flight_recorder.h"
+#include "frame_pacer.h"
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <intrin.h>
+#define FR_TLS __declspec(thread)
+typedef volatile LONG64 FrCounter;
+static uint64_t Counter_Next(FrCounter* c) { return (uint64_t)InterlockedIncrement64(c) - 1; }
+static uint64_t Counter_Load(FrCounter* c) { return (uint64_t)*c; }
+static void Counter_Store(FrCounter* c, uint64_t v) { _ReadWriteBarrier(); *c = (LONG64)v; }
+typedef volatile LONG FrFlag;
+static bool Flag_TryTake(FrFlag* flag) { return InterlockedCompareExchange(flag, 1, 0) == 0; }
+static uint32_t CurrentThreadId(void) { return (uint32_t)GetCurrentThreadId(); }
+#else
+#include <unistd.h>
+#include <sys/syscall.h>
+#define FR_TLS __thread
+typedef volatile uint64_t FrCounter;
+static uint64_t Counter_Next(FrCounter* c) { return __atomic_fetch_add(c, 1, __ATOMIC_RELAXED); }
+static uint64_t Counter_Load(FrCounter* c) { return __atomic_load_n(c, __ATOMIC_ACQUIRE); }
+static void Counter_Store(FrCounter* c, uint64_t v) { __atomic_store_n(c, v, __ATOMIC_RELEASE); }
+typedef volatile int FrFlag;
+static bool Flag_TryTake(FrFlag* flag) {
+    int expected = 0;
+    return __atomic_compare_exchange_n(flag, &expected, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+static uint32_t CurrentThreadId(void) { return (uint32_t)syscall(SYS_gettid); }
+#endif
+
+#define FR_EVENT_MASK   (FLIGHT_RECORDER_EVENTS - 1)
+#define FR_NAME_SIZE    FLIGHT_RECORDER_NAME_SIZE
+#define FR_NO_THREAD    0xFFFF
+
+typedef struct {
+    FrCounter sequence;             // Index + 1 once written, 0 while writing
+    int64_t time;
+    int64_t a;
+    int64_t b;
+    uint16_t thread;                // Slot in g_threads
+    uint16_t event;
+} FrEventRecord;
+
+// Written since -> deadline -> stage and read in the opposite order, so a
+// reader that sees an old 'since' also sees the stage that went with it
+typedef struct {
+    FrFlag inUse;
+    uint32_t threadId;
+    char name[FR_NAME_SIZE];
+    const char* volatile stage;
+    volatile int32_t deadlineMs;
+    volatile int64_t since;
+} FrThread;
+
+typedef struct {
+    volatile int64_t value;
+    volatile int64_t peak;
+} FrGauge;
+
+static FrEventRecord g_events[FLIGHT_RECORDER_EVENTS];
+static FrCounter g_eventHead;
+static FrThread g_threads[FLIGHT_RECORDER_THREADS];
+static FrGauge g_gauges[FR_GAUGE_COUNT];
+
+static FR_TLS int t_slot = -1;
+
+typedef struct {
+    const char* name;
+    const char* aLabel;             // NULL: not shown
+    const char* bLabel;
+    bool aIsTime;                   // a is a 100-ns timestamp
+} FrEventInfo;
+
+static const FrEventInfo g_eventInfo[FR_EVENT_COUNT] = {
+    { "submit",      "ts",      NULL,       true  },
+    { "drain",       "ts",      "bytes",    true  },
+    { "drop",        "ts",      "reason",   true  },
+    { "save begin",  "video",   "audio",    false },
+    { "save end",    "ok",      "ms",       false },
+    { "reconfigure", "qp",      "keyframeMs", false },
+    { "audio read",  "ts",      "bytes",    true  },
+    { "error",       "code",    "detail",   false },
+    { "stall",       "tid",     "ms",       false },
+};
+
+static const char* g_gaugeNames[FR_GAUGE_COUNT] = {
+    "replay enc queue", "record enc queue", "video samples", "audio samples", "audio buffered"
+};
+
+// ============================================================================
+// Threads
+// ============================================================================
+
+static int TakeSlot(const char* name) {
+    for (int i = 0; i < FLIGHT_RECORDER_THREADS; i++) {
+        if (Flag_TryTake(&g_threads[i].inUse)) {
+            FrThread* t = &g_threads[i];
+            t->threadId = CurrentThreadId();
+            if (name) {
+                strncpy(t->name, name, FR_NAME_SIZE - 1);
+                t->name[FR_NAME_SIZE - 1] = '\0';
+            } else {
+                t->name[0] = '\0';
+            }
+            t->stage = NULL;
+            t->deadlineMs = FR_NO_DEADLINE;
+            t->since = FramePacer_Now();
+            return i;
+        }
+    }
+    return -1;
+}
+
+void FlightRecorder_RegisterThread(const char* name) {
+    if (t_slot >= 0) {
+        strncpy(g_threads[t_slot].name, name ? name : "", FR_NAME_SIZE - 1);
+        return;
+    }
+    t_slot = TakeSlot(name);
+}
+
+void FlightRecorder_ReleaseThread(void) {
+    if (t_slot < 0) return;
+    FrThread* t = &g_threads[t_slot];
+    t->stage = NULL;
+    t->inUse = 0;
+    t_slot = -1;
+}
+
+void FlightRecorder_SetStage(const char* stage, int deadlineMs) {
+    if (t_slot < 0) {
+        t_slot = TakeSlot(NULL);
+        if (t_slot < 0) return;
+    }
+    FrThread* t = &g_threads[t_slot];
+    t->since = FramePacer_Now();
+    t->deadlineMs = deadlineMs;
+    t->stage = stage;
+}
+
+int FlightRecorder_GetStalls(FlightRecorderStall* stalls, int maxStalls) {
+    if (!stalls || maxStalls <= 0) return 0;
+    int64_t now = FramePacer_Now();
+    int count = 0;
+
+    for (int i = 0; i < FLIGHT_RECORDER_THREADS && count < maxStalls; i++) {
+        const FrThread* t = &g_threads[i];
+        if (!t->inUse) continue;
+        const char* stage = t->stage;
+        int deadlineMs = t->deadlineMs;
+        int64_t since = t->since;
+        if (!stage || deadlineMs <= 0) continue;
+
+        int64_t elapsedMs = (now - since) / (FRAME_PACER_UNITS_PER_SECOND / 1000);
+        if (elapsedMs <= deadlineMs) continue;
+
+        FlightRecorderStall* s = &stalls[count++];
+        s->slot = i;
+        s->threadId = t->threadId;
+        memcpy(s->name, t->name, FR_NAME_SIZE);
+        s->name[FR_NAME_SIZE - 1] = '\0';
+        if (!s->name[0]) snprintf(s->name, FR_NAME_SIZE, "thread %u", t->threadId);
+        s->stage = stage;
+        s->since = since;
+        s->elapsedMs = elapsedMs;
+        s->deadlineMs = deadlineMs;
+    }
+    return count;
+}
+
+// ============================================================================
+// Events and gauges
+// ============================================================================
+
+void FlightRecorder_Event(FlightRecorderEvent event, int64_t a, int64_t b) {
+    if (event < 0 || event >= FR_EVENT_COUNT) return;
+
+    uint64_t index = Counter_Next(&g_eventHead);
+    FrEventRecord* e = &g_events[index & FR_EVENT_MASK];
+    Counter_Store(&e->sequence, 0);
+    e->time = FramePacer_Now();
+    e->a = a;
+    e->b = b;
+    e->thread = (uint16_t)(t_slot >= 0 ? t_slot : FR_NO_THREAD);
+    e->event = (uint16_t)event;
+    Counter_Store(&e->sequence, index + 1);
+}
+
+void FlightRecorder_SetGauge(FlightRecorderGauge gauge, int64_t value) {
+    if (gauge < 0 || gauge >= FR_GAUGE_COUNT) return;
+    FrGauge* g = &g_gauges[gauge];
+    g->value = value;
+    if (value > g->peak) g->peak = value;   // Racy max is fine for diagnostics
+}
+
+// ============================================================================
+// Dump
+// ============================================================================
+
+static const char* ThreadName(int slot, char* buffer, size_t size) {
+    if (slot < 0 || slot >= FLIGHT_RECORDER_THREADS) return "?";
+    const FrThread* t = &g_threads[slot];
+    if (t->name[0]) return t->name;
+    snprintf(buffer, size, "thread %u", t->threadId);
+    return buffer;
+}
+
+void FlightRecorder_Dump(FILE* file) {
+    if (!file) return;
+    int64_t now = FramePacer_Now();
+    char nameBuf[FR_NAME_SIZE];
+
+    fprintf(file, "=== Flight Recorder ===\n");
+
+    fprintf(file, "Threads:\n");
+    for (int i = 0; i < FLIGHT_RECORDER_THREADS; i++) {
+        const FrThread* t = &g_threads[i];
+        if (!t->inUse) continue;
+        const char* stage = t->stage;
+        int deadlineMs = t->deadlineMs;
+        double elapsed = (double)(now - t->since) / FRAME_PACER_UNITS_PER_SECOND;
+        fprintf(file, "  %-16s [tid %5u] %-14s for %.3fs", ThreadName(i, nameBuf, sizeof(nameBuf)),
+                t->threadId, stage ? stage : "(no stage)", elapsed);
+        if (stage && deadlineMs > 0) {
+            fprintf(file, " (deadline %.1fs)%s", deadlineMs / 1000.0,
+                    elapsed * 1000.0 > deadlineMs ? " STALLED" : "");
+        }
+        fprintf(file, "\n");
+    }
+
+    fprintf(file, "Gauges:                  current      peak\n");
+    for (int i = 0; i < FR_GAUGE_COUNT; i++) {
+        fprintf(file, "  %-20s %10lld %9lld\n", g_gaugeNames[i],
+                (long long)g_gauges[i].value, (long long)g_gauges[i].peak);
+    }
+
+    uint64_t head = Counter_Load(&g_eventHead);
+    uint64_t first = head > FLIGHT_RECORDER_EVENTS ? head - FLIGHT_RECORDER_EVENTS : 0;
+    fprintf(file, "Events (%llu recorded, last %llu, times relative to now):\n",
+            (unsigned long long)head, (unsigned long long)(head - first));
+
+    for (uint64_t i = first; i < head; i++) {
+        FrEventRecord* slot = &g_events[i & FR_EVENT_MASK];
+        if (Counter_Load(&slot->sequence) != i + 1) continue;
+        FrEventRecord e = *slot;
+        if (Counter_Load(&slot->sequence) != i + 1) continue;   // Overwritten meanwhile
+        if (e.event >= FR_EVENT_COUNT) continue;
+
+        const FrEventInfo* info = &g_eventInfo[e.event];
+        const char* thread = e.thread == FR_NO_THREAD ? "-" : ThreadName(e.thread, nameBuf, sizeof(nameBuf));
+        fprintf(file, "  %+9.3fs %-16s %-12s", (double)(e.time - now) / FRAME_PACER_UNITS_PER_SECOND,
+                thread, info->name);
+        if (info->aLabel) {
+            if (info->aIsTime) {
+                fprintf(file, " %s=%.3fs", info->aLabel, (double)e.a / FRAME_PACER_UNITS_PER_SECOND);
+            } else {
+                fprintf(file, " %s=%lld", info->aLabel, (long long)e.a);
+            }
+        }
+        if (info->bLabel) fprintf(file, " %s=%lld", info->bLabel, (long long)e.b);
+        fprintf(file, "\n");
+    }
+}
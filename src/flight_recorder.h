@@ -0,0 +1,88 @@
+/*
+ * Flight Recorder - Always-on record of recent pipeline activity
+ * Portable C; static memory only, lock-free, safe to read from a crash handler
+ *
+ * Three things are kept, all overwritten in place:
+ * - Per thread: name and the stage it is in now (since when, and how long
+ *   it may take before the watchdog reports the thread stalled)
+ * - Gauges: current and peak queue depths (encoder queues, buffered samples, ...)
+ * - Events: a ring of the last FLIGHT_RECORDER_EVENTS submits, drains,
+ *   drops, saves and errors from every thread
+ *
+ * Recording is an atomic increment, a clock read and a few stores, so it
+ * stays on in release builds. FlightRecorder_Dump serializes everything as
+ * text; the crash handler appends it to the crash log so a crash or hang
+ * report says what the pipeline was doing in its last seconds.
+ */
+
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FLIGHT_RECORDER_EVENTS      2048    // Power of two; ~15s of a 60 fps pipeline
+#define FLIGHT_RECORDER_THREADS     32
+#define FLIGHT_RECORDER_NAME_SIZE   24
+
+// Stage deadlines for FlightRecorder_SetStage
+#define FR_NO_DEADLINE              0       // Idle waits: may last indefinitely
+#define FR_STAGE_DEADLINE_MS        2000    // One frame or chunk of work
+
+typedef enum {
+    FR_EVENT_SUBMIT = 0,        // a = frame timestamp
+    FR_EVENT_DRAIN,             // a = frame timestamp, b = bytes
+    FR_EVENT_DROP,              // a = frame timestamp, b = drop reason
+    FR_EVENT_SAVE_BEGIN,        // a = video samples, b = audio samples
+    FR_EVENT_SAVE_END,          // a = success, b = duration (ms)
+    FR_EVENT_RECONFIGURE,       // a = QP, b = keyframe interval (ms)
+    FR_EVENT_AUDIO_READ,        // a = chunk timestamp, b = bytes
+    FR_EVENT_ERROR,             // a = error code, b = detail
+    FR_EVENT_STALL,             // a = thread id, b = time in stage (ms)
+    FR_EVENT_COUNT
+} FlightRecorderEvent;
+
+typedef enum {
+    FR_GAUGE_REPLAY_ENCODER_QUEUE = 0,  // Replay encoder: frames submitted, not yet returned
+    FR_GAUGE_RECORD_ENCODER_QUEUE,      // Recording encoder: same
+    FR_GAUGE_VIDEO_SAMPLES,     // Replay ring
+    FR_GAUGE_AUDIO_SAMPLES,     // Replay AAC store
+    FR_GAUGE_AUDIO_BUFFERED,    // Mixed PCM waiting to be read (bytes)
+    FR_GAUGE_COUNT
+} FlightRecorderGauge;
+
+// Name the calling thread (copied). Threads that record without registering
+// show up by thread id.
+void FlightRecorder_RegisterThread(const char* name);
+
+// Calling thread is exiting: free its slot
+void FlightRecorder_ReleaseThread(void);
+
+// Stage the calling thread is entering (a string literal). Entering a stage
+// is the thread's heartbeat: if it is still in the stage deadlineMs later
+// it is reported stalled (FR_NO_DEADLINE: never).
+void FlightRecorder_SetStage(const char* stage, int deadlineMs);
+
+void FlightRecorder_Event(FlightRecorderEvent event, int64_t a, int64_t b);
+
+void FlightRecorder_SetGauge(FlightRecorderGauge gauge, int64_t value);
+
+typedef struct {
+    int slot;                   // Thread slot (stable until it is released)
+    uint32_t threadId;
+    char name[FLIGHT_RECORDER_NAME_SIZE];
+    const char* stage;
+    int64_t since;              // FramePacer_Now() when the stage was entered
+    int64_t elapsedMs;
+    int deadlineMs;
+} FlightRecorderStall;
+
+// Threads past their stage deadline. Returns how many were written.
+int FlightRecorder_GetStalls(FlightRecorderStall* stalls, int maxStalls);
+
+// Write threads, gauges and events (oldest first) as text. Doesn't lock or
+// allocate; events being written during the dump are skipped.
+void FlightRecorder_Dump(FILE* file);
+
+#endif // FLIGHT_RECORDER_H
@@ -0,0 +1,561 @@
+/*
+ * Frame Hub Implementation
+ * Producer thread, refcounted frame pool and per-consumer mailboxes
+ *
+ * Locking: one mutex guards consumers, mailboxes and refcounts. The source
+ * grab runs outside it (the slot being filled is reserved by its refcount),
+ * so consumers acquiring/releasing never wait on a capture. A separate
+ * control mutex serializes add/remove so producer start/stop can't race.
+ */
+
+#include "frame_hub.h"
+#include "frame_pacer.h"
+#include "trace.h"
+#include "flight_recorder.h"
+#include "thread_registry.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#include <errno.h>
+#endif
+
+#define FRAME_HUB_MAX_SLOTS (FRAME_HUB_MAX_CONSUMERS * (FRAME_HUB_MAX_DEPTH + 1) + 2)
+
+// ============================================================================
+// Platform
+// ============================================================================
+
+#ifdef _WIN32
+typedef CRITICAL_SECTION HubMutex;
+typedef CONDITION_VARIABLE HubCond;
+typedef HANDLE HubThread;
+
+static void Mutex_Init(HubMutex* m) { InitializeCriticalSection(m); }
+static void Mutex_Destroy(HubMutex* m) { DeleteCriticalSection(m); }
+static void Mutex_Lock(HubMutex* m) { EnterCriticalSection(m); }
+static void Mutex_Unlock(HubMutex* m) { LeaveCriticalSection(m); }
+static void Cond_Init(HubCond* c) { InitializeConditionVariable(c); }
+static void Cond_Destroy(HubCond* c) { (void)c; }
+static void Cond_Signal(HubCond* c) { WakeAllConditionVariable(c); }   // All waiters, as pthread
+
+// Returns false on timeout (timeoutMs < 0 waits forever)
+static bool Cond_Wait(HubCond* c, HubMutex* m, int timeoutMs) {
+    return SleepConditionVariableCS(c, m, timeoutMs < 0 ? INFINITE : (DWORD)timeoutMs) != 0;
+}
+
+#else
+typedef pthread_mutex_t HubMutex;
+typedef pthread_cond_t HubCond;
+typedef pthread_t HubThread;
+
+static void Mutex_Init(HubMutex* m) { pthread_mutex_init(m, NULL); }
+static void Mutex_Destroy(HubMutex* m) { pthread_mutex_destroy(m); }
+static void Mutex_Lock(HubMutex* m) { pthread_mutex_lock(m); }
+static void Mutex_Unlock(HubMutex* m) { pthread_mutex_unlock(m); }
+
+static void Cond_Init(HubCond* c) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(c, &attr);
+    pthread_condattr_destroy(&attr);
+}
+static void Cond_Destroy(HubCond* c) { pthread_cond_destroy(c); }
+static void Cond_Signal(HubCond* c) { pthread_cond_broadcast(c); }
+
+static bool Cond_Wait(HubCond* c, HubMutex* m, int timeoutMs) {
+    if (timeoutMs < 0) {
+        pthread_cond_wait(c, m);
+        return true;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += timeoutMs / 1000;
+    ts.tv_nsec += (long)(timeoutMs % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return pthread_cond_timedwait(c, m, &ts) != ETIMEDOUT;
+}
+#endif
+
+int64_t FrameHub_Now(void) {
+    return FramePacer_Now();
+}
+
+// ============================================================================
+// Types
+// ============================================================================
+
+struct HubConsumer {
+    bool active;
+    HubConsumerConfig config;
+    HubRect crop;
+
+    // Decimation schedule (hub units)
+    int64_t interval;
+    int64_t nextDue;
+
+    // Mailbox (ring)
+    HubDelivery queue[FRAME_HUB_MAX_DEPTH];
+    int head;
+    int count;
+    int depth;
+    HubCond cond;
+
+    uint64_t lastSequence;  // Sequence of the last frame handed out by Acquire
+    HubConsumerStats stats;
+};
+
+struct FrameHub {
+    FrameHubSource source;
+
+    HubMutex lock;          // Consumers, mailboxes, refcounts
+    HubMutex controlLock;   // Serializes add/remove (producer start/stop)
+    FramePacer* pacer;      // Producer tick timer
+
+    HubConsumer consumers[FRAME_HUB_MAX_CONSUMERS];
+    int consumerCount;
+
+    HubFrame slots[FRAME_HUB_MAX_SLOTS];
+    int slotCount;
+    HubFrame* latest;       // Most recent content (hub holds one reference)
+    uint64_t sequence;
+
+    HubRect region;
+    int64_t tickInterval;
+    bool rateChanged;       // tickInterval changed; producer re-times its pacer
+
+    HubThread thread;
+    bool threadRunning;
+    bool stopRequested;
+
+    HubStats stats;
+};
+
+// ============================================================================
+// Internal (hub->lock held)
+// ============================================================================
+
+static void ReleaseLocked(HubFrame* frame) {
+    if (frame && frame->refCount > 0) frame->refCount--;
+}
+
+static int PoolLimit(FrameHub* hub) {
+    int limit = 2;  // Latest + the one being grabbed
+    for (int i = 0; i < FRAME_HUB_MAX_CONSUMERS; i++) {
+        if (hub->consumers[i].active) limit += hub->consumers[i].depth + 1;
+    }
+    return limit;
+}
+
+static void UpdateTickInterval(FrameHub* hub) {
+    int64_t interval = 0;
+    for (int i = 0; i < FRAME_HUB_MAX_CONSUMERS; i++) {
+        HubConsumer* c = &hub->consumers[i];
+        if (c->active && (interval == 0 || c->interval < interval)) interval = c->interval;
+    }
+    if (interval != hub->tickInterval) {
+        hub->tickInterval = interval;
+        hub->rateChanged = true;
+    }
+}
+
+static void Deliver(FrameHub* hub, HubConsumer* c, int64_t tickTime) {
+    if (c->count == c->depth) {
+        // Fell behind: drop the oldest so the newest is always available
+        ReleaseLocked(c->queue[c->head].frame);
+        c->head = (c->head + 1) % c->depth;
+        c->count--;
+        c->stats.dropped++;
+    }
+
+    HubDelivery* d = &c->queue[(c->head + c->count) % c->depth];
+    d->frame = hub->latest;
+    d->tickTime = tickTime;
+    d->changed = false;     // Decided at acquire time
+    hub->latest->refCount++;
+    c->count++;
+    c->stats.delivered++;
+    Cond_Signal(&c->cond);
+}
+
+// Find a free pool slot (refCount 0), or index of a slot to create (-1 if full)
+static int FindFreeSlot(FrameHub* hub, bool* create) {
+    *create = false;
+    for (int i = 0; i < hub->slotCount; i++) {
+        if (hub->slots[i].refCount == 0) return i;
+    }
+    if (hub->slotCount < PoolLimit(hub) && hub->slotCount < FRAME_HUB_MAX_SLOTS) {
+        *create = true;
+        return hub->slotCount;
+    }
+    return -1;
+}
+
+// ============================================================================
+// Producer
+// ============================================================================
+
+static void ProducerTick(FrameHub* hub, int64_t tickTime) {
+    bool create = false;
+    int slot = FindFreeSlot(hub, &create);
+    if (slot < 0) {
+        // Can't happen with the pool sizing above; treat as an empty tick
+        hub->stats.grabsNone++;
+        return;
+    }
+
+    HubFrame* frame = &hub->slots[slot];
+    frame->refCount = 1;    // Reserve while grabbing
+    if (create) {
+        frame->slot = slot;
+        frame->payload = NULL;
+        hub->slotCount++;
+    }
+
+    Mutex_Unlock(&hub->lock);
+    if (!frame->payload) {
+        frame->payload = hub->source.createPayload ? hub->source.createPayload(hub->source.userData) : NULL;
+    }
+    HubGrabResult result = HUB_GRAB_NONE;
+    if (frame->payload || !hub->source.createPayload) {
+        TRACE_BEGIN(TRACE_GRAB, hub->sequence + 1);
+        result = hub->source.grab(hub->source.userData, frame->payload);
+        TRACE_END(TRACE_GRAB, hub->sequence + 1);
+    }
+    Mutex_Lock(&hub->lock);
+
+    if (result == HUB_GRAB_NEW) {
+        frame->width = hub->region.width;
+        frame->height = hub->region.height;
+        frame->sequence = ++hub->sequence;
+        frame->grabTime = tickTime;
+        ReleaseLocked(hub->latest);
+        hub->latest = frame;    // Keeps the reservation reference
+        hub->stats.grabsNew++;
+    } else {
+        frame->refCount = 0;
+        if (result == HUB_GRAB_SAME && hub->latest) {
+            hub->stats.grabsSame++;
+        } else {
+            hub->stats.grabsNone++;
+            return;
+        }
+    }
+
+    // Fan out to consumers that are due. Half a tick of tolerance so hub
+    // jitter doesn't push a consumer's frame onto the following tick.
+    int64_t tolerance = hub->tickInterval / 2;
+    for (int i = 0; i < FRAME_HUB_MAX_CONSUMERS; i++) {
+        HubConsumer* c = &hub->consumers[i];
+        if (!c->active || tickTime + tolerance < c->nextDue) continue;
+
+        c->nextDue += c->interval;
+        if (tickTime - c->nextDue > c->interval) {
+            c->nextDue = tickTime + c->interval;    // Way behind: resync, no burst
+        }
+        Deliver(hub, c, tickTime);
+    }
+}
+
+#ifdef _WIN32
+static unsigned __stdcall ProducerThread(void* param) {
+#else
+static void* ProducerThread(void* param) {
+#endif
+    FrameHub* hub = (FrameHub*)param;
+    Trace_SetThreadName("Frame hub");
+    FlightRecorder_RegisterThread("Frame hub");
+    ThreadRegistry_Register("Frame hub", THREAD_ROLE_CAPTURE);
+
+    // Ticks come from the pacer's drift-free grid; missed ticks are skipped
+    Mutex_Lock(&hub->lock);
+    FramePacer_Reset(hub->pacer, 0);
+    hub->rateChanged = true;
+
+    while (!hub->stopRequested) {
+        if (hub->rateChanged) {
+            FramePacer_SetRate(hub->pacer, (int)FRAME_HUB_UNITS_PER_SECOND, (int)hub->tickInterval);
+            hub->rateChanged = false;
+        }
+
+        Mutex_Unlock(&hub->lock);
+        FlightRecorder_SetStage("wait", FR_NO_DEADLINE);
+        bool due = FramePacer_Wait(hub->pacer, NULL);
+        FlightRecorder_SetStage("grab", FR_STAGE_DEADLINE_MS);
+        Mutex_Lock(&hub->lock);
+        if (!due) continue;     // Interrupted: stop request or rate change
+
+        hub->stats.ticks++;
+        ProducerTick(hub, FrameHub_Now());
+    }
+
+    Mutex_Unlock(&hub->lock);
+    Trace_ReleaseThread();
+    FlightRecorder_ReleaseThread();
+    ThreadRegistry_Unregister();
+    return 0;
+}
+
+static bool StartProducer(FrameHub* hub) {
+    hub->stopRequested = false;
+#ifdef _WIN32
+    hub->thread = (HANDLE)_beginthreadex(NULL, 0, ProducerThread, hub, 0, NULL);
+    hub->threadRunning = hub->thread != NULL;
+#else
+    hub->threadRunning = pthread_create(&hub->thread, NULL, ProducerThread, hub) == 0;
+#endif
+    return hub->threadRunning;
+}
+
+static void StopProducer(FrameHub* hub) {
+    if (!hub->threadRunning) return;
+    Mutex_Lock(&hub->lock);
+    hub->stopRequested = true;
+    FramePacer_Interrupt(hub->pacer);
+    Mutex_Unlock(&hub->lock);
+#ifdef _WIN32
+    WaitForSingleObject(hub->thread, INFINITE);
+    CloseHandle(hub->thread);
+#else
+    pthread_join(hub->thread, NULL);
+#endif
+    hub->threadRunning = false;
+}
+
+// Free pool payloads (producer stopped, no consumers)
+static void FreePool(FrameHub* hub) {
+    for (int i = 0; i < hub->slotCount; i++) {
+        if (hub->slots[i].payload && hub->source.destroyPayload) {
+            hub->source.destroyPayload(hub->source.userData, hub->slots[i].payload);
+        }
+    }
+    memset(hub->slots, 0, sizeof(hub->slots));
+    hub->slotCount = 0;
+    hub->latest = NULL;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+FrameHub* FrameHub_Create(const FrameHubSource* source) {
+    if (!source || !source->grab) return NULL;
+
+    FrameHub* hub = (FrameHub*)calloc(1, sizeof(FrameHub));
+    if (!hub) return NULL;
+
+    hub->source = *source;
+    hub->pacer = FramePacer_Create(60, 1);
+    if (!hub->pacer) {
+        free(hub);
+        return NULL;
+    }
+    Mutex_Init(&hub->lock);
+    Mutex_Init(&hub->controlLock);
+    for (int i = 0; i < FRAME_HUB_MAX_CONSUMERS; i++) {
+        Cond_Init(&hub->consumers[i].cond);
+    }
+    return hub;
+}
+
+void FrameHub_Destroy(FrameHub* hub) {
+    if (!hub) return;
+
+    StopProducer(hub);
+    FreePool(hub);
+    for (int i = 0; i < FRAME_HUB_MAX_CONSUMERS; i++) {
+        Cond_Destroy(&hub->consumers[i].cond);
+    }
+    FramePacer_Destroy(hub->pacer);
+    Mutex_Destroy(&hub->controlLock);
+    Mutex_Destroy(&hub->lock);
+    free(hub);
+}
+
+HubConsumer* FrameHub_AddConsumer(FrameHub* hub, const HubConsumerConfig* config) {
+    if (!hub || !config || config->fps <= 0) return NULL;
+
+    Mutex_Lock(&hub->controlLock);
+
+    HubRect crop = {0};
+    bool first = hub->consumerCount == 0;
+    if (first) {
+        // First consumer picks the region
+        HubRect actual = config->region;
+        if (hub->source.setRegion && !hub->source.setRegion(hub->source.userData, &config->region, &actual)) {
+            Mutex_Unlock(&hub->controlLock);
+            return NULL;
+        }
+        hub->region = actual;
+        hub->sequence = 0;
+        memset(&hub->stats, 0, sizeof(hub->stats));
+        FramePacer_ResetStats(hub->pacer);
+    }
+
+    if (config->region.width <= 0 || config->region.height <= 0 || first) {
+        crop.width = hub->region.width;
+        crop.height = hub->region.height;
+    } else {
+        // Must lie inside the captured region
+        crop.x = config->region.x - hub->region.x;
+        crop.y = config->region.y - hub->region.y;
+        crop.width = config->region.width & ~1;
+        crop.height = config->region.height & ~1;
+        if (crop.x < 0 || crop.y < 0 ||
+            crop.x + crop.width > hub->region.width || crop.y + crop.height > hub->region.height) {
+            Mutex_Unlock(&hub->controlLock);
+            return NULL;
+        }
+    }
+
+    Mutex_Lock(&hub->lock);
+    HubConsumer* consumer = NULL;
+    for (int i = 0; i < FRAME_HUB_MAX_CONSUMERS; i++) {
+        if (!hub->consumers[i].active) {
+            consumer = &hub->consumers[i];
+            break;
+        }
+    }
+    if (consumer) {
+        int depth = config->queueDepth > 0 ? config->queueDepth : FRAME_HUB_DEFAULT_DEPTH;
+        if (depth > FRAME_HUB_MAX_DEPTH) depth = FRAME_HUB_MAX_DEPTH;
+
+        consumer->active = true;
+        consumer->config = *config;
+        consumer->crop = crop;
+        consumer->interval = FRAME_HUB_UNITS_PER_SECOND / config->fps;
+        consumer->nextDue = FrameHub_Now();
+        consumer->head = 0;
+        consumer->count = 0;
+        consumer->depth = depth;
+        consumer->lastSequence = 0;
+        memset(&consumer->stats, 0, sizeof(consumer->stats));
+        hub->consumerCount++;
+        UpdateTickInterval(hub);
+        if (hub->rateChanged) FramePacer_Interrupt(hub->pacer);    // Tick rate went up
+    }
+    Mutex_Unlock(&hub->lock);
+
+    if (consumer && !hub->threadRunning && !StartProducer(hub)) {
+        Mutex_Lock(&hub->lock);
+        consumer->active = false;
+        hub->consumerCount--;
+        Mutex_Unlock(&hub->lock);
+        consumer = NULL;
+    }
+
+    Mutex_Unlock(&hub->controlLock);
+    return consumer;
+}
+
+void FrameHub_RemoveConsumer(FrameHub* hub, HubConsumer* consumer) {
+    if (!hub || !consumer) return;
+
+    Mutex_Lock(&hub->controlLock);
+    Mutex_Lock(&hub->lock);
+    if (consumer->active) {
+        while (consumer->count > 0) {
+            ReleaseLocked(consumer->queue[consumer->head].frame);
+            consumer->head = (consumer->head + 1) % consumer->depth;
+            consumer->count--;
+        }
+        consumer->active = false;
+        hub->consumerCount--;
+        UpdateTickInterval(hub);
+
+        // A thread blocked in Acquire on this consumer returns empty-handed
+        Cond_Signal(&consumer->cond);
+    }
+    bool last = hub->consumerCount == 0;
+    Mutex_Unlock(&hub->lock);
+
+    if (last) {
+        StopProducer(hub);
+        FreePool(hub);
+    }
+    Mutex_Unlock(&hub->controlLock);
+}
+
+bool FrameHub_Acquire(FrameHub* hub, HubConsumer* consumer, int timeoutMs, HubDelivery* out) {
+    if (!hub || !consumer || !out) return false;
+
+    Mutex_Lock(&hub->lock);
+    if (consumer->count == 0 && timeoutMs != 0) {
+        int64_t deadline = FrameHub_Now() + (int64_t)timeoutMs * 10000;
+        while (consumer->count == 0 && consumer->active) {
+            int waitMs = -1;
+            if (timeoutMs > 0) {
+                int64_t remaining = deadline - FrameHub_Now();
+                if (remaining <= 0) break;
+                waitMs = (int)((remaining + 9999) / 10000);
+            }
+            Cond_Wait(&consumer->cond, &hub->lock, waitMs);
+        }
+    }
+
+    bool ok = consumer->count > 0;
+    if (ok) {
+        *out = consumer->queue[consumer->head];
+        consumer->head = (consumer->head + 1) % consumer->depth;
+        consumer->count--;
+        out->changed = out->frame->sequence != consumer->lastSequence;
+        consumer->lastSequence = out->frame->sequence;
+        consumer->stats.consumed++;
+    }
+    Mutex_Unlock(&hub->lock);
+    return ok;
+}
+
+void FrameHub_Release(FrameHub* hub, HubFrame* frame) {
+    if (!hub || !frame) return;
+    Mutex_Lock(&hub->lock);
+    ReleaseLocked(frame);
+    Mutex_Unlock(&hub->lock);
+}
+
+HubRect FrameHub_GetCrop(HubConsumer* consumer) {
+    HubRect empty = {0};
+    return consumer ? consumer->crop : empty;
+}
+
+HubRect FrameHub_GetRegion(FrameHub* hub) {
+    HubRect empty = {0};
+    return hub ? hub->region : empty;
+}
+
+int FrameHub_GetConsumerCount(FrameHub* hub) {
+    if (!hub) return 0;
+    Mutex_Lock(&hub->lock);
+    int count = hub->consumerCount;
+    Mutex_Unlock(&hub->lock);
+    return count;
+}
+
+void FrameHub_GetConsumerStats(FrameHub* hub, HubConsumer* consumer, HubConsumerStats* stats) {
+    if (!hub || !consumer || !stats) return;
+    Mutex_Lock(&hub->lock);
+    *stats = consumer->stats;
+    Mutex_Unlock(&hub->lock);
+}
+
+void FrameHub_GetStats(FrameHub* hub, HubStats* stats) {
+    if (!hub || !stats) return;
+    Mutex_Lock(&hub->lock);
+    *stats = hub->stats;
+    stats->poolSlots = hub->slotCount;
+    Mutex_Unlock(&hub->lock);
+}
+
+void FrameHub_GetPacerStats(FrameHub* hub, FramePacerStats* stats) {
+    if (!hub || !stats) return;
+    FramePacer_GetStats(hub->pacer, stats);
+}
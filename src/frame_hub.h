@@ -0,0 +1,152 @@
+/*
+ * Frame Hub - Capture once, fan out to many consumers
+ * Portable C (Win32 or pthreads); the frame source is pluggable
+ *
+ * One producer thread grabs frames from a FrameHubSource at the highest
+ * rate any consumer asked for and hands each consumer a reference to the
+ * same pooled frame:
+ * - Per-consumer decimation: a 30 fps consumer on a 60 fps hub gets every
+ *   other tick, on a drift-free schedule
+ * - Refcounted frames: a pool slot is reused only after every consumer
+ *   released it. Ticks with no new content re-deliver the latest frame
+ *   without copying
+ * - Bounded mailboxes: a consumer that falls behind loses its oldest queued
+ *   frame (counted as a drop); the producer and other consumers never wait
+ *
+ * Producer ticks are paced by a FramePacer (kernel timer, no polling).
+ *
+ * The pool never runs dry: it is sized to (queueDepth + 1) per consumer plus
+ * the latest frame and the one being grabbed.
+ */
+
+#ifndef FRAME_HUB_H
+#define FRAME_HUB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "frame_pacer.h"
+
+#define FRAME_HUB_MAX_CONSUMERS     8
+#define FRAME_HUB_DEFAULT_DEPTH     2
+#define FRAME_HUB_MAX_DEPTH         8
+
+// Hub timebase: 100-ns units, monotonic (the frame pacer's clock)
+#define FRAME_HUB_UNITS_PER_SECOND  FRAME_PACER_UNITS_PER_SECOND
+
+// Rectangle in source coordinates
+typedef struct {
+    int x;
+    int y;
+    int width;
+    int height;
+} HubRect;
+
+typedef enum {
+    HUB_GRAB_NONE = 0,      // No frame available (nothing delivered this tick)
+    HUB_GRAB_SAME,          // Content unchanged since the last HUB_GRAB_NEW
+    HUB_GRAB_NEW            // New content written into the payload
+} HubGrabResult;
+
+// Frame source. All callbacks run on the hub's producer thread, except
+// setRegion which runs on the thread adding the first consumer.
+typedef struct {
+    void* userData;
+
+    // Select the capture region. Returns false if it can't be captured;
+    // otherwise writes the region actually captured (may be clamped/aligned).
+    bool (*setRegion)(void* userData, const HubRect* requested, HubRect* actual);
+
+    // Create / destroy a pool payload for the current region
+    void* (*createPayload)(void* userData);
+    void (*destroyPayload)(void* userData, void* payload);
+
+    // Grab the current frame into payload (only touched for HUB_GRAB_NEW)
+    HubGrabResult (*grab)(void* userData, void* payload);
+} FrameHubSource;
+
+// Pooled frame shared between consumers (read-only for them)
+typedef struct {
+    void* payload;          // Source-defined (e.g. ID3D11Texture2D*, BGRA buffer)
+    int width;
+    int height;
+    uint64_t sequence;      // Increments for every frame with new content
+    int64_t grabTime;       // FrameHub_Now() when the content was grabbed
+
+    // Internal
+    int refCount;
+    int slot;
+} HubFrame;
+
+// One delivery to a consumer
+typedef struct {
+    HubFrame* frame;        // Release with FrameHub_Release
+    int64_t tickTime;       // FrameHub_Now() of the producer tick
+    bool changed;           // Content differs from the previous delivery to this consumer
+} HubDelivery;
+
+typedef struct {
+    const char* name;       // For stats/logging (not copied)
+    int fps;                // Delivery rate
+    int queueDepth;         // Mailbox size (0 = FRAME_HUB_DEFAULT_DEPTH)
+    HubRect region;         // Wanted region in source coordinates (0x0 = whatever the hub captures)
+} HubConsumerConfig;
+
+typedef struct {
+    uint64_t delivered;     // Frames put in the mailbox
+    uint64_t dropped;       // Frames evicted unread because the consumer fell behind
+    uint64_t consumed;      // Frames taken with FrameHub_Acquire
+} HubConsumerStats;
+
+typedef struct {
+    uint64_t ticks;         // Producer ticks
+    uint64_t grabsNew;      // Ticks with new content (one copy each)
+    uint64_t grabsSame;     // Ticks that re-delivered the latest frame
+    uint64_t grabsNone;     // Ticks with no frame
+    int poolSlots;          // Payloads allocated
+} HubStats;
+
+typedef struct FrameHub FrameHub;
+typedef struct HubConsumer HubConsumer;
+
+// Create a hub over a source (copied). The producer thread only runs while
+// there are consumers.
+FrameHub* FrameHub_Create(const FrameHubSource* source);
+
+// Destroy the hub. All consumers must have been removed.
+void FrameHub_Destroy(FrameHub* hub);
+
+// Attach a consumer. The first consumer selects the capture region; later
+// ones must request a region inside it (or 0x0) and get a crop instead.
+// Returns NULL if the region can't be served.
+HubConsumer* FrameHub_AddConsumer(FrameHub* hub, const HubConsumerConfig* config);
+
+// Detach a consumer (releases anything left in its mailbox). Frames the
+// consumer still holds must be released first. The last consumer out stops
+// the producer and frees the pool.
+void FrameHub_RemoveConsumer(FrameHub* hub, HubConsumer* consumer);
+
+// Take the oldest queued delivery. Waits up to timeoutMs (0 = poll,
+// negative = forever). Returns false on timeout.
+bool FrameHub_Acquire(FrameHub* hub, HubConsumer* consumer, int timeoutMs, HubDelivery* out);
+
+// Return a frame reference obtained from FrameHub_Acquire
+void FrameHub_Release(FrameHub* hub, HubFrame* frame);
+
+// Consumer's crop rectangle relative to the captured frame
+HubRect FrameHub_GetCrop(HubConsumer* consumer);
+
+// Region captured by the hub (valid while it has consumers)
+HubRect FrameHub_GetRegion(FrameHub* hub);
+
+int FrameHub_GetConsumerCount(FrameHub* hub);
+void FrameHub_GetConsumerStats(FrameHub* hub, HubConsumer* consumer, HubConsumerStats* stats);
+void FrameHub_GetStats(FrameHub* hub, HubStats* stats);
+
+// Producer tick timing (jitter histogram, missed ticks)
+void FrameHub_GetPacerStats(FrameHub* hub, FramePacerStats* stats);
+
+// Monotonic clock in hub units
+int64_t FrameHub_Now(void);
+
+#endif // FRAME_HUB_H
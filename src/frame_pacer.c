@@ -0,0 +1,364 @@
+/*
+ * Frame Pacer Implementation
+ * Integer deadline grid, kernel timers and jitter accounting
+ */
+
+#include "frame_pacer.h"
+#include "platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <mmsystem.h>   // timeBeginPeriod fallback for pre-1803 Windows
+#pragma comment(lib, "winmm.lib")
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#else
+#include <pthread.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#endif
+
+static const int g_bucketLimitsUs[FRAME_PACER_JITTER_BUCKETS] = {
+    50, 100, 250, 500, 1000, 2000, 4000, 8000, 16000, -1
+};
+
+struct FramePacer {
+    // Grid: deadline(k) = anchor + k * periodInt + (k * periodRem) / fpsNum,
+    // with k wrapped every fpsNum frames (= exactly fpsDen seconds)
+    int64_t anchor;
+    int64_t index;
+    int64_t lastDeadline;
+    bool started;               // A deadline has been met since Reset
+    int64_t periodInt;
+    int64_t periodRem;
+    int fpsNum;
+    int fpsDen;
+
+    FramePacerStats stats;
+
+#ifdef _WIN32
+    HANDLE timer;
+    HANDLE interruptEvent;
+    BOOL lowResFallback;        // Plain waitable timer + timeBeginPeriod(1)
+    CRITICAL_SECTION statsLock;
+#else
+    int timerFd;
+    int interruptFd;
+    pthread_mutex_t statsLock;
+#endif
+};
+
+// ============================================================================
+// Platform
+// ============================================================================
+
+#ifdef _WIN32
+static void StatsLock(FramePacer* p) { EnterCriticalSection(&p->statsLock); }
+static void StatsUnlock(FramePacer* p) { LeaveCriticalSection(&p->statsLock); }
+
+static bool Platform_Init(FramePacer* p) {
+    InitializeCriticalSection(&p->statsLock);
+
+    // High-resolution timers (Windows 10 1803+) fire within ~0.5 ms without
+    // raising the system timer rate
+    p->timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!p->timer) {
+        p->timer = CreateWaitableTimerW(NULL, FALSE, NULL);
+        if (p->timer) {
+            p->lowResFallback = TRUE;
+            timeBeginPeriod(1);
+        }
+    }
+    p->interruptEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+    return p->timer && p->interruptEvent;
+}
+
+static void Platform_Shutdown(FramePacer* p) {
+    if (p->timer) CloseHandle(p->timer);
+    if (p->interruptEvent) CloseHandle(p->interruptEvent);
+    if (p->lowResFallback) timeEndPeriod(1);
+    DeleteCriticalSection(&p->statsLock);
+}
+
+static void Platform_Arm(FramePacer* p, int64_t deadline) {
+    // QPC and the timer clock differ, so arm relative to now (negative = relative)
+    int64_t remaining = deadline - FramePacer_Now();
+    LARGE_INTEGER due;
+    due.QuadPart = remaining > 0 ? -remaining : -1;
+    SetWaitableTimer(p->timer, &due, 0, NULL, NULL, FALSE);
+}
+
+static void Platform_ClearTimer(FramePacer* p) {
+    (void)p;    // Auto-reset timer: the satisfied wait already cleared it
+}
+
+static bool Platform_Wait(FramePacer* p) {
+    HANDLE handles[2] = { p->interruptEvent, p->timer };
+    return WaitForMultipleObjects(2, handles, FALSE, INFINITE) == WAIT_OBJECT_0 + 1;
+}
+
+static void Platform_Interrupt(FramePacer* p) {
+    SetEvent(p->interruptEvent);
+}
+
+static PacerHandle Platform_Handle(FramePacer* p) {
+    return p->timer;
+}
+#else
+static void StatsLock(FramePacer* p) { pthread_mutex_lock(&p->statsLock); }
+static void StatsUnlock(FramePacer* p) { pthread_mutex_unlock(&p->statsLock); }
+
+static bool Platform_Init(FramePacer* p) {
+    pthread_mutex_init(&p->statsLock, NULL);
+    p->timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    p->interruptFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    return p->timerFd >= 0 && p->interruptFd >= 0;
+}
+
+static void Platform_Shutdown(FramePacer* p) {
+    if (p->timerFd >= 0) close(p->timerFd);
+    if (p->interruptFd >= 0) close(p->interruptFd);
+    pthread_mutex_destroy(&p->statsLock);
+}
+
+static void Platform_Arm(FramePacer* p, int64_t deadline) {
+    // Same clock as FramePacer_Now, so arm on the absolute deadline
+    // (a zero it_value would disarm; deadlines are always past boot)
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (deadline <= 0) deadline = 1;
+    spec.it_value.tv_sec = (time_t)(deadline / FRAME_PACER_UNITS_PER_SECOND);
+    spec.it_value.tv_nsec = (long)(deadline % FRAME_PACER_UNITS_PER_SECOND) * 100;
+    timerfd_settime(p->timerFd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+static void Platform_ClearTimer(FramePacer* p) {
+    uint64_t expirations;
+    ssize_t r = read(p->timerFd, &expirations, sizeof(expirations));
+    (void)r;
+}
+
+static bool Platform_Wait(FramePacer* p) {
+    struct pollfd fds[2];
+    fds[0].fd = p->interruptFd;
+    fds[0].events = POLLIN;
+    fds[1].fd = p->timerFd;
+    fds[1].events = POLLIN;
+
+    for (;;) {
+        int r = poll(fds, 2, -1);
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0) return false;
+        if (fds[0].revents & POLLIN) {
+            uint64_t value;
+            ssize_t n = read(p->interruptFd, &value, sizeof(value));
+            (void)n;
+            return false;
+        }
+        if (fds[1].revents & POLLIN) return true;
+    }
+}
+
+static void Platform_Interrupt(FramePacer* p) {
+    uint64_t one = 1;
+    ssize_t n = write(p->interruptFd, &one, sizeof(one));
+    (void)n;
+}
+
+static PacerHandle Platform_Handle(FramePacer* p) {
+    return p->timerFd;
+}
+#endif
+
+int64_t FramePacer_Now(void) {
+    return Platform_Now();
+}
+
+// ============================================================================
+// Grid
+// ============================================================================
+
+static int64_t GridDeadline(const FramePacer* p) {
+    return p->anchor + p->index * p->periodInt + (p->index * p->periodRem) / p->fpsNum;
+}
+
+static void GridAdvance(FramePacer* p) {
+    p->index++;
+    if (p->index == p->fpsNum) {
+        // fpsNum frames = fpsDen seconds exactly; re-anchor to keep k small
+        p->anchor += (int64_t)p->fpsDen * FRAME_PACER_UNITS_PER_SECOND;
+        p->index = 0;
+    }
+}
+
+static void GridSetRate(FramePacer* p, int fpsNum, int fpsDen) {
+    if (fpsNum <= 0) fpsNum = 60;
+    if (fpsDen <= 0) fpsDen = 1;
+    int64_t span = (int64_t)fpsDen * FRAME_PACER_UNITS_PER_SECOND;
+    p->fpsNum = fpsNum;
+    p->fpsDen = fpsDen;
+    p->periodInt = span / fpsNum;
+    p->periodRem = span % fpsNum;
+}
+
+static int JitterBucket(int64_t jitter) {
+    int64_t us = jitter > 0 ? jitter / 10 : 0;
+    for (int i = 0; i < FRAME_PACER_JITTER_BUCKETS - 1; i++) {
+        if (us < g_bucketLimitsUs[i]) return i;
+    }
+    return FRAME_PACER_JITTER_BUCKETS - 1;
+}
+
+// Account for a wake at 'now' on the current deadline and move past it
+static void CompleteTick(FramePacer* p, int64_t now, int64_t* deadlineOut) {
+    int64_t deadline = GridDeadline(p);
+    int64_t jitter = now - deadline;
+    uint64_t missed = 0;
+
+    GridAdvance(p);
+    while (GridDeadline(p) <= now) {
+        GridAdvance(p);
+        missed++;
+    }
+    p->lastDeadline = deadline;
+    p->started = true;
+
+    StatsLock(p);
+    FramePacerStats* s = &p->stats;
+    if (s->ticks == 0 || jitter < s->jitterMin) s->jitterMin = jitter;
+    if (s->ticks == 0 || jitter > s->jitterMax) s->jitterMax = jitter;
+    s->ticks++;
+    s->missed += missed;
+    s->jitterTotal += jitter;
+    s->histogram[JitterBucket(jitter)]++;
+    StatsUnlock(p);
+
+    if (deadlineOut) *deadlineOut = deadline;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+FramePacer* FramePacer_Create(int fpsNum, int fpsDen) {
+    FramePacer* p = (FramePacer*)calloc(1, sizeof(FramePacer));
+    if (!p) return NULL;
+#ifndef _WIN32
+    p->timerFd = -1;
+    p->interruptFd = -1;
+#endif
+    if (!Platform_Init(p)) {
+        Platform_Shutdown(p);
+        free(p);
+        return NULL;
+    }
+    GridSetRate(p, fpsNum, fpsDen);
+    FramePacer_Reset(p, 0);
+    return p;
+}
+
+void FramePacer_Destroy(FramePacer* pacer) {
+    if (!pacer) return;
+    Platform_Shutdown(pacer);
+    free(pacer);
+}
+
+void FramePacer_Reset(FramePacer* pacer, int64_t startTime) {
+    if (!pacer) return;
+    pacer->anchor = startTime > 0 ? startTime : FramePacer_Now();
+    pacer->index = 0;
+    pacer->lastDeadline = pacer->anchor;
+    pacer->started = false;
+}
+
+void FramePacer_SetRate(FramePacer* pacer, int fpsNum, int fpsDen) {
+    if (!pacer || (fpsNum == pacer->fpsNum && fpsDen == pacer->fpsDen)) return;
+    GridSetRate(pacer, fpsNum, fpsDen);
+    pacer->anchor = pacer->lastDeadline;
+    pacer->index = 0;
+    if (pacer->started) GridAdvance(pacer);    // Else the first deadline is still due
+}
+
+bool FramePacer_Wait(FramePacer* pacer, int64_t* deadline) {
+    if (!pacer) return false;
+    Platform_Arm(pacer, GridDeadline(pacer));
+    if (!Platform_Wait(pacer)) return false;
+    Platform_ClearTimer(pacer);
+    CompleteTick(pacer, FramePacer_Now(), deadline);
+    return true;
+}
+
+void FramePacer_Interrupt(FramePacer* pacer) {
+    if (pacer) Platform_Interrupt(pacer);
+}
+
+PacerHandle FramePacer_Arm(FramePacer* pacer) {
+    Platform_Arm(pacer, GridDeadline(pacer));
+    return Platform_Handle(pacer);
+}
+
+void FramePacer_Complete(FramePacer* pacer, int64_t* deadline) {
+    if (!pacer) return;
+    Platform_ClearTimer(pacer);
+    CompleteTick(pacer, FramePacer_Now(), deadline);
+}
+
+int64_t FramePacer_NextDeadline(FramePacer* pacer) {
+    return pacer ? GridDeadline(pacer) : 0;
+}
+
+void FramePacer_GetStats(FramePacer* pacer, FramePacerStats* stats) {
+    if (!pacer || !stats) return;
+    StatsLock(pacer);
+    *stats = pacer->stats;
+    StatsUnlock(pacer);
+}
+
+void FramePacer_ResetStats(FramePacer* pacer) {
+    if (!pacer) return;
+    StatsLock(pacer);
+    memset(&pacer->stats, 0, sizeof(pacer->stats));
+    StatsUnlock(pacer);
+}
+
+int FramePacer_BucketLimitUs(int bucket) {
+    if (bucket < 0 || bucket >= FRAME_PACER_JITTER_BUCKETS) return -1;
+    return g_bucketLimitsUs[bucket];
+}
+
+void FramePacer_FormatStats(const FramePacerStats* stats, char* buffer, size_t size) {
+    if (!buffer || size == 0) return;
+    buffer[0] = '\0';
+    if (!stats) return;
+
+    double avgMs = stats->ticks > 0 ? (double)stats->jitterTotal / stats->ticks / 10000.0 : 0.0;
+    int len = snprintf(buffer, size, "n=%llu missed=%llu jitter avg=%.3fms max=%.3fms [",
+                       (unsigned long long)stats->ticks, (unsigned long long)stats->missed,
+                       avgMs, (double)stats->jitterMax / 10000.0);
+
+    bool first = true;
+    for (int i = 0; i < FRAME_PACER_JITTER_BUCKETS && len > 0 && (size_t)len < size; i++) {
+        if (stats->histogram[i] == 0) continue;
+        int limit = g_bucketLimitsUs[i];
+        int n;
+        if (limit < 0) {
+            n = snprintf(buffer + len, size - len, "%s>=%dus:%llu", first ? "" : " ",
+                         g_bucketLimitsUs[i - 1], (unsigned long long)stats->histogram[i]);
+        } else {
+            n = snprintf(buffer + len, size - len, "%s<%dus:%llu", first ? "" : " ",
+                         limit, (unsigned long long)stats->histogram[i]);
+        }
+        if (n < 0) break;
+        len += n;
+        first = false;
+    }
+    if (len > 0 && (size_t)len < size) snprintf(buffer + len, size - len, "]");
+}
@@ -0,0 +1,90 @@
+/*
+ * Frame Pacer - Drift-free frame deadlines on high-resolution timers
+ * Portable C: waitable timers on Windows, timerfd on Linux
+ *
+ * - Deadlines sit on an exact integer grid (start + k * den / num seconds),
+ *   so rounding never accumulates and a late wake doesn't shift later frames
+ * - Sleeps until the deadline on a kernel timer: one wakeup per frame, no
+ *   1 ms polling and no system-wide timeBeginPeriod (unless the OS lacks
+ *   high-resolution waitable timers)
+ * - Missed deadlines are skipped and counted, not replayed in a burst
+ * - Wake-up lateness goes into a jitter histogram
+ *
+ * Two ways to wait: FramePacer_Wait blocks (FramePacer_Interrupt wakes it),
+ * or FramePacer_Arm returns a handle to wait on alongside other handles and
+ * FramePacer_Complete is called once it fires.
+ */
+
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef _WIN32
+typedef void* PacerHandle;      // HANDLE (waitable timer)
+#else
+typedef int PacerHandle;        // timerfd (poll for POLLIN)
+#endif
+
+// Pacer timebase: 100-ns units, monotonic (same clock as FrameHub_Now)
+#define FRAME_PACER_UNITS_PER_SECOND 10000000LL
+
+// Jitter histogram buckets (upper bounds in microseconds, last is open-ended)
+#define FRAME_PACER_JITTER_BUCKETS 10
+
+typedef struct {
+    uint64_t ticks;             // Deadlines met (woken for)
+    uint64_t missed;            // Deadlines skipped because the waiter was too late
+    int64_t jitterMin;          // Wake lateness, 100-ns units
+    int64_t jitterMax;
+    int64_t jitterTotal;
+    uint64_t histogram[FRAME_PACER_JITTER_BUCKETS];
+} FramePacerStats;
+
+typedef struct FramePacer FramePacer;
+
+// Create a pacer at fpsNum/fpsDen frames per second. The first deadline is
+// immediate; use FramePacer_Reset to anchor the grid elsewhere.
+FramePacer* FramePacer_Create(int fpsNum, int fpsDen);
+void FramePacer_Destroy(FramePacer* pacer);
+
+// Restart the grid with its first deadline at startTime (0 = now)
+void FramePacer_Reset(FramePacer* pacer, int64_t startTime);
+
+// Change rate. The grid is re-anchored on the last deadline, so the next one
+// is a new-rate interval after it.
+void FramePacer_SetRate(FramePacer* pacer, int fpsNum, int fpsDen);
+
+// Block until the next deadline. Returns false (without advancing) if
+// FramePacer_Interrupt was called. *deadline receives the deadline met.
+bool FramePacer_Wait(FramePacer* pacer, int64_t* deadline);
+
+// Wake a thread blocked in FramePacer_Wait (safe from any thread). An
+// interrupt with no waiter makes the next Wait return immediately.
+void FramePacer_Interrupt(FramePacer* pacer);
+
+// Arm the timer for the next deadline and return its handle
+PacerHandle FramePacer_Arm(FramePacer* pacer);
+
+// Record the wake after the armed handle fired and advance to the next
+// deadline. *deadline receives the deadline met.
+void FramePacer_Complete(FramePacer* pacer, int64_t* deadline);
+
+// Next deadline on the grid
+int64_t FramePacer_NextDeadline(FramePacer* pacer);
+
+void FramePacer_GetStats(FramePacer* pacer, FramePacerStats* stats);
+void FramePacer_ResetStats(FramePacer* pacer);
+
+// Upper bound of a histogram bucket in microseconds (-1 for the last)
+int FramePacer_BucketLimitUs(int bucket);
+
+// One-line summary for logs, e.g. "n=600 missed=0 jitter avg=0.08ms max=0.61ms [<50us:571 ...]"
+void FramePacer_FormatStats(const FramePacerStats* stats, char* buffer, size_t size);
+
+// Monotonic clock in pacer units
+int64_t FramePacer_Now(void);
+
+#endif // FRAME_PACER_H
@@ -0,0 +1,548 @@
+/*
+ * Frame Source Implementation
+ * Pattern, Y4M and raw file backends plus the frame hub adapter
+ */
+
+#ifdef _WIN32
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "frame_source.h"
+#include "cpu_converter.h"
+#include "mem_tracker.h"
+#include "platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNITS_PER_SECOND 10000000LL
+
+// ============================================================================
+// SHARED HELPERS
+// ============================================================================
+
+int FrameSource_DefaultPitch(const FrameSourceInfo* info) {
+    if (!info) return 0;
+    return info->format == FRAME_FORMAT_NV12 ? info->width : info->width * 4;
+}
+
+size_t FrameSource_FrameSize(const FrameSourceInfo* info, int pitch) {
+    if (!info) return 0;
+    if (pitch <= 0) pitch = FrameSource_DefaultPitch(info);
+    size_t rows = info->format == FRAME_FORMAT_NV12
+        ? (size_t)info->height * 3 / 2
+        : (size_t)info->height;
+    return rows * (size_t)pitch;
+}
+
+static int64_t FrameTimestamp(const FrameSourceInfo* info, int64_t index) {
+    return index * UNITS_PER_SECOND * info->fpsDen / info->fpsNum;
+}
+
+// Copy a tightly packed frame into caller memory with its own pitch
+static void CopyFrame(const FrameSourceInfo* info, const uint8_t* packed, uint8_t* dst, int pitch) {
+    int packedPitch = FrameSource_DefaultPitch(info);
+    if (pitch == packedPitch) {
+        memcpy(dst, packed, FrameSource_FrameSize(info, packedPitch));
+        return;
+    }
+    int rows = info->format == FRAME_FORMAT_NV12 ? info->height * 3 / 2 : info->height;
+    for (int y = 0; y < rows; y++) {
+        memcpy(dst + (size_t)y * pitch, packed + (size_t)y * packedPitch, packedPitch);
+    }
+}
+
+static void BGRAToNV12(const uint8_t* bgra, int width, int height, uint8_t* nv12) {
+    CPUConverter_BGRAToNV12(bgra, width * 4, width, height, nv12, width, nv12 + (size_t)width * height, width);
+}
+
+static uint8_t Clamp255(int v) {
+    return (uint8_t)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+// Planar 4:2:0 (BT.601 limited range) → BGRA
+static void I420ToBGRA(const uint8_t* yPlane, const uint8_t* uPlane, const uint8_t* vPlane,
+                       int width, int height, uint8_t* bgra) {
+    int chromaWidth = width / 2;
+    for (int y = 0; y < height; y++) {
+        const uint8_t* yRow = yPlane + (size_t)y * width;
+        const uint8_t* uRow = uPlane + (size_t)(y / 2) * chromaWidth;
+        const uint8_t* vRow = vPlane + (size_t)(y / 2) * chromaWidth;
+        uint8_t* out = bgra + (size_t)y * width * 4;
+
+        for (int x = 0; x < width; x++) {
+            int c = 298 * (yRow[x] - 16);
+            int d = uRow[x / 2] - 128;
+            int e = vRow[x / 2] - 128;
+            out[x * 4 + 0] = Clamp255((c + 516 * d + 128) >> 8);
+            out[x * 4 + 1] = Clamp255((c - 100 * d - 208 * e + 128) >> 8);
+            out[x * 4 + 2] = Clamp255((c + 409 * e + 128) >> 8);
+            out[x * 4 + 3] = 255;
+        }
+    }
+}
+
+static bool ValidFrameSize(int width, int height) {
+    // NV12 needs whole 2x2 chroma blocks; keep BGRA to the same rule so a
+    // source can switch formats without changing size
+    return width >= 2 && height >= 2 && !(width & 1) && !(height & 1) &&
+           width <= 16384 && height <= 16384;
+}
+
+static FrameSource* AllocSource(const FrameSourceOps* ops, void* impl) {
+    FrameSource* src = (FrameSource*)calloc(1, sizeof(FrameSource));
+    if (!src) return NULL;
+    src->ops = ops;
+    src->impl = impl;
+    return src;
+}
+
+// ============================================================================
+// PATTERN SOURCE
+// ============================================================================
+
+typedef struct {
+    PatternConfig config;
+    int64_t nextIndex;
+    int64_t renderedPhase;      // Animation phase held in 'frame' (-1 = none)
+    uint8_t* bgra;              // Render target
+    uint8_t* frame;             // Packed output (aliases bgra for BGRA output)
+} PatternSource;
+
+// Animation phase only advances during motion periods, so every frame of a
+// static period renders identically
+static int64_t PatternPhase(const PatternConfig* config, int64_t index) {
+    if (config->staticFrames <= 0) return index;
+    if (config->motionFrames <= 0) return 0;
+    int64_t period = (int64_t)config->motionFrames + config->staticFrames;
+    int64_t cycles = index / period;
+    int64_t pos = index % period;
+    return cycles * config->motionFrames + (pos < config->motionFrames ? pos : config->motionFrames - 1);
+}
+
+static void PatternRender(PatternSource* p, int64_t phase) {
+    int width = p->config.width;
+    int height = p->config.height;
+    uint8_t* bgra = p->bgra;
+
+    // Background: diagonal gradient scrolling one pixel per frame
+    for (int y = 0; y < height; y++) {
+        uint8_t* row = bgra + (size_t)y * width * 4;
+        uint8_t g = (uint8_t)(y * 255 / (height - 1));
+        for (int x = 0; x < width; x++) {
+            row[x * 4 + 0] = (uint8_t)((x + y) >> 2);
+            row[x * 4 + 1] = g;
+            row[x * 4 + 2] = (uint8_t)(x + phase);
+            row[x * 4 + 3] = 255;
+        }
+    }
+
+    // Box bouncing diagonally across the frame
+    int boxSize = (height < width ? height : width) / 4;
+    if (boxSize > 0 && p->config.motionSpeed > 0) {
+        int64_t travelX = (int64_t)(width - boxSize);
+        int64_t travelY = (int64_t)(height - boxSize);
+        int64_t dist = phase * p->config.motionSpeed;
+        int64_t bx = travelX > 0 ? dist % (2 * travelX) : 0;
+        int64_t by = travelY > 0 ? dist % (2 * travelY) : 0;
+        if (bx > travelX) bx = 2 * travelX - bx;
+        if (by > travelY) by = 2 * travelY - by;
+
+        for (int y = (int)by; y < (int)by + boxSize; y++) {
+            uint8_t* row = bgra + ((size_t)y * width + (size_t)bx) * 4;
+            for (int x = 0; x < boxSize; x++) {
+                row[x * 4 + 0] = 240;
+                row[x * 4 + 1] = 240;
+                row[x * 4 + 2] = 240;
+            }
+        }
+    }
+
+    // Counter strip: 16 blocks along the top showing the phase in binary
+    int block = width / 16;
+    int stripHeight = height / 16 > 0 ? height / 16 : 1;
+    for (int bit = 0; bit < 16 && block > 0; bit++) {
+        uint8_t v = ((phase >> (15 - bit)) & 1) ? 255 : 0;
+        for (int y = 0; y < stripHeight; y++) {
+            memset(bgra + ((size_t)y * width + (size_t)bit * block) * 4, v, (size_t)block * 4);
+        }
+    }
+
+    if (p->config.format == FRAME_FORMAT_NV12) {
+        BGRAToNV12(bgra, width, height, p->frame);
+    }
+    p->renderedPhase = phase;
+}
+
+static bool Pattern_Read(FrameSource* src, uint8_t* dst, int pitch, SourceFrame* frame) {
+    PatternSource* p = (PatternSource*)src->impl;
+    if (p->config.frameCount > 0 && p->nextIndex >= p->config.frameCount) return false;
+
+    int64_t index = p->nextIndex++;
+    int64_t phase = PatternPhase(&p->config, index);
+    bool changed = phase != p->renderedPhase;
+    if (changed) PatternRender(p, phase);
+
+    CopyFrame(&src->info, p->frame, dst, pitch);
+
+    if (frame) {
+        frame->index = index;
+        frame->timestamp = FrameTimestamp(&src->info, index);
+        frame->changed = changed || index == 0;
+    }
+    return true;
+}
+
+static bool Pattern_Rewind(FrameSource* src) {
+    PatternSource* p = (PatternSource*)src->impl;
+    p->nextIndex = 0;
+    return true;
+}
+
+static void Pattern_Destroy(FrameSource* src) {
+    PatternSource* p = (PatternSource*)src->impl;
+    if (p->frame != p->bgra) MemTracker_Free(p->frame);
+    MemTracker_Free(p->bgra);
+    free(p);
+}
+
+static const FrameSourceOps g_patternOps = {
+    "pattern",
+    Pattern_Read,
+    Pattern_Rewind,
+    Pattern_Destroy
+};
+
+FrameSource* FrameSource_CreatePattern(const PatternConfig* config) {
+    if (!config || !ValidFrameSize(config->width, config->height) || config->fps <= 0) return NULL;
+
+    PatternSource* p = (PatternSource*)calloc(1, sizeof(PatternSource));
+    if (!p) return NULL;
+    p->config = *config;
+    p->renderedPhase = -1;
+
+    size_t pixels = (size_t)config->width * config->height;
+    p->bgra = (uint8_t*)MemTracker_Alloc(MEM_TAG_CAPTURE, pixels * 4);
+    p->frame = config->format == FRAME_FORMAT_NV12 ? (uint8_t*)MemTracker_Alloc(MEM_TAG_CAPTURE, pixels * 3 / 2) : p->bgra;
+    if (!p->bgra || !p->frame) goto fail;
+
+    FrameSource* src = AllocSource(&g_patternOps, p);
+    if (!src) goto fail;
+    src->info.width = config->width;
+    src->info.height = config->height;
+    src->info.format = config->format;
+    src->info.fpsNum = config->fps;
+    src->info.fpsDen = 1;
+    src->info.frameCount = config->frameCount > 0 ? config->frameCount : 0;
+    return src;
+
+fail:
+    if (p->frame && p->frame != p->bgra) MemTracker_Free(p->frame);
+    MemTracker_Free(p->bgra);
+    free(p);
+    return NULL;
+}
+
+// ============================================================================
+// FILE SOURCES (Y4M / RAW)
+// ============================================================================
+
+typedef struct {
+    FILE* file;
+    bool y4m;
+    int64_t dataOffset;         // First frame (Y4M: first "FRAME" marker)
+    size_t fileFrameSize;       // Bytes of pixel data per frame in the file
+    int64_t nextIndex;
+    uint8_t* planar;            // Y4M: raw I420 frame as read
+    uint8_t* frame;             // Packed output of the current frame
+    uint8_t* previous;          // Packed output of the previous frame (for 'changed')
+    bool havePrevious;
+} FileSource;
+
+static bool File_ReadFrameHeader(FileSource* f) {
+    // "FRAME" optionally followed by parameters, terminated by '\n'
+    char tag[5];
+    if (fread(tag, 1, 5, f->file) != 5 || memcmp(tag, "FRAME", 5) != 0) return false;
+    int c;
+    int guard = 0;
+    while ((c = fgetc(f->file)) != EOF && c != '\n') {
+        if (++guard > 1024) return false;
+    }
+    return c == '\n';
+}
+
+static bool File_Read(FrameSource* src, uint8_t* dst, int pitch, SourceFrame* frame) {
+    FileSource* f = (FileSource*)src->impl;
+    const FrameSourceInfo* info = &src->info;
+    int width = info->width;
+    int height = info->height;
+
+    uint8_t* tmp = f->previous;
+    f->previous = f->frame;
+    f->frame = tmp;
+
+    if (f->y4m) {
+        if (!File_ReadFrameHeader(f)) goto eof;
+        if (fread(f->planar, 1, f->fileFrameSize, f->file) != f->fileFrameSize) goto eof;
+
+        const uint8_t* yPlane = f->planar;
+        const uint8_t* uPlane = yPlane + (size_t)width * height;
+        const uint8_t* vPlane = uPlane + (size_t)(width / 2) * (height / 2);
+        if (info->format == FRAME_FORMAT_NV12) {
+            memcpy(f->frame, yPlane, (size_t)width * height);
+            uint8_t* uv = f->frame + (size_t)width * height;
+            size_t chroma = (size_t)(width / 2) * (height / 2);
+            for (size_t i = 0; i < chroma; i++) {
+                uv[i * 2] = uPlane[i];
+                uv[i * 2 + 1] = vPlane[i];
+            }
+        } else {
+            I420ToBGRA(yPlane, uPlane, vPlane, width, height, f->frame);
+        }
+    } else {
+        if (fread(f->frame, 1, f->fileFrameSize, f->file) != f->fileFrameSize) goto eof;
+    }
+
+    size_t packedSize = FrameSource_FrameSize(info, 0);
+    bool changed = !f->havePrevious || memcmp(f->frame, f->previous, packedSize) != 0;
+    f->havePrevious = true;
+
+    CopyFrame(info, f->frame, dst, pitch);
+
+    if (frame) {
+        frame->index = f->nextIndex;
+        frame->timestamp = FrameTimestamp(info, f->nextIndex);
+        frame->changed = changed;
+    }
+    f->nextIndex++;
+    return true;
+
+eof:
+    // Keep 'previous' pointing at the last frame actually delivered
+    tmp = f->previous;
+    f->previous = f->frame;
+    f->frame = tmp;
+    return false;
+}
+
+static bool File_Rewind(FrameSource* src) {
+    FileSource* f = (FileSource*)src->impl;
+    if (Platform_FileSeek64(f->file, f->dataOffset, SEEK_SET) != 0) return false;
+    clearerr(f->file);
+    f->nextIndex = 0;
+    return true;
+}
+
+static void File_Destroy(FrameSource* src) {
+    FileSource* f = (FileSource*)src->impl;
+    if (f->file) fclose(f->file);
+    MemTracker_Free(f->planar);
+    MemTracker_Free(f->frame);
+    MemTracker_Free(f->previous);
+    free(f);
+}
+
+static const FrameSourceOps g_y4mOps = {
+    "y4m",
+    File_Read,
+    File_Rewind,
+    File_Destroy
+};
+
+static const FrameSourceOps g_rawOps = {
+    "raw",
+    File_Read,
+    File_Rewind,
+    File_Destroy
+};
+
+// Finish a file source once info and the file layout are known
+static FrameSource* File_Create(const FrameSourceOps* ops, FileSource* f, const FrameSourceInfo* info,
+                                size_t frameOverhead) {
+    size_t packedSize = FrameSource_FrameSize(info, 0);
+    f->frame = (uint8_t*)MemTracker_Alloc(MEM_TAG_CAPTURE, packedSize);
+    f->previous = (uint8_t*)MemTracker_Alloc(MEM_TAG_CAPTURE, packedSize);
+    if (f->y4m) f->planar = (uint8_t*)MemTracker_Alloc(MEM_TAG_CAPTURE, f->fileFrameSize);
+    if (!f->frame || !f->previous || (f->y4m && !f->planar)) return NULL;
+
+    FrameSource* src = AllocSource(ops, f);
+    if (!src) return NULL;
+    src->info = *info;
+
+    // Frame count from the file size (exact unless Y4M frames carry parameters)
+    if (Platform_FileSeek64(f->file, 0, SEEK_END) == 0) {
+        int64_t end = Platform_FileTell64(f->file);
+        if (end > f->dataOffset) {
+            src->info.frameCount = (end - f->dataOffset) / (int64_t)(f->fileFrameSize + frameOverhead);
+        }
+    }
+    if (Platform_FileSeek64(f->file, f->dataOffset, SEEK_SET) != 0) {
+        free(src);
+        return NULL;
+    }
+    return src;
+}
+
+static void File_Free(FileSource* f) {
+    if (!f) return;
+    if (f->file) fclose(f->file);
+    MemTracker_Free(f->planar);
+    MemTracker_Free(f->frame);
+    MemTracker_Free(f->previous);
+    free(f);
+}
+
+FrameSource* FrameSource_OpenY4M(const char* path, FrameFormat outputFormat) {
+    if (!path) return NULL;
+
+    FileSource* f = (FileSource*)calloc(1, sizeof(FileSource));
+    if (!f) return NULL;
+    f->y4m = true;
+    f->file = fopen(path, "rb");
+    if (!f->file) goto fail;
+
+    // Header: "YUV4MPEG2 W<w> H<h> F<num>:<den> [I..] [A..] [C<colorspace>] [X..]\n"
+    char header[512];
+    int len = 0;
+    int c;
+    while ((c = fgetc(f->file)) != EOF && c != '\n') {
+        if (len >= (int)sizeof(header) - 1) goto fail;
+        header[len++] = (char)c;
+    }
+    if (c != '\n') goto fail;
+    header[len] = '\0';
+    if (strncmp(header, "YUV4MPEG2", 9) != 0) goto fail;
+
+    FrameSourceInfo info = {0};
+    info.format = outputFormat;
+    info.fpsNum = 30;
+    info.fpsDen = 1;
+
+    for (char* tok = strtok(header + 9, " "); tok; tok = strtok(NULL, " ")) {
+        switch (tok[0]) {
+            case 'W': info.width = atoi(tok + 1); break;
+            case 'H': info.height = atoi(tok + 1); break;
+            case 'F': {
+                int num = 0, den = 0;
+                if (sscanf(tok + 1, "%d:%d", &num, &den) == 2 && num > 0 && den > 0) {
+                    info.fpsNum = num;
+                    info.fpsDen = den;
+                }
+                break;
+            }
+            case 'C':
+                // Only 8-bit 4:2:0 (any chroma siting)
+                if (strncmp(tok + 1, "420", 3) != 0 || strstr(tok, "p1") || strstr(tok, "p9")) goto fail;
+                break;
+            default:
+                break;
+        }
+    }
+    if (!ValidFrameSize(info.width, info.height)) goto fail;
+
+    f->dataOffset = Platform_FileTell64(f->file);
+    f->fileFrameSize = (size_t)info.width * info.height * 3 / 2;
+
+    FrameSource* src = File_Create(&g_y4mOps, f, &info, 6);  // "FRAME\n"
+    if (!src) goto fail;
+    return src;
+
+fail:
+    File_Free(f);
+    return NULL;
+}
+
+FrameSource* FrameSource_OpenRaw(const char* path, int width, int height, FrameFormat format, int fps) {
+    if (!path || !ValidFrameSize(width, height) || fps <= 0) return NULL;
+
+    FileSource* f = (FileSource*)calloc(1, sizeof(FileSource));
+    if (!f) return NULL;
+    f->file = fopen(path, "rb");
+    if (!f->file) goto fail;
+
+    FrameSourceInfo info = {0};
+    info.width = width;
+    info.height = height;
+    info.format = format;
+    info.fpsNum = fps;
+    info.fpsDen = 1;
+
+    f->dataOffset = 0;
+    f->fileFrameSize = FrameSource_FrameSize(&info, 0);
+
+    FrameSource* src = File_Create(&g_rawOps, f, &info, 0);
+    if (!src) goto fail;
+    return src;
+
+fail:
+    File_Free(f);
+    return NULL;
+}
+
+// ============================================================================
+// GENERIC API
+// ============================================================================
+
+bool FrameSource_Read(FrameSource* src, uint8_t* dst, int pitch, SourceFrame* frame) {
+    if (!src || !src->ops->read || !dst) return false;
+    if (pitch <= 0) pitch = FrameSource_DefaultPitch(&src->info);
+    if (pitch < FrameSource_DefaultPitch(&src->info)) return false;
+    return src->ops->read(src, dst, pitch, frame);
+}
+
+bool FrameSource_Rewind(FrameSource* src) {
+    if (!src || !src->ops->rewind) return false;
+    return src->ops->rewind(src);
+}
+
+void FrameSource_Destroy(FrameSource* src) {
+    if (!src) return;
+    if (src->ops->destroy) src->ops->destroy(src);
+    free(src);
+}
+
+// ============================================================================
+// FRAME HUB ADAPTER
+// ============================================================================
+
+static bool HubSource_SetRegion(void* userData, const HubRect* requested, HubRect* actual) {
+    FrameSource* src = (FrameSource*)userData;
+    (void)requested;
+    actual->x = 0;
+    actual->y = 0;
+    actual->width = src->info.width;
+    actual->height = src->info.height;
+    return true;
+}
+
+static void* HubSource_CreatePayload(void* userData) {
+    FrameSource* src = (FrameSource*)userData;
+    return MemTracker_Alloc(MEM_TAG_CAPTURE, FrameSource_FrameSize(&src->info, 0));
+}
+
+static void HubSource_DestroyPayload(void* userData, void* payload) {
+    (void)userData;
+    MemTracker_Free(payload);
+}
+
+static HubGrabResult HubSource_Grab(void* userData, void* payload) {
+    FrameSource* src = (FrameSource*)userData;
+    SourceFrame frame;
+    if (!FrameSource_Read(src, (uint8_t*)payload, 0, &frame)) {
+        // End of a finite source: loop
+        if (!FrameSource_Rewind(src) || !FrameSource_Read(src, (uint8_t*)payload, 0, &frame)) {
+            return HUB_GRAB_NONE;
+        }
+    }
+    return frame.changed ? HUB_GRAB_NEW : HUB_GRAB_SAME;
+}
+
+void FrameSource_GetHubSource(FrameSource* src, FrameHubSource* hubSource) {
+    if (!hubSource) return;
+    memset(hubSource, 0, sizeof(FrameHubSource));
+    hubSource->userData = src;
+    hubSource->setRegion = HubSource_SetRegion;
+    hubSource->createPayload = HubSource_CreatePayload;
+    hubSource->destroyPayload = HubSource_DestroyPayload;
+    hubSource->grab = HubSource_Grab;
+}
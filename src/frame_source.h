@@ -0,0 +1,106 @@
+/*
+ * Frame Source - Pull-based video input for the capture pipeline
+ * Portable C; backends are operation tables like VideoEncoderOps
+ *
+ * Backends:
+ * - Pattern: procedural test content with configurable motion and static
+ *   periods, any size and rate
+ * - Y4M / raw file: YUV4MPEG2 4:2:0, or headerless BGRA/NV12
+ *
+ * Live desktop capture stays on the GPU path (Capture_GetHubSource hands the
+ * hub D3D11 textures); these sources feed the hub from system memory
+ * (FrameSource_GetHubSource) or drive lwsr-replay-sim --source directly.
+ *
+ * Frames are written into caller memory as BGRA (pitch >= width * 4) or
+ * NV12 (Y plane of height rows, then interleaved UV plane of height / 2 rows,
+ * both with the same pitch >= width). File and pattern sources are not paced:
+ * they produce frames as fast as they are read, with timestamps derived from
+ * the frame index, so a pipeline can run faster than real time.
+ */
+
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "frame_hub.h"
+
+typedef enum {
+    FRAME_FORMAT_BGRA = 0,
+    FRAME_FORMAT_NV12
+} FrameFormat;
+
+typedef struct {
+    int width;
+    int height;
+    FrameFormat format;
+    int fpsNum;             // Frame rate as a fraction (e.g. 30000/1001)
+    int fpsDen;
+    int64_t frameCount;     // Total frames, 0 = unbounded (live or endless pattern)
+} FrameSourceInfo;
+
+// Per-frame metadata from FrameSource_Read
+typedef struct {
+    int64_t index;          // Frame number since open/rewind
+    int64_t timestamp;      // 100-ns units (index / fps for file and pattern sources)
+    bool changed;           // Content differs from the previous frame
+} SourceFrame;
+
+typedef struct FrameSource FrameSource;
+
+// Backend operations table
+typedef struct {
+    const char* name;
+    // Write the next frame into dst. Returns false at end of stream or on error.
+    bool (*read)(FrameSource* src, uint8_t* dst, int pitch, SourceFrame* frame);
+    // Restart from the first frame (false if not seekable)
+    bool (*rewind)(FrameSource* src);
+    void (*destroy)(FrameSource* src);
+} FrameSourceOps;
+
+struct FrameSource {
+    const FrameSourceOps* ops;
+    FrameSourceInfo info;
+    void* impl;
+};
+
+// Procedural pattern: scrolling gradient with a moving box and a ticking
+// counter strip. Motion and static periods alternate (static frames are
+// bit-identical and reported as unchanged).
+typedef struct {
+    int width;
+    int height;
+    FrameFormat format;
+    int fps;
+    int motionSpeed;        // Pixels per frame the box moves (0 = no box motion)
+    int motionFrames;       // Length of a motion period in frames (0 = always moving)
+    int staticFrames;       // Length of a static period in frames (0 = never static)
+    int64_t frameCount;     // Stop after this many frames (0 = endless)
+} PatternConfig;
+
+FrameSource* FrameSource_CreatePattern(const PatternConfig* config);
+
+// YUV4MPEG2 file (8-bit 4:2:0 only). Output format may be BGRA or NV12.
+FrameSource* FrameSource_OpenY4M(const char* path, FrameFormat outputFormat);
+
+// Headerless raw file of back-to-back frames in the given format (tightly packed)
+FrameSource* FrameSource_OpenRaw(const char* path, int width, int height, FrameFormat format, int fps);
+
+// Bytes needed for one frame at the given pitch (pitch 0 = tightly packed)
+size_t FrameSource_FrameSize(const FrameSourceInfo* info, int pitch);
+
+// Tightly packed pitch for a source's format
+int FrameSource_DefaultPitch(const FrameSourceInfo* info);
+
+bool FrameSource_Read(FrameSource* src, uint8_t* dst, int pitch, SourceFrame* frame);
+bool FrameSource_Rewind(FrameSource* src);
+void FrameSource_Destroy(FrameSource* src);
+
+// Adapt a source for the frame hub. Payloads are tightly packed frames in
+// the source's format; finite sources loop. The hub captures the whole
+// frame (region requests only pick the crop for later consumers).
+// The source must outlive the hub's use of it.
+void FrameSource_GetHubSource(FrameSource* src, FrameHubSource* hubSource);
+
+#endif // FRAME_SOURCE_H
@@ -105,6 +105,12 @@ fail:
     return FALSE;
 }
 
+void GPUConverter_SetSourceRect(GPUConverter* conv, const RECT* rect) {
+    if (!conv->initialized) return;
+    conv->videoContext->lpVtbl->VideoProcessorSetStreamSourceRect(
+        conv->videoContext, conv->videoProcessor, 0, rect ? TRUE : FALSE, rect);
+}
+
 ID3D11Texture2D* GPUConverter_Convert(GPUConverter* conv, ID3D11Texture2D* bgraTexture) {
     if (!conv->initialized || !bgraTexture) return NULL;
     
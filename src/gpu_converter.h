@@ -28,6 +28,10 @@ typedef struct {
 // Initialize GPU converter
 BOOL GPUConverter_Init(GPUConverter* conv, ID3D11Device* device, int width, int height);
 
+// Convert only this part of the input (e.g. a frame hub crop); NULL = whole
+// input. Must match the converter size. Persists across Convert calls.
+void GPUConverter_SetSourceRect(GPUConverter* conv, const RECT* rect);
+
 // Convert BGRA texture to NV12 texture (GPU-only, no CPU copy)
 // Returns the NV12 output texture (owned by converter, do not release)
 ID3D11Texture2D* GPUConverter_Convert(GPUConverter* conv, ID3D11Texture2D* bgraTexture);
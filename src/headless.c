@@ -0,0 +1,206 @@
+/*
+ * Headless Implementation
+ */
+
+#include "headless.h"
+#include "control.h"
+#include "control_server.h"
+#include "config.h"
+#include "replay_buffer.h"
+#include "crash_handler.h"
+#include "logger.h"
+#include <stdio.h>
+#include <string.h>
+
+// How often the job loop wakes without work (heartbeat cadence)
+#define HEADLESS_IDLE_MS 1000
+
+// Alias for logging
+#define HeadlessLog Logger_Log
+
+extern AppConfig g_config;
+extern ReplayBufferState g_replayBuffer;
+
+static ControlQueue* g_queue = NULL;
+
+// ============================================================================
+// Jobs
+// ============================================================================
+
+// Target file for a save: the default timestamped name (milliseconds, so
+// back-to-back saves don't collide) or a path relative to the save folder
+static BOOL ResolveSavePath(const char* requested, char* path, size_t size) {
+    int length;
+    if (!requested[0]) {
+        SYSTEMTIME st;
+        GetLocalTime(&st);
+        length = snprintf(path, size, "%s\\Replay_%04d%02d%02d_%02d%02d%02d_%03d.mp4",
+                          g_config.savePath, st.wYear, st.wMonth, st.wDay,
+                          st.wHour, st.wMinute, st.wSecond, st.wMilliseconds);
+    } else if (requested[0] == '\\' || requested[0] == '/' || (requested[0] && requested[1] == ':')) {
+        length = snprintf(path, size, "%s", requested);
+    } else {
+        length = snprintf(path, size, "%s\\%s", g_config.savePath, requested);
+    }
+    return length > 0 && (size_t)length < size;
+}
+
+static BOOL RunSave(const ControlCommand* command, char* detail, size_t size) {
+    char path[MAX_PATH];
+    if (!ResolveSavePath(command->path, path, sizeof(path))) {
+        snprintf(detail, size, "path too long");
+        return FALSE;
+    }
+    if (!g_replayBuffer.isBuffering || !g_replayBuffer.bufferReady) {
+        snprintf(detail, size, "replay buffer not ready");
+        return FALSE;
+    }
+
+    // Blocks for as long as the save takes (up to the watchdog's hang
+    // timeout); SaveClip sends heartbeats while it waits
+    if (!ReplayBuffer_SaveClip(&g_replayBuffer, path, command->seconds)) {
+        snprintf(detail, size, "save failed (see log)");
+        return FALSE;
+    }
+    snprintf(detail, size, "%s", path);
+    return TRUE;
+}
+
+static void ApplySettings(const ControlSettings* s) {
+    if (s->durationSeconds >= 0) g_config.replayDuration = s->durationSeconds;
+    if (s->fps >= 0)             g_config.replayFPS = s->fps;
+    if (s->quality >= 0)         g_config.quality = (QualityPreset)s->quality;
+    if (s->memoryMB >= 0)        g_config.replayMemoryMB = s->memoryMB;
+    if (s->vfr >= 0)             g_config.replayVFR = s->vfr ? TRUE : FALSE;
+    if (s->audio >= 0)           g_config.audioEnabled = s->audio ? TRUE : FALSE;
+    if (s->monitor >= 0) {
+        g_config.replayCaptureSource = MODE_MONITOR;
+        g_config.replayMonitorIndex = s->monitor;
+    }
+}
+
+static BOOL StartBuffer(char* detail, size_t size) {
+    if (g_replayBuffer.isBuffering) return TRUE;
+    if (!ReplayBuffer_Start(&g_replayBuffer, &g_config)) {
+        snprintf(detail, size, "replay buffer failed to start (see log)");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Run one job; FALSE with a reason in 'detail' if it failed
+static BOOL RunJob(const ControlJob* job, char* detail, size_t size) {
+    const ControlCommand* command = &job->command;
+    switch (command->type) {
+        case CONTROL_START:
+            return StartBuffer(detail, size);
+
+        case CONTROL_STOP:
+            if (!ReplayBuffer_Stop(&g_replayBuffer)) {
+                snprintf(detail, size, "buffer thread did not exit");
+                return FALSE;
+            }
+            return TRUE;
+
+        case CONTROL_RESTART:
+            // A second buffer thread would reset the globals a stuck one
+            // still uses: if it won't exit, leave it for the hang report
+            if (!ReplayBuffer_Stop(&g_replayBuffer)) {
+                snprintf(detail, size, "buffer thread did not exit, not restarting");
+                return FALSE;
+            }
+            return StartBuffer(detail, size);
+
+        case CONTROL_SAVE:
+            return RunSave(command, detail, size);
+
+        case CONTROL_RECONFIGURE: {
+            // The pipeline reads the settings when it starts, so a running
+            // buffer restarts (and loses its contents) to pick them up
+            BOOL wasBuffering = g_replayBuffer.isBuffering;
+            if (wasBuffering && !ReplayBuffer_Stop(&g_replayBuffer)) {
+                snprintf(detail, size, "buffer thread did not exit, settings not applied");
+                return FALSE;
+            }
+            ApplySettings(&command->settings);
+            return wasBuffering ? StartBuffer(detail, size) : TRUE;
+        }
+
+        default:
+            return TRUE;
+    }
+}
+
+// ============================================================================
+// Stall recovery
+// ============================================================================
+
+// Watchdog thread: queue a restart like any other job, so it runs in order
+// with saves instead of racing them
+static BOOL RecoverStall(const char* threadName, const char* stage, void* userData) {
+    (void)stage;
+    (void)userData;
+
+    // The frame hub is not restarted with the replay pipeline
+    if (!g_queue || !g_replayBuffer.isBuffering) return FALSE;
+    if (strcmp(threadName, "Frame hub") == 0 || strcmp(threadName, "Recorder") == 0) return FALSE;
+
+    ControlCommand restart;
+    memset(&restart, 0, sizeof(restart));
+    restart.type = CONTROL_RESTART;
+    return ControlQueue_Post(g_queue, &restart) != 0;
+}
+
+// ============================================================================
+// Main loop
+// ============================================================================
+
+int Headless_Run(void) {
+    g_queue = ControlQueue_Create();
+    if (!g_queue) return 1;
+
+    if (!ControlServer_Start(CONTROL_PIPE_NAME, g_queue)) {
+        HeadlessLog("Headless: control pipe failed to start\n");
+        ControlQueue_Destroy(g_queue);
+        g_queue = NULL;
+        return 1;
+    }
+
+    // Buffering is the point of the daemon, whatever the INI says
+    g_config.replayEnabled = TRUE;
+    ReplayBuffer_Start(&g_replayBuffer, &g_config);
+    CrashHandler_SetStallRecovery(RecoverStall, NULL);
+    HeadlessLog("Headless: running (buffering=%d)\n", g_replayBuffer.isBuffering);
+
+    BOOL quit = FALSE;
+    while (!quit) {
+        CrashHandler_Heartbeat();
+        ControlQueue_Wait(g_queue, HEADLESS_IDLE_MS);
+
+        ControlJob job;
+        while (!quit && ControlQueue_Take(g_queue, &job)) {
+            char detail[CONTROL_MAX_PATH] = "";
+            BOOL ok = TRUE;
+            if (job.command.type == CONTROL_QUIT) {
+                quit = TRUE;
+            } else {
+                ok = RunJob(&job, detail, sizeof(detail));
+            }
+            ControlQueue_Finish(g_queue, job.id, ok ? true : false, detail);
+            HeadlessLog("Headless: job %u %s %s%s%s\n", job.id, Control_CommandName(job.command.type),
+                        ok ? "done" : "failed", detail[0] ? ": " : "", detail);
+            CrashHandler_Heartbeat();
+        }
+    }
+
+    // No new jobs from here; the caller shuts the buffer down. The watchdog
+    // may be inside RecoverStall, so it stops before the queue goes away,
+    // and a server thread that won't exit keeps the queue (leaked).
+    CrashHandler_StopWatchdog();
+    CrashHandler_SetStallRecovery(NULL, NULL);
+    if (ControlServer_Stop()) {
+        ControlQueue_Destroy(g_queue);
+    }
+    g_queue = NULL;
+    return 0;
+}
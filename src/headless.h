@@ -0,0 +1,19 @@
+/*
+ * Headless - Replay buffer daemon driven over the control pipe
+ *
+ * With --headless, WinMain creates no windows: the replay buffer runs from
+ * the INI settings and is driven by jobs from CONTROL_PIPE_NAME (control.h).
+ * Jobs run one at a time on the calling thread, which also feeds the
+ * watchdog heartbeat. Settings changed by "reconfigure" last for the run and
+ * are never written back to the INI.
+ */
+
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <windows.h>
+
+// Run until a "quit" job; returns the process exit code
+int Headless_Run(void);
+
+#endif // HEADLESS_H
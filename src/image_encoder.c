@@ -0,0 +1,1145 @@
+/*
+ * Image Encoder Implementation
+ * QOI encoder, PNG filtering and a small multi-threaded deflate
+ *
+ * Deflate: greedy LZ77 (3-byte hash chains, 32K window) + dynamic Huffman
+ * blocks, falling back to stored blocks for incompressible data. Strips are
+ * compressed independently and terminated with an empty stored block (sync
+ * flush), so their outputs concatenate into one valid zlib stream. The
+ * Adler-32 of the whole stream is combined from per-strip checksums.
+ */
+
+#include "image_encoder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IMAGE_ENCODER_SSE2 1
+#endif
+
+// ============================================================================
+// Shared helpers
+// ============================================================================
+
+static void PutBE32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static int CpuCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+// ============================================================================
+// QOI
+// ============================================================================
+
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF  0x40
+#define QOI_OP_LUMA  0x80
+#define QOI_OP_RUN   0xc0
+#define QOI_OP_RGB   0xfe
+#define QOI_HEADER_SIZE 14
+
+bool ImageEncoder_EncodeQOI(const uint8_t* bgra, int width, int height, int pitch, EncodedImage* out) {
+    if (!bgra || !out || width <= 0 || height <= 0 || pitch < width * 4) return false;
+    out->data = NULL;
+    out->size = 0;
+
+    // Worst case: QOI_OP_RGB (4 bytes) for every pixel
+    size_t maxSize = (size_t)width * height * 4 + QOI_HEADER_SIZE + 8;
+    uint8_t* dst = (uint8_t*)malloc(maxSize);
+    if (!dst) return false;
+
+    memcpy(dst, "qoif", 4);
+    PutBE32(dst + 4, (uint32_t)width);
+    PutBE32(dst + 8, (uint32_t)height);
+    dst[12] = 3;    // RGB
+    dst[13] = 0;    // sRGB with linear alpha
+    size_t p = QOI_HEADER_SIZE;
+
+    // Pixels packed as 0xAARRGGBB-independent byte triples; alpha fixed at 255
+    uint8_t index[64][3];
+    memset(index, 0, sizeof(index));
+    uint8_t pr = 0, pg = 0, pb = 0;
+    int run = 0;
+
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = bgra + (size_t)y * pitch;
+        for (int x = 0; x < width; x++) {
+            uint8_t b = row[x * 4 + 0];
+            uint8_t g = row[x * 4 + 1];
+            uint8_t r = row[x * 4 + 2];
+
+            if (r == pr && g == pg && b == pb) {
+                if (++run == 62) {
+                    dst[p++] = (uint8_t)(QOI_OP_RUN | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+
+            if (run > 0) {
+                dst[p++] = (uint8_t)(QOI_OP_RUN | (run - 1));
+                run = 0;
+            }
+
+            int h = (r * 3 + g * 5 + b * 7 + 255 * 11) & 63;
+            if (index[h][0] == r && index[h][1] == g && index[h][2] == b) {
+                dst[p++] = (uint8_t)(QOI_OP_INDEX | h);
+            } else {
+                index[h][0] = r;
+                index[h][1] = g;
+                index[h][2] = b;
+
+                signed char vr = (signed char)(r - pr);
+                signed char vg = (signed char)(g - pg);
+                signed char vb = (signed char)(b - pb);
+                signed char vgr = (signed char)(vr - vg);
+                signed char vgb = (signed char)(vb - vg);
+
+                if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                    dst[p++] = (uint8_t)(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+                } else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8) {
+                    dst[p++] = (uint8_t)(QOI_OP_LUMA | (vg + 32));
+                    dst[p++] = (uint8_t)((vgr + 8) << 4 | (vgb + 8));
+                } else {
+                    dst[p++] = QOI_OP_RGB;
+                    dst[p++] = r;
+                    dst[p++] = g;
+                    dst[p++] = b;
+                }
+            }
+
+            pr = r;
+            pg = g;
+            pb = b;
+        }
+    }
+
+    if (run > 0) {
+        dst[p++] = (uint8_t)(QOI_OP_RUN | (run - 1));
+    }
+
+    // End marker
+    static const uint8_t padding[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    memcpy(dst + p, padding, sizeof(padding));
+    p += sizeof(padding);
+
+    out->data = dst;
+    out->size = p;
+    return true;
+}
+
+// ============================================================================
+// Checksums
+// ============================================================================
+
+static uint32_t g_crcTable[8][256];
+static volatile int g_crcReady = 0;
+
+static void InitCrcTable(void) {
+    if (g_crcReady) return;
+    for (uint32_t n = 0; n < 256; n++) {
+        uint32_t c = n;
+        for (int k = 0; k < 8; k++) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        g_crcTable[0][n] = c;
+    }
+    for (uint32_t n = 0; n < 256; n++) {
+        for (int t = 1; t < 8; t++) {
+            g_crcTable[t][n] = (g_crcTable[t - 1][n] >> 8) ^ g_crcTable[0][g_crcTable[t - 1][n] & 0xFF];
+        }
+    }
+    g_crcReady = 1;
+}
+
+// Slice-by-8 CRC-32 (PNG chunk CRC)
+static uint32_t Crc32Update(uint32_t crc, const uint8_t* data, size_t len) {
+    crc = ~crc;
+    while (len >= 8) {
+        uint32_t lo = crc ^ ((uint32_t)data[0] | (uint32_t)data[1] << 8 |
+                             (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24);
+        crc = g_crcTable[7][lo & 0xFF] ^ g_crcTable[6][(lo >> 8) & 0xFF] ^
+              g_crcTable[5][(lo >> 16) & 0xFF] ^ g_crcTable[4][lo >> 24] ^
+              g_crcTable[3][data[4]] ^ g_crcTable[2][data[5]] ^
+              g_crcTable[1][data[6]] ^ g_crcTable[0][data[7]];
+        data += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = g_crcTable[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+#define ADLER_BASE 65521u
+#define ADLER_NMAX 5552
+
+static uint32_t Adler32Update(uint32_t adler, const uint8_t* data, size_t len) {
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+    while (len > 0) {
+        size_t n = len < ADLER_NMAX ? len : ADLER_NMAX;
+        len -= n;
+        while (n--) {
+            a += *data++;
+            b += a;
+        }
+        a %= ADLER_BASE;
+        b %= ADLER_BASE;
+    }
+    return (b << 16) | a;
+}
+
+// Adler-32 of A||B from adler(A), adler(B) and len(B)
+static uint32_t Adler32Combine(uint32_t adler1, uint32_t adler2, size_t len2) {
+    uint32_t rem = (uint32_t)(len2 % ADLER_BASE);
+    uint32_t sum1 = adler1 & 0xFFFF;
+    uint32_t sum2 = (uint32_t)(((uint64_t)rem * sum1) % ADLER_BASE);
+    sum1 += (adler2 & 0xFFFF) + ADLER_BASE - 1;
+    sum2 += (adler1 >> 16) + (adler2 >> 16) + ADLER_BASE - rem;
+    if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+    if (sum1 >= ADLER_BASE) sum1 -= ADLER_BASE;
+    if (sum2 >= (ADLER_BASE << 1)) sum2 -= (ADLER_BASE << 1);
+    if (sum2 >= ADLER_BASE) sum2 -= ADLER_BASE;
+    return sum1 | (sum2 << 16);
+}
+
+// ============================================================================
+// Deflate
+// ============================================================================
+
+#define DEFL_WINDOW       32768
+#define DEFL_WINDOW_MASK  (DEFL_WINDOW - 1)
+#define DEFL_HASH_BITS    15
+#define DEFL_HASH_SIZE    (1 << DEFL_HASH_BITS)
+#define DEFL_MIN_MATCH    3
+#define DEFL_MAX_MATCH    258
+#define DEFL_MAX_CHAIN    16
+#define DEFL_NICE_MATCH   128
+#define DEFL_BLOCK_TOKENS 32768
+
+#define DEFL_NUM_LITLEN   288
+#define DEFL_NUM_DIST     30
+#define DEFL_NUM_CLEN     19
+
+static const uint16_t s_lenBase[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const uint8_t s_lenExtra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const uint16_t s_distBase[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const uint8_t s_distExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+static const uint8_t s_clenOrder[DEFL_NUM_CLEN] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+// Length (3..258) → code index 0..28; distance → code 0..29
+static uint8_t s_lenCode[DEFL_MAX_MATCH + 1];
+static uint8_t s_distCodeLo[512];     // (dist-1) < 512
+static uint8_t s_distCodeHi[256];     // (dist-1) >> 7
+static volatile int s_deflateTablesReady = 0;
+
+static void InitDeflateTables(void) {
+    if (s_deflateTablesReady) return;
+    for (int code = 0; code < 29; code++) {
+        int count = 1 << s_lenExtra[code];
+        for (int i = 0; i < count && s_lenBase[code] + i <= DEFL_MAX_MATCH; i++) {
+            s_lenCode[s_lenBase[code] + i] = (uint8_t)code;
+        }
+    }
+    s_lenCode[258] = 28;
+    for (int code = 0; code < 30; code++) {
+        int count = 1 << s_distExtra[code];
+        for (int i = 0; i < count; i++) {
+            int d = s_distBase[code] + i - 1;
+            if (d < 512) s_distCodeLo[d] = (uint8_t)code;
+            if ((d >> 7) < 256) s_distCodeHi[d >> 7] = (uint8_t)code;
+        }
+    }
+    s_deflateTablesReady = 1;
+}
+
+static int DistCode(int dist) {
+    int d = dist - 1;
+    return d < 512 ? s_distCodeLo[d] : s_distCodeHi[d >> 7];
+}
+
+typedef struct {
+    uint16_t litlen;    // Literal byte, or match length
+    uint16_t dist;      // 0 for literal
+} DeflateToken;
+
+typedef struct {
+    uint8_t* out;
+    size_t pos;
+    size_t cap;
+    uint64_t bits;
+    int count;
+    bool failed;
+} BitWriter;
+
+static bool BitWriter_Reserve(BitWriter* bw, size_t bytes) {
+    if (bw->pos + bytes + 16 <= bw->cap) return true;
+    size_t newCap = bw->cap * 2;
+    if (newCap < bw->pos + bytes + 16) newCap = bw->pos + bytes + 16;
+    uint8_t* p = (uint8_t*)realloc(bw->out, newCap);
+    if (!p) {
+        bw->failed = true;
+        return false;
+    }
+    bw->out = p;
+    bw->cap = newCap;
+    return true;
+}
+
+static inline void BitWriter_Put(BitWriter* bw, uint32_t value, int n) {
+    bw->bits |= (uint64_t)value << bw->count;
+    bw->count += n;
+    if (bw->count >= 32) {
+        uint32_t w = (uint32_t)bw->bits;
+        bw->out[bw->pos + 0] = (uint8_t)w;
+        bw->out[bw->pos + 1] = (uint8_t)(w >> 8);
+        bw->out[bw->pos + 2] = (uint8_t)(w >> 16);
+        bw->out[bw->pos + 3] = (uint8_t)(w >> 24);
+        bw->pos += 4;
+        bw->bits >>= 32;
+        bw->count -= 32;
+    }
+}
+
+static void BitWriter_AlignByte(BitWriter* bw) {
+    while (bw->count > 0) {
+        bw->out[bw->pos++] = (uint8_t)bw->bits;
+        bw->bits >>= 8;
+        bw->count = bw->count > 8 ? bw->count - 8 : 0;
+    }
+    bw->bits = 0;
+}
+
+static uint32_t ReverseBits(uint32_t code, int len) {
+    uint32_t r = 0;
+    for (int i = 0; i < len; i++) {
+        r = (r << 1) | (code & 1);
+        code >>= 1;
+    }
+    return r;
+}
+
+typedef struct {
+    uint32_t freq;
+    uint16_t sym;
+} SymFreq;
+
+static int CompareSymFreq(const void* a, const void* b) {
+    const SymFreq* x = (const SymFreq*)a;
+    const SymFreq* y = (const SymFreq*)b;
+    if (x->freq != y->freq) return x->freq < y->freq ? -1 : 1;
+    return (int)x->sym - (int)y->sym;
+}
+
+// Length-limited Huffman code lengths (two-queue Huffman + Kraft fix-up)
+static void BuildCodeLengths(const uint32_t* freq, int n, int maxLen, uint8_t* lens) {
+    SymFreq items[DEFL_NUM_LITLEN];
+    int count = 0;
+
+    memset(lens, 0, (size_t)n);
+    for (int i = 0; i < n; i++) {
+        if (freq[i]) {
+            items[count].freq = freq[i];
+            items[count].sym = (uint16_t)i;
+            count++;
+        }
+    }
+    if (count == 0) return;
+    if (count == 1) {
+        // Pad with a dummy symbol so the code is complete (inflate rejects
+        // incomplete code-length codes)
+        lens[items[0].sym] = 1;
+        lens[items[0].sym == 0 ? 1 : 0] = 1;
+        return;
+    }
+
+    qsort(items, (size_t)count, sizeof(SymFreq), CompareSymFreq);
+
+    // Leaves are 0..count-1 (ascending weight), internal nodes follow
+    uint32_t weight[2 * DEFL_NUM_LITLEN];
+    int parent[2 * DEFL_NUM_LITLEN];
+    for (int i = 0; i < count; i++) weight[i] = items[i].freq;
+
+    int leaf = 0;
+    int node = count;
+    for (int next = count; next < 2 * count - 1; next++) {
+        int pick[2];
+        for (int k = 0; k < 2; k++) {
+            if (leaf < count && (node >= next || weight[leaf] <= weight[node])) {
+                pick[k] = leaf++;
+            } else {
+                pick[k] = node++;
+            }
+        }
+        weight[next] = weight[pick[0]] + weight[pick[1]];
+        parent[pick[0]] = next;
+        parent[pick[1]] = next;
+    }
+
+    // Depths top-down (root is the last node)
+    int depth[2 * DEFL_NUM_LITLEN];
+    int root = 2 * count - 2;
+    depth[root] = 0;
+    for (int i = root - 1; i >= 0; i--) {
+        depth[i] = depth[parent[i]] + 1;
+    }
+
+    // Clamp to maxLen, then restore Kraft equality
+    int numCodes[32] = {0};
+    for (int i = 0; i < count; i++) {
+        int d = depth[i] > maxLen ? maxLen : depth[i];
+        numCodes[d]++;
+    }
+    uint32_t total = 0;
+    for (int i = 1; i <= maxLen; i++) {
+        total += (uint32_t)numCodes[i] << (maxLen - i);
+    }
+    while (total != (1u << maxLen)) {
+        numCodes[maxLen]--;
+        for (int i = maxLen - 1; i > 0; i--) {
+            if (numCodes[i]) {
+                numCodes[i]--;
+                numCodes[i + 1] += 2;
+                break;
+            }
+        }
+        total--;
+    }
+
+    // Longest codes to least frequent symbols
+    int idx = 0;
+    for (int len = maxLen; len > 0; len--) {
+        for (int k = numCodes[len]; k > 0; k--) {
+            lens[items[idx++].sym] = (uint8_t)len;
+        }
+    }
+}
+
+// Canonical codes, bit-reversed for LSB-first output
+static void BuildCodes(const uint8_t* lens, int n, uint16_t* codes) {
+    int blCount[16] = {0};
+    int nextCode[16];
+    for (int i = 0; i < n; i++) blCount[lens[i]]++;
+    blCount[0] = 0;
+    int code = 0;
+    for (int bits = 1; bits < 16; bits++) {
+        code = (code + blCount[bits - 1]) << 1;
+        nextCode[bits] = code;
+    }
+    for (int i = 0; i < n; i++) {
+        int len = lens[i];
+        codes[i] = len ? (uint16_t)ReverseBits((uint32_t)nextCode[len]++, len) : 0;
+    }
+}
+
+typedef struct {
+    const uint8_t* data;    // Strip input
+    size_t size;
+    int32_t* head;          // Hash heads (position or -1)
+    int32_t* prev;          // Chain links, indexed by position & window mask
+    DeflateToken* tokens;
+    BitWriter bw;
+} DeflateState;
+
+// Write tokens [0, tokenCount) covering input [blockStart, blockEnd)
+static void WriteBlock(DeflateState* ds, int tokenCount, size_t blockStart, size_t blockEnd, bool final) {
+    BitWriter* bw = &ds->bw;
+    uint32_t litFreq[DEFL_NUM_LITLEN] = {0};
+    uint32_t distFreq[DEFL_NUM_DIST] = {0};
+
+    for (int i = 0; i < tokenCount; i++) {
+        const DeflateToken* t = &ds->tokens[i];
+        if (t->dist == 0) {
+            litFreq[t->litlen]++;
+        } else {
+            litFreq[257 + s_lenCode[t->litlen]]++;
+            distFreq[DistCode(t->dist)]++;
+        }
+    }
+    litFreq[256] = 1;
+
+    uint8_t litLens[DEFL_NUM_LITLEN];
+    uint8_t distLens[DEFL_NUM_DIST];
+    BuildCodeLengths(litFreq, DEFL_NUM_LITLEN, 15, litLens);
+    BuildCodeLengths(distFreq, DEFL_NUM_DIST, 15, distLens);
+
+    int hlit = 286;
+    while (hlit > 257 && litLens[hlit - 1] == 0) hlit--;
+    int hdist = 30;
+    while (hdist > 1 && distLens[hdist - 1] == 0) hdist--;
+    if (distLens[0] == 0 && hdist == 1) distLens[0] = 1;  // Need at least one distance code
+
+    // Run-length encode the code lengths
+    uint8_t allLens[DEFL_NUM_LITLEN + DEFL_NUM_DIST];
+    memcpy(allLens, litLens, (size_t)hlit);
+    memcpy(allLens + hlit, distLens, (size_t)hdist);
+    int totalLens = hlit + hdist;
+
+    uint8_t rleSym[DEFL_NUM_LITLEN + DEFL_NUM_DIST];
+    uint8_t rleExtra[DEFL_NUM_LITLEN + DEFL_NUM_DIST];
+    int rleCount = 0;
+    uint32_t clenFreq[DEFL_NUM_CLEN] = {0};
+
+    for (int i = 0; i < totalLens;) {
+        uint8_t len = allLens[i];
+        int run = 1;
+        while (i + run < totalLens && allLens[i + run] == len) run++;
+
+        if (len == 0 && run >= 3) {
+            int r = run > 138 ? 138 : run;
+            if (r >= 11) {
+                rleSym[rleCount] = 18;
+                rleExtra[rleCount++] = (uint8_t)(r - 11);
+            } else {
+                rleSym[rleCount] = 17;
+                rleExtra[rleCount++] = (uint8_t)(r - 3);
+            }
+            clenFreq[rleSym[rleCount - 1]]++;
+            i += r;
+        } else if (len != 0 && run >= 4) {
+            rleSym[rleCount] = len;
+            rleExtra[rleCount++] = 0;
+            clenFreq[len]++;
+            int r = run - 1 > 6 ? 6 : run - 1;
+            rleSym[rleCount] = 16;
+            rleExtra[rleCount++] = (uint8_t)(r - 3);
+            clenFreq[16]++;
+            i += 1 + r;
+        } else {
+            rleSym[rleCount] = len;
+            rleExtra[rleCount++] = 0;
+            clenFreq[len]++;
+            i++;
+        }
+    }
+
+    uint8_t clenLens[DEFL_NUM_CLEN];
+    uint16_t clenCodes[DEFL_NUM_CLEN];
+    BuildCodeLengths(clenFreq, DEFL_NUM_CLEN, 7, clenLens);
+    BuildCodes(clenLens, DEFL_NUM_CLEN, clenCodes);
+
+    int hclen = DEFL_NUM_CLEN;
+    while (hclen > 4 && clenLens[s_clenOrder[hclen - 1]] == 0) hclen--;
+
+    // Cost of the dynamic block vs. stored
+    uint64_t dynBits = 3 + 5 + 5 + 4 + (uint64_t)hclen * 3;
+    for (int i = 0; i < rleCount; i++) {
+        dynBits += clenLens[rleSym[i]];
+        dynBits += rleSym[i] == 16 ? 2 : rleSym[i] == 17 ? 3 : rleSym[i] == 18 ? 7 : 0;
+    }
+    for (int i = 0; i < DEFL_NUM_LITLEN; i++) {
+        dynBits += (uint64_t)litFreq[i] * litLens[i];
+        if (i >= 257 && i < 257 + 29) dynBits += (uint64_t)litFreq[i] * s_lenExtra[i - 257];
+    }
+    for (int i = 0; i < DEFL_NUM_DIST; i++) {
+        dynBits += (uint64_t)distFreq[i] * (distLens[i] + s_distExtra[i]);
+    }
+    size_t rawLen = blockEnd - blockStart;
+    uint64_t storedBits = ((uint64_t)rawLen + 5 * (rawLen / 65535 + 1)) * 8 + 8;
+
+    if (!BitWriter_Reserve(bw, (size_t)((dynBits < storedBits ? dynBits : storedBits) / 8) + 64)) return;
+
+    if (storedBits <= dynBits) {
+        // Incompressible: stored blocks of up to 65535 bytes
+        size_t pos = blockStart;
+        do {
+            size_t n = blockEnd - pos;
+            if (n > 65535) n = 65535;
+            bool last = final && pos + n == blockEnd;
+            BitWriter_Put(bw, last ? 1 : 0, 1);
+            BitWriter_Put(bw, 0, 2);
+            BitWriter_AlignByte(bw);
+            bw->out[bw->pos++] = (uint8_t)n;
+            bw->out[bw->pos++] = (uint8_t)(n >> 8);
+            bw->out[bw->pos++] = (uint8_t)~n;
+            bw->out[bw->pos++] = (uint8_t)(~n >> 8);
+            memcpy(bw->out + bw->pos, ds->data + pos, n);
+            bw->pos += n;
+            pos += n;
+        } while (pos < blockEnd);
+        return;
+    }
+
+    uint16_t litCodes[DEFL_NUM_LITLEN];
+    uint16_t distCodes[DEFL_NUM_DIST];
+    BuildCodes(litLens, DEFL_NUM_LITLEN, litCodes);
+    BuildCodes(distLens, DEFL_NUM_DIST, distCodes);
+
+    BitWriter_Put(bw, final ? 1 : 0, 1);
+    BitWriter_Put(bw, 2, 2);    // Dynamic Huffman
+    BitWriter_Put(bw, (uint32_t)(hlit - 257), 5);
+    BitWriter_Put(bw, (uint32_t)(hdist - 1), 5);
+    BitWriter_Put(bw, (uint32_t)(hclen - 4), 4);
+    for (int i = 0; i < hclen; i++) {
+        BitWriter_Put(bw, clenLens[s_clenOrder[i]], 3);
+    }
+    for (int i = 0; i < rleCount; i++) {
+        int sym = rleSym[i];
+        BitWriter_Put(bw, clenCodes[sym], clenLens[sym]);
+        if (sym == 16) BitWriter_Put(bw, rleExtra[i], 2);
+        else if (sym == 17) BitWriter_Put(bw, rleExtra[i], 3);
+        else if (sym == 18) BitWriter_Put(bw, rleExtra[i], 7);
+    }
+
+    for (int i = 0; i < tokenCount; i++) {
+        const DeflateToken* t = &ds->tokens[i];
+        if (t->dist == 0) {
+            BitWriter_Put(bw, litCodes[t->litlen], litLens[t->litlen]);
+        } else {
+            int lc = s_lenCode[t->litlen];
+            BitWriter_Put(bw, litCodes[257 + lc], litLens[257 + lc]);
+            if (s_lenExtra[lc]) BitWriter_Put(bw, (uint32_t)(t->litlen - s_lenBase[lc]), s_lenExtra[lc]);
+            int dc = DistCode(t->dist);
+            BitWriter_Put(bw, distCodes[dc], distLens[dc]);
+            if (s_distExtra[dc]) BitWriter_Put(bw, (uint32_t)(t->dist - s_distBase[dc]), s_distExtra[dc]);
+        }
+    }
+    BitWriter_Put(bw, litCodes[256], litLens[256]);
+}
+
+static inline uint32_t Hash3(const uint8_t* p) {
+    uint32_t v = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16;
+    return (v * 2654435761u) >> (32 - DEFL_HASH_BITS);
+}
+
+static inline int MatchLength(const uint8_t* a, const uint8_t* b, int maxLen) {
+    int len = 0;
+    while (len + 8 <= maxLen) {
+        uint64_t x, y;
+        memcpy(&x, a + len, 8);
+        memcpy(&y, b + len, 8);
+        uint64_t diff = x ^ y;
+        if (diff) {
+#if defined(_MSC_VER)
+            unsigned long bit;
+            _BitScanForward64(&bit, diff);
+            return len + (int)(bit >> 3);
+#else
+            return len + (__builtin_ctzll(diff) >> 3);
+#endif
+        }
+        len += 8;
+    }
+    while (len < maxLen && a[len] == b[len]) len++;
+    return len;
+}
+
+static inline void InsertHash(DeflateState* ds, size_t pos) {
+    uint32_t h = Hash3(ds->data + pos);
+    ds->prev[pos & DEFL_WINDOW_MASK] = ds->head[h];
+    ds->head[h] = (int32_t)pos;
+}
+
+// Compress one strip. Non-final strips end with an empty stored block so the
+// output is byte-aligned and can be concatenated with the next strip.
+static bool DeflateStrip(DeflateState* ds, bool final) {
+    const uint8_t* data = ds->data;
+    size_t size = ds->size;
+    for (int i = 0; i < DEFL_HASH_SIZE; i++) ds->head[i] = -1;
+
+    size_t pos = 0;
+    size_t blockStart = 0;
+    int tokenCount = 0;
+
+    while (pos < size) {
+        int bestLen = 0;
+        int bestDist = 0;
+
+        if (pos + DEFL_MIN_MATCH <= size) {
+            int maxLen = (int)(size - pos < DEFL_MAX_MATCH ? size - pos : DEFL_MAX_MATCH);
+            uint32_t h = Hash3(data + pos);
+            int32_t cand = ds->head[h];
+            int chain = DEFL_MAX_CHAIN;
+
+            while (cand >= 0 && chain-- > 0) {
+                size_t dist = pos - (size_t)cand;
+                if (dist > DEFL_WINDOW - 1) break;
+                if (data[cand + bestLen] == data[pos + bestLen]) {
+                    int len = MatchLength(data + cand, data + pos, maxLen);
+                    if (len > bestLen) {
+                        bestLen = len;
+                        bestDist = (int)dist;
+                        if (len >= DEFL_NICE_MATCH || len == maxLen) break;
+                    }
+                }
+                int32_t next = ds->prev[cand & DEFL_WINDOW_MASK];
+                if (next >= cand) break;  // Stale link from an overwritten slot
+                cand = next;
+            }
+
+            ds->prev[pos & DEFL_WINDOW_MASK] = ds->head[h];
+            ds->head[h] = (int32_t)pos;
+        }
+
+        if (bestLen >= DEFL_MIN_MATCH) {
+            ds->tokens[tokenCount].litlen = (uint16_t)bestLen;
+            ds->tokens[tokenCount].dist = (uint16_t)bestDist;
+            tokenCount++;
+            size_t end = pos + (size_t)bestLen;
+            // Index the matched bytes (skip the tail of very long runs)
+            size_t insertEnd = end + DEFL_MIN_MATCH <= size ? end : size - DEFL_MIN_MATCH + 1;
+            size_t limit = pos + 1 + 32;
+            for (size_t p = pos + 1; p < insertEnd && p < limit; p++) InsertHash(ds, p);
+            pos = end;
+        } else {
+            ds->tokens[tokenCount].litlen = data[pos];
+            ds->tokens[tokenCount].dist = 0;
+            tokenCount++;
+            pos++;
+        }
+
+        if (tokenCount == DEFL_BLOCK_TOKENS) {
+            WriteBlock(ds, tokenCount, blockStart, pos, final && pos == size);
+            if (ds->bw.failed) return false;
+            tokenCount = 0;
+            blockStart = pos;
+        }
+    }
+
+    if (tokenCount > 0 || blockStart == 0) {
+        WriteBlock(ds, tokenCount, blockStart, pos, final);
+        if (ds->bw.failed) return false;
+    }
+
+    if (!BitWriter_Reserve(&ds->bw, 16)) return false;
+    if (!final) {
+        // Sync flush: empty stored block
+        BitWriter_Put(&ds->bw, 0, 3);
+        BitWriter_AlignByte(&ds->bw);
+        ds->bw.out[ds->bw.pos++] = 0x00;
+        ds->bw.out[ds->bw.pos++] = 0x00;
+        ds->bw.out[ds->bw.pos++] = 0xFF;
+        ds->bw.out[ds->bw.pos++] = 0xFF;
+    } else {
+        BitWriter_AlignByte(&ds->bw);
+    }
+    return true;
+}
+
+// ============================================================================
+// PNG filtering
+// ============================================================================
+
+// BGRA row → RGB (dst has 16 bytes of zero padding before it for the Sub/Paeth left neighbor)
+static void BGRAToRGBRow(const uint8_t* src, uint8_t* dst, int width) {
+    for (int x = 0; x < width; x++) {
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = src[0];
+        src += 4;
+        dst += 3;
+    }
+}
+
+static inline uint8_t Paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return (uint8_t)a;
+    if (pb <= pc) return (uint8_t)b;
+    return (uint8_t)c;
+}
+
+static inline uint32_t SignedAbs(uint8_t v) {
+    return v < 128 ? v : 256u - v;
+}
+
+// Compute Sub/Up/Paeth for one row; write the cheapest (by sum of |signed|) to out
+// with its filter byte. cur/prev point at RGB rows with 3 zero bytes before them.
+static void FilterRow(const uint8_t* cur, const uint8_t* prev, int rowBytes,
+                      uint8_t* sub, uint8_t* up, uint8_t* paeth, uint8_t* out) {
+    uint32_t sumNone = 0, sumSub = 0, sumUp = 0, sumPaeth = 0;
+    int i = 0;
+
+#ifdef IMAGE_ENCODER_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    __m128i accNone = zero, accSub = zero, accUp = zero, accPaeth = zero;
+
+    for (; i + 16 <= rowBytes; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(cur + i));
+        __m128i a = _mm_loadu_si128((const __m128i*)(cur + i - 3));
+        __m128i b = _mm_loadu_si128((const __m128i*)(prev + i));
+        __m128i c = _mm_loadu_si128((const __m128i*)(prev + i - 3));
+
+        __m128i fSub = _mm_sub_epi8(x, a);
+        __m128i fUp = _mm_sub_epi8(x, b);
+
+        // Paeth predictor in 16-bit lanes
+        __m128i pred[2];
+        for (int half = 0; half < 2; half++) {
+            __m128i a16 = half ? _mm_unpackhi_epi8(a, zero) : _mm_unpacklo_epi8(a, zero);
+            __m128i b16 = half ? _mm_unpackhi_epi8(b, zero) : _mm_unpacklo_epi8(b, zero);
+            __m128i c16 = half ? _mm_unpackhi_epi8(c, zero) : _mm_unpacklo_epi8(c, zero);
+            __m128i pa = _mm_sub_epi16(b16, c16);           // p - a
+            __m128i pb = _mm_sub_epi16(a16, c16);           // p - b
+            __m128i pc = _mm_add_epi16(pa, pb);             // p - c
+            pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+            pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+            pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+            // useA = pa <= pb && pa <= pc ; useB = !useA && pb <= pc
+            __m128i notA = _mm_or_si128(_mm_cmpgt_epi16(pa, pb), _mm_cmpgt_epi16(pa, pc));
+            __m128i useC = _mm_and_si128(notA, _mm_cmpgt_epi16(pb, pc));
+            __m128i useB = _mm_andnot_si128(useC, notA);
+            __m128i r = _mm_andnot_si128(notA, a16);
+            r = _mm_or_si128(r, _mm_and_si128(useB, b16));
+            r = _mm_or_si128(r, _mm_and_si128(useC, c16));
+            pred[half] = r;
+        }
+        __m128i fPaeth = _mm_sub_epi8(x, _mm_packus_epi16(pred[0], pred[1]));
+
+        _mm_storeu_si128((__m128i*)(sub + i), fSub);
+        _mm_storeu_si128((__m128i*)(up + i), fUp);
+        _mm_storeu_si128((__m128i*)(paeth + i), fPaeth);
+
+        // |signed byte| = min(v, -v) as unsigned; SAD sums it
+        accNone = _mm_add_epi64(accNone, _mm_sad_epu8(_mm_min_epu8(x, _mm_sub_epi8(zero, x)), zero));
+        accSub = _mm_add_epi64(accSub, _mm_sad_epu8(_mm_min_epu8(fSub, _mm_sub_epi8(zero, fSub)), zero));
+        accUp = _mm_add_epi64(accUp, _mm_sad_epu8(_mm_min_epu8(fUp, _mm_sub_epi8(zero, fUp)), zero));
+        accPaeth = _mm_add_epi64(accPaeth, _mm_sad_epu8(_mm_min_epu8(fPaeth, _mm_sub_epi8(zero, fPaeth)), zero));
+    }
+
+    sumNone = (uint32_t)(_mm_cvtsi128_si32(accNone) + _mm_cvtsi128_si32(_mm_srli_si128(accNone, 8)));
+    sumSub = (uint32_t)(_mm_cvtsi128_si32(accSub) + _mm_cvtsi128_si32(_mm_srli_si128(accSub, 8)));
+    sumUp = (uint32_t)(_mm_cvtsi128_si32(accUp) + _mm_cvtsi128_si32(_mm_srli_si128(accUp, 8)));
+    sumPaeth = (uint32_t)(_mm_cvtsi128_si32(accPaeth) + _mm_cvtsi128_si32(_mm_srli_si128(accPaeth, 8)));
+#endif
+
+    for (; i < rowBytes; i++) {
+        uint8_t x = cur[i];
+        uint8_t a = cur[i - 3];
+        uint8_t b = prev[i];
+        uint8_t c = prev[i - 3];
+        sub[i] = (uint8_t)(x - a);
+        up[i] = (uint8_t)(x - b);
+        paeth[i] = (uint8_t)(x - Paeth(a, b, c));
+        sumNone += SignedAbs(x);
+        sumSub += SignedAbs(sub[i]);
+        sumUp += SignedAbs(up[i]);
+        sumPaeth += SignedAbs(paeth[i]);
+    }
+
+    const uint8_t* best = cur;
+    uint8_t filter = 0;
+    uint32_t bestSum = sumNone;
+    if (sumSub < bestSum) { best = sub; filter = 1; bestSum = sumSub; }
+    if (sumUp < bestSum) { best = up; filter = 2; bestSum = sumUp; }
+    if (sumPaeth < bestSum) { best = paeth; filter = 4; }
+
+    out[0] = filter;
+    memcpy(out + 1, best, (size_t)rowBytes);
+}
+
+// ============================================================================
+// PNG (parallel strips)
+// ============================================================================
+
+typedef struct {
+    int firstRow;
+    int rowCount;
+    uint8_t* output;        // IDAT chunk (length + "IDAT" + deflate + CRC)
+    size_t outputSize;
+    uint32_t adler;         // Adler-32 of this strip's filtered bytes
+    size_t filteredSize;
+    bool ok;
+} PngStrip;
+
+typedef struct {
+    const uint8_t* bgra;
+    int width;
+    int height;
+    int pitch;
+    PngStrip* strips;
+    int stripCount;
+#ifdef _WIN32
+    volatile LONG nextStrip;
+#else
+    int nextStrip;
+#endif
+} PngJob;
+
+static int NextStrip(PngJob* job) {
+#ifdef _WIN32
+    return (int)InterlockedIncrement(&job->nextStrip) - 1;
+#else
+    return __atomic_fetch_add(&job->nextStrip, 1, __ATOMIC_RELAXED);
+#endif
+}
+
+static void EncodeStrip(PngJob* job, PngStrip* strip, bool final) {
+    int rowBytes = job->width * 3;
+    size_t filteredSize = (size_t)strip->rowCount * (rowBytes + 1);
+    size_t rowAlloc = (size_t)rowBytes + 32;
+
+    // Scratch: two padded raw rows, three candidate rows, filtered strip
+    uint8_t* scratch = (uint8_t*)calloc(5, rowAlloc);
+    uint8_t* filtered = (uint8_t*)malloc(filteredSize);
+    DeflateState ds;
+    memset(&ds, 0, sizeof(ds));
+    ds.head = (int32_t*)malloc(sizeof(int32_t) * DEFL_HASH_SIZE);
+    ds.prev = (int32_t*)malloc(sizeof(int32_t) * DEFL_WINDOW);
+    ds.tokens = (DeflateToken*)malloc(sizeof(DeflateToken) * DEFL_BLOCK_TOKENS);
+    ds.bw.cap = filteredSize / 2 + 1024;
+    ds.bw.out = (uint8_t*)malloc(ds.bw.cap);
+
+    if (!scratch || !filtered || !ds.head || !ds.prev || !ds.tokens || !ds.bw.out) goto done;
+
+    uint8_t* rawA = scratch + 16;
+    uint8_t* rawB = scratch + rowAlloc + 16;
+    uint8_t* candSub = scratch + rowAlloc * 2;
+    uint8_t* candUp = scratch + rowAlloc * 3;
+    uint8_t* candPaeth = scratch + rowAlloc * 4;
+
+    // Row above the strip (zeros for the first image row)
+    uint8_t* prevRow = rawA;
+    uint8_t* curRow = rawB;
+    if (strip->firstRow > 0) {
+        BGRAToRGBRow(job->bgra + (size_t)(strip->firstRow - 1) * job->pitch, prevRow, job->width);
+    }
+
+    for (int r = 0; r < strip->rowCount; r++) {
+        int y = strip->firstRow + r;
+        BGRAToRGBRow(job->bgra + (size_t)y * job->pitch, curRow, job->width);
+        FilterRow(curRow, prevRow, rowBytes, candSub, candUp, candPaeth,
+                  filtered + (size_t)r * (rowBytes + 1));
+        uint8_t* t = prevRow;
+        prevRow = curRow;
+        curRow = t;
+    }
+
+    strip->adler = Adler32Update(1, filtered, filteredSize);
+    strip->filteredSize = filteredSize;
+
+    // Reserve the chunk header in front of the deflate data
+    ds.bw.pos = 8;
+    ds.data = filtered;
+    ds.size = filteredSize;
+    if (!DeflateStrip(&ds, final)) goto done;
+
+    size_t dataLen = ds.bw.pos - 8;
+    if (!BitWriter_Reserve(&ds.bw, 4)) goto done;
+    PutBE32(ds.bw.out, (uint32_t)dataLen);
+    memcpy(ds.bw.out + 4, "IDAT", 4);
+    PutBE32(ds.bw.out + 8 + dataLen, Crc32Update(0, ds.bw.out + 4, dataLen + 4));
+
+    strip->output = ds.bw.out;
+    strip->outputSize = dataLen + 12;
+    ds.bw.out = NULL;
+    strip->ok = true;
+
+done:
+    free(scratch);
+    free(filtered);
+    free(ds.head);
+    free(ds.prev);
+    free(ds.tokens);
+    free(ds.bw.out);
+}
+
+#ifdef _WIN32
+static unsigned __stdcall PngWorker(void* param) {
+#else
+static void* PngWorker(void* param) {
+#endif
+    PngJob* job = (PngJob*)param;
+    int idx;
+    while ((idx = NextStrip(job)) < job->stripCount) {
+        EncodeStrip(job, &job->strips[idx], idx == job->stripCount - 1);
+    }
+    return 0;
+}
+
+static void AppendChunk(uint8_t* dst, size_t* pos, const char* type, const uint8_t* data, uint32_t len) {
+    PutBE32(dst + *pos, len);
+    memcpy(dst + *pos + 4, type, 4);
+    if (len) memcpy(dst + *pos + 8, data, len);
+    PutBE32(dst + *pos + 8 + len, Crc32Update(0, dst + *pos + 4, (size_t)len + 4));
+    *pos += 12 + len;
+}
+
+bool ImageEncoder_EncodePNG(const uint8_t* bgra, int width, int height, int pitch, int threads, EncodedImage* out) {
+    if (!bgra || !out || width <= 0 || height <= 0 || pitch < width * 4) return false;
+    out->data = NULL;
+    out->size = 0;
+
+    InitCrcTable();
+    InitDeflateTables();
+
+    if (threads <= 0) threads = CpuCount();
+    if (threads > 64) threads = 64;
+
+    // ~2 strips per thread for load balance, at least 16 rows each
+    int stripCount = threads * 2;
+    if (stripCount > height / 16) stripCount = height / 16;
+    if (stripCount < 1) stripCount = 1;
+    if (threads > stripCount) threads = stripCount;
+
+    PngJob job;
+    memset(&job, 0, sizeof(job));
+    job.bgra = bgra;
+    job.width = width;
+    job.height = height;
+    job.pitch = pitch;
+    job.stripCount = stripCount;
+    job.strips = (PngStrip*)calloc((size_t)stripCount, sizeof(PngStrip));
+    if (!job.strips) return false;
+
+    int rowsPerStrip = height / stripCount;
+    int extra = height % stripCount;
+    int row = 0;
+    for (int i = 0; i < stripCount; i++) {
+        job.strips[i].firstRow = row;
+        job.strips[i].rowCount = rowsPerStrip + (i < extra ? 1 : 0);
+        row += job.strips[i].rowCount;
+    }
+
+    // Calling thread works too
+#ifdef _WIN32
+    HANDLE workers[64];
+    int workerCount = 0;
+    for (int i = 1; i < threads; i++) {
+        HANDLE h = (HANDLE)_beginthreadex(NULL, 0, PngWorker, &job, 0, NULL);
+        if (h) workers[workerCount++] = h;
+    }
+    PngWorker(&job);
+    for (int i = 0; i < workerCount; i++) {
+        WaitForSingleObject(workers[i], INFINITE);
+        CloseHandle(workers[i]);
+    }
+#else
+    pthread_t workers[64];
+    int workerCount = 0;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&workers[workerCount], NULL, PngWorker, &job) == 0) workerCount++;
+    }
+    PngWorker(&job);
+    for (int i = 0; i < workerCount; i++) {
+        pthread_join(workers[i], NULL);
+    }
+#endif
+
+    bool ok = true;
+    size_t total = 8 + 25 + 12 + 2 + 12 + 4 + 12;   // sig, IHDR, zlib header/trailer chunks, IEND
+    uint32_t adler = 1;
+    for (int i = 0; i < stripCount; i++) {
+        if (!job.strips[i].ok) ok = false;
+        total += job.strips[i].outputSize;
+        adler = i == 0 ? job.strips[i].adler
+                       : Adler32Combine(adler, job.strips[i].adler, job.strips[i].filteredSize);
+    }
+
+    uint8_t* dst = ok ? (uint8_t*)malloc(total) : NULL;
+    if (dst) {
+        static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        size_t pos = 0;
+        memcpy(dst, signature, 8);
+        pos = 8;
+
+        uint8_t ihdr[13];
+        PutBE32(ihdr, (uint32_t)width);
+        PutBE32(ihdr + 4, (uint32_t)height);
+        ihdr[8] = 8;    // Bit depth
+        ihdr[9] = 2;    // Truecolor RGB
+        ihdr[10] = 0;   // Deflate
+        ihdr[11] = 0;   // Adaptive filtering
+        ihdr[12] = 0;   // No interlace
+        AppendChunk(dst, &pos, "IHDR", ihdr, 13);
+
+        // zlib header (32K window, fastest level hint) in its own IDAT
+        static const uint8_t zlibHeader[2] = {0x78, 0x01};
+        AppendChunk(dst, &pos, "IDAT", zlibHeader, 2);
+
+        for (int i = 0; i < stripCount; i++) {
+            memcpy(dst + pos, job.strips[i].output, job.strips[i].outputSize);
+            pos += job.strips[i].outputSize;
+        }
+
+        uint8_t trailer[4];
+        PutBE32(trailer, adler);
+        AppendChunk(dst, &pos, "IDAT", trailer, 4);
+        AppendChunk(dst, &pos, "IEND", NULL, 0);
+
+        out->data = dst;
+        out->size = pos;
+    } else {
+        ok = false;
+    }
+
+    for (int i = 0; i < stripCount; i++) free(job.strips[i].output);
+    free(job.strips);
+    return ok;
+}
+
+// ============================================================================
+// Public helpers
+// ============================================================================
+
+bool ImageEncoder_Encode(ImageFormat format, const uint8_t* bgra, int width, int height, int pitch, EncodedImage* out) {
+    if (format == IMAGE_FORMAT_QOI) {
+        return ImageEncoder_EncodeQOI(bgra, width, height, pitch, out);
+    }
+    return ImageEncoder_EncodePNG(bgra, width, height, pitch, 0, out);
+}
+
+ImageFormat ImageEncoder_FormatFromPath(const char* path) {
+    const char* dot = path ? strrchr(path, '.') : NULL;
+    if (dot && (dot[1] == 'q' || dot[1] == 'Q') && (dot[2] == 'o' || dot[2] == 'O') &&
+        (dot[3] == 'i' || dot[3] == 'I') && dot[4] == '\0') {
+        return IMAGE_FORMAT_QOI;
+    }
+    return IMAGE_FORMAT_PNG;
+}
+
+bool ImageEncoder_WriteFile(const char* path, const EncodedImage* image) {
+    if (!path || !image || !image->data) return false;
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    size_t written = fwrite(image->data, 1, image->size, f);
+    bool ok = (written == image->size);
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
+
+void ImageEncoder_Free(EncodedImage* image) {
+    if (!image) return;
+    free(image->data);
+    image->data = NULL;
+    image->size = 0;
+}
@@ -0,0 +1,50 @@
+/*
+ * Image Encoder - Lossless screenshot encoding (PNG / QOI)
+ * No external dependencies; portable C (builds on Windows and Linux)
+ *
+ * - QOI: single pass, very fast, larger files
+ * - PNG: RGB, per-row adaptive filtering (SSE2), deflate compressed in
+ *   parallel row strips. Each strip ends on a byte boundary and becomes its
+ *   own IDAT chunk, so strips never wait on each other.
+ *
+ * Input is top-down BGRA with an arbitrary row pitch. Alpha is ignored
+ * (desktop captures don't carry meaningful alpha).
+ */
+
+#ifndef IMAGE_ENCODER_H
+#define IMAGE_ENCODER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    IMAGE_FORMAT_PNG = 0,
+    IMAGE_FORMAT_QOI
+} ImageFormat;
+
+// Encoded file contents (free with ImageEncoder_Free)
+typedef struct {
+    uint8_t* data;
+    size_t size;
+} EncodedImage;
+
+// Encode to QOI (3 channels, sRGB)
+bool ImageEncoder_EncodeQOI(const uint8_t* bgra, int width, int height, int pitch, EncodedImage* out);
+
+// Encode to PNG (8-bit RGB). threads = 0 uses one per CPU.
+bool ImageEncoder_EncodePNG(const uint8_t* bgra, int width, int height, int pitch, int threads, EncodedImage* out);
+
+// Encode in the given format (PNG uses all CPUs)
+bool ImageEncoder_Encode(ImageFormat format, const uint8_t* bgra, int width, int height, int pitch, EncodedImage* out);
+
+// Pick format from file extension (".qoi" → QOI, anything else → PNG)
+ImageFormat ImageEncoder_FormatFromPath(const char* path);
+
+// Write encoded image to a file
+bool ImageEncoder_WriteFile(const char* path, const EncodedImage* image);
+
+// Free encoded data
+void ImageEncoder_Free(EncodedImage* image);
+
+#endif // IMAGE_ENCODER_H
@@ -1,63 +1,521 @@
 /*
  * Centralized Logging Implementation
- * Thread-safe debug logging for replay buffer and related modules
+ * Lock-free record queue, deferred formatting, batched writes
  */
 
 #include "logger.h"
+#include "platform.h"
+#include "mem_tracker.h"
+#include "thread_registry.h"
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
 
-// Global log file handle
+// Queue positions and sequence numbers (unsigned view of the platform atomics)
+typedef PlatformAtomic64 LogCounter;
+static uint64_t Counter_Load(LogCounter* c) { return (uint64_t)Platform_AtomicLoad64(c); }
+static void Counter_Store(LogCounter* c, uint64_t v) { Platform_AtomicStore64(c, (int64_t)v); }
+static bool Counter_CompareExchange(LogCounter* c, uint64_t expected, uint64_t desired) {
+    return (uint64_t)Platform_AtomicCompareExchange64(c, (int64_t)expected, (int64_t)desired) == expected;
+}
+static void Counter_Increment(LogCounter* c) { Platform_AtomicAdd64(c, 1); }
+
+typedef struct { PlatformThread thread; PlatformEvent wake; } LogWriter;
+static void WriterThread(void* param);
+static bool Writer_Start(LogWriter* w) {
+    if (!Platform_EventCreate(&w->wake, false, false)) return false;
+    if (!Platform_ThreadCreate(&w->thread, WriterThread, NULL)) {
+        Platform_EventDestroy(&w->wake);
+        return false;
+    }
+    return true;
+}
+static void Writer_Wait(LogWriter* w, int ms) { Platform_EventWait(&w->wake, ms); }
+static void Writer_Wake(LogWriter* w) { Platform_EventSet(&w->wake); }
+static void Writer_Join(LogWriter* w) {
+    Platform_ThreadJoin(&w->thread);
+    Platform_EventDestroy(&w->wake);
+}
+
+#define LOG_QUEUE_MASK      (LOGGER_QUEUE_RECORDS - 1)
+#define LOG_DATA_SIZE       (LOGGER_RECORD_SIZE - 20)
+#define LOG_BATCH_SIZE      (64 * 1024)
+#define LOG_LINE_SIZE       2048
+
+// One queue slot. 'sequence' is the Vyukov bounded-queue ticket: equal to
+// the slot's position when free, position + 1 once the record is published.
+typedef struct {
+    LogCounter sequence;
+    const char* fmt;            // NULL: data holds the preformatted text
+    uint16_t size;              // Bytes used in data
+    uint8_t level;
+    uint8_t reserved;
+    unsigned char data[LOG_DATA_SIZE];
+} LogCell;
+
+static LogCell g_queue[LOGGER_QUEUE_RECORDS];
+static LogCounter g_enqueuePos;
+static LogCounter g_dequeuePos;     // Written only by the writer thread
+static LogCounter g_dropped;
+
+// Global log file handle (owned by the writer thread while it runs)
 static FILE* g_logFile = NULL;
-static CRITICAL_SECTION g_logLock;
-static BOOL g_logInitialized = FALSE;
+static volatile bool g_logInitialized = false;
+static volatile bool g_stopWriter = false;
+static volatile LogLevel g_logLevel = LOG_LEVEL_INFO;
+static LogWriter g_writer;
 
-void Logger_Init(const char* filename, const char* mode) {
-    if (g_logInitialized) return;
-    
-    InitializeCriticalSection(&g_logLock);
-    g_logFile = fopen(filename, mode);
-    
-    // Only mark as initialized if file opened successfully
-    // Critical section is still valid for later attempts
-    if (g_logFile) {
-        g_logInitialized = TRUE;
+// ============================================================================
+// Argument packing (caller thread)
+// ============================================================================
+
+typedef struct {
+    char flags[8];
+    int width;                  // -1: none
+    int precision;              // -1: none
+    bool widthArg;              // '*'
+    bool precisionArg;          // '.*'
+    char length[4];             // "", "h", "hh", "l", "ll", "z", "j", "t", "L", "I64", ...
+    char conversion;
+} FormatSpec;
+
+// Parse one conversion after '%'. Returns the character after it.
+static const char* ParseSpec(const char* p, FormatSpec* spec) {
+    memset(spec, 0, sizeof(*spec));
+    spec->width = -1;
+    spec->precision = -1;
+
+    int n = 0;
+    while (*p && strchr("-+ #0", *p) && n < (int)sizeof(spec->flags) - 1) spec->flags[n++] = *p++;
+
+    if (*p == '*') {
+        spec->widthArg = true;
+        p++;
+    } else if (*p >= '0' && *p <= '9') {
+        spec->width = 0;
+        while (*p >= '0' && *p <= '9') spec->width = spec->width * 10 + (*p++ - '0');
+    }
+
+    if (*p == '.') {
+        p++;
+        spec->precision = 0;
+        if (*p == '*') {
+            spec->precisionArg = true;
+            p++;
+        } else {
+            while (*p >= '0' && *p <= '9') spec->precision = spec->precision * 10 + (*p++ - '0');
+        }
+    }
+
+    if (p[0] == 'I' && p[1] == '6' && p[2] == '4') { strcpy(spec->length, "I64"); p += 3; }
+    else if (p[0] == 'I' && p[1] == '3' && p[2] == '2') { strcpy(spec->length, "I32"); p += 3; }
+    else if ((p[0] == 'h' && p[1] == 'h') || (p[0] == 'l' && p[1] == 'l')) {
+        spec->length[0] = p[0];
+        spec->length[1] = p[1];
+        p += 2;
+    } else if (*p && strchr("hlzjtLI", *p)) {
+        spec->length[0] = *p++;
+    }
+
+    spec->conversion = *p;
+    return *p ? p + 1 : p;
+}
+
+typedef struct {
+    unsigned char* data;
+    size_t used;
+    bool ok;
+} ArgWriter;
+
+static void PutBytes(ArgWriter* w, const void* src, size_t size) {
+    if (!w->ok || w->used + size > LOG_DATA_SIZE) {
+        w->ok = false;
+        return;
+    }
+    memcpy(w->data + w->used, src, size);
+    w->used += size;
+}
+
+static void PutInt(ArgWriter* w, int64_t v) { PutBytes(w, &v, sizeof(v)); }
+
+static bool IsLength(const FormatSpec* spec, const char* length) {
+    return strcmp(spec->length, length) == 0;
+}
+
+// Copy the arguments 'fmt' will consume into 'data'. Integers become 64-bit,
+// floats double, strings are copied. False if the format uses something we
+// can't defer (wide strings, long double, %n) or the arguments don't fit.
+static bool PackArgs(const char* fmt, va_list args, unsigned char* data, uint16_t* used) {
+    ArgWriter w = { data, 0, true };
+
+    for (const char* p = fmt; *p && w.ok; ) {
+        if (*p++ != '%') continue;
+        if (*p == '%') {
+            p++;
+            continue;
+        }
+
+        FormatSpec spec;
+        p = ParseSpec(p, &spec);
+        if (spec.widthArg) PutInt(&w, va_arg(args, int));
+        int precision = spec.precision;
+        if (spec.precisionArg) {
+            precision = va_arg(args, int);
+            PutInt(&w, precision);
+        }
+
+        switch (spec.conversion) {
+        case 'd': case 'i':
+            if (IsLength(&spec, "ll") || IsLength(&spec, "j") || IsLength(&spec, "I64")) PutInt(&w, va_arg(args, long long));
+            else if (IsLength(&spec, "l")) PutInt(&w, va_arg(args, long));
+            else if (IsLength(&spec, "z") || IsLength(&spec, "t") || IsLength(&spec, "I")) PutInt(&w, va_arg(args, ptrdiff_t));
+            else PutInt(&w, va_arg(args, int));
+            break;
+        case 'u': case 'x': case 'X': case 'o':
+            if (IsLength(&spec, "ll") || IsLength(&spec, "j") || IsLength(&spec, "I64")) PutInt(&w, (int64_t)va_arg(args, unsigned long long));
+            else if (IsLength(&spec, "l")) PutInt(&w, (int64_t)va_arg(args, unsigned long));
+            else if (IsLength(&spec, "z") || IsLength(&spec, "t") || IsLength(&spec, "I")) PutInt(&w, (int64_t)va_arg(args, size_t));
+            else if (IsLength(&spec, "hh")) PutInt(&w, (unsigned char)va_arg(args, unsigned int));
+            else if (IsLength(&spec, "h")) PutInt(&w, (unsigned short)va_arg(args, unsigned int));
+            else PutInt(&w, va_arg(args, unsigned int));
+            break;
+        case 'c':
+            if (spec.length[0]) return false;       // Wide character
+            PutInt(&w, va_arg(args, int));
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': {
+            if (spec.length[0] == 'L') return false;
+            double v = va_arg(args, double);
+            PutBytes(&w, &v, sizeof(v));
+            break;
+        }
+        case 's': {
+            if (spec.length[0]) return false;       // Wide string
+            const char* s = va_arg(args, const char*);
+            if (!s) s = "(null)";
+            size_t len = 0;
+            size_t limit = precision >= 0 ? (size_t)precision : LOG_DATA_SIZE;
+            while (len < limit && len <= LOG_DATA_SIZE && s[len]) len++;
+            uint16_t len16 = (uint16_t)len;
+            PutBytes(&w, &len16, sizeof(len16));
+            PutBytes(&w, s, len);
+            break;
+        }
+        case 'p': {
+            void* v = va_arg(args, void*);
+            PutBytes(&w, &v, sizeof(v));
+            break;
+        }
+        default:
+            return false;                           // %n, %S, %C, unknown
+        }
+    }
+
+    *used = (uint16_t)w.used;
+    return w.ok;
+}
+
+// ============================================================================
+// Queue
+// ============================================================================
+
+static LogCell* ClaimCell(uint64_t* position) {
+    uint64_t pos = Counter_Load(&g_enqueuePos);
+    for (;;) {
+        LogCell* cell = &g_queue[pos & LOG_QUEUE_MASK];
+        int64_t diff = (int64_t)(Counter_Load(&cell->sequence) - pos);
+        if (diff == 0) {
+            if (Counter_CompareExchange(&g_enqueuePos, pos, pos + 1)) {
+                *position = pos;
+                return cell;
+            }
+            pos = Counter_Load(&g_enqueuePos);
+        } else if (diff < 0) {
+            return NULL;                            // Full
+        } else {
+            pos = Counter_Load(&g_enqueuePos);      // Another producer took it
+        }
+    }
+}
+
+static void Enqueue(LogLevel level, const char* fmt, va_list args) {
+    uint64_t pos;
+    LogCell* cell = ClaimCell(&pos);
+    if (!cell) {
+        Counter_Increment(&g_dropped);
+        return;
+    }
+
+    va_list copy;
+    va_copy(copy, args);
+    bool packed = PackArgs(fmt, copy, cell->data, &cell->size);
+    va_end(copy);
+
+    if (packed) {
+        cell->fmt = fmt;
     } else {
-        // Clean up critical section if file open failed
-        DeleteCriticalSection(&g_logLock);
+        // Can't defer: format here (still no lock, no I/O)
+        int n = vsnprintf((char*)cell->data, LOG_DATA_SIZE, fmt, args);
+        cell->fmt = NULL;
+        cell->size = (uint16_t)(n < 0 ? 0 : n < LOG_DATA_SIZE ? n : LOG_DATA_SIZE - 1);
+        if (n >= LOG_DATA_SIZE) {
+            size_t fmtLen = strlen(fmt);
+            if (fmtLen > 0 && fmt[fmtLen - 1] == '\n') cell->data[cell->size - 1] = '\n';   // Keep lines apart
+        }
+    }
+    cell->level = (uint8_t)level;
+    Counter_Store(&cell->sequence, pos + 1);
+
+    // Burst: don't wait for the timer. Only the producer that crosses the
+    // half-full mark pays for the wake-up.
+    if (pos - Counter_Load(&g_dequeuePos) == LOGGER_QUEUE_RECORDS / 2) {
+        Writer_Wake(&g_writer);
     }
 }
 
-void Logger_Shutdown(void) {
-    if (!g_logInitialized) return;
-    
-    EnterCriticalSection(&g_logLock);
+// ============================================================================
+// Formatting and writing (writer thread)
+// ============================================================================
+
+typedef struct {
+    const unsigned char* data;
+    size_t offset;
+    size_t size;
+} ArgReader;
+
+static int64_t GetInt(ArgReader* r) {
+    int64_t v = 0;
+    if (r->offset + sizeof(v) <= r->size) memcpy(&v, r->data + r->offset, sizeof(v));
+    r->offset += sizeof(v);
+    return v;
+}
+
+static double GetDouble(ArgReader* r) {
+    double v = 0;
+    if (r->offset + sizeof(v) <= r->size) memcpy(&v, r->data + r->offset, sizeof(v));
+    r->offset += sizeof(v);
+    return v;
+}
+
+// Format one record into 'out'; returns the length
+static size_t FormatRecord(const LogCell* cell, char* out, size_t size) {
+    if (!cell->fmt) {
+        size_t n = cell->size < size - 1 ? cell->size : size - 1;
+        memcpy(out, cell->data, n);
+        out[n] = '\0';
+        return n;
+    }
+
+    ArgReader r = { cell->data, 0, cell->size };
+    size_t len = 0;
+    const char* p = cell->fmt;
+
+    while (*p && len < size - 1) {
+        if (*p != '%') {
+            out[len++] = *p++;
+            continue;
+        }
+        p++;
+        if (*p == '%') {
+            out[len++] = *p++;
+            continue;
+        }
+
+        FormatSpec spec;
+        p = ParseSpec(p, &spec);
+        int width = spec.widthArg ? (int)GetInt(&r) : spec.width;
+        int precision = spec.precisionArg ? (int)GetInt(&r) : spec.precision;
+
+        // Rebuild the spec with explicit width/precision and our storage types
+        char specText[32];
+        int n = snprintf(specText, sizeof(specText), "%%%s", spec.flags);
+        if (width >= 0) n += snprintf(specText + n, sizeof(specText) - n, "%d", width);
+        if (precision >= 0 && spec.conversion != 's') n += snprintf(specText + n, sizeof(specText) - n, ".%d", precision);
+
+        int written = 0;
+        switch (spec.conversion) {
+        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o':
+            snprintf(specText + n, sizeof(specText) - n, "ll%c", spec.conversion);
+            written = snprintf(out + len, size - len, specText, (long long)GetInt(&r));
+            break;
+        case 'c':
+            snprintf(specText + n, sizeof(specText) - n, "c");
+            written = snprintf(out + len, size - len, specText, (int)GetInt(&r));
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            snprintf(specText + n, sizeof(specText) - n, "%c", spec.conversion);
+            written = snprintf(out + len, size - len, specText, GetDouble(&r));
+            break;
+        case 's': {
+            uint16_t sLen = 0;
+            if (r.offset + sizeof(sLen) <= r.size) memcpy(&sLen, r.data + r.offset, sizeof(sLen));
+            r.offset += sizeof(sLen);
+            const char* s = (const char*)r.data + r.offset;
+            if (r.offset + sLen > r.size) sLen = 0;
+            r.offset += sLen;
+            snprintf(specText + n, sizeof(specText) - n, ".*s");
+            written = snprintf(out + len, size - len, specText, (int)sLen, s);
+            break;
+        }
+        case 'p': {
+            void* v = NULL;
+            if (r.offset + sizeof(v) <= r.size) memcpy(&v, r.data + r.offset, sizeof(v));
+            r.offset += sizeof(v);
+            written = snprintf(out + len, size - len, "%p", v);
+            break;
+        }
+        default:
+            break;
+        }
+        if (written > 0) len += (size_t)written < size - len ? (size_t)written : size - len - 1;
+    }
+
+    out[len] = '\0';
+    return len;
+}
+
+// Write every published record; returns true if anything was written
+static bool DrainQueue(void) {
+    static char batch[LOG_BATCH_SIZE];
+    static unsigned long long reportedDrops = 0;
+    char line[LOG_LINE_SIZE];
+    size_t batchLen = 0;
+
+    uint64_t pos = Counter_Load(&g_dequeuePos);
+    for (;;) {
+        LogCell* cell = &g_queue[pos & LOG_QUEUE_MASK];
+        if (Counter_Load(&cell->sequence) != pos + 1) break;
+
+        size_t n = FormatRecord(cell, line, sizeof(line));
+        Counter_Store(&cell->sequence, pos + LOGGER_QUEUE_RECORDS);    // Free for the next lap
+        pos++;
+        Counter_Store(&g_dequeuePos, pos);
+
+        if (batchLen + n > sizeof(batch)) {
+            if (g_logFile) fwrite(batch, 1, batchLen, g_logFile);
+            batchLen = 0;
+        }
+        memcpy(batch + batchLen, line, n);
+        batchLen += n;
+    }
+
+    unsigned long long dropped = Counter_Load(&g_dropped);
+    if (dropped != reportedDrops && batchLen + 96 <= sizeof(batch)) {
+        int n = snprintf(batch + batchLen, 96, "[Logger] %llu messages dropped (queue full)\n",
+                         dropped - reportedDrops);
+        if (n > 0) batchLen += (size_t)n < 96 ? (size_t)n : 95;
+        reportedDrops = dropped;
+    }
+
+    if (batchLen == 0) return false;
     if (g_logFile) {
+        fwrite(batch, 1, batchLen, g_logFile);
+        fflush(g_logFile);
+    }
+    return true;
+}
+
+static void WriterThread(void* param) {
+    (void)param;
+    ThreadRegistry_Register("Log writer", THREAD_ROLE_LOGGER);
+    while (!g_stopWriter) {
+        Writer_Wait(&g_writer, LOGGER_FLUSH_MS);
+        DrainQueue();
+    }
+    DrainQueue();
+    ThreadRegistry_Unregister();
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void Logger_Init(const char* filename, const char* mode) {
+    if (g_logInitialized) return;
+
+    g_logFile = fopen(filename, mode);
+    if (!g_logFile) return;
+
+    // Fresh queue: every slot free for lap 0
+    for (int i = 0; i < LOGGER_QUEUE_RECORDS; i++) {
+        Counter_Store(&g_queue[i].sequence, (uint64_t)i);
+    }
+    Counter_Store(&g_enqueuePos, 0);
+    Counter_Store(&g_dequeuePos, 0);
+    Counter_Store(&g_dropped, 0);
+
+    g_stopWriter = false;
+    if (!Writer_Start(&g_writer)) {
         fclose(g_logFile);
         g_logFile = NULL;
+        return;
     }
-    LeaveCriticalSection(&g_logLock);
-    
-    DeleteCriticalSection(&g_logLock);
-    g_logInitialized = FALSE;
+
+    // Only mark as initialized once the writer is running
+    g_logInitialized = true;
+    MemTracker_Account(MEM_TAG_DIAGNOSTICS, (int64_t)(sizeof(g_queue) + LOG_BATCH_SIZE));
 }
 
-void Logger_Log(const char* fmt, ...) {
+void Logger_Shutdown(void) {
     if (!g_logInitialized) return;
-    
-    EnterCriticalSection(&g_logLock);
-    
-    if (g_logFile) {
-        va_list args;
-        va_start(args, fmt);
-        vfprintf(g_logFile, fmt, args);
-        va_end(args);
-        fflush(g_logFile);
+
+    // Writer drains what's queued before exiting
+    g_logInitialized = false;
+    g_stopWriter = true;
+    Writer_Wake(&g_writer);
+    Writer_Join(&g_writer);
+
+    fclose(g_logFile);
+    g_logFile = NULL;
+    MemTracker_Account(MEM_TAG_DIAGNOSTICS, -(int64_t)(sizeof(g_queue) + LOG_BATCH_SIZE));
+}
+
+void Logger_Log(const char* fmt, ...) {
+    if (!g_logInitialized || LOG_LEVEL_INFO > g_logLevel) return;
+
+    va_list args;
+    va_start(args, fmt);
+    Enqueue(LOG_LEVEL_INFO, fmt, args);
+    va_end(args);
+}
+
+void Logger_LogLevel(LogLevel level, const char* fmt, ...) {
+    if (!g_logInitialized || level > g_logLevel) return;
+
+    va_list args;
+    va_start(args, fmt);
+    Enqueue(level, fmt, args);
+    va_end(args);
+}
+
+void Logger_SetLevel(LogLevel level) {
+    if (level < LOG_LEVEL_ERROR) level = LOG_LEVEL_ERROR;
+    if (level >= LOG_LEVEL_COUNT) level = LOG_LEVEL_DEBUG;
+    g_logLevel = level;
+}
+
+LogLevel Logger_GetLevel(void) {
+    return g_logLevel;
+}
+
+bool Logger_Flush(int timeoutMs) {
+    if (!g_logInitialized) return true;
+
+    uint64_t target = Counter_Load(&g_enqueuePos);
+    for (int waited = 0; Counter_Load(&g_dequeuePos) < target; waited++) {
+        if (!g_logInitialized || waited >= timeoutMs) return false;
+        Writer_Wake(&g_writer);
+        Platform_SleepMs(1);
     }
-    
-    LeaveCriticalSection(&g_logLock);
+    return true;
+}
+
+unsigned long long Logger_GetDropped(void) {
+    return (unsigned long long)Counter_Load(&g_dropped);
 }
 
-BOOL Logger_IsInitialized(void) {
+bool Logger_IsInitialized(void) {
     return g_logInitialized && g_logFile != NULL;
 }
@@ -1,24 +1,72 @@
 /*
  * Centralized Logging
- * Thread-safe debug logging for replay buffer and related modules
+ * Asynchronous debug logging for replay buffer and related modules
+ *
+ * Logging is called from the encoder output threads, the capture loop and
+ * the audio mixer, so the caller never formats, locks or touches the disk.
+ * Logger_Log scans the format, copies the raw arguments (strings by value)
+ * into a fixed-size record and pushes it on a lock-free multi-producer
+ * queue. A background thread formats records and writes them in batches.
+ *
+ * The format must be a string literal (only its pointer is queued). A
+ * message whose arguments don't fit in a record is formatted by the caller
+ * instead; one that finds the queue full is dropped and counted.
  */
 
 #ifndef LOGGER_H
 #define LOGGER_H
 
-#include <windows.h>
+#include <stdbool.h>
 
-// Initialize the logger (opens log file)
+typedef enum {
+    LOG_LEVEL_ERROR = 0,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,             // Logger_Log
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_COUNT
+} LogLevel;
+
+// Messages above this level are compiled out of the LOG_* macros
+#ifndef LOGGER_COMPILE_LEVEL
+#define LOGGER_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+#define LOGGER_QUEUE_RECORDS    2048    // Power of two
+#define LOGGER_RECORD_SIZE      512     // Bytes per queued message
+#define LOGGER_FLUSH_MS         20      // Writer wakes at least this often
+
+// Initialize the logger (opens log file, starts the writer thread)
 // Mode: "w" for overwrite, "a" for append
 void Logger_Init(const char* filename, const char* mode);
 
-// Shutdown the logger (closes log file)
+// Shutdown the logger (writes everything queued, closes log file)
 void Logger_Shutdown(void);
 
-// Log a formatted message (printf-style)
+// Log a formatted message (printf-style) at LOG_LEVEL_INFO
 void Logger_Log(const char* fmt, ...);
 
+// Log a formatted message at a given level (prefer the LOG_* macros)
+void Logger_LogLevel(LogLevel level, const char* fmt, ...);
+
+#define LOG_AT(level, ...) \
+    do { if ((level) <= LOGGER_COMPILE_LEVEL) Logger_LogLevel((level), __VA_ARGS__); } while (0)
+#define LOG_ERROR(...)  LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...)   LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...)   LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...)  LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+// Runtime filter: messages above 'level' are discarded by the caller
+void Logger_SetLevel(LogLevel level);
+LogLevel Logger_GetLevel(void);
+
+// Wait (up to timeoutMs) until everything queued so far has been written.
+// Messages are otherwise on disk within LOGGER_FLUSH_MS.
+bool Logger_Flush(int timeoutMs);
+
+// Messages dropped because the queue was full
+unsigned long long Logger_GetDropped(void);
+
 // Check if logger is initialized
-BOOL Logger_IsInitialized(void);
+bool Logger_IsInitialized(void);
 
 #endif // LOGGER_H
@@ -35,15 +35,18 @@
 // Forward declarations
 #include "config.h"
 #include "capture.h"
-#include "encoder.h"
 #include "overlay.h"
 #include "replay_buffer.h"
 #include "logger.h"
 #include "crash_handler.h"
+#include "trace.h"
+#include "metrics_server.h"
+#include "headless.h"
 
 // Global state
 AppConfig g_config;
 CaptureState g_capture;
+FrameHub* g_frameHub = NULL;
 ReplayBufferState g_replayBuffer;
 BOOL g_isRecording = FALSE;
 BOOL g_isSelecting = FALSE;
@@ -55,17 +58,37 @@ HWND g_controlWnd = NULL;
 
 // Debug mode flag (enabled via --debug CLI argument)
 static BOOL g_debugMode = FALSE;
+static BOOL g_verboseLog = FALSE;   // --verbose: debug-level log lines too
+static BOOL g_metricsMode = FALSE;  // --metrics: serve live metrics on a named pipe
+static BOOL g_headlessMode = FALSE; // --headless: no windows, driven over the control pipe
 
 // Mutex for single instance detection
 HANDLE g_mutex = NULL;
 const char* MUTEX_NAME = "LightweightScreenRecorderMutex";
 const char* WINDOW_CLASS = "LWSROverlay";
 
-// Parse command line for --debug flag
+// Parse command line for --debug / --verbose / --metrics / --headless flags
 static void ParseCommandLine(LPSTR lpCmdLine) {
     if (lpCmdLine && (strstr(lpCmdLine, "--debug") || strstr(lpCmdLine, "-d"))) {
         g_debugMode = TRUE;
     }
+    if (lpCmdLine && strstr(lpCmdLine, "--verbose")) {
+        g_debugMode = TRUE;
+        g_verboseLog = TRUE;
+    }
+    if (lpCmdLine && strstr(lpCmdLine, "--metrics")) {
+        g_metricsMode = TRUE;
+    }
+    if (lpCmdLine && strstr(lpCmdLine, "--headless")) {
+        g_headlessMode = TRUE;
+    }
+}
+
+// Startup failure: a message box, except headless where nobody would click it
+static void ReportFatal(const char* message) {
+    if (!g_headlessMode) {
+        MessageBoxA(NULL, message, "Error", MB_OK | MB_ICONERROR);
+    }
 }
 
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, 
@@ -83,7 +106,8 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
     g_mutex = OpenMutexA(MUTEX_ALL_ACCESS, FALSE, MUTEX_NAME);
     if (g_mutex) {
         // Another instance exists - signal it to stop recording
-        HWND existingWnd = FindWindowA(WINDOW_CLASS, NULL);
+        // (a headless launch just exits; it doesn't drive the GUI)
+        HWND existingWnd = g_headlessMode ? NULL : FindWindowA(WINDOW_CLASS, NULL);
         if (existingWnd) {
             PostMessage(existingWnd, WM_USER + 1, 0, 0); // Custom stop message
         }
@@ -97,7 +121,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
     // Initialize COM
     HRESULT hr = CoInitializeEx(NULL, COINIT_APARTMENTTHREADED);
     if (FAILED(hr)) {
-        MessageBoxA(NULL, "Failed to initialize COM", "Error", MB_OK | MB_ICONERROR);
+        ReportFatal("Failed to initialize COM");
         return 1;
     }
     
@@ -107,7 +131,7 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
     // Initialize Media Foundation
     hr = MFStartup(MF_VERSION, MFSTARTUP_NOSOCKET);
     if (FAILED(hr)) {
-        MessageBoxA(NULL, "Failed to initialize Media Foundation", "Error", MB_OK | MB_ICONERROR);
+        ReportFatal("Failed to initialize Media Foundation");
         CoUninitialize();
         return 1;
     }
@@ -115,17 +139,35 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
     // Load configuration
     Config_Load(&g_config);
     
+    // Thread policies must be in place before any pipeline thread starts
+    for (int i = 0; i < THREAD_ROLE_COUNT; i++) {
+        ThreadRegistry_SetPolicy((ThreadRole)i, &g_config.threadPolicy[i]);
+    }
+    
     // Initialize capture system
     if (!Capture_Init(&g_capture)) {
-        MessageBoxA(NULL, "Failed to initialize screen capture", "Error", MB_OK | MB_ICONERROR);
+        ReportFatal("Failed to initialize screen capture");
+        MFShutdown();
+        CoUninitialize();
+        return 1;
+    }
+    
+    // Single capture loop shared by the replay buffer and recorder
+    FrameHubSource hubSource;
+    Capture_GetHubSource(&g_capture, &hubSource);
+    g_frameHub = FrameHub_Create(&hubSource);
+    if (!g_frameHub) {
+        ReportFatal("Failed to initialize screen capture");
+        Capture_Shutdown(&g_capture);
         MFShutdown();
         CoUninitialize();
         return 1;
     }
     
-    // Create and show overlay
-    if (!Overlay_Create(hInstance)) {
-        MessageBoxA(NULL, "Failed to create overlay", "Error", MB_OK | MB_ICONERROR);
+    // Create and show overlay (none when headless)
+    if (!g_headlessMode && !Overlay_Create(hInstance)) {
+        ReportFatal("Failed to create overlay");
+        FrameHub_Destroy(g_frameHub);
         Capture_Shutdown(&g_capture);
         MFShutdown();
         CoUninitialize();
@@ -138,26 +180,41 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
     // Initialize logger for replay debugging (only if --debug flag is set)
     if (g_debugMode) {
         Logger_Init("replay_debug.txt", "w");
+        Logger_SetLevel(g_verboseLog ? LOG_LEVEL_DEBUG : LOG_LEVEL_INFO);
     }
     
-    // Start replay buffer if enabled in config
-    if (g_config.replayEnabled) {
-        ReplayBuffer_Start(&g_replayBuffer, &g_config);
-        // Register global hotkey for saving replay
-        RegisterHotKey(g_controlWnd, HOTKEY_REPLAY_SAVE, 0, g_config.replaySaveKey);
+    // Live metrics for monitoring (only if --metrics flag is set)
+    if (g_metricsMode) {
+        MetricsServer_Start(METRICS_PIPE_NAME);
     }
     
-    // Start watchdog for hang detection (optional - monitors for frozen app)
-    CrashHandler_StartWatchdog();
-    
-    // Message loop
-    MSG msg;
-    while (GetMessage(&msg, NULL, 0, 0)) {
-        // Heartbeat to let watchdog know we're alive
-        CrashHandler_Heartbeat();
+    int exitCode;
+    if (g_headlessMode) {
+        // Starts the buffer itself and returns on "quit"
+        CrashHandler_StartWatchdog();
+        exitCode = Headless_Run();
+    } else {
+        // Start replay buffer if enabled in config
+        if (g_config.replayEnabled) {
+            ReplayBuffer_Start(&g_replayBuffer, &g_config);
+            // Register global hotkey for saving replay
+            RegisterHotKey(g_controlWnd, HOTKEY_REPLAY_SAVE, 0, g_config.replaySaveKey);
+        }
+        
+        // Start watchdog for hang detection (optional - monitors for frozen app)
+        CrashHandler_StartWatchdog();
+        CrashHandler_SetStallRecovery(Overlay_RecoverStall, NULL);
         
-        TranslateMessage(&msg);
-        DispatchMessage(&msg);
+        // Message loop
+        MSG msg;
+        while (GetMessage(&msg, NULL, 0, 0)) {
+            // Heartbeat to let watchdog know we're alive
+            CrashHandler_Heartbeat();
+            
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+        exitCode = (int)msg.wParam;
     }
     
     // Stop watchdog before cleanup
@@ -165,9 +222,14 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
     
     // Cleanup
     UnregisterHotKey(g_controlWnd, HOTKEY_REPLAY_SAVE);
+    MetricsServer_Stop();
     ReplayBuffer_Shutdown(&g_replayBuffer);
     Logger_Shutdown();
-    Config_Save(&g_config);
+    if (!g_headlessMode) {
+        Config_Save(&g_config);     // Settings changed over the control pipe aren't kept
+    }
+    FrameHub_Destroy(g_frameHub);
+    Trace_Shutdown();   // Every traced thread has exited
     Capture_Shutdown(&g_capture);
     MFShutdown();
     CoUninitialize();
@@ -180,5 +242,5 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance,
         CloseHandle(g_mutex);
     }
     
-    return (int)msg.wParam;
+    return exitCode;
 }
@@ -0,0 +1,60 @@
+/*
+ * Media Clock Implementation
+ */
+
+#include "media_clock.h"
+#include "frame_pacer.h"
+#include <stddef.h>
+
+static int64_t SourceNow(const MediaClock* clock) {
+    return clock->source ? clock->source(clock->userData) : FramePacer_Now();
+}
+
+void MediaClock_Init(MediaClock* clock, MediaClockSource source, void* userData) {
+    if (!clock) return;
+    clock->source = source;
+    clock->userData = userData;
+    clock->origin = SourceNow(clock);
+    clock->pausedAt = 0;
+    clock->paused = false;
+}
+
+int64_t MediaClock_Now(const MediaClock* clock) {
+    if (!clock) return 0;
+    return (clock->paused ? clock->pausedAt : SourceNow(clock)) - clock->origin;
+}
+
+void MediaClock_Pause(MediaClock* clock) {
+    if (!clock || clock->paused) return;
+    clock->pausedAt = SourceNow(clock);
+    clock->paused = true;
+}
+
+void MediaClock_Resume(MediaClock* clock) {
+    if (!clock || !clock->paused) return;
+    clock->origin += SourceNow(clock) - clock->pausedAt;
+    clock->paused = false;
+}
+
+int64_t MediaClock_FromSource(const MediaClock* clock, int64_t sourceTime) {
+    return clock ? sourceTime - clock->origin : sourceTime;
+}
+
+int64_t MediaClock_ToSource(const MediaClock* clock, int64_t mediaTime) {
+    return clock ? mediaTime + clock->origin : mediaTime;
+}
+
+int64_t MediaClock_FromSamples(int64_t samples, int rate) {
+    if (rate <= 0) return 0;
+    // Split to avoid overflow on long captures
+    return (samples / rate) * MEDIA_CLOCK_UNITS_PER_SECOND +
+           (samples % rate) * MEDIA_CLOCK_UNITS_PER_SECOND / rate;
+}
+
+bool MediaClock_Drifted(int64_t expected, int64_t actual, int64_t tolerance) {
+    return actual - expected > tolerance || expected - actual > tolerance;
+}
+
+int64_t MediaClock_FakeSource(void* userData) {
+    return userData ? *(const int64_t*)userData : 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * Media Clock - Master timeline for video, audio and the muxer
+ * Portable C; integer 100-ns ticks
+ *
+ * One clock per capture session. Every stage stamps against it:
+ * - Video: hub tick times are converted with MediaClock_FromSource
+ * - Audio: AudioCapture stamps each read with the clock time of its first byte
+ * - AAC: output frames carry their input's media time (resynced on drift)
+ * so audio and video share an origin and save-time alignment is a subtraction.
+ *
+ * The default source is the system monotonic clock (FramePacer_Now, the
+ * same clock as frame hub tick times). Tests can inject a fake source.
+ */
+
+#ifndef MEDIA_CLOCK_H
+#define MEDIA_CLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define MEDIA_CLOCK_UNITS_PER_SECOND 10000000LL
+
+// Monotonic time in 100-ns units
+typedef int64_t (*MediaClockSource)(void* userData);
+
+typedef struct {
+    MediaClockSource source;    // NULL = system clock
+    void* userData;
+    int64_t origin;             // Source time of media time 0
+    int64_t pausedAt;           // Source time the clock was paused at
+    bool paused;
+} MediaClock;
+
+// Start a clock at media time 0 = now. source NULL uses the system clock.
+void MediaClock_Init(MediaClock* clock, MediaClockSource source, void* userData);
+
+// Current media time
+int64_t MediaClock_Now(const MediaClock* clock);
+
+// Hold media time while paused. Resume carries on from the held time, so
+// the paused span leaves no gap (origin moves forward by its length).
+void MediaClock_Pause(MediaClock* clock);
+void MediaClock_Resume(MediaClock* clock);
+
+// Source time (e.g. a hub tick time) <-> media time
+int64_t MediaClock_FromSource(const MediaClock* clock, int64_t sourceTime);
+int64_t MediaClock_ToSource(const MediaClock* clock, int64_t mediaTime);
+
+// Duration of 'samples' at 'rate' per second, rounded down
+int64_t MediaClock_FromSamples(int64_t samples, int rate);
+
+// True if 'actual' is more than 'tolerance' either side of 'expected'. A
+// stage anchored on a sample count re-anchors when its input drifts this far.
+bool MediaClock_Drifted(int64_t expected, int64_t actual, int64_t tolerance);
+
+// Fake source for tests: userData points at an int64_t holding the time
+int64_t MediaClock_FakeSource(void* userData);
+
+#endif // MEDIA_CLOCK_H
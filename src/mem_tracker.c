@@ -0,0 +1,197 @@
+/*
+ * Memory Tracker Implementation
+ * Block headers and per-tag atomic counters
+ */
+
+#include "mem_tracker.h"
+#include "platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Keeps the user block 16-byte aligned, like malloc on x64
+typedef union {
+    struct {
+        uint64_t size;
+        uint32_t tag;
+    } info;
+    uint8_t pad[16];
+} MemHeader;
+
+typedef struct {
+    PlatformAtomic64 current;
+    PlatformAtomic64 peak;
+    PlatformAtomic64 windowPeak;
+    PlatformAtomic64 allocations;
+} MemCounters;
+
+static MemCounters g_tags[MEM_TAG_COUNT];
+static MemCounters g_total;
+
+static const char* g_tagNames[MEM_TAG_COUNT] = {
+    "video", "audio", "save", "video encoder", "audio encoder", "audio capture", "capture", "diagnostics"
+};
+
+// ============================================================================
+// Counters
+// ============================================================================
+
+static void RaisePeak(PlatformAtomic64* peak, int64_t value) {
+    int64_t seen = Platform_AtomicLoad64(peak);
+    while (value > seen) {
+        int64_t previous = Platform_AtomicCompareExchange64(peak, seen, value);
+        if (previous == seen) break;
+        seen = previous;
+    }
+}
+
+static void Add(MemCounters* counters, int64_t bytes) {
+    int64_t now = Platform_AtomicAdd64(&counters->current, bytes);
+    if (bytes > 0) {
+        RaisePeak(&counters->peak, now);
+        RaisePeak(&counters->windowPeak, now);
+    }
+}
+
+static void Count(MemTag tag, int64_t bytes) {
+    Add(&g_tags[tag], bytes);
+    Add(&g_total, bytes);
+}
+
+static MemTag ValidTag(MemTag tag) {
+    return (tag >= 0 && tag < MEM_TAG_COUNT) ? tag : MEM_TAG_DIAGNOSTICS;
+}
+
+// ============================================================================
+// Allocation
+// ============================================================================
+
+static void* Track(MemHeader* header, MemTag tag, size_t size) {
+    header->info.size = size;
+    header->info.tag = (uint32_t)tag;
+    Count(tag, (int64_t)size);
+    Platform_AtomicAdd64(&g_tags[tag].allocations, 1);
+    Platform_AtomicAdd64(&g_total.allocations, 1);
+    return header + 1;
+}
+
+void* MemTracker_Alloc(MemTag tag, size_t size) {
+    if (size > SIZE_MAX - sizeof(MemHeader)) return NULL;
+    MemHeader* header = (MemHeader*)malloc(sizeof(MemHeader) + size);
+    if (!header) return NULL;
+    return Track(header, ValidTag(tag), size);
+}
+
+void* MemTracker_Calloc(MemTag tag, size_t count, size_t size) {
+    if (size != 0 && count > (SIZE_MAX - sizeof(MemHeader)) / size) return NULL;
+    MemHeader* header = (MemHeader*)calloc(1, sizeof(MemHeader) + count * size);
+    if (!header) return NULL;
+    return Track(header, ValidTag(tag), count * size);
+}
+
+void* MemTracker_Realloc(MemTag tag, void* ptr, size_t size) {
+    if (!ptr) return MemTracker_Alloc(tag, size);
+    if (size > SIZE_MAX - sizeof(MemHeader)) return NULL;
+    tag = ValidTag(tag);
+
+    MemHeader* header = (MemHeader*)ptr - 1;
+    MemTag oldTag = (MemTag)header->info.tag;
+    int64_t oldSize = (int64_t)header->info.size;
+
+    MemHeader* grown = (MemHeader*)realloc(header, sizeof(MemHeader) + size);
+    if (!grown) return NULL;    // Old block untouched
+
+    Count(oldTag, -oldSize);
+    grown->info.size = size;
+    grown->info.tag = (uint32_t)tag;
+    Count(tag, (int64_t)size);
+    return grown + 1;
+}
+
+void MemTracker_Free(void* ptr) {
+    if (!ptr) return;
+    MemHeader* header = (MemHeader*)ptr - 1;
+    Count((MemTag)header->info.tag, -(int64_t)header->info.size);
+    free(header);
+}
+
+void MemTracker_Retag(void* ptr, MemTag tag) {
+    if (!ptr) return;
+    tag = ValidTag(tag);
+    MemHeader* header = (MemHeader*)ptr - 1;
+    MemTag oldTag = (MemTag)header->info.tag;
+    if (oldTag == tag) return;
+
+    int64_t size = (int64_t)header->info.size;
+    header->info.tag = (uint32_t)tag;
+    Add(&g_tags[oldTag], -size);
+    Add(&g_tags[tag], size);     // Total unchanged
+}
+
+void MemTracker_Account(MemTag tag, int64_t bytes) {
+    Count(ValidTag(tag), bytes);
+}
+
+// ============================================================================
+// Stats
+// ============================================================================
+
+static void Read(MemCounters* counters, MemTagStats* stats) {
+    stats->current = Platform_AtomicLoad64(&counters->current);
+    stats->peak = Platform_AtomicLoad64(&counters->peak);
+    stats->windowPeak = Platform_AtomicLoad64(&counters->windowPeak);
+    stats->allocations = (uint64_t)Platform_AtomicLoad64(&counters->allocations);
+}
+
+void MemTracker_GetStats(MemTag tag, MemTagStats* stats) {
+    if (!stats) return;
+    if (tag < 0 || tag >= MEM_TAG_COUNT) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    Read(&g_tags[tag], stats);
+}
+
+void MemTracker_GetTotal(MemTagStats* stats) {
+    if (!stats) return;
+    Read(&g_total, stats);
+}
+
+void MemTracker_ResetWindow(void) {
+    for (int i = 0; i < MEM_TAG_COUNT; i++) {
+        Platform_AtomicStore64(&g_tags[i].windowPeak, Platform_AtomicLoad64(&g_tags[i].current));
+    }
+    Platform_AtomicStore64(&g_total.windowPeak, Platform_AtomicLoad64(&g_total.current));
+}
+
+const char* MemTracker_TagName(MemTag tag) {
+    if (tag < 0 || tag >= MEM_TAG_COUNT) return "?";
+    return g_tagNames[tag];
+}
+
+static int FormatBytes(char* buffer, size_t size, int64_t bytes) {
+    if (bytes >= 1024 * 1024 || bytes <= -1024 * 1024) {
+        return snprintf(buffer, size, "%.1fMB", bytes / (1024.0 * 1024.0));
+    }
+    return snprintf(buffer, size, "%lldKB", (long long)(bytes / 1024));
+}
+
+int MemTracker_Format(char* buffer, size_t size) {
+    if (!buffer || size == 0) return 0;
+
+    char current[32], peak[32];
+    MemTagStats stats;
+    MemTracker_GetTotal(&stats);
+    FormatBytes(current, sizeof(current), stats.current);
+    FormatBytes(peak, sizeof(peak), stats.peak);
+    int written = snprintf(buffer, size, "total %s (peak %s)", current, peak);
+
+    for (int i = 0; i < MEM_TAG_COUNT && written >= 0 && (size_t)written < size; i++) {
+        MemTracker_GetStats((MemTag)i, &stats);
+        if (stats.current == 0 && stats.peak == 0) continue;
+        FormatBytes(current, sizeof(current), stats.current);
+        FormatBytes(peak, sizeof(peak), stats.peak);
+        written += snprintf(buffer + written, size - written, ", %s %s/%s", g_tagNames[i], current, peak);
+    }
+    return written;
+}
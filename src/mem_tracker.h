@@ -0,0 +1,72 @@
+/*
+ * Memory Tracker - Tagged heap accounting per subsystem
+ * Portable C; per-tag atomic counters, no locks
+ *
+ * The replay ring is the largest consumer but not the only one: the AAC
+ * store, audio mix and source rings, encoder staging and the deep copies
+ * made during a save all add up. Allocations go through thin wrappers that
+ * put a small header (size, tag) in front of the block, so freeing knows
+ * what to subtract. Each tag keeps current bytes, peak bytes, a peak since
+ * the last window reset (e.g. during one save) and an allocation count.
+ *
+ * Blocks from MemTracker_Alloc/Calloc/Realloc must be released with
+ * MemTracker_Free (never free(), and never the other way round). When a
+ * block changes owner - an encoded frame handed from the encoder to the
+ * replay ring - MemTracker_Retag moves its bytes to the new tag.
+ */
+
+#ifndef MEM_TRACKER_H
+#define MEM_TRACKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    MEM_TAG_VIDEO_SAMPLES = 0,  // Replay ring: encoded video
+    MEM_TAG_AUDIO_SAMPLES,      // Replay AAC store
+    MEM_TAG_SAVE,               // Deep copies while a save is muxed
+    MEM_TAG_VIDEO_ENCODER,      // Encoded frames in flight, encoder input staging
+    MEM_TAG_AUDIO_ENCODER,      // AAC input staging
+    MEM_TAG_AUDIO_CAPTURE,      // Mix buffer, per-source rings
+    MEM_TAG_CAPTURE,            // CPU copies of captured frames
+    MEM_TAG_DIAGNOSTICS,        // Logger queue, trace rings
+    MEM_TAG_COUNT
+} MemTag;
+
+typedef struct {
+    int64_t current;            // Bytes
+    int64_t peak;
+    int64_t windowPeak;         // Since MemTracker_ResetWindow
+    uint64_t allocations;
+} MemTagStats;
+
+void* MemTracker_Alloc(MemTag tag, size_t size);
+void* MemTracker_Calloc(MemTag tag, size_t count, size_t size);
+
+// Like realloc; the block ends up under 'tag'
+void* MemTracker_Realloc(MemTag tag, void* ptr, size_t size);
+
+void MemTracker_Free(void* ptr);
+
+// Move a block's bytes to another tag (ownership handed over)
+void MemTracker_Retag(void* ptr, MemTag tag);
+
+// Count memory not allocated here (static buffers): +bytes when it comes
+// into use, -bytes when it is released
+void MemTracker_Account(MemTag tag, int64_t bytes);
+
+void MemTracker_GetStats(MemTag tag, MemTagStats* stats);
+
+// All tags together (peaks are of the total, not sums of tag peaks)
+void MemTracker_GetTotal(MemTagStats* stats);
+
+// Start a new window: every windowPeak restarts from its current value
+void MemTracker_ResetWindow(void);
+
+const char* MemTracker_TagName(MemTag tag);
+
+// One line: "total 412.3MB (peak 530.1MB), video 398.2MB, audio 3.1MB, ..."
+// listing tags with memory in use. Returns chars written (snprintf rules).
+int MemTracker_Format(char* buffer, size_t size);
+
+#endif // MEM_TRACKER_H
@@ -0,0 +1,269 @@
+/*
+ * Metrics Implementation
+ * Sequence-locked snapshot and Prometheus / JSON rendering
+ */
+
+#include "metrics.h"
+#include "frame_pacer.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+typedef volatile LONG64 MetricsSequence;
+static uint64_t Sequence_Load(MetricsSequence* s) { return (uint64_t)InterlockedCompareExchange64(s, 0, 0); }
+static void Sequence_Store(MetricsSequence* s, uint64_t v) { InterlockedExchange64(s, (LONG64)v); }
+static void Fence(void) { MemoryBarrier(); }
+static void Pause(void) { YieldProcessor(); }
+#else
+typedef volatile uint64_t MetricsSequence;
+static uint64_t Sequence_Load(MetricsSequence* s) { return __atomic_load_n(s, __ATOMIC_ACQUIRE); }
+static void Sequence_Store(MetricsSequence* s, uint64_t v) { __atomic_store_n(s, v, __ATOMIC_RELEASE); }
+static void Fence(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+static void Pause(void) { }
+#endif
+
+#define UNITS_PER_MS    (FRAME_PACER_UNITS_PER_SECOND / 1000)
+
+static MetricsSequence g_sequence;      // Even: stable, odd: being written, 0: never published
+static MetricsSnapshot g_snapshot;
+static int64_t g_publishedAt;
+
+// ============================================================================
+// Snapshot
+// ============================================================================
+
+void Metrics_Publish(const MetricsSnapshot* snapshot) {
+    if (!snapshot) return;
+    uint64_t sequence = Sequence_Load(&g_sequence);
+    Sequence_Store(&g_sequence, sequence + 1);
+    Fence();
+    memcpy(&g_snapshot, snapshot, sizeof(g_snapshot));
+    g_publishedAt = FramePacer_Now();
+    Fence();
+    Sequence_Store(&g_sequence, sequence + 2);
+}
+
+bool Metrics_Read(MetricsSnapshot* snapshot, int64_t* ageMs) {
+    if (!snapshot) return false;
+    int64_t publishedAt;
+
+    for (;;) {
+        uint64_t before = Sequence_Load(&g_sequence);
+        if (before == 0) return false;
+        if (before & 1) {
+            Pause();
+            continue;
+        }
+        Fence();
+        memcpy(snapshot, &g_snapshot, sizeof(*snapshot));
+        publishedAt = g_publishedAt;
+        Fence();
+        if (Sequence_Load(&g_sequence) == before) break;
+    }
+
+    if (ageMs) *ageMs = (FramePacer_Now() - publishedAt) / UNITS_PER_MS;
+    return true;
+}
+
+// ============================================================================
+// Rendering
+// ============================================================================
+
+typedef struct {
+    char* buffer;
+    size_t size;
+    int written;                // Chars the full output needs
+} MetricsWriter;
+
+static void Append(MetricsWriter* w, const char* format, ...) {
+    size_t used = (size_t)w->written < w->size ? (size_t)w->written : w->size;
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(w->buffer + used, w->size - used, format, args);
+    va_end(args);
+    if (n > 0) w->written += n;
+}
+
+static double Seconds(int64_t units) {
+    return (double)units / FRAME_PACER_UNITS_PER_SECOND;
+}
+
+static double Milliseconds(int64_t units) {
+    return (double)units / UNITS_PER_MS;
+}
+
+static void Metric(MetricsWriter* w, const char* name, const char* type, const char* help) {
+    Append(w, "# HELP lwsr_%s %s\n# TYPE lwsr_%s %s\n", name, help, name, type);
+}
+
+int Metrics_FormatPrometheus(const MetricsSnapshot* s, int64_t ageMs, char* buffer, size_t size) {
+    if (!s || !buffer || size == 0) return 0;
+    MetricsWriter w = { buffer, size, 0 };
+    buffer[0] = '\0';
+
+    Metric(&w, "snapshot_age_seconds", "gauge", "Time since the replay thread last published");
+    Append(&w, "lwsr_snapshot_age_seconds %.3f\n", ageMs / 1000.0);
+    Metric(&w, "buffering", "gauge", "1 while the replay buffer is running");
+    Append(&w, "lwsr_buffering %d\n", s->buffering ? 1 : 0);
+
+    Metric(&w, "buffer_seconds", "gauge", "Video held in the replay buffer");
+    Append(&w, "lwsr_buffer_seconds %.3f\n", s->bufferSeconds);
+    Metric(&w, "buffer_target_seconds", "gauge", "Configured replay duration");
+    Append(&w, "lwsr_buffer_target_seconds %d\n", s->targetSeconds);
+    Metric(&w, "buffer_bytes", "gauge", "Encoded video in the replay buffer");
+    Append(&w, "lwsr_buffer_bytes %lld\n", (long long)s->bufferBytes);
+    Metric(&w, "buffer_frames", "gauge", "Samples in the replay buffer");
+    Append(&w, "lwsr_buffer_frames %d\n", s->bufferFrames);
+
+    Metric(&w, "frames_total", "counter", "Frames this run by outcome");
+    Append(&w, "lwsr_frames_total{outcome=\"attempted\"} %llu\n", (unsigned long long)s->framesAttempted);
+    Append(&w, "lwsr_frames_total{outcome=\"submitted\"} %llu\n", (unsigned long long)s->framesSubmitted);
+    Append(&w, "lwsr_frames_total{outcome=\"encoded\"} %llu\n", (unsigned long long)s->framesEncoded);
+    Append(&w, "lwsr_frames_total{outcome=\"coalesced\"} %llu\n", (unsigned long long)s->framesCoalesced);
+    Metric(&w, "encoder_in_flight", "gauge", "Frames submitted to the encoder and not yet returned");
+    Append(&w, "lwsr_encoder_in_flight %d\n", s->encoderInFlight);
+
+    Metric(&w, "frames_dropped_total", "counter", "Frames dropped this run by reason");
+    Append(&w, "lwsr_frames_dropped_total{reason=\"capture\"} %llu\n", (unsigned long long)s->captureDropped);
+    Append(&w, "lwsr_frames_dropped_total{reason=\"convert\"} %llu\n", (unsigned long long)s->convertFailed);
+    Append(&w, "lwsr_frames_dropped_total{reason=\"encode\"} %llu\n", (unsigned long long)s->encodeFailed);
+    for (int i = DROP_NONE + 1; i < DROP_REASON_COUNT; i++) {
+        Append(&w, "lwsr_frames_dropped_total{reason=\"%s\"} %llu\n", Backpressure_ReasonName((DropReason)i),
+               (unsigned long long)s->dropped[i]);
+    }
+
+    Metric(&w, "stage_latency_seconds", "summary", "Pipeline stage latency this run");
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+        const LatencySummary* l = &s->latency[i];
+        const char* stage = PipelineLatency_StageName((LatencyStage)i);
+        Append(&w, "lwsr_stage_latency_seconds{stage=\"%s\",quantile=\"0.5\"} %.6f\n", stage, Seconds(l->p50));
+        Append(&w, "lwsr_stage_latency_seconds{stage=\"%s\",quantile=\"0.99\"} %.6f\n", stage, Seconds(l->p99));
+        Append(&w, "lwsr_stage_latency_seconds{stage=\"%s\",quantile=\"0.999\"} %.6f\n", stage, Seconds(l->p999));
+        Append(&w, "lwsr_stage_latency_seconds_sum{stage=\"%s\"} %.6f\n", stage, l->mean * l->count / FRAME_PACER_UNITS_PER_SECOND);
+        Append(&w, "lwsr_stage_latency_seconds_count{stage=\"%s\"} %llu\n", stage, (unsigned long long)l->count);
+    }
+    Metric(&w, "stage_latency_max_seconds", "gauge", "Slowest sample per stage this run");
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+        Append(&w, "lwsr_stage_latency_max_seconds{stage=\"%s\"} %.6f\n",
+               PipelineLatency_StageName((LatencyStage)i), Seconds(s->latency[i].max));
+    }
+
+    Metric(&w, "audio_active", "gauge", "1 while audio is being captured");
+    Append(&w, "lwsr_audio_active %d\n", s->audioActive ? 1 : 0);
+    Metric(&w, "audio_buffer_seconds", "gauge", "Audio held in the replay buffer");
+    Append(&w, "lwsr_audio_buffer_seconds %.3f\n", s->audioSeconds);
+    Metric(&w, "audio_buffer_frames", "gauge", "AAC frames in the replay buffer");
+    Append(&w, "lwsr_audio_buffer_frames %d\n", s->audioSamples);
+    Metric(&w, "audio_discontinuities_total", "counter", "Capture glitches reported by audio devices");
+    Append(&w, "lwsr_audio_discontinuities_total %llu\n", (unsigned long long)s->audioDiscontinuities);
+    Metric(&w, "audio_overflow_bytes_total", "counter", "Captured PCM dropped because a buffer was full");
+    Append(&w, "lwsr_audio_overflow_bytes_total %llu\n", (unsigned long long)s->audioOverflowBytes);
+
+    Metric(&w, "saves_total", "counter", "Replay saves by result");
+    Append(&w, "lwsr_saves_total{result=\"ok\"} %llu\n", (unsigned long long)(s->saves - s->saveFailures));
+    Append(&w, "lwsr_saves_total{result=\"failed\"} %llu\n", (unsigned long long)s->saveFailures);
+    Metric(&w, "last_save_seconds", "gauge", "Duration of the most recent save");
+    Append(&w, "lwsr_last_save_seconds %.3f\n", s->lastSaveSeconds);
+
+    Metric(&w, "memory_bytes", "gauge", "Heap in use by subsystem");
+    Append(&w, "lwsr_memory_bytes{subsystem=\"total\"} %lld\n", (long long)s->memoryTotal.current);
+    for (int i = 0; i < MEM_TAG_COUNT; i++) {
+        Append(&w, "lwsr_memory_bytes{subsystem=\"%s\"} %lld\n", MemTracker_TagName((MemTag)i),
+               (long long)s->memory[i].current);
+    }
+    Metric(&w, "memory_peak_bytes", "gauge", "Highest heap use by subsystem");
+    Append(&w, "lwsr_memory_peak_bytes{subsystem=\"total\"} %lld\n", (long long)s->memoryTotal.peak);
+    for (int i = 0; i < MEM_TAG_COUNT; i++) {
+        Append(&w, "lwsr_memory_peak_bytes{subsystem=\"%s\"} %lld\n", MemTracker_TagName((MemTag)i),
+               (long long)s->memory[i].peak);
+    }
+
+    Metric(&w, "thread_cpu_seconds_total", "counter", "CPU time (user + kernel) per pipeline thread");
+    for (int i = 0; i < s->threadCount; i++) {
+        const ThreadStats* t = &s->threads[i];
+        Append(&w, "lwsr_thread_cpu_seconds_total{thread=\"%s\",tid=\"%u\",role=\"%s\"} %.3f\n",
+               t->name, t->threadId, ThreadRegistry_RoleName(t->role), Seconds(t->cpuTime));
+    }
+    Metric(&w, "thread_context_switches_total", "counter", "Context switches per pipeline thread");
+    for (int i = 0; i < s->threadCount; i++) {
+        const ThreadStats* t = &s->threads[i];
+        Append(&w, "lwsr_thread_context_switches_total{thread=\"%s\",tid=\"%u\",role=\"%s\"} %llu\n",
+               t->name, t->threadId, ThreadRegistry_RoleName(t->role), (unsigned long long)t->contextSwitches);
+    }
+    Metric(&w, "thread_priority_level", "gauge", "Priority in effect per pipeline thread (-1 below normal to 3 time critical)");
+    for (int i = 0; i < s->threadCount; i++) {
+        const ThreadStats* t = &s->threads[i];
+        Append(&w, "lwsr_thread_priority_level{thread=\"%s\",tid=\"%u\",role=\"%s\"} %d\n",
+               t->name, t->threadId, ThreadRegistry_RoleName(t->role), (int)t->level);
+    }
+    Metric(&w, "role_cpu_seconds_total", "counter", "CPU time by thread role, including exited threads");
+    for (int i = 0; i < THREAD_ROLE_COUNT; i++) {
+        Append(&w, "lwsr_role_cpu_seconds_total{role=\"%s\"} %.3f\n",
+               ThreadRegistry_RoleName((ThreadRole)i), Seconds(s->roleCpu[i]));
+    }
+
+    return w.written;
+}
+
+int Metrics_FormatJson(const MetricsSnapshot* s, int64_t ageMs, char* buffer, size_t size) {
+    if (!s || !buffer || size == 0) return 0;
+    MetricsWriter w = { buffer, size, 0 };
+    buffer[0] = '\0';
+
+    Append(&w, "{\"age_ms\":%lld,\"buffering\":%s,", (long long)ageMs, s->buffering ? "true" : "false");
+    Append(&w, "\"buffer\":{\"seconds\":%.3f,\"target_seconds\":%d,\"bytes\":%lld,\"frames\":%d},",
+           s->bufferSeconds, s->targetSeconds, (long long)s->bufferBytes, s->bufferFrames);
+    Append(&w, "\"frames\":{\"attempted\":%llu,\"submitted\":%llu,\"encoded\":%llu,\"coalesced\":%llu,\"in_flight\":%d},",
+           (unsigned long long)s->framesAttempted, (unsigned long long)s->framesSubmitted,
+           (unsigned long long)s->framesEncoded, (unsigned long long)s->framesCoalesced, s->encoderInFlight);
+
+    Append(&w, "\"drops\":{\"capture\":%llu,\"convert\":%llu,\"encode\":%llu",
+           (unsigned long long)s->captureDropped, (unsigned long long)s->convertFailed,
+           (unsigned long long)s->encodeFailed);
+    for (int i = DROP_NONE + 1; i < DROP_REASON_COUNT; i++) {
+        Append(&w, ",\"%s\":%llu", Backpressure_ReasonName((DropReason)i), (unsigned long long)s->dropped[i]);
+    }
+    Append(&w, "},");
+
+    Append(&w, "\"latency_ms\":{");
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+        const LatencySummary* l = &s->latency[i];
+        Append(&w, "%s\"%s\":{\"count\":%llu,\"p50\":%.3f,\"p99\":%.3f,\"p999\":%.3f,\"max\":%.3f}",
+               i > 0 ? "," : "", PipelineLatency_StageName((LatencyStage)i), (unsigned long long)l->count,
+               Milliseconds(l->p50), Milliseconds(l->p99), Milliseconds(l->p999), Milliseconds(l->max));
+    }
+    Append(&w, "},");
+
+    Append(&w, "\"audio\":{\"active\":%s,\"seconds\":%.3f,\"frames\":%d,\"discontinuities\":%llu,\"overflow_bytes\":%llu},",
+           s->audioActive ? "true" : "false", s->audioSeconds, s->audioSamples,
+           (unsigned long long)s->audioDiscontinuities, (unsigned long long)s->audioOverflowBytes);
+    Append(&w, "\"saves\":{\"total\":%llu,\"failed\":%llu,\"last_seconds\":%.3f},",
+           (unsigned long long)s->saves, (unsigned long long)s->saveFailures, s->lastSaveSeconds);
+
+    Append(&w, "\"memory\":{\"total\":{\"current\":%lld,\"peak\":%lld}",
+           (long long)s->memoryTotal.current, (long long)s->memoryTotal.peak);
+    for (int i = 0; i < MEM_TAG_COUNT; i++) {
+        Append(&w, ",\"%s\":{\"current\":%lld,\"peak\":%lld}", MemTracker_TagName((MemTag)i),
+               (long long)s->memory[i].current, (long long)s->memory[i].peak);
+    }
+    Append(&w, "},");
+
+    Append(&w, "\"threads\":[");
+    for (int i = 0; i < s->threadCount; i++) {
+        const ThreadStats* t = &s->threads[i];
+        Append(&w, "%s{\"name\":\"%s\",\"tid\":%u,\"role\":\"%s\",\"priority\":\"%s\",\"cpu_seconds\":%.3f,\"cpu_percent\":%.1f,"
+                   "\"context_switches\":%llu,\"switches_per_second\":%.0f}",
+               i > 0 ? "," : "", t->name, t->threadId, ThreadRegistry_RoleName(t->role),
+               ThreadRegistry_LevelName(t->level), Seconds(t->cpuTime),
+               t->cpuPercent, (unsigned long long)t->contextSwitches, t->switchesPerSecond);
+    }
+    Append(&w, "],\"role_cpu_seconds\":{");
+    for (int i = 0; i < THREAD_ROLE_COUNT; i++) {
+        Append(&w, "%s\"%s\":%.3f", i > 0 ? "," : "", ThreadRegistry_RoleName((ThreadRole)i), Seconds(s->roleCpu[i]));
+    }
+    Append(&w, "}}\n");
+
+    return w.written;
+}
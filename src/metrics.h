@@ -0,0 +1,85 @@
+/*
+ * Metrics - Snapshot of pipeline health for external monitoring
+ * Portable C; one writer publishes, any number of readers copy without locks
+ *
+ * The replay thread gathers its numbers (buffer, frames, drops, stage
+ * latencies, audio, saves, memory, thread CPU) about once a second and
+ * publishes them as a single MetricsSnapshot. Publishing is a sequence
+ * lock: the sequence is odd while the snapshot is being written, and a
+ * reader retries if it saw an odd sequence or the sequence moved during
+ * its copy. The writer never waits for readers, so a scraper polling as
+ * often as it likes can't hold up the pipeline.
+ *
+ * The snapshot is rendered as Prometheus text exposition or JSON; the
+ * metrics server (metrics_server.c) serves it over a local named pipe.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "backpressure.h"
+#include "pipeline_latency.h"
+#include "mem_tracker.h"
+#include "thread_registry.h"
+
+typedef struct {
+    bool buffering;
+
+    // Replay ring
+    double bufferSeconds;
+    int64_t bufferBytes;
+    int bufferFrames;
+    int targetSeconds;          // Configured replay duration
+
+    // Frames this run
+    uint64_t framesAttempted;   // Hub deliveries taken
+    uint64_t framesSubmitted;
+    uint64_t framesEncoded;
+    uint64_t framesCoalesced;   // Static ticks held instead of encoded (VFR)
+    int encoderInFlight;
+
+    // Drops this run, by reason
+    uint64_t dropped[DROP_REASON_COUNT];    // Encoder backpressure (DROP_NONE unused)
+    uint64_t captureDropped;    // Hub ticks missed because the thread fell behind
+    uint64_t convertFailed;
+    uint64_t encodeFailed;
+
+    LatencySummary latency[LATENCY_STAGE_COUNT];
+
+    // Audio
+    bool audioActive;
+    int audioSamples;           // AAC frames in the replay store
+    double audioSeconds;
+    uint64_t audioDiscontinuities;  // Glitches reported by the capture devices
+    uint64_t audioOverflowBytes;    // PCM dropped because a ring was full
+
+    // Saves since the app started
+    uint64_t saves;
+    uint64_t saveFailures;
+    double lastSaveSeconds;
+
+    MemTagStats memory[MEM_TAG_COUNT];
+    MemTagStats memoryTotal;
+
+    // Registered pipeline threads and CPU per role (thread_registry.h)
+    ThreadStats threads[THREAD_REGISTRY_MAX];
+    int threadCount;
+    int64_t roleCpu[THREAD_ROLE_COUNT];
+} MetricsSnapshot;
+
+// Replace the published snapshot. Single writer.
+void Metrics_Publish(const MetricsSnapshot* snapshot);
+
+// Copy of the latest snapshot; 'ageMs' (optional) is how long ago it was
+// published. False if nothing has been published yet.
+bool Metrics_Read(MetricsSnapshot* snapshot, int64_t* ageMs);
+
+// Render a snapshot. Return chars written (snprintf rules: a result >= size
+// means the buffer was too small).
+int Metrics_FormatPrometheus(const MetricsSnapshot* snapshot, int64_t ageMs, char* buffer, size_t size);
+int Metrics_FormatJson(const MetricsSnapshot* snapshot, int64_t ageMs, char* buffer, size_t size);
+
+#endif // METRICS_H
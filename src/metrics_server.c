@@ -0,0 +1,180 @@
+/*
+ * Metrics Server Implementation
+ * One overlapped pipe instance, served a client at a time on its own thread
+ */
+
+#include "metrics_server.h"
+#include "metrics.h"
+#include "mem_tracker.h"
+#include "logger.h"
+#include <stdio.h>
+#include <string.h>
+
+// How long a response write may take
+#define METRICS_WRITE_TIMEOUT_MS 1000
+
+// Alias for logging
+#define MetricsLog Logger_Log
+
+static HANDLE g_serverThread = NULL;
+static HANDLE g_stopEvent = NULL;
+static char g_pipeName[128];
+
+// ============================================================================
+// Pipe I/O
+// ============================================================================
+
+// Wait for an overlapped operation. FALSE on stop, timeout or error (the
+// operation is cancelled, so the OVERLAPPED can be reused).
+static BOOL WaitIo(HANDLE pipe, OVERLAPPED* ov, DWORD timeoutMs, DWORD* bytes) {
+    HANDLE handles[2] = { ov->hEvent, g_stopEvent };
+    DWORD result = WaitForMultipleObjects(2, handles, FALSE, timeoutMs);
+    if (result != WAIT_OBJECT_0) {
+        CancelIo(pipe);
+        GetOverlappedResult(pipe, ov, bytes, TRUE);
+        return FALSE;
+    }
+    return GetOverlappedResult(pipe, ov, bytes, FALSE);
+}
+
+static BOOL WaitForClient(HANDLE pipe, OVERLAPPED* ov) {
+    DWORD bytes;
+    ResetEvent(ov->hEvent);
+    if (ConnectNamedPipe(pipe, ov)) return TRUE;
+
+    switch (GetLastError()) {
+        case ERROR_PIPE_CONNECTED:  return TRUE;    // Connected between create and connect
+        case ERROR_IO_PENDING:      return WaitIo(pipe, ov, INFINITE, &bytes);
+        default:                    return FALSE;
+    }
+}
+
+// Optional request line; returns bytes read (0 if the client sent nothing)
+static DWORD ReadRequest(HANDLE pipe, OVERLAPPED* ov, char* request, DWORD size) {
+    DWORD bytes = 0;
+    request[0] = '\0';
+    ResetEvent(ov->hEvent);
+    if (!ReadFile(pipe, request, size - 1, &bytes, ov)) {
+        if (GetLastError() != ERROR_IO_PENDING) return 0;
+        if (!WaitIo(pipe, ov, METRICS_REQUEST_TIMEOUT_MS, &bytes)) return 0;
+    }
+    request[bytes] = '\0';
+    return bytes;
+}
+
+static BOOL WriteResponse(HANDLE pipe, OVERLAPPED* ov, const char* response, DWORD size) {
+    DWORD bytes = 0;
+    ResetEvent(ov->hEvent);
+    if (!WriteFile(pipe, response, size, &bytes, ov)) {
+        if (GetLastError() != ERROR_IO_PENDING) return FALSE;
+        if (!WaitIo(pipe, ov, METRICS_WRITE_TIMEOUT_MS, &bytes)) return FALSE;
+    }
+    return bytes == size;
+}
+
+// ============================================================================
+// Server thread
+// ============================================================================
+
+static void Serve(HANDLE pipe, OVERLAPPED* ov, char* response) {
+    char request[64];
+    ReadRequest(pipe, ov, request, sizeof(request));
+    BOOL json = _strnicmp(request, "json", 4) == 0;
+
+    // Before the first publish, serve an all-zero snapshot (not buffering)
+    MetricsSnapshot snapshot;
+    int64_t ageMs = 0;
+    if (!Metrics_Read(&snapshot, &ageMs)) {
+        ZeroMemory(&snapshot, sizeof(snapshot));
+    }
+
+    int length = json ? Metrics_FormatJson(&snapshot, ageMs, response, METRICS_RESPONSE_SIZE)
+                      : Metrics_FormatPrometheus(&snapshot, ageMs, response, METRICS_RESPONSE_SIZE);
+    if (length >= METRICS_RESPONSE_SIZE) {
+        MetricsLog("Metrics: response truncated (%d bytes needed)\n", length);
+        length = METRICS_RESPONSE_SIZE - 1;
+    }
+
+    // DisconnectNamedPipe discards what the client hasn't read yet, so wait
+    // until it has (MetricsServer_Stop cancels this for a client that never reads)
+    if (length > 0 && WriteResponse(pipe, ov, response, (DWORD)length)) {
+        FlushFileBuffers(pipe);
+    }
+}
+
+static DWORD WINAPI ServerThread(LPVOID param) {
+    (void)param;
+    char* response = (char*)MemTracker_Alloc(MEM_TAG_DIAGNOSTICS, METRICS_RESPONSE_SIZE);
+    OVERLAPPED ov = {0};
+    ov.hEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!response || !ov.hEvent) {
+        MetricsLog("Metrics: server thread setup failed\n");
+        MemTracker_Free(response);
+        if (ov.hEvent) CloseHandle(ov.hEvent);
+        return 1;
+    }
+
+    while (WaitForSingleObject(g_stopEvent, 0) != WAIT_OBJECT_0) {
+        HANDLE pipe = CreateNamedPipeA(g_pipeName,
+            PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED,
+            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+            1, METRICS_RESPONSE_SIZE, 512, 0, NULL);
+        if (pipe == INVALID_HANDLE_VALUE) {
+            MetricsLog("Metrics: CreateNamedPipe failed (%lu), retrying\n", GetLastError());
+            WaitForSingleObject(g_stopEvent, 1000);
+            continue;
+        }
+
+        if (WaitForClient(pipe, &ov)) {
+            Serve(pipe, &ov, response);
+        }
+        DisconnectNamedPipe(pipe);
+        CloseHandle(pipe);
+    }
+
+    CloseHandle(ov.hEvent);
+    MemTracker_Free(response);
+    return 0;
+}
+
+// ============================================================================
+// Lifecycle
+// ============================================================================
+
+BOOL MetricsServer_Start(const char* pipeName) {
+    if (g_serverThread) return TRUE;
+    if (!pipeName || !pipeName[0]) return FALSE;
+
+    strncpy(g_pipeName, pipeName, sizeof(g_pipeName) - 1);
+    g_pipeName[sizeof(g_pipeName) - 1] = '\0';
+
+    g_stopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!g_stopEvent) return FALSE;
+
+    g_serverThread = CreateThread(NULL, 0, ServerThread, NULL, 0, NULL);
+    if (!g_serverThread) {
+        CloseHandle(g_stopEvent);
+        g_stopEvent = NULL;
+        return FALSE;
+    }
+
+    MetricsLog("Metrics: serving on %s\n", g_pipeName);
+    return TRUE;
+}
+
+BOOL MetricsServer_Stop(void) {
+    if (!g_serverThread) return TRUE;
+
+    SetEvent(g_stopEvent);
+    CancelSynchronousIo(g_serverThread);    // A flush waiting on a stuck client
+    if (WaitForSingleObject(g_serverThread, 2000) != WAIT_OBJECT_0) {
+        // It still waits on g_stopEvent and reads g_pipeName: leak them
+        MetricsLog("Metrics: server thread did not exit, leaking it\n");
+        return FALSE;
+    }
+    CloseHandle(g_serverThread);
+    CloseHandle(g_stopEvent);
+    g_serverThread = NULL;
+    g_stopEvent = NULL;
+    return TRUE;
+}
@@ -0,0 +1,25 @@
+/*
+ * Metrics Server - Serves the pipeline metrics snapshot on a local named pipe
+ *
+ * Off unless started (--metrics). A client connects to METRICS_PIPE_NAME,
+ * may write "json" to get JSON (anything else, or nothing within
+ * METRICS_REQUEST_TIMEOUT_MS, gets Prometheus text), then reads until the
+ * server closes its end. Each response is rendered from the snapshot the
+ * replay thread last published (metrics.h), so serving never takes a
+ * pipeline lock. Remote clients are rejected.
+ */
+
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <windows.h>
+
+#define METRICS_PIPE_NAME           "\\\\.\\pipe\\lwsr-metrics"
+#define METRICS_REQUEST_TIMEOUT_MS  100
+#define METRICS_RESPONSE_SIZE       (64 * 1024)
+
+BOOL MetricsServer_Start(const char* pipeName);
+// FALSE if the server thread did not exit within 2s (its handles are leaked)
+BOOL MetricsServer_Stop(void);
+
+#endif // METRICS_SERVER_H
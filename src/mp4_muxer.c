@@ -19,6 +19,10 @@ static const GUID MFVideoFormat_HEVC_Local =
 // Alias for logging
 #define MuxLog Logger_Log
 
+static const GUID* VideoSubtype(VideoCodec codec) {
+    return codec == VIDEO_CODEC_H264 ? &MFVideoFormat_H264 : &MFVideoFormat_HEVC_Local;
+}
+
 BOOL MP4Muxer_WriteFile(
     const char* outputPath,
     const MuxerSample* samples,
@@ -66,7 +70,7 @@ BOOL MP4Muxer_WriteFile(
     UINT32 bitrate = Util_CalculateBitrate(config->width, config->height, config->fps, config->quality);
     
     outputType->lpVtbl->SetGUID(outputType, &MF_MT_MAJOR_TYPE, &MFMediaType_Video);
-    outputType->lpVtbl->SetGUID(outputType, &MF_MT_SUBTYPE, &MFVideoFormat_HEVC_Local);
+    outputType->lpVtbl->SetGUID(outputType, &MF_MT_SUBTYPE, VideoSubtype(config->codec));
     outputType->lpVtbl->SetUINT32(outputType, &MF_MT_AVG_BITRATE, bitrate);
     outputType->lpVtbl->SetUINT32(outputType, &MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive);
     // Note: MF_MT_MPEG2_PROFILE is technically for H.264, but MF accepts it for HEVC passthrough
@@ -258,7 +262,7 @@ BOOL MP4Muxer_WriteFileWithAudio(
                                            videoConfig->fps, videoConfig->quality);
     
     videoType->lpVtbl->SetGUID(videoType, &MF_MT_MAJOR_TYPE, &MFMediaType_Video);
-    videoType->lpVtbl->SetGUID(videoType, &MF_MT_SUBTYPE, &MFVideoFormat_HEVC_Local);
+    videoType->lpVtbl->SetGUID(videoType, &MF_MT_SUBTYPE, VideoSubtype(videoConfig->codec));
     videoType->lpVtbl->SetUINT32(videoType, &MF_MT_AVG_BITRATE, bitrate);
     videoType->lpVtbl->SetUINT32(videoType, &MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive);
     // Note: For HEVC passthrough, profile is embedded in VPS/SPS from encoder
@@ -450,3 +454,219 @@ BOOL MP4Muxer_WriteFileWithAudio(
     
     return success;
 }
+
+// ============================================================================
+// Streaming writer
+// ============================================================================
+
+struct MP4Muxer {
+    IMFSinkWriter* writer;
+    DWORD videoStreamIndex;
+    DWORD audioStreamIndex;
+    BOOL hasAudio;
+    
+    volatile LONG videoWritten;
+    volatile LONG audioWritten;
+    int writeErrors;
+    LONGLONG lastVideoEnd;      // End of newest video sample (for logging)
+    
+    CRITICAL_SECTION lock;      // Serializes WriteSample from encoder/audio threads
+};
+
+static BOOL WriteStreamSample(MP4Muxer* muxer, DWORD streamIndex, const BYTE* data, DWORD size,
+                              LONGLONG timestamp, LONGLONG duration, BOOL isKeyframe) {
+    IMFMediaBuffer* mfBuffer = NULL;
+    HRESULT hr = MFCreateMemoryBuffer(size, &mfBuffer);
+    if (FAILED(hr)) return FALSE;
+    
+    BYTE* bufData = NULL;
+    hr = mfBuffer->lpVtbl->Lock(mfBuffer, &bufData, NULL, NULL);
+    if (FAILED(hr)) {
+        mfBuffer->lpVtbl->Release(mfBuffer);
+        return FALSE;
+    }
+    memcpy(bufData, data, size);
+    mfBuffer->lpVtbl->Unlock(mfBuffer);
+    mfBuffer->lpVtbl->SetCurrentLength(mfBuffer, size);
+    
+    IMFSample* mfSample = NULL;
+    hr = MFCreateSample(&mfSample);
+    if (FAILED(hr)) {
+        mfBuffer->lpVtbl->Release(mfBuffer);
+        return FALSE;
+    }
+    
+    mfSample->lpVtbl->AddBuffer(mfSample, mfBuffer);
+    mfSample->lpVtbl->SetSampleTime(mfSample, timestamp);
+    mfSample->lpVtbl->SetSampleDuration(mfSample, duration);
+    if (isKeyframe) {
+        mfSample->lpVtbl->SetUINT32(mfSample, &MFSampleExtension_CleanPoint, TRUE);
+    }
+    
+    EnterCriticalSection(&muxer->lock);
+    hr = muxer->writer->lpVtbl->WriteSample(muxer->writer, streamIndex, mfSample);
+    if (FAILED(hr) && ++muxer->writeErrors <= 5) {
+        MuxLog("MP4Muxer: WriteSample (stream %u) failed 0x%08X\n", streamIndex, hr);
+    }
+    LeaveCriticalSection(&muxer->lock);
+    
+    mfSample->lpVtbl->Release(mfSample);
+    mfBuffer->lpVtbl->Release(mfBuffer);
+    
+    return SUCCEEDED(hr);
+}
+
+MP4Muxer* MP4Muxer_Open(const char* outputPath, const MuxerConfig* videoConfig,
+                        const MuxerAudioConfig* audioConfig) {
+    if (!outputPath || !videoConfig) {
+        MuxLog("MP4Muxer: Invalid parameters\n");
+        return NULL;
+    }
+    
+    MuxLog("MP4Muxer: Opening %s for streaming (%dx%d @ %d fps, audio=%s)\n",
+           outputPath, videoConfig->width, videoConfig->height, videoConfig->fps,
+           audioConfig ? "yes" : "no");
+    
+    MP4Muxer* muxer = (MP4Muxer*)calloc(1, sizeof(MP4Muxer));
+    if (!muxer) return NULL;
+    InitializeCriticalSection(&muxer->lock);
+    
+    WCHAR wPath[MAX_PATH];
+    MultiByteToWideChar(CP_ACP, 0, outputPath, -1, wPath, MAX_PATH);
+    
+    // Samples arrive in real time from two threads; don't let the sink
+    // writer block the encoder output thread waiting for the other stream
+    IMFAttributes* attrs = NULL;
+    HRESULT hr = MFCreateAttributes(&attrs, 2);
+    if (SUCCEEDED(hr)) {
+        attrs->lpVtbl->SetUINT32(attrs, &MF_SINK_WRITER_DISABLE_THROTTLING, TRUE);
+        attrs->lpVtbl->SetUINT32(attrs, &MF_LOW_LATENCY, TRUE);
+    }
+    
+    hr = MFCreateSinkWriterFromURL(wPath, NULL, attrs, &muxer->writer);
+    if (attrs) attrs->lpVtbl->Release(attrs);
+    if (FAILED(hr)) {
+        MuxLog("MP4Muxer: MFCreateSinkWriterFromURL failed 0x%08X\n", hr);
+        goto fail;
+    }
+    
+    // === VIDEO STREAM (passthrough) ===
+    IMFMediaType* videoType = NULL;
+    hr = MFCreateMediaType(&videoType);
+    if (FAILED(hr)) goto fail;
+    
+    UINT32 bitrate = Util_CalculateBitrate(videoConfig->width, videoConfig->height,
+                                           videoConfig->fps, videoConfig->quality);
+    
+    videoType->lpVtbl->SetGUID(videoType, &MF_MT_MAJOR_TYPE, &MFMediaType_Video);
+    videoType->lpVtbl->SetGUID(videoType, &MF_MT_SUBTYPE, VideoSubtype(videoConfig->codec));
+    videoType->lpVtbl->SetUINT32(videoType, &MF_MT_AVG_BITRATE, bitrate);
+    videoType->lpVtbl->SetUINT32(videoType, &MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive);
+    videoType->lpVtbl->SetUINT64(videoType, &MF_MT_FRAME_SIZE,
+                                 ((UINT64)videoConfig->width << 32) | videoConfig->height);
+    videoType->lpVtbl->SetUINT64(videoType, &MF_MT_FRAME_RATE, ((UINT64)videoConfig->fps << 32) | 1);
+    videoType->lpVtbl->SetUINT64(videoType, &MF_MT_PIXEL_ASPECT_RATIO, ((UINT64)1 << 32) | 1);
+    
+    if (videoConfig->seqHeader && videoConfig->seqHeaderSize > 0) {
+        videoType->lpVtbl->SetBlob(videoType, &MF_MT_MPEG_SEQUENCE_HEADER,
+                                   videoConfig->seqHeader, videoConfig->seqHeaderSize);
+    }
+    
+    hr = muxer->writer->lpVtbl->AddStream(muxer->writer, videoType, &muxer->videoStreamIndex);
+    if (SUCCEEDED(hr)) {
+        hr = muxer->writer->lpVtbl->SetInputMediaType(muxer->writer, muxer->videoStreamIndex, videoType, NULL);
+    }
+    videoType->lpVtbl->Release(videoType);
+    if (FAILED(hr)) {
+        MuxLog("MP4Muxer: Video stream setup failed 0x%08X\n", hr);
+        goto fail;
+    }
+    
+    // === AUDIO STREAM (passthrough) ===
+    if (audioConfig) {
+        IMFMediaType* audioType = NULL;
+        hr = MFCreateMediaType(&audioType);
+        if (FAILED(hr)) goto fail;
+        
+        audioType->lpVtbl->SetGUID(audioType, &MF_MT_MAJOR_TYPE, &MFMediaType_Audio);
+        audioType->lpVtbl->SetGUID(audioType, &MF_MT_SUBTYPE, &MFAudioFormat_AAC);
+        audioType->lpVtbl->SetUINT32(audioType, &MF_MT_AUDIO_SAMPLES_PER_SECOND, audioConfig->sampleRate);
+        audioType->lpVtbl->SetUINT32(audioType, &MF_MT_AUDIO_NUM_CHANNELS, audioConfig->channels);
+        audioType->lpVtbl->SetUINT32(audioType, &MF_MT_AUDIO_BITS_PER_SAMPLE, 16);
+        audioType->lpVtbl->SetUINT32(audioType, &MF_MT_AUDIO_AVG_BYTES_PER_SECOND, audioConfig->bitrate / 8);
+        audioType->lpVtbl->SetUINT32(audioType, &MF_MT_AAC_PAYLOAD_TYPE, 0);  // Raw AAC
+        if (audioConfig->configData && audioConfig->configSize > 0) {
+            audioType->lpVtbl->SetBlob(audioType, &MF_MT_USER_DATA,
+                                       audioConfig->configData, audioConfig->configSize);
+        }
+        
+        hr = muxer->writer->lpVtbl->AddStream(muxer->writer, audioType, &muxer->audioStreamIndex);
+        if (SUCCEEDED(hr)) {
+            hr = muxer->writer->lpVtbl->SetInputMediaType(muxer->writer, muxer->audioStreamIndex, audioType, NULL);
+        }
+        audioType->lpVtbl->Release(audioType);
+        if (FAILED(hr)) {
+            MuxLog("MP4Muxer: Audio stream setup failed 0x%08X\n", hr);
+            goto fail;
+        }
+        muxer->hasAudio = TRUE;
+    }
+    
+    hr = muxer->writer->lpVtbl->BeginWriting(muxer->writer);
+    if (FAILED(hr)) {
+        MuxLog("MP4Muxer: BeginWriting failed 0x%08X\n", hr);
+        goto fail;
+    }
+    
+    return muxer;
+    
+fail:
+    if (muxer->writer) muxer->writer->lpVtbl->Release(muxer->writer);
+    DeleteCriticalSection(&muxer->lock);
+    free(muxer);
+    return NULL;
+}
+
+BOOL MP4Muxer_WriteVideo(MP4Muxer* muxer, const MuxerSample* sample) {
+    if (!muxer || !sample || !sample->data || sample->size == 0) return FALSE;
+    
+    if (!WriteStreamSample(muxer, muxer->videoStreamIndex, sample->data, sample->size,
+                           sample->timestamp, sample->duration, sample->isKeyframe)) {
+        return FALSE;
+    }
+    
+    InterlockedIncrement(&muxer->videoWritten);
+    muxer->lastVideoEnd = sample->timestamp + sample->duration;
+    return TRUE;
+}
+
+BOOL MP4Muxer_WriteAudio(MP4Muxer* muxer, const MuxerAudioSample* sample) {
+    if (!muxer || !muxer->hasAudio || !sample || !sample->data || sample->size == 0) return FALSE;
+    
+    if (!WriteStreamSample(muxer, muxer->audioStreamIndex, sample->data, sample->size,
+                           sample->timestamp, sample->duration, FALSE)) {
+        return FALSE;
+    }
+    
+    InterlockedIncrement(&muxer->audioWritten);
+    return TRUE;
+}
+
+BOOL MP4Muxer_Close(MP4Muxer* muxer) {
+    if (!muxer) return FALSE;
+    
+    HRESULT hr = muxer->writer->lpVtbl->Finalize(muxer->writer);
+    if (FAILED(hr)) {
+        MuxLog("MP4Muxer: Finalize failed with HRESULT 0x%08X\n", hr);
+    }
+    muxer->writer->lpVtbl->Release(muxer->writer);
+    
+    BOOL success = SUCCEEDED(hr) && muxer->videoWritten > 0;
+    MuxLog("MP4Muxer: Closed stream (%ld video, %ld audio samples, %.2fs) %s\n",
+           muxer->videoWritten, muxer->audioWritten, (double)muxer->lastVideoEnd / 10000000.0,
+           success ? "OK" : "FAILED");
+    
+    DeleteCriticalSection(&muxer->lock);
+    free(muxer);
+    return success;
+}
@@ -7,7 +7,7 @@
 #ifndef MP4_MUXER_H
 #define MP4_MUXER_H
 
-#include <windows.h>
+#include "platform.h"
 #include "config.h"
 
 // Sample data for muxing (copies data from buffer)
@@ -33,7 +33,8 @@ typedef struct {
     int height;             // Video height
     int fps;                // Frame rate
     QualityPreset quality;  // For bitrate calculation
-    BYTE* seqHeader;        // HEVC VPS/SPS/PPS sequence header
+    VideoCodec codec;       // Bitstream format of the samples
+    BYTE* seqHeader;        // VPS/SPS/PPS (HEVC) or SPS/PPS (H.264) sequence header
     DWORD seqHeaderSize;    // Size of sequence header
 } MuxerConfig;
 
@@ -67,4 +68,23 @@ BOOL MP4Muxer_WriteFileWithAudio(
     const MuxerAudioConfig* audioConfig
 );
 
+// ============================================================================
+// Streaming writer (incremental recording)
+// ============================================================================
+
+typedef struct MP4Muxer MP4Muxer;
+
+// Open an MP4 file for incremental writing. audioConfig may be NULL (video only).
+// videoConfig->seqHeader must be set (first keyframe's parameter sets).
+MP4Muxer* MP4Muxer_Open(const char* outputPath, const MuxerConfig* videoConfig,
+                        const MuxerAudioConfig* audioConfig);
+
+// Append one sample. Timestamps are relative to the start of the file.
+// Thread-safe: video and audio may be written from different threads.
+BOOL MP4Muxer_WriteVideo(MP4Muxer* muxer, const MuxerSample* sample);
+BOOL MP4Muxer_WriteAudio(MP4Muxer* muxer, const MuxerAudioSample* sample);
+
+// Finalize the file and free the muxer. Returns TRUE if a playable file was written.
+BOOL MP4Muxer_Close(MP4Muxer* muxer);
+
 #endif // MP4_MUXER_H
@@ -19,7 +19,12 @@
  */
 
 #include "nvenc_encoder.h"
+#include "util.h"
 #include "logger.h"
+#include "trace.h"
+#include "flight_recorder.h"
+#include "thread_registry.h"
+#include "mem_tracker.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -36,9 +41,7 @@
 // Constants
 // ============================================================================
 
-// Per API docs (line 3444-3445): "at least 4 more than number of B frames"
-// With no B-frames, minimum is 4. We use 8 for better pipelining.
-#define NUM_BUFFERS 8
+#define NUM_BUFFERS NVENC_NUM_BUFFERS
 
 // ============================================================================
 // Encoder State
@@ -99,10 +102,20 @@ struct NVENCEncoder {
     int submitIndex;    // Next buffer to use for submission
     int retrieveIndex;  // Next buffer to retrieve from
     volatile LONG pendingCount;  // Frames in flight
+    FlightRecorderGauge queueGauge;  // Where pendingCount is published
     
     // Frame counter
     uint64_t frameNumber;
     
+    // Keyframe cadence is timeline-based (variable frame rate safe)
+    LONGLONG keyframeInterval;  // 100-ns units
+    LONGLONG lastIdrTimestamp;
+    BOOL idrPending;            // Reconfigure reset the GOP; next frame is the IDR
+    
+    // Session parameters, kept for nvEncReconfigureEncoder
+    NV_ENC_CONFIG encodeConfig;
+    NV_ENC_INITIALIZE_PARAMS initParams;
+    
     // Output thread (per API lines 3384-3388)
     HANDLE outputThread;
     volatile BOOL stopThread;
@@ -160,6 +173,7 @@ NVENCEncoder* NVENCEncoder_Create(ID3D11Device* d3dDevice, int width, int height
     enc->height = height;
     enc->fps = fps;
     enc->frameDuration = 10000000ULL / fps;
+    enc->keyframeInterval = VIDEO_ENCODER_KEYFRAME_MS * 10000LL;  // IDR every 2 seconds of timeline
     
     InitializeCriticalSection(&enc->submitLock);
     
@@ -284,56 +298,51 @@ NVENCEncoder* NVENCEncoder_Create(ID3D11Device* d3dDevice, int width, int height
     }
     
     // Customize config for screen recording
-    NV_ENC_CONFIG config = presetConfig.presetCfg;
-    config.gopLength = fps * 2;  // 2-second GOP for seeking
-    config.frameIntervalP = 1;   // No B-frames (confirmed by user)
+    NV_ENC_CONFIG* config = &enc->encodeConfig;
+    *config = presetConfig.presetCfg;
+    config->gopLength = fps * VIDEO_ENCODER_KEYFRAME_MS / 1000;  // 2-second GOP for seeking
+    config->frameIntervalP = 1;   // No B-frames (confirmed by user)
     
     // Disable expensive features for maximum speed
-    config.rcParams.enableAQ = 0;
-    config.rcParams.enableTemporalAQ = 0;
-    config.rcParams.enableLookahead = 0;
-    config.rcParams.lookaheadDepth = 0;
-    config.rcParams.disableBadapt = 1;
-    config.rcParams.multiPass = NV_ENC_MULTI_PASS_DISABLED;
+    config->rcParams.enableAQ = 0;
+    config->rcParams.enableTemporalAQ = 0;
+    config->rcParams.enableLookahead = 0;
+    config->rcParams.lookaheadDepth = 0;
+    config->rcParams.disableBadapt = 1;
+    config->rcParams.multiPass = NV_ENC_MULTI_PASS_DISABLED;
     
     // HEVC: Disable temporal filter, minimal references
-    config.encodeCodecConfig.hevcConfig.tfLevel = NV_ENC_TEMPORAL_FILTER_LEVEL_0;
-    config.encodeCodecConfig.hevcConfig.maxNumRefFramesInDPB = 2;
+    config->encodeCodecConfig.hevcConfig.tfLevel = NV_ENC_TEMPORAL_FILTER_LEVEL_0;
+    config->encodeCodecConfig.hevcConfig.maxNumRefFramesInDPB = 2;
     
     // Constant QP mode (fastest, no rate control overhead)
-    config.rcParams.rateControlMode = NV_ENC_PARAMS_RC_CONSTQP;
-    switch (quality) {
-        case QUALITY_LOW:      enc->qp = 28; break;
-        case QUALITY_MEDIUM:   enc->qp = 24; break;
-        case QUALITY_HIGH:     enc->qp = 20; break;
-        case QUALITY_LOSSLESS: enc->qp = 16; break;
-        default:               enc->qp = 24; break;
-    }
-    config.rcParams.constQP.qpInterP = enc->qp;
-    config.rcParams.constQP.qpInterB = enc->qp;
-    config.rcParams.constQP.qpIntra = enc->qp > 4 ? enc->qp - 4 : 1;
+    config->rcParams.rateControlMode = NV_ENC_PARAMS_RC_CONSTQP;
+    enc->qp = Util_QualityToQP(quality);
+    config->rcParams.constQP.qpInterP = enc->qp;
+    config->rcParams.constQP.qpInterB = enc->qp;
+    config->rcParams.constQP.qpIntra = enc->qp > 4 ? enc->qp - 4 : 1;
     
     // ========================================================================
     // Step 4: Initialize encoder
     // Per API (line 2240): enableEncodeAsync=1 for async mode
     // ========================================================================
     
-    NV_ENC_INITIALIZE_PARAMS initParams = {0};
-    initParams.version = NV_ENC_INITIALIZE_PARAMS_VER;
-    initParams.encodeGUID = NV_ENC_CODEC_HEVC_GUID;
-    initParams.presetGUID = NV_ENC_PRESET_P1_GUID;
-    initParams.encodeWidth = width;
-    initParams.encodeHeight = height;
-    initParams.darWidth = width;
-    initParams.darHeight = height;
-    initParams.frameRateNum = fps;
-    initParams.frameRateDen = 1;
-    initParams.enableEncodeAsync = 1;  // Async mode required
-    initParams.enablePTD = 1;  // Let NVENC decide picture types
-    initParams.encodeConfig = &config;
-    initParams.tuningInfo = NV_ENC_TUNING_INFO_ULTRA_LOW_LATENCY;
-    
-    st = enc->fn.nvEncInitializeEncoder(enc->encoder, &initParams);
+    NV_ENC_INITIALIZE_PARAMS* initParams = &enc->initParams;
+    initParams->version = NV_ENC_INITIALIZE_PARAMS_VER;
+    initParams->encodeGUID = NV_ENC_CODEC_HEVC_GUID;
+    initParams->presetGUID = NV_ENC_PRESET_P1_GUID;
+    initParams->encodeWidth = width;
+    initParams->encodeHeight = height;
+    initParams->darWidth = width;
+    initParams->darHeight = height;
+    initParams->frameRateNum = fps;
+    initParams->frameRateDen = 1;
+    initParams->enableEncodeAsync = 1;  // Async mode required
+    initParams->enablePTD = 1;  // Let NVENC decide picture types
+    initParams->encodeConfig = config;
+    initParams->tuningInfo = NV_ENC_TUNING_INFO_ULTRA_LOW_LATENCY;
+    
+    st = enc->fn.nvEncInitializeEncoder(enc->encoder, initParams);
     if (st != NV_ENC_SUCCESS) {
         NvLog("NVENCEncoder: Initialize failed (%d)\n", st);
         goto fail;
@@ -416,6 +425,11 @@ void NVENCEncoder_SetCallback(NVENCEncoder* enc, EncodedFrameCallback callback,
     enc->callbackUserData = userData;
 }
 
+void NVENCEncoder_SetQueueGauge(NVENCEncoder* enc, FlightRecorderGauge gauge) {
+    if (!enc) return;
+    enc->queueGauge = gauge;
+}
+
 BOOL NVENCEncoder_SubmitTexture(NVENCEncoder* enc, ID3D11Texture2D* nv12Source, LONGLONG timestamp) {
     if (!enc || !enc->initialized || !nv12Source) return FALSE;
     
@@ -511,8 +525,11 @@ BOOL NVENCEncoder_SubmitTexture(NVENCEncoder* enc, ID3D11Texture2D* nv12Source,
     picParams.inputDuration = enc->frameDuration;
     picParams.completionEvent = enc->completionEvents[idx];
     
-    // Force IDR every 2 seconds for seeking
-    if (enc->frameNumber % (enc->fps * 2) == 0) {
+    // Force IDR every 2 seconds of timeline for seeking. Counted by timestamp,
+    // not frame number, so sparse (variable frame rate) input keeps the cadence.
+    BOOL forceIdr = (enc->frameNumber == 0 || enc->idrPending ||
+                     timestamp - enc->lastIdrTimestamp >= enc->keyframeInterval);
+    if (forceIdr) {
         picParams.encodePicFlags = NV_ENC_PIC_FLAG_FORCEIDR;
     }
     
@@ -533,10 +550,15 @@ BOOL NVENCEncoder_SubmitTexture(NVENCEncoder* enc, ID3D11Texture2D* nv12Source,
     // NOTE: encMutex[idx] is still held! The output thread will release it
     // after LockBitstream and UnmapInputResource complete.
     
+    if (forceIdr) {
+        enc->lastIdrTimestamp = timestamp;
+        enc->idrPending = FALSE;
+    }
+    
     // Track pending frame
     enc->pendingTimestamps[idx] = timestamp;
     enc->submitIndex = (enc->submitIndex + 1) % NUM_BUFFERS;
-    InterlockedIncrement(&enc->pendingCount);
+    FlightRecorder_SetGauge(enc->queueGauge, InterlockedIncrement(&enc->pendingCount));
     enc->frameNumber++;
     
     LeaveCriticalSection(&enc->submitLock);
@@ -597,6 +619,64 @@ BOOL NVENCEncoder_GetSequenceHeader(NVENCEncoder* enc, BYTE* buffer, DWORD buffe
     return TRUE;
 }
 
+BOOL NVENCEncoder_Reconfigure(NVENCEncoder* enc, const EncoderParams* params) {
+    if (!enc || !enc->initialized || !params) return FALSE;
+    
+    EnterCriticalSection(&enc->submitLock);
+    
+    NV_ENC_CONFIG newConfig = enc->encodeConfig;
+    int newQp = enc->qp;
+    BOOL gopChanged = FALSE;
+    
+    if (params->qp > 0) {
+        newQp = params->qp;
+        if (newQp > 51) newQp = 51;
+        newConfig.rcParams.constQP.qpInterP = newQp;
+        newConfig.rcParams.constQP.qpInterB = newQp;
+        newConfig.rcParams.constQP.qpIntra = newQp > 4 ? newQp - 4 : 1;
+    }
+    
+    if (params->keyframeIntervalMs > 0) {
+        uint32_t gop = (uint32_t)((LONGLONG)enc->fps * params->keyframeIntervalMs / 1000);
+        if (gop < 1) gop = 1;
+        gopChanged = (gop != newConfig.gopLength);
+        newConfig.gopLength = gop;
+    }
+    
+    NV_ENC_RECONFIGURE_PARAMS reconfig = {0};
+    reconfig.version = NV_ENC_RECONFIGURE_PARAMS_VER;
+    reconfig.reInitEncodeParams = enc->initParams;
+    reconfig.reInitEncodeParams.encodeConfig = &newConfig;
+    // A GOP structure change requires a reset, which starts with an IDR
+    reconfig.resetEncoder = gopChanged ? 1 : 0;
+    reconfig.forceIDR = gopChanged ? 1 : 0;
+    
+    NVENCSTATUS st = enc->fn.nvEncReconfigureEncoder(enc->encoder, &reconfig);
+    if (st != NV_ENC_SUCCESS) {
+        LeaveCriticalSection(&enc->submitLock);
+        NvLog("NVENCEncoder: ReconfigureEncoder failed (%d)\n", st);
+        return FALSE;
+    }
+    
+    enc->encodeConfig = newConfig;
+    enc->initParams.encodeConfig = &enc->encodeConfig;
+    enc->qp = newQp;
+    if (params->keyframeIntervalMs > 0) {
+        enc->keyframeInterval = (LONGLONG)params->keyframeIntervalMs * 10000LL;
+    }
+    // The reset's IDR lands on the next submitted frame; the timed cadence
+    // restarts from there (its timestamp is known only at submit)
+    if (gopChanged) {
+        enc->idrPending = TRUE;
+    }
+    
+    LeaveCriticalSection(&enc->submitLock);
+    
+    NvLog("NVENCEncoder: Reconfigured (QP=%d, GOP=%u frames, keyframe every %lldms)\n",
+          enc->qp, enc->encodeConfig.gopLength, enc->keyframeInterval / 10000LL);
+    return TRUE;
+}
+
 void NVENCEncoder_GetStats(NVENCEncoder* enc, int* framesEncoded, double* avgEncodeTimeMs) {
     if (!enc) return;
     if (framesEncoded) *framesEncoded = (int)enc->frameNumber;
@@ -619,8 +699,17 @@ void NVENCEncoder_Destroy(NVENCEncoder* enc) {
             }
         }
         
-        WaitForSingleObject(enc->outputThread, 5000);
+        if (WaitForSingleObject(enc->outputThread, 5000) != WAIT_OBJECT_0) {
+            // The output thread may still be in nvEncLockBitstream on our
+            // buffers: leak the encoder rather than free it under it, and
+            // detach the callback so a late frame can't reach the owner's
+            // next session
+            NvLog("NVENCEncoder: output thread still running after 5s, leaking encoder\n");
+            enc->frameCallback = NULL;
+            return;
+        }
         CloseHandle(enc->outputThread);
+        enc->outputThread = NULL;
     }
     
     // Cleanup NVENC resources
@@ -684,6 +773,9 @@ static unsigned __stdcall OutputThreadProc(void* param) {
     NVENCEncoder* enc = (NVENCEncoder*)param;
     
     NvLog("NVENCEncoder: Output thread started\n");
+    Trace_SetThreadName("NVENC output");
+    FlightRecorder_RegisterThread("NVENC output");
+    ThreadRegistry_Register("NVENC output", THREAD_ROLE_ENCODER_OUTPUT);
     
     int framesRetrieved = 0;
     
@@ -701,6 +793,7 @@ static unsigned __stdcall OutputThreadProc(void* param) {
         // Per docs: "wait on the event object to be signaled"
         // ====================================================================
         
+        FlightRecorder_SetStage("wait", FR_NO_DEADLINE);
         DWORD waitResult = WaitForSingleObject(enc->completionEvents[idx], 100);
         
         if (waitResult == WAIT_TIMEOUT) {
@@ -722,6 +815,8 @@ static unsigned __stdcall OutputThreadProc(void* param) {
         // Per docs (lines 3623-3626): event signaled means data is ready
         // ====================================================================
         
+        FlightRecorder_SetStage("fetch", FR_STAGE_DEADLINE_MS);
+        TRACE_BEGIN(TRACE_ENCODE, enc->pendingTimestamps[idx]);
         NV_ENC_LOCK_BITSTREAM lockParams = {0};
         lockParams.version = NV_ENC_LOCK_BITSTREAM_VER;
         lockParams.outputBitstream = enc->outputBuffers[idx];
@@ -730,9 +825,11 @@ static unsigned __stdcall OutputThreadProc(void* param) {
         NVENCSTATUS st = enc->fn.nvEncLockBitstream(enc->encoder, &lockParams);
         if (st != NV_ENC_SUCCESS) {
             NvLog("NVENCEncoder: LockBitstream[%d] failed (%d)\n", idx, st);
+            TRACE_END(TRACE_ENCODE, enc->pendingTimestamps[idx]);
             // Still advance to avoid getting stuck
+            FlightRecorder_Event(FR_EVENT_ERROR, st, idx);
             enc->retrieveIndex = (enc->retrieveIndex + 1) % NUM_BUFFERS;
-            InterlockedDecrement(&enc->pendingCount);
+            FlightRecorder_SetGauge(enc->queueGauge, InterlockedDecrement(&enc->pendingCount));
             continue;
         }
         
@@ -741,7 +838,7 @@ static unsigned __stdcall OutputThreadProc(void* param) {
         // ====================================================================
         
         EncodedFrame frame = {0};
-        frame.data = (BYTE*)malloc(lockParams.bitstreamSizeInBytes);
+        frame.data = (BYTE*)MemTracker_Alloc(MEM_TAG_VIDEO_ENCODER, lockParams.bitstreamSizeInBytes);
         if (frame.data) {
             memcpy(frame.data, lockParams.bitstreamBufferPtr, lockParams.bitstreamSizeInBytes);
             frame.size = lockParams.bitstreamSizeInBytes;
@@ -771,6 +868,7 @@ static unsigned __stdcall OutputThreadProc(void* param) {
         if (enc->encMutex[idx]) {
             enc->encMutex[idx]->lpVtbl->ReleaseSync(enc->encMutex[idx], 0);
         }
+        TRACE_END(TRACE_ENCODE, enc->pendingTimestamps[idx]);
         
         // ====================================================================
         // Step 6: Deliver frame and advance
@@ -779,15 +877,17 @@ static unsigned __stdcall OutputThreadProc(void* param) {
         if (frame.data && enc->frameCallback) {
             enc->frameCallback(&frame, enc->callbackUserData);
             framesRetrieved++;
-        } else if (frame.data) {
-            free(frame.data);
         }
+        if (frame.data) MemTracker_Free(frame.data);  // Callback did not take ownership
         
         enc->retrieveIndex = (enc->retrieveIndex + 1) % NUM_BUFFERS;
-        InterlockedDecrement(&enc->pendingCount);
+        FlightRecorder_SetGauge(enc->queueGauge, InterlockedDecrement(&enc->pendingCount));
     }
     
     NvLog("NVENCEncoder: Output thread exiting (retrieved %d frames)\n", framesRetrieved);
+    Trace_ReleaseThread();
+    FlightRecorder_ReleaseThread();
+    ThreadRegistry_Unregister();
     return 0;
 }
 
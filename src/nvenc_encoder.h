@@ -9,20 +9,15 @@
 #include <windows.h>
 #include <d3d11.h>
 #include "config.h"
+#include "video_encoder.h"
 
-typedef struct {
-    BYTE* data;
-    DWORD size;
-    LONGLONG timestamp;
-    LONGLONG duration;
-    BOOL isKeyframe;
-} EncodedFrame;
+// Frames in flight (input/output buffer pairs).
+// Per API docs (line 3444-3445): "at least 4 more than number of B frames"
+// With no B-frames, minimum is 4. We use 8 for better pipelining.
+#define NVENC_NUM_BUFFERS 8
 
 typedef struct NVENCEncoder NVENCEncoder;
 
-// Callback for receiving completed frames (called from output thread)
-typedef void (*EncodedFrameCallback)(EncodedFrame* frame, void* userData);
-
 // Check if NVENC is available
 BOOL NVENCEncoder_IsAvailable(void);
 
@@ -31,6 +26,7 @@ NVENCEncoder* NVENCEncoder_Create(ID3D11Device* d3dDevice, int width, int height
 
 // Set callback for completed frames (async mode delivers via callback)
 void NVENCEncoder_SetCallback(NVENCEncoder* enc, EncodedFrameCallback callback, void* userData);
+void NVENCEncoder_SetQueueGauge(NVENCEncoder* enc, FlightRecorderGauge gauge);
 
 // Submit texture for encoding (fast, non-blocking in async mode)
 // The texture will be copied internally, so caller can reuse it immediately
@@ -46,6 +42,9 @@ BOOL NVENCEncoder_Flush(NVENCEncoder* enc, EncodedFrame* outFrame);
 // Get sequence header (VPS/SPS/PPS for HEVC)
 BOOL NVENCEncoder_GetSequenceHeader(NVENCEncoder* enc, BYTE* buffer, DWORD bufferSize, DWORD* outSize);
 
+// Change QP and/or keyframe interval without recreating the session
+BOOL NVENCEncoder_Reconfigure(NVENCEncoder* enc, const EncoderParams* params);
+
 // Stats
 void NVENCEncoder_GetStats(NVENCEncoder* enc, int* framesEncoded, double* avgEncodeTimeMs);
 
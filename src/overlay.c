@@ -12,8 +12,8 @@
 #include <shlobj.h>
 #include <shellapi.h>   // For system tray (Shell_NotifyIcon)
 #include <dwmapi.h>
-#include <mmsystem.h>  // For timeBeginPeriod/timeEndPeriod
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "action_toolbar.h"
 #include "audio_device.h"
@@ -96,10 +96,11 @@ static GdipStartPathFigureFunc GdipStartPathFigure = NULL;
 
 #include "overlay.h"
 #include "capture.h"
-#include "encoder.h"
+#include "recorder.h"
 #include "config.h"
 #include "replay_buffer.h"
 #include "logger.h"
+#include "image_encoder.h"
 
 #pragma comment(lib, "comctl32.lib")
 #pragma comment(lib, "comdlg32.lib")
@@ -111,6 +112,7 @@ static GdipStartPathFigureFunc GdipStartPathFigure = NULL;
 // External globals from main.c
 extern AppConfig g_config;
 extern CaptureState g_capture;
+extern FrameHub* g_frameHub;
 extern ReplayBufferState g_replayBuffer;
 extern BOOL g_isRecording;
 extern BOOL g_isSelecting;
@@ -180,6 +182,9 @@ extern HWND g_controlWnd;
 #define ID_TRAY_SHOW       6001
 #define ID_TRAY_EXIT       6002
 
+// Watchdog asked for the replay pipeline to be restarted (stalled stage)
+#define WM_REPLAY_RECOVER  (WM_USER + 101)
+
 // Selection states
 typedef enum {
     SEL_NONE = 0,
@@ -212,9 +217,7 @@ static RECT g_originalRect;    // Original rect before resize/move
 static HWND g_settingsWnd = NULL;
 static HWND g_crosshairWnd = NULL;
 static HWND g_recordingPanel = NULL;  // Inline timer + stop in control bar
-static EncoderState g_encoder;
-static HANDLE g_recordThread = NULL;
-static volatile BOOL g_stopRecording = FALSE;
+static Recorder* g_recorder = NULL;
 static DWORD g_recordStartTime = 0;
 static BOOL g_recordingPanelHovered = FALSE;  // Hover state for recording panel
 static BOOL g_waitingForHotkey = FALSE;       // Waiting for user to press hotkey
@@ -226,9 +229,6 @@ static NOTIFYICONDATAA g_trayIcon = {0};      // System tray icon data
 // Handle size
 #define HANDLE_SIZE 10
 
-// Recording thread
-static DWORD WINAPI RecordingThread(LPVOID param);
-
 // Window procedures
 static LRESULT CALLBACK OverlayWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
@@ -663,7 +663,7 @@ static void CaptureToClipboard(void) {
     // Hide overlay temporarily
     ShowWindow(g_overlayWnd, SW_HIDE);
     ActionToolbar_Hide();
-    Sleep(50); // Let windows redraw
+    DwmFlush(); // Wait for the compositor to present the frame without the overlay
     
     HDC screenDC = GetDC(NULL);
     HDC memDC = CreateCompatibleDC(screenDC);
@@ -702,7 +702,7 @@ static void CaptureToFile(void) {
     // Hide overlay temporarily
     ShowWindow(g_overlayWnd, SW_HIDE);
     ActionToolbar_Hide();
-    Sleep(50);
+    DwmFlush();
     
     HDC screenDC = GetDC(NULL);
     HDC memDC = CreateCompatibleDC(screenDC);
@@ -712,41 +712,56 @@ static void CaptureToFile(void) {
     BitBlt(memDC, 0, 0, w, h, screenDC, g_selectedRect.left, g_selectedRect.top, SRCCOPY);
     
     SelectObject(memDC, oldBitmap);
+    
+    // Read back as top-down 32bpp BGRA for the encoder
+    BITMAPINFO bmi = {0};
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = w;
+    bmi.bmiHeader.biHeight = -h;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    
+    BYTE* pixels = (BYTE*)malloc((size_t)w * h * 4);
+    BOOL havePixels = pixels && GetDIBits(memDC, hBitmap, 0, h, pixels, &bmi, DIB_RGB_COLORS) == h;
+    
     DeleteDC(memDC);
     ReleaseDC(NULL, screenDC);
+    DeleteObject(hBitmap);
     
     // Show Save As dialog
     char filename[MAX_PATH] = "capture.png";
     OPENFILENAMEA ofn = {0};
     ofn.lStructSize = sizeof(ofn);
     ofn.hwndOwner = NULL;
-    ofn.lpstrFilter = "PNG Image\0*.png\0All Files\0*.*\0";
+    ofn.lpstrFilter = "PNG Image\0*.png\0QOI Image\0*.qoi\0";
     ofn.lpstrFile = filename;
     ofn.nMaxFile = MAX_PATH;
     ofn.Flags = OFN_OVERWRITEPROMPT;
     ofn.lpstrDefExt = "png";
     
-    BOOL clipboardTookOwnership = FALSE;
-    if (GetSaveFileNameA(&ofn)) {
-        // TODO: Save as PNG (requires GDI+ or other library)
-        // For now, just show success message
-        MessageBoxA(NULL, "Save functionality requires PNG encoder.\nBitmap captured to clipboard instead.", 
-                    "Save", MB_OK | MB_ICONINFORMATION);
+    if (havePixels && GetSaveFileNameA(&ofn)) {
+        ImageFormat format = ImageEncoder_FormatFromPath(filename);
+        EncodedImage image = {0};
+        LARGE_INTEGER freq, start, end;
+        QueryPerformanceFrequency(&freq);
+        QueryPerformanceCounter(&start);
+        BOOL saved = ImageEncoder_Encode(format, pixels, w, h, w * 4, &image) &&
+                     ImageEncoder_WriteFile(filename, &image);
+        QueryPerformanceCounter(&end);
         
-        // Copy to clipboard as fallback
-        if (OpenClipboard(NULL)) {
-            EmptyClipboard();
-            if (SetClipboardData(CF_BITMAP, hBitmap)) {
-                clipboardTookOwnership = TRUE;  // Clipboard now owns the bitmap
-            }
-            CloseClipboard();
+        if (saved) {
+            Logger_Log("Screenshot saved: %s (%dx%d, %zu bytes, %.1f ms)\n", filename, w, h, image.size,
+                       (double)(end.QuadPart - start.QuadPart) * 1000.0 / freq.QuadPart);
+        } else {
+            Logger_Log("Screenshot save failed: %s\n", filename);
+            MessageBoxA(NULL, "Failed to save screenshot", "Error", MB_OK | MB_ICONERROR);
         }
+        ImageEncoder_Free(&image);
+    } else if (!havePixels) {
+        Logger_Log("Screenshot capture failed (GetDIBits)\n");
     }
-    
-    // Only delete bitmap if clipboard didn't take ownership
-    if (!clipboardTookOwnership) {
-        DeleteObject(hBitmap);
-    }
+    free(pixels);
     
     // Clear selection state - overlay stays hidden, show control panel
     g_selState = SEL_NONE;
@@ -1290,37 +1305,57 @@ HWND Overlay_GetWindow(void) {
     return g_overlayWnd;
 }
 
+BOOL Overlay_RecoverStall(const char* threadName, const char* stage, void* userData) {
+    (void)stage;
+    (void)userData;
+    
+    // Only the replay pipeline can be restarted without losing user data:
+    // never touch a recording in progress, and the frame hub is shared
+    if (!g_replayBuffer.isBuffering || g_isRecording || !g_controlWnd) return FALSE;
+    if (strcmp(threadName, "Frame hub") == 0 || strcmp(threadName, "Recorder") == 0) return FALSE;
+    
+    return PostMessage(g_controlWnd, WM_REPLAY_RECOVER, 0, 0);
+}
+
 void Recording_Start(void) {
     if (g_isRecording) return;
     if (IsRectEmpty(&g_selectedRect)) return;
     
-    // Set capture region
-    if (!Capture_SetRegion(&g_capture, g_selectedRect)) {
-        MessageBoxA(NULL, "Failed to set capture region", "Error", MB_OK | MB_ICONERROR);
-        return;
-    }
-    
     // Validate dimensions
-    if (g_capture.captureWidth < 16 || g_capture.captureHeight < 16) {
+    int width = g_selectedRect.right - g_selectedRect.left;
+    int height = g_selectedRect.bottom - g_selectedRect.top;
+    if (width < 16 || height < 16) {
         MessageBoxA(NULL, "Capture area too small", "Error", MB_OK | MB_ICONERROR);
         return;
     }
     
-    // Generate output filename
+    // The replay buffer may already be capturing through the frame hub; the
+    // recording then shares its capture and must lie on the same area
+    if (FrameHub_GetConsumerCount(g_frameHub) > 0) {
+        HubRect hubRegion = FrameHub_GetRegion(g_frameHub);
+        RECT active = { hubRegion.x, hubRegion.y, hubRegion.x + hubRegion.width, hubRegion.y + hubRegion.height };
+        RECT inside;
+        if (!IntersectRect(&inside, &active, &g_selectedRect) || !EqualRect(&inside, &g_selectedRect)) {
+            MessageBoxA(NULL, "The replay buffer is capturing a different area.\n"
+                        "Select a region inside the replay capture area, or turn off the replay buffer.",
+                        "Error", MB_OK | MB_ICONERROR);
+            return;
+        }
+    }
+    
+    // Generate output filename (encoded pipeline always writes MP4)
     char outputPath[MAX_PATH];
-    Encoder_GenerateFilename(outputPath, MAX_PATH, 
-                             g_config.savePath, g_config.outputFormat);
+    Recorder_GenerateFilename(outputPath, MAX_PATH, g_config.savePath);
     
-    // Initialize encoder
+    // Start encoder pipeline
     int fps = Capture_GetRefreshRate(&g_capture);
     if (fps > 60) fps = 60; // Cap at 60 FPS for encoder compatibility
-    if (!Encoder_Init(&g_encoder, outputPath, 
-                      g_capture.captureWidth, g_capture.captureHeight,
-                      fps, g_config.outputFormat, g_config.quality)) {
+    g_recorder = Recorder_Start(g_frameHub, &g_capture, g_selectedRect, outputPath, fps, &g_config);
+    if (!g_recorder) {
         char errMsg[512];
         snprintf(errMsg, sizeof(errMsg), 
             "Failed to initialize encoder.\nPath: %s\nSize: %dx%d\nFPS: %d",
-            outputPath, g_capture.captureWidth, g_capture.captureHeight, fps);
+            outputPath, width, height, fps);
         MessageBoxA(NULL, errMsg, "Error", MB_OK | MB_ICONERROR);
         return;
     }
@@ -1333,7 +1368,6 @@ void Recording_Start(void) {
     // Start recording
     g_isRecording = TRUE;
     g_isSelecting = FALSE;
-    g_stopRecording = FALSE;
     g_recordStartTime = GetTickCount();
     g_recordingMode = g_currentMode;  // Remember which mode started recording
     strcpy(g_timerText, "00:00");
@@ -1346,9 +1380,6 @@ void Recording_Start(void) {
     // Update control panel to show inline timer/stop
     Overlay_SetRecordingState(TRUE);
     
-    // Start recording thread
-    g_recordThread = CreateThread(NULL, 0, RecordingThread, NULL, 0, NULL);
-    
     // Start time limit timer if configured
     if (g_config.maxRecordingSeconds > 0) {
         SetTimer(g_controlWnd, ID_TIMER_LIMIT, 
@@ -1359,17 +1390,9 @@ void Recording_Start(void) {
 void Recording_Stop(void) {
     if (!g_isRecording) return;
     
-    g_stopRecording = TRUE;
-    
-    // Wait for recording thread
-    if (g_recordThread) {
-        WaitForSingleObject(g_recordThread, 5000);
-        CloseHandle(g_recordThread);
-        g_recordThread = NULL;
-    }
-    
-    // Finalize encoder
-    Encoder_Finalize(&g_encoder);
+    // Stop pipeline, flush encoder and finalize the file
+    Recorder_Stop(g_recorder);
+    g_recorder = NULL;
     
     g_isRecording = FALSE;
     
@@ -1392,61 +1415,6 @@ void Recording_Stop(void) {
     ShowWindow(g_controlWnd, SW_SHOW);
 }
 
-static DWORD WINAPI RecordingThread(LPVOID param) {
-    (void)param;
-    
-    // Request high-resolution timer (1ms instead of 15.6ms)
-    timeBeginPeriod(1);
-    
-    LARGE_INTEGER freq, start, now;
-    QueryPerformanceFrequency(&freq);
-    QueryPerformanceCounter(&start);
-    
-    int fps = Capture_GetRefreshRate(&g_capture);
-    if (fps > 60) fps = 60;
-    
-    // Use frame count for consistent timing
-    UINT64 frameCount = 0;
-    UINT64 frameDuration100ns = 10000000ULL / fps; // 100-nanosecond units for MF
-    double frameIntervalSec = 1.0 / fps;
-    
-    while (!g_stopRecording) {
-        QueryPerformanceCounter(&now);
-        double elapsed = (double)(now.QuadPart - start.QuadPart) / freq.QuadPart;
-        double targetTime = frameCount * frameIntervalSec;
-        
-        if (elapsed >= targetTime) {
-            // Use frame-based timestamp for smooth playback
-            UINT64 timestamp = frameCount * frameDuration100ns;
-            BYTE* frame = Capture_GetFrame(&g_capture, NULL); // Ignore DXGI timestamp
-            
-            if (frame) {
-                Encoder_WriteFrame(&g_encoder, frame, timestamp);
-            }
-            
-            frameCount++;
-            
-            // Skip frames if we're falling behind (drop frames rather than stutter)
-            double newElapsed = (double)(now.QuadPart - start.QuadPart) / freq.QuadPart;
-            while ((frameCount * frameIntervalSec) < newElapsed - frameIntervalSec) {
-                frameCount++; // Skip this frame
-            }
-        } else {
-            // Sleep until next frame time - use high precision sleep
-            double sleepTime = (targetTime - elapsed) * 1000.0;
-            if (sleepTime > 2.0) {
-                Sleep((DWORD)(sleepTime - 1.5));
-            } else if (sleepTime > 0.5) {
-                Sleep(1);
-            }
-            // Busy-wait for sub-millisecond precision
-        }
-    }
-    
-    timeEndPeriod(1);
-    return 0;
-}
-
 void Overlay_SetRecordingState(BOOL isRecording) {
     if (isRecording) {
         // Get button positions based on recording mode
@@ -2377,6 +2345,21 @@ static LRESULT CALLBACK ControlWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPARA
             return (LRESULT)hBrush;
         }
         
+        case WM_REPLAY_RECOVER:
+            // Start() brings up a fresh encoder, converter and audio capture,
+            // but only once the old buffer thread has exited: a second one
+            // would reset the globals the stuck one still uses. If it won't
+            // exit, leave it stalled for the watchdog's hang report.
+            if (g_replayBuffer.isBuffering && !g_isRecording) {
+                Logger_Log("Restarting replay buffer after a pipeline stall\n");
+                if (ReplayBuffer_Stop(&g_replayBuffer)) {
+                    ReplayBuffer_Start(&g_replayBuffer, &g_config);
+                } else {
+                    Logger_Log("Replay buffer thread did not exit, not restarting\n");
+                }
+            }
+            return 0;
+        
         case WM_HOTKEY: {
             Logger_Log("WM_HOTKEY received: wParam=%llu\n", (unsigned long long)wParam);
             if (wParam == HOTKEY_REPLAY_SAVE) {
@@ -2639,6 +2622,37 @@ static int PopulateAudioDropdown(HWND comboBox, const AudioDeviceList* devices,
     return selectedIdx;
 }
 
+// Explanation and calculation lines for the replay RAM estimate
+static void FormatReplayRAMText(int durationSecs, int width, int height, int fps,
+                                char* explainText, size_t explainSize, char* calcText, size_t calcSize) {
+    ReplayRAMEstimate est;
+    int ramMB = ReplayBuffer_EstimateRAMUsage(durationSecs, width, height, fps, g_config.quality, &est);
+    
+    if (est.availableMB > 0 && est.highMB > est.availableMB) {
+        snprintf(explainText, explainSize, "Warning: needs up to %d MB of RAM but only %d MB is free. Shorten the duration or set a limit.",
+                 est.highMB, est.availableMB);
+    } else if (est.learned) {
+        snprintf(explainText, explainSize, "When enabled, ~%d MB of RAM (%d-%d MB%s) is used for the video buffer. See the calculation below:",
+                 ramMB, est.lowMB, est.highMB, est.tentative ? ", extrapolated" : "");
+    } else {
+        snprintf(explainText, explainSize, "When enabled, ~%d MB of RAM is reserved for the video buffer. See the calculation below:", ramMB);
+    }
+    
+    // Learned rates replace the fixed bitrate after the first run
+    const char* basis = est.learned ? "measured" : "estimated";
+    if (durationSecs >= 60) {
+        int mins = durationSecs / 60;
+        int secs = durationSecs % 60;
+        if (secs > 0) {
+            snprintf(calcText, calcSize, "%dm %ds @ %d FPS, %dx%d = ~%d MB (%s)", mins, secs, fps, width, height, ramMB, basis);
+        } else {
+            snprintf(calcText, calcSize, "%dm @ %d FPS, %dx%d = ~%d MB (%s)", mins, fps, width, height, ramMB, basis);
+        }
+    } else {
+        snprintf(calcText, calcSize, "%ds @ %d FPS, %dx%d = ~%d MB (%s)", durationSecs, fps, width, height, ramMB, basis);
+    }
+}
+
 // Update RAM usage estimate label in settings
 static void UpdateReplayRAMEstimate(HWND hwndSettings) {
     HWND lblRam = GetDlgItem(hwndSettings, ID_STATIC_REPLAY_RAM);
@@ -2668,26 +2682,11 @@ static void UpdateReplayRAMEstimate(HWND hwndSettings) {
         }
     }
     
-    int ramMB = ReplayBuffer_EstimateRAMUsage(durationSecs, estWidth, estHeight, fps);
-    
-    // Update explanation text
     char explainText[256];
-    sprintf(explainText, "When enabled, ~%d MB of RAM is reserved for the video buffer. See the calculation below:", ramMB);
-    SetWindowTextA(lblRam, explainText);
-    
-    // Update calculation text
     char calcText[128];
-    if (durationSecs >= 60) {
-        int mins = durationSecs / 60;
-        int secs = durationSecs % 60;
-        if (secs > 0) {
-            sprintf(calcText, "%dm %ds @ %d FPS, %dx%d = ~%d MB", mins, secs, fps, estWidth, estHeight, ramMB);
-        } else {
-            sprintf(calcText, "%dm @ %d FPS, %dx%d = ~%d MB", mins, fps, estWidth, estHeight, ramMB);
-        }
-    } else {
-        sprintf(calcText, "%ds @ %d FPS, %dx%d = ~%d MB", durationSecs, fps, estWidth, estHeight, ramMB);
-    }
+    FormatReplayRAMText(durationSecs, estWidth, estHeight, fps,
+                        explainText, sizeof(explainText), calcText, sizeof(calcText));
+    SetWindowTextA(lblRam, explainText);
     SetWindowTextA(lblCalc, calcText);
 }
 
@@ -2856,10 +2855,10 @@ static LRESULT CALLBACK SettingsWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPAR
                 controlX, y, controlW, 120, hwnd, (HMENU)ID_CMB_FORMAT, g_hInstance, NULL);
             SendMessage(cmbFormat, WM_SETFONT, (WPARAM)g_settingsFont, TRUE);
             
-            SendMessageW(cmbFormat, CB_ADDSTRING, 0, (LPARAM)L"MP4 (H.264) - Best compatibility");
-            SendMessageW(cmbFormat, CB_ADDSTRING, 0, (LPARAM)L"AVI - Legacy format");
-            SendMessageW(cmbFormat, CB_ADDSTRING, 0, (LPARAM)L"WMV - Windows Media");
-            SendMessage(cmbFormat, CB_SETCURSEL, g_config.outputFormat, 0);
+            // Recordings are muxed from the encoded pipeline, which only writes MP4
+            SendMessageW(cmbFormat, CB_ADDSTRING, 0, (LPARAM)L"MP4 (HEVC / H.264)");
+            SendMessage(cmbFormat, CB_SETCURSEL, 0, 0);
+            EnableWindow(cmbFormat, FALSE);
             y += rowH;
             
             // Quality dropdown with descriptions
@@ -3197,11 +3196,12 @@ static LRESULT CALLBACK SettingsWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPAR
                     }
                 }
                 
-                int ramMB = ReplayBuffer_EstimateRAMUsage(durationSecs, estWidth, estHeight, fps);
+                char explainText[256];
+                char calcText[128];
+                FormatReplayRAMText(durationSecs, estWidth, estHeight, fps,
+                                    explainText, sizeof(explainText), calcText, sizeof(calcText));
                 
                 // Explanation text
-                char explainText[256];
-                sprintf(explainText, "When enabled, ~%d MB of RAM is reserved for the video buffer. See the calculation below:", ramMB);
                 HWND lblExplain = CreateWindowExA(0, "STATIC", explainText,
                     WS_CHILD | WS_VISIBLE,
                     labelX, y + 4, contentW, 20, hwnd, (HMENU)ID_STATIC_REPLAY_RAM, g_hInstance, NULL);
@@ -3209,19 +3209,6 @@ static LRESULT CALLBACK SettingsWndProc(HWND hwnd, UINT msg, WPARAM wParam, LPAR
                 y += 32;
                 
                 // Calculation breakdown
-                char calcText[128];
-                if (durationSecs >= 60) {
-                    int calcMins = durationSecs / 60;
-                    int calcSecs = durationSecs % 60;
-                    if (calcSecs > 0) {
-                        sprintf(calcText, "%dm %ds @ %d FPS, %dx%d = ~%d MB", calcMins, calcSecs, fps, estWidth, estHeight, ramMB);
-                    } else {
-                        sprintf(calcText, "%dm @ %d FPS, %dx%d = ~%d MB", calcMins, fps, estWidth, estHeight, ramMB);
-                    }
-                } else {
-                    sprintf(calcText, "%ds @ %d FPS, %dx%d = ~%d MB", durationSecs, fps, estWidth, estHeight, ramMB);
-                }
-                
                 HWND lblCalc = CreateWindowExA(0, "STATIC", calcText,
                     WS_CHILD | WS_VISIBLE,
                     labelX + 20, y, contentW - 20, 20, hwnd, (HMENU)ID_STATIC_REPLAY_CALC, g_hInstance, NULL);
@@ -33,6 +33,10 @@ void Overlay_SetRecordingState(BOOL isRecording);
 // Get overlay window handle
 HWND Overlay_GetWindow(void);
 
+// Stall recovery hook for the crash handler watchdog: restarts the replay
+// buffer on the UI thread when one of its stages is stuck
+BOOL Overlay_RecoverStall(const char* threadName, const char* stage, void* userData);
+
 // Start recording with current selection
 void Recording_Start(void);
 
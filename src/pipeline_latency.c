@@ -0,0 +1,215 @@
+/*
+ * Pipeline Latency Implementation
+ * Log-linear bucket math, stage table and frame tags
+ */
+
+#include "pipeline_latency.h"
+#include "platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LATENCY_MAX_VALUE (((int64_t)1 << LATENCY_MAX_BITS) - 1)
+
+struct PipelineLatency {
+    PlatformMutex lock;
+    LatencyHistogram stages[LATENCY_STAGE_COUNT];
+
+    LatencyTag tags[LATENCY_TAG_CAPACITY];
+    int tagHead;
+    int tagCount;
+};
+
+static const char* g_stageNames[LATENCY_STAGE_COUNT] = {
+    "acquire", "convert", "submit", "encode", "drain", "save", "capture-to-buffer"
+};
+
+// ============================================================================
+// Histogram
+// ============================================================================
+
+static int HighestBit(uint64_t v) {
+#ifdef _WIN32
+    unsigned long index;
+    _BitScanReverse64(&index, v);
+    return (int)index;
+#else
+    return 63 - __builtin_clzll(v);
+#endif
+}
+
+// Values below 2 * LATENCY_SUB_BUCKETS map to themselves; above that, each
+// power of two is split into LATENCY_SUB_BUCKETS equal buckets
+static int BucketIndex(int64_t value) {
+    if (value < 2 * LATENCY_SUB_BUCKETS) return (int)value;
+    int shift = HighestBit((uint64_t)value) - LATENCY_SUB_BUCKET_BITS;
+    return shift * LATENCY_SUB_BUCKETS + (int)(value >> shift);
+}
+
+static int64_t BucketUpperBound(int index) {
+    if (index < 2 * LATENCY_SUB_BUCKETS) return index;
+    int shift = index / LATENCY_SUB_BUCKETS - 1;
+    int64_t sub = (index % LATENCY_SUB_BUCKETS) + LATENCY_SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram_Reset(LatencyHistogram* hist) {
+    if (!hist) return;
+    memset(hist, 0, sizeof(*hist));
+}
+
+void LatencyHistogram_Record(LatencyHistogram* hist, int64_t value) {
+    if (!hist) return;
+    if (value < 0) value = 0;
+    if (value > LATENCY_MAX_VALUE) value = LATENCY_MAX_VALUE;
+
+    hist->counts[BucketIndex(value)]++;
+    if (hist->count == 0 || value < hist->min) hist->min = value;
+    if (value > hist->max) hist->max = value;
+    hist->total += value;
+    hist->count++;
+}
+
+void LatencyHistogram_Merge(LatencyHistogram* dst, const LatencyHistogram* src) {
+    if (!dst || !src || src->count == 0) return;
+    for (int i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+        dst->counts[i] += src->counts[i];
+    }
+    if (dst->count == 0 || src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+    dst->total += src->total;
+    dst->count += src->count;
+}
+
+int64_t LatencyHistogram_Percentile(const LatencyHistogram* hist, double percentile) {
+    if (!hist || hist->count == 0) return 0;
+    if (percentile < 0.0) percentile = 0.0;
+    if (percentile > 100.0) percentile = 100.0;
+
+    // Rank of the sample we want (1-based, rounded up)
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)hist->count + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > hist->count) rank = hist->count;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKET_COUNT; i++) {
+        seen += hist->counts[i];
+        if (seen >= rank) {
+            int64_t value = BucketUpperBound(i);
+            return value < hist->max ? value : hist->max;
+        }
+    }
+    return hist->max;
+}
+
+// ============================================================================
+// Pipeline stages
+// ============================================================================
+
+PipelineLatency* PipelineLatency_Create(void) {
+    PipelineLatency* pl = (PipelineLatency*)calloc(1, sizeof(PipelineLatency));
+    if (!pl) return NULL;
+    Platform_MutexInit(&pl->lock);
+    return pl;
+}
+
+void PipelineLatency_Destroy(PipelineLatency* pl) {
+    if (!pl) return;
+    Platform_MutexDestroy(&pl->lock);
+    free(pl);
+}
+
+void PipelineLatency_Record(PipelineLatency* pl, LatencyStage stage, int64_t value) {
+    if (!pl || stage < 0 || stage >= LATENCY_STAGE_COUNT) return;
+    Platform_MutexLock(&pl->lock);
+    LatencyHistogram_Record(&pl->stages[stage], value);
+    Platform_MutexUnlock(&pl->lock);
+}
+
+void PipelineLatency_TagFrame(PipelineLatency* pl, const LatencyTag* tag) {
+    if (!pl || !tag) return;
+
+    Platform_MutexLock(&pl->lock);
+    if (pl->tagCount == LATENCY_TAG_CAPACITY) {
+        pl->tagHead = (pl->tagHead + 1) % LATENCY_TAG_CAPACITY;
+        pl->tagCount--;
+    }
+    pl->tags[(pl->tagHead + pl->tagCount) % LATENCY_TAG_CAPACITY] = *tag;
+    pl->tagCount++;
+    Platform_MutexUnlock(&pl->lock);
+}
+
+bool PipelineLatency_TakeTag(PipelineLatency* pl, int64_t timestamp, LatencyTag* tag) {
+    if (!pl) return false;
+
+    bool found = false;
+    Platform_MutexLock(&pl->lock);
+    while (pl->tagCount > 0) {
+        LatencyTag* oldest = &pl->tags[pl->tagHead];
+        if (oldest->timestamp > timestamp) break;
+
+        if (oldest->timestamp == timestamp) {
+            if (tag) *tag = *oldest;
+            found = true;
+        }
+        pl->tagHead = (pl->tagHead + 1) % LATENCY_TAG_CAPACITY;
+        pl->tagCount--;
+        if (found) break;
+    }
+    Platform_MutexUnlock(&pl->lock);
+    return found;
+}
+
+void PipelineLatency_GetSummary(PipelineLatency* pl, LatencyStage stage, LatencySummary* summary) {
+    if (!summary) return;
+    memset(summary, 0, sizeof(*summary));
+    if (!pl || stage < 0 || stage >= LATENCY_STAGE_COUNT) return;
+
+    Platform_MutexLock(&pl->lock);
+    const LatencyHistogram* hist = &pl->stages[stage];
+    summary->count = hist->count;
+    summary->p50 = LatencyHistogram_Percentile(hist, 50.0);
+    summary->p99 = LatencyHistogram_Percentile(hist, 99.0);
+    summary->p999 = LatencyHistogram_Percentile(hist, 99.9);
+    summary->max = hist->max;
+    summary->mean = hist->count > 0 ? (double)hist->total / (double)hist->count : 0.0;
+    Platform_MutexUnlock(&pl->lock);
+}
+
+void PipelineLatency_GetHistogram(PipelineLatency* pl, LatencyStage stage, LatencyHistogram* hist) {
+    if (!hist) return;
+    if (!pl || stage < 0 || stage >= LATENCY_STAGE_COUNT) {
+        LatencyHistogram_Reset(hist);
+        return;
+    }
+    Platform_MutexLock(&pl->lock);
+    *hist = pl->stages[stage];
+    Platform_MutexUnlock(&pl->lock);
+}
+
+void PipelineLatency_Reset(PipelineLatency* pl) {
+    if (!pl) return;
+    Platform_MutexLock(&pl->lock);
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+        LatencyHistogram_Reset(&pl->stages[i]);
+    }
+    Platform_MutexUnlock(&pl->lock);
+}
+
+const char* PipelineLatency_StageName(LatencyStage stage) {
+    if (stage < 0 || stage >= LATENCY_STAGE_COUNT) return "?";
+    return g_stageNames[stage];
+}
+
+void PipelineLatency_FormatSummary(LatencyStage stage, const LatencySummary* summary,
+                                   char* buffer, size_t size) {
+    if (!buffer || size == 0) return;
+    if (!summary) {
+        buffer[0] = '\0';
+        return;
+    }
+    snprintf(buffer, size, "%s n=%llu p50=%.2fms p99=%.2fms p99.9=%.2fms max=%.2fms",
+             PipelineLatency_StageName(stage), (unsigned long long)summary->count,
+             summary->p50 / 10000.0, summary->p99 / 10000.0, summary->p999 / 10000.0,
+             summary->max / 10000.0);
+}
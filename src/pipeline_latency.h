@@ -0,0 +1,101 @@
+/*
+ * Pipeline Latency - Per-stage latency histograms for the capture pipeline
+ * Portable C; values in 100-ns units on the caller's clock (FrameHub_Now)
+ *
+ * Averages hide the tail stalls that show up as stutter, so every sample goes
+ * into a log-linear (HDR-style) histogram: exact below 32 units, then 16
+ * linear sub-buckets per power of two (<= 6.25% error) up to ~30 hours.
+ * Percentiles come from bucket counts, so recording is O(1) and memory is
+ * fixed.
+ *
+ * Frames are tagged at submit (grab and submit time, keyed by timestamp) so
+ * the encoder output thread can measure encode time and true
+ * capture-to-buffer latency when the frame comes back.
+ */
+
+#ifndef PIPELINE_LATENCY_H
+#define PIPELINE_LATENCY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define LATENCY_SUB_BUCKET_BITS     4
+#define LATENCY_SUB_BUCKETS         (1 << LATENCY_SUB_BUCKET_BITS)
+#define LATENCY_MAX_BITS            40      // Values clamp to 2^40 - 1
+#define LATENCY_BUCKET_COUNT        ((LATENCY_MAX_BITS - LATENCY_SUB_BUCKET_BITS + 1) * LATENCY_SUB_BUCKETS)
+
+#define LATENCY_TAG_CAPACITY        64      // Frames tracked between submit and completion
+
+typedef struct {
+    uint64_t counts[LATENCY_BUCKET_COUNT];
+    uint64_t count;
+    int64_t min;
+    int64_t max;
+    int64_t total;
+} LatencyHistogram;
+
+void LatencyHistogram_Reset(LatencyHistogram* hist);
+void LatencyHistogram_Record(LatencyHistogram* hist, int64_t value);
+void LatencyHistogram_Merge(LatencyHistogram* dst, const LatencyHistogram* src);
+
+// Smallest value v with at least 'percentile' % of samples <= v (bucket
+// upper bound, clamped to max). 0 if empty.
+int64_t LatencyHistogram_Percentile(const LatencyHistogram* hist, double percentile);
+
+typedef enum {
+    LATENCY_ACQUIRE = 0,        // Grabbed by the hub → taken by the consumer
+    LATENCY_CONVERT,            // Color conversion (incl. CPU readback)
+    LATENCY_SUBMIT,             // Encoder submit call
+    LATENCY_ENCODE,             // Submit → encoder output
+    LATENCY_DRAIN,              // Encoder output → stored in the buffer
+    LATENCY_SAVE,               // Save request → file written
+    LATENCY_CAPTURE_TO_BUFFER,  // Grabbed → stored in the buffer (end to end)
+    LATENCY_STAGE_COUNT
+} LatencyStage;
+
+typedef struct {
+    uint64_t count;
+    int64_t p50;
+    int64_t p99;
+    int64_t p999;
+    int64_t max;
+    double mean;
+} LatencySummary;
+
+// Times carried with a frame from submit to encoder output
+typedef struct {
+    int64_t timestamp;          // Frame timestamp (key)
+    int64_t grabTime;
+    int64_t submitTime;
+} LatencyTag;
+
+typedef struct PipelineLatency PipelineLatency;
+
+PipelineLatency* PipelineLatency_Create(void);
+void PipelineLatency_Destroy(PipelineLatency* pl);
+
+void PipelineLatency_Record(PipelineLatency* pl, LatencyStage stage, int64_t value);
+
+// Remember a submitted frame (oldest dropped when full)
+void PipelineLatency_TagFrame(PipelineLatency* pl, const LatencyTag* tag);
+
+// Take the tag for 'timestamp'. Older tags (frames the encoder never
+// returned) are discarded. Returns false if there is none.
+bool PipelineLatency_TakeTag(PipelineLatency* pl, int64_t timestamp, LatencyTag* tag);
+
+// p50 / p99 / p99.9 / max since the last reset
+void PipelineLatency_GetSummary(PipelineLatency* pl, LatencyStage stage, LatencySummary* summary);
+
+// Copy of a stage's histogram (for merging or custom percentiles)
+void PipelineLatency_GetHistogram(PipelineLatency* pl, LatencyStage stage, LatencyHistogram* hist);
+
+void PipelineLatency_Reset(PipelineLatency* pl);
+
+const char* PipelineLatency_StageName(LatencyStage stage);
+
+// One-line summary for logs, e.g. "encode n=600 p50=4.10ms p99=9.80ms p99.9=15.2ms max=15.9ms"
+void PipelineLatency_FormatSummary(LatencyStage stage, const LatencySummary* summary,
+                                   char* buffer, size_t size);
+
+#endif // PIPELINE_LATENCY_H
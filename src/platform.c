@@ -0,0 +1,209 @@
+/*
+ * Platform Implementation
+ * Win32 and POSIX back ends for the primitives in platform.h
+ */
+
+#include "platform.h"
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <errno.h>
+#include <time.h>
+#endif
+
+// ============================================================================
+// Win32
+// ============================================================================
+
+#ifdef _WIN32
+
+void Platform_MutexInit(PlatformMutex* m) { InitializeCriticalSection(m); }
+void Platform_MutexDestroy(PlatformMutex* m) { DeleteCriticalSection(m); }
+void Platform_MutexLock(PlatformMutex* m) { EnterCriticalSection(m); }
+void Platform_MutexUnlock(PlatformMutex* m) { LeaveCriticalSection(m); }
+
+bool Platform_EventCreate(PlatformEvent* e, bool manualReset, bool initialState) {
+    e->handle = CreateEvent(NULL, manualReset, initialState, NULL);
+    return e->handle != NULL;
+}
+
+void Platform_EventDestroy(PlatformEvent* e) {
+    if (e->handle) CloseHandle(e->handle);
+    e->handle = NULL;
+}
+
+void Platform_EventSet(PlatformEvent* e) { SetEvent(e->handle); }
+void Platform_EventReset(PlatformEvent* e) { ResetEvent(e->handle); }
+
+bool Platform_EventWait(PlatformEvent* e, int timeoutMs) {
+    DWORD timeout = timeoutMs < 0 ? INFINITE : (DWORD)timeoutMs;
+    return WaitForSingleObject(e->handle, timeout) == WAIT_OBJECT_0;
+}
+
+static unsigned __stdcall ThreadStart(void* param) {
+    PlatformThread* t = (PlatformThread*)param;
+    t->fn(t->param);
+    return 0;
+}
+
+bool Platform_ThreadCreate(PlatformThread* t, PlatformThreadFn fn, void* param) {
+    t->fn = fn;
+    t->param = param;
+    t->handle = (HANDLE)_beginthreadex(NULL, 0, ThreadStart, t, 0, NULL);
+    return t->handle != NULL;
+}
+
+void Platform_ThreadJoin(PlatformThread* t) {
+    if (!t->handle) return;
+    WaitForSingleObject(t->handle, INFINITE);
+    CloseHandle(t->handle);
+    t->handle = NULL;
+}
+
+void Platform_SleepMs(int ms) { Sleep(ms); }
+
+int64_t Platform_SystemNow(void) {
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    // Split to avoid overflow of now * 10^7
+    return (now.QuadPart / freq.QuadPart) * PLATFORM_UNITS_PER_SECOND +
+           (now.QuadPart % freq.QuadPart) * PLATFORM_UNITS_PER_SECOND / freq.QuadPart;
+}
+
+int64_t Platform_SystemNowNs(void) {
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER now;
+    if (freq.QuadPart == 0) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    return (now.QuadPart / freq.QuadPart) * 1000000000LL +
+           (now.QuadPart % freq.QuadPart) * 1000000000LL / freq.QuadPart;
+}
+
+int Platform_FileSeek64(FILE* file, int64_t offset, int origin) { return _fseeki64(file, offset, origin); }
+int64_t Platform_FileTell64(FILE* file) { return _ftelli64(file); }
+
+// ============================================================================
+// POSIX
+// ============================================================================
+
+#else
+
+void Platform_MutexInit(PlatformMutex* m) { pthread_mutex_init(m, NULL); }
+void Platform_MutexDestroy(PlatformMutex* m) { pthread_mutex_destroy(m); }
+void Platform_MutexLock(PlatformMutex* m) { pthread_mutex_lock(m); }
+void Platform_MutexUnlock(PlatformMutex* m) { pthread_mutex_unlock(m); }
+
+bool Platform_EventCreate(PlatformEvent* e, bool manualReset, bool initialState) {
+    // Timed waits run on the monotonic clock, like WaitForSingleObject
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    int result = pthread_cond_init(&e->cond, &attr);
+    pthread_condattr_destroy(&attr);
+    if (result != 0) return false;
+
+    pthread_mutex_init(&e->lock, NULL);
+    e->signaled = initialState;
+    e->manualReset = manualReset;
+    return true;
+}
+
+void Platform_EventDestroy(PlatformEvent* e) {
+    pthread_cond_destroy(&e->cond);
+    pthread_mutex_destroy(&e->lock);
+}
+
+void Platform_EventSet(PlatformEvent* e) {
+    pthread_mutex_lock(&e->lock);
+    e->signaled = true;
+    if (e->manualReset) {
+        pthread_cond_broadcast(&e->cond);
+    } else {
+        pthread_cond_signal(&e->cond);
+    }
+    pthread_mutex_unlock(&e->lock);
+}
+
+void Platform_EventReset(PlatformEvent* e) {
+    pthread_mutex_lock(&e->lock);
+    e->signaled = false;
+    pthread_mutex_unlock(&e->lock);
+}
+
+bool Platform_EventWait(PlatformEvent* e, int timeoutMs) {
+    struct timespec deadline;
+    if (timeoutMs >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_nsec += (long)(timeoutMs % 1000) * 1000000L;
+        deadline.tv_sec += timeoutMs / 1000 + deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+    }
+
+    pthread_mutex_lock(&e->lock);
+    while (!e->signaled) {
+        int result = timeoutMs < 0 ? pthread_cond_wait(&e->cond, &e->lock)
+                                   : pthread_cond_timedwait(&e->cond, &e->lock, &deadline);
+        if (result == ETIMEDOUT) break;
+    }
+    bool signaled = e->signaled;
+    if (signaled && !e->manualReset) e->signaled = false;
+    pthread_mutex_unlock(&e->lock);
+    return signaled;
+}
+
+static void* ThreadStart(void* param) {
+    PlatformThread* t = (PlatformThread*)param;
+    t->fn(t->param);
+    return NULL;
+}
+
+bool Platform_ThreadCreate(PlatformThread* t, PlatformThreadFn fn, void* param) {
+    t->fn = fn;
+    t->param = param;
+    return pthread_create(&t->handle, NULL, ThreadStart, t) == 0;
+}
+
+void Platform_ThreadJoin(PlatformThread* t) {
+    pthread_join(t->handle, NULL);
+}
+
+void Platform_SleepMs(int ms) {
+    struct timespec ts = { ms / 1000, (long)(ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+int64_t Platform_SystemNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * PLATFORM_UNITS_PER_SECOND + ts.tv_nsec / 100;
+}
+
+int64_t Platform_SystemNowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int Platform_FileSeek64(FILE* file, int64_t offset, int origin) { return fseeko(file, (off_t)offset, origin); }
+int64_t Platform_FileTell64(FILE* file) { return (int64_t)ftello(file); }
+
+#endif
+
+// ============================================================================
+// Clock source
+// ============================================================================
+
+static PlatformClockSource g_clockSource = NULL;
+static void* g_clockUserData = NULL;
+
+void Platform_SetClockSource(PlatformClockSource source, void* userData) {
+    g_clockUserData = userData;
+    g_clockSource = source;
+}
+
+int64_t Platform_Now(void) {
+    return g_clockSource ? g_clockSource(g_clockUserData) : Platform_SystemNow();
+}
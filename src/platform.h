@@ -0,0 +1,190 @@
+/*
+ * Platform - Thin OS layer for the portable pipeline core
+ * Portable C; Win32 and POSIX (pthreads, clock_gettime)
+ *
+ * Mutex, event, 64-bit atomics, threads, a monotonic (replaceable) clock
+ * and 64-bit file offsets, so the core (sample buffer, logger, pacing,
+ * backpressure, the diagnostics modules) builds with gcc/clang on Linux and
+ * can be profiled there. On POSIX it also defines the few Windows base types the shared
+ * headers use (BYTE, DWORD, LONGLONG, BOOL, RECT, MAX_PATH). Modules that
+ * only exist on Windows (capture, NVENC, WASAPI, Media Foundation) keep
+ * including <windows.h> directly.
+ */
+
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <pthread.h>
+
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef uint32_t UINT32;
+typedef int32_t LONG;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONGLONG;
+typedef int BOOL;
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0
+#endif
+
+typedef struct {
+    LONG left;
+    LONG top;
+    LONG right;
+    LONG bottom;
+} RECT;
+
+#define MAX_PATH 260
+#endif
+
+// ============================================================================
+// Mutex
+// ============================================================================
+
+#ifdef _WIN32
+typedef CRITICAL_SECTION PlatformMutex;
+#else
+typedef pthread_mutex_t PlatformMutex;
+#endif
+
+void Platform_MutexInit(PlatformMutex* m);
+void Platform_MutexDestroy(PlatformMutex* m);
+void Platform_MutexLock(PlatformMutex* m);
+void Platform_MutexUnlock(PlatformMutex* m);
+
+// ============================================================================
+// Event
+// ============================================================================
+
+// Auto-reset events release one waiter and clear; manual-reset events stay
+// set until Platform_EventReset
+typedef struct {
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool signaled;
+    bool manualReset;
+#endif
+} PlatformEvent;
+
+#define PLATFORM_WAIT_INFINITE  (-1)
+
+bool Platform_EventCreate(PlatformEvent* e, bool manualReset, bool initialState);
+void Platform_EventDestroy(PlatformEvent* e);
+void Platform_EventSet(PlatformEvent* e);
+void Platform_EventReset(PlatformEvent* e);
+
+// True if the event was set within timeoutMs (PLATFORM_WAIT_INFINITE: no limit)
+bool Platform_EventWait(PlatformEvent* e, int timeoutMs);
+
+// ============================================================================
+// Thread
+// ============================================================================
+
+typedef void (*PlatformThreadFn)(void* param);
+
+// The struct is the thread's start argument: keep it in place until Join
+typedef struct {
+#ifdef _WIN32
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+    PlatformThreadFn fn;
+    void* param;
+} PlatformThread;
+
+bool Platform_ThreadCreate(PlatformThread* t, PlatformThreadFn fn, void* param);
+void Platform_ThreadJoin(PlatformThread* t);
+
+void Platform_SleepMs(int ms);
+
+// ============================================================================
+// Clock
+// ============================================================================
+
+#define PLATFORM_UNITS_PER_SECOND 10000000LL    // 100-ns units
+
+// Monotonic time in 100-ns units (arbitrary epoch), or the installed source
+int64_t Platform_Now(void);
+
+// System monotonic clock, ignoring any installed source (measuring real cost)
+int64_t Platform_SystemNow(void);
+
+// Same clock in nanoseconds, for timing operations shorter than 100 ns units
+int64_t Platform_SystemNowNs(void);
+
+// Replace the clock behind Platform_Now, e.g. with a simulated one; NULL
+// restores the system clock. Install it before starting threads that read
+// the clock. Everything stamped from Platform_Now follows it (frame hub,
+// media clock, flight recorder, metrics), but kernel waits do not: frame
+// pacer timers and event timeouts still run on the system clock.
+typedef int64_t (*PlatformClockSource)(void* userData);
+void Platform_SetClockSource(PlatformClockSource source, void* userData);
+
+// ============================================================================
+// Atomics (64-bit; loads acquire, stores release, read-modify-write both)
+// ============================================================================
+
+#ifdef _WIN32
+typedef volatile LONG64 PlatformAtomic64;
+
+// x64: aligned volatile loads and stores are acquire / release
+static inline int64_t Platform_AtomicLoad64(PlatformAtomic64* a) {
+    int64_t v = *a;
+    _ReadWriteBarrier();
+    return v;
+}
+static inline void Platform_AtomicStore64(PlatformAtomic64* a, int64_t v) {
+    _ReadWriteBarrier();
+    *a = v;
+}
+// Returns the new value
+static inline int64_t Platform_AtomicAdd64(PlatformAtomic64* a, int64_t v) {
+    return InterlockedExchangeAdd64(a, v) + v;
+}
+// Returns the previous value (the exchange happened if it equals 'expected')
+static inline int64_t Platform_AtomicCompareExchange64(PlatformAtomic64* a, int64_t expected, int64_t desired) {
+    return InterlockedCompareExchange64(a, desired, expected);
+}
+#else
+typedef volatile int64_t PlatformAtomic64;
+
+static inline int64_t Platform_AtomicLoad64(PlatformAtomic64* a) {
+    return __atomic_load_n(a, __ATOMIC_ACQUIRE);
+}
+static inline void Platform_AtomicStore64(PlatformAtomic64* a, int64_t v) {
+    __atomic_store_n(a, v, __ATOMIC_RELEASE);
+}
+static inline int64_t Platform_AtomicAdd64(PlatformAtomic64* a, int64_t v) {
+    return __atomic_add_fetch(a, v, __ATOMIC_ACQ_REL);
+}
+static inline int64_t Platform_AtomicCompareExchange64(PlatformAtomic64* a, int64_t expected, int64_t desired) {
+    __atomic_compare_exchange_n(a, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    return expected;
+}
+#endif
+
+// ============================================================================
+// Files
+// ============================================================================
+
+// 64-bit offsets on every platform (long is 32 bits on Windows)
+int Platform_FileSeek64(FILE* file, int64_t offset, int origin);
+int64_t Platform_FileTell64(FILE* file);
+
+#endif // PLATFORM_H
@@ -0,0 +1,225 @@
+/*
+ * Quality Controller Implementation
+ * Windowed rate measurement and QP / keyframe interval steering
+ */
+
+#include "quality_controller.h"
+#include "platform.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UNITS_PER_SECOND 10000000LL
+#define UNITS_PER_MS     10000LL
+
+// Codec QP scale: +6 QP roughly halves the bitrate
+#define QP_PER_HALVING 6.0
+
+// Largest single QP change (a bigger error takes more windows)
+#define MAX_QP_STEP 4
+
+// Relaxing aims for this fraction of the target, leaving headroom below the
+// over threshold
+#define RELAX_AIM 0.9
+
+#define QP_LIMIT 51
+
+struct QualityController {
+    PlatformMutex lock;
+    QualityControllerConfig config;
+
+    int qp;
+    int keyframeMs;
+    int prevQp;                 // Settings before the last change
+    int prevKeyframeMs;
+    bool pending;               // Change waiting for Poll
+
+    int64_t windowStart;
+    uint64_t windowBytes;
+    bool haveWindow;
+    int skipWindows;            // Windows measured across a settings change
+    int underCount;
+
+    double rate;                // Smoothed over windows at the current settings
+    bool haveRate;
+
+    QualityControllerStats stats;
+};
+
+// ============================================================================
+// Internal (lock held)
+// ============================================================================
+
+static int64_t WindowLength(const QualityController* qc) {
+    int64_t window = qc->config.window > 0 ? qc->config.window : 2 * UNITS_PER_SECOND;
+    // A window must hold a keyframe, or the I-frame cost lands unevenly
+    int64_t keyframe = (int64_t)qc->keyframeMs * UNITS_PER_MS;
+    return window > keyframe ? window : keyframe;
+}
+
+static void ApplyChange(QualityController* qc, int qp, int keyframeMs, bool raise) {
+    qc->prevQp = qc->qp;
+    qc->prevKeyframeMs = qc->keyframeMs;
+    qc->qp = qp;
+    qc->keyframeMs = keyframeMs;
+    qc->pending = true;
+    qc->skipWindows = 1;
+    qc->haveRate = false;
+    qc->underCount = 0;
+    if (raise) qc->stats.raises++;
+    else qc->stats.relaxes++;
+}
+
+static void Evaluate(QualityController* qc, double windowRate) {
+    const QualityControllerConfig* cfg = &qc->config;
+
+    qc->stats.windows++;
+    qc->stats.lastWindowRate = windowRate;
+
+    if (qc->skipWindows > 0) {
+        qc->skipWindows--;
+        return;
+    }
+
+    qc->rate = qc->haveRate ? (qc->rate + windowRate) / 2.0 : windowRate;
+    qc->haveRate = true;
+    qc->stats.rate = qc->rate;
+
+    double ratio = qc->rate / (double)cfg->targetBytesPerSec;
+
+    if (ratio > cfg->overThreshold) {
+        qc->underCount = 0;
+        if (qc->qp < cfg->maxQp) {
+            int step = (int)ceil(QP_PER_HALVING * log2(ratio));
+            if (step < 1) step = 1;
+            if (step > MAX_QP_STEP) step = MAX_QP_STEP;
+            int qp = qc->qp + step;
+            if (qp > cfg->maxQp) qp = cfg->maxQp;
+            ApplyChange(qc, qp, qc->keyframeMs, true);
+        } else if (qc->keyframeMs < cfg->maxKeyframeMs) {
+            int keyframeMs = qc->keyframeMs * 3 / 2;
+            if (keyframeMs > cfg->maxKeyframeMs) keyframeMs = cfg->maxKeyframeMs;
+            ApplyChange(qc, qc->qp, keyframeMs, true);
+        }
+    } else if (ratio < cfg->underThreshold) {
+        if (++qc->underCount < cfg->relaxWindows) return;
+        qc->underCount = 0;
+        if (qc->keyframeMs > cfg->initialKeyframeMs) {
+            ApplyChange(qc, qc->qp, cfg->initialKeyframeMs, false);
+        } else if (qc->qp > cfg->initialQp) {
+            int step = ratio > 0.0 ? (int)floor(QP_PER_HALVING * log2(RELAX_AIM / ratio)) : MAX_QP_STEP;
+            if (step < 1) step = 1;
+            if (step > MAX_QP_STEP) step = MAX_QP_STEP;
+            int qp = qc->qp - step;
+            if (qp < cfg->initialQp) qp = cfg->initialQp;
+            ApplyChange(qc, qp, qc->keyframeMs, false);
+        }
+    } else {
+        qc->underCount = 0;
+    }
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void QualityController_DefaultConfig(QualityControllerConfig* config, int64_t targetBytesPerSec,
+                                     int initialQp, int initialKeyframeMs) {
+    if (!config) return;
+    memset(config, 0, sizeof(*config));
+    config->targetBytesPerSec = targetBytesPerSec;
+    config->initialQp = initialQp;
+    config->maxQp = initialQp > 42 ? initialQp : 42;
+    config->initialKeyframeMs = initialKeyframeMs;
+    config->maxKeyframeMs = initialKeyframeMs * 3;
+    config->window = 0;
+    config->overThreshold = 1.10;
+    config->underThreshold = 0.70;
+    config->relaxWindows = 2;
+}
+
+QualityController* QualityController_Create(const QualityControllerConfig* config) {
+    if (!config || config->targetBytesPerSec <= 0 || config->initialQp <= 0 ||
+        config->initialKeyframeMs <= 0) {
+        return NULL;
+    }
+
+    QualityController* qc = (QualityController*)calloc(1, sizeof(QualityController));
+    if (!qc) return NULL;
+
+    Platform_MutexInit(&qc->lock);
+    qc->config = *config;
+    QualityControllerConfig* cfg = &qc->config;
+    if (cfg->maxQp < cfg->initialQp) cfg->maxQp = cfg->initialQp;
+    if (cfg->maxQp > QP_LIMIT) cfg->maxQp = QP_LIMIT;
+    if (cfg->maxKeyframeMs < cfg->initialKeyframeMs) cfg->maxKeyframeMs = cfg->initialKeyframeMs;
+    if (cfg->overThreshold < 1.0) cfg->overThreshold = 1.0;
+    if (cfg->underThreshold > 1.0) cfg->underThreshold = 1.0;
+    if (cfg->relaxWindows < 1) cfg->relaxWindows = 1;
+
+    qc->qp = qc->prevQp = cfg->initialQp;
+    qc->keyframeMs = qc->prevKeyframeMs = cfg->initialKeyframeMs;
+    qc->stats.targetBytesPerSec = cfg->targetBytesPerSec;
+    return qc;
+}
+
+void QualityController_Destroy(QualityController* qc) {
+    if (!qc) return;
+    Platform_MutexDestroy(&qc->lock);
+    free(qc);
+}
+
+void QualityController_Record(QualityController* qc, int64_t timestamp, size_t bytes) {
+    if (!qc) return;
+
+    Platform_MutexLock(&qc->lock);
+    if (!qc->haveWindow || timestamp < qc->windowStart) {
+        qc->windowStart = timestamp;
+        qc->windowBytes = 0;
+        qc->haveWindow = true;
+    } else {
+        int64_t elapsed = timestamp - qc->windowStart;
+        if (elapsed >= WindowLength(qc)) {
+            Evaluate(qc, (double)qc->windowBytes * UNITS_PER_SECOND / (double)elapsed);
+            qc->windowStart = timestamp;
+            qc->windowBytes = 0;
+        }
+    }
+    qc->windowBytes += bytes;
+    Platform_MutexUnlock(&qc->lock);
+}
+
+bool QualityController_Poll(QualityController* qc, int* qp, int* keyframeMs) {
+    if (!qc) return false;
+
+    Platform_MutexLock(&qc->lock);
+    bool changed = qc->pending;
+    if (changed) {
+        if (qp) *qp = qc->qp;
+        if (keyframeMs) *keyframeMs = qc->keyframeMs;
+        qc->pending = false;
+    }
+    Platform_MutexUnlock(&qc->lock);
+    return changed;
+}
+
+void QualityController_Rejected(QualityController* qc) {
+    if (!qc) return;
+
+    Platform_MutexLock(&qc->lock);
+    qc->qp = qc->prevQp;
+    qc->keyframeMs = qc->prevKeyframeMs;
+    qc->pending = false;
+    qc->skipWindows = 0;
+    Platform_MutexUnlock(&qc->lock);
+}
+
+void QualityController_GetStats(QualityController* qc, QualityControllerStats* stats) {
+    if (!qc || !stats) return;
+
+    Platform_MutexLock(&qc->lock);
+    *stats = qc->stats;
+    stats->qp = qc->qp;
+    stats->keyframeMs = qc->keyframeMs;
+    Platform_MutexUnlock(&qc->lock);
+}
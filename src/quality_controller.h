@@ -0,0 +1,72 @@
+/*
+ * Quality Controller - Holds the replay buffer to a memory budget
+ * Portable C; the caller feeds encoded frame sizes and applies the result
+ *
+ * The replay ring keeps a fixed duration, so its memory is that duration
+ * times the encoded bitrate. With constant QP the bitrate follows content
+ * (a static desktop vs. a game can differ 20x). The controller measures
+ * bytes/s over windows of the media timeline and steers QP and keyframe
+ * interval so the rate stays at budget / duration:
+ * - Over target: raise QP by the step the overshoot calls for (~6 QP per
+ *   halving of bitrate); at the QP ceiling, lengthen the keyframe interval
+ * - Well under target for several windows: give quality back (keyframe
+ *   interval first), never above the starting quality
+ * - The band between the two thresholds is the hysteresis; after a change
+ *   one window is skipped so the next measurement sees the new settings
+ *
+ * Frames are recorded from the encoder output thread; the decision is taken
+ * with QualityController_Poll on the thread that submits frames.
+ */
+
+#ifndef QUALITY_CONTROLLER_H
+#define QUALITY_CONTROLLER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    int64_t targetBytesPerSec;  // Budget / duration (video only)
+    int initialQp;              // Preset QP; also the best quality allowed
+    int maxQp;                  // Worst quality allowed
+    int initialKeyframeMs;      // Preset keyframe interval; also the shortest
+    int maxKeyframeMs;          // Longest keyframe interval allowed
+    int64_t window;             // Measurement window, 100-ns units (0 = 2s or one keyframe interval)
+    double overThreshold;       // Act when rate > target * this (e.g. 1.10)
+    double underThreshold;      // Relax when rate < target * this (e.g. 0.70)
+    int relaxWindows;           // Consecutive under-target windows before relaxing
+} QualityControllerConfig;
+
+typedef struct {
+    int qp;
+    int keyframeMs;
+    double rate;                // Smoothed bytes/s
+    double lastWindowRate;      // Bytes/s of the latest complete window
+    int64_t targetBytesPerSec;
+    uint64_t windows;
+    uint64_t raises;            // Adjustments toward lower bitrate
+    uint64_t relaxes;           // Adjustments toward higher quality
+} QualityControllerStats;
+
+typedef struct QualityController QualityController;
+
+// Fill a config with defaults for the given target and preset
+void QualityController_DefaultConfig(QualityControllerConfig* config, int64_t targetBytesPerSec,
+                                     int initialQp, int initialKeyframeMs);
+
+QualityController* QualityController_Create(const QualityControllerConfig* config);
+void QualityController_Destroy(QualityController* qc);
+
+// Encoded frame of 'bytes' at media time 'timestamp' (100-ns units)
+void QualityController_Record(QualityController* qc, int64_t timestamp, size_t bytes);
+
+// Returns true once per decision with the new QP and keyframe interval.
+// If the encoder refuses them, report it with QualityController_Rejected.
+bool QualityController_Poll(QualityController* qc, int* qp, int* keyframeMs);
+
+// The last polled change wasn't applied: return to the previous settings
+void QualityController_Rejected(QualityController* qc);
+
+void QualityController_GetStats(QualityController* qc, QualityControllerStats* stats);
+
+#endif // QUALITY_CONTROLLER_H
@@ -0,0 +1,306 @@
+/*
+ * RAM Estimator Implementation
+ * Windowed rate measurement, moving statistics and profile file I/O
+ */
+
+#include "ram_estimator.h"
+#include "platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define RAM_UNITS_PER_SECOND    10000000LL
+#define RAM_WINDOW_UNITS        (RAM_ESTIMATOR_WINDOW_SECONDS * RAM_UNITS_PER_SECOND)
+#define RAM_Z_95                1.645   // One-sided 95% of a normal
+#define RAM_PIXEL_EXPONENT      0.75
+#define RAM_FILE_HEADER         "# lwsr replay RAM profiles v1: width height fps quality windows bytesPerSec variance framesPerSec"
+
+typedef struct {
+    RamProfileKey key;
+    uint64_t windows;
+    double mean;                // Bytes per second
+    double variance;
+    double framesPerSecond;
+} RamProfile;
+
+struct RamEstimator {
+    PlatformMutex lock;
+    RamProfile profiles[RAM_ESTIMATOR_PROFILES];
+    int profileCount;
+
+    // Run being learned (current < 0: none)
+    int current;
+    int64_t windowStart;        // -1 until the first frame
+    int64_t windowBytes;
+    int windowFrames;
+    double runBytes;            // Completed windows only
+    double runSeconds;
+};
+
+// ============================================================================
+// Profiles
+// ============================================================================
+
+static bool SameKey(const RamProfileKey* a, const RamProfileKey* b) {
+    return a->width == b->width && a->height == b->height &&
+           a->fps == b->fps && a->quality == b->quality;
+}
+
+static bool ValidKey(const RamProfileKey* key) {
+    return key && key->width > 0 && key->height > 0 && key->fps > 0;
+}
+
+static double PixelRate(const RamProfileKey* key) {
+    return (double)key->width * key->height * key->fps;
+}
+
+static int FindProfile(RamEstimator* est, const RamProfileKey* key) {
+    for (int i = 0; i < est->profileCount; i++) {
+        if (SameKey(&est->profiles[i].key, key)) return i;
+    }
+    return -1;
+}
+
+// Existing profile for 'key', or a fresh one (replacing the least learned
+// when full, never the run in progress)
+static int GetProfile(RamEstimator* est, const RamProfileKey* key) {
+    int index = FindProfile(est, key);
+    if (index >= 0) return index;
+
+    if (est->profileCount < RAM_ESTIMATOR_PROFILES) {
+        index = est->profileCount++;
+    } else {
+        index = -1;
+        for (int i = 0; i < est->profileCount; i++) {
+            if (i == est->current) continue;
+            if (index < 0 || est->profiles[i].windows < est->profiles[index].windows) index = i;
+        }
+    }
+
+    RamProfile* p = &est->profiles[index];
+    memset(p, 0, sizeof(*p));
+    p->key = *key;
+    return index;
+}
+
+// Exponentially weighted mean/variance: a plain running average until
+// RAM_ESTIMATOR_HORIZON windows, then a moving one so the estimate follows
+// changes in what is usually captured
+static void AddWindow(RamProfile* p, double rate, double framesPerSecond) {
+    p->windows++;
+    uint64_t n = p->windows < RAM_ESTIMATOR_HORIZON ? p->windows : RAM_ESTIMATOR_HORIZON;
+    double alpha = 1.0 / (double)n;
+    double diff = rate - p->mean;
+    double step = alpha * diff;
+    p->mean += step;
+    p->variance = (1.0 - alpha) * (p->variance + diff * step);
+    p->framesPerSecond += alpha * (framesPerSecond - p->framesPerSecond);
+}
+
+// ============================================================================
+// Lifecycle
+// ============================================================================
+
+RamEstimator* RamEstimator_Create(void) {
+    RamEstimator* est = (RamEstimator*)calloc(1, sizeof(RamEstimator));
+    if (!est) return NULL;
+    Platform_MutexInit(&est->lock);
+    est->current = -1;
+    est->windowStart = -1;
+    return est;
+}
+
+void RamEstimator_Destroy(RamEstimator* est) {
+    if (!est) return;
+    Platform_MutexDestroy(&est->lock);
+    free(est);
+}
+
+// ============================================================================
+// Learning
+// ============================================================================
+
+void RamEstimator_Begin(RamEstimator* est, const RamProfileKey* key) {
+    if (!est) return;
+    Platform_MutexLock(&est->lock);
+    est->current = ValidKey(key) ? GetProfile(est, key) : -1;
+    est->windowStart = -1;
+    est->windowBytes = 0;
+    est->windowFrames = 0;
+    est->runBytes = 0;
+    est->runSeconds = 0;
+    Platform_MutexUnlock(&est->lock);
+}
+
+void RamEstimator_Record(RamEstimator* est, int64_t timestamp, uint32_t bytes) {
+    if (!est) return;
+    Platform_MutexLock(&est->lock);
+    if (est->current < 0) {
+        Platform_MutexUnlock(&est->lock);
+        return;
+    }
+
+    // Timeline restarted: the partial window can't be measured
+    if (est->windowStart < 0 || timestamp < est->windowStart) {
+        est->windowStart = timestamp;
+        est->windowBytes = 0;
+        est->windowFrames = 0;
+    }
+
+    // This frame opens the next window; the finished one spans up to it
+    int64_t elapsed = timestamp - est->windowStart;
+    if (elapsed >= RAM_WINDOW_UNITS) {
+        double seconds = (double)elapsed / RAM_UNITS_PER_SECOND;
+        AddWindow(&est->profiles[est->current], est->windowBytes / seconds, est->windowFrames / seconds);
+        est->runBytes += (double)est->windowBytes;
+        est->runSeconds += seconds;
+        est->windowStart = timestamp;
+        est->windowBytes = 0;
+        est->windowFrames = 0;
+    }
+
+    est->windowBytes += bytes;
+    est->windowFrames++;
+    Platform_MutexUnlock(&est->lock);
+}
+
+void RamEstimator_End(RamEstimator* est) {
+    if (!est) return;
+    Platform_MutexLock(&est->lock);
+    est->current = -1;
+    est->windowStart = -1;
+    Platform_MutexUnlock(&est->lock);
+}
+
+double RamEstimator_GetLiveRate(RamEstimator* est) {
+    if (!est) return 0.0;
+    Platform_MutexLock(&est->lock);
+    double rate = est->runSeconds > 0 ? est->runBytes / est->runSeconds : 0.0;
+    Platform_MutexUnlock(&est->lock);
+    return rate;
+}
+
+// ============================================================================
+// Prediction
+// ============================================================================
+
+// Trusted profile closest in pixel rate, preferring the same quality preset
+static int FindNearest(RamEstimator* est, const RamProfileKey* key) {
+    int best = -1;
+    bool bestSameQuality = false;
+    double bestDistance = 0;
+    double rate = PixelRate(key);
+
+    for (int i = 0; i < est->profileCount; i++) {
+        const RamProfile* p = &est->profiles[i];
+        if (p->windows < RAM_ESTIMATOR_MIN_WINDOWS) continue;
+        bool sameQuality = p->key.quality == key->quality;
+        double distance = fabs(log(PixelRate(&p->key) / rate));
+        if (best < 0 || (sameQuality && !bestSameQuality) ||
+            (sameQuality == bestSameQuality && distance < bestDistance)) {
+            best = i;
+            bestSameQuality = sameQuality;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+bool RamEstimator_Predict(RamEstimator* est, const RamProfileKey* key, int durationSeconds,
+                          RamEstimate* estimate) {
+    if (!est || !ValidKey(key) || !estimate || durationSeconds <= 0) return false;
+    memset(estimate, 0, sizeof(*estimate));
+
+    Platform_MutexLock(&est->lock);
+    int index = FindProfile(est, key);
+    double scale = 1.0;
+    bool tentative = false;
+
+    if (index < 0 || est->profiles[index].windows < RAM_ESTIMATOR_MIN_WINDOWS) {
+        int nearest = FindNearest(est, key);
+        if (nearest >= 0) {
+            scale = pow(PixelRate(key) / PixelRate(&est->profiles[nearest].key), RAM_PIXEL_EXPONENT);
+            index = nearest;
+        }
+        tentative = true;
+    }
+    if (index < 0 || est->profiles[index].windows == 0) {
+        Platform_MutexUnlock(&est->lock);
+        return false;
+    }
+    RamProfile p = est->profiles[index];
+    Platform_MutexUnlock(&est->lock);
+
+    double mean = p.mean * scale;
+    double spread = RAM_Z_95 * sqrt(p.variance) * scale;
+    if (tentative && spread < mean * 0.5) spread = mean * 0.5;
+
+    double low = mean - spread;
+    if (low < 0) low = 0;
+
+    estimate->bytesPerSecond = mean;
+    estimate->expectedBytes = (int64_t)(mean * durationSeconds);
+    estimate->lowBytes = (int64_t)(low * durationSeconds);
+    estimate->highBytes = (int64_t)((mean + spread) * durationSeconds);
+    estimate->windows = p.windows;
+    estimate->tentative = tentative;
+    return true;
+}
+
+// ============================================================================
+// Persistence
+// ============================================================================
+
+bool RamEstimator_Load(RamEstimator* est, const char* path) {
+    if (!est || !path) return false;
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+
+    char line[256];
+    Platform_MutexLock(&est->lock);
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#') continue;
+
+        RamProfileKey key;
+        unsigned long long windows;
+        double mean, variance, framesPerSecond;
+        int end = 0;
+        if (sscanf(line, "%d %d %d %d %llu %lf %lf %lf %n", &key.width, &key.height, &key.fps,
+                   &key.quality, &windows, &mean, &variance, &framesPerSecond, &end) != 8) continue;
+        // More fields than ours: a line from another version of the format
+        if (line[end] != '\0') continue;
+        if (!ValidKey(&key) || windows == 0 || !isfinite(mean) || mean < 0 ||
+            !isfinite(variance) || variance < 0 || !isfinite(framesPerSecond)) continue;
+
+        RamProfile* p = &est->profiles[GetProfile(est, &key)];
+        p->windows = windows;
+        p->mean = mean;
+        p->variance = variance;
+        p->framesPerSecond = framesPerSecond;
+    }
+    Platform_MutexUnlock(&est->lock);
+
+    fclose(file);
+    return true;
+}
+
+bool RamEstimator_Save(RamEstimator* est, const char* path) {
+    if (!est || !path) return false;
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+
+    fprintf(file, "%s\n", RAM_FILE_HEADER);
+    Platform_MutexLock(&est->lock);
+    for (int i = 0; i < est->profileCount; i++) {
+        const RamProfile* p = &est->profiles[i];
+        if (p->windows == 0) continue;
+        fprintf(file, "%d %d %d %d %llu %.1f %.1f %.3f\n", p->key.width, p->key.height, p->key.fps,
+                p->key.quality, (unsigned long long)p->windows, p->mean, p->variance, p->framesPerSecond);
+    }
+    Platform_MutexUnlock(&est->lock);
+
+    bool ok = !ferror(file);
+    if (fclose(file) != 0) ok = false;
+    return ok;
+}
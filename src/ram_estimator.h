@@ -0,0 +1,74 @@
+/*
+ * RAM Estimator - Learns the replay buffer's real data rate per capture profile
+ * Portable C; fed from the encoder output, persisted as a small text file
+ *
+ * CQP output size depends on content and preset far more than on a nominal
+ * bitrate, so a fixed Mbps formula is off by 2-5x either way. Each profile
+ * (resolution, fps, quality preset) keeps exponentially weighted statistics
+ * of the encoded rate measured over RAM_ESTIMATOR_WINDOW_SECONDS windows -
+ * two keyframe intervals, so GOP structure averages out. A buffer of D
+ * seconds is predicted as D times the mean rate, with a range of D times
+ * the 5th-95th percentile window rate (a buffer filled with the busiest or
+ * quietest content seen).
+ *
+ * Profiles never seen are extrapolated from the learned profile nearest in
+ * pixel rate (same quality preset first), scaled by the pixel rate ratio to
+ * the 0.75 power (encoders spend less per pixel as resolution grows), with a
+ * wider range. With nothing learned at all the caller falls back to its own
+ * formula.
+ */
+
+#ifndef RAM_ESTIMATOR_H
+#define RAM_ESTIMATOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RAM_ESTIMATOR_PROFILES          32
+#define RAM_ESTIMATOR_WINDOW_SECONDS    4
+#define RAM_ESTIMATOR_HORIZON           600     // Windows (~40 min) in the moving average
+#define RAM_ESTIMATOR_MIN_WINDOWS       8       // Before a profile is trusted
+
+typedef struct RamEstimator RamEstimator;
+
+typedef struct {
+    int width;
+    int height;
+    int fps;
+    int quality;                // QualityPreset
+} RamProfileKey;
+
+typedef struct {
+    int64_t expectedBytes;
+    int64_t lowBytes;
+    int64_t highBytes;
+    double bytesPerSecond;      // Mean rate used
+    uint64_t windows;           // Windows behind the estimate
+    bool tentative;             // Extrapolated or few windows: wider range
+} RamEstimate;
+
+RamEstimator* RamEstimator_Create(void);
+void RamEstimator_Destroy(RamEstimator* est);
+
+// Merge profiles from a file written by RamEstimator_Save. Missing file: false.
+bool RamEstimator_Load(RamEstimator* est, const char* path);
+bool RamEstimator_Save(RamEstimator* est, const char* path);
+
+// Start learning 'key' from encoder output (closes any run in progress)
+void RamEstimator_Begin(RamEstimator* est, const RamProfileKey* key);
+
+// One encoded frame (timestamp in 100-ns units). Thread-safe.
+void RamEstimator_Record(RamEstimator* est, int64_t timestamp, uint32_t bytes);
+
+// Stop learning; a partial window is dropped
+void RamEstimator_End(RamEstimator* est);
+
+// Current run's mean rate so far (bytes/s, 0 before the first window)
+double RamEstimator_GetLiveRate(RamEstimator* est);
+
+// Predict a buffer of durationSeconds for 'key'. False when nothing usable
+// has been learned yet.
+bool RamEstimator_Predict(RamEstimator* est, const RamProfileKey* key, int durationSeconds,
+                          RamEstimate* estimate);
+
+#endif // RAM_ESTIMATOR_H
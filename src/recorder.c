@@ -0,0 +1,562 @@
+/*
+ * Recorder Implementation
+ * Streams encoded frames from the shared encoder pipeline into an MP4 file
+ *
+ * Threads:
+ * - Recorder thread: takes frames from the frame hub, color convert, submit; feeds AAC
+ * - Encoder output thread: delivers encoded frames → MP4Muxer_WriteVideo
+ * - AAC callback (on recorder thread): encoded audio → MP4Muxer_WriteAudio
+ *
+ * The file is opened on the first keyframe, so it always starts decodable and
+ * the sequence header is known (software encoders emit it in-band).
+ */
+
+#include "recorder.h"
+#include "video_encoder.h"
+#include "gpu_converter.h"
+#include "cpu_converter.h"
+#include "mp4_muxer.h"
+#include "audio_capture.h"
+#include "aac_encoder.h"
+#include "util.h"
+#include "logger.h"
+#include "frame_pacer.h"
+#include "backpressure.h"
+#include "media_clock.h"
+#include "flight_recorder.h"
+#include "thread_registry.h"
+#include "mem_tracker.h"
+#include <stdio.h>
+#include <time.h>
+#include <objbase.h>   // For CoInitializeEx/CoUninitialize
+
+#pragma comment(lib, "ole32.lib")
+
+#define RecLog Logger_Log
+
+struct Recorder {
+    CaptureState* capture;
+    FrameHub* hub;
+    HubConsumer* consumer;
+    RECT crop;                      // Our part of the hub frame
+    AppConfig config;               // Snapshot (quality, encoder, audio sources)
+    char outputPath[MAX_PATH];
+    int fps;
+    int width;
+    int height;
+
+    VideoEncoder* encoder;
+    Backpressure* backpressure;     // Even drops when the encoder falls behind
+
+    // Muxer (opened on first keyframe)
+    MP4Muxer* muxer;
+    BOOL muxerFailed;
+    MediaClock clock;               // Master clock video and audio are stamped on
+    LONGLONG videoBase;             // Media time of the first written frame
+    CRITICAL_SECTION lock;          // Guards muxer open/close vs. writes
+
+    // Audio
+    AudioCaptureContext* audioCapture;
+    AACEncoder* aacEncoder;
+    BYTE* aacConfigData;            // Owned by aacEncoder
+    int aacConfigSize;
+
+    // Thread management
+    HANDLE thread;
+    HANDLE hStopEvent;
+    HANDLE hReadyEvent;             // Signaled once init finished (ok or not)
+    volatile BOOL startOk;
+
+    // Stats
+    int framesSubmitted;
+    volatile LONG framesWritten;
+    int framesDropped;
+};
+
+static DWORD WINAPI RecorderThreadProc(LPVOID param);
+
+void Recorder_GenerateFilename(char* buffer, size_t size, const char* basePath) {
+    time_t now = time(NULL);
+    struct tm* tm_info = localtime(&now);
+
+    char timestamp[64];
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d_%H-%M-%S", tm_info);
+
+    snprintf(buffer, size, "%s\\Recording_%s.mp4", basePath, timestamp);
+}
+
+// ============================================================================
+// Sample sinks
+// ============================================================================
+
+// Open the muxer on the first keyframe (called with rec->lock held)
+static BOOL OpenMuxer(Recorder* rec, LONGLONG firstTimestamp) {
+    BYTE seqHeader[256];
+    DWORD seqHeaderSize = 0;
+    if (!VideoEncoder_GetSequenceHeader(rec->encoder, seqHeader, sizeof(seqHeader), &seqHeaderSize)) {
+        RecLog("Recorder: No sequence header available at first keyframe\n");
+        seqHeaderSize = 0;
+    }
+
+    MuxerConfig videoConfig;
+    videoConfig.width = rec->width;
+    videoConfig.height = rec->height;
+    videoConfig.fps = rec->fps;
+    videoConfig.quality = rec->config.quality;
+    videoConfig.codec = rec->encoder->codec;
+    videoConfig.seqHeader = seqHeaderSize > 0 ? seqHeader : NULL;
+    videoConfig.seqHeaderSize = seqHeaderSize;
+
+    MuxerAudioConfig audioConfig;
+    audioConfig.sampleRate = AAC_SAMPLE_RATE;
+    audioConfig.channels = AAC_CHANNELS;
+    audioConfig.bitrate = AAC_BITRATE;
+    audioConfig.configData = rec->aacConfigData;
+    audioConfig.configSize = rec->aacConfigSize;
+
+    rec->muxer = MP4Muxer_Open(rec->outputPath, &videoConfig, rec->aacEncoder ? &audioConfig : NULL);
+    if (!rec->muxer) {
+        rec->muxerFailed = TRUE;
+        return FALSE;
+    }
+
+    rec->videoBase = firstTimestamp;
+    RecLog("Recorder: File opened on first keyframe (%s, seqHeader=%u bytes)\n",
+           rec->encoder->codec == VIDEO_CODEC_HEVC ? "HEVC" : "H.264", seqHeaderSize);
+    return TRUE;
+}
+
+// Encoded video (encoder output thread, or recorder thread during flush)
+static void WriteVideoFrame(Recorder* rec, const EncodedFrame* frame) {
+    if (!frame || !frame->data || frame->size == 0) return;
+
+    EnterCriticalSection(&rec->lock);
+
+    if (!rec->muxer && !rec->muxerFailed) {
+        // Frames before the first keyframe can't be decoded - skip them
+        if (!frame->isKeyframe || !OpenMuxer(rec, frame->timestamp)) {
+            LeaveCriticalSection(&rec->lock);
+            return;
+        }
+    }
+
+    if (rec->muxer) {
+        MuxerSample sample;
+        sample.data = frame->data;
+        sample.size = frame->size;
+        sample.timestamp = frame->timestamp - rec->videoBase;
+        sample.duration = frame->duration;
+        sample.isKeyframe = frame->isKeyframe;
+
+        if (sample.timestamp >= 0 && MP4Muxer_WriteVideo(rec->muxer, &sample)) {
+            InterlockedIncrement(&rec->framesWritten);
+        }
+    }
+
+    LeaveCriticalSection(&rec->lock);
+}
+
+static void EncodedFrameCallback_Recorder(EncodedFrame* frame, void* userData) {
+    Recorder* rec = (Recorder*)userData;
+    if (frame) {
+        Backpressure_Completed(rec->backpressure, frame->timestamp, FrameHub_Now());
+    }
+    WriteVideoFrame(rec, frame);
+}
+
+// Encoded audio (called from AACEncoder_Feed/Flush on the recorder thread)
+static void AudioEncoderCallback(const AACSample* sample, void* userData) {
+    Recorder* rec = (Recorder*)userData;
+    if (!sample || !sample->data || sample->size <= 0) return;
+
+    EnterCriticalSection(&rec->lock);
+
+    // Audio before the first video keyframe has nothing to sync to
+    if (rec->muxer) {
+        MuxerAudioSample out;
+        out.data = sample->data;
+        out.size = (DWORD)sample->size;
+        out.timestamp = sample->timestamp - rec->videoBase;
+        out.duration = sample->duration;
+
+        if (out.timestamp >= 0) {
+            MP4Muxer_WriteAudio(rec->muxer, &out);
+        }
+    }
+
+    LeaveCriticalSection(&rec->lock);
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+Recorder* Recorder_Start(FrameHub* hub, CaptureState* capture, RECT region,
+                         const char* outputPath, int fps, const AppConfig* config) {
+    if (!hub || !capture || !outputPath || !config || fps <= 0) return NULL;
+
+    Recorder* rec = (Recorder*)calloc(1, sizeof(Recorder));
+    if (!rec) return NULL;
+
+    rec->hub = hub;
+    rec->capture = capture;
+    rec->config = *config;
+    rec->fps = fps;
+    strncpy(rec->outputPath, outputPath, MAX_PATH - 1);
+
+    // Attach to the frame hub (shares capture with the replay buffer)
+    HubConsumerConfig hubConfig = {0};
+    hubConfig.name = "recorder";
+    hubConfig.fps = fps;
+    hubConfig.queueDepth = FRAME_HUB_DEFAULT_DEPTH;
+    hubConfig.region.x = region.left;
+    hubConfig.region.y = region.top;
+    hubConfig.region.width = region.right - region.left;
+    hubConfig.region.height = region.bottom - region.top;
+    rec->consumer = FrameHub_AddConsumer(hub, &hubConfig);
+    if (!rec->consumer) {
+        RecLog("Recorder: Region %d,%d,%d,%d not available from the frame hub\n",
+               region.left, region.top, region.right, region.bottom);
+        free(rec);
+        return NULL;
+    }
+
+    HubRect crop = FrameHub_GetCrop(rec->consumer);
+    SetRect(&rec->crop, crop.x, crop.y, crop.x + crop.width, crop.y + crop.height);
+    rec->width = crop.width;
+    rec->height = crop.height;
+
+    // Ensure output directory exists
+    char dirPath[MAX_PATH];
+    strncpy(dirPath, outputPath, MAX_PATH - 1);
+    dirPath[MAX_PATH - 1] = '\0';
+    char* lastSlash = strrchr(dirPath, '\\');
+    if (lastSlash) {
+        *lastSlash = '\0';
+        CreateDirectoryA(dirPath, NULL);
+    }
+
+    InitializeCriticalSection(&rec->lock);
+    rec->hStopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    rec->hReadyEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    if (!rec->hStopEvent || !rec->hReadyEvent) goto fail;
+
+    RecLog("Recorder: Starting %dx%d @ %d fps -> %s\n", rec->width, rec->height, fps, outputPath);
+
+    rec->thread = CreateThread(NULL, 0, RecorderThreadProc, rec, 0, NULL);
+    if (!rec->thread) goto fail;
+
+    // Wait for the thread to bring up encoder/converters
+    HANDLE waitHandles[2] = { rec->hReadyEvent, rec->thread };
+    WaitForMultipleObjects(2, waitHandles, FALSE, 10000);
+
+    if (!rec->startOk) {
+        RecLog("Recorder: Failed to start pipeline\n");
+        SetEvent(rec->hStopEvent);
+        if (WaitForSingleObject(rec->thread, 5000) != WAIT_OBJECT_0) {
+            // Still bringing up the pipeline through 'rec'; leak it (see Recorder_Stop)
+            RecLog("Recorder: WARNING - thread did not exit, leaking recorder\n");
+            return NULL;
+        }
+        goto fail;
+    }
+
+    return rec;
+
+fail:
+    FrameHub_RemoveConsumer(rec->hub, rec->consumer);
+    if (rec->thread) CloseHandle(rec->thread);
+    if (rec->hStopEvent) CloseHandle(rec->hStopEvent);
+    if (rec->hReadyEvent) CloseHandle(rec->hReadyEvent);
+    DeleteCriticalSection(&rec->lock);
+    free(rec);
+    return NULL;
+}
+
+BOOL Recorder_Stop(Recorder* rec) {
+    if (!rec) return FALSE;
+
+    SetEvent(rec->hStopEvent);
+    if (WaitForSingleObject(rec->thread, 10000) != WAIT_OBJECT_0) {
+        // The thread may still write through 'rec' and the muxer, and hold a
+        // hub frame (removing the last consumer frees the pool): leak all of
+        // it, consumer included, rather than free it underneath the thread
+        RecLog("Recorder: WARNING - thread did not exit in time, leaking recorder (file not finalized)\n");
+        return FALSE;
+    }
+    CloseHandle(rec->thread);
+
+    HubConsumerStats hubStats = {0};
+    FrameHub_GetConsumerStats(rec->hub, rec->consumer, &hubStats);
+    FrameHub_RemoveConsumer(rec->hub, rec->consumer);
+
+    // Thread has flushed the encoder and audio; finalize the file
+    BOOL ok = FALSE;
+    EnterCriticalSection(&rec->lock);
+    if (rec->muxer) {
+        ok = MP4Muxer_Close(rec->muxer);
+        rec->muxer = NULL;
+    }
+    LeaveCriticalSection(&rec->lock);
+
+    RecLog("Recorder: Stopped (%d submitted, %ld written, %d dropped) %s\n",
+           rec->framesSubmitted, rec->framesWritten, rec->framesDropped + (int)hubStats.dropped,
+           ok ? "OK" : "FAILED");
+
+    CloseHandle(rec->hStopEvent);
+    CloseHandle(rec->hReadyEvent);
+    DeleteCriticalSection(&rec->lock);
+    free(rec);
+
+    return ok;
+}
+
+const char* Recorder_GetOutputPath(Recorder* rec) {
+    return rec ? rec->outputPath : NULL;
+}
+
+// ============================================================================
+// Recorder thread
+// ============================================================================
+
+static void StartAudio(Recorder* rec) {
+    const AppConfig* cfg = &rec->config;
+    if (!cfg->audioEnabled || !(cfg->audioSource1[0] || cfg->audioSource2[0] || cfg->audioSource3[0])) {
+        return;
+    }
+
+    rec->audioCapture = AudioCapture_Create(
+        cfg->audioSource1, cfg->audioVolume1,
+        cfg->audioSource2, cfg->audioVolume2,
+        cfg->audioSource3, cfg->audioVolume3
+    );
+    if (!rec->audioCapture) {
+        RecLog("Recorder: AudioCapture_Create failed, recording without audio\n");
+        return;
+    }
+
+    rec->aacEncoder = AACEncoder_Create();
+    if (!rec->aacEncoder) {
+        RecLog("Recorder: AACEncoder_Create failed, recording without audio\n");
+        AudioCapture_Destroy(rec->audioCapture);
+        rec->audioCapture = NULL;
+        return;
+    }
+    AACEncoder_SetCallback(rec->aacEncoder, AudioEncoderCallback, rec);
+    AACEncoder_GetConfig(rec->aacEncoder, &rec->aacConfigData, &rec->aacConfigSize);
+
+    if (!AudioCapture_Start(rec->audioCapture, &rec->clock)) {
+        RecLog("Recorder: AudioCapture_Start failed, recording without audio\n");
+        AACEncoder_Destroy(rec->aacEncoder);
+        rec->aacEncoder = NULL;
+        AudioCapture_Destroy(rec->audioCapture);
+        rec->audioCapture = NULL;
+        return;
+    }
+
+    RecLog("Recorder: Audio capture started\n");
+}
+
+static void StopAudio(Recorder* rec) {
+    if (rec->audioCapture) {
+        AudioCapture_Stop(rec->audioCapture);
+    }
+    if (rec->aacEncoder) {
+        AACEncoder_Flush(rec->aacEncoder);  // Remaining samples go to the muxer
+        EnterCriticalSection(&rec->lock);
+        AACEncoder_Destroy(rec->aacEncoder);
+        rec->aacEncoder = NULL;
+        rec->aacConfigData = NULL;
+        LeaveCriticalSection(&rec->lock);
+    }
+    if (rec->audioCapture) {
+        AudioCapture_Destroy(rec->audioCapture);
+        rec->audioCapture = NULL;
+    }
+}
+
+// Convert and submit one hub delivery (releases it)
+static void RecordFrame(Recorder* rec, CaptureState* capture, GPUConverter* gpuConverter,
+                        CPUConverter* cpuConverter, ID3D11Texture2D** readbackTexture,
+                        const HubDelivery* delivery) {
+    LONGLONG timestamp = MediaClock_FromSource(&rec->clock, delivery->tickTime);
+    ID3D11Texture2D* bgraTexture = (ID3D11Texture2D*)delivery->frame->payload;
+
+    // Encoder behind: skip the frame before spending a conversion on it.
+    // Timestamps are kept, so the previous frame holds over the gap.
+    if (Backpressure_Admit(rec->backpressure, timestamp, FrameHub_Now()) != DROP_NONE) {
+        FrameHub_Release(rec->hub, delivery->frame);
+        rec->framesDropped++;
+        return;
+    }
+
+    BOOL submitted = FALSE;
+    if (gpuConverter->initialized) {
+        ID3D11Texture2D* nv12Texture = GPUConverter_Convert(gpuConverter, bgraTexture);
+        if (nv12Texture) {
+            submitted = VideoEncoder_SubmitTexture(rec->encoder, nv12Texture, timestamp);
+        }
+    } else {
+        int bgraPitch = 0;
+        BYTE* bgra = Capture_MapFrameTexture(capture, bgraTexture, &rec->crop, readbackTexture, &bgraPitch);
+        BYTE* yPlane = bgra ? CPUConverter_Convert(cpuConverter, bgra, bgraPitch) : NULL;
+        if (bgra) Capture_UnmapFrameTexture(capture, *readbackTexture);
+        if (yPlane) {
+            submitted = VideoEncoder_SubmitNV12(rec->encoder, yPlane, cpuConverter->yPitch,
+                                                CPUConverter_GetUVPlane(cpuConverter),
+                                                cpuConverter->uvPitch, timestamp);
+        }
+    }
+
+    FrameHub_Release(rec->hub, delivery->frame);
+    Backpressure_SubmitResult(rec->backpressure, timestamp, FrameHub_Now(), submitted != FALSE);
+
+    if (submitted) {
+        rec->framesSubmitted++;
+    } else {
+        rec->framesDropped++;
+    }
+}
+
+static DWORD WINAPI RecorderThreadProc(LPVOID param) {
+    Recorder* rec = (Recorder*)param;
+    CaptureState* capture = rec->capture;
+
+    HRESULT hrCom = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+
+    // Encoder (same backend selection as the replay buffer)
+    rec->encoder = VideoEncoder_Create(rec->config.replayEncoder, capture->device,
+                                       rec->width, rec->height, rec->fps, rec->config.quality);
+    if (!rec->encoder) {
+        RecLog("Recorder: VideoEncoder_Create failed\n");
+        SetEvent(rec->hReadyEvent);
+        if (SUCCEEDED(hrCom)) CoUninitialize();
+        return 1;
+    }
+
+    GPUConverter gpuConverter = {0};
+    CPUConverter cpuConverter = {0};
+    BOOL converterOk = (rec->encoder->inputType == ENCODER_INPUT_D3D11_NV12)
+        ? GPUConverter_Init(&gpuConverter, capture->device, rec->width, rec->height)
+        : CPUConverter_Init(&cpuConverter, rec->width, rec->height);
+    if (!converterOk) {
+        RecLog("Recorder: Color converter init failed\n");
+        VideoEncoder_Destroy(rec->encoder);
+        rec->encoder = NULL;
+        SetEvent(rec->hReadyEvent);
+        if (SUCCEEDED(hrCom)) CoUninitialize();
+        return 1;
+    }
+    if (gpuConverter.initialized) {
+        GPUConverter_SetSourceRect(&gpuConverter, &rec->crop);
+    }
+
+    rec->backpressure = Backpressure_Create(rec->encoder->maxInFlight, MF_UNITS_PER_SECOND / rec->fps);
+    VideoEncoder_SetCallback(rec->encoder, EncodedFrameCallback_Recorder, rec);
+    VideoEncoder_SetQueueGauge(rec->encoder, FR_GAUGE_RECORD_ENCODER_QUEUE);
+    RecLog("Recorder: %s encoder ready\n", VideoEncoder_GetName(rec->encoder));
+
+    // One wake per frame on the hub's interval (1ms polling if no pacer)
+    LONGLONG frameDuration = MF_UNITS_PER_SECOND / rec->fps;
+    FramePacer* pacer = FramePacer_Create((int)MF_UNITS_PER_SECOND, (int)frameDuration);
+    BOOL pacerAligned = FALSE;
+
+    // Video ticks and audio reads share this clock's time zero
+    MediaClock_Init(&rec->clock, NULL, NULL);
+    LONGLONG hubStartTime = FrameHub_Now();
+    ID3D11Texture2D* readbackTexture = NULL;   // CPU path staging copy
+
+    StartAudio(rec);
+
+    rec->startOk = TRUE;
+    SetEvent(rec->hReadyEvent);
+    FlightRecorder_RegisterThread("Recorder");
+    ThreadRegistry_Register("Recorder", THREAD_ROLE_ENCODE);
+
+    HANDLE waitHandles[2] = { rec->hStopEvent, NULL };
+    for (;;) {
+        DWORD waitResult;
+        FlightRecorder_SetStage("wait", FR_NO_DEADLINE);
+        if (pacer) {
+            waitHandles[1] = FramePacer_Arm(pacer);
+            waitResult = WaitForMultipleObjects(2, waitHandles, FALSE, INFINITE);
+        } else {
+            waitResult = WaitForSingleObject(rec->hStopEvent, 1);
+        }
+        if (waitResult == WAIT_OBJECT_0) break;
+        if (pacer && waitResult == WAIT_OBJECT_0 + 1) FramePacer_Complete(pacer, NULL);
+        FlightRecorder_SetStage("capture", FR_STAGE_DEADLINE_MS);
+
+        // Feed audio (everything mixed since the last wake)
+        if (rec->aacEncoder) {
+            BYTE audioPcmBuf[8192];
+            LONGLONG audioTs = 0;
+            int audioBytes;
+            while ((audioBytes = AudioCapture_Read(rec->audioCapture, audioPcmBuf, sizeof(audioPcmBuf), &audioTs)) > 0) {
+                AACEncoder_Feed(rec->aacEncoder, audioPcmBuf, audioBytes, audioTs);
+                if (audioBytes < (int)sizeof(audioPcmBuf)) break;
+            }
+        }
+
+        // The hub paces deliveries at our frame rate; take everything queued
+        HubDelivery delivery;
+        while (FrameHub_Acquire(rec->hub, rec->consumer, 0, &delivery)) {
+            // Frames queued while the encoder was starting up are stale
+            if (delivery.tickTime < hubStartTime) {
+                FrameHub_Release(rec->hub, delivery.frame);
+                continue;
+            }
+
+            // Wake half a frame after the hub ticks
+            if (pacer && !pacerAligned) {
+                FramePacer_Reset(pacer, delivery.tickTime + frameDuration + frameDuration / 2);
+                pacerAligned = TRUE;
+            }
+
+            RecordFrame(rec, capture, &gpuConverter, &cpuConverter, &readbackTexture, &delivery);
+        }
+    }
+
+    if (pacer) {
+        FramePacerStats pacerStats;
+        char pacerLine[256];
+        FramePacer_GetStats(pacer, &pacerStats);
+        FramePacer_FormatStats(&pacerStats, pacerLine, sizeof(pacerLine));
+        RecLog("Recorder: pacing %s\n", pacerLine);
+        FramePacer_Destroy(pacer);
+    }
+
+    if (rec->backpressure) {
+        BackpressureStats bpStats;
+        char bpLine[256];
+        Backpressure_GetStats(rec->backpressure, &bpStats);
+        Backpressure_FormatStats(&bpStats, bpLine, sizeof(bpLine));
+        RecLog("Recorder: encoder %s\n", bpLine);
+    }
+
+    if (readbackTexture) {
+        readbackTexture->lpVtbl->Release(readbackTexture);
+    }
+
+    // Drain the encoder into the file
+    EncodedFrame flushed = {0};
+    while (VideoEncoder_Flush(rec->encoder, &flushed)) {
+        WriteVideoFrame(rec, &flushed);
+        if (flushed.data) MemTracker_Free(flushed.data);
+        memset(&flushed, 0, sizeof(flushed));
+    }
+    VideoEncoder_Destroy(rec->encoder);
+    rec->encoder = NULL;
+    Backpressure_Destroy(rec->backpressure);
+    rec->backpressure = NULL;
+
+    StopAudio(rec);
+
+    GPUConverter_Shutdown(&gpuConverter);
+    CPUConverter_Shutdown(&cpuConverter);
+
+    FlightRecorder_ReleaseThread();
+    ThreadRegistry_Unregister();
+    if (SUCCEEDED(hrCom)) CoUninitialize();
+    return 0;
+}
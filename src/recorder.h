@@ -0,0 +1,36 @@
+/*
+ * Recorder - Classic start/stop recording to file
+ *
+ * Same pipeline as the replay buffer, but streamed straight to disk:
+ * Frame hub (DXGI) → GPU/CPU color convert → VideoEncoder → MP4Muxer (incremental)
+ * Audio (if enabled) is AAC-encoded and interleaved into the same file.
+ */
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <windows.h>
+#include "capture.h"
+#include "config.h"
+
+typedef struct Recorder Recorder;
+
+// Start recording a screen region, taking frames from the shared frame hub.
+// If the hub is already capturing (replay buffer), region must lie inside
+// its capture area. Blocks until the pipeline is running; returns NULL if it
+// failed to start.
+Recorder* Recorder_Start(FrameHub* hub, CaptureState* capture, RECT region,
+                         const char* outputPath, int fps, const AppConfig* config);
+
+// Stop recording, flush the encoder and finalize the file.
+// Returns TRUE if a playable file was written. Frees the recorder (leaks it
+// if the thread is stuck and did not exit).
+BOOL Recorder_Stop(Recorder* rec);
+
+// Output file path
+const char* Recorder_GetOutputPath(Recorder* rec);
+
+// Generate output filename with timestamp (always .mp4)
+void Recorder_GenerateFilename(char* buffer, size_t size, const char* basePath);
+
+#endif // RECORDER_H
@@ -1,14 +1,16 @@
 /*
  * Replay Buffer - ShadowPlay-style instant replay
  * 
- * Uses RAM-based circular buffer of encoded HEVC samples.
+ * Uses RAM-based circular buffer of encoded HEVC/H.264 samples.
  * On save: muxes buffered samples to MP4 (no re-encoding).
- * Full GPU pipeline: DXGI capture → GPU color convert → NVENC (native API)
+ * GPU pipeline: frame hub (DXGI) → GPU color convert → NVENC (native API)
+ * CPU pipeline: frame hub (DXGI) → readback → CPU color convert → software MFT
  */
 
 #include "replay_buffer.h"
-#include "nvenc_encoder.h"
+#include "video_encoder.h"
 #include "sample_buffer.h"
+#include "audio_store.h"
 #include "capture.h"
 #include "config.h"
 #include "util.h"
@@ -17,34 +19,64 @@
 #include "aac_encoder.h"
 #include "mp4_muxer.h"
 #include "gpu_converter.h"
+#include "cpu_converter.h"
+#include "frame_pacer.h"
+#include "backpressure.h"
+#include "media_clock.h"
+#include "quality_controller.h"
+#include "pipeline_latency.h"
+#include "trace.h"
+#include "flight_recorder.h"
+#include "thread_registry.h"
+#include "mem_tracker.h"
+#include "ram_estimator.h"
+#include "metrics.h"
+#include "crash_handler.h"
 #include <stdio.h>
-#include <mmsystem.h>  // For timeBeginPeriod/timeEndPeriod
 #include <objbase.h>   // For CoInitializeEx/CoUninitialize
 
-#pragma comment(lib, "winmm.lib")
 #pragma comment(lib, "ole32.lib")
 
+// Longest a save may take (muxing large buffers); also its stall deadline
+#define SAVE_TIMEOUT_MS 30000
+#define SAVE_WAIT_SLICE_MS 1000     // Caller's heartbeat cadence while it waits
+
+// Learned data rates per capture profile, kept next to the executable
+#define RAM_PROFILE_FILE "lwsr_ram_profiles.txt"
+
 // Global state
-static NVENCEncoder* g_encoder = NULL;
+static VideoEncoder* g_encoder = NULL;
+static Backpressure* g_backpressure = NULL;     // Admission control in front of g_encoder
+static QualityController* g_quality = NULL;     // QP/GOP steering for the memory budget (NULL = off)
+static PipelineLatency* g_latency = NULL;       // Per-stage histograms (lives from Init to Shutdown)
+static RamEstimator* g_ramEstimator = NULL;     // Learned data rates (lives from Init to Shutdown)
+
+// Save outcomes since the app started (buffer thread only)
+// Latest thread sample, taken by PublishMetrics. It is the only
+// ThreadRegistry_Sample caller: every call re-bases the registry's rates,
+// so a second sampler would leave both with partial intervals.
+static ThreadStats g_threadSample[THREAD_REGISTRY_MAX];
+static int g_threadSampleCount = 0;
+static LONGLONG g_threadSampleTime = 0;
+
+static int g_savesTotal = 0;
+static int g_saveFailures = 0;
+static double g_lastSaveSeconds = 0;
 static SampleBuffer g_sampleBuffer = {0};
 
-// HEVC sequence header (VPS/SPS/PPS) for muxing
+// Codec sequence header (VPS/SPS/PPS or SPS/PPS) for muxing
 static BYTE g_seqHeader[256];
 static DWORD g_seqHeaderSize = 0;
 
 // Audio state
 static AudioCaptureContext* g_audioCapture = NULL;
 static AACEncoder* g_aacEncoder = NULL;
-static MuxerAudioSample* g_audioSamples = NULL;
-static int g_audioSampleCount = 0;
-static int g_audioSampleCapacity = 0;
-static CRITICAL_SECTION g_audioLock;
-static BOOL g_audioLockInitialized = FALSE;  // Track CS initialization
+static AudioStore g_audioStore = {0};  // Encoded AAC frames (lives from Init to Shutdown)
 static BYTE* g_aacConfigData = NULL;
 static int g_aacConfigSize = 0;
-static LONGLONG g_audioMaxDuration = 0;  // Max duration in 100-ns units for eviction
 
 extern CaptureState g_capture;
+extern FrameHub* g_frameHub;
 extern AppConfig g_config;
 
 static DWORD WINAPI BufferThreadProc(LPVOID param);
@@ -52,106 +84,197 @@ static DWORD WINAPI BufferThreadProc(LPVOID param);
 // Alias for logging
 #define ReplayLog Logger_Log
 
+// Log encoder backpressure and the most recent timeline gaps
+static void LogBackpressure(const char* label) {
+    if (!g_backpressure) return;
+    
+    BackpressureStats stats;
+    char line[256];
+    Backpressure_GetStats(g_backpressure, &stats);
+    Backpressure_FormatStats(&stats, line, sizeof(line));
+    ReplayLog("%s%s\n", label, line);
+    
+    TimelineGap gaps[4];
+    int gapCount = Backpressure_GetGaps(g_backpressure, gaps, 4);
+    for (int i = 0; i < gapCount; i++) {
+        ReplayLog("    gap %.3fs-%.3fs (%d frames, %s)\n",
+                  (double)gaps[i].start / MF_UNITS_PER_SECOND, (double)gaps[i].end / MF_UNITS_PER_SECOND,
+                  gaps[i].frames, Backpressure_ReasonName(gaps[i].reason));
+    }
+}
+
 // Callback for draining completed encoded frames into sample buffer
-// Called from NVENC output thread - must be thread-safe
+// Called from the encoder's output thread - must be thread-safe
 static void DrainCallback(EncodedFrame* frame, void* userData) {
     SampleBuffer* buffer = (SampleBuffer*)userData;
-    if (frame && frame->data && buffer) {
+    if (!frame) return;
+    
+    LONGLONG outputTime = FrameHub_Now();
+    LONGLONG timestamp = frame->timestamp;
+    TRACE_BEGIN(TRACE_OUTPUT, timestamp);
+    FlightRecorder_Event(FR_EVENT_DRAIN, timestamp, frame->size);
+    Backpressure_Completed(g_backpressure, timestamp, outputTime);
+    QualityController_Record(g_quality, timestamp, frame->size);
+    RamEstimator_Record(g_ramEstimator, timestamp, frame->size);
+    
+    if (frame->data && buffer) {
         SampleBuffer_Add(buffer, frame);
     }
+    
+    // Submit → output → stored, and end to end from the hub's grab
+    LONGLONG storedTime = FrameHub_Now();
+    LatencyTag tag;
+    PipelineLatency_Record(g_latency, LATENCY_DRAIN, storedTime - outputTime);
+    if (PipelineLatency_TakeTag(g_latency, timestamp, &tag)) {
+        PipelineLatency_Record(g_latency, LATENCY_ENCODE, outputTime - tag.submitTime);
+        PipelineLatency_Record(g_latency, LATENCY_CAPTURE_TO_BUFFER, storedTime - tag.grabTime);
+    }
+    TRACE_END(TRACE_OUTPUT, timestamp);
 }
 
-// Audio callback - stores encoded AAC samples
-static void AudioEncoderCallback(const AACSample* sample, void* userData) {
-    (void)userData;  // Unused - samples go to global buffer
-    if (!sample || !sample->data || sample->size <= 0) return;
-    
-    EnterCriticalSection(&g_audioLock);
-    
-    // Time-based eviction: remove samples older than max duration
-    // This matches video buffer eviction behavior
-    if (g_audioSampleCount > 0 && g_audioMaxDuration > 0) {
-        int evicted = 0;
-        while (g_audioSampleCount > 0) {
-            LONGLONG oldest = g_audioSamples[0].timestamp;
-            LONGLONG span = sample->timestamp - oldest;
-            
-            if (span <= g_audioMaxDuration) {
-                break;  // Within duration limit
-            }
-            
-            // Evict oldest sample
-            if (g_audioSamples[0].data) {
-                free(g_audioSamples[0].data);
-            }
-            memmove(g_audioSamples, g_audioSamples + 1, 
-                    (g_audioSampleCount - 1) * sizeof(MuxerAudioSample));
-            g_audioSampleCount--;
-            evicted++;
+static void GetRamProfilePath(char* buffer, size_t size) {
+    GetModuleFileNameA(NULL, buffer, (DWORD)size);
+    char* lastSlash = strrchr(buffer, '\\');
+    if (lastSlash) {
+        strcpy(lastSlash + 1, RAM_PROFILE_FILE);
+    }
+}
+
+static int AvailableMemoryMB(void) {
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+    if (!GlobalMemoryStatusEx(&status)) return 0;
+    return (int)(status.ullAvailPhys / (1024 * 1024));
+}
+
+// Fill in the rest of the metrics snapshot and publish it. The caller sets
+// 'buffering' and this run's frame and drop counters.
+static void PublishMetrics(MetricsSnapshot* m) {
+    if (m->buffering) {
+        m->bufferSeconds = SampleBuffer_GetDuration(&g_sampleBuffer);
+        m->bufferBytes = (int64_t)SampleBuffer_GetMemoryUsage(&g_sampleBuffer);
+        m->bufferFrames = SampleBuffer_GetCount(&g_sampleBuffer);
+        m->targetSeconds = g_config.replayDuration;
+        
+        BackpressureStats bp;
+        Backpressure_GetStats(g_backpressure, &bp);
+        m->framesEncoded = bp.completed;
+        m->encoderInFlight = bp.inFlight;
+        memcpy(m->dropped, bp.dropped, sizeof(m->dropped));
+        
+        for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+            PipelineLatency_GetSummary(g_latency, (LatencyStage)i, &m->latency[i]);
         }
         
-        // Log eviction periodically (counter reset each callback to avoid stale state)
-        static int audioEvictLogCounter = 0;
-        audioEvictLogCounter++;
-        if (evicted > 0 && (audioEvictLogCounter % 500) == 0) {
-            double spanSec = 0;
-            if (g_audioSampleCount > 0) {
-                spanSec = (sample->timestamp - g_audioSamples[0].timestamp) / 10000000.0;
-            }
-            ReplayLog("Audio eviction: removed %d samples, count=%d, span=%.2fs\n",
-                      evicted, g_audioSampleCount, spanSec);
+        if (g_audioCapture) {
+            AudioCaptureHealth health;
+            AudioCapture_GetHealth(g_audioCapture, &health);
+            m->audioActive = TRUE;
+            m->audioDiscontinuities = health.discontinuities;
+            m->audioOverflowBytes = health.overflowBytes;
         }
+        m->audioSamples = AudioStore_GetCount(&g_audioStore);
+        m->audioSeconds = AudioStore_GetDuration(&g_audioStore);
     }
     
-    // Grow array if needed (capacity-based)
-    if (g_audioSampleCount >= g_audioSampleCapacity) {
-        int newCapacity = g_audioSampleCapacity == 0 ? 1024 : g_audioSampleCapacity * 2;
-        if (newCapacity > MAX_AUDIO_SAMPLES) newCapacity = MAX_AUDIO_SAMPLES;
-        
-        if (g_audioSampleCount >= newCapacity) {
-            // Still full after time eviction - emergency capacity eviction
-            int toKeep = newCapacity * 3 / 4;
-            int toRemove = g_audioSampleCount - toKeep;
-            
-            for (int i = 0; i < toRemove && i < g_audioSampleCount; i++) {
-                if (g_audioSamples[i].data) {
-                    free(g_audioSamples[i].data);
-                }
-            }
-            
-            memmove(g_audioSamples, g_audioSamples + toRemove, 
-                    toKeep * sizeof(MuxerAudioSample));
-            g_audioSampleCount = toKeep;
-        } else {
-            MuxerAudioSample* newArr = realloc(g_audioSamples, 
-                                                newCapacity * sizeof(MuxerAudioSample));
-            if (newArr) {
-                g_audioSamples = newArr;
-                g_audioSampleCapacity = newCapacity;
-            } else {
-                // realloc failed - log and drop sample
-                static int reallocFailCount = 0;
-                if (++reallocFailCount <= 5) {
-                    ReplayLog("WARNING: Audio buffer realloc failed (count=%d, capacity=%d)\n", 
-                              g_audioSampleCount, newCapacity);
-                }
+    m->saves = (uint64_t)g_savesTotal;
+    m->saveFailures = (uint64_t)g_saveFailures;
+    m->lastSaveSeconds = g_lastSaveSeconds;
+    for (int i = 0; i < MEM_TAG_COUNT; i++) {
+        MemTracker_GetStats((MemTag)i, &m->memory[i]);
+    }
+    MemTracker_GetTotal(&m->memoryTotal);
+    m->threadCount = ThreadRegistry_Sample(m->threads, THREAD_REGISTRY_MAX);
+    ThreadRegistry_GetRoleCpu(m->roleCpu);
+    memcpy(g_threadSample, m->threads, m->threadCount * sizeof(ThreadStats));
+    g_threadSampleCount = m->threadCount;
+    g_threadSampleTime = FrameHub_Now();
+    
+    Metrics_Publish(m);
+}
+
+// Log per-thread CPU since the previous call, worked out from the cumulative
+// counters of the latest metrics sample (a thread new since then is
+// reported at the sample's own rates)
+static void LogThreads(const char* label) {
+    static ThreadStats previous[THREAD_REGISTRY_MAX];
+    static int previousCount = 0;
+    static LONGLONG previousTime = 0;
+    if (g_threadSampleCount == 0) return;
+    
+    ThreadStats threads[THREAD_REGISTRY_MAX];
+    int count = g_threadSampleCount;
+    memcpy(threads, g_threadSample, count * sizeof(ThreadStats));
+    double seconds = (double)(g_threadSampleTime - previousTime) / MF_UNITS_PER_SECOND;
+    if (previousCount > 0 && seconds > 0) {
+        for (int i = 0; i < count; i++) {
+            for (int j = 0; j < previousCount; j++) {
+                if (previous[j].threadId != threads[i].threadId) continue;
+                double cpu = (double)(threads[i].cpuTime - previous[j].cpuTime) / MF_UNITS_PER_SECOND;
+                threads[i].cpuPercent = 100.0 * cpu / seconds;
+                threads[i].switchesPerSecond =
+                    (double)(threads[i].contextSwitches - previous[j].contextSwitches) / seconds;
+                break;
             }
         }
     }
+    memcpy(previous, g_threadSample, count * sizeof(ThreadStats));
+    previousCount = count;
+    previousTime = g_threadSampleTime;
     
-    if (g_audioSampleCount < g_audioSampleCapacity) {
-        MuxerAudioSample* dst = &g_audioSamples[g_audioSampleCount];
-        dst->data = (BYTE*)malloc(sample->size);
-        if (dst->data) {
-            memcpy(dst->data, sample->data, sample->size);
-            dst->size = sample->size;
-            dst->timestamp = sample->timestamp;
-            dst->duration = sample->duration;
-            g_audioSampleCount++;
-        }
+    char line[512];
+    ThreadRegistry_Format(threads, count, line, sizeof(line));
+    ReplayLog("%s%s\n", label, line);
+}
+
+// Log p50/p99/p99.9 of every stage that has samples
+static void LogLatency(const char* label) {
+    for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+        LatencySummary summary;
+        PipelineLatency_GetSummary(g_latency, (LatencyStage)i, &summary);
+        if (summary.count == 0) continue;
+        
+        char line[160];
+        PipelineLatency_FormatSummary((LatencyStage)i, &summary, line, sizeof(line));
+        ReplayLog("%s%s\n", label, line);
+    }
+}
+
+// Chrome trace of the last few seconds next to a saved clip ("clip.mp4" → "clip.trace.json")
+static void WriteTrace(const char* clipPath) {
+    char tracePath[MAX_PATH];
+    strncpy(tracePath, clipPath, MAX_PATH - 1);
+    tracePath[MAX_PATH - 1] = '\0';
+    char* ext = strrchr(tracePath, '.');
+    char* sep = strrchr(tracePath, '\\');
+    if (ext && (!sep || ext > sep)) *ext = '\0';
+    if (strlen(tracePath) + sizeof(".trace.json") > MAX_PATH) return;
+    strcat(tracePath, ".trace.json");
+    
+    LONGLONG start = FrameHub_Now();
+    BOOL ok = Trace_ExportChrome(tracePath);
+    ReplayLog("  Trace %s: %s (%.0fms)\n", ok ? "written" : "FAILED", tracePath,
+              (FrameHub_Now() - start) / 10000.0);
+}
+
+// Count a tick that is now covered by the buffer toward the save threshold.
+// Coalesced VFR ticks count too: they extend buffered time without adding a sample.
+static void CountBufferedTick(ReplayBufferState* state) {
+    LONG newCount = InterlockedIncrement(&state->framesCaptured);
+    
+    // Signal ready event once we have enough frames
+    if (newCount == MIN_FRAMES_FOR_SAVE) {
+        SetEvent(state->hReadyEvent);
+        ReplayLog("Minimum frames captured (%d), ready for saves\n", MIN_FRAMES_FOR_SAVE);
     }
+}
+
+// Audio callback - stores encoded AAC samples
+static void AudioEncoderCallback(const AACSample* sample, void* userData) {
+    (void)userData;  // Unused - samples go to global buffer
+    if (!sample || !sample->data || sample->size <= 0) return;
     
-    LeaveCriticalSection(&g_audioLock);
+    AudioStore_Add(&g_audioStore, sample->data, (DWORD)sample->size, sample->timestamp, sample->duration);
 }
 
 // ============================================================================
@@ -179,14 +302,25 @@ BOOL ReplayBuffer_Init(ReplayBufferState* state) {
     }
     
     state->state = REPLAY_STATE_UNINITIALIZED;
-    InitializeCriticalSection(&g_audioLock);
-    g_audioLockInitialized = TRUE;
+    AudioStore_Init(&g_audioStore);
+    g_latency = PipelineLatency_Create();
+    
+    g_ramEstimator = RamEstimator_Create();
+    char profilePath[MAX_PATH];
+    GetRamProfilePath(profilePath, sizeof(profilePath));
+    if (RamEstimator_Load(g_ramEstimator, profilePath)) {
+        ReplayLog("Loaded RAM profiles from %s\n", profilePath);
+    }
     return TRUE;
 }
 
 void ReplayBuffer_Shutdown(ReplayBufferState* state) {
     if (!state) return;
-    ReplayBuffer_Stop(state);
+    if (!ReplayBuffer_Stop(state)) {
+        // The thread still waits on these events and uses the audio store
+        ReplayLog("Shutdown: buffer thread still running, leaking its state\n");
+        return;
+    }
     
     // Close event handles
     if (state->hReadyEvent) CloseHandle(state->hReadyEvent);
@@ -198,24 +332,12 @@ void ReplayBuffer_Shutdown(ReplayBufferState* state) {
     state->hSaveCompleteEvent = NULL;
     state->hStopEvent = NULL;
     
-    // Clean up audio samples - must be done BEFORE deleting critical section
-    if (g_audioLockInitialized) {
-        EnterCriticalSection(&g_audioLock);
-        if (g_audioSamples) {
-            for (int i = 0; i < g_audioSampleCount; i++) {
-                if (g_audioSamples[i].data) free(g_audioSamples[i].data);
-            }
-            free(g_audioSamples);
-            g_audioSamples = NULL;
-        }
-        g_audioSampleCount = 0;
-        g_audioSampleCapacity = 0;
-        g_audioMaxDuration = 0;
-        LeaveCriticalSection(&g_audioLock);
-        
-        DeleteCriticalSection(&g_audioLock);
-        g_audioLockInitialized = FALSE;
-    }
+    AudioStore_Shutdown(&g_audioStore);
+    
+    PipelineLatency_Destroy(g_latency);
+    g_latency = NULL;
+    RamEstimator_Destroy(g_ramEstimator);
+    g_ramEstimator = NULL;
     
     // Logger cleanup is handled by Logger_Shutdown in main.c
 }
@@ -223,6 +345,10 @@ void ReplayBuffer_Shutdown(ReplayBufferState* state) {
 BOOL ReplayBuffer_Start(ReplayBufferState* state, const AppConfig* config) {
     if (!state || !config) return FALSE;
     if (state->isBuffering) return TRUE;
+    if (!ReplayBuffer_HasExited(state)) {
+        ReplayLog("Start refused: previous buffer thread has not exited\n");
+        return FALSE;
+    }
     
     state->enabled = config->replayEnabled;
     state->durationSeconds = config->replayDuration;
@@ -245,6 +371,7 @@ BOOL ReplayBuffer_Start(ReplayBufferState* state, const AppConfig* config) {
     InterlockedExchange(&state->framesCaptured, 0);
     state->saveSuccess = FALSE;
     state->savePath[0] = '\0';
+    state->saveSeconds = 0;
     
     // Reset events
     ResetEvent(state->hReadyEvent);
@@ -254,17 +381,8 @@ BOOL ReplayBuffer_Start(ReplayBufferState* state, const AppConfig* config) {
     // Legacy flags
     state->bufferReady = FALSE;
     
-    // Reset audio buffer
-    EnterCriticalSection(&g_audioLock);
-    for (int i = 0; i < g_audioSampleCount; i++) {
-        if (g_audioSamples[i].data) {
-            free(g_audioSamples[i].data);
-            g_audioSamples[i].data = NULL;
-        }
-    }
-    g_audioSampleCount = 0;
-    g_audioMaxDuration = 0;  // Reset max duration for next run
-    LeaveCriticalSection(&g_audioLock);
+    // Reset audio buffer (and its max duration, set again by the next run)
+    AudioStore_Clear(&g_audioStore);
     
     state->bufferThread = CreateThread(NULL, 0, BufferThreadProc, state, 0, NULL);
     state->isBuffering = (state->bufferThread != NULL);
@@ -284,22 +402,37 @@ BOOL ReplayBuffer_Start(ReplayBufferState* state, const AppConfig* config) {
     return state->isBuffering;
 }
 
-void ReplayBuffer_Stop(ReplayBufferState* state) {
-    if (!state || !state->isBuffering) return;
+BOOL ReplayBuffer_Stop(ReplayBufferState* state) {
+    if (!state) return TRUE;
+    if (!state->isBuffering) return ReplayBuffer_HasExited(state);
     
     // Signal stop via event (proper cross-thread communication)
     InterlockedExchange(&state->state, REPLAY_STATE_STOPPING);
     SetEvent(state->hStopEvent);
+    state->isBuffering = FALSE;
     
-    if (state->bufferThread) {
-        WaitForSingleObject(state->bufferThread, 10000);
-        CloseHandle(state->bufferThread);
-        state->bufferThread = NULL;
+    if (state->bufferThread && WaitForSingleObject(state->bufferThread, 10000) != WAIT_OBJECT_0) {
+        // Still running on the module globals: keep the handle so Start
+        // refuses to launch a second thread over them
+        ReplayLog("Buffer thread still running after 10s\n");
+        return FALSE;
     }
-    state->isBuffering = FALSE;
+    return ReplayBuffer_HasExited(state);
+}
+
+BOOL ReplayBuffer_HasExited(ReplayBufferState* state) {
+    if (!state || !state->bufferThread) return TRUE;
+    if (WaitForSingleObject(state->bufferThread, 0) != WAIT_OBJECT_0) return FALSE;
+    CloseHandle(state->bufferThread);
+    state->bufferThread = NULL;
+    return TRUE;
 }
 
 BOOL ReplayBuffer_Save(ReplayBufferState* state, const char* outputPath) {
+    return ReplayBuffer_SaveClip(state, outputPath, 0);
+}
+
+BOOL ReplayBuffer_SaveClip(ReplayBufferState* state, const char* outputPath, int seconds) {
     if (!state || !outputPath || !state->isBuffering) {
         ReplayLog("Save rejected: state=%p, path=%s, buffering=%d\n", 
                   state, outputPath ? outputPath : "NULL", state ? state->isBuffering : 0);
@@ -324,51 +457,95 @@ BOOL ReplayBuffer_Save(ReplayBufferState* state, const char* outputPath) {
     // Set up save parameters
     strncpy(state->savePath, outputPath, MAX_PATH - 1);
     state->savePath[MAX_PATH - 1] = '\0';
+    state->saveSeconds = seconds > 0 ? seconds : 0;
     state->saveSuccess = FALSE;
     
     // Signal save request via event (proper synchronization)
     ResetEvent(state->hSaveCompleteEvent);
     SetEvent(state->hSaveRequestEvent);
     
-    // Wait for completion (max 30 sec for muxing large buffers)
-    DWORD waitResult = WaitForSingleObject(state->hSaveCompleteEvent, 30000);
+    // Wait for completion (muxing large buffers takes a while). The caller
+    // - the headless job loop or the UI thread - is waiting, not hung, and
+    // a save may run as long as the watchdog's hang timeout, so it keeps
+    // the watchdog fed. A stuck save still shows up as a stall of the
+    // buffer thread's "save" stage.
+    DWORD waitResult = WAIT_TIMEOUT;
+    for (DWORD waited = 0; waited < SAVE_TIMEOUT_MS; waited += SAVE_WAIT_SLICE_MS) {
+        waitResult = WaitForSingleObject(state->hSaveCompleteEvent, SAVE_WAIT_SLICE_MS);
+        if (waitResult != WAIT_TIMEOUT) break;
+        CrashHandler_Heartbeat();
+    }
     
     if (waitResult != WAIT_OBJECT_0) {
-        ReplayLog("Save timeout after 30 seconds\n");
+        ReplayLog("Save timeout after %d seconds\n", SAVE_TIMEOUT_MS / 1000);
         return FALSE;
     }
     
     return state->saveSuccess;
 }
 
+BOOL ReplayBuffer_GetLatency(ReplayBufferState* state, LatencyStage stage, LatencySummary* summary) {
+    if (!state || !summary || !g_latency) return FALSE;
+    PipelineLatency_GetSummary(g_latency, stage, summary);
+    return summary->count > 0;
+}
+
 void ReplayBuffer_GetStatus(ReplayBufferState* state, char* buffer, int bufferSize) {
     if (!state || !buffer || bufferSize < 1) return;
     
     if (state->isBuffering) {
         double duration = SampleBuffer_GetDuration(&g_sampleBuffer);
         size_t memMB = SampleBuffer_GetMemoryUsage(&g_sampleBuffer) / (1024 * 1024);
-        snprintf(buffer, bufferSize, "Replay: %.0fs (%zuMB)", duration, memMB);
+        MemTagStats total;
+        MemTracker_GetTotal(&total);
+        snprintf(buffer, bufferSize, "Replay: %.0fs (%zuMB, %lldMB total)", duration, memMB,
+                 (long long)(total.current / (1024 * 1024)));
     } else {
         strcpy(buffer, "Replay: OFF");
     }
 }
 
-int ReplayBuffer_EstimateRAMUsage(int durationSec, int w, int h, int fps) {
-    // Estimate based on bitrate
-    // At 90 Mbps, 60 sec = 90 * 60 / 8 = 675 MB
-    float baseMbps = 75.0f;  // Medium quality default
-    float megapixels = (float)(w * h) / 1000000.0f;
-    float resScale = megapixels / 3.7f;
-    if (resScale < 0.5f) resScale = 0.5f;
-    if (resScale > 2.5f) resScale = 2.5f;
-    float fpsScale = (float)fps / 60.0f;
-    if (fpsScale < 0.5f) fpsScale = 0.5f;
-    if (fpsScale > 2.0f) fpsScale = 2.0f;
-    
-    float mbps = baseMbps * resScale * fpsScale;
-    float totalMB = (mbps * durationSec) / 8.0f;
-    
-    return (int)totalMB;
+int ReplayBuffer_EstimateRAMUsage(int durationSec, int w, int h, int fps,
+                                  QualityPreset quality, ReplayRAMEstimate* estimate) {
+    ReplayRAMEstimate result = {0};
+    result.availableMB = AvailableMemoryMB();
+    
+    RamProfileKey key = { w, h, fps, (int)quality };
+    RamEstimate learned;
+    if (RamEstimator_Predict(g_ramEstimator, &key, durationSec, &learned)) {
+        result.expectedMB = (int)(learned.expectedBytes / (1024 * 1024));
+        result.lowMB = (int)(learned.lowBytes / (1024 * 1024));
+        result.highMB = (int)(learned.highBytes / (1024 * 1024));
+        result.learned = TRUE;
+        result.tentative = learned.tentative;
+    } else {
+        // Nothing learned yet: estimate based on bitrate
+        // At 90 Mbps, 60 sec = 90 * 60 / 8 = 675 MB
+        float baseMbps = 75.0f;  // Medium quality default
+        float megapixels = (float)(w * h) / 1000000.0f;
+        float resScale = megapixels / 3.7f;
+        if (resScale < 0.5f) resScale = 0.5f;
+        if (resScale > 2.5f) resScale = 2.5f;
+        float fpsScale = (float)fps / 60.0f;
+        if (fpsScale < 0.5f) fpsScale = 0.5f;
+        if (fpsScale > 2.0f) fpsScale = 2.0f;
+        
+        float mbps = baseMbps * resScale * fpsScale;
+        result.expectedMB = (int)((mbps * durationSec) / 8.0f);
+        result.lowMB = result.expectedMB;
+        result.highMB = result.expectedMB;
+    }
+    
+    // The quality controller holds the buffer to the budget
+    int budgetMB = g_config.replayMemoryMB;
+    if (budgetMB > 0) {
+        if (result.expectedMB > budgetMB) result.expectedMB = budgetMB;
+        if (result.lowMB > budgetMB) result.lowMB = budgetMB;
+        if (result.highMB > budgetMB) result.highMB = budgetMB;
+    }
+    
+    if (estimate) *estimate = result;
+    return result.expectedMB;
 }
 
 // ============================================================================
@@ -381,13 +558,12 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
     
     // Reset static globals at start of each run to prevent stale state
     g_encoder = NULL;
+    g_backpressure = NULL;
+    g_quality = NULL;
     ZeroMemory(&g_sampleBuffer, sizeof(g_sampleBuffer));
     g_seqHeaderSize = 0;
     g_audioCapture = NULL;
     g_aacEncoder = NULL;
-    g_audioSamples = NULL;
-    g_audioSampleCount = 0;
-    g_audioSampleCapacity = 0;
     g_aacConfigData = NULL;
     g_aacConfigSize = 0;
     
@@ -398,19 +574,17 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
     ReplayLog("Config: replayFPS=%d, replayAspectRatio=%d, quality=%d\n",
               g_config.replayFPS, g_config.replayAspectRatio, g_config.quality);
     
-    // Setup capture
+    // Setup capture (frames come from the shared frame hub)
     CaptureState* capture = &g_capture;
     RECT rect = {0};
     
     if (state->captureSource == MODE_ALL_MONITORS) {
         Capture_GetAllMonitorsBounds(&rect);
-        Capture_SetAllMonitors(capture);
     } else {
         if (!Capture_GetMonitorBoundsByIndex(state->monitorIndex, &rect)) {
             POINT pt = {0, 0};
             Capture_GetMonitorFromPoint(pt, &rect, NULL);
         }
-        Capture_SetMonitor(capture, state->monitorIndex);
     }
     
     int width = rect.right - rect.left;
@@ -441,63 +615,149 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
         return 1;
     }
     
-    // Update capture to use cropped region
-    if (!Capture_SetRegion(capture, rect)) {
-        ReplayLog("Capture_SetRegion failed - cannot capture region %d,%d,%d,%d\n",
+    int fps = g_config.replayFPS;
+    if (fps < 30) fps = 30;
+    if (fps > 120) fps = 120;
+    
+    // Attach to the frame hub. If the recorder already runs the hub, our
+    // region must lie inside its capture area (we get a crop of it).
+    HubConsumerConfig hubConfig = {0};
+    hubConfig.name = "replay";
+    hubConfig.fps = fps;
+    hubConfig.queueDepth = FRAME_HUB_DEFAULT_DEPTH;
+    hubConfig.region.x = rect.left;
+    hubConfig.region.y = rect.top;
+    hubConfig.region.width = width;
+    hubConfig.region.height = height;
+    HubConsumer* hubConsumer = FrameHub_AddConsumer(g_frameHub, &hubConfig);
+    if (!hubConsumer) {
+        ReplayLog("FrameHub_AddConsumer failed - cannot capture region %d,%d,%d,%d\n",
                   rect.left, rect.top, rect.right, rect.bottom);
         return 1;
     }
     
+    // Actual size after clamping to the monitor and rounding to even
+    HubRect crop = FrameHub_GetCrop(hubConsumer);
+    RECT cropRect = { crop.x, crop.y, crop.x + crop.width, crop.y + crop.height };
+    width = crop.width;
+    height = crop.height;
+    
     state->frameWidth = width;
     state->frameHeight = height;
     
-    int fps = g_config.replayFPS;
-    if (fps < 30) fps = 30;
-    if (fps > 120) fps = 120;
-    
     ReplayLog("Final capture params: %dx%d @ %d FPS, duration=%ds, quality=%d\n", 
               width, height, fps, g_config.replayDuration, g_config.quality);
     
-    // Initialize GPU color converter (BGRA → NV12 on GPU)
-    GPUConverter gpuConverter = {0};
-    if (!GPUConverter_Init(&gpuConverter, capture->device, width, height)) {
-        ReplayLog("GPUConverter_Init failed - GPU color conversion required!\n");
+    // Create encoder (NVENC when available, software MFT otherwise)
+    ReplayLog("Creating video encoder (%dx%d @ %d fps, quality=%d, backend=%d)...\n",
+              width, height, fps, g_config.quality, g_config.replayEncoder);
+    g_encoder = VideoEncoder_Create(g_config.replayEncoder, capture->device, width, height, fps, g_config.quality);
+    if (!g_encoder) {
+        ReplayLog("VideoEncoder_Create failed - no usable encoder backend!\n");
+        FrameHub_RemoveConsumer(g_frameHub, hubConsumer);
         return 1;
     }
-    ReplayLog("GPU color converter initialized (D3D11 Video Processor)\n");
+    ReplayLog("%s %s encoder initialized\n", VideoEncoder_GetName(g_encoder),
+              g_encoder->codec == VIDEO_CODEC_HEVC ? "HEVC" : "H.264");
     
-    // Initialize NVENC HEVC encoder with D3D11 device (native API)
-    ReplayLog("Creating NVENCEncoder (%dx%d @ %d fps, quality=%d)...\n", width, height, fps, g_config.quality);
-    g_encoder = NVENCEncoder_Create(capture->device, width, height, fps, g_config.quality);
-    if (!g_encoder) {
-        ReplayLog("NVENCEncoder_Create failed - NVIDIA GPU with NVENC required!\n");
-        GPUConverter_Shutdown(&gpuConverter);
-        return 1;
+    // Color conversion matching the encoder's input
+    GPUConverter gpuConverter = {0};
+    CPUConverter cpuConverter = {0};
+    if (g_encoder->inputType == ENCODER_INPUT_D3D11_NV12) {
+        // BGRA → NV12 on GPU
+        if (!GPUConverter_Init(&gpuConverter, capture->device, width, height)) {
+            ReplayLog("GPUConverter_Init failed - GPU color conversion required!\n");
+            VideoEncoder_Destroy(g_encoder);
+            g_encoder = NULL;
+            FrameHub_RemoveConsumer(g_frameHub, hubConsumer);
+            return 1;
+        }
+        GPUConverter_SetSourceRect(&gpuConverter, &cropRect);
+        ReplayLog("GPU color converter initialized (D3D11 Video Processor)\n");
+    } else {
+        // BGRA readback → NV12 in system memory
+        if (!CPUConverter_Init(&cpuConverter, width, height)) {
+            ReplayLog("CPUConverter_Init failed\n");
+            VideoEncoder_Destroy(g_encoder);
+            g_encoder = NULL;
+            FrameHub_RemoveConsumer(g_frameHub, hubConsumer);
+            return 1;
+        }
+        ReplayLog("CPU color converter initialized\n");
     }
-    ReplayLog("NVENC HEVC hardware encoder initialized (native API)\n");
     
-    // Extract HEVC sequence header (VPS/SPS/PPS) for MP4 muxing
-    if (NVENCEncoder_GetSequenceHeader(g_encoder, g_seqHeader, sizeof(g_seqHeader), &g_seqHeaderSize)) {
-        ReplayLog("HEVC sequence header extracted (%u bytes)\n", g_seqHeaderSize);
+    // Extract sequence header for MP4 muxing (software MFTs may only
+    // provide it after the first keyframe - retried at save time)
+    if (VideoEncoder_GetSequenceHeader(g_encoder, g_seqHeader, sizeof(g_seqHeader), &g_seqHeaderSize)) {
+        ReplayLog("Sequence header extracted (%u bytes)\n", g_seqHeaderSize);
     } else {
-        ReplayLog("WARNING: Failed to get HEVC sequence header - muxing may fail!\n");
+        ReplayLog("Sequence header not available yet, will retry on save\n");
         g_seqHeaderSize = 0;
-    };
+    }
     
     // Initialize sample buffer BEFORE setting encoder callback
     // (callback needs valid buffer pointer)
     if (!SampleBuffer_Init(&g_sampleBuffer, g_config.replayDuration, fps, 
-                           width, height, g_config.quality)) {
+                           width, height, g_config.quality, g_encoder->codec)) {
         ReplayLog("SampleBuffer_Init failed\n");
-        NVENCEncoder_Destroy(g_encoder);
+        VideoEncoder_Destroy(g_encoder);
         g_encoder = NULL;
         GPUConverter_Shutdown(&gpuConverter);
+        CPUConverter_Shutdown(&cpuConverter);
+        FrameHub_RemoveConsumer(g_frameHub, hubConsumer);
         return 1;
     }
     
+    // Even frame dropping when the encoder falls behind (before the callback
+    // is set, so completions always find it)
+    g_backpressure = Backpressure_Create(g_encoder->maxInFlight, MF_UNITS_PER_SECOND / fps);
+    
+    // Memory budget: steer QP / keyframe interval so the buffer's duration
+    // fits. Audio is a fixed bitrate, so its share comes off the top.
+    if (g_config.replayMemoryMB > 0 && g_config.replayDuration > 0) {
+        LONGLONG budget = (LONGLONG)g_config.replayMemoryMB * 1024 * 1024;
+        if (state->audioEnabled) {
+            budget -= (LONGLONG)(AAC_BITRATE / 8) * g_config.replayDuration;
+        }
+        LONGLONG targetRate = budget / g_config.replayDuration;
+        
+        QualityControllerConfig qcConfig;
+        QualityController_DefaultConfig(&qcConfig, targetRate,
+                                        Util_QualityToQP(g_config.quality), VIDEO_ENCODER_KEYFRAME_MS);
+        g_quality = QualityController_Create(&qcConfig);
+        if (g_quality) {
+            ReplayLog("Memory budget %dMB: video target %.0f KB/s, QP %d-%d\n",
+                      g_config.replayMemoryMB, targetRate / 1024.0, qcConfig.initialQp, qcConfig.maxQp);
+        } else {
+            ReplayLog("WARNING: Memory budget %dMB too small for %ds, keeping fixed quality\n",
+                      g_config.replayMemoryMB, g_config.replayDuration);
+        }
+    }
+    
+    // Learn this profile's data rate, but only at fixed quality - with a
+    // budget the controller steers QP and the rate says nothing about the
+    // preset. Warn up front if the buffer may not fit in free memory.
+    RamProfileKey ramKey = { width, height, fps, (int)g_config.quality };
+    if (!g_quality) {
+        RamEstimator_Begin(g_ramEstimator, &ramKey);
+    }
+    ReplayRAMEstimate ramEstimate;
+    ReplayBuffer_EstimateRAMUsage(g_config.replayDuration, width, height, fps, g_config.quality, &ramEstimate);
+    ReplayLog("RAM estimate: ~%dMB (%d-%dMB, %s), %dMB free\n", ramEstimate.expectedMB,
+              ramEstimate.lowMB, ramEstimate.highMB,
+              !ramEstimate.learned ? "default bitrate" : ramEstimate.tentative ? "extrapolated" : "learned",
+              ramEstimate.availableMB);
+    BOOL memoryWarned = FALSE;
+    if (ramEstimate.availableMB > 0 && ramEstimate.highMB > ramEstimate.availableMB) {
+        ReplayLog("WARNING: Replay buffer may need up to %dMB but only %dMB is free\n",
+                  ramEstimate.highMB, ramEstimate.availableMB);
+        memoryWarned = TRUE;
+    }
+    
     // Set encoder callback to receive completed frames (async mode)
     // The output thread will call DrainCallback when frames complete
-    NVENCEncoder_SetCallback(g_encoder, DrainCallback, &g_sampleBuffer);
+    VideoEncoder_SetCallback(g_encoder, DrainCallback, &g_sampleBuffer);
+    VideoEncoder_SetQueueGauge(g_encoder, FR_GAUGE_REPLAY_ENCODER_QUEUE);
     
     // Pass sequence header to sample buffer for video-only saves
     if (g_seqHeaderSize > 0) {
@@ -506,6 +766,11 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
     
     ReplayLog("Sample buffer initialized (max %ds)\n", g_config.replayDuration);
     
+    // Master clock for this run: video ticks and audio reads are both stamped
+    // against it, so the streams share time zero
+    MediaClock mediaClock;
+    MediaClock_Init(&mediaClock, NULL, NULL);
+    
     // Initialize audio capture if enabled
     BOOL audioActive = FALSE;
     if (state->audioEnabled && (state->audioSource1[0] || state->audioSource2[0] || state->audioSource3[0])) {
@@ -526,13 +791,13 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
                 AACEncoder_SetCallback(g_aacEncoder, AudioEncoderCallback, NULL);
                 
                 // Set audio max duration to match video buffer (in 100-ns units)
-                g_audioMaxDuration = (LONGLONG)g_config.replayDuration * 10000000LL;
+                AudioStore_SetMaxDuration(&g_audioStore, (LONGLONG)g_config.replayDuration * 10000000LL);
                 ReplayLog("Audio eviction enabled: max duration = %ds\n", g_config.replayDuration);
                 
                 // Get AAC config for muxer
                 AACEncoder_GetConfig(g_aacEncoder, &g_aacConfigData, &g_aacConfigSize);
                 
-                if (AudioCapture_Start(g_audioCapture)) {
+                if (AudioCapture_Start(g_audioCapture, &mediaClock)) {
                     audioActive = TRUE;
                     ReplayLog("Audio capture started successfully\n");
                 } else {
@@ -546,28 +811,51 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
         }
     }
     
-    // Timing - use floating point for precise frame intervals
-    double frameIntervalMs = 1000.0 / (double)fps;  // 16.667ms for 60fps
-    ReplayLog("Frame interval: %.4f ms (target fps=%d)\n", frameIntervalMs, fps);
+    // Variable frame rate: unchanged ticks extend the previous sample
+    BOOL vfrEnabled = g_config.replayVFR;
+    LONGLONG frameDuration = MF_UNITS_PER_SECOND / fps;
+    ReplayLog("Frame interval: %.4f ms (target fps=%d)\n", frameDuration / 10000.0, fps);
+    LONGLONG vfrMaxGap = (LONGLONG)VFR_MAX_FRAME_GAP_MS * 10000LL;
+    LONGLONG lastSubmitTimestamp = 0;
+    if (vfrEnabled) {
+        ReplayLog("Variable frame rate enabled (max gap %dms)\n", VFR_MAX_FRAME_GAP_MS);
+    }
     
-    // Request high-resolution timer (1ms precision)
-    timeBeginPeriod(1);
+    // Wake once per frame on a high-resolution timer, with the same integer
+    // interval as the hub so the two schedules never drift apart. Without a
+    // pacer the loop falls back to 1ms polling.
+    FramePacer* pacer = FramePacer_Create((int)MF_UNITS_PER_SECOND, (int)frameDuration);
+    BOOL pacerAligned = FALSE;
+    if (!pacer) {
+        ReplayLog("WARNING: FramePacer_Create failed, polling instead\n");
+    }
     
-    LARGE_INTEGER perfFreq, lastFrameTime, captureStartTime;
+    LARGE_INTEGER perfFreq, captureStartTime;
     QueryPerformanceFrequency(&perfFreq);
-    QueryPerformanceCounter(&lastFrameTime);
-    captureStartTime = lastFrameTime;
+    QueryPerformanceCounter(&captureStartTime);
+    LONGLONG hubStartTime = FrameHub_Now();
+    ID3D11Texture2D* readbackTexture = NULL;  // CPU path staging copy
     
     int frameCount = 0;
-    int lastLogFrame = 0;
+    int coalescedCount = 0;
+    int saveCount = 0;
+    int lastLogAttempt = 0;
     
     // Diagnostic counters (reset each run)
     int attemptCount = 0;
-    int captureNullCount = 0;
+    int captureNullCount = 0;     // Frames the hub dropped because we fell behind
     int convertNullCount = 0;
     int encodeFailCount = 0;
-    double totalCaptureMs = 0, totalConvertMs = 0, totalSubmitMs = 0;
-    int timingCount = 0;
+    LONGLONG lastMetricsTime = 0;
+    PipelineLatency_Reset(g_latency);
+    
+    Trace_SetThreadName("Replay");
+    FlightRecorder_RegisterThread("Replay");
+    ThreadRegistry_Register("Replay", THREAD_ROLE_ENCODE);
+    Trace_Enable(g_config.replayTrace != FALSE);
+    if (g_config.replayTrace) {
+        ReplayLog("Pipeline trace enabled (written next to each saved clip)\n");
+    }
     
     // Transition to CAPTURING state and signal ready
     // (but don't signal hReadyEvent until we have frames)
@@ -575,12 +863,20 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
     state->bufferReady = TRUE;  // Legacy flag
     ReplayLog("Buffer thread ready, entering capture loop\n");
     
-    // Build wait handle array for event-driven loop
-    HANDLE waitHandles[2] = { state->hStopEvent, state->hSaveRequestEvent };
+    // Build wait handle array for event-driven loop (frame timer last)
+    HANDLE waitHandles[3] = { state->hStopEvent, state->hSaveRequestEvent, NULL };
     
     while (InterlockedCompareExchange(&state->state, 0, 0) == REPLAY_STATE_CAPTURING) {
-        // Check for stop/save events with 1ms timeout (allows frame timing)
-        DWORD waitResult = WaitForMultipleObjects(2, waitHandles, FALSE, 1);
+        // Sleep until stop/save or the next frame deadline
+        DWORD handleCount = 2;
+        DWORD waitTimeout = 1;
+        if (pacer) {
+            waitHandles[2] = FramePacer_Arm(pacer);
+            handleCount = 3;
+            waitTimeout = INFINITE;
+        }
+        FlightRecorder_SetStage("wait", FR_NO_DEADLINE);
+        DWORD waitResult = WaitForMultipleObjects(handleCount, waitHandles, FALSE, waitTimeout);
         
         if (waitResult == WAIT_OBJECT_0) {
             // Stop event signaled
@@ -590,8 +886,17 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
         
         if (waitResult == WAIT_OBJECT_0 + 1) {
             // Save request event signaled
+            LONGLONG saveStartTime = FrameHub_Now();
+            TRACE_BEGIN(TRACE_SAVE, ++saveCount);
+            ThreadRegistry_SetRole(THREAD_ROLE_SAVE);
+            int64_t saveCpuStart = ThreadRegistry_CurrentCpuTime();
+            FlightRecorder_SetStage("save", SAVE_TIMEOUT_MS);
             double duration = SampleBuffer_GetDuration(&g_sampleBuffer);
             int count = SampleBuffer_GetCount(&g_sampleBuffer);
+            FlightRecorder_Event(FR_EVENT_SAVE_BEGIN, count, AudioStore_GetCount(&g_audioStore));
+            MemTagStats memBefore;
+            MemTracker_GetTotal(&memBefore);
+            MemTracker_ResetWindow();
             
             // Calculate actual capture stats for diagnostics
             LARGE_INTEGER nowTime;
@@ -600,69 +905,52 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
             double actualFPS = (realElapsedSec > 0) ? frameCount / realElapsedSec : 0;
             
             ReplayLog("SAVE REQUEST: %d video samples (%.2fs), %d audio samples, after %.2fs real time\n", 
-                      count, duration, g_audioSampleCount, realElapsedSec);
+                      count, duration, AudioStore_GetCount(&g_audioStore), realElapsedSec);
             ReplayLog("  Actual capture rate: %.2f fps (target: %d fps)\n", actualFPS, fps);
             ReplayLog("  Output path: %s\n", state->savePath);
+            if (state->saveSeconds > 0) {
+                ReplayLog("  Clip: last %ds\n", state->saveSeconds);
+            }
+            LogBackpressure("  Encoder: ");
+            
+            // Late sequence header (encoders that only emit it in-band)
+            if (g_sampleBuffer.seqHeaderSize == 0 &&
+                VideoEncoder_GetSequenceHeader(g_encoder, g_seqHeader, sizeof(g_seqHeader), &g_seqHeaderSize)) {
+                SampleBuffer_SetSequenceHeader(&g_sampleBuffer, g_seqHeader, g_seqHeaderSize);
+            }
             
             // Write buffer to file (with audio if available)
             BOOL ok = FALSE;
             
-            EnterCriticalSection(&g_audioLock);
-            int audioCount = g_audioSampleCount;
-            MuxerAudioSample* audioCopy = NULL;
+            // Video first: its first sample is time zero in the file, and audio
+            // (stamped on the same media clock) is rebased onto it
+            MuxerSample* videoSamples = NULL;
+            int videoCount = 0;
+            LONGLONG mediaBase = 0;
+            TRACE_BEGIN(TRACE_SAVE_COPY, saveCount);
+            BOOL haveVideo = SampleBuffer_GetRecentSamplesForMuxing(&g_sampleBuffer,
+                (LONGLONG)state->saveSeconds * MF_UNITS_PER_SECOND, &videoSamples, &videoCount, &mediaBase);
             
-            if (audioCount > 0 && g_audioSamples && g_aacConfigData && g_aacConfigSize > 0) {
-                // Deep copy audio samples
-                audioCopy = (MuxerAudioSample*)malloc(audioCount * sizeof(MuxerAudioSample));
-                if (audioCopy) {
-                    LONGLONG firstAudioTs = g_audioSamples[0].timestamp;
-                    int copiedCount = 0;
-                    BOOL copyFailed = FALSE;
-                    
-                    for (int i = 0; i < audioCount; i++) {
-                        audioCopy[i].data = (BYTE*)malloc(g_audioSamples[i].size);
-                        if (audioCopy[i].data) {
-                            memcpy(audioCopy[i].data, g_audioSamples[i].data, g_audioSamples[i].size);
-                            audioCopy[i].size = g_audioSamples[i].size;
-                            audioCopy[i].timestamp = g_audioSamples[i].timestamp - firstAudioTs;
-                            audioCopy[i].duration = g_audioSamples[i].duration;
-                            copiedCount++;
-                        } else {
-                            // malloc failed - free all previous copies and abort
-                            ReplayLog("WARNING: Audio copy malloc failed at sample %d/%d\n", i, audioCount);
-                            for (int j = 0; j < i; j++) {
-                                if (audioCopy[j].data) free(audioCopy[j].data);
-                            }
-                            free(audioCopy);
-                            audioCopy = NULL;
-                            copyFailed = TRUE;
-                            break;
-                        }
-                    }
-                    
-                    // Update audioCount to reflect actual copied samples
-                    if (!copyFailed) {
-                        audioCount = copiedCount;
-                    } else {
-                        audioCount = 0;
-                    }
-                }
+            int audioCount = 0;
+            MuxerAudioSample* audioCopy = NULL;
+            if (haveVideo && g_aacConfigData && g_aacConfigSize > 0) {
+                // Audio from before the first video frame is cut
+                AudioStore_GetSamplesForMuxing(&g_audioStore, mediaBase, &audioCopy, &audioCount);
             }
-            LeaveCriticalSection(&g_audioLock);
+            TRACE_END(TRACE_SAVE_COPY, saveCount);
             
-            // Get video samples
-            MuxerSample* videoSamples = NULL;
-            int videoCount = 0;
-            if (SampleBuffer_GetSamplesForMuxing(&g_sampleBuffer, &videoSamples, &videoCount)) {
+            if (haveVideo) {
                 // Build video config
                 MuxerConfig videoConfig;
                 videoConfig.width = g_sampleBuffer.width;
                 videoConfig.height = g_sampleBuffer.height;
                 videoConfig.fps = g_sampleBuffer.fps;
                 videoConfig.quality = g_sampleBuffer.quality;
+                videoConfig.codec = g_sampleBuffer.codec;
                 videoConfig.seqHeader = g_sampleBuffer.seqHeaderSize > 0 ? g_sampleBuffer.seqHeader : NULL;
                 videoConfig.seqHeaderSize = g_sampleBuffer.seqHeaderSize;
                 
+                TRACE_BEGIN(TRACE_SAVE_MUX, saveCount);
                 if (audioCopy && audioCount > 0) {
                     // Mux with audio
                     ReplayLog("  Starting save (audio+video path, %d audio samples)...\n", audioCount);
@@ -681,130 +969,228 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
                     ReplayLog("  Starting save (video-only path)...\n");
                     ok = MP4Muxer_WriteFile(state->savePath, videoSamples, videoCount, &videoConfig);
                 }
+                TRACE_END(TRACE_SAVE_MUX, saveCount);
                 
                 // Free video samples
                 for (int i = 0; i < videoCount; i++) {
-                    if (videoSamples[i].data) free(videoSamples[i].data);
+                    if (videoSamples[i].data) MemTracker_Free(videoSamples[i].data);
                 }
-                free(videoSamples);
+                MemTracker_Free(videoSamples);
             }
             
             // Free audio copy
             if (audioCopy) {
                 for (int i = 0; i < audioCount; i++) {
-                    if (audioCopy[i].data) free(audioCopy[i].data);
+                    if (audioCopy[i].data) MemTracker_Free(audioCopy[i].data);
                 }
-                free(audioCopy);
+                MemTracker_Free(audioCopy);
             }
             
-            ReplayLog("SAVE %s\n", ok ? "OK" : "FAILED");
+            PipelineLatency_Record(g_latency, LATENCY_SAVE, FrameHub_Now() - saveStartTime);
+            g_savesTotal++;
+            if (!ok) g_saveFailures++;
+            g_lastSaveSeconds = (double)(FrameHub_Now() - saveStartTime) / MF_UNITS_PER_SECOND;
+            ReplayLog("SAVE %s (%.0fms, CPU %.0fms)\n", ok ? "OK" : "FAILED", (FrameHub_Now() - saveStartTime) / 10000.0,
+                      (ThreadRegistry_CurrentCpuTime() - saveCpuStart) / 10000.0);
+            FlightRecorder_Event(FR_EVENT_SAVE_END, ok, (FrameHub_Now() - saveStartTime) / 10000);
+            MemTagStats memSave, copies;
+            MemTracker_GetTotal(&memSave);
+            MemTracker_GetStats(MEM_TAG_SAVE, &copies);
+            ReplayLog("  Memory during save: peak %.1fMB (+%.1fMB over %.1fMB, copies %.1fMB)\n",
+                      memSave.windowPeak / (1024.0 * 1024.0), (memSave.windowPeak - memBefore.current) / (1024.0 * 1024.0),
+                      memBefore.current / (1024.0 * 1024.0), copies.windowPeak / (1024.0 * 1024.0));
+            TRACE_END(TRACE_SAVE, saveCount);
+            if (ok && Trace_IsEnabled()) {
+                WriteTrace(state->savePath);
+            }
+            ThreadRegistry_SetRole(THREAD_ROLE_ENCODE);
             
             state->saveSuccess = ok;
             SetEvent(state->hSaveCompleteEvent);
             continue;  // Skip frame capture this iteration
         }
         
+        if (waitResult == WAIT_OBJECT_0 + 2) {
+            FramePacer_Complete(pacer, NULL);
+        }
+        
         // === AUDIO CAPTURE ===
+        // Drain everything mixed since the last wake (a frame's worth or more)
         if (audioActive && g_audioCapture && g_aacEncoder) {
+            FlightRecorder_SetStage("audio", FR_STAGE_DEADLINE_MS);
             BYTE audioPcmBuf[8192];
             LONGLONG audioTs = 0;
-            int audioBytes = AudioCapture_Read(g_audioCapture, audioPcmBuf, sizeof(audioPcmBuf), &audioTs);
-            if (audioBytes > 0) {
+            int audioBytes;
+            for (;;) {
+                TRACE_BEGIN(TRACE_AUDIO_READ, 0);
+                audioBytes = AudioCapture_Read(g_audioCapture, audioPcmBuf, sizeof(audioPcmBuf), &audioTs);
+                TRACE_END(TRACE_AUDIO_READ, audioBytes > 0 ? audioTs : 0);
+                if (audioBytes <= 0) break;
+                
+                TRACE_BEGIN(TRACE_AUDIO_ENCODE, audioTs);
                 AACEncoder_Feed(g_aacEncoder, audioPcmBuf, audioBytes, audioTs);
+                TRACE_END(TRACE_AUDIO_ENCODE, audioTs);
+                if (audioBytes < (int)sizeof(audioPcmBuf)) break;
             }
         }
         
-        // === FRAME CAPTURE (GPU PATH) ===
-        LARGE_INTEGER currentTime;
-        QueryPerformanceCounter(&currentTime);
-        double frameElapsedMs = (double)(currentTime.QuadPart - lastFrameTime.QuadPart) * 1000.0 / perfFreq.QuadPart;
+        // === QUALITY ===
+        // Apply budget decisions here, on the thread that submits frames
+        int newQp, newKeyframeMs;
+        if (QualityController_Poll(g_quality, &newQp, &newKeyframeMs)) {
+            EncoderParams params = {0};
+            params.qp = newQp;
+            params.keyframeIntervalMs = newKeyframeMs;
+            if (VideoEncoder_Reconfigure(g_encoder, &params)) {
+                FlightRecorder_Event(FR_EVENT_RECONFIGURE, newQp, newKeyframeMs);
+                ReplayLog("Quality: QP=%d, keyframe every %dms\n", newQp, newKeyframeMs);
+            } else {
+                ReplayLog("WARNING: Encoder refused QP=%d / keyframe %dms\n", newQp, newKeyframeMs);
+                QualityController_Rejected(g_quality);
+            }
+        }
         
-        if (frameElapsedMs >= frameIntervalMs) {
-            // Use ideal next frame time (prevents drift accumulation)
-            lastFrameTime.QuadPart += (LONGLONG)(frameIntervalMs * perfFreq.QuadPart / 1000.0);
+        // === FRAME CAPTURE ===
+        // The hub paces deliveries at our frame rate; take everything queued
+        FlightRecorder_SetStage("capture", FR_STAGE_DEADLINE_MS);
+        for (;;) {
+            HubDelivery delivery = {0};
+            LONGLONG t2, t3, t4;  // Pipeline timing (FrameHub_Now units)
+            DropReason dropReason;
             
-            // But if we're way behind, reset to now (prevents "catch up" burst)
-            if ((currentTime.QuadPart - lastFrameTime.QuadPart) * 1000.0 / perfFreq.QuadPart > frameIntervalMs * 2) {
-                lastFrameTime = currentTime;
+            if (!FrameHub_Acquire(g_frameHub, hubConsumer, 0, &delivery)) break;
+            if (delivery.tickTime < hubStartTime) {
+                // Queued while the encoder was starting up - stale
+                FrameHub_Release(g_frameHub, delivery.frame);
+                continue;
             }
             
-            attemptCount++;
-            
-            // Calculate real wall-clock timestamp for this frame (100-ns units)
-            double realElapsedSec = (double)(currentTime.QuadPart - captureStartTime.QuadPart) / perfFreq.QuadPart;
-            UINT64 realTimestamp = (UINT64)(realElapsedSec * 10000000.0);
+            // Wake half a frame after the hub ticks, so each wake normally
+            // finds exactly one delivery waiting
+            if (pacer && !pacerAligned) {
+                FramePacer_Reset(pacer, delivery.tickTime + frameDuration + frameDuration / 2);
+                pacerAligned = TRUE;
+            }
             
-            // GPU path: capture → color convert → NVENC (all on GPU)
+            t2 = FrameHub_Now();
+            attemptCount++;
+            PipelineLatency_Record(g_latency, LATENCY_ACQUIRE, t2 - delivery.frame->grabTime);
             
-            // Pipeline timing for diagnostics
-            LARGE_INTEGER t1, t2, t3, t4;
+            // Wall-clock timestamp of the hub tick (100-ns units)
+            UINT64 realTimestamp = (UINT64)MediaClock_FromSource(&mediaClock, delivery.tickTime);
+            TRACE_INSTANT(TRACE_ACQUIRE, realTimestamp);
+            double realElapsedSec = (double)realTimestamp / MF_UNITS_PER_SECOND;
+            ID3D11Texture2D* bgraTexture = (ID3D11Texture2D*)delivery.frame->payload;
             
-            if (gpuConverter.initialized && g_encoder) {
-                QueryPerformanceCounter(&t1);
-                ID3D11Texture2D* bgraTexture = Capture_GetFrameTexture(capture, NULL);
-                QueryPerformanceCounter(&t2);
-                
-                if (bgraTexture) {
-                    ID3D11Texture2D* nv12Texture = GPUConverter_Convert(&gpuConverter, bgraTexture);
-                    QueryPerformanceCounter(&t3);
+            if ((gpuConverter.initialized || cpuConverter.initialized) && g_encoder) {
+                if (vfrEnabled && !delivery.changed && frameCount > 0 &&
+                    (LONGLONG)realTimestamp - lastSubmitTimestamp < vfrMaxGap) {
+                    // Static content: hold the previous sample for this tick
+                    // instead of encoding a duplicate frame
+                    SampleBuffer_ExtendLastSample(&g_sampleBuffer, (LONGLONG)realTimestamp + frameDuration);
+                    coalescedCount++;
+                    CountBufferedTick(state);
+                } else if ((dropReason = Backpressure_Admit(g_backpressure, (LONGLONG)realTimestamp, FrameHub_Now())) != DROP_NONE) {
+                    // Encoder behind: skip this frame, spread evenly over time.
+                    // The previous sample covers the gap, as with dropped ticks.
+                    TRACE_INSTANT(TRACE_DROP, realTimestamp);
+                    FlightRecorder_Event(FR_EVENT_DROP, (LONGLONG)realTimestamp, dropReason);
+                    CountBufferedTick(state);
+                } else {
+                    BOOL converted = FALSE;
+                    BOOL submitted = FALSE;
+                    
+                    // Tagged before submit: the output thread may return the
+                    // frame before the submit call does
+                    LatencyTag tag = { (LONGLONG)realTimestamp, delivery.frame->grabTime, 0 };
                     
-                    if (nv12Texture) {
-                        // Async API: Submit frame (fast, non-blocking)
-                        // Output thread will call DrainCallback when frame completes
-                        BOOL submitted = NVENCEncoder_SubmitTexture(g_encoder, nv12Texture, realTimestamp);
-                        QueryPerformanceCounter(&t4);
-                        
+                    if (gpuConverter.initialized) {
+                        // GPU path: color convert → NVENC (all on GPU)
+                        FlightRecorder_SetStage("convert", FR_STAGE_DEADLINE_MS);
+                        TRACE_BEGIN(TRACE_CONVERT, realTimestamp);
+                        ID3D11Texture2D* nv12Texture = GPUConverter_Convert(&gpuConverter, bgraTexture);
+                        TRACE_END(TRACE_CONVERT, realTimestamp);
+                        t3 = FrameHub_Now();
+                        if (nv12Texture) {
+                            converted = TRUE;
+                            tag.submitTime = t3;
+                            PipelineLatency_TagFrame(g_latency, &tag);
+                            // Async API: Submit frame (fast, non-blocking)
+                            // Output thread will call DrainCallback when frame completes
+                            FlightRecorder_SetStage("submit", FR_STAGE_DEADLINE_MS);
+                            TRACE_BEGIN(TRACE_SUBMIT, realTimestamp);
+                            submitted = VideoEncoder_SubmitTexture(g_encoder, nv12Texture, realTimestamp);
+                            TRACE_END(TRACE_SUBMIT, realTimestamp);
+                        }
+                    } else {
+                        // CPU path: readback → color convert → software encoder queue
+                        int bgraPitch = 0;
+                        FlightRecorder_SetStage("convert", FR_STAGE_DEADLINE_MS);
+                        TRACE_BEGIN(TRACE_CONVERT, realTimestamp);
+                        BYTE* bgra = Capture_MapFrameTexture(capture, bgraTexture, &cropRect,
+                                                             &readbackTexture, &bgraPitch);
+                        BYTE* yPlane = bgra ? CPUConverter_Convert(&cpuConverter, bgra, bgraPitch) : NULL;
+                        if (bgra) Capture_UnmapFrameTexture(capture, readbackTexture);
+                        TRACE_END(TRACE_CONVERT, realTimestamp);
+                        t3 = FrameHub_Now();
+                        if (yPlane) {
+                            converted = TRUE;
+                            tag.submitTime = t3;
+                            PipelineLatency_TagFrame(g_latency, &tag);
+                            FlightRecorder_SetStage("submit", FR_STAGE_DEADLINE_MS);
+                            TRACE_BEGIN(TRACE_SUBMIT, realTimestamp);
+                            submitted = VideoEncoder_SubmitNV12(g_encoder, yPlane, cpuConverter.yPitch,
+                                                                CPUConverter_GetUVPlane(&cpuConverter),
+                                                                cpuConverter.uvPitch, realTimestamp);
+                            TRACE_END(TRACE_SUBMIT, realTimestamp);
+                        }
+                    }
+                    t4 = FrameHub_Now();
+                    
+                    if (converted) {
+                        Backpressure_SubmitResult(g_backpressure, (LONGLONG)realTimestamp, FrameHub_Now(), submitted != FALSE);
                         if (submitted) {
                             frameCount++;  // Count submissions (frames delivered via callback)
+                            FlightRecorder_Event(FR_EVENT_SUBMIT, (LONGLONG)realTimestamp, 0);
+                            lastSubmitTimestamp = (LONGLONG)realTimestamp;
+                            CountBufferedTick(state);
                             
-                            // Update state machine frame count
-                            LONG newCount = InterlockedIncrement(&state->framesCaptured);
-                            
-                            // Signal ready event once we have enough frames
-                            if (newCount == MIN_FRAMES_FOR_SAVE) {
-                                SetEvent(state->hReadyEvent);
-                                ReplayLog("Minimum frames captured (%d), ready for saves\n", MIN_FRAMES_FOR_SAVE);
-                            }
-                            
-                            // Accumulate timing stats (submit should be <1ms in async mode)
-                            totalCaptureMs += (double)(t2.QuadPart - t1.QuadPart) * 1000.0 / perfFreq.QuadPart;
-                            totalConvertMs += (double)(t3.QuadPart - t2.QuadPart) * 1000.0 / perfFreq.QuadPart;
-                            totalSubmitMs += (double)(t4.QuadPart - t3.QuadPart) * 1000.0 / perfFreq.QuadPart;
-                            timingCount++;
+                            // Stage timing (submit should be <1ms in async mode)
+                            PipelineLatency_Record(g_latency, LATENCY_CONVERT, t3 - t2);
+                            PipelineLatency_Record(g_latency, LATENCY_SUBMIT, t4 - t3);
                         } else {
                             encodeFailCount++;
                         }
                     } else {
                         convertNullCount++;
                     }
-                } else {
-                    captureNullCount++;
                 }
             }
+            FrameHub_Release(g_frameHub, delivery.frame);
+            
+            HubConsumerStats hubStats;
+            FrameHub_GetConsumerStats(g_frameHub, hubConsumer, &hubStats);
+            captureNullCount = (int)hubStats.dropped;
             
             // Early failure detection - if first 60 attempts all fail, log warning
             if (attemptCount == 60 && frameCount == 0) {
                 ReplayLog("WARNING: First 60 capture attempts all failed! Check capture source.\n");
-                ReplayLog("  capture=%d, convert=%d, encode=%d\n",
+                ReplayLog("  dropped=%d, convert=%d, encode=%d\n",
                           captureNullCount, convertNullCount, encodeFailCount);
             }
             
             // Log failures and timing periodically (every 10 seconds worth of attempts)
             if (attemptCount % (fps * 10) == 0 && attemptCount > 0) {
-                if (timingCount > 0) {
-                    ReplayLog("Pipeline timing (avg): capture=%.2fms, convert=%.2fms, submit=%.2fms, total=%.2fms\n",
-                              totalCaptureMs / timingCount, totalConvertMs / timingCount, 
-                              totalSubmitMs / timingCount,
-                              (totalCaptureMs + totalConvertMs + totalSubmitMs) / timingCount);
-                }
+                ReplayLog("Pipeline latency (since start):\n");
+                LogLatency("  ");
                 if (captureNullCount + convertNullCount + encodeFailCount > 0) {
-                    ReplayLog("Frame stats: attempts=%d, success=%d, failures: capture=%d, convert=%d, encode=%d\n",
+                    ReplayLog("Frame stats: attempts=%d, success=%d, failures: dropped=%d, convert=%d, encode=%d\n",
                               attemptCount, frameCount, captureNullCount, convertNullCount, encodeFailCount);
                 }
             }
             
-            // Periodic log with actual FPS calculation
-            if (frameCount - lastLogFrame >= fps * 5) {
+            // Periodic log with actual FPS calculation (every 5 seconds of ticks)
+            if (attemptCount - lastLogAttempt >= fps * 5) {
                 LARGE_INTEGER nowTime;
                 QueryPerformanceCounter(&nowTime);
                 double logElapsedSec = (double)(nowTime.QuadPart - captureStartTime.QuadPart) / perfFreq.QuadPart;
@@ -814,7 +1200,7 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
                 // Get encoder stats
                 int encFrames = 0;
                 double avgEncMs = 0;
-                NVENCEncoder_GetStats(g_encoder, &encFrames, &avgEncMs);
+                VideoEncoder_GetStats(g_encoder, &encFrames, &avgEncMs);
                 
                 double duration = SampleBuffer_GetDuration(&g_sampleBuffer);
                 int bufCount = SampleBuffer_GetCount(&g_sampleBuffer);
@@ -823,27 +1209,97 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
                 int avgKBPerFrame = bufCount > 0 ? (int)(memKB / bufCount) : 0;
                 ReplayLog("Status: %d/%d frames in %.1fs (encode=%.1f fps, attempt=%.1f fps, target=%d fps), buffer=%.1fs (%d samples, %zu MB, %d KB/frame)\n", 
                           frameCount, attemptCount, realElapsedSec, actualFPS, attemptFPS, fps, duration, bufCount, memMB, avgKBPerFrame);
+                if (vfrEnabled) {
+                    ReplayLog("  VFR: %d static ticks coalesced (%.1f%% of attempts)\n",
+                              coalescedCount, attemptCount > 0 ? 100.0 * coalescedCount / attemptCount : 0.0);
+                }
+                
+                // Wake-up jitter since the last status line
+                if (pacer) {
+                    FramePacerStats pacerStats;
+                    char pacerLine[256];
+                    FramePacer_GetStats(pacer, &pacerStats);
+                    FramePacer_FormatStats(&pacerStats, pacerLine, sizeof(pacerLine));
+                    ReplayLog("  Pacing: %s\n", pacerLine);
+                    FramePacer_ResetStats(pacer);
+                }
+                LogBackpressure("  Encoder: ");
+                
+                // While the buffer fills, project its full size from the
+                // rate so far and warn once if that won't fit
+                double liveRate = RamEstimator_GetLiveRate(g_ramEstimator);
+                if (!memoryWarned && liveRate > 0 && duration < g_config.replayDuration) {
+                    int projectedMB = (int)(liveRate * g_config.replayDuration / (1024 * 1024));
+                    int availableMB = AvailableMemoryMB();
+                    if (availableMB > 0 && projectedMB > availableMB + (int)memMB) {
+                        ReplayLog("WARNING: Replay buffer is on course for %dMB but only %dMB more is free\n",
+                                  projectedMB, availableMB);
+                        memoryWarned = TRUE;
+                    }
+                }
+                char memLine[384];
+                MemTracker_Format(memLine, sizeof(memLine));
+                ReplayLog("  Memory: %s\n", memLine);
+                LogThreads("  Threads: ");
+                if (g_quality) {
+                    QualityControllerStats qcStats;
+                    QualityController_GetStats(g_quality, &qcStats);
+                    ReplayLog("  Quality: QP=%d keyframe=%dms rate=%.0f KB/s (target %.0f), ring %zu/%dMB, %llu raises, %llu relaxes\n",
+                              qcStats.qp, qcStats.keyframeMs, qcStats.rate / 1024.0, qcStats.targetBytesPerSec / 1024.0,
+                              memMB, g_config.replayMemoryMB,
+                              (unsigned long long)qcStats.raises, (unsigned long long)qcStats.relaxes);
+                }
                 
                 // Log failure breakdown if any
                 if (captureNullCount + convertNullCount + encodeFailCount > 0) {
-                    ReplayLog("  Failures: capture=%d, convert=%d, encode=%d\n",
+                    ReplayLog("  Failures: dropped=%d, convert=%d, encode=%d\n",
                               captureNullCount, convertNullCount, encodeFailCount);
                 }
                 
-                lastLogFrame = frameCount;
+                lastLogAttempt = attemptCount;
             }
         }
-        // No Sleep() needed - WaitForMultipleObjects provides timing
+        
+        // Metrics snapshot for external monitoring, once a second
+        LONGLONG metricsTime = FrameHub_Now();
+        if (metricsTime - lastMetricsTime >= MF_UNITS_PER_SECOND) {
+            MetricsSnapshot metrics = {0};
+            metrics.buffering = TRUE;
+            metrics.framesAttempted = (uint64_t)attemptCount;
+            metrics.framesSubmitted = (uint64_t)frameCount;
+            metrics.framesCoalesced = (uint64_t)coalescedCount;
+            metrics.captureDropped = (uint64_t)captureNullCount;
+            metrics.convertFailed = (uint64_t)convertNullCount;
+            metrics.encodeFailed = (uint64_t)encodeFailCount;
+            PublishMetrics(&metrics);
+            lastMetricsTime = metricsTime;
+        }
     }
     
     // Cleanup
     ReplayLog("Shutting down (state=%d)...\n", InterlockedCompareExchange(&state->state, 0, 0));
     
-    // Restore timer resolution
-    timeEndPeriod(1);
+    // Capture tick timing since the hub last started
+    FramePacerStats hubPacing;
+    char hubPacingLine[256];
+    FrameHub_GetPacerStats(g_frameHub, &hubPacing);
+    FramePacer_FormatStats(&hubPacing, hubPacingLine, sizeof(hubPacingLine));
+    ReplayLog("Capture pacing: %s\n", hubPacingLine);
+    LogBackpressure("Encoder backpressure: ");
+    ReplayLog("Pipeline latency:\n");
+    LogLatency("  ");
+    
+    // Detach from the frame hub (stops capture if we were the last consumer)
+    FrameHub_RemoveConsumer(g_frameHub, hubConsumer);
+    if (readbackTexture) {
+        readbackTexture->lpVtbl->Release(readbackTexture);
+    }
+    
+    FramePacer_Destroy(pacer);
     
-    // Shutdown GPU converter
+    // Shutdown color converters
     GPUConverter_Shutdown(&gpuConverter);
+    CPUConverter_Shutdown(&cpuConverter);
     
     // Stop audio capture
     if (audioActive) {
@@ -862,15 +1318,34 @@ static DWORD WINAPI BufferThreadProc(LPVOID param) {
     // Flush encoder
     if (g_encoder) {
         EncodedFrame flushed = {0};
-        while (NVENCEncoder_Flush(g_encoder, &flushed)) {
+        while (VideoEncoder_Flush(g_encoder, &flushed)) {
             SampleBuffer_Add(&g_sampleBuffer, &flushed);
         }
         
-        NVENCEncoder_Destroy(g_encoder);
+        VideoEncoder_Destroy(g_encoder);
         g_encoder = NULL;
     }
+    Backpressure_Destroy(g_backpressure);
+    g_backpressure = NULL;
+    QualityController_Destroy(g_quality);
+    g_quality = NULL;
     SampleBuffer_Shutdown(&g_sampleBuffer);
     
+    MetricsSnapshot stopped = {0};
+    PublishMetrics(&stopped);
+    
+    // Keep what this run learned even if the app doesn't exit cleanly
+    RamEstimator_End(g_ramEstimator);
+    char profilePath[MAX_PATH];
+    GetRamProfilePath(profilePath, sizeof(profilePath));
+    if (!RamEstimator_Save(g_ramEstimator, profilePath)) {
+        ReplayLog("Failed to save RAM profiles to %s\n", profilePath);
+    }
+    
+    Trace_Enable(FALSE);
+    Trace_ReleaseThread();
+    FlightRecorder_ReleaseThread();
+    ThreadRegistry_Unregister();
     ReplayLog("BufferThread exit\n");
     return 0;
 }
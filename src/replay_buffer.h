@@ -12,13 +12,15 @@
 
 #include <windows.h>
 #include "config.h"
-
-// Maximum encoded audio samples to store
-#define MAX_AUDIO_SAMPLES 16384
+#include "pipeline_latency.h"
 
 // Minimum frames required before save is allowed (1 second worth)
 #define MIN_FRAMES_FOR_SAVE 30
 
+// Variable frame rate: longest a static frame may be held before a real
+// frame is encoded anyway (keeps keyframes and seek points regular)
+#define VFR_MAX_FRAME_GAP_MS 1000
+
 // Replay buffer lifecycle states
 typedef enum {
     REPLAY_STATE_UNINITIALIZED,
@@ -50,6 +52,7 @@ typedef struct {
     
     // Save parameters (protected by hSaveRequestEvent sequencing)
     char savePath[MAX_PATH];
+    int saveSeconds;            // Clip length, 0 = whole buffer
     volatile BOOL saveSuccess;  // Result of last save
     
     // Legacy compatibility
@@ -72,9 +75,35 @@ typedef struct {
 BOOL ReplayBuffer_Init(ReplayBufferState* state);
 void ReplayBuffer_Shutdown(ReplayBufferState* state);
 BOOL ReplayBuffer_Start(ReplayBufferState* state, const AppConfig* config);
-void ReplayBuffer_Stop(ReplayBufferState* state);
+// Stop buffering. Returns FALSE if the buffer thread did not exit within
+// 10s: it is left running and Start refuses until it has exited.
+BOOL ReplayBuffer_Stop(ReplayBufferState* state);
+// TRUE once no buffer thread is running (closes the handle of one that ended)
+BOOL ReplayBuffer_HasExited(ReplayBufferState* state);
 BOOL ReplayBuffer_Save(ReplayBufferState* state, const char* outputPath);
-int ReplayBuffer_EstimateRAMUsage(int durationSeconds, int width, int height, int fps);
+// Save only the newest 'seconds' (from the keyframe before that point;
+// 0 = whole buffer). Blocks until the file is written.
+BOOL ReplayBuffer_SaveClip(ReplayBufferState* state, const char* outputPath, int seconds);
 void ReplayBuffer_GetStatus(ReplayBufferState* state, char* buffer, int bufferSize);
 
+// Expected video buffer RAM for a capture shape. Uses data rates learned
+// from earlier runs on this machine (a fixed-bitrate guess until then) and
+// is capped by the memory budget when one is set.
+typedef struct {
+    int expectedMB;
+    int lowMB;                  // 5th-95th percentile range
+    int highMB;
+    int availableMB;            // Free physical memory right now
+    BOOL learned;               // FALSE: fixed-bitrate guess, no range
+    BOOL tentative;             // Extrapolated from another resolution/fps/quality
+} ReplayRAMEstimate;
+
+// Returns expectedMB; 'estimate' (optional) receives the full estimate
+int ReplayBuffer_EstimateRAMUsage(int durationSeconds, int width, int height, int fps,
+                                  QualityPreset quality, ReplayRAMEstimate* estimate);
+
+// Latency percentiles of a pipeline stage since the buffer last started
+// (FALSE if the stage has no samples yet)
+BOOL ReplayBuffer_GetLatency(ReplayBufferState* state, LatencyStage stage, LatencySummary* summary);
+
 #endif
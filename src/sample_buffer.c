@@ -8,7 +8,11 @@
 #include "mp4_muxer.h"
 #include "util.h"
 #include "logger.h"
+#include "trace.h"
+#include "flight_recorder.h"
+#include "mem_tracker.h"
 #include <stdio.h>
+#include <string.h>
 
 // Alias for logging
 #define BufLog Logger_Log
@@ -16,7 +20,7 @@
 // Free a single sample
 static void FreeSample(BufferedSample* sample) {
     if (sample->data) {
-        free(sample->data);
+        MemTracker_Free(sample->data);
         sample->data = NULL;
     }
     sample->size = 0;
@@ -28,8 +32,16 @@ static void FreeSample(BufferedSample* sample) {
 // Evict oldest samples until buffer duration is under maxDuration
 // Uses real timestamps: newest_timestamp - oldest_timestamp
 static void EvictOldSamples(SampleBuffer* buf, LONGLONG newTimestamp) {
+    buf->lastEvicted = 0;
+    buf->lastEvictNs = 0;
     if (buf->count == 0) return;
     
+    // Only an add that evicts pays for the clock reads
+    if (buf->count < buf->capacity &&
+        newTimestamp - buf->samples[buf->tail].timestamp <= buf->maxDuration) {
+        return;
+    }
+    int64_t evictStart = Platform_SystemNowNs();
     int evicted = 0;
     
     // Keep evicting while (newest - oldest) > maxDuration
@@ -59,28 +71,32 @@ static void EvictOldSamples(SampleBuffer* buf, LONGLONG newTimestamp) {
         evicted++;
     }
     
+    buf->lastEvicted = evicted;
+    buf->lastEvictNs = Platform_SystemNowNs() - evictStart;
+    if (evicted > 0) TRACE_INSTANT(TRACE_EVICT, evicted);
+
     // Log eviction occasionally to show buffer is working
     static int evictLogCounter = 0;
     evictLogCounter++;
     if (evicted > 0 && (evictLogCounter % 300) == 0 && buf->count > 0) {
         double span = (double)(newTimestamp - buf->samples[buf->tail].timestamp) / 10000000.0;
-        BufLog("Eviction: removed %d samples, count now %d, span=%.2fs\n", 
-               evicted, buf->count, span);
+        LOG_DEBUG("Eviction: removed %d samples, count now %d, span=%.2fs\n", 
+                  evicted, buf->count, span);
     }
 }
 
 BOOL SampleBuffer_Init(SampleBuffer* buf, int durationSeconds, int fps,
-                        int width, int height, QualityPreset quality) {
+                        int width, int height, QualityPreset quality, VideoCodec codec) {
     if (!buf) return FALSE;
     
-    ZeroMemory(buf, sizeof(SampleBuffer));
+    memset(buf, 0, sizeof(SampleBuffer));
     
     // Calculate capacity: frames for 1.5x duration (headroom)
     int capacity = (int)(durationSeconds * fps * 1.5);
     if (capacity < 100) capacity = 100;
     if (capacity > 100000) capacity = 100000;  // ~27 min at 60fps
     
-    buf->samples = (BufferedSample*)calloc(capacity, sizeof(BufferedSample));
+    buf->samples = (BufferedSample*)MemTracker_Calloc(MEM_TAG_VIDEO_SAMPLES, capacity, sizeof(BufferedSample));
     if (!buf->samples) {
         BufLog("Failed to allocate %d samples\n", capacity);
         return FALSE;
@@ -95,8 +111,9 @@ BOOL SampleBuffer_Init(SampleBuffer* buf, int durationSeconds, int fps,
     buf->height = height;
     buf->fps = fps;
     buf->quality = quality;
+    buf->codec = codec;
     
-    InitializeCriticalSection(&buf->lock);
+    Platform_MutexInit(&buf->lock);
     buf->initialized = TRUE;
     
     BufLog("SampleBuffer_Init: capacity=%d, maxDuration=%llds\n", 
@@ -109,18 +126,18 @@ void SampleBuffer_Shutdown(SampleBuffer* buf) {
     if (!buf) return;
     
     if (buf->initialized) {
-        EnterCriticalSection(&buf->lock);
+        Platform_MutexLock(&buf->lock);
         
         // Free all samples
         for (int i = 0; i < buf->capacity; i++) {
             FreeSample(&buf->samples[i]);
         }
         
-        free(buf->samples);
+        MemTracker_Free(buf->samples);
         buf->samples = NULL;
         
-        LeaveCriticalSection(&buf->lock);
-        DeleteCriticalSection(&buf->lock);
+        Platform_MutexUnlock(&buf->lock);
+        Platform_MutexDestroy(&buf->lock);
     }
     
     buf->initialized = FALSE;
@@ -131,20 +148,32 @@ void SampleBuffer_Shutdown(SampleBuffer* buf) {
 BOOL SampleBuffer_Add(SampleBuffer* buf, EncodedFrame* frame) {
     if (!buf || !buf->initialized || !frame || !frame->data) return FALSE;
     
-    EnterCriticalSection(&buf->lock);
+    Platform_MutexLock(&buf->lock);
     
     // Evict old samples based on timestamp (keeps last maxDuration seconds)
     EvictOldSamples(buf, frame->timestamp);
     
+    // The previous sample lasts until this one starts. With variable frame
+    // rate capture (static content) or dropped ticks this is longer than the
+    // nominal frame duration, and the muxer writes it as-is.
+    if (buf->count > 0) {
+        int prevIdx = (buf->head - 1 + buf->capacity) % buf->capacity;
+        BufferedSample* prev = &buf->samples[prevIdx];
+        if (frame->timestamp > prev->timestamp) {
+            prev->duration = frame->timestamp - prev->timestamp;
+        }
+    }
+    
     // Add to buffer (take ownership of data)
     BufferedSample* slot = &buf->samples[buf->head];
     
     // Free any existing data in slot (shouldn't happen after eviction)
     if (slot->data) {
-        free(slot->data);
+        MemTracker_Free(slot->data);
     }
     
     slot->data = frame->data;
+    MemTracker_Retag(slot->data, MEM_TAG_VIDEO_SAMPLES);
     slot->size = frame->size;
     slot->timestamp = frame->timestamp;
     slot->duration = frame->duration;
@@ -156,16 +185,34 @@ BOOL SampleBuffer_Add(SampleBuffer* buf, EncodedFrame* frame) {
     
     buf->head = (buf->head + 1) % buf->capacity;
     buf->count++;
+    FlightRecorder_SetGauge(FR_GAUGE_VIDEO_SAMPLES, buf->count);
     
-    LeaveCriticalSection(&buf->lock);
+    Platform_MutexUnlock(&buf->lock);
     
     return TRUE;
 }
 
+void SampleBuffer_ExtendLastSample(SampleBuffer* buf, LONGLONG endTimestamp) {
+    if (!buf || !buf->initialized) return;
+    
+    Platform_MutexLock(&buf->lock);
+    
+    if (buf->count > 0) {
+        int newestIdx = (buf->head - 1 + buf->capacity) % buf->capacity;
+        BufferedSample* newest = &buf->samples[newestIdx];
+        LONGLONG span = endTimestamp - newest->timestamp;
+        if (span > newest->duration) {
+            newest->duration = span;
+        }
+    }
+    
+    Platform_MutexUnlock(&buf->lock);
+}
+
 double SampleBuffer_GetDuration(SampleBuffer* buf) {
     if (!buf || !buf->initialized || buf->count == 0) return 0.0;
     
-    EnterCriticalSection(&buf->lock);
+    Platform_MutexLock(&buf->lock);
     
     // Calculate duration from timestamps: newest - oldest
     int newestIdx = (buf->head - 1 + buf->capacity) % buf->capacity;
@@ -174,7 +221,7 @@ double SampleBuffer_GetDuration(SampleBuffer* buf) {
     
     double duration = (double)(newest->timestamp - oldest->timestamp) / 10000000.0;
     
-    LeaveCriticalSection(&buf->lock);
+    Platform_MutexUnlock(&buf->lock);
     
     return duration;
 }
@@ -182,9 +229,9 @@ double SampleBuffer_GetDuration(SampleBuffer* buf) {
 int SampleBuffer_GetCount(SampleBuffer* buf) {
     if (!buf || !buf->initialized) return 0;
     
-    EnterCriticalSection(&buf->lock);
+    Platform_MutexLock(&buf->lock);
     int count = buf->count;
-    LeaveCriticalSection(&buf->lock);
+    Platform_MutexUnlock(&buf->lock);
     
     return count;
 }
@@ -192,7 +239,7 @@ int SampleBuffer_GetCount(SampleBuffer* buf) {
 size_t SampleBuffer_GetMemoryUsage(SampleBuffer* buf) {
     if (!buf || !buf->initialized) return 0;
     
-    EnterCriticalSection(&buf->lock);
+    Platform_MutexLock(&buf->lock);
     
     size_t total = 0;
     int idx = buf->tail;
@@ -201,7 +248,7 @@ size_t SampleBuffer_GetMemoryUsage(SampleBuffer* buf) {
         idx = (idx + 1) % buf->capacity;
     }
     
-    LeaveCriticalSection(&buf->lock);
+    Platform_MutexUnlock(&buf->lock);
     
     return total;
 }
@@ -209,7 +256,7 @@ size_t SampleBuffer_GetMemoryUsage(SampleBuffer* buf) {
 void SampleBuffer_Clear(SampleBuffer* buf) {
     if (!buf || !buf->initialized) return;
     
-    EnterCriticalSection(&buf->lock);
+    Platform_MutexLock(&buf->lock);
     
     for (int i = 0; i < buf->capacity; i++) {
         FreeSample(&buf->samples[i]);
@@ -219,9 +266,11 @@ void SampleBuffer_Clear(SampleBuffer* buf) {
     buf->tail = 0;
     buf->count = 0;
     
-    LeaveCriticalSection(&buf->lock);
+    Platform_MutexUnlock(&buf->lock);
 }
 
+#ifdef _WIN32
+
 // Write buffered samples to MP4 file using muxer module
 // Deep copies all data under lock to prevent use-after-free from eviction,
 // then releases lock before muxing (which can be slow)
@@ -229,11 +278,11 @@ BOOL SampleBuffer_WriteToFile(SampleBuffer* buf, const char* outputPath) {
     if (!buf || !buf->initialized || !outputPath) return FALSE;
     
     BufLog("WriteToFile: entering, getting lock...\n");
-    EnterCriticalSection(&buf->lock);
+    Platform_MutexLock(&buf->lock);
     BufLog("WriteToFile: lock acquired\n");
     
     if (buf->count == 0) {
-        LeaveCriticalSection(&buf->lock);
+        Platform_MutexUnlock(&buf->lock);
         BufLog("WriteToFile: buffer is empty\n");
         return FALSE;
     }
@@ -248,9 +297,9 @@ BOOL SampleBuffer_WriteToFile(SampleBuffer* buf, const char* outputPath) {
     
     // Allocate sample array
     BufLog("WriteToFile: allocating %d samples (%zu bytes)\n", count, count * sizeof(MuxerSample));
-    MuxerSample* samples = (MuxerSample*)malloc(count * sizeof(MuxerSample));
+    MuxerSample* samples = (MuxerSample*)MemTracker_Alloc(MEM_TAG_SAVE, count * sizeof(MuxerSample));
     if (!samples) {
-        LeaveCriticalSection(&buf->lock);
+        Platform_MutexUnlock(&buf->lock);
         BufLog("WriteToFile: failed to allocate samples array\n");
         return FALSE;
     }
@@ -272,7 +321,7 @@ BOOL SampleBuffer_WriteToFile(SampleBuffer* buf, const char* outputPath) {
     for (int i = 0; i < count; i++) {
         BufferedSample* src = &buf->samples[(buf->tail + i) % buf->capacity];
         if (src->data && src->size > 0) {
-            samples[copiedCount].data = (BYTE*)malloc(src->size);
+            samples[copiedCount].data = (BYTE*)MemTracker_Alloc(MEM_TAG_SAVE, src->size);
             if (samples[copiedCount].data) {
                 memcpy(samples[copiedCount].data, src->data, src->size);
                 samples[copiedCount].size = src->size;
@@ -292,11 +341,12 @@ BOOL SampleBuffer_WriteToFile(SampleBuffer* buf, const char* outputPath) {
     config.height = buf->height;
     config.fps = buf->fps;
     config.quality = buf->quality;
+    config.codec = buf->codec;
     config.seqHeader = buf->seqHeaderSize > 0 ? buf->seqHeader : NULL;
     config.seqHeaderSize = buf->seqHeaderSize;
     
     BufLog("WriteToFile: releasing lock, calling muxer...\n");
-    LeaveCriticalSection(&buf->lock);
+    Platform_MutexUnlock(&buf->lock);
     // Lock released! All data is now in our own deep-copied memory
     
     // Mux to file (this can be slow, but we're not holding the lock)
@@ -306,40 +356,65 @@ BOOL SampleBuffer_WriteToFile(SampleBuffer* buf, const char* outputPath) {
     // Free deep-copied sample data
     BufLog("WriteToFile: freeing sample copies...\n");
     for (int i = 0; i < copiedCount; i++) {
-        if (samples[i].data) free(samples[i].data);
+        if (samples[i].data) MemTracker_Free(samples[i].data);
     }
-    free(samples);
+    MemTracker_Free(samples);
     BufLog("WriteToFile: done\n");
     
     return success;
 }
 
-// Get copies of samples for external muxing (caller must free)
+#endif
+
+// Get copies of samples for external muxing (caller releases with MemTracker_Free)
 // Deep copies all data under lock to prevent use-after-free from eviction
-BOOL SampleBuffer_GetSamplesForMuxing(SampleBuffer* buf, MuxerSample** outSamples, int* outCount) {
+BOOL SampleBuffer_GetSamplesForMuxing(SampleBuffer* buf, MuxerSample** outSamples, int* outCount,
+                                      LONGLONG* baseTimestamp) {
+    return SampleBuffer_GetRecentSamplesForMuxing(buf, 0, outSamples, outCount, baseTimestamp);
+}
+
+BOOL SampleBuffer_GetRecentSamplesForMuxing(SampleBuffer* buf, LONGLONG duration, MuxerSample** outSamples,
+                                            int* outCount, LONGLONG* baseTimestamp) {
     if (!buf || !buf->initialized || !outSamples || !outCount) return FALSE;
     
     *outSamples = NULL;
     *outCount = 0;
+    if (baseTimestamp) *baseTimestamp = 0;
     
-    EnterCriticalSection(&buf->lock);
+    Platform_MutexLock(&buf->lock);
     
     int count = buf->count;
     if (count == 0) {
-        LeaveCriticalSection(&buf->lock);
+        Platform_MutexUnlock(&buf->lock);
         return FALSE;
     }
     
+    // Clip start: the newest keyframe at or before (end - duration), so the
+    // clip decodes from its first frame and covers at least 'duration'.
+    // Walks back from the newest sample, so short clips cost little.
+    int first = 0;
+    if (duration > 0) {
+        const BufferedSample* newest = &buf->samples[(buf->tail + count - 1) % buf->capacity];
+        LONGLONG cut = newest->timestamp + newest->duration - duration;
+        for (int i = count - 1; i >= 0; i--) {
+            const BufferedSample* src = &buf->samples[(buf->tail + i) % buf->capacity];
+            if (src->isKeyframe && src->timestamp <= cut) {
+                first = i;
+                break;
+            }
+        }
+    }
+    
     // Allocate output array
-    MuxerSample* samples = (MuxerSample*)malloc(count * sizeof(MuxerSample));
+    MuxerSample* samples = (MuxerSample*)MemTracker_Alloc(MEM_TAG_SAVE, (count - first) * sizeof(MuxerSample));
     if (!samples) {
-        LeaveCriticalSection(&buf->lock);
+        Platform_MutexUnlock(&buf->lock);
         return FALSE;
     }
     
     // Find first timestamp for normalization
     LONGLONG firstTimestamp = 0;
-    for (int i = 0; i < count; i++) {
+    for (int i = first; i < count; i++) {
         BufferedSample* src = &buf->samples[(buf->tail + i) % buf->capacity];
         if (src->data && src->size > 0) {
             firstTimestamp = src->timestamp;
@@ -349,10 +424,10 @@ BOOL SampleBuffer_GetSamplesForMuxing(SampleBuffer* buf, MuxerSample** outSample
     
     // Deep copy all samples while holding lock (prevents use-after-free)
     int copiedCount = 0;
-    for (int i = 0; i < count; i++) {
+    for (int i = first; i < count; i++) {
         BufferedSample* src = &buf->samples[(buf->tail + i) % buf->capacity];
         if (src->data && src->size > 0) {
-            samples[copiedCount].data = (BYTE*)malloc(src->size);
+            samples[copiedCount].data = (BYTE*)MemTracker_Alloc(MEM_TAG_SAVE, src->size);
             if (samples[copiedCount].data) {
                 memcpy(samples[copiedCount].data, src->data, src->size);
                 samples[copiedCount].size = src->size;
@@ -364,19 +439,25 @@ BOOL SampleBuffer_GetSamplesForMuxing(SampleBuffer* buf, MuxerSample** outSample
         }
     }
     
-    LeaveCriticalSection(&buf->lock);
+    Platform_MutexUnlock(&buf->lock);
+    
+    if (copiedCount == 0) {
+        MemTracker_Free(samples);
+        return FALSE;
+    }
     
     *outSamples = samples;
     *outCount = copiedCount;
+    if (baseTimestamp) *baseTimestamp = firstTimestamp;
     return copiedCount > 0;
 }
 
 void SampleBuffer_SetSequenceHeader(SampleBuffer* buf, const BYTE* header, DWORD size) {
     if (!buf || !header || size == 0 || size > sizeof(buf->seqHeader)) return;
     
-    EnterCriticalSection(&buf->lock);
+    Platform_MutexLock(&buf->lock);
     memcpy(buf->seqHeader, header, size);
     buf->seqHeaderSize = size;
-    LeaveCriticalSection(&buf->lock);
+    Platform_MutexUnlock(&buf->lock);
     BufLog("SetSequenceHeader: %u bytes\n", size);
 }
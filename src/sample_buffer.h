@@ -6,8 +6,8 @@
 #ifndef SAMPLE_BUFFER_H
 #define SAMPLE_BUFFER_H
 
-#include <windows.h>
-#include "nvenc_encoder.h"
+#include "platform.h"
+#include "video_encoder.h"
 #include "config.h"
 #include "mp4_muxer.h"
 
@@ -34,18 +34,24 @@ typedef struct {
     int height;                 // Video height
     int fps;                    // Frame rate
     QualityPreset quality;      // Quality preset
+    VideoCodec codec;           // Bitstream format produced by the encoder
     
-    BYTE seqHeader[256];        // HEVC VPS/SPS/PPS sequence header
+    BYTE seqHeader[256];        // Codec parameter sets (Annex-B)
     DWORD seqHeaderSize;        // Sequence header size
     
-    CRITICAL_SECTION lock;      // Thread safety
+    PlatformMutex lock;         // Thread safety
     BOOL initialized;
     
+    // Eviction done by the most recent Add (read under the caller's own
+    // serialization, e.g. from the thread that called Add)
+    int lastEvicted;            // Samples freed
+    int64_t lastEvictNs;        // Time spent freeing them (0 if none)
+    
 } SampleBuffer;
 
 // Initialize buffer for given duration
 BOOL SampleBuffer_Init(SampleBuffer* buf, int durationSeconds, int fps, 
-                        int width, int height, QualityPreset quality);
+                        int width, int height, QualityPreset quality, VideoCodec codec);
 
 // Shutdown and free all resources
 void SampleBuffer_Shutdown(SampleBuffer* buf);
@@ -54,6 +60,11 @@ void SampleBuffer_Shutdown(SampleBuffer* buf);
 // Takes ownership of frame->data, caller should not free it
 BOOL SampleBuffer_Add(SampleBuffer* buf, EncodedFrame* frame);
 
+// Extend the newest sample so it lasts until endTimestamp (100-ns units)
+// Used for variable frame rate capture: unchanged ticks lengthen the previous
+// sample instead of adding a new one. Never shortens a sample.
+void SampleBuffer_ExtendLastSample(SampleBuffer* buf, LONGLONG endTimestamp);
+
 // Get current buffered duration in seconds
 double SampleBuffer_GetDuration(SampleBuffer* buf);
 
@@ -63,13 +74,23 @@ int SampleBuffer_GetCount(SampleBuffer* buf);
 // Get total memory usage in bytes
 size_t SampleBuffer_GetMemoryUsage(SampleBuffer* buf);
 
+#ifdef _WIN32
 // Write all buffered samples to an MP4 file
-// Uses passthrough muxing (no re-encoding)
+// Uses passthrough muxing (no re-encoding, Media Foundation)
 BOOL SampleBuffer_WriteToFile(SampleBuffer* buf, const char* outputPath);
+#endif
+
+// Get copies of samples for external muxing (caller releases the array and
+// each sample's data with MemTracker_Free)
+// Timestamps are rebased to start at 0; baseTimestamp (optional) receives the
+// original timestamp of the first sample, for aligning other streams
+BOOL SampleBuffer_GetSamplesForMuxing(SampleBuffer* buf, MuxerSample** samples, int* count,
+                                      LONGLONG* baseTimestamp);
 
-// Get copies of samples for external muxing (caller must free)
-// Used for audio+video muxing
-BOOL SampleBuffer_GetSamplesForMuxing(SampleBuffer* buf, MuxerSample** samples, int* count);
+// As GetSamplesForMuxing, but only the newest 'duration' (100-ns units, 0 =
+// everything), starting at the keyframe at or before that point
+BOOL SampleBuffer_GetRecentSamplesForMuxing(SampleBuffer* buf, LONGLONG duration, MuxerSample** samples,
+                                            int* count, LONGLONG* baseTimestamp);
 
 // Clear all samples from buffer
 void SampleBuffer_Clear(SampleBuffer* buf);
@@ -0,0 +1,167 @@
+/*
+ * Stream Model Implementation
+ */
+
+#include "stream_model.h"
+#include "video_encoder.h"
+#include "util.h"
+#include <math.h>
+#include <string.h>
+
+#define UNITS_PER_MS 10000LL
+
+// Unchanged ticks still cost a skip-coded frame
+#define SKIP_FRAME_SCALE 0.01
+
+// ============================================================================
+// Random numbers
+// ============================================================================
+
+void StreamRandom_Seed(StreamRandom* rng, uint64_t seed) {
+    // Spread small seeds over the state; the state must never be zero
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    rng->state = z ? z : 1;
+}
+
+uint64_t StreamRandom_Next(StreamRandom* rng) {
+    uint64_t x = rng->state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    rng->state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+double StreamRandom_Uniform(StreamRandom* rng) {
+    return (double)(StreamRandom_Next(rng) >> 11) / 9007199254740992.0;    // 2^53
+}
+
+double StreamRandom_Normal(StreamRandom* rng) {
+    // Box-Muller (one of the pair; simplicity over speed)
+    double u1 = StreamRandom_Uniform(rng);
+    double u2 = StreamRandom_Uniform(rng);
+    if (u1 < 1e-300) u1 = 1e-300;
+    return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+double StreamRandom_LogNormal(StreamRandom* rng, double sigma) {
+    return exp(sigma * StreamRandom_Normal(rng) - sigma * sigma / 2.0);
+}
+
+// ============================================================================
+// Frame sizes
+// ============================================================================
+
+void StreamModel_DefaultConfig(StreamModelConfig* config, int width, int height, int fps,
+                               QualityPreset quality) {
+    memset(config, 0, sizeof(*config));
+    config->width = width;
+    config->height = height;
+    config->fps = fps;
+    config->quality = quality;
+    config->keyframeMs = VIDEO_ENCODER_KEYFRAME_MS;
+    config->keyframeRatio = 6.0;
+    config->sigma = 0.35;
+    config->staticFraction = 0.3;
+    config->staticScale = 0.15;
+    config->staticChangeRate = 0.1;
+    config->sceneMinMs = 2000;
+    config->sceneMaxMs = 20000;
+    config->seed = 1;
+}
+
+void StreamModel_Init(StreamModel* model, const StreamModelConfig* config) {
+    memset(model, 0, sizeof(*model));
+    model->config = *config;
+    if (model->config.fps <= 0) model->config.fps = 60;
+    if (model->config.keyframeMs <= 0) model->config.keyframeMs = VIDEO_ENCODER_KEYFRAME_MS;
+    if (model->config.staticFraction < 0) model->config.staticFraction = 0;
+    if (model->config.staticFraction > 0.95) model->config.staticFraction = 0.95;
+    if (model->config.sceneMaxMs < model->config.sceneMinMs) model->config.sceneMaxMs = model->config.sceneMinMs;
+    StreamRandom_Seed(&model->rng, config->seed);
+
+    model->presetQp = Util_QualityToQP(config->quality);
+    model->qp = model->presetQp;
+    model->keyframeMs = model->config.keyframeMs;
+
+    // Motion content at the preset settings averages the preset bitrate:
+    // one IDR of keyframeRatio P frames per GOP of K frames
+    const StreamModelConfig* c = &model->config;
+    double bytesPerFrame = Util_CalculateBitrate(c->width, c->height, c->fps, c->quality) / 8.0 / c->fps;
+    double gopFrames = (double)c->keyframeMs * c->fps / 1000.0;
+    if (gopFrames < 1) gopFrames = 1;
+    model->motionMean = bytesPerFrame * gopFrames / (c->keyframeRatio + gopFrames - 1);
+}
+
+void StreamModel_SetParams(StreamModel* model, int qp, int keyframeMs) {
+    if (qp > 0) model->qp = qp;
+    if (keyframeMs > 0) {
+        // Takes effect from the current GOP, as an encoder reconfigure does
+        if (model->started) {
+            model->nextKeyframe += (int64_t)(keyframeMs - model->keyframeMs) * UNITS_PER_MS;
+        }
+        model->keyframeMs = keyframeMs;
+    }
+}
+
+static void UpdateScene(StreamModel* model, int64_t timestamp) {
+    const StreamModelConfig* c = &model->config;
+    if (!model->started) {
+        model->started = true;
+        model->sceneStatic = false;
+        model->sceneEnd = timestamp;
+        model->nextKeyframe = timestamp;
+    }
+    while (timestamp >= model->sceneEnd) {
+        int lengthMs = c->sceneMinMs + (int)(StreamRandom_Uniform(&model->rng) * (c->sceneMaxMs - c->sceneMinMs));
+        model->sceneStatic = StreamRandom_Uniform(&model->rng) < c->staticFraction;
+        model->sceneEnd += (int64_t)(lengthMs > 0 ? lengthMs : 1) * UNITS_PER_MS;
+    }
+}
+
+bool StreamModel_ContentChanged(StreamModel* model, int64_t timestamp) {
+    UpdateScene(model, timestamp);
+    if (!model->sceneStatic) return true;
+    return StreamRandom_Uniform(&model->rng) < model->config.staticChangeRate;
+}
+
+static double QpScale(const StreamModel* model) {
+    // ~6 QP per halving of bitrate
+    return pow(2.0, (model->presetQp - model->qp) / 6.0);
+}
+
+uint32_t StreamModel_NextFrame(StreamModel* model, int64_t timestamp, bool changed, bool* isKeyframe) {
+    UpdateScene(model, timestamp);
+    const StreamModelConfig* c = &model->config;
+
+    bool keyframe = timestamp >= model->nextKeyframe;
+    double scale;
+    if (keyframe) {
+        model->nextKeyframe = timestamp + (int64_t)model->keyframeMs * UNITS_PER_MS;
+        scale = c->keyframeRatio;
+    } else if (!changed) {
+        scale = SKIP_FRAME_SCALE;
+    } else {
+        scale = model->sceneStatic ? c->staticScale : 1.0;
+    }
+
+    double size = model->motionMean * scale * QpScale(model) * StreamRandom_LogNormal(&model->rng, c->sigma);
+    if (size < 32) size = 32;   // Slice header and NAL overhead
+    if (size > 64 * 1024 * 1024) size = 64 * 1024 * 1024;
+
+    if (isKeyframe) *isKeyframe = keyframe;
+    return (uint32_t)size;
+}
+
+double StreamModel_ExpectedRate(const StreamModel* model) {
+    const StreamModelConfig* c = &model->config;
+    double keyframesPerSec = 1000.0 / model->keyframeMs;
+    if (keyframesPerSec > c->fps) keyframesPerSec = c->fps;
+    double staticMean = c->staticChangeRate * c->staticScale + (1 - c->staticChangeRate) * SKIP_FRAME_SCALE;
+    double pMean = (1 - c->staticFraction) + c->staticFraction * staticMean;
+    return model->motionMean * QpScale(model) *
+           (keyframesPerSec * c->keyframeRatio + (c->fps - keyframesPerSec) * pMean);
+}
@@ -0,0 +1,102 @@
+/*
+ * Stream Model - Synthetic encoded video for simulations and benchmarks
+ * Portable C; deterministic (seeded), no capture or encoder needed
+ *
+ * Stands in for a constant-QP HEVC encoder when the replay path is
+ * exercised without a GPU:
+ * - IDR frames on the timeline every keyframe interval, several times the
+ *   size of a P frame
+ * - P frame sizes are log-normal around the mean; content alternates
+ *   between motion scenes and near-static ones (desktop, menus) where few
+ *   ticks change and changed frames are tiny
+ * - At the preset QP and keyframe interval the long-run rate matches
+ *   Util_CalculateBitrate; each QP step scales it by 2^(-1/6) and longer
+ *   GOPs lower it, as with the real backends
+ *
+ * The same seed gives the same stream on every platform.
+ */
+
+#ifndef STREAM_MODEL_H
+#define STREAM_MODEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+
+// ============================================================================
+// Random numbers
+// ============================================================================
+
+// xorshift64* generator
+typedef struct {
+    uint64_t state;
+} StreamRandom;
+
+void StreamRandom_Seed(StreamRandom* rng, uint64_t seed);
+uint64_t StreamRandom_Next(StreamRandom* rng);
+
+// Uniform in [0, 1)
+double StreamRandom_Uniform(StreamRandom* rng);
+
+// Standard normal (mean 0, deviation 1)
+double StreamRandom_Normal(StreamRandom* rng);
+
+// Log-normal with mean 1 and log-deviation sigma
+double StreamRandom_LogNormal(StreamRandom* rng, double sigma);
+
+// ============================================================================
+// Frame sizes
+// ============================================================================
+
+typedef struct {
+    int width;
+    int height;
+    int fps;
+    QualityPreset quality;
+    int keyframeMs;             // Preset keyframe interval (VIDEO_ENCODER_KEYFRAME_MS)
+    double keyframeRatio;       // IDR size / mean P frame size
+    double sigma;               // Log-normal spread of frame sizes
+    double staticFraction;      // Share of the timeline in static scenes (0-0.95)
+    double staticScale;         // Changed-frame size in a static scene / motion mean
+    double staticChangeRate;    // Share of static-scene ticks with new content
+    int sceneMinMs;             // Scene length range (uniform)
+    int sceneMaxMs;
+    uint64_t seed;
+} StreamModelConfig;
+
+typedef struct {
+    StreamModelConfig config;
+    StreamRandom rng;
+
+    int qp;                     // Current encoder settings
+    int keyframeMs;
+    int presetQp;
+
+    double motionMean;          // Mean P frame bytes in a motion scene at the preset QP
+    bool sceneStatic;
+    int64_t sceneEnd;           // Timestamp the current scene ends (100-ns units)
+    int64_t nextKeyframe;       // Timestamp at or after which the next frame is an IDR
+    bool started;
+} StreamModel;
+
+// Defaults for a capture profile: HEVC-like GOP and spread, 30% static scenes
+void StreamModel_DefaultConfig(StreamModelConfig* config, int width, int height, int fps,
+                               QualityPreset quality);
+
+void StreamModel_Init(StreamModel* model, const StreamModelConfig* config);
+
+// Apply encoder settings like VideoEncoder_Reconfigure (0 = leave unchanged)
+void StreamModel_SetParams(StreamModel* model, int qp, int keyframeMs);
+
+// Whether the tick at 'timestamp' has new content (always true in motion scenes)
+bool StreamModel_ContentChanged(StreamModel* model, int64_t timestamp);
+
+// Size of the frame encoded at 'timestamp' (100-ns units, increasing).
+// 'changed' is the tick's StreamModel_ContentChanged result: unchanged
+// frames are skip-coded and tiny.
+uint32_t StreamModel_NextFrame(StreamModel* model, int64_t timestamp, bool changed, bool* isKeyframe);
+
+// Long-run video rate at the current settings with every tick encoded (bytes/s)
+double StreamModel_ExpectedRate(const StreamModel* model);
+
+#endif // STREAM_MODEL_H
@@ -0,0 +1,766 @@
+/*
+ * Software Video Encoder Implementation
+ * Media Foundation synchronous encoder MFT driven from a worker thread
+ *
+ * Architecture (mirrors the NVENC backend):
+ * - Capture thread: copies NV12 into a small input ring (non-blocking)
+ * - Worker thread: ProcessInput/ProcessOutput, delivers frames via callback
+ *
+ * The MFT is only touched from the worker thread after creation, since
+ * synchronous MFTs are not required to be thread-safe.
+ */
+
+#include "sw_encoder.h"
+#include "util.h"
+#include "logger.h"
+#include "trace.h"
+#include "flight_recorder.h"
+#include "thread_registry.h"
+#include "mem_tracker.h"
+#include <mfapi.h>
+#include <mftransform.h>
+#include <mferror.h>
+#include <strmif.h>
+#include <process.h>
+#include <stdio.h>
+
+#pragma comment(lib, "mfplat.lib")
+#pragma comment(lib, "mfuuid.lib")
+
+#define SwLog Logger_Log
+
+// HEVC format GUID: {43564548-0000-0010-8000-00AA00389B71}
+static const GUID MFVideoFormat_HEVC_Local =
+    {0x43564548, 0x0000, 0x0010, {0x80, 0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71}};
+
+// Codec API properties (codecapi.h), defined locally to avoid GUID linkage issues
+// CODECAPI_AVEncCommonRateControlMode {1c0608e9-370c-4710-8a58-cb6181c42423}
+static const GUID CODECAPI_RateControlMode_Local =
+    {0x1c0608e9, 0x370c, 0x4710, {0x8a, 0x58, 0xcb, 0x61, 0x81, 0xc4, 0x24, 0x23}};
+// CODECAPI_AVEncVideoEncodeQP {2cb5696b-23fb-4ce1-a0f9-ef5b90fd55ca}
+static const GUID CODECAPI_VideoEncodeQP_Local =
+    {0x2cb5696b, 0x23fb, 0x4ce1, {0xa0, 0xf9, 0xef, 0x5b, 0x90, 0xfd, 0x55, 0xca}};
+// CODECAPI_AVEncMPVGOPSize {95f31b26-95a4-41aa-9303-246a7fc6eef1}
+static const GUID CODECAPI_GOPSize_Local =
+    {0x95f31b26, 0x95a4, 0x41aa, {0x93, 0x03, 0x24, 0x6a, 0x7f, 0xc6, 0xee, 0xf1}};
+// CODECAPI_AVEncMPVDefaultBPictureCount {8d390aac-dc5c-4200-b57f-814d04babab2}
+static const GUID CODECAPI_BPictureCount_Local =
+    {0x8d390aac, 0xdc5c, 0x4200, {0xb5, 0x7f, 0x81, 0x4d, 0x04, 0xba, 0xba, 0xb2}};
+// CODECAPI_AVLowLatencyMode {9c27891a-ed7a-40e1-88e8-b22727a024ee}
+static const GUID CODECAPI_LowLatencyMode_Local =
+    {0x9c27891a, 0xed7a, 0x40e1, {0x88, 0xe8, 0xb2, 0x27, 0x27, 0xa0, 0x24, 0xee}};
+// CODECAPI_AVEncVideoForceKeyFrame {398c1b98-8353-475a-9ef2-8f265d260345}
+static const GUID CODECAPI_ForceKeyFrame_Local =
+    {0x398c1b98, 0x8353, 0x475a, {0x9e, 0xf2, 0x8f, 0x26, 0x5d, 0x26, 0x03, 0x45}};
+
+#define RATE_CONTROL_MODE_QUALITY 3     // eAVEncCommonRateControlMode_Quality
+#define H264_PROFILE_MAIN 77            // eAVEncH264VProfile_Main
+#define H265_PROFILE_MAIN 1             // eAVEncH265VProfile_Main_420_8
+#define SW_ENCODE_DEADLINE_MS 5000     // Drains the whole queue; slow MFTs at 4K take a while
+
+struct SWEncoder {
+    IMFTransform* transform;
+    ICodecAPI* codecApi;            // Optional, used for QP/GOP/keyframe control
+    VideoCodec codec;
+
+    int width;
+    int height;
+    int fps;
+    int qp;
+    QualityPreset quality;
+    LONGLONG frameDuration;        // 100-ns units
+    DWORD frameSize;                // NV12 bytes (tight pitch)
+
+    // Keyframe cadence is timeline-based, same as NVENC
+    LONGLONG keyframeInterval;
+    LONGLONG lastIdrTimestamp;
+
+    // Output buffer negotiation
+    BOOL providesSamples;
+    DWORD outputBufferSize;
+
+    // Input ring (single producer, worker consumes in order)
+    BYTE* inputFrames[SW_NUM_BUFFERS];
+    LONGLONG inputTimestamps[SW_NUM_BUFFERS];
+    int submitIndex;
+    int encodeIndex;
+    volatile LONG pendingCount;
+    FlightRecorderGauge queueGauge;
+
+    // Worker thread
+    HANDLE workerThread;
+    HANDLE frameEvent;              // Auto-reset: frame queued or stop requested
+    volatile BOOL stopThread;       // Exit after queued frames are encoded
+    volatile BOOL discardPending;   // Exit immediately (destroy)
+    BOOL flushed;
+
+    // Parameter changes applied by the worker before its next frame
+    EncoderParams pendingParams;
+    volatile LONG paramsPending;
+
+    // Parameter sets (from output type, or extracted from first keyframe)
+    BYTE seqHeader[256];
+    DWORD seqHeaderSize;
+
+    EncodedFrameCallback frameCallback;
+    void* callbackUserData;
+
+    CRITICAL_SECTION lock;          // Guards submit ring, params and seqHeader
+
+    // Stats (written by worker)
+    uint64_t framesEncoded;
+    double totalEncodeMs;
+    int pipelineFullCount;
+    int processErrorCount;
+
+    BOOL initialized;
+};
+
+static unsigned __stdcall WorkerThreadProc(void* param);
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static void SetCodecApiUINT32(SWEncoder* enc, const GUID* api, ULONG value, const char* name) {
+    if (!enc->codecApi) return;
+    VARIANT var;
+    ZeroMemory(&var, sizeof(var));
+    var.vt = VT_UI4;
+    var.ulVal = value;
+    HRESULT hr = enc->codecApi->lpVtbl->SetValue(enc->codecApi, api, &var);
+    if (FAILED(hr)) {
+        SwLog("SWEncoder: %s not supported (0x%08X)\n", name, hr);
+    }
+}
+
+static void SetCodecApiQP(SWEncoder* enc, int qp) {
+    if (!enc->codecApi) return;
+    VARIANT var;
+    ZeroMemory(&var, sizeof(var));
+    var.vt = VT_UI8;
+    var.ullVal = (ULONGLONG)qp;
+    HRESULT hr = enc->codecApi->lpVtbl->SetValue(enc->codecApi, &CODECAPI_VideoEncodeQP_Local, &var);
+    if (FAILED(hr)) {
+        SwLog("SWEncoder: QP control not supported (0x%08X), using bitrate mode\n", hr);
+    }
+}
+
+// Find a synchronous (software) encoder MFT for NV12 → subtype
+static IMFTransform* FindSoftwareEncoder(const GUID* subtype) {
+    MFT_REGISTER_TYPE_INFO inputInfo = {MFMediaType_Video, MFVideoFormat_NV12};
+    MFT_REGISTER_TYPE_INFO outputInfo;
+    outputInfo.guidMajorType = MFMediaType_Video;
+    outputInfo.guidSubtype = *subtype;
+
+    IMFActivate** activates = NULL;
+    UINT32 count = 0;
+    IMFTransform* transform = NULL;
+
+    // SYNCMFT + SORTANDFILTER excludes hardware (async) encoders
+    HRESULT hr = MFTEnumEx(
+        MFT_CATEGORY_VIDEO_ENCODER,
+        MFT_ENUM_FLAG_SYNCMFT | MFT_ENUM_FLAG_LOCALMFT | MFT_ENUM_FLAG_SORTANDFILTER,
+        &inputInfo,
+        &outputInfo,
+        &activates,
+        &count
+    );
+
+    if (SUCCEEDED(hr) && count > 0) {
+        activates[0]->lpVtbl->ActivateObject(activates[0], &IID_IMFTransform, (void**)&transform);
+        for (UINT32 i = 0; i < count; i++) {
+            activates[i]->lpVtbl->Release(activates[i]);
+        }
+    }
+    if (activates) CoTaskMemFree(activates);
+
+    return transform;
+}
+
+// Copy VPS/SPS/PPS (HEVC) or SPS/PPS (H.264) NAL units out of an Annex-B access unit
+static DWORD ExtractParameterSets(VideoCodec codec, const BYTE* data, DWORD size, BYTE* out, DWORD outSize) {
+    DWORD written = 0;
+    DWORD i = 0;
+
+    while (i + 3 < size) {
+        // Find start code
+        if (!(data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1)) {
+            i++;
+            continue;
+        }
+        DWORD nalStart = i + 3;
+
+        // Find next start code (or end)
+        DWORD j = nalStart;
+        while (j + 2 < size && !(data[j] == 0 && data[j + 1] == 0 && data[j + 2] == 1)) j++;
+        DWORD nalEnd = (j + 2 < size) ? j : size;
+
+        // Trailing zero belongs to a 4-byte start code of the next NAL
+        while (nalEnd > nalStart && data[nalEnd - 1] == 0) nalEnd--;
+
+        if (nalEnd > nalStart) {
+            BYTE header = data[nalStart];
+            BOOL isParamSet;
+            if (codec == VIDEO_CODEC_HEVC) {
+                int type = (header >> 1) & 0x3F;
+                isParamSet = (type >= 32 && type <= 34);
+            } else {
+                int type = header & 0x1F;
+                isParamSet = (type == 7 || type == 8);
+            }
+
+            DWORD nalSize = nalEnd - nalStart;
+            if (isParamSet && written + 4 + nalSize <= outSize) {
+                out[written++] = 0;
+                out[written++] = 0;
+                out[written++] = 0;
+                out[written++] = 1;
+                memcpy(out + written, data + nalStart, nalSize);
+                written += nalSize;
+            }
+        }
+
+        i = nalEnd;
+    }
+
+    return written;
+}
+
+static void RefreshOutputStreamInfo(SWEncoder* enc) {
+    MFT_OUTPUT_STREAM_INFO streamInfo = {0};
+    enc->transform->lpVtbl->GetOutputStreamInfo(enc->transform, 0, &streamInfo);
+    enc->providesSamples = (streamInfo.dwFlags & MFT_OUTPUT_STREAM_PROVIDES_SAMPLES) != 0;
+    enc->outputBufferSize = streamInfo.cbSize > 0 ? streamInfo.cbSize : enc->frameSize;
+}
+
+static IMFMediaType* CreateOutputType(SWEncoder* enc, const GUID* subtype) {
+    IMFMediaType* type = NULL;
+    if (FAILED(MFCreateMediaType(&type))) return NULL;
+
+    // Fallback target for MFTs that ignore the QP codec property
+    UINT32 bitrate = Util_CalculateBitrate(enc->width, enc->height, enc->fps, enc->quality);
+
+    type->lpVtbl->SetGUID(type, &MF_MT_MAJOR_TYPE, &MFMediaType_Video);
+    type->lpVtbl->SetGUID(type, &MF_MT_SUBTYPE, subtype);
+    type->lpVtbl->SetUINT32(type, &MF_MT_AVG_BITRATE, bitrate);
+    type->lpVtbl->SetUINT32(type, &MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive);
+    type->lpVtbl->SetUINT32(type, &MF_MT_MPEG2_PROFILE,
+                            enc->codec == VIDEO_CODEC_HEVC ? H265_PROFILE_MAIN : H264_PROFILE_MAIN);
+    type->lpVtbl->SetUINT64(type, &MF_MT_FRAME_SIZE, ((UINT64)enc->width << 32) | enc->height);
+    type->lpVtbl->SetUINT64(type, &MF_MT_FRAME_RATE, ((UINT64)enc->fps << 32) | 1);
+    type->lpVtbl->SetUINT64(type, &MF_MT_PIXEL_ASPECT_RATIO, ((UINT64)1 << 32) | 1);
+
+    return type;
+}
+
+static IMFMediaType* CreateInputType(SWEncoder* enc) {
+    IMFMediaType* type = NULL;
+    if (FAILED(MFCreateMediaType(&type))) return NULL;
+
+    type->lpVtbl->SetGUID(type, &MF_MT_MAJOR_TYPE, &MFMediaType_Video);
+    type->lpVtbl->SetGUID(type, &MF_MT_SUBTYPE, &MFVideoFormat_NV12);
+    type->lpVtbl->SetUINT32(type, &MF_MT_INTERLACE_MODE, MFVideoInterlace_Progressive);
+    type->lpVtbl->SetUINT64(type, &MF_MT_FRAME_SIZE, ((UINT64)enc->width << 32) | enc->height);
+    type->lpVtbl->SetUINT64(type, &MF_MT_FRAME_RATE, ((UINT64)enc->fps << 32) | 1);
+    type->lpVtbl->SetUINT64(type, &MF_MT_PIXEL_ASPECT_RATIO, ((UINT64)1 << 32) | 1);
+
+    return type;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+SWEncoder* SWEncoder_Create(int width, int height, int fps, QualityPreset quality) {
+    if (width <= 0 || height <= 0 || fps <= 0) {
+        SwLog("SWEncoder: Invalid parameters\n");
+        return NULL;
+    }
+
+    SwLog("Creating SWEncoder (%dx%d @ %d fps, quality=%d)...\n", width, height, fps, quality);
+
+    SWEncoder* enc = (SWEncoder*)calloc(1, sizeof(SWEncoder));
+    if (!enc) return NULL;
+
+    enc->width = width;
+    enc->height = height;
+    enc->fps = fps;
+    enc->qp = Util_QualityToQP(quality);
+    enc->quality = quality;
+    enc->frameDuration = MF_UNITS_PER_SECOND / fps;
+    enc->frameSize = (DWORD)width * height * 3 / 2;
+    enc->keyframeInterval = VIDEO_ENCODER_KEYFRAME_MS * 10000LL;  // IDR every 2 seconds of timeline
+
+    InitializeCriticalSection(&enc->lock);
+
+    // Prefer HEVC (same as NVENC), fall back to the inbox H.264 encoder
+    const GUID* subtype = &MFVideoFormat_HEVC_Local;
+    enc->codec = VIDEO_CODEC_HEVC;
+    enc->transform = FindSoftwareEncoder(subtype);
+    if (!enc->transform) {
+        subtype = &MFVideoFormat_H264;
+        enc->codec = VIDEO_CODEC_H264;
+        enc->transform = FindSoftwareEncoder(subtype);
+    }
+    if (!enc->transform) {
+        SwLog("SWEncoder: No software HEVC or H.264 encoder MFT found\n");
+        goto fail;
+    }
+    SwLog("SWEncoder: Using %s software encoder MFT\n", enc->codec == VIDEO_CODEC_HEVC ? "HEVC" : "H.264");
+
+    // Codec properties must be set before media types on the inbox encoders
+    enc->transform->lpVtbl->QueryInterface(enc->transform, &IID_ICodecAPI, (void**)&enc->codecApi);
+    if (enc->codecApi) {
+        SetCodecApiUINT32(enc, &CODECAPI_RateControlMode_Local, RATE_CONTROL_MODE_QUALITY, "Quality rate control");
+        SetCodecApiQP(enc, enc->qp);
+        SetCodecApiUINT32(enc, &CODECAPI_GOPSize_Local, (ULONG)(fps * 2), "GOP size");
+        SetCodecApiUINT32(enc, &CODECAPI_BPictureCount_Local, 0, "B-frame count");
+
+        VARIANT lowLatency;
+        ZeroMemory(&lowLatency, sizeof(lowLatency));
+        lowLatency.vt = VT_BOOL;
+        lowLatency.boolVal = VARIANT_TRUE;
+        enc->codecApi->lpVtbl->SetValue(enc->codecApi, &CODECAPI_LowLatencyMode_Local, &lowLatency);
+    } else {
+        SwLog("SWEncoder: ICodecAPI unavailable, using MFT defaults\n");
+    }
+
+    // Encoders require the output type before the input type
+    IMFMediaType* outputType = CreateOutputType(enc, subtype);
+    if (!outputType) goto fail;
+    HRESULT hr = enc->transform->lpVtbl->SetOutputType(enc->transform, 0, outputType, 0);
+    outputType->lpVtbl->Release(outputType);
+    if (FAILED(hr)) {
+        SwLog("SWEncoder: SetOutputType failed 0x%08X\n", hr);
+        goto fail;
+    }
+
+    IMFMediaType* inputType = CreateInputType(enc);
+    if (!inputType) goto fail;
+    hr = enc->transform->lpVtbl->SetInputType(enc->transform, 0, inputType, 0);
+    inputType->lpVtbl->Release(inputType);
+    if (FAILED(hr)) {
+        SwLog("SWEncoder: SetInputType (NV12) failed 0x%08X\n", hr);
+        goto fail;
+    }
+
+    RefreshOutputStreamInfo(enc);
+
+    // Parameter sets: most encoders publish them on the output type
+    IMFMediaType* currentType = NULL;
+    if (SUCCEEDED(enc->transform->lpVtbl->GetOutputCurrentType(enc->transform, 0, &currentType))) {
+        UINT32 blobSize = 0;
+        if (SUCCEEDED(currentType->lpVtbl->GetBlobSize(currentType, &MF_MT_MPEG_SEQUENCE_HEADER, &blobSize)) &&
+            blobSize > 0 && blobSize <= sizeof(enc->seqHeader)) {
+            UINT32 got = 0;
+            if (SUCCEEDED(currentType->lpVtbl->GetBlob(currentType, &MF_MT_MPEG_SEQUENCE_HEADER,
+                                                       enc->seqHeader, sizeof(enc->seqHeader), &got))) {
+                enc->seqHeaderSize = got;
+            }
+        }
+        currentType->lpVtbl->Release(currentType);
+    }
+    if (enc->seqHeaderSize == 0) {
+        SwLog("SWEncoder: Sequence header not on output type, will extract from first keyframe\n");
+    }
+
+    // Input ring
+    for (int i = 0; i < SW_NUM_BUFFERS; i++) {
+        enc->inputFrames[i] = (BYTE*)MemTracker_Alloc(MEM_TAG_VIDEO_ENCODER, enc->frameSize);
+        if (!enc->inputFrames[i]) goto fail;
+    }
+
+    enc->transform->lpVtbl->ProcessMessage(enc->transform, MFT_MESSAGE_NOTIFY_BEGIN_STREAMING, 0);
+    enc->transform->lpVtbl->ProcessMessage(enc->transform, MFT_MESSAGE_NOTIFY_START_OF_STREAM, 0);
+
+    enc->frameEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (!enc->frameEvent) goto fail;
+
+    enc->workerThread = (HANDLE)_beginthreadex(NULL, 0, WorkerThreadProc, enc, 0, NULL);
+    if (!enc->workerThread) {
+        SwLog("SWEncoder: Failed to create worker thread\n");
+        goto fail;
+    }
+
+    enc->initialized = TRUE;
+    SwLog("SWEncoder: Ready (QP=%d, %d buffers)\n", enc->qp, SW_NUM_BUFFERS);
+    return enc;
+
+fail:
+    SWEncoder_Destroy(enc);
+    return NULL;
+}
+
+VideoCodec SWEncoder_GetCodec(SWEncoder* enc) {
+    return enc ? enc->codec : VIDEO_CODEC_HEVC;
+}
+
+void SWEncoder_SetCallback(SWEncoder* enc, EncodedFrameCallback callback, void* userData) {
+    if (!enc) return;
+    enc->frameCallback = callback;
+    enc->callbackUserData = userData;
+}
+
+void SWEncoder_SetQueueGauge(SWEncoder* enc, FlightRecorderGauge gauge) {
+    if (!enc) return;
+    enc->queueGauge = gauge;
+}
+
+BOOL SWEncoder_SubmitNV12(SWEncoder* enc, const BYTE* yPlane, int yPitch,
+                          const BYTE* uvPlane, int uvPitch, LONGLONG timestamp) {
+    if (!enc || !enc->initialized || enc->flushed || !yPlane || !uvPlane) return FALSE;
+
+    EnterCriticalSection(&enc->lock);
+
+    // Worker still busy with every queued frame - drop rather than block capture
+    if (enc->pendingCount >= SW_NUM_BUFFERS) {
+        enc->pipelineFullCount++;
+        if (enc->pipelineFullCount <= 5 || (enc->pipelineFullCount % 300) == 0) {
+            SwLog("SWEncoder: Pipeline full, dropping frame (count=%d)\n", enc->pipelineFullCount);
+        }
+        LeaveCriticalSection(&enc->lock);
+        return FALSE;
+    }
+
+    int idx = enc->submitIndex;
+    BYTE* dst = enc->inputFrames[idx];
+
+    // Repack to tight pitch
+    for (int y = 0; y < enc->height; y++) {
+        memcpy(dst + (size_t)y * enc->width, yPlane + (size_t)y * yPitch, enc->width);
+    }
+    dst += (size_t)enc->width * enc->height;
+    for (int y = 0; y < enc->height / 2; y++) {
+        memcpy(dst + (size_t)y * enc->width, uvPlane + (size_t)y * uvPitch, enc->width);
+    }
+
+    enc->inputTimestamps[idx] = timestamp;
+    enc->submitIndex = (enc->submitIndex + 1) % SW_NUM_BUFFERS;
+    FlightRecorder_SetGauge(enc->queueGauge, InterlockedIncrement(&enc->pendingCount));
+
+    LeaveCriticalSection(&enc->lock);
+
+    SetEvent(enc->frameEvent);
+    return TRUE;
+}
+
+BOOL SWEncoder_GetSequenceHeader(SWEncoder* enc, BYTE* buffer, DWORD bufferSize, DWORD* outSize) {
+    if (!enc || !buffer || !outSize) return FALSE;
+
+    EnterCriticalSection(&enc->lock);
+    BOOL ok = (enc->seqHeaderSize > 0 && enc->seqHeaderSize <= bufferSize);
+    if (ok) {
+        memcpy(buffer, enc->seqHeader, enc->seqHeaderSize);
+        *outSize = enc->seqHeaderSize;
+    }
+    LeaveCriticalSection(&enc->lock);
+
+    return ok;
+}
+
+BOOL SWEncoder_Reconfigure(SWEncoder* enc, const EncoderParams* params) {
+    if (!enc || !enc->initialized || !params) return FALSE;
+
+    // QP/GOP changes need the codec API; the timeline keyframe interval does not
+    if (params->qp > 0 && !enc->codecApi) return FALSE;
+
+    EnterCriticalSection(&enc->lock);
+    enc->pendingParams = *params;
+    LeaveCriticalSection(&enc->lock);
+    InterlockedExchange(&enc->paramsPending, 1);
+
+    return TRUE;
+}
+
+void SWEncoder_GetStats(SWEncoder* enc, int* framesEncoded, double* avgEncodeTimeMs) {
+    if (!enc) return;
+    if (framesEncoded) *framesEncoded = (int)enc->framesEncoded;
+    if (avgEncodeTimeMs) {
+        *avgEncodeTimeMs = enc->framesEncoded > 0 ? enc->totalEncodeMs / (double)enc->framesEncoded : 0.0;
+    }
+}
+
+BOOL SWEncoder_Flush(SWEncoder* enc, EncodedFrame* outFrame) {
+    if (outFrame) memset(outFrame, 0, sizeof(*outFrame));
+    if (!enc || !enc->initialized || enc->flushed) return FALSE;
+
+    enc->flushed = TRUE;
+
+    // Let the worker finish queued frames and drain the MFT, then exit
+    if (enc->workerThread) {
+        enc->stopThread = TRUE;
+        SetEvent(enc->frameEvent);
+        if (WaitForSingleObject(enc->workerThread, 10000) != WAIT_OBJECT_0) {
+            // Still inside the MFT; Destroy decides whether it can be freed
+            SwLog("SWEncoder: worker did not finish flushing within 10s\n");
+            return FALSE;
+        }
+        CloseHandle(enc->workerThread);
+        enc->workerThread = NULL;
+    }
+
+    return FALSE;
+}
+
+void SWEncoder_Destroy(SWEncoder* enc) {
+    if (!enc) return;
+
+    SwLog("SWEncoder: Destroy (%llu frames)\n", enc->framesEncoded);
+
+    if (enc->workerThread) {
+        enc->discardPending = TRUE;
+        enc->stopThread = TRUE;
+        SetEvent(enc->frameEvent);
+        if (WaitForSingleObject(enc->workerThread, 5000) != WAIT_OBJECT_0) {
+            // The worker may still be in ProcessInput/ProcessOutput and uses
+            // 'enc' throughout: leak the encoder rather than free it under it
+            // Detach the callback so a late frame can't reach the owner's
+            // next session
+            SwLog("SWEncoder: worker still running after 5s, leaking encoder\n");
+            enc->frameCallback = NULL;
+            return;
+        }
+        CloseHandle(enc->workerThread);
+        enc->workerThread = NULL;
+    }
+
+    if (enc->codecApi) {
+        enc->codecApi->lpVtbl->Release(enc->codecApi);
+        enc->codecApi = NULL;
+    }
+    if (enc->transform) {
+        enc->transform->lpVtbl->ProcessMessage(enc->transform, MFT_MESSAGE_NOTIFY_END_STREAMING, 0);
+        enc->transform->lpVtbl->Release(enc->transform);
+        enc->transform = NULL;
+    }
+
+    for (int i = 0; i < SW_NUM_BUFFERS; i++) {
+        if (enc->inputFrames[i]) MemTracker_Free(enc->inputFrames[i]);
+    }
+    if (enc->frameEvent) CloseHandle(enc->frameEvent);
+
+    DeleteCriticalSection(&enc->lock);
+    free(enc);
+}
+
+// ============================================================================
+// Worker Thread
+// ============================================================================
+
+static void DeliverSample(SWEncoder* enc, IMFSample* sample) {
+    IMFMediaBuffer* buffer = NULL;
+    if (FAILED(sample->lpVtbl->ConvertToContiguousBuffer(sample, &buffer))) return;
+
+    BYTE* data = NULL;
+    DWORD dataLen = 0;
+    if (FAILED(buffer->lpVtbl->Lock(buffer, &data, NULL, &dataLen)) || !data || dataLen == 0) {
+        buffer->lpVtbl->Release(buffer);
+        return;
+    }
+
+    UINT32 cleanPoint = 0;
+    sample->lpVtbl->GetUINT32(sample, &MFSampleExtension_CleanPoint, &cleanPoint);
+    LONGLONG sampleTime = 0;
+    sample->lpVtbl->GetSampleTime(sample, &sampleTime);
+
+    // Capture parameter sets from the first keyframe if the type didn't carry them
+    if (cleanPoint && enc->seqHeaderSize == 0) {
+        EnterCriticalSection(&enc->lock);
+        enc->seqHeaderSize = ExtractParameterSets(enc->codec, data, dataLen,
+                                                  enc->seqHeader, sizeof(enc->seqHeader));
+        LeaveCriticalSection(&enc->lock);
+        SwLog("SWEncoder: Sequence header extracted from keyframe (%u bytes)\n", enc->seqHeaderSize);
+    }
+
+    EncodedFrame frame = {0};
+    frame.data = (BYTE*)MemTracker_Alloc(MEM_TAG_VIDEO_ENCODER, dataLen);
+    if (frame.data) {
+        memcpy(frame.data, data, dataLen);
+        frame.size = dataLen;
+        frame.timestamp = sampleTime;
+        frame.duration = enc->frameDuration;
+        frame.isKeyframe = cleanPoint ? TRUE : FALSE;
+    }
+
+    buffer->lpVtbl->Unlock(buffer);
+    buffer->lpVtbl->Release(buffer);
+
+    if (frame.data && enc->frameCallback) {
+        enc->frameCallback(&frame, enc->callbackUserData);
+    }
+    if (frame.data) MemTracker_Free(frame.data);  // Callback did not take ownership
+}
+
+static void ProcessOutputs(SWEncoder* enc) {
+    while (1) {
+        MFT_OUTPUT_DATA_BUFFER output = {0};
+        DWORD status = 0;
+        IMFSample* ownSample = NULL;
+        IMFMediaBuffer* ownBuffer = NULL;
+
+        if (!enc->providesSamples) {
+            if (FAILED(MFCreateSample(&ownSample))) break;
+            if (FAILED(MFCreateMemoryBuffer(enc->outputBufferSize, &ownBuffer))) {
+                ownSample->lpVtbl->Release(ownSample);
+                break;
+            }
+            ownSample->lpVtbl->AddBuffer(ownSample, ownBuffer);
+            output.pSample = ownSample;
+        }
+        output.dwStreamID = 0;
+
+        HRESULT hr = enc->transform->lpVtbl->ProcessOutput(enc->transform, 0, 1, &output, &status);
+
+        if (SUCCEEDED(hr) && output.pSample) {
+            DeliverSample(enc, output.pSample);
+        }
+
+        if (output.pEvents) output.pEvents->lpVtbl->Release(output.pEvents);
+        if (enc->providesSamples && output.pSample) output.pSample->lpVtbl->Release(output.pSample);
+        if (ownSample) ownSample->lpVtbl->Release(ownSample);
+        if (ownBuffer) ownBuffer->lpVtbl->Release(ownBuffer);
+
+        if (hr == MF_E_TRANSFORM_STREAM_CHANGE) {
+            // Encoder changed its output type - accept the first available one
+            IMFMediaType* newType = NULL;
+            if (SUCCEEDED(enc->transform->lpVtbl->GetOutputAvailableType(enc->transform, 0, 0, &newType))) {
+                enc->transform->lpVtbl->SetOutputType(enc->transform, 0, newType, 0);
+                newType->lpVtbl->Release(newType);
+            }
+            RefreshOutputStreamInfo(enc);
+            continue;
+        }
+
+        if (hr == MF_E_TRANSFORM_NEED_MORE_INPUT) break;
+
+        if (FAILED(hr)) {
+            if (++enc->processErrorCount <= 5) {
+                SwLog("SWEncoder: ProcessOutput failed 0x%08X\n", hr);
+            }
+            break;
+        }
+    }
+}
+
+static void ApplyPendingParams(SWEncoder* enc) {
+    if (!InterlockedExchange(&enc->paramsPending, 0)) return;
+
+    EnterCriticalSection(&enc->lock);
+    EncoderParams params = enc->pendingParams;
+    LeaveCriticalSection(&enc->lock);
+
+    if (params.qp > 0) {
+        enc->qp = params.qp > 51 ? 51 : params.qp;
+        SetCodecApiQP(enc, enc->qp);
+    }
+    if (params.keyframeIntervalMs > 0) {
+        enc->keyframeInterval = (LONGLONG)params.keyframeIntervalMs * 10000LL;
+        ULONG gop = (ULONG)((LONGLONG)enc->fps * params.keyframeIntervalMs / 1000);
+        SetCodecApiUINT32(enc, &CODECAPI_GOPSize_Local, gop > 0 ? gop : 1, "GOP size");
+    }
+
+    SwLog("SWEncoder: Reconfigured (QP=%d, keyframe every %lldms)\n",
+          enc->qp, enc->keyframeInterval / 10000LL);
+}
+
+static void EncodeFrame(SWEncoder* enc, const BYTE* nv12, LONGLONG timestamp) {
+    LARGE_INTEGER freq, t0, t1;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t0);
+
+    // Timeline-based IDR, same cadence rule as NVENC
+    if (enc->framesEncoded == 0 || timestamp - enc->lastIdrTimestamp >= enc->keyframeInterval) {
+        SetCodecApiUINT32(enc, &CODECAPI_ForceKeyFrame_Local, 1, "Force keyframe");
+        enc->lastIdrTimestamp = timestamp;
+    }
+
+    IMFSample* sample = NULL;
+    IMFMediaBuffer* buffer = NULL;
+    if (FAILED(MFCreateSample(&sample))) return;
+    if (FAILED(MFCreateMemoryBuffer(enc->frameSize, &buffer))) {
+        sample->lpVtbl->Release(sample);
+        return;
+    }
+
+    BYTE* bufData = NULL;
+    buffer->lpVtbl->Lock(buffer, &bufData, NULL, NULL);
+    memcpy(bufData, nv12, enc->frameSize);
+    buffer->lpVtbl->Unlock(buffer);
+    buffer->lpVtbl->SetCurrentLength(buffer, enc->frameSize);
+
+    sample->lpVtbl->AddBuffer(sample, buffer);
+    sample->lpVtbl->SetSampleTime(sample, timestamp);
+    sample->lpVtbl->SetSampleDuration(sample, enc->frameDuration);
+
+    HRESULT hr = enc->transform->lpVtbl->ProcessInput(enc->transform, 0, sample, 0);
+    if (hr == MF_E_NOTACCEPTING) {
+        // Output pending - collect it and retry once
+        ProcessOutputs(enc);
+        hr = enc->transform->lpVtbl->ProcessInput(enc->transform, 0, sample, 0);
+    }
+
+    buffer->lpVtbl->Release(buffer);
+    sample->lpVtbl->Release(sample);
+
+    if (FAILED(hr)) {
+        if (++enc->processErrorCount <= 5) {
+            SwLog("SWEncoder: ProcessInput failed 0x%08X\n", hr);
+        }
+        return;
+    }
+
+    ProcessOutputs(enc);
+
+    QueryPerformanceCounter(&t1);
+    enc->totalEncodeMs += (double)(t1.QuadPart - t0.QuadPart) * 1000.0 / freq.QuadPart;
+    enc->framesEncoded++;
+}
+
+static unsigned __stdcall WorkerThreadProc(void* param) {
+    SWEncoder* enc = (SWEncoder*)param;
+
+    HRESULT hrCom = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    SwLog("SWEncoder: Worker thread started\n");
+    Trace_SetThreadName("SW encoder");
+    FlightRecorder_RegisterThread("SW encoder");
+    ThreadRegistry_Register("SW encoder", THREAD_ROLE_ENCODER_OUTPUT);
+
+    while (1) {
+        FlightRecorder_SetStage("wait", FR_NO_DEADLINE);
+        WaitForSingleObject(enc->frameEvent, 100);
+        FlightRecorder_SetStage("encode", SW_ENCODE_DEADLINE_MS);
+
+        if (enc->discardPending) break;
+
+        while (InterlockedCompareExchange(&enc->pendingCount, 0, 0) > 0 && !enc->discardPending) {
+            ApplyPendingParams(enc);
+
+            int idx = enc->encodeIndex;
+            TRACE_BEGIN(TRACE_ENCODE, enc->inputTimestamps[idx]);
+            EncodeFrame(enc, enc->inputFrames[idx], enc->inputTimestamps[idx]);
+            TRACE_END(TRACE_ENCODE, enc->inputTimestamps[idx]);
+
+            enc->encodeIndex = (enc->encodeIndex + 1) % SW_NUM_BUFFERS;
+            FlightRecorder_SetGauge(enc->queueGauge, InterlockedDecrement(&enc->pendingCount));
+        }
+
+        if (enc->stopThread) {
+            if (!enc->discardPending) {
+                // Flush: push out anything the MFT is still holding
+                enc->transform->lpVtbl->ProcessMessage(enc->transform, MFT_MESSAGE_NOTIFY_END_OF_STREAM, 0);
+                enc->transform->lpVtbl->ProcessMessage(enc->transform, MFT_MESSAGE_COMMAND_DRAIN, 0);
+                ProcessOutputs(enc);
+            }
+            break;
+        }
+    }
+
+    SwLog("SWEncoder: Worker thread exiting (%llu frames, avg %.2fms)\n", enc->framesEncoded,
+          enc->framesEncoded > 0 ? enc->totalEncodeMs / (double)enc->framesEncoded : 0.0);
+    if (SUCCEEDED(hrCom)) CoUninitialize();
+    Trace_ReleaseThread();
+    FlightRecorder_ReleaseThread();
+    ThreadRegistry_Unregister();
+    return 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * Software Video Encoder - Media Foundation encoder MFT on the CPU
+ * HEVC when a software HEVC MFT is installed, otherwise H.264 (always present)
+ * Fed with system-memory NV12; encodes on its own worker thread
+ */
+
+#ifndef SW_ENCODER_H
+#define SW_ENCODER_H
+
+#include <windows.h>
+#include "config.h"
+#include "video_encoder.h"
+
+// Input frames queued ahead of the worker
+#define SW_NUM_BUFFERS 4
+
+typedef struct SWEncoder SWEncoder;
+
+// Create encoder (no GPU required)
+SWEncoder* SWEncoder_Create(int width, int height, int fps, QualityPreset quality);
+
+// Codec selected at creation
+VideoCodec SWEncoder_GetCodec(SWEncoder* enc);
+
+// Set callback for completed frames (called from the worker thread)
+void SWEncoder_SetCallback(SWEncoder* enc, EncodedFrameCallback callback, void* userData);
+void SWEncoder_SetQueueGauge(SWEncoder* enc, FlightRecorderGauge gauge);
+
+// Queue an NV12 frame (copied; returns FALSE if the worker is still busy with
+// all queued frames, so the caller drops the frame instead of blocking)
+BOOL SWEncoder_SubmitNV12(SWEncoder* enc, const BYTE* yPlane, int yPitch,
+                          const BYTE* uvPlane, int uvPitch, LONGLONG timestamp);
+
+// Encode queued frames, drain the MFT and stop the worker.
+// Remaining frames are delivered via callback; always returns FALSE.
+BOOL SWEncoder_Flush(SWEncoder* enc, EncodedFrame* outFrame);
+
+// Get parameter sets (Annex-B). Available after creation on most MFTs,
+// otherwise after the first keyframe has been encoded.
+BOOL SWEncoder_GetSequenceHeader(SWEncoder* enc, BYTE* buffer, DWORD bufferSize, DWORD* outSize);
+
+// Change QP / keyframe interval (applied before the next encoded frame)
+BOOL SWEncoder_Reconfigure(SWEncoder* enc, const EncoderParams* params);
+
+// Stats
+void SWEncoder_GetStats(SWEncoder* enc, int* framesEncoded, double* avgEncodeTimeMs);
+
+// Cleanup
+void SWEncoder_Destroy(SWEncoder* enc);
+
+#endif // SW_ENCODER_H
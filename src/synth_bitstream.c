@@ -0,0 +1,532 @@
+/*
+ * Synth Bitstream Implementation
+ */
+
+#include "synth_bitstream.h"
+#include <string.h>
+
+// NAL unit types (H.265 table 7-1)
+#define HEVC_NAL_TRAIL_R    1
+#define HEVC_NAL_IDR_W_RADL 19
+#define HEVC_NAL_VPS        32
+#define HEVC_NAL_SPS        33
+#define HEVC_NAL_PPS        34
+
+#define HEVC_SLICE_P 1
+#define HEVC_SLICE_I 2
+
+// 8-bit POC LSBs (log2_max_pic_order_cnt_lsb_minus4 = 4)
+#define HEVC_POC_LSB_BITS 8
+
+// Syntactic element IDs (ISO 14496-3 table 4.85)
+#define AAC_ID_SCE 0
+#define AAC_ID_CPE 1
+#define AAC_ID_FIL 6
+#define AAC_ID_END 7
+
+// Silent single_channel_element / channel_pair_element, in bits
+#define AAC_SCE_BITS (3 + 4 + 22)
+#define AAC_CPE_BITS (3 + 4 + 1 + 22 + 22)
+
+// fill_element: id + count (7 bits), esc_count when count is 15 (8 more),
+// then up to 15 + 255 - 1 bytes
+#define AAC_FILL_MIN_BITS 7
+#define AAC_FILL_MAX_BYTES 269
+#define AAC_FILL_MAX_BITS (15 + 8 * AAC_FILL_MAX_BYTES)
+
+#define MAX_HEADER_BYTES 64
+
+// ============================================================================
+// Bit writer
+// ============================================================================
+
+typedef struct {
+    uint8_t* data;
+    uint32_t capacity;          // Bytes
+    uint32_t bits;              // Bits written
+    bool overflow;
+} BitWriter;
+
+static void Bits_Init(BitWriter* bw, uint8_t* data, uint32_t capacity) {
+    bw->data = data;
+    bw->capacity = capacity;
+    bw->bits = 0;
+    bw->overflow = false;
+    memset(data, 0, capacity);
+}
+
+static void Bits_Put(BitWriter* bw, uint32_t value, int count) {
+    for (int i = count - 1; i >= 0; i--) {
+        uint32_t byte = bw->bits >> 3;
+        if (byte >= bw->capacity) {
+            bw->overflow = true;
+            return;
+        }
+        if ((value >> i) & 1) bw->data[byte] |= (uint8_t)(0x80 >> (bw->bits & 7));
+        bw->bits++;
+    }
+}
+
+// Exp-Golomb ue(v), values below 2^31
+static void Bits_PutUE(BitWriter* bw, uint32_t value) {
+    uint32_t code = value + 1;
+    int length = 0;
+    while ((code >> length) > 1) length++;
+    Bits_Put(bw, 0, length);
+    Bits_Put(bw, code, length + 1);
+}
+
+// Exp-Golomb se(v)
+static void Bits_PutSE(BitWriter* bw, int value) {
+    Bits_PutUE(bw, value > 0 ? (uint32_t)value * 2 - 1 : (uint32_t)(-value) * 2);
+}
+
+static void Bits_AlignZero(BitWriter* bw) {
+    while (bw->bits & 7) Bits_Put(bw, 0, 1);
+}
+
+// rbsp_trailing_bits (also the slice header's byte_alignment)
+static void Bits_Trailing(BitWriter* bw) {
+    Bits_Put(bw, 1, 1);
+    Bits_AlignZero(bw);
+}
+
+static uint32_t Bits_Bytes(const BitWriter* bw) {
+    return (bw->bits + 7) >> 3;
+}
+
+// ============================================================================
+// HEVC NAL units
+// ============================================================================
+
+static void PutNalHeader(BitWriter* bw, int type) {
+    Bits_Put(bw, 0, 1);             // forbidden_zero_bit
+    Bits_Put(bw, type, 6);
+    Bits_Put(bw, 0, 6);             // nuh_layer_id
+    Bits_Put(bw, 1, 3);             // nuh_temporal_id_plus1
+}
+
+// Start code plus the RBSP with emulation prevention bytes inserted.
+// Returns bytes written, 0 if they don't fit.
+static uint32_t WriteNal(const uint8_t* rbsp, uint32_t size, uint8_t* out, uint32_t capacity) {
+    if (capacity < 4) return 0;
+    out[0] = 0;
+    out[1] = 0;
+    out[2] = 0;
+    out[3] = 1;
+    uint32_t pos = 4;
+    int zeros = 0;
+    for (uint32_t i = 0; i < size; i++) {
+        if (zeros >= 2 && rbsp[i] <= 3) {
+            if (pos >= capacity) return 0;
+            out[pos++] = 3;
+            zeros = 0;
+        }
+        if (pos >= capacity) return 0;
+        out[pos++] = rbsp[i];
+        zeros = rbsp[i] == 0 ? zeros + 1 : 0;
+    }
+    return pos;
+}
+
+// Lowest Main-tier level whose picture size and luma rate cover the profile
+static int LevelIdc(int width, int height, int fps) {
+    static const struct { int idc; int64_t maxLumaPs; int64_t maxLumaSr; } levels[] = {
+        {  30,    36864,     552960LL }, {  60,   122880,    3686400LL },
+        {  63,   245760,    7372800LL }, {  90,   552960,   16588800LL },
+        {  93,   983040,   33177600LL }, { 120,  2228224,   66846720LL },
+        { 123,  2228224,  133693440LL }, { 150,  8912896,  267386880LL },
+        { 153,  8912896,  534773760LL }, { 156,  8912896, 1069547520LL },
+        { 180, 35651584, 1069547520LL }, { 183, 35651584, 2139095040LL },
+    };
+    int64_t ps = (int64_t)width * height;
+    int64_t sr = ps * fps;
+    for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+        if (ps <= levels[i].maxLumaPs && sr <= levels[i].maxLumaSr) return levels[i].idc;
+    }
+    return 186;     // 6.2
+}
+
+static void PutProfileTierLevel(BitWriter* bw, int levelIdc) {
+    Bits_Put(bw, 0, 2);             // general_profile_space
+    Bits_Put(bw, 0, 1);             // general_tier_flag (Main)
+    Bits_Put(bw, 1, 5);             // general_profile_idc (Main)
+    Bits_Put(bw, 0x60000000, 32);   // compatible with Main and Main 10
+    Bits_Put(bw, 1, 1);             // general_progressive_source_flag
+    Bits_Put(bw, 0, 1);             // general_interlaced_source_flag
+    Bits_Put(bw, 0, 1);             // general_non_packed_constraint_flag
+    Bits_Put(bw, 1, 1);             // general_frame_only_constraint_flag
+    Bits_Put(bw, 0, 32);            // 43 reserved bits + general_inbld_flag
+    Bits_Put(bw, 0, 12);
+    Bits_Put(bw, levelIdc, 8);
+}
+
+// One picture in the DPB besides the current, no reordering
+static void PutSubLayerOrdering(BitWriter* bw) {
+    Bits_Put(bw, 1, 1);             // sub_layer_ordering_info_present_flag
+    Bits_PutUE(bw, 1);              // max_dec_pic_buffering_minus1
+    Bits_PutUE(bw, 0);              // max_num_reorder_pics
+    Bits_PutUE(bw, 0);              // max_latency_increase_plus1
+}
+
+static uint32_t WriteVps(const SynthHevcConfig* c, uint8_t* out, uint32_t capacity) {
+    uint8_t rbsp[MAX_HEADER_BYTES];
+    BitWriter bw;
+    Bits_Init(&bw, rbsp, sizeof(rbsp));
+
+    PutNalHeader(&bw, HEVC_NAL_VPS);
+    Bits_Put(&bw, 0, 4);            // vps_video_parameter_set_id
+    Bits_Put(&bw, 1, 1);            // vps_base_layer_internal_flag
+    Bits_Put(&bw, 1, 1);            // vps_base_layer_available_flag
+    Bits_Put(&bw, 0, 6);            // vps_max_layers_minus1
+    Bits_Put(&bw, 0, 3);            // vps_max_sub_layers_minus1
+    Bits_Put(&bw, 1, 1);            // vps_temporal_id_nesting_flag
+    Bits_Put(&bw, 0xFFFF, 16);      // vps_reserved_0xffff_16bits
+    PutProfileTierLevel(&bw, LevelIdc(c->width, c->height, c->fps));
+    PutSubLayerOrdering(&bw);
+    Bits_Put(&bw, 0, 6);            // vps_max_layer_id
+    Bits_PutUE(&bw, 0);             // vps_num_layer_sets_minus1
+    Bits_Put(&bw, 0, 1);            // vps_timing_info_present_flag (in the SPS VUI)
+    Bits_Put(&bw, 0, 1);            // vps_extension_flag
+    Bits_Trailing(&bw);
+
+    return bw.overflow ? 0 : WriteNal(rbsp, Bits_Bytes(&bw), out, capacity);
+}
+
+static uint32_t WriteSps(const SynthHevcConfig* c, uint8_t* out, uint32_t capacity) {
+    uint8_t rbsp[MAX_HEADER_BYTES];
+    BitWriter bw;
+    Bits_Init(&bw, rbsp, sizeof(rbsp));
+
+    // Coded size on the minimum coding block grid (8), cropped back
+    int codedWidth = (c->width + 7) & ~7;
+    int codedHeight = (c->height + 7) & ~7;
+    bool crop = codedWidth != c->width || codedHeight != c->height;
+
+    PutNalHeader(&bw, HEVC_NAL_SPS);
+    Bits_Put(&bw, 0, 4);            // sps_video_parameter_set_id
+    Bits_Put(&bw, 0, 3);            // sps_max_sub_layers_minus1
+    Bits_Put(&bw, 1, 1);            // sps_temporal_id_nesting_flag
+    PutProfileTierLevel(&bw, LevelIdc(c->width, c->height, c->fps));
+    Bits_PutUE(&bw, 0);             // sps_seq_parameter_set_id
+    Bits_PutUE(&bw, 1);             // chroma_format_idc (4:2:0)
+    Bits_PutUE(&bw, codedWidth);
+    Bits_PutUE(&bw, codedHeight);
+    Bits_Put(&bw, crop, 1);         // conformance_window_flag
+    if (crop) {
+        // Offsets in chroma samples
+        Bits_PutUE(&bw, 0);
+        Bits_PutUE(&bw, (codedWidth - c->width) / 2);
+        Bits_PutUE(&bw, 0);
+        Bits_PutUE(&bw, (codedHeight - c->height) / 2);
+    }
+    Bits_PutUE(&bw, 0);             // bit_depth_luma_minus8
+    Bits_PutUE(&bw, 0);             // bit_depth_chroma_minus8
+    Bits_PutUE(&bw, HEVC_POC_LSB_BITS - 4);
+    PutSubLayerOrdering(&bw);
+    Bits_PutUE(&bw, 0);             // log2_min_luma_coding_block_size_minus3 (8)
+    Bits_PutUE(&bw, 3);             // log2_diff_max_min_luma_coding_block_size (64)
+    Bits_PutUE(&bw, 0);             // log2_min_luma_transform_block_size_minus2 (4)
+    Bits_PutUE(&bw, 3);             // log2_diff_max_min_luma_transform_block_size (32)
+    Bits_PutUE(&bw, 1);             // max_transform_hierarchy_depth_inter
+    Bits_PutUE(&bw, 1);             // max_transform_hierarchy_depth_intra
+    Bits_Put(&bw, 0, 1);            // scaling_list_enabled_flag
+    Bits_Put(&bw, 0, 1);            // amp_enabled_flag
+    Bits_Put(&bw, 0, 1);            // sample_adaptive_offset_enabled_flag
+    Bits_Put(&bw, 0, 1);            // pcm_enabled_flag
+
+    // One short-term RPS: the previous picture
+    Bits_PutUE(&bw, 1);             // num_short_term_ref_pic_sets
+    Bits_PutUE(&bw, 1);             // num_negative_pics
+    Bits_PutUE(&bw, 0);             // num_positive_pics
+    Bits_PutUE(&bw, 0);             // delta_poc_s0_minus1
+    Bits_Put(&bw, 1, 1);            // used_by_curr_pic_s0_flag
+
+    Bits_Put(&bw, 0, 1);            // long_term_ref_pics_present_flag
+    Bits_Put(&bw, 0, 1);            // sps_temporal_mvp_enabled_flag
+    Bits_Put(&bw, 0, 1);            // strong_intra_smoothing_enabled_flag
+
+    // VUI with just the frame rate, so raw .hevc files play at the right speed
+    Bits_Put(&bw, 1, 1);            // vui_parameters_present_flag
+    Bits_Put(&bw, 0, 8);            // aspect ratio .. default display window flags
+    Bits_Put(&bw, 1, 1);            // vui_timing_info_present_flag
+    Bits_Put(&bw, 1, 32);           // vui_num_units_in_tick
+    Bits_Put(&bw, c->fps, 32);      // vui_time_scale
+    Bits_Put(&bw, 0, 1);            // vui_poc_proportional_to_timing_flag
+    Bits_Put(&bw, 0, 1);            // vui_hrd_parameters_present_flag
+    Bits_Put(&bw, 0, 1);            // bitstream_restriction_flag
+
+    Bits_Put(&bw, 0, 1);            // sps_extension_present_flag
+    Bits_Trailing(&bw);
+
+    return bw.overflow ? 0 : WriteNal(rbsp, Bits_Bytes(&bw), out, capacity);
+}
+
+static uint32_t WritePps(uint8_t* out, uint32_t capacity) {
+    uint8_t rbsp[MAX_HEADER_BYTES];
+    BitWriter bw;
+    Bits_Init(&bw, rbsp, sizeof(rbsp));
+
+    PutNalHeader(&bw, HEVC_NAL_PPS);
+    Bits_PutUE(&bw, 0);             // pps_pic_parameter_set_id
+    Bits_PutUE(&bw, 0);             // pps_seq_parameter_set_id
+    Bits_Put(&bw, 0, 1);            // dependent_slice_segments_enabled_flag
+    Bits_Put(&bw, 0, 1);            // output_flag_present_flag
+    Bits_Put(&bw, 0, 3);            // num_extra_slice_header_bits
+    Bits_Put(&bw, 0, 1);            // sign_data_hiding_enabled_flag
+    Bits_Put(&bw, 0, 1);            // cabac_init_present_flag
+    Bits_PutUE(&bw, 0);             // num_ref_idx_l0_default_active_minus1
+    Bits_PutUE(&bw, 0);             // num_ref_idx_l1_default_active_minus1
+    Bits_PutSE(&bw, 0);             // init_qp_minus26
+    Bits_Put(&bw, 0, 1);            // constrained_intra_pred_flag
+    Bits_Put(&bw, 0, 1);            // transform_skip_enabled_flag
+    Bits_Put(&bw, 0, 1);            // cu_qp_delta_enabled_flag
+    Bits_PutSE(&bw, 0);             // pps_cb_qp_offset
+    Bits_PutSE(&bw, 0);             // pps_cr_qp_offset
+    Bits_Put(&bw, 0, 1);            // pps_slice_chroma_qp_offsets_present_flag
+    Bits_Put(&bw, 0, 1);            // weighted_pred_flag
+    Bits_Put(&bw, 0, 1);            // weighted_bipred_flag
+    Bits_Put(&bw, 0, 1);            // transquant_bypass_enabled_flag
+    Bits_Put(&bw, 0, 1);            // tiles_enabled_flag
+    Bits_Put(&bw, 0, 1);            // entropy_coding_sync_enabled_flag
+    Bits_Put(&bw, 0, 1);            // pps_loop_filter_across_slices_enabled_flag
+    Bits_Put(&bw, 0, 1);            // deblocking_filter_control_present_flag
+    Bits_Put(&bw, 0, 1);            // pps_scaling_list_data_present_flag
+    Bits_Put(&bw, 0, 1);            // lists_modification_present_flag
+    Bits_PutUE(&bw, 0);             // log2_parallel_merge_level_minus2
+    Bits_Put(&bw, 0, 1);            // slice_segment_header_extension_present_flag
+    Bits_Put(&bw, 0, 1);            // pps_extension_present_flag
+    Bits_Trailing(&bw);
+
+    return bw.overflow ? 0 : WriteNal(rbsp, Bits_Bytes(&bw), out, capacity);
+}
+
+// NAL header and slice segment header of the next picture, up to and
+// including byte_alignment(); returns the escaped NAL size so far
+static uint32_t WriteSliceHeader(const SynthHevc* gen, bool keyframe, uint8_t* out, uint32_t capacity) {
+    uint8_t rbsp[MAX_HEADER_BYTES];
+    BitWriter bw;
+    Bits_Init(&bw, rbsp, sizeof(rbsp));
+
+    int qp = gen->config.qp;
+    if (keyframe) qp = qp > 4 ? qp - 4 : 1;
+
+    PutNalHeader(&bw, keyframe ? HEVC_NAL_IDR_W_RADL : HEVC_NAL_TRAIL_R);
+    Bits_Put(&bw, 1, 1);            // first_slice_segment_in_pic_flag
+    if (keyframe) Bits_Put(&bw, 0, 1);  // no_output_of_prior_pics_flag
+    Bits_PutUE(&bw, 0);             // slice_pic_parameter_set_id
+    Bits_PutUE(&bw, keyframe ? HEVC_SLICE_I : HEVC_SLICE_P);
+    if (!keyframe) {
+        Bits_Put(&bw, gen->framesSinceIdr & ((1u << HEVC_POC_LSB_BITS) - 1), HEVC_POC_LSB_BITS);
+        Bits_Put(&bw, 1, 1);        // short_term_ref_pic_set_sps_flag (the only one)
+        Bits_Put(&bw, 0, 1);        // num_ref_idx_active_override_flag
+        Bits_PutUE(&bw, 0);         // five_minus_max_num_merge_cand
+    }
+    Bits_PutSE(&bw, qp - 26);       // slice_qp_delta
+    Bits_Trailing(&bw);             // byte_alignment()
+
+    return bw.overflow ? 0 : WriteNal(rbsp, Bits_Bytes(&bw), out, capacity);
+}
+
+// ============================================================================
+// HEVC
+// ============================================================================
+
+void SynthHevc_Init(SynthHevc* gen, const SynthHevcConfig* config) {
+    memset(gen, 0, sizeof(*gen));
+    gen->config = *config;
+    SynthHevcConfig* c = &gen->config;
+    if (c->width < 16) c->width = 16;
+    if (c->height < 16) c->height = 16;
+    c->width &= ~1;
+    c->height &= ~1;
+    if (c->fps <= 0) c->fps = 60;
+    if (c->qp < 1) c->qp = 1;
+    if (c->qp > 51) c->qp = 51;
+    StreamRandom_Seed(&gen->rng, c->seed);
+
+    uint32_t pos = 0;
+    uint32_t n = WriteVps(c, gen->paramSets, sizeof(gen->paramSets));
+    pos += n;
+    n = n ? WriteSps(c, gen->paramSets + pos, sizeof(gen->paramSets) - pos) : 0;
+    pos += n;
+    n = n ? WritePps(gen->paramSets + pos, sizeof(gen->paramSets) - pos) : 0;
+    pos += n;
+    gen->paramSetsSize = n ? pos : 0;
+}
+
+const uint8_t* SynthHevc_GetParamSets(const SynthHevc* gen, uint32_t* size) {
+    if (size) *size = gen->paramSetsSize;
+    return gen->paramSets;
+}
+
+void SynthHevc_SetQP(SynthHevc* gen, int qp) {
+    if (qp >= 1 && qp <= 51) gen->config.qp = qp;
+}
+
+uint32_t SynthHevc_MinFrameSize(const SynthHevc* gen, bool keyframe) {
+    uint8_t header[MAX_HEADER_BYTES * 2];
+    uint32_t size = WriteSliceHeader(gen, keyframe, header, sizeof(header)) + 1;
+    if (keyframe && gen->config.repeatParamSets) size += gen->paramSetsSize;
+    return size;
+}
+
+uint32_t SynthHevc_WriteFrame(SynthHevc* gen, bool keyframe, uint8_t* out, uint32_t capacity, uint32_t size) {
+    uint32_t minSize = SynthHevc_MinFrameSize(gen, keyframe);
+    if (size < minSize) size = minSize;
+    if (!out || capacity < size) return 0;
+
+    uint32_t pos = 0;
+    if (keyframe && gen->config.repeatParamSets) {
+        memcpy(out, gen->paramSets, gen->paramSetsSize);
+        pos = gen->paramSetsSize;
+    }
+    if (keyframe) gen->framesSinceIdr = 0;
+    pos += WriteSliceHeader(gen, keyframe, out + pos, capacity - pos);
+    gen->framesSinceIdr++;
+
+    // Slice data: nonzero bytes can't form a start code or need escaping;
+    // the last carries rbsp_slice_segment_trailing_bits
+    uint32_t end = size - 1;
+    while (pos + 8 <= end) {
+        uint64_t r = StreamRandom_Next(&gen->rng) | 0x0101010101010101ULL;
+        memcpy(out + pos, &r, 8);
+        pos += 8;
+    }
+    while (pos < end) out[pos++] = 0xA5;
+    out[pos++] = 0x80;
+    return pos;
+}
+
+// ============================================================================
+// AAC
+// ============================================================================
+
+static int SampleRateIndex(int sampleRate) {
+    static const int rates[] = {
+        96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350
+    };
+    for (int i = 0; i < (int)(sizeof(rates) / sizeof(rates[0])); i++) {
+        if (rates[i] == sampleRate) return i;
+    }
+    return -1;
+}
+
+int SynthAac_WriteConfig(int sampleRate, int channels, uint8_t* out, int capacity) {
+    int index = SampleRateIndex(sampleRate);
+    if (index < 0 || channels < 1 || channels > 2 || !out || capacity < SYNTH_AAC_CONFIG_SIZE) return 0;
+
+    // audioObjectType 2 (LC), frequency index, channel configuration,
+    // GASpecificConfig all zero (1024-sample frames, no core coder/extension)
+    out[0] = (uint8_t)((2 << 3) | (index >> 1));
+    out[1] = (uint8_t)(((index & 1) << 7) | (channels << 3));
+    return SYNTH_AAC_CONFIG_SIZE;
+}
+
+static uint32_t ElementBits(int channels) {
+    return channels == 1 ? AAC_SCE_BITS : AAC_CPE_BITS;
+}
+
+uint32_t SynthAac_MinFrameSize(int channels) {
+    return (ElementBits(channels) + 3 + 7) / 8;
+}
+
+// individual_channel_stream with max_sfb 0: no spectral data
+static void PutSilentChannel(BitWriter* bw) {
+    Bits_Put(bw, 100, 8);           // global_gain
+    Bits_Put(bw, 0, 1);             // ics_reserved_bit
+    Bits_Put(bw, 0, 2);             // window_sequence (ONLY_LONG_SEQUENCE)
+    Bits_Put(bw, 0, 1);             // window_shape
+    Bits_Put(bw, 0, 6);             // max_sfb
+    Bits_Put(bw, 0, 1);             // predictor_data_present
+    Bits_Put(bw, 0, 1);             // pulse_data_present
+    Bits_Put(bw, 0, 1);             // tns_data_present
+    Bits_Put(bw, 0, 1);             // gain_control_data_present
+}
+
+// fill_element of exactly 'bits' bits (7 mod 8, between the min and max)
+static void PutFill(BitWriter* bw, uint32_t bits) {
+    uint32_t count = (bits - AAC_FILL_MIN_BITS) / 8;
+    Bits_Put(bw, AAC_ID_FIL, 3);
+    if (count < 15) {
+        Bits_Put(bw, count, 4);
+    } else {
+        count = (bits - AAC_FILL_MIN_BITS - 8) / 8;
+        Bits_Put(bw, 15, 4);
+        Bits_Put(bw, count - 14, 8);    // esc_count
+    }
+    if (count > 0) {
+        Bits_Put(bw, 0, 4);         // extension_type EXT_FILL
+        Bits_Put(bw, 0, 4);         // fill_nibble
+        for (uint32_t i = 1; i < count; i++) Bits_Put(bw, 0xA5, 8);    // fill_byte
+    }
+}
+
+uint32_t SynthAac_WriteFrame(int channels, uint8_t* out, uint32_t size) {
+    if (channels < 1 || channels > 2 || !out || size < SynthAac_MinFrameSize(channels)) return 0;
+
+    // Fill elements take 7 mod 8 bits each, so k of them cover any length
+    // congruent to 7k; pick the count that lands within the final byte's
+    // alignment padding
+    uint32_t avail = size * 8 - ElementBits(channels) - 3;
+    uint32_t fillBits = 0, fills = 0;
+    for (uint32_t pad = 0; pad < 8 && pad <= avail; pad++) {
+        fillBits = avail - pad;
+        fills = (8 - fillBits % 8) % 8;
+        while ((uint64_t)fills * AAC_FILL_MAX_BITS < fillBits) fills += 8;
+        if (fills * AAC_FILL_MIN_BITS <= fillBits) break;
+    }
+
+    BitWriter bw;
+    Bits_Init(&bw, out, size);
+    if (channels == 1) {
+        Bits_Put(&bw, AAC_ID_SCE, 3);
+        Bits_Put(&bw, 0, 4);        // element_instance_tag
+        PutSilentChannel(&bw);
+    } else {
+        Bits_Put(&bw, AAC_ID_CPE, 3);
+        Bits_Put(&bw, 0, 4);        // element_instance_tag
+        Bits_Put(&bw, 0, 1);        // common_window
+        PutSilentChannel(&bw);
+        PutSilentChannel(&bw);
+    }
+
+    // Largest fills first, leaving at least the minimum for the rest
+    for (uint32_t left = fills; left > 0; left--) {
+        uint32_t bits = fillBits;
+        if (left > 1) {
+            bits = fillBits - (left - 1) * AAC_FILL_MIN_BITS;
+            if (bits > AAC_FILL_MAX_BITS) bits = AAC_FILL_MAX_BITS;
+            bits -= (bits - AAC_FILL_MIN_BITS) % 8;
+        }
+        PutFill(&bw, bits);
+        fillBits -= bits;
+    }
+
+    Bits_Put(&bw, AAC_ID_END, 3);
+    Bits_AlignZero(&bw);
+    return bw.overflow ? 0 : Bits_Bytes(&bw);
+}
+
+int SynthAac_WriteAdtsHeader(int sampleRate, int channels, uint32_t frameSize,
+                             uint8_t out[SYNTH_AAC_ADTS_HEADER_SIZE]) {
+    int index = SampleRateIndex(sampleRate);
+    uint32_t length = frameSize + SYNTH_AAC_ADTS_HEADER_SIZE;
+    if (index < 0 || channels < 1 || channels > 7 || length > 0x1FFF) return 0;
+
+    BitWriter bw;
+    Bits_Init(&bw, out, SYNTH_AAC_ADTS_HEADER_SIZE);
+    Bits_Put(&bw, 0xFFF, 12);       // syncword
+    Bits_Put(&bw, 0, 1);            // ID (MPEG-4)
+    Bits_Put(&bw, 0, 2);            // layer
+    Bits_Put(&bw, 1, 1);            // protection_absent
+    Bits_Put(&bw, 1, 2);            // profile (LC)
+    Bits_Put(&bw, index, 4);
+    Bits_Put(&bw, 0, 1);            // private_bit
+    Bits_Put(&bw, channels, 3);
+    Bits_Put(&bw, 0, 4);            // original/home/copyright bits
+    Bits_Put(&bw, length, 13);      // aac_frame_length
+    Bits_Put(&bw, 0x7FF, 11);       // adts_buffer_fullness (VBR)
+    Bits_Put(&bw, 0, 2);            // number_of_raw_data_blocks_in_frame - 1
+    return SYNTH_AAC_ADTS_HEADER_SIZE;
+}
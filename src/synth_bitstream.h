@@ -0,0 +1,88 @@
+/*
+ * Synth Bitstream - Structurally valid HEVC and AAC for load testing
+ * Portable C; deterministic (seeded), no encoder needed
+ *
+ * Fills frames of a given size (StreamModel's) with data a demuxer or
+ * muxer accepts, so the buffer, muxer and save paths see real streams at any
+ * resolution and bitrate:
+ * - HEVC Main, Annex-B: VPS/SPS/PPS for the profile (level from the luma
+ *   rate, conformance window for sizes off the 8-pixel grid, VUI timing),
+ *   IDR_W_RADL and TRAIL_R access units with real slice segment headers
+ *   (POC, short-term RPS, slice QP). Slice data is filler, not CABAC - the
+ *   stream parses but doesn't decode to pictures.
+ * - AAC-LC raw frames that decode (to silence): one SCE or CPE with no
+ *   spectral data, padded to size with FIL elements; AudioSpecificConfig and
+ *   ADTS headers for the same stream.
+ */
+
+#ifndef SYNTH_BITSTREAM_H
+#define SYNTH_BITSTREAM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "stream_model.h"
+
+// VPS+SPS+PPS with start codes (fits SampleBuffer's sequence header)
+#define SYNTH_HEVC_MAX_PARAM_SETS 128
+
+// AudioSpecificConfig (AAC-LC, no extensions)
+#define SYNTH_AAC_CONFIG_SIZE 2
+#define SYNTH_AAC_ADTS_HEADER_SIZE 7
+
+// ============================================================================
+// HEVC
+// ============================================================================
+
+typedef struct {
+    int width;                  // Even sizes (4:2:0)
+    int height;
+    int fps;
+    int qp;                     // P slice QP; IDRs use qp - 4, as NVENC's constQP
+    bool repeatParamSets;       // VPS/SPS/PPS in front of every IDR
+    uint64_t seed;              // Slice data bytes
+} SynthHevcConfig;
+
+typedef struct {
+    SynthHevcConfig config;
+    StreamRandom rng;
+    uint8_t paramSets[SYNTH_HEVC_MAX_PARAM_SETS];
+    uint32_t paramSetsSize;
+    uint32_t framesSinceIdr;    // POC of the next TRAIL picture
+} SynthHevc;
+
+void SynthHevc_Init(SynthHevc* gen, const SynthHevcConfig* config);
+
+// Parameter sets for the muxer's sequence header (Annex-B)
+const uint8_t* SynthHevc_GetParamSets(const SynthHevc* gen, uint32_t* size);
+
+// Apply a QP change like VideoEncoder_Reconfigure (takes effect next frame)
+void SynthHevc_SetQP(SynthHevc* gen, int qp);
+
+// Smallest access unit the generator can write (headers plus one byte of data)
+uint32_t SynthHevc_MinFrameSize(const SynthHevc* gen, bool keyframe);
+
+// Write the next access unit, exactly 'size' bytes (raised to the minimum).
+// Pictures follow one another in decode order; a keyframe starts a new
+// coded video sequence. Returns bytes written, 0 if 'capacity' is too small.
+uint32_t SynthHevc_WriteFrame(SynthHevc* gen, bool keyframe, uint8_t* out, uint32_t capacity, uint32_t size);
+
+// ============================================================================
+// AAC
+// ============================================================================
+
+// AudioSpecificConfig for AAC-LC; returns bytes written, 0 for an unsupported
+// rate or channel count (1 or 2 channels)
+int SynthAac_WriteConfig(int sampleRate, int channels, uint8_t* out, int capacity);
+
+// Smallest raw frame for the channel count
+uint32_t SynthAac_MinFrameSize(int channels);
+
+// Raw AAC-LC frame (1024 samples of silence) of exactly 'size' bytes.
+// Returns bytes written, 0 if 'size' is below the minimum.
+uint32_t SynthAac_WriteFrame(int channels, uint8_t* out, uint32_t size);
+
+// ADTS header for a raw frame of 'frameSize' bytes, for .aac files
+int SynthAac_WriteAdtsHeader(int sampleRate, int channels, uint32_t frameSize,
+                             uint8_t out[SYNTH_AAC_ADTS_HEADER_SIZE]);
+
+#endif // SYNTH_BITSTREAM_H
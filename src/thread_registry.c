@@ -0,0 +1,538 @@
+/*
+ * Thread Registry Implementation
+ * Thread slots, per-platform CPU and context switch readers, role totals,
+ * role scheduling policies
+ */
+
+#ifndef _WIN32
+#define _GNU_SOURCE     // pthread_setaffinity_np, CPU_* set macros
+#endif
+
+#include "thread_registry.h"
+#include "frame_pacer.h"
+#include "mem_tracker.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <winternl.h>
+#define REG_TLS __declspec(thread)
+typedef SRWLOCK RegLock;
+#define REG_LOCK_INIT SRWLOCK_INIT
+static void Lock(RegLock* l) { AcquireSRWLockExclusive(l); }
+static void Unlock(RegLock* l) { ReleaseSRWLockExclusive(l); }
+typedef HANDLE RegThreadHandle;
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#define REG_TLS __thread
+typedef pthread_mutex_t RegLock;
+#define REG_LOCK_INIT PTHREAD_MUTEX_INITIALIZER
+static void Lock(RegLock* l) { pthread_mutex_lock(l); }
+static void Unlock(RegLock* l) { pthread_mutex_unlock(l); }
+typedef clockid_t RegThreadHandle;
+#endif
+
+typedef struct {
+    bool inUse;
+    uint32_t threadId;
+    char name[THREAD_REGISTRY_NAME_SIZE];
+    ThreadRole role;
+    ThreadLevel level;          // Applied by the thread itself
+    RegThreadHandle handle;     // For reading the thread's CPU time from other threads
+    int64_t roleCpuBase;        // CPU time when the current role began
+    int64_t lastCpu;            // At the previous sample
+    uint64_t lastSwitches;
+    int64_t lastSampleTime;     // 0: never sampled
+} RegThread;
+
+// A thread being sampled, copied out of its slot so the counters can be read
+// without holding the registry lock
+typedef struct {
+    int slot;
+    uint32_t threadId;
+    RegThreadHandle handle;     // Own copy: the slot's may be closed meanwhile
+} RegSampleThread;
+
+typedef struct {
+    RegThread threads[THREAD_REGISTRY_MAX];
+    int64_t roleCpu[THREAD_ROLE_COUNT];     // Finished role intervals
+#ifdef _WIN32
+    BYTE* systemInfo;           // NtQuerySystemInformation snapshot (reused, g_sampleLock)
+    ULONG systemInfoSize;
+#endif
+} Registry;
+
+static RegLock g_lock = REG_LOCK_INIT;
+static RegLock g_sampleLock = REG_LOCK_INIT;    // One sampler at a time; never held with g_lock while reading
+static Registry g_registry;
+
+static REG_TLS int t_slot = -1;
+
+static const char* g_roleNames[THREAD_ROLE_COUNT] = {
+    "capture", "encode", "encoder output", "audio capture", "mixer", "save", "logger"
+};
+
+static const char* g_levelNames[] = {
+    "below normal", "normal", "above normal", "highest", "time critical"
+};
+
+// Defaults favour whatever loses data when it wakes late: a capture tick
+// or an audio device buffer. Saves are long and can wait for the game.
+#define DEFAULT_POLICIES {                                  \
+    { THREAD_LEVEL_HIGHEST, 0 },        /* Capture */        \
+    { THREAD_LEVEL_ABOVE_NORMAL, 0 },   /* Encode */         \
+    { THREAD_LEVEL_ABOVE_NORMAL, 0 },   /* Encoder output */ \
+    { THREAD_LEVEL_HIGHEST, 0 },        /* Audio capture */  \
+    { THREAD_LEVEL_HIGHEST, 0 },        /* Mixer */          \
+    { THREAD_LEVEL_NORMAL, 0 },         /* Save */           \
+    { THREAD_LEVEL_BELOW_NORMAL, 0 },   /* Logger */         \
+}
+static const ThreadPolicy g_defaultPolicies[THREAD_ROLE_COUNT] = DEFAULT_POLICIES;
+static ThreadPolicy g_policies[THREAD_ROLE_COUNT] = DEFAULT_POLICIES;
+
+static ThreadRole ValidRole(ThreadRole role) {
+    return (role >= 0 && role < THREAD_ROLE_COUNT) ? role : THREAD_ROLE_ENCODE;
+}
+
+static ThreadLevel ValidLevel(ThreadLevel level) {
+    if (level < THREAD_LEVEL_BELOW_NORMAL) return THREAD_LEVEL_BELOW_NORMAL;
+    if (level > THREAD_LEVEL_TIME_CRITICAL) return THREAD_LEVEL_TIME_CRITICAL;
+    return level;
+}
+
+// ============================================================================
+// Platform readers
+// ============================================================================
+
+#ifdef _WIN32
+
+static int64_t FileTimeUnits(const FILETIME* ft) {
+    return ((int64_t)ft->dwHighDateTime << 32) | ft->dwLowDateTime;
+}
+
+static int64_t ReadCpuTime(HANDLE thread) {
+    FILETIME created, exited, kernel, user;
+    if (!GetThreadTimes(thread, &created, &exited, &kernel, &user)) return -1;
+    return FileTimeUnits(&kernel) + FileTimeUnits(&user);
+}
+
+static uint32_t CurrentThreadId(void) { return (uint32_t)GetCurrentThreadId(); }
+static int64_t CurrentCpuTime(void) { return ReadCpuTime(GetCurrentThread()); }
+
+static bool OpenCurrentThread(RegThreadHandle* handle) {
+    *handle = OpenThread(THREAD_QUERY_LIMITED_INFORMATION, FALSE, GetCurrentThreadId());
+    return *handle != NULL;
+}
+
+static void CloseThreadHandle(RegThreadHandle handle) {
+    if (handle) CloseHandle(handle);
+}
+
+static bool CopyThreadHandle(RegThreadHandle handle, RegThreadHandle* copy) {
+    HANDLE process = GetCurrentProcess();
+    return DuplicateHandle(process, handle, process, copy, 0, FALSE, DUPLICATE_SAME_ACCESS) != 0;
+}
+
+// Calling thread takes 'policy'; returns the level in effect
+static ThreadLevel ApplyPolicy(const ThreadPolicy* policy) {
+    static const int priorities[] = {
+        THREAD_PRIORITY_BELOW_NORMAL, THREAD_PRIORITY_NORMAL, THREAD_PRIORITY_ABOVE_NORMAL,
+        THREAD_PRIORITY_HIGHEST, THREAD_PRIORITY_TIME_CRITICAL
+    };
+    HANDLE self = GetCurrentThread();
+    ThreadLevel level = policy->level;
+    if (!SetThreadPriority(self, priorities[level - THREAD_LEVEL_BELOW_NORMAL])) {
+        level = THREAD_LEVEL_NORMAL;
+    }
+
+    // A mask with no CPU the process may use falls back to all of them
+    DWORD_PTR processMask, systemMask;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask)) {
+        DWORD_PTR mask = (DWORD_PTR)policy->affinity & processMask;
+        SetThreadAffinityMask(self, mask ? mask : processMask);
+    }
+    return level;
+}
+
+// Per-thread context switches are only published in the system process
+// snapshot. Thread entries follow each process entry; winternl.h keeps
+// ContextSwitches as a reserved field, so the layout is spelled out here.
+typedef struct {
+    LARGE_INTEGER kernelTime;
+    LARGE_INTEGER userTime;
+    LARGE_INTEGER createTime;
+    ULONG waitTime;
+    PVOID startAddress;
+    CLIENT_ID clientId;
+    LONG priority;
+    LONG basePriority;
+    ULONG contextSwitches;
+    ULONG threadState;
+    ULONG waitReason;
+} RegSystemThread;
+
+typedef NTSTATUS (NTAPI *NtQuerySystemInformationFn)(ULONG infoClass, PVOID buffer, ULONG size, PULONG needed);
+
+#define REG_SYSTEM_PROCESS_INFORMATION  5
+#define REG_STATUS_LENGTH_MISMATCH      ((NTSTATUS)0xC0000004L)
+
+// This process's entry in a fresh snapshot (NULL if unavailable)
+static const SYSTEM_PROCESS_INFORMATION* QueryProcessInfo(Registry* reg) {
+    static NtQuerySystemInformationFn query = NULL;
+    if (!query) {
+        query = (NtQuerySystemInformationFn)GetProcAddress(GetModuleHandleA("ntdll.dll"), "NtQuerySystemInformation");
+        if (!query) return NULL;
+    }
+
+    for (int attempt = 0; ; attempt++) {
+        ULONG needed = 0;
+        if (reg->systemInfo) {
+            NTSTATUS status = query(REG_SYSTEM_PROCESS_INFORMATION, reg->systemInfo, reg->systemInfoSize, &needed);
+            if (status >= 0) break;
+            if (status != REG_STATUS_LENGTH_MISMATCH || attempt >= 3) return NULL;
+        }
+        // Grow with headroom: processes come and go between calls
+        ULONG size = (needed > reg->systemInfoSize ? needed : reg->systemInfoSize) + 64 * 1024;
+        MemTracker_Free(reg->systemInfo);
+        reg->systemInfo = (BYTE*)MemTracker_Alloc(MEM_TAG_DIAGNOSTICS, size);
+        reg->systemInfoSize = reg->systemInfo ? size : 0;
+        if (!reg->systemInfo) return NULL;
+    }
+
+    HANDLE self = (HANDLE)(ULONG_PTR)GetCurrentProcessId();
+    const BYTE* entry = reg->systemInfo;
+    for (;;) {
+        const SYSTEM_PROCESS_INFORMATION* process = (const SYSTEM_PROCESS_INFORMATION*)entry;
+        if (process->UniqueProcessId == self) return process;
+        if (process->NextEntryOffset == 0) return NULL;
+        entry += process->NextEntryOffset;
+    }
+}
+
+static void ReadContextSwitches(Registry* reg, const RegSampleThread* sampled, int count, uint64_t* switches) {
+    const SYSTEM_PROCESS_INFORMATION* process = QueryProcessInfo(reg);
+    if (!process) return;
+
+    const RegSystemThread* threads = (const RegSystemThread*)(process + 1);
+    for (ULONG i = 0; i < process->NumberOfThreads; i++) {
+        uint32_t tid = (uint32_t)(ULONG_PTR)threads[i].clientId.UniqueThread;
+        for (int k = 0; k < count; k++) {
+            if (sampled[k].threadId == tid) {
+                switches[k] = threads[i].contextSwitches;
+                break;
+            }
+        }
+    }
+}
+
+#else
+
+static int64_t ReadCpuTime(clockid_t clock) {
+    struct timespec ts;
+    if (clock_gettime(clock, &ts) != 0) return -1;
+    return (int64_t)ts.tv_sec * 10000000 + ts.tv_nsec / 100;
+}
+
+static uint32_t CurrentThreadId(void) { return (uint32_t)syscall(SYS_gettid); }
+static int64_t CurrentCpuTime(void) { return ReadCpuTime(CLOCK_THREAD_CPUTIME_ID); }
+
+static bool OpenCurrentThread(RegThreadHandle* handle) {
+    return pthread_getcpuclockid(pthread_self(), handle) == 0;
+}
+
+static void CloseThreadHandle(RegThreadHandle handle) { (void)handle; }
+
+static bool CopyThreadHandle(RegThreadHandle handle, RegThreadHandle* copy) {
+    *copy = handle;
+    return true;
+}
+
+// Calling thread takes 'policy'; returns the level in effect. Highest and
+// time critical are real-time (SCHED_RR / SCHED_FIFO), which needs
+// CAP_SYS_NICE; without it they fall back to the best nice value allowed.
+static ThreadLevel ApplyPolicy(const ThreadPolicy* policy) {
+    static const int niceValues[] = { 5, 0, -5 };
+    pthread_t self = pthread_self();
+    pid_t tid = (pid_t)syscall(SYS_gettid);
+    ThreadLevel level = policy->level;
+    struct sched_param param = {0};
+
+    bool realtime = false;
+    if (level >= THREAD_LEVEL_HIGHEST) {
+        int scheduler = level == THREAD_LEVEL_TIME_CRITICAL ? SCHED_FIFO : SCHED_RR;
+        param.sched_priority = sched_get_priority_min(scheduler) + (level == THREAD_LEVEL_TIME_CRITICAL ? 20 : 10);
+        realtime = pthread_setschedparam(self, scheduler, &param) == 0;
+    }
+    if (!realtime) {
+        param.sched_priority = 0;
+        pthread_setschedparam(self, SCHED_OTHER, &param);
+        int index = level > THREAD_LEVEL_ABOVE_NORMAL ? 2 : (int)level + 1;
+        if (setpriority(PRIO_PROCESS, (id_t)tid, niceValues[index]) != 0 && index == 2) {
+            setpriority(PRIO_PROCESS, (id_t)tid, 0);
+        }
+        // Lowering nice can fail too, so report what stuck
+        int nice = getpriority(PRIO_PROCESS, (id_t)tid);
+        level = nice > 0 ? THREAD_LEVEL_BELOW_NORMAL : nice < 0 ? THREAD_LEVEL_ABOVE_NORMAL : THREAD_LEVEL_NORMAL;
+    }
+
+    cpu_set_t allowed;
+    if (sched_getaffinity(getpid(), sizeof(allowed), &allowed) == 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu = 0; cpu < 64; cpu++) {
+            if (((policy->affinity >> cpu) & 1) && CPU_ISSET(cpu, &allowed)) CPU_SET(cpu, &set);
+        }
+        pthread_setaffinity_np(self, sizeof(cpu_set_t), CPU_COUNT(&set) > 0 ? &set : &allowed);
+    }
+    return level;
+}
+
+// Voluntary + involuntary switches from /proc/self/task/<tid>/status
+static void ReadContextSwitches(Registry* reg, const RegSampleThread* sampled, int count, uint64_t* switches) {
+    (void)reg;
+    for (int k = 0; k < count; k++) {
+        char path[64], line[128];
+        snprintf(path, sizeof(path), "/proc/self/task/%u/status", sampled[k].threadId);
+        FILE* file = fopen(path, "r");
+        if (!file) continue;
+
+        uint64_t total = 0;
+        unsigned long long value;
+        while (fgets(line, sizeof(line), file)) {
+            if (sscanf(line, "voluntary_ctxt_switches: %llu", &value) == 1 ||
+                sscanf(line, "nonvoluntary_ctxt_switches: %llu", &value) == 1) {
+                total += value;
+            }
+        }
+        fclose(file);
+        switches[k] = total;
+    }
+}
+
+#endif
+
+// ============================================================================
+// Registration
+// ============================================================================
+
+// Apply the role's policy to the calling thread and record the outcome
+static void TakeRolePolicy(ThreadRole role) {
+    Lock(&g_lock);
+    ThreadPolicy policy = g_policies[role];
+    Unlock(&g_lock);
+
+    ThreadLevel level = ApplyPolicy(&policy);
+
+    if (t_slot < 0) return;
+    Lock(&g_lock);
+    g_registry.threads[t_slot].level = level;
+    Unlock(&g_lock);
+}
+
+void ThreadRegistry_Register(const char* name, ThreadRole role) {
+    Registry* reg = &g_registry;
+    role = ValidRole(role);
+    int64_t cpu = CurrentCpuTime();
+
+    Lock(&g_lock);
+    if (t_slot < 0) {
+        for (int i = 0; i < THREAD_REGISTRY_MAX; i++) {
+            RegThread* t = &reg->threads[i];
+            if (t->inUse) continue;
+            if (!OpenCurrentThread(&t->handle)) break;
+            t->inUse = true;
+            t->threadId = CurrentThreadId();
+            t->role = role;
+            t->roleCpuBase = cpu;
+            t->lastCpu = cpu;
+            t->lastSwitches = 0;
+            t->lastSampleTime = 0;
+            t_slot = i;
+            break;
+        }
+    } else {
+        // Re-registering: close the old role's interval
+        RegThread* t = &reg->threads[t_slot];
+        reg->roleCpu[t->role] += cpu - t->roleCpuBase;
+        t->roleCpuBase = cpu;
+        t->role = role;
+    }
+    if (t_slot >= 0) {
+        RegThread* t = &reg->threads[t_slot];
+        strncpy(t->name, name ? name : "", THREAD_REGISTRY_NAME_SIZE - 1);
+        t->name[THREAD_REGISTRY_NAME_SIZE - 1] = '\0';
+    }
+    Unlock(&g_lock);
+
+    TakeRolePolicy(role);
+}
+
+void ThreadRegistry_Unregister(void) {
+    if (t_slot < 0) return;
+    Registry* reg = &g_registry;
+    int64_t cpu = CurrentCpuTime();
+
+    Lock(&g_lock);
+    RegThread* t = &reg->threads[t_slot];
+    if (cpu >= t->roleCpuBase) reg->roleCpu[t->role] += cpu - t->roleCpuBase;
+    CloseThreadHandle(t->handle);
+    memset(t, 0, sizeof(*t));
+    Unlock(&g_lock);
+    t_slot = -1;
+}
+
+void ThreadRegistry_SetRole(ThreadRole role) {
+    if (t_slot < 0) return;
+    Registry* reg = &g_registry;
+    role = ValidRole(role);
+    int64_t cpu = CurrentCpuTime();
+
+    Lock(&g_lock);
+    RegThread* t = &reg->threads[t_slot];
+    bool changed = t->role != role;
+    if (changed) {
+        if (cpu >= t->roleCpuBase) reg->roleCpu[t->role] += cpu - t->roleCpuBase;
+        t->roleCpuBase = cpu;
+        t->role = role;
+    }
+    Unlock(&g_lock);
+
+    if (changed) TakeRolePolicy(role);
+}
+
+int64_t ThreadRegistry_CurrentCpuTime(void) {
+    int64_t cpu = CurrentCpuTime();
+    return cpu > 0 ? cpu : 0;
+}
+
+// ============================================================================
+// Sampling
+// ============================================================================
+
+int ThreadRegistry_Sample(ThreadStats* stats, int maxStats) {
+    if (!stats || maxStats <= 0) return 0;
+    Registry* reg = &g_registry;
+    RegSampleThread sampled[THREAD_REGISTRY_MAX];
+    int sampledCount = 0;
+
+    // Copy the threads out so registering threads never wait on /proc reads
+    // or the system snapshot
+    Lock(&g_sampleLock);
+    Lock(&g_lock);
+    for (int i = 0; i < THREAD_REGISTRY_MAX && sampledCount < maxStats; i++) {
+        const RegThread* t = &reg->threads[i];
+        if (!t->inUse) continue;
+        RegSampleThread* s = &sampled[sampledCount];
+        if (!CopyThreadHandle(t->handle, &s->handle)) continue;
+        s->slot = i;
+        s->threadId = t->threadId;
+        sampledCount++;
+    }
+    Unlock(&g_lock);
+
+    uint64_t switches[THREAD_REGISTRY_MAX] = {0};
+    int64_t cpuTimes[THREAD_REGISTRY_MAX];
+    ReadContextSwitches(reg, sampled, sampledCount, switches);
+    for (int k = 0; k < sampledCount; k++) {
+        cpuTimes[k] = ReadCpuTime(sampled[k].handle);
+        CloseThreadHandle(sampled[k].handle);
+    }
+    int64_t now = FramePacer_Now();
+
+    // Threads that left (or whose slot was reused) meanwhile are dropped
+    int count = 0;
+    Lock(&g_lock);
+    for (int k = 0; k < sampledCount; k++) {
+        RegThread* t = &reg->threads[sampled[k].slot];
+        if (!t->inUse || t->threadId != sampled[k].threadId) continue;
+        int64_t cpu = cpuTimes[k] >= 0 ? cpuTimes[k] : t->lastCpu;
+
+        ThreadStats* s = &stats[count++];
+        memset(s, 0, sizeof(*s));
+        s->threadId = t->threadId;
+        memcpy(s->name, t->name, sizeof(s->name));
+        s->role = t->role;
+        s->level = t->level;
+        s->cpuTime = cpu;
+        s->contextSwitches = switches[k];
+
+        if (t->lastSampleTime > 0 && now > t->lastSampleTime) {
+            double seconds = (double)(now - t->lastSampleTime) / FRAME_PACER_UNITS_PER_SECOND;
+            s->cpuPercent = 100.0 * (double)(cpu - t->lastCpu) / (double)(now - t->lastSampleTime);
+            if (switches[k] >= t->lastSwitches) {
+                s->switchesPerSecond = (double)(switches[k] - t->lastSwitches) / seconds;
+            }
+        }
+        t->lastCpu = cpu;
+        t->lastSwitches = switches[k];
+        t->lastSampleTime = now;
+    }
+    Unlock(&g_lock);
+    Unlock(&g_sampleLock);
+    return count;
+}
+
+void ThreadRegistry_GetRoleCpu(int64_t roleCpu[THREAD_ROLE_COUNT]) {
+    if (!roleCpu) return;
+    Registry* reg = &g_registry;
+
+    Lock(&g_lock);
+    memcpy(roleCpu, reg->roleCpu, sizeof(reg->roleCpu));
+    for (int i = 0; i < THREAD_REGISTRY_MAX; i++) {
+        const RegThread* t = &reg->threads[i];
+        if (t->inUse && t->lastCpu > t->roleCpuBase) roleCpu[t->role] += t->lastCpu - t->roleCpuBase;
+    }
+    Unlock(&g_lock);
+}
+
+// ============================================================================
+// Policies
+// ============================================================================
+
+void ThreadRegistry_SetPolicy(ThreadRole role, const ThreadPolicy* policy) {
+    if (!policy || role < 0 || role >= THREAD_ROLE_COUNT) return;
+    Lock(&g_lock);
+    g_policies[role].level = ValidLevel(policy->level);
+    g_policies[role].affinity = policy->affinity;
+    Unlock(&g_lock);
+}
+
+void ThreadRegistry_GetPolicy(ThreadRole role, ThreadPolicy* policy) {
+    if (!policy) return;
+    Lock(&g_lock);
+    *policy = g_policies[ValidRole(role)];
+    Unlock(&g_lock);
+}
+
+void ThreadRegistry_GetDefaultPolicy(ThreadRole role, ThreadPolicy* policy) {
+    if (!policy) return;
+    *policy = g_defaultPolicies[ValidRole(role)];
+}
+
+const char* ThreadRegistry_RoleName(ThreadRole role) {
+    if (role < 0 || role >= THREAD_ROLE_COUNT) return "?";
+    return g_roleNames[role];
+}
+
+const char* ThreadRegistry_LevelName(ThreadLevel level) {
+    return g_levelNames[ValidLevel(level) - THREAD_LEVEL_BELOW_NORMAL];
+}
+
+int ThreadRegistry_Format(const ThreadStats* stats, int count, char* buffer, size_t size) {
+    if (!buffer || size == 0) return 0;
+    buffer[0] = '\0';
+    int written = 0;
+
+    for (int i = 0; i < count && written >= 0 && (size_t)written < size; i++) {
+        written += snprintf(buffer + written, size - written, "%s%s %.1f%% %.0fcs/s", i > 0 ? ", " : "",
+                            stats[i].name[0] ? stats[i].name : ThreadRegistry_RoleName(stats[i].role),
+                            stats[i].cpuPercent, stats[i].switchesPerSecond);
+    }
+    return written;
+}
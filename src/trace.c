@@ -0,0 +1,272 @@
+/*
+ * Trace Implementation
+ * Single-writer rings per thread, lock-free emit, JSON export
+ */
+
+#include "trace.h"
+#include "mem_tracker.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <intrin.h>
+#define TRACE_TLS __declspec(thread)
+typedef SRWLOCK TraceLock;
+#define TRACE_LOCK_INIT SRWLOCK_INIT
+static void Lock(TraceLock* l) { AcquireSRWLockExclusive(l); }
+static void Unlock(TraceLock* l) { ReleaseSRWLockExclusive(l); }
+static uint32_t CurrentThreadId(void) { return (uint32_t)GetCurrentThreadId(); }
+// Raw QPC ticks; converted to time only on export
+static int64_t Clock_Ticks(void) { LARGE_INTEGER t; QueryPerformanceCounter(&t); return t.QuadPart; }
+static int64_t Clock_Frequency(void) { LARGE_INTEGER f; QueryPerformanceFrequency(&f); return f.QuadPart; }
+// x64 stores aren't reordered with older stores; only the compiler needs fencing
+static void StoreRelease(volatile uint64_t* p, uint64_t v) { _ReadWriteBarrier(); *p = v; }
+static uint64_t LoadAcquire(volatile uint64_t* p) { uint64_t v = *p; _ReadWriteBarrier(); return v; }
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <time.h>
+#define TRACE_TLS __thread
+typedef pthread_mutex_t TraceLock;
+#define TRACE_LOCK_INIT PTHREAD_MUTEX_INITIALIZER
+static void Lock(TraceLock* l) { pthread_mutex_lock(l); }
+static void Unlock(TraceLock* l) { pthread_mutex_unlock(l); }
+static uint32_t CurrentThreadId(void) { return (uint32_t)syscall(SYS_gettid); }
+static int64_t Clock_Ticks(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+static int64_t Clock_Frequency(void) { return 1000000000; }
+static void StoreRelease(volatile uint64_t* p, uint64_t v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+static uint64_t LoadAcquire(volatile uint64_t* p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+#endif
+
+#define TRACE_RING_MASK (TRACE_RING_EVENTS - 1)
+#define TRACE_NAME_SIZE 32
+
+typedef struct {
+    int64_t time;           // Clock_Ticks
+    uint64_t id;
+    uint16_t stage;
+    uint8_t phase;
+} TraceEvent;
+
+typedef struct {
+    TraceEvent events[TRACE_RING_EVENTS];
+    volatile uint64_t head;     // Events ever written (only the owner writes)
+    uint64_t firstEvent;        // head when the current owner attached
+    volatile int inUse;
+    uint32_t threadId;
+    char name[TRACE_NAME_SIZE];
+} TraceRing;
+
+volatile int g_traceEnabled = 0;
+static int64_t g_origin = 0;        // Export time zero (first enable)
+
+static TraceLock g_ringLock = TRACE_LOCK_INIT;
+static TraceRing* g_rings[TRACE_MAX_THREADS];
+static int g_ringCount = 0;
+static volatile uint32_t g_generation = 1;     // Bumped when Trace_Shutdown frees the rings
+
+// A thread's ring is only valid for the generation it attached in: after a
+// shutdown every other thread still holds a pointer to freed memory
+static TRACE_TLS TraceRing* t_ring = NULL;
+static TRACE_TLS uint32_t t_generation = 0;
+static TRACE_TLS char t_name[TRACE_NAME_SIZE];
+
+static const char* g_stageNames[TRACE_STAGE_COUNT] = {
+    "grab", "acquire", "convert", "submit", "encode", "output", "drop",
+    "audio read", "audio encode", "evict", "save", "save copy", "save mux"
+};
+
+// ============================================================================
+// Rings
+// ============================================================================
+
+static void SetRingName(TraceRing* ring) {
+    if (t_name[0]) {
+        snprintf(ring->name, sizeof(ring->name), "%s", t_name);
+    } else {
+        snprintf(ring->name, sizeof(ring->name), "Thread %u", ring->threadId);
+    }
+}
+
+// Calling thread's ring, NULL if it has none or it was freed since
+static TraceRing* CurrentRing(void) {
+    return t_generation == g_generation ? t_ring : NULL;
+}
+
+// First event on this thread: take a free ring or allocate one
+static TraceRing* AttachRing(void) {
+    TraceRing* ring = NULL;
+
+    Lock(&g_ringLock);
+    for (int i = 0; i < g_ringCount; i++) {
+        if (!g_rings[i]->inUse) {
+            ring = g_rings[i];
+            break;
+        }
+    }
+    if (!ring && g_ringCount < TRACE_MAX_THREADS) {
+        ring = (TraceRing*)MemTracker_Calloc(MEM_TAG_DIAGNOSTICS, 1, sizeof(TraceRing));
+        if (ring) g_rings[g_ringCount++] = ring;
+    }
+    if (ring) {
+        ring->inUse = 1;
+        ring->firstEvent = ring->head;
+        ring->threadId = CurrentThreadId();
+        SetRingName(ring);
+    }
+    t_generation = g_generation;
+    Unlock(&g_ringLock);
+
+    t_ring = ring;
+    return ring;
+}
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+void Trace_Enable(bool enabled) {
+    if (enabled && g_origin == 0) g_origin = Clock_Ticks();
+    g_traceEnabled = enabled ? 1 : 0;
+}
+
+bool Trace_IsEnabled(void) {
+    return g_traceEnabled != 0;
+}
+
+void Trace_Emit(TracePhase phase, TraceStage stage, uint64_t id) {
+    TraceRing* ring = CurrentRing();
+    if (!ring) {
+        ring = AttachRing();
+        if (!ring) return;      // Out of rings
+    }
+
+    uint64_t head = ring->head;
+    TraceEvent* e = &ring->events[head & TRACE_RING_MASK];
+    e->time = Clock_Ticks();
+    e->id = id;
+    e->stage = (uint16_t)stage;
+    e->phase = (uint8_t)phase;
+    StoreRelease(&ring->head, head + 1);
+}
+
+void Trace_SetThreadName(const char* name) {
+    snprintf(t_name, sizeof(t_name), "%s", name ? name : "");
+    Lock(&g_ringLock);
+    TraceRing* ring = CurrentRing();
+    if (ring) SetRingName(ring);
+    Unlock(&g_ringLock);
+}
+
+void Trace_ReleaseThread(void) {
+    t_name[0] = '\0';
+    Lock(&g_ringLock);
+    TraceRing* ring = CurrentRing();
+    if (ring) ring->inUse = 0;
+    Unlock(&g_ringLock);
+    t_ring = NULL;
+}
+
+bool Trace_ExportChrome(const char* path) {
+    if (!path) return false;
+
+    FILE* f = fopen(path, "w");
+    if (!f) return false;
+
+    TraceEvent* copy = (TraceEvent*)MemTracker_Alloc(MEM_TAG_DIAGNOSTICS, sizeof(TraceEvent) * TRACE_RING_EVENTS);
+    if (!copy) {
+        fclose(f);
+        return false;
+    }
+
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    double ticksPerUs = (double)Clock_Frequency() / 1000000.0;
+
+    // Only Trace_Shutdown frees rings (never during an export), so the list
+    // can be walked after dropping the lock
+    Lock(&g_ringLock);
+    int ringCount = g_ringCount;
+    Unlock(&g_ringLock);
+
+    for (int r = 0; r < ringCount; r++) {
+        TraceRing* ring = g_rings[r];
+        char name[TRACE_NAME_SIZE];
+        Lock(&g_ringLock);
+        memcpy(name, ring->name, sizeof(name));
+        uint64_t firstEvent = ring->firstEvent;
+        uint32_t threadId = ring->threadId;
+        Unlock(&g_ringLock);
+
+        // Copy the ring, then drop whatever the writer may have overwritten
+        // meanwhile (it is always writing slot 'head')
+        uint64_t end = LoadAcquire(&ring->head);
+        uint64_t start = end > TRACE_RING_EVENTS ? end - TRACE_RING_EVENTS : 0;
+        if (start < firstEvent) start = firstEvent;
+        for (uint64_t i = start; i < end; i++) {
+            copy[i - start] = ring->events[i & TRACE_RING_MASK];
+        }
+        uint64_t after = LoadAcquire(&ring->head);
+        if (after >= TRACE_RING_EVENTS && after - TRACE_RING_EVENTS + 1 > start) {
+            uint64_t safe = after - TRACE_RING_EVENTS + 1;
+            if (safe > end) safe = end;
+            memmove(copy, copy + (safe - start), (size_t)(end - safe) * sizeof(TraceEvent));
+            start = safe;
+        }
+        int count = (int)(end - start);
+        if (count <= 0) continue;
+
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s (%u)\"}}",
+                first ? "" : ",\n", r + 1, name, threadId);
+        first = false;
+
+        int depth = 0;
+        for (int i = 0; i < count; i++) {
+            const TraceEvent* e = &copy[i];
+            const char* ph = "i";
+            if (e->phase == TRACE_PHASE_BEGIN) {
+                ph = "B";
+                depth++;
+            } else if (e->phase == TRACE_PHASE_END) {
+                if (depth == 0) continue;   // Its begin fell off the ring
+                ph = "E";
+                depth--;
+            }
+            fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"pipeline\",\"ph\":\"%s\",%s\"ts\":%.1f,\"pid\":1,\"tid\":%d,\"args\":{\"id\":%llu}}",
+                    Trace_StageName((TraceStage)e->stage), ph,
+                    e->phase == TRACE_PHASE_INSTANT ? "\"s\":\"t\"," : "",
+                    (double)(e->time - g_origin) / ticksPerUs, r + 1, (unsigned long long)e->id);
+        }
+    }
+
+    fprintf(f, "\n]}\n");
+    MemTracker_Free(copy);
+    bool ok = ferror(f) == 0;
+    if (fclose(f) != 0) ok = false;
+    return ok;
+}
+
+void Trace_Shutdown(void) {
+    g_traceEnabled = 0;
+    Lock(&g_ringLock);
+    for (int i = 0; i < g_ringCount; i++) {
+        MemTracker_Free(g_rings[i]);
+        g_rings[i] = NULL;
+    }
+    g_ringCount = 0;
+    g_generation++;
+    Unlock(&g_ringLock);
+    t_ring = NULL;
+}
+
+const char* Trace_StageName(TraceStage stage) {
+    if (stage < 0 || stage >= TRACE_STAGE_COUNT) return "?";
+    return g_stageNames[stage];
+}
@@ -0,0 +1,78 @@
+/*
+ * Trace - Per-thread event rings with Chrome trace (Perfetto) export
+ * Portable C
+ *
+ * Each thread that emits gets its own fixed-size ring of binary events
+ * (time, stage, begin/end/instant, frame id). Emitting is a thread-local
+ * lookup, a clock read and a 24-byte store - no locks, no formatting. When
+ * tracing is off the TRACE_* macros cost a single branch.
+ *
+ * Trace_ExportChrome writes the recent history of every thread as Chrome
+ * trace JSON (load in chrome://tracing or ui.perfetto.dev) so a hitch can be
+ * followed from grab to buffer on each thread's timeline.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#define TRACE_RING_EVENTS   16384   // Per thread (power of two), ~25s at 60 fps
+#define TRACE_MAX_THREADS   32
+
+typedef enum {
+    TRACE_GRAB = 0,         // Hub producer: desktop frame copied
+    TRACE_ACQUIRE,          // Consumer took a delivery
+    TRACE_CONVERT,          // Color conversion (incl. CPU readback)
+    TRACE_SUBMIT,           // Encoder submit call
+    TRACE_ENCODE,           // Encoder worker: frame encoded / fetched
+    TRACE_OUTPUT,           // Encoded frame stored in the buffer
+    TRACE_DROP,             // Frame dropped by backpressure
+    TRACE_AUDIO_READ,
+    TRACE_AUDIO_ENCODE,
+    TRACE_EVICT,            // Buffer evicted old samples (id = count)
+    TRACE_SAVE,             // Whole save
+    TRACE_SAVE_COPY,        // Copying samples out of the buffers
+    TRACE_SAVE_MUX,         // Writing the MP4
+    TRACE_STAGE_COUNT
+} TraceStage;
+
+typedef enum {
+    TRACE_PHASE_BEGIN = 0,
+    TRACE_PHASE_END,
+    TRACE_PHASE_INSTANT
+} TracePhase;
+
+// Read by the macros; use Trace_Enable to change
+extern volatile int g_traceEnabled;
+
+#define TRACE_BEGIN(stage, id)   do { if (g_traceEnabled) Trace_Emit(TRACE_PHASE_BEGIN, (stage), (uint64_t)(id)); } while (0)
+#define TRACE_END(stage, id)     do { if (g_traceEnabled) Trace_Emit(TRACE_PHASE_END, (stage), (uint64_t)(id)); } while (0)
+#define TRACE_INSTANT(stage, id) do { if (g_traceEnabled) Trace_Emit(TRACE_PHASE_INSTANT, (stage), (uint64_t)(id)); } while (0)
+
+void Trace_Enable(bool enabled);
+bool Trace_IsEnabled(void);
+
+// Record an event on the calling thread's ring (use the macros)
+void Trace_Emit(TracePhase phase, TraceStage stage, uint64_t id);
+
+// Name the calling thread in exported traces (copied, truncated to 31 chars)
+void Trace_SetThreadName(const char* name);
+
+// Calling thread is exiting: its ring keeps its events for export until the
+// next thread that needs a ring takes it over
+void Trace_ReleaseThread(void);
+
+// Write every ring as Chrome trace JSON. Safe while threads keep emitting
+// (events overwritten during the copy are skipped).
+bool Trace_ExportChrome(const char* path);
+
+// Free all rings (no thread may be emitting). Threads that held one attach
+// a new ring on their next event.
+void Trace_Shutdown(void);
+
+const char* Trace_StageName(TraceStage stage);
+
+#endif // TRACE_H
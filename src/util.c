@@ -43,6 +43,17 @@ UINT32 Util_CalculateBitrate(int width, int height, int fps, QualityPreset quali
     return bitrate;
 }
 
+int Util_QualityToQP(QualityPreset quality) {
+    // Lower QP = higher quality
+    switch (quality) {
+        case QUALITY_LOW:      return 28;
+        case QUALITY_MEDIUM:   return 24;
+        case QUALITY_HIGH:     return 20;
+        case QUALITY_LOSSLESS: return 16;
+        default:               return 24;
+    }
+}
+
 // Calculate precise timestamp for a frame (avoids cumulative rounding errors)
 LONGLONG Util_CalculateTimestamp(int frameNumber, int fps) {
     // Using exact division: (frame * 10000000) / fps
@@ -106,6 +117,8 @@ RECT Util_CalculateAspectRect(RECT sourceBounds, int ratioW, int ratioH) {
     return result;
 }
 
+#ifdef _WIN32
+
 // ============================================================================
 // String Conversion Utilities
 // ============================================================================
@@ -125,3 +138,5 @@ int Util_Utf8ToWide(const char* utf8, WCHAR* wide, int maxLen) {
     if (result > 0) result--;  // Exclude null terminator from count
     return result;
 }
+
+#endif
@@ -6,7 +6,7 @@
 #ifndef UTIL_H
 #define UTIL_H
 
-#include <windows.h>
+#include "platform.h"
 #include "config.h"
 
 // Media Foundation time units (100-nanosecond intervals)
@@ -17,6 +17,9 @@
 // Returns bitrate in bits per second
 UINT32 Util_CalculateBitrate(int width, int height, int fps, QualityPreset quality);
 
+// Map a quality preset to the constant QP used by all encoder backends
+int Util_QualityToQP(QualityPreset quality);
+
 // Calculate precise timestamp for a frame (avoids cumulative rounding errors)
 // Returns timestamp in 100-ns units
 LONGLONG Util_CalculateTimestamp(int frameNumber, int fps);
@@ -33,6 +36,8 @@ RECT Util_CalculateAspectRect(RECT sourceBounds, int ratioW, int ratioH);
 // Index: 0=Native, 1=16:9, 2=9:16, 3=1:1, 4=4:5, 5=16:10, 6=4:3, 7=21:9, 8=32:9
 void Util_GetAspectRatioDimensions(int aspectIndex, int* ratioW, int* ratioH);
 
+#ifdef _WIN32
+
 // ============================================================================
 // String Conversion Utilities
 // ============================================================================
@@ -45,4 +50,6 @@ int Util_WideToUtf8(const WCHAR* wide, char* utf8, int maxLen);
 // Returns number of characters written (excluding null terminator), or 0 on failure
 int Util_Utf8ToWide(const char* utf8, WCHAR* wide, int maxLen);
 
+#endif
+
 #endif // UTIL_H
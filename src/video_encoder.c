@@ -0,0 +1,225 @@
+/*
+ * Video Encoder Interface Implementation
+ * Backend selection and dispatch to NVENC / software encoders
+ */
+
+#include "video_encoder.h"
+#include "nvenc_encoder.h"
+#include "sw_encoder.h"
+#include "logger.h"
+#include <stdlib.h>
+
+#define EncLog Logger_Log
+
+// ============================================================================
+// NVENC backend
+// ============================================================================
+
+static void Nvenc_SetCallback(void* impl, EncodedFrameCallback callback, void* userData) {
+    NVENCEncoder_SetCallback((NVENCEncoder*)impl, callback, userData);
+}
+
+static void Nvenc_SetQueueGauge(void* impl, FlightRecorderGauge gauge) {
+    NVENCEncoder_SetQueueGauge((NVENCEncoder*)impl, gauge);
+}
+
+static BOOL Nvenc_SubmitTexture(void* impl, ID3D11Texture2D* nv12Texture, LONGLONG timestamp) {
+    return NVENCEncoder_SubmitTexture((NVENCEncoder*)impl, nv12Texture, timestamp);
+}
+
+static int Nvenc_DrainCompleted(void* impl, EncodedFrameCallback callback, void* userData) {
+    return NVENCEncoder_DrainCompleted((NVENCEncoder*)impl, callback, userData);
+}
+
+static BOOL Nvenc_Flush(void* impl, EncodedFrame* outFrame) {
+    return NVENCEncoder_Flush((NVENCEncoder*)impl, outFrame);
+}
+
+static BOOL Nvenc_GetSequenceHeader(void* impl, BYTE* buffer, DWORD bufferSize, DWORD* outSize) {
+    return NVENCEncoder_GetSequenceHeader((NVENCEncoder*)impl, buffer, bufferSize, outSize);
+}
+
+static BOOL Nvenc_Reconfigure(void* impl, const EncoderParams* params) {
+    return NVENCEncoder_Reconfigure((NVENCEncoder*)impl, params);
+}
+
+static void Nvenc_GetStats(void* impl, int* framesEncoded, double* avgEncodeTimeMs) {
+    NVENCEncoder_GetStats((NVENCEncoder*)impl, framesEncoded, avgEncodeTimeMs);
+}
+
+static void Nvenc_Destroy(void* impl) {
+    NVENCEncoder_Destroy((NVENCEncoder*)impl);
+}
+
+static const VideoEncoderOps s_nvencOps = {
+    "NVENC",
+    Nvenc_SetCallback,
+    Nvenc_SetQueueGauge,
+    Nvenc_SubmitTexture,
+    NULL,
+    Nvenc_DrainCompleted,
+    Nvenc_Flush,
+    Nvenc_GetSequenceHeader,
+    Nvenc_Reconfigure,
+    Nvenc_GetStats,
+    Nvenc_Destroy
+};
+
+// ============================================================================
+// Software backend
+// ============================================================================
+
+static void Software_SetCallback(void* impl, EncodedFrameCallback callback, void* userData) {
+    SWEncoder_SetCallback((SWEncoder*)impl, callback, userData);
+}
+
+static void Software_SetQueueGauge(void* impl, FlightRecorderGauge gauge) {
+    SWEncoder_SetQueueGauge((SWEncoder*)impl, gauge);
+}
+
+static BOOL Software_SubmitNV12(void* impl, const BYTE* yPlane, int yPitch,
+                                const BYTE* uvPlane, int uvPitch, LONGLONG timestamp) {
+    return SWEncoder_SubmitNV12((SWEncoder*)impl, yPlane, yPitch, uvPlane, uvPitch, timestamp);
+}
+
+static BOOL Software_Flush(void* impl, EncodedFrame* outFrame) {
+    return SWEncoder_Flush((SWEncoder*)impl, outFrame);
+}
+
+static BOOL Software_GetSequenceHeader(void* impl, BYTE* buffer, DWORD bufferSize, DWORD* outSize) {
+    return SWEncoder_GetSequenceHeader((SWEncoder*)impl, buffer, bufferSize, outSize);
+}
+
+static BOOL Software_Reconfigure(void* impl, const EncoderParams* params) {
+    return SWEncoder_Reconfigure((SWEncoder*)impl, params);
+}
+
+static void Software_GetStats(void* impl, int* framesEncoded, double* avgEncodeTimeMs) {
+    SWEncoder_GetStats((SWEncoder*)impl, framesEncoded, avgEncodeTimeMs);
+}
+
+static void Software_Destroy(void* impl) {
+    SWEncoder_Destroy((SWEncoder*)impl);
+}
+
+static const VideoEncoderOps s_softwareOps = {
+    "Software",
+    Software_SetCallback,
+    Software_SetQueueGauge,
+    NULL,
+    Software_SubmitNV12,
+    NULL,
+    Software_Flush,
+    Software_GetSequenceHeader,
+    Software_Reconfigure,
+    Software_GetStats,
+    Software_Destroy
+};
+
+// ============================================================================
+// Public API
+// ============================================================================
+
+VideoEncoder* VideoEncoder_Create(EncoderBackend backend, ID3D11Device* d3dDevice,
+                                  int width, int height, int fps, QualityPreset quality) {
+    VideoEncoder* enc = (VideoEncoder*)calloc(1, sizeof(VideoEncoder));
+    if (!enc) return NULL;
+
+    enc->width = width;
+    enc->height = height;
+    enc->fps = fps;
+
+    // NVENC: explicit, or auto when an NVIDIA GPU is usable
+    if (backend == ENCODER_BACKEND_NVENC ||
+        (backend == ENCODER_BACKEND_AUTO && d3dDevice && NVENCEncoder_IsAvailable())) {
+        NVENCEncoder* nvenc = d3dDevice ? NVENCEncoder_Create(d3dDevice, width, height, fps, quality) : NULL;
+        if (nvenc) {
+            enc->ops = &s_nvencOps;
+            enc->impl = nvenc;
+            enc->backend = ENCODER_BACKEND_NVENC;
+            enc->inputType = ENCODER_INPUT_D3D11_NV12;
+            enc->codec = VIDEO_CODEC_HEVC;
+            enc->maxInFlight = NVENC_NUM_BUFFERS;
+            EncLog("VideoEncoder: Using NVENC backend\n");
+            return enc;
+        }
+        if (backend == ENCODER_BACKEND_NVENC) {
+            EncLog("VideoEncoder: NVENC requested but unavailable\n");
+            free(enc);
+            return NULL;
+        }
+        EncLog("VideoEncoder: NVENC init failed, falling back to software\n");
+    }
+
+    SWEncoder* sw = SWEncoder_Create(width, height, fps, quality);
+    if (!sw) {
+        EncLog("VideoEncoder: Software encoder unavailable\n");
+        free(enc);
+        return NULL;
+    }
+
+    enc->ops = &s_softwareOps;
+    enc->impl = sw;
+    enc->backend = ENCODER_BACKEND_SOFTWARE;
+    enc->inputType = ENCODER_INPUT_CPU_NV12;
+    enc->codec = SWEncoder_GetCodec(sw);
+    enc->maxInFlight = SW_NUM_BUFFERS;
+    EncLog("VideoEncoder: Using software backend (%s)\n", enc->codec == VIDEO_CODEC_HEVC ? "HEVC" : "H.264");
+    return enc;
+}
+
+void VideoEncoder_SetCallback(VideoEncoder* enc, EncodedFrameCallback callback, void* userData) {
+    if (!enc) return;
+    enc->ops->setCallback(enc->impl, callback, userData);
+}
+
+void VideoEncoder_SetQueueGauge(VideoEncoder* enc, FlightRecorderGauge gauge) {
+    if (!enc) return;
+    enc->ops->setQueueGauge(enc->impl, gauge);
+}
+
+BOOL VideoEncoder_SubmitTexture(VideoEncoder* enc, ID3D11Texture2D* nv12Texture, LONGLONG timestamp) {
+    if (!enc || !enc->ops->submitTexture) return FALSE;
+    return enc->ops->submitTexture(enc->impl, nv12Texture, timestamp);
+}
+
+BOOL VideoEncoder_SubmitNV12(VideoEncoder* enc, const BYTE* yPlane, int yPitch,
+                             const BYTE* uvPlane, int uvPitch, LONGLONG timestamp) {
+    if (!enc || !enc->ops->submitNV12) return FALSE;
+    return enc->ops->submitNV12(enc->impl, yPlane, yPitch, uvPlane, uvPitch, timestamp);
+}
+
+int VideoEncoder_DrainCompleted(VideoEncoder* enc, EncodedFrameCallback callback, void* userData) {
+    if (!enc || !enc->ops->drainCompleted) return 0;
+    return enc->ops->drainCompleted(enc->impl, callback, userData);
+}
+
+BOOL VideoEncoder_Flush(VideoEncoder* enc, EncodedFrame* outFrame) {
+    if (!enc) return FALSE;
+    return enc->ops->flush(enc->impl, outFrame);
+}
+
+BOOL VideoEncoder_GetSequenceHeader(VideoEncoder* enc, BYTE* buffer, DWORD bufferSize, DWORD* outSize) {
+    if (!enc) return FALSE;
+    return enc->ops->getSequenceHeader(enc->impl, buffer, bufferSize, outSize);
+}
+
+BOOL VideoEncoder_Reconfigure(VideoEncoder* enc, const EncoderParams* params) {
+    if (!enc || !enc->ops->reconfigure) return FALSE;
+    return enc->ops->reconfigure(enc->impl, params);
+}
+
+void VideoEncoder_GetStats(VideoEncoder* enc, int* framesEncoded, double* avgEncodeTimeMs) {
+    if (!enc) return;
+    enc->ops->getStats(enc->impl, framesEncoded, avgEncodeTimeMs);
+}
+
+const char* VideoEncoder_GetName(VideoEncoder* enc) {
+    return enc ? enc->ops->name : "None";
+}
+
+void VideoEncoder_Destroy(VideoEncoder* enc) {
+    if (!enc) return;
+    enc->ops->destroy(enc->impl);
+    free(enc);
+}
@@ -0,0 +1,124 @@
+/*
+ * Video Encoder Interface
+ * Backend-neutral encoder API used by the replay and recording pipelines
+ *
+ * Backends:
+ * - NVENC (nvenc_encoder.c): GPU, consumes D3D11 NV12 textures
+ * - Software (sw_encoder.c): CPU Media Foundation MFT, consumes system-memory NV12
+ *
+ * All backends deliver EncodedFrame via callback from their own worker thread.
+ */
+
+#ifndef VIDEO_ENCODER_H
+#define VIDEO_ENCODER_H
+
+#include "platform.h"
+#include "config.h"
+#include "flight_recorder.h"
+
+#ifdef _WIN32
+#include <d3d11.h>
+#else
+// Texture input is Windows-only; elsewhere the D3D types are opaque
+typedef struct ID3D11Device ID3D11Device;
+typedef struct ID3D11Texture2D ID3D11Texture2D;
+#endif
+
+typedef struct {
+    BYTE* data;
+    DWORD size;
+    LONGLONG timestamp;
+    LONGLONG duration;
+    BOOL isKeyframe;
+} EncodedFrame;
+
+// Callback for receiving completed frames (called from encoder output thread)
+// Callee may take ownership of frame->data by setting it to NULL
+typedef void (*EncodedFrameCallback)(EncodedFrame* frame, void* userData);
+
+// Input a backend expects
+typedef enum {
+    ENCODER_INPUT_D3D11_NV12 = 0,   // ID3D11Texture2D (NV12) on the capture device
+    ENCODER_INPUT_CPU_NV12          // NV12 planes in system memory
+} EncoderInputType;
+
+// Default timeline distance between IDR frames (all backends)
+#define VIDEO_ENCODER_KEYFRAME_MS 2000
+
+// Runtime-adjustable parameters (0 = leave unchanged)
+typedef struct {
+    int qp;                     // Constant QP for P frames (I frames use qp - 4)
+    int keyframeIntervalMs;     // Timeline distance between forced IDR frames
+} EncoderParams;
+
+typedef struct VideoEncoder VideoEncoder;
+
+// Backend operations table (one per implementation)
+typedef struct {
+    const char* name;
+    void (*setCallback)(void* impl, EncodedFrameCallback callback, void* userData);
+    void (*setQueueGauge)(void* impl, FlightRecorderGauge gauge);
+    BOOL (*submitTexture)(void* impl, ID3D11Texture2D* nv12Texture, LONGLONG timestamp);
+    BOOL (*submitNV12)(void* impl, const BYTE* yPlane, int yPitch, const BYTE* uvPlane, int uvPitch, LONGLONG timestamp);
+    int  (*drainCompleted)(void* impl, EncodedFrameCallback callback, void* userData);
+    BOOL (*flush)(void* impl, EncodedFrame* outFrame);
+    BOOL (*getSequenceHeader)(void* impl, BYTE* buffer, DWORD bufferSize, DWORD* outSize);
+    BOOL (*reconfigure)(void* impl, const EncoderParams* params);
+    void (*getStats)(void* impl, int* framesEncoded, double* avgEncodeTimeMs);
+    void (*destroy)(void* impl);
+} VideoEncoderOps;
+
+struct VideoEncoder {
+    const VideoEncoderOps* ops;
+    void* impl;
+    EncoderBackend backend;
+    EncoderInputType inputType;
+    VideoCodec codec;
+    int width;
+    int height;
+    int fps;
+    int maxInFlight;            // Submitted frames the backend holds before refusing more
+};
+
+// Create an encoder. ENCODER_BACKEND_AUTO tries NVENC first, then software.
+// d3dDevice is required for NVENC and ignored by the software backend.
+VideoEncoder* VideoEncoder_Create(EncoderBackend backend, ID3D11Device* d3dDevice,
+                                  int width, int height, int fps, QualityPreset quality);
+
+// Set callback for completed frames
+void VideoEncoder_SetCallback(VideoEncoder* enc, EncodedFrameCallback callback, void* userData);
+
+// Flight recorder gauge that tracks this encoder's in-flight frames, so the
+// replay and recording encoders don't overwrite each other's depth
+// (default FR_GAUGE_REPLAY_ENCODER_QUEUE)
+void VideoEncoder_SetQueueGauge(VideoEncoder* enc, FlightRecorderGauge gauge);
+
+// Submit a frame. Use the variant matching enc->inputType; the other returns FALSE.
+// Both copy the input, so the caller can reuse it immediately.
+BOOL VideoEncoder_SubmitTexture(VideoEncoder* enc, ID3D11Texture2D* nv12Texture, LONGLONG timestamp);
+BOOL VideoEncoder_SubmitNV12(VideoEncoder* enc, const BYTE* yPlane, int yPitch,
+                             const BYTE* uvPlane, int uvPitch, LONGLONG timestamp);
+
+// Drain completed frames manually (no-op for callback-driven backends)
+int VideoEncoder_DrainCompleted(VideoEncoder* enc, EncodedFrameCallback callback, void* userData);
+
+// Flush pending frames. Returns TRUE while frames are returned in outFrame.
+BOOL VideoEncoder_Flush(VideoEncoder* enc, EncodedFrame* outFrame);
+
+// Get codec parameter sets (VPS/SPS/PPS for HEVC, SPS/PPS for H.264), Annex-B
+// May fail until the first keyframe for backends that emit them in-band only.
+BOOL VideoEncoder_GetSequenceHeader(VideoEncoder* enc, BYTE* buffer, DWORD bufferSize, DWORD* outSize);
+
+// Change QP / keyframe interval while encoding
+BOOL VideoEncoder_Reconfigure(VideoEncoder* enc, const EncoderParams* params);
+
+// Stats
+void VideoEncoder_GetStats(VideoEncoder* enc, int* framesEncoded, double* avgEncodeTimeMs);
+
+// Backend display name ("NVENC", "Software")
+const char* VideoEncoder_GetName(VideoEncoder* enc);
+
+// Cleanup
+void VideoEncoder_Destroy(VideoEncoder* enc);
+
+#endif // VIDEO_ENCODER_H
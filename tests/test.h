@@ -0,0 +1,50 @@
+/*
+ * Test - Minimal assertions for the lwsr-core unit tests
+ * Portable C; each test is its own executable, run by ctest
+ *
+ * CHECK records a failure and carries on, so one run reports every broken
+ * expectation. main() returns TEST_RESULT().
+ */
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <math.h>
+
+static int g_testChecks = 0;
+static int g_testFailures = 0;
+
+#define CHECK(cond) do { \
+    g_testChecks++; \
+    if (!(cond)) { \
+        g_testFailures++; \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    } \
+} while (0)
+
+// Integers, printed on failure
+#define CHECK_EQ(actual, expected) do { \
+    long long a_ = (long long)(actual), e_ = (long long)(expected); \
+    g_testChecks++; \
+    if (a_ != e_) { \
+        g_testFailures++; \
+        fprintf(stderr, "%s:%d: %s == %lld, expected %s == %lld\n", \
+                __FILE__, __LINE__, #actual, a_, #expected, e_); \
+    } \
+} while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) do { \
+    double a_ = (double)(actual), e_ = (double)(expected); \
+    g_testChecks++; \
+    if (fabs(a_ - e_) > (tolerance)) { \
+        g_testFailures++; \
+        fprintf(stderr, "%s:%d: %s == %g, expected %g +- %g\n", \
+                __FILE__, __LINE__, #actual, a_, e_, (double)(tolerance)); \
+    } \
+} while (0)
+
+#define TEST_RESULT() (printf("%d checks, %d failed\n", g_testChecks, g_testFailures), \
+                       g_testFailures ? 1 : 0)
+
+#endif // TEST_H
@@ -0,0 +1,166 @@
+/*
+ * Backpressure tests - admission against a stand-in encoder with configurable
+ * service time and pipeline latency
+ */
+
+#include "test.h"
+#include "backpressure.h"
+#include <string.h>
+
+#define INTERVAL    166667      // 60 fps, 100-ns units
+#define RING        8
+
+// One frame at a time, 'service' each, then 'latency' more in the pipeline
+// (which doesn't hold up the next frame); frames complete in submit order
+typedef struct {
+    int64_t timestamps[64];
+    int64_t completions[64];
+    int head;
+    int count;
+    int64_t free;               // When the encoder finishes its queue
+    int64_t service;
+    int64_t latency;
+} StandIn;
+
+static void StandIn_Submit(StandIn* enc, int64_t timestamp, int64_t now) {
+    int64_t start = enc->free > now ? enc->free : now;
+    enc->free = start + enc->service;
+    int slot = (enc->head + enc->count) % 64;
+    enc->timestamps[slot] = timestamp;
+    enc->completions[slot] = enc->free + enc->latency;
+    enc->count++;
+}
+
+static void StandIn_Deliver(StandIn* enc, Backpressure* bp, int64_t now) {
+    while (enc->count > 0 && enc->completions[enc->head] <= now) {
+        Backpressure_Completed(bp, enc->timestamps[enc->head], enc->completions[enc->head]);
+        enc->head = (enc->head + 1) % 64;
+        enc->count--;
+    }
+}
+
+// Run 'frames' capture ticks; returns the longest run of consecutive drops
+static int Run(Backpressure* bp, StandIn* enc, int frames) {
+    int run = 0, longest = 0;
+    for (int i = 0; i < frames; i++) {
+        int64_t now = (int64_t)i * INTERVAL;
+        StandIn_Deliver(enc, bp, now);
+        if (Backpressure_Admit(bp, now, now) == DROP_NONE) {
+            Backpressure_SubmitResult(bp, now, now, true);
+            StandIn_Submit(enc, now, now);
+            run = 0;
+        } else if (++run > longest) {
+            longest = run;
+        }
+    }
+    return longest;
+}
+
+// Encoder faster than the frame rate: nothing is dropped
+static void TestKeepsUp(void) {
+    Backpressure* bp = Backpressure_Create(RING, INTERVAL);
+    StandIn enc;
+    memset(&enc, 0, sizeof(enc));
+    enc.service = INTERVAL / 2;
+
+    Run(bp, &enc, 600);
+    BackpressureStats stats;
+    Backpressure_GetStats(bp, &stats);
+    CHECK_EQ(stats.dropped[DROP_PACED] + stats.dropped[DROP_FULL] + stats.dropped[DROP_REJECTED], 0);
+    CHECK_EQ(stats.submitted, 600);
+    CHECK(stats.completed >= 599);
+    CHECK_NEAR(stats.latencyAvg, INTERVAL / 2, INTERVAL / 20);
+    CHECK_NEAR(stats.dropRatio, 0.0, 0);
+    CHECK(stats.targetDepth >= 1 && stats.targetDepth <= RING);
+    CHECK_EQ(stats.gaps, 0);
+    Backpressure_Destroy(bp);
+}
+
+// Deep pipeline with throughput to spare: the in-flight depth grows to
+// cover the latency instead of dropping frames
+static void TestHighLatency(void) {
+    Backpressure* bp = Backpressure_Create(RING, INTERVAL);
+    StandIn enc;
+    memset(&enc, 0, sizeof(enc));
+    enc.service = INTERVAL / 2;
+    enc.latency = INTERVAL * 3;
+
+    Run(bp, &enc, 600);
+    BackpressureStats stats;
+    Backpressure_GetStats(bp, &stats);
+    CHECK_EQ(stats.dropped[DROP_PACED] + stats.dropped[DROP_FULL] + stats.dropped[DROP_REJECTED], 0);
+    CHECK_EQ(stats.submitted, 600);
+    CHECK_NEAR(stats.latencyAvg, INTERVAL * 7 / 2, INTERVAL / 20);
+    CHECK_EQ(stats.targetDepth, 5);     // ceil(3.5 intervals) + the frame being captured
+    CHECK(stats.inFlight <= stats.targetDepth);
+    CHECK_NEAR(stats.dropRatio, 0.0, 0);
+    CHECK_EQ(stats.gaps, 0);
+    Backpressure_Destroy(bp);
+}
+
+// 1.5x overload: about one frame in three dropped, spread out rather than
+// in bursts, and every drop is on the gap timeline
+static void TestOverload(void) {
+    Backpressure* bp = Backpressure_Create(RING, INTERVAL);
+    StandIn enc;
+    memset(&enc, 0, sizeof(enc));
+    enc.service = INTERVAL * 3 / 2;
+
+    int longest = Run(bp, &enc, 1200);
+    BackpressureStats stats;
+    Backpressure_GetStats(bp, &stats);
+    uint64_t dropped = stats.dropped[DROP_PACED] + stats.dropped[DROP_FULL];
+    CHECK_NEAR((double)dropped / 1200, 1.0 / 3, 0.05);
+    CHECK(stats.dropped[DROP_PACED] > stats.dropped[DROP_FULL]);
+    CHECK_NEAR(stats.dropRatio, 1.0 / 3, 0.05);
+    CHECK(longest <= 2);
+    CHECK_EQ(stats.gapTime, (int64_t)dropped * INTERVAL);
+    CHECK(stats.inFlight <= RING);
+
+    TimelineGap gaps[BACKPRESSURE_GAP_HISTORY];
+    int count = Backpressure_GetGaps(bp, gaps, BACKPRESSURE_GAP_HISTORY);
+    CHECK(count > 0);
+    for (int i = 1; i < count; i++) CHECK(gaps[i].start > gaps[i - 1].start);
+    Backpressure_Destroy(bp);
+}
+
+// Rejected submits and frames the encoder never returns are gaps too
+static void TestRejected(void) {
+    Backpressure* bp = Backpressure_Create(RING, INTERVAL);
+
+    CHECK_EQ(Backpressure_Admit(bp, 0, 0), DROP_NONE);
+    Backpressure_SubmitResult(bp, 0, 0, false);
+    BackpressureStats stats;
+    Backpressure_GetStats(bp, &stats);
+    CHECK_EQ(stats.dropped[DROP_REJECTED], 1);
+    CHECK_EQ(stats.inFlight, 0);
+
+    // Frame 1 never comes back; frame 2's completion accounts for it
+    for (int i = 1; i <= 2; i++) {
+        CHECK_EQ(Backpressure_Admit(bp, i * INTERVAL, i * INTERVAL), DROP_NONE);
+        Backpressure_SubmitResult(bp, i * INTERVAL, i * INTERVAL, true);
+    }
+    Backpressure_Completed(bp, 2 * INTERVAL, 3 * INTERVAL);
+    Backpressure_GetStats(bp, &stats);
+    CHECK_EQ(stats.dropped[DROP_REJECTED], 2);
+    CHECK_EQ(stats.completed, 1);
+    CHECK_EQ(stats.inFlight, 0);
+
+    // Adjacent drops merge into one gap
+    TimelineGap gaps[4];
+    CHECK_EQ(Backpressure_GetGaps(bp, gaps, 4), 1);
+    CHECK_EQ(gaps[0].frames, 2);
+    CHECK_EQ(gaps[0].start, 0);
+    CHECK_EQ(gaps[0].end, 2 * INTERVAL);
+    CHECK_EQ(gaps[0].reason, DROP_REJECTED);
+    Backpressure_Destroy(bp);
+}
+
+int main(void) {
+    TestKeepsUp();
+    TestHighLatency();
+    TestOverload();
+    TestRejected();
+    CHECK(Backpressure_Create(0, INTERVAL) == NULL);
+    return TEST_RESULT();
+}
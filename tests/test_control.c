@@ -0,0 +1,128 @@
+/*
+ * Control tests - request parsing and the job queue
+ */
+
+#include "test.h"
+#include "control.h"
+#include <string.h>
+
+static bool Parse(const char* line, ControlCommand* command) {
+    char error[128];
+    return Control_Parse(line, command, error, sizeof(error));
+}
+
+static void TestParse(void) {
+    ControlCommand c;
+
+    CHECK(Parse("start", &c) && c.type == CONTROL_START);
+    CHECK(Parse("  STATUS  ", &c) && c.type == CONTROL_STATUS);
+    CHECK(Parse("quit", &c) && c.type == CONTROL_QUIT);
+    CHECK(!Parse("", &c));
+    CHECK(!Parse("bogus", &c));
+    CHECK(!Parse("stop now", &c));
+
+    CHECK(Parse("save", &c));
+    CHECK(c.type == CONTROL_SAVE && c.path[0] == '\0' && c.seconds == 0);
+    CHECK(Parse("save clip.mp4 30", &c));
+    CHECK(strcmp(c.path, "clip.mp4") == 0);
+    CHECK_EQ(c.seconds, 30);
+    CHECK(Parse("save 45", &c));
+    CHECK(c.path[0] == '\0');
+    CHECK_EQ(c.seconds, 45);
+    CHECK(Parse("save \"C:\\My Clips\\a.mp4\"", &c));
+    CHECK(strcmp(c.path, "C:\\My Clips\\a.mp4") == 0);
+
+    // A bare number is always the clip length, and must be in range
+    char error[128];
+    CHECK(!Control_Parse("save 0", &c, error, sizeof(error)));
+    CHECK(strstr(error, "seconds") != NULL);
+    CHECK(!Parse("save 90000", &c));
+    CHECK(!Parse("save 10 20", &c));
+    CHECK(!Parse("save a.mp4 b.mp4", &c));
+
+    CHECK(Parse("result 7", &c) && c.id == 7);
+    CHECK(!Parse("result", &c));
+    CHECK(!Parse("result x", &c));
+    CHECK(!Parse("result 1 2", &c));
+
+    CHECK(Parse("reconfigure fps=60 quality=high vfr=off memory=512", &c));
+    CHECK_EQ(c.settings.fps, 60);
+    CHECK_EQ(c.settings.quality, 2);
+    CHECK_EQ(c.settings.vfr, 0);
+    CHECK_EQ(c.settings.memoryMB, 512);
+    CHECK_EQ(c.settings.durationSeconds, -1);
+    CHECK_EQ(c.settings.audio, -1);
+    CHECK_EQ(c.settings.monitor, -1);
+    CHECK(!Parse("reconfigure", &c));
+    CHECK(!Parse("reconfigure fps=10", &c));
+    CHECK(!Parse("reconfigure colour=blue", &c));
+    CHECK(!Parse("reconfigure fps", &c));
+}
+
+static void TestQueue(void) {
+    ControlQueue* queue = ControlQueue_Create();
+    CHECK(queue != NULL);
+    char response[CONTROL_RESPONSE_SIZE];
+
+    ControlQueue_Handle(queue, "save clip.mp4 10", response, sizeof(response));
+    CHECK(strstr(response, "\"ok\":true,\"id\":1,\"command\":\"save\"") != NULL);
+    ControlQueue_Handle(queue, "restart", response, sizeof(response));
+    CHECK(strstr(response, "\"id\":2") != NULL);
+    CHECK(strstr(response, "\"ahead\":1") != NULL);
+    CHECK(ControlQueue_Wait(queue, 0));
+
+    // Jobs run in order
+    ControlJob job;
+    CHECK(ControlQueue_Take(queue, &job));
+    CHECK_EQ(job.id, 1);
+    CHECK_EQ(job.state, CONTROL_JOB_RUNNING);
+    CHECK_EQ(job.command.seconds, 10);
+    ControlQueue_Finish(queue, job.id, true, "clip.mp4");
+
+    ControlQueue_Handle(queue, "result 1", response, sizeof(response));
+    CHECK(strstr(response, "\"state\":\"done\"") != NULL);
+    CHECK(strstr(response, "\"seconds\":10") != NULL);
+    CHECK(strstr(response, "\"detail\":\"clip.mp4\"") != NULL);
+
+    CHECK(ControlQueue_Take(queue, &job));
+    CHECK_EQ(job.id, 2);
+    ControlQueue_Finish(queue, job.id, false, "buffer thread did not exit");
+    CHECK(ControlQueue_GetJob(queue, 2, &job));
+    CHECK_EQ(job.state, CONTROL_JOB_FAILED);
+    CHECK(!ControlQueue_Take(queue, &job));
+
+    ControlQueue_Handle(queue, "result 99", response, sizeof(response));
+    CHECK(strstr(response, "\"error\":\"unknown job\"") != NULL);
+    ControlQueue_Handle(queue, "frobnicate", response, sizeof(response));
+    CHECK(strstr(response, "\"ok\":false") != NULL);
+
+    // Bounded: beyond CONTROL_MAX_PENDING waiting jobs, requests are refused
+    for (int i = 0; i < CONTROL_MAX_PENDING; i++) {
+        ControlQueue_Handle(queue, "stop", response, sizeof(response));
+        CHECK(strstr(response, "\"ok\":true") != NULL);
+    }
+    ControlQueue_Handle(queue, "stop", response, sizeof(response));
+    CHECK(strstr(response, "\"error\":\"busy\"") != NULL);
+    ControlCommand restart;
+    memset(&restart, 0, sizeof(restart));
+    restart.type = CONTROL_RESTART;
+    CHECK_EQ(ControlQueue_Post(queue, &restart), 0);
+
+    ControlQueue_Handle(queue, "status", response, sizeof(response));
+    CHECK(strstr(response, "\"queued\":16") != NULL);
+    CHECK(strstr(response, "\"completed\":1,\"failed\":1,\"refused\":2") != NULL);
+
+    // Responses follow snprintf rules when truncated
+    char small[16];
+    int length = ControlQueue_Handle(queue, "status", small, sizeof(small));
+    CHECK(length >= (int)sizeof(small));
+    CHECK(strlen(small) == sizeof(small) - 1);
+
+    ControlQueue_Destroy(queue);
+}
+
+int main(void) {
+    TestParse();
+    TestQueue();
+    return TEST_RESULT();
+}
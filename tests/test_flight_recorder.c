@@ -0,0 +1,179 @@
+/*
+ * Flight Recorder tests - FlightRecorder_Dump after event ring wrap-around,
+ * gauge peaks and a thread stalled past its stage deadline
+ *
+ * Runs on the real clock: the stall case sleeps past FR_STAGE_DEADLINE_MS.
+ */
+
+#include "test.h"
+#include "flight_recorder.h"
+#include "platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define EXTRA_EVENTS 100
+
+typedef struct {
+    PlatformEvent* staged;      // Set once in its stage
+    PlatformEvent* finish;
+} StallArgs;
+
+// Dump into a temporary file and read it back as one string
+static char* DumpToString(void) {
+    FILE* f = tmpfile();
+    if (!f) return NULL;
+    FlightRecorder_Dump(f);
+    long size = ftell(f);
+    rewind(f);
+    char* text = (char*)malloc((size_t)size + 1);
+    size_t read = fread(text, 1, (size_t)size, f);
+    text[read] = '\0';
+    fclose(f);
+    return text;
+}
+
+// The dump line starting with 'prefix' (after indentation), copied into line
+static bool FindLine(const char* text, const char* prefix, char* line, size_t size) {
+    const char* p = text;
+    while (p && *p) {
+        const char* end = strchr(p, '\n');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        const char* start = p;
+        while (*start == ' ' && start < p + len) start++;
+        if (strncmp(start, prefix, strlen(prefix)) == 0) {
+            if (len >= size) len = size - 1;
+            memcpy(line, p, len);
+            line[len] = '\0';
+            return true;
+        }
+        p = end ? end + 1 : NULL;
+    }
+    return false;
+}
+
+// More events than the ring holds: the dump lists the newest
+// FLIGHT_RECORDER_EVENTS, oldest first
+static void TestEventWrap(void) {
+    FlightRecorder_RegisterThread("Replay");
+    int total = FLIGHT_RECORDER_EVENTS + EXTRA_EVENTS;
+    for (int i = 0; i < total; i++) FlightRecorder_Event(FR_EVENT_ERROR, i, -i);
+    FlightRecorder_Event(FR_EVENT_COUNT, 0, 0);     // Ignored
+
+    char* text = DumpToString();
+    CHECK(text != NULL);
+    if (!text) return;
+    char line[256];
+    CHECK(FindLine(text, "Events (", line, sizeof(line)));
+    unsigned long long recorded = 0, last = 0;
+    CHECK_EQ(sscanf(strchr(line, '('), "(%llu recorded, last %llu", &recorded, &last), 2);
+    CHECK_EQ(recorded, total);
+    CHECK_EQ(last, FLIGHT_RECORDER_EVENTS);
+
+    int lines = 0;
+    long long expected = EXTRA_EVENTS;
+    bool ordered = true, attributed = true;
+    for (const char* p = strstr(text, " error "); p; p = strstr(p + 1, " error ")) {
+        const char* code = strstr(p, "code=");
+        if (!code || atoll(code + 5) != expected) ordered = false;
+        const char* lineStart = p;
+        while (lineStart > text && lineStart[-1] != '\n') lineStart--;
+        if (!strstr(lineStart, "Replay") || strstr(lineStart, "Replay") > p) attributed = false;
+        expected++;
+        lines++;
+    }
+    CHECK_EQ(lines, FLIGHT_RECORDER_EVENTS);
+    CHECK(ordered);
+    CHECK(attributed);
+    free(text);
+    FlightRecorder_ReleaseThread();
+}
+
+static void TestGauges(void) {
+    FlightRecorder_SetGauge(FR_GAUGE_VIDEO_SAMPLES, 5);
+    FlightRecorder_SetGauge(FR_GAUGE_VIDEO_SAMPLES, 12);
+    FlightRecorder_SetGauge(FR_GAUGE_VIDEO_SAMPLES, 3);
+    FlightRecorder_SetGauge(FR_GAUGE_REPLAY_ENCODER_QUEUE, 4);
+    FlightRecorder_SetGauge(FR_GAUGE_COUNT, 99);                // Ignored
+
+    char* text = DumpToString();
+    CHECK(text != NULL);
+    if (!text) return;
+    char line[256];
+    long long current = -1, peak = -1;
+    CHECK(FindLine(text, "video samples", line, sizeof(line)));
+    CHECK_EQ(sscanf(strstr(line, "samples") + 7, "%lld %lld", &current, &peak), 2);
+    CHECK_EQ(current, 3);
+    CHECK_EQ(peak, 12);
+    CHECK(FindLine(text, "replay enc queue", line, sizeof(line)));
+    CHECK_EQ(sscanf(strstr(line, "queue") + 5, "%lld %lld", &current, &peak), 2);
+    CHECK_EQ(current, 4);
+    CHECK_EQ(peak, 4);
+    CHECK(FindLine(text, "audio buffered", line, sizeof(line)));
+    CHECK_EQ(sscanf(strstr(line, "buffered") + 8, "%lld %lld", &current, &peak), 2);
+    CHECK_EQ(peak, 0);
+    free(text);
+}
+
+static void StallThread(void* param) {
+    StallArgs* args = (StallArgs*)param;
+    FlightRecorder_RegisterThread("Encoder");
+    FlightRecorder_SetStage("encode", FR_STAGE_DEADLINE_MS);
+    Platform_EventSet(args->staged);
+    Platform_EventWait(args->finish, 30000);
+    FlightRecorder_ReleaseThread();
+}
+
+// One thread stuck in a stage past FR_STAGE_DEADLINE_MS, one that keeps
+// entering its stage (heartbeat), one idle without a deadline
+static void TestStall(void) {
+    PlatformEvent staged, finish;
+    Platform_EventCreate(&staged, true, false);
+    Platform_EventCreate(&finish, true, false);
+    StallArgs args = { &staged, &finish };
+    PlatformThread thread;
+    CHECK(Platform_ThreadCreate(&thread, StallThread, &args));
+    CHECK(Platform_EventWait(&staged, 5000));
+
+    FlightRecorder_RegisterThread("Capture");
+    int waited = 0;
+    while (waited < FR_STAGE_DEADLINE_MS + 300) {
+        FlightRecorder_SetStage("grab", FR_STAGE_DEADLINE_MS);
+        Platform_SleepMs(100);
+        waited += 100;
+    }
+    FlightRecorderStall stalls[4];
+    CHECK_EQ(FlightRecorder_GetStalls(stalls, 4), 1);
+    CHECK_EQ(strcmp(stalls[0].name, "Encoder"), 0);
+    CHECK_EQ(strcmp(stalls[0].stage, "encode"), 0);
+    CHECK(stalls[0].elapsedMs > FR_STAGE_DEADLINE_MS);
+    CHECK_EQ(stalls[0].deadlineMs, FR_STAGE_DEADLINE_MS);
+
+    FlightRecorder_SetStage("wait", FR_NO_DEADLINE);
+    char* text = DumpToString();
+    CHECK(text != NULL);
+    if (text) {
+        char line[256];
+        CHECK(FindLine(text, "Encoder", line, sizeof(line)));
+        CHECK(strstr(line, "encode") != NULL);
+        CHECK(strstr(line, "(deadline 2.0s) STALLED") != NULL);
+        CHECK(FindLine(text, "Capture", line, sizeof(line)));
+        CHECK(strstr(line, "wait") != NULL);
+        CHECK(strstr(line, "STALLED") == NULL);
+        CHECK(strstr(line, "deadline") == NULL);
+        free(text);
+    }
+
+    Platform_EventSet(&finish);
+    Platform_ThreadJoin(&thread);
+    CHECK_EQ(FlightRecorder_GetStalls(stalls, 4), 0);           // Slot released
+    FlightRecorder_ReleaseThread();
+    Platform_EventDestroy(&staged);
+    Platform_EventDestroy(&finish);
+}
+
+int main(void) {
+    TestEventWrap();
+    TestGauges();
+    TestStall();
+    return TEST_RESULT();
+}
@@ -0,0 +1,147 @@
+/*
+ * Frame Hub tests - fan-out of a synthetic frame source
+ *
+ * The hub runs on the real clock, so rates are checked with slack for a
+ * loaded machine; the invariants (no copies per consumer, a stalled
+ * consumer loses only its own frames, removal wakes a waiter) are exact.
+ */
+
+#include "test.h"
+#include "frame_hub.h"
+#include "frame_source.h"
+#include "platform.h"
+#include <string.h>
+
+#define WIDTH   320
+#define HEIGHT  180
+#define FPS     60
+#define RUN_MS  1000
+
+typedef struct {
+    FrameHub* hub;
+    HubConsumer* consumer;
+    int acquired;
+    bool result;
+} Waiter;
+
+static void WaitForever(void* param) {
+    Waiter* w = (Waiter*)param;
+    HubDelivery delivery;
+    w->result = FrameHub_Acquire(w->hub, w->consumer, PLATFORM_WAIT_INFINITE, &delivery);
+    if (w->result) FrameHub_Release(w->hub, delivery.frame);
+    w->acquired = 1;
+}
+
+// A 60 fps consumer reads every frame while a 15 fps one stalls: the
+// stalled one drops its own oldest frames, the fast one loses nothing,
+// and every new frame is grabbed once however many consumers share it
+static void TestFanOut(FrameSource* src) {
+    FrameHubSource hubSource;
+    FrameSource_GetHubSource(src, &hubSource);
+    FrameHub* hub = FrameHub_Create(&hubSource);
+    CHECK(hub != NULL);
+
+    HubConsumerConfig fastConfig = { "fast", FPS, 4, { 0, 0, 0, 0 } };
+    HubConsumerConfig slowConfig = { "slow", FPS / 4, 2, { 16, 16, 64, 64 } };
+    HubConsumer* fast = FrameHub_AddConsumer(hub, &fastConfig);
+    HubConsumer* slow = FrameHub_AddConsumer(hub, &slowConfig);
+    CHECK(fast != NULL && slow != NULL);
+    CHECK_EQ(FrameHub_GetConsumerCount(hub), 2);
+
+    HubRect region = FrameHub_GetRegion(hub);
+    CHECK_EQ(region.width, WIDTH);
+    CHECK_EQ(region.height, HEIGHT);
+    HubRect crop = FrameHub_GetCrop(slow);
+    CHECK_EQ(crop.x, 16);
+    CHECK_EQ(crop.width, 64);
+
+    int64_t end = FrameHub_Now() + (int64_t)RUN_MS * FRAME_HUB_UNITS_PER_SECOND / 1000;
+    uint64_t lastSequence = 0;
+    int changed = 0;
+    bool ordered = true;
+    while (FrameHub_Now() < end) {
+        HubDelivery delivery;
+        if (!FrameHub_Acquire(hub, fast, 100, &delivery)) continue;
+        CHECK(delivery.frame->payload != NULL);
+        CHECK_EQ(delivery.frame->width, WIDTH);
+        if (delivery.frame->sequence < lastSequence) ordered = false;
+        lastSequence = delivery.frame->sequence;
+        if (delivery.changed) changed++;
+        FrameHub_Release(hub, delivery.frame);
+    }
+    CHECK(ordered);
+
+    HubConsumerStats fastStats, slowStats;
+    FrameHub_GetConsumerStats(hub, fast, &fastStats);
+    FrameHub_GetConsumerStats(hub, slow, &slowStats);
+    HubStats stats;
+    FrameHub_GetStats(hub, &stats);
+
+    int expected = FPS * RUN_MS / 1000;
+    CHECK(fastStats.delivered >= (uint64_t)expected / 2 && fastStats.delivered <= (uint64_t)expected + 2);
+    CHECK_EQ(fastStats.dropped, 0);
+    CHECK(fastStats.consumed + 4 >= fastStats.delivered);
+    CHECK(changed > 0);
+
+    // Decimated to a quarter, and everything past its mailbox was dropped
+    CHECK(slowStats.delivered >= fastStats.delivered / 8);
+    CHECK(slowStats.delivered <= fastStats.delivered / 4 + 2);
+    CHECK_EQ(slowStats.consumed, 0);
+    CHECK_EQ(slowStats.dropped + 2, slowStats.delivered);
+
+    // The pattern has static periods: those ticks re-deliver without a copy
+    CHECK(stats.grabsSame > 0);
+    CHECK(stats.grabsNew + stats.grabsSame + stats.grabsNone == stats.ticks);
+    CHECK(stats.poolSlots <= (4 + 1) + (2 + 1) + 2);
+
+    FramePacerStats pacer;
+    FrameHub_GetPacerStats(hub, &pacer);
+    CHECK(pacer.ticks > 0);
+
+    FrameHub_RemoveConsumer(hub, slow);
+    FrameHub_RemoveConsumer(hub, fast);
+    CHECK_EQ(FrameHub_GetConsumerCount(hub), 0);
+    FrameHub_Destroy(hub);
+}
+
+// Removing a consumer wakes a thread blocked in Acquire on it
+static void TestRemoveWakes(FrameSource* src) {
+    FrameHubSource hubSource;
+    FrameSource_GetHubSource(src, &hubSource);
+    FrameHub* hub = FrameHub_Create(&hubSource);
+
+    // Two consumers, so the pool outlives the removal. The 1 fps waiter takes
+    // its first delivery (due at once), so the next is a second away
+    HubConsumerConfig otherConfig = { "other", FPS, 0, { 0, 0, 0, 0 } };
+    HubConsumerConfig config = { "waiter", 1, 1, { 0, 0, 0, 0 } };
+    HubConsumer* other = FrameHub_AddConsumer(hub, &otherConfig);
+    Waiter waiter = { hub, FrameHub_AddConsumer(hub, &config), 0, true };
+    HubDelivery delivery;
+    CHECK(FrameHub_Acquire(hub, waiter.consumer, 500, &delivery));
+    FrameHub_Release(hub, delivery.frame);
+
+    PlatformThread thread;
+    CHECK(Platform_ThreadCreate(&thread, WaitForever, &waiter));
+    Platform_SleepMs(50);
+    FrameHub_RemoveConsumer(hub, waiter.consumer);
+    for (int i = 0; i < 200 && !waiter.acquired; i++) Platform_SleepMs(10);
+    CHECK(waiter.acquired);
+    if (waiter.acquired) Platform_ThreadJoin(&thread);
+    CHECK(!waiter.result);
+
+    FrameHub_RemoveConsumer(hub, other);
+    FrameHub_Destroy(hub);
+}
+
+int main(void) {
+    // Alternating half seconds of motion and stillness
+    PatternConfig pattern = { WIDTH, HEIGHT, FRAME_FORMAT_BGRA, FPS, 4, FPS / 2, FPS / 2, 0 };
+    FrameSource* src = FrameSource_CreatePattern(&pattern);
+    CHECK(src != NULL);
+    if (!src) return TEST_RESULT();
+
+    TestFanOut(src);
+    TestRemoveWakes(src);
+    FrameSource_Destroy(src);
+    return TEST_RESULT();
+}
@@ -0,0 +1,97 @@
+/*
+ * Frame Pacer tests - deadline grid, jitter accounting and interrupts
+ *
+ * Runs on the real clock: deadlines must sit exactly on the grid, lateness
+ * is only checked against a bound a loaded machine still meets.
+ */
+
+#include "test.h"
+#include "frame_pacer.h"
+
+#define UNITS FRAME_PACER_UNITS_PER_SECOND
+
+// 100 fps for half a second: every deadline met is start + k / 100 exactly,
+// and a deadline's wake is never early
+static void TestGrid(void) {
+    FramePacer* pacer = FramePacer_Create(100, 1);
+    CHECK(pacer != NULL);
+    int64_t start = FramePacer_Now() + UNITS / 100;
+    FramePacer_Reset(pacer, start);
+    CHECK_EQ(FramePacer_NextDeadline(pacer), start);
+
+    bool onGrid = true, early = false;
+    int64_t deadline = 0;
+    for (int i = 0; i < 50; i++) {
+        CHECK(FramePacer_Wait(pacer, &deadline));
+        if ((deadline - start) % (UNITS / 100) != 0) onGrid = false;
+        if (FramePacer_Now() < deadline) early = true;
+    }
+    CHECK(onGrid);
+    CHECK(!early);
+
+    FramePacerStats stats;
+    FramePacer_GetStats(pacer, &stats);
+    CHECK_EQ(stats.ticks, 50);
+    CHECK_EQ(deadline, start + (int64_t)(stats.ticks + stats.missed - 1) * (UNITS / 100));
+    CHECK(stats.jitterMin >= 0);
+    CHECK(stats.jitterTotal / (int64_t)stats.ticks < UNITS / 200);     // Mean under 5 ms
+
+    uint64_t bucketed = 0;
+    for (int i = 0; i < FRAME_PACER_JITTER_BUCKETS; i++) bucketed += stats.histogram[i];
+    CHECK_EQ(bucketed, stats.ticks);
+    FramePacer_Destroy(pacer);
+}
+
+// A rate that doesn't divide the clock: 30000/1001 fps comes back to an
+// exact 1001 s boundary after 30000 frames without accumulating rounding
+static void TestFractionalRate(void) {
+    FramePacer* pacer = FramePacer_Create(30000, 1001);
+    int64_t start = FramePacer_Now() - 2000 * UNITS;   // Far enough back that every deadline is due
+    FramePacer_Reset(pacer, start);
+
+    int64_t deadline = 0;
+    PacerHandle handle = FramePacer_Arm(pacer);
+    (void)handle;
+    FramePacer_Complete(pacer, &deadline);
+    CHECK_EQ(deadline, start);
+
+    // Every deadline up to now was missed: the next one is the first in the future
+    FramePacerStats stats;
+    FramePacer_GetStats(pacer, &stats);
+    int64_t next = FramePacer_NextDeadline(pacer);
+    int64_t frames = (int64_t)stats.missed + 1;
+    CHECK_EQ(next, start + (frames / 30000) * 1001 * UNITS + (frames % 30000) * 1001 * UNITS / 30000);
+    CHECK(next > FramePacer_Now() - UNITS);
+
+    // After a tick, a rate change puts the next deadline one new interval
+    // after the last one met
+    FramePacer_SetRate(pacer, 50, 1);
+    CHECK_EQ(FramePacer_NextDeadline(pacer), start + UNITS / 50);
+    FramePacer_Destroy(pacer);
+}
+
+// Interrupt makes the pending (or next) Wait return false without advancing
+static void TestInterrupt(void) {
+    FramePacer* pacer = FramePacer_Create(1, 1);
+    FramePacer_Reset(pacer, FramePacer_Now() + 10 * UNITS);
+    int64_t before = FramePacer_NextDeadline(pacer);
+
+    FramePacer_Interrupt(pacer);
+    int64_t t0 = FramePacer_Now();
+    int64_t deadline = 0;
+    CHECK(!FramePacer_Wait(pacer, &deadline));
+    CHECK(FramePacer_Now() - t0 < UNITS);
+    CHECK_EQ(FramePacer_NextDeadline(pacer), before);
+
+    // Before the first tick a rate change keeps the first deadline due
+    FramePacer_SetRate(pacer, 50, 1);
+    CHECK_EQ(FramePacer_NextDeadline(pacer), before);
+    FramePacer_Destroy(pacer);
+}
+
+int main(void) {
+    TestGrid();
+    TestFractionalRate();
+    TestInterrupt();
+    return TEST_RESULT();
+}
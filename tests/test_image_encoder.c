@@ -0,0 +1,466 @@
+/*
+ * Image Encoder tests - PNG and QOI round trips on small synthetic frames
+ *
+ * The PNG is checked chunk by chunk (CRC-32), its zlib stream is inflated
+ * here (stored and Huffman blocks, Adler-32) and the rows unfiltered; the
+ * QOI stream is decoded op by op. Both must give back the source pixels.
+ */
+
+#include "test.h"
+#include "image_encoder.h"
+#include <stdlib.h>
+#include <string.h>
+
+// ============================================================================
+// Source frames
+// ============================================================================
+
+// BGRA with a row pitch wider than the row. Flat areas, a gradient and
+// noise, so PNG picks different filters and QOI emits runs, diffs and
+// index hits.
+static uint8_t* MakeFrame(int width, int height, int pitch, uint32_t seed) {
+    uint8_t* bgra = (uint8_t*)malloc((size_t)pitch * height);
+    memset(bgra, 0xCD, (size_t)pitch * height);
+    for (int y = 0; y < height; y++) {
+        uint8_t* row = bgra + (size_t)y * pitch;
+        for (int x = 0; x < width; x++) {
+            uint8_t* p = row + x * 4;
+            if (y < height / 3) {
+                p[0] = 40; p[1] = 90; p[2] = 200;
+                if (x % 17 == 3) p[1] = (uint8_t)(90 + y % 3);
+            } else if (y < 2 * height / 3) {
+                p[0] = (uint8_t)(x * 3); p[1] = (uint8_t)(y * 2); p[2] = (uint8_t)(x + y);
+            } else {
+                seed = seed * 1664525u + 1013904223u;
+                p[0] = (uint8_t)(seed >> 8); p[1] = (uint8_t)(seed >> 16); p[2] = (uint8_t)(seed >> 24);
+            }
+            p[3] = (uint8_t)(x * 7);    // Ignored by both encoders
+        }
+    }
+    return bgra;
+}
+
+// RGB of the source pixel, as both formats store it
+static bool SamePixels(const uint8_t* rgb, const uint8_t* bgra, int width, int height, int pitch) {
+    for (int y = 0; y < height; y++) {
+        const uint8_t* src = bgra + (size_t)y * pitch;
+        const uint8_t* dst = rgb + (size_t)y * width * 3;
+        for (int x = 0; x < width; x++) {
+            if (dst[x * 3] != src[x * 4 + 2] || dst[x * 3 + 1] != src[x * 4 + 1] || dst[x * 3 + 2] != src[x * 4]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static uint32_t ReadBE32(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+// ============================================================================
+// Inflate (RFC 1951)
+// ============================================================================
+
+typedef struct {
+    const uint8_t* in;
+    size_t inSize;
+    size_t pos;
+    uint32_t bits;
+    int bitCount;
+    uint8_t* out;
+    size_t outSize;
+    size_t outCap;
+    bool error;
+} Inflater;
+
+typedef struct {
+    uint16_t counts[16];        // Codes of each length
+    uint16_t symbols[320];      // Symbols ordered by code
+} Huffman;
+
+static int Bits(Inflater* s, int need) {
+    while (s->bitCount < need) {
+        if (s->pos >= s->inSize) {
+            s->error = true;
+            return 0;
+        }
+        s->bits |= (uint32_t)s->in[s->pos++] << s->bitCount;
+        s->bitCount += 8;
+    }
+    int value = (int)(s->bits & ((1u << need) - 1));
+    s->bits >>= need;
+    s->bitCount -= need;
+    return value;
+}
+
+static void Put(Inflater* s, uint8_t byte) {
+    if (s->outSize == s->outCap) {
+        s->error = true;
+        return;
+    }
+    s->out[s->outSize++] = byte;
+}
+
+static void BuildHuffman(Huffman* h, const uint8_t* lengths, int count) {
+    uint16_t offsets[16];
+    memset(h->counts, 0, sizeof(h->counts));
+    for (int i = 0; i < count; i++) h->counts[lengths[i]]++;
+    h->counts[0] = 0;
+    offsets[1] = 0;
+    for (int len = 1; len < 15; len++) offsets[len + 1] = offsets[len] + h->counts[len];
+    for (int i = 0; i < count; i++) {
+        if (lengths[i]) h->symbols[offsets[lengths[i]]++] = (uint16_t)i;
+    }
+}
+
+// Canonical decode one bit at a time (codes are stored MSB first)
+static int Decode(Inflater* s, const Huffman* h) {
+    int code = 0, first = 0, index = 0;
+    for (int len = 1; len < 16; len++) {
+        code |= Bits(s, 1);
+        int count = h->counts[len];
+        if (code - count < first) return h->symbols[index + (code - first)];
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+        if (s->error) return -1;
+    }
+    s->error = true;
+    return -1;
+}
+
+static void InflateCodes(Inflater* s, const Huffman* lit, const Huffman* dist) {
+    static const uint16_t lenBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                          35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    static const uint8_t lenExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                          3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    static const uint16_t distBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                           257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                           8193, 12289, 16385, 24577 };
+    static const uint8_t distExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                           7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    for (;;) {
+        int symbol = Decode(s, lit);
+        if (s->error || symbol == 256) return;
+        if (symbol < 256) {
+            Put(s, (uint8_t)symbol);
+            continue;
+        }
+        symbol -= 257;
+        if (symbol >= 29) {
+            s->error = true;
+            return;
+        }
+        int length = lenBase[symbol] + Bits(s, lenExtra[symbol]);
+        int d = Decode(s, dist);
+        if (s->error || d >= 30) {
+            s->error = true;
+            return;
+        }
+        size_t distance = distBase[d] + (size_t)Bits(s, distExtra[d]);
+        if (distance > s->outSize) {
+            s->error = true;
+            return;
+        }
+        for (int i = 0; i < length && !s->error; i++) Put(s, s->out[s->outSize - distance]);
+    }
+}
+
+static void InflateDynamic(Inflater* s) {
+    static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+    int litCount = Bits(s, 5) + 257;
+    int distCount = Bits(s, 5) + 1;
+    int codeCount = Bits(s, 4) + 4;
+    uint8_t lengths[320] = {0};
+    for (int i = 0; i < codeCount; i++) lengths[order[i]] = (uint8_t)Bits(s, 3);
+    Huffman lenCode;
+    BuildHuffman(&lenCode, lengths, 19);
+
+    memset(lengths, 0, sizeof(lengths));
+    int n = 0;
+    while (n < litCount + distCount && !s->error) {
+        int symbol = Decode(s, &lenCode);
+        if (symbol < 0) return;
+        if (symbol < 16) {
+            lengths[n++] = (uint8_t)symbol;
+            continue;
+        }
+        uint8_t value = 0;
+        int repeat;
+        if (symbol == 16) {
+            if (n == 0) {
+                s->error = true;
+                return;
+            }
+            value = lengths[n - 1];
+            repeat = 3 + Bits(s, 2);
+        } else if (symbol == 17) {
+            repeat = 3 + Bits(s, 3);
+        } else {
+            repeat = 11 + Bits(s, 7);
+        }
+        if (n + repeat > litCount + distCount) {
+            s->error = true;
+            return;
+        }
+        while (repeat--) lengths[n++] = value;
+    }
+    if (s->error) return;
+
+    Huffman lit, dist;
+    BuildHuffman(&lit, lengths, litCount);
+    BuildHuffman(&dist, lengths + litCount, distCount);
+    InflateCodes(s, &lit, &dist);
+}
+
+static void InflateFixed(Inflater* s) {
+    uint8_t lengths[320];
+    int i = 0;
+    for (; i < 144; i++) lengths[i] = 8;
+    for (; i < 256; i++) lengths[i] = 9;
+    for (; i < 280; i++) lengths[i] = 7;
+    for (; i < 288; i++) lengths[i] = 8;
+    for (; i < 318; i++) lengths[i] = 5;
+    Huffman lit, dist;
+    BuildHuffman(&lit, lengths, 288);
+    BuildHuffman(&dist, lengths + 288, 30);
+    InflateCodes(s, &lit, &dist);
+}
+
+static void InflateStored(Inflater* s) {
+    s->bits = 0;
+    s->bitCount = 0;    // Byte aligned from here
+    if (s->pos + 4 > s->inSize) {
+        s->error = true;
+        return;
+    }
+    unsigned len = s->in[s->pos] | s->in[s->pos + 1] << 8;
+    unsigned nlen = s->in[s->pos + 2] | s->in[s->pos + 3] << 8;
+    s->pos += 4;
+    if ((len ^ 0xFFFF) != nlen || s->pos + len > s->inSize) {
+        s->error = true;
+        return;
+    }
+    for (unsigned i = 0; i < len; i++) Put(s, s->in[s->pos + i]);
+    s->pos += len;
+}
+
+// Inflate a zlib stream into out (exactly outCap bytes expected). Checks the
+// header and the Adler-32 trailer.
+static bool ZlibInflate(const uint8_t* in, size_t inSize, uint8_t* out, size_t outCap) {
+    if (inSize < 6 || (in[0] & 0x0F) != 8 || ((in[0] << 8) | in[1]) % 31 != 0 || (in[1] & 0x20)) return false;
+    Inflater s = { in, inSize, 2, 0, 0, out, 0, outCap, false };
+    int last = 0;
+    while (!last && !s.error) {
+        last = Bits(&s, 1);
+        int type = Bits(&s, 2);
+        if (type == 0) InflateStored(&s);
+        else if (type == 1) InflateFixed(&s);
+        else if (type == 2) InflateDynamic(&s);
+        else s.error = true;
+    }
+    if (s.error || s.outSize != outCap || s.pos + 4 > inSize) return false;
+
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < outCap; i++) {
+        a = (a + out[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    return ReadBE32(in + s.pos) == (b << 16 | a);
+}
+
+// ============================================================================
+// PNG
+// ============================================================================
+
+static uint32_t Crc32(const uint8_t* data, size_t size) {
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static uint8_t PaethPredict(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return (uint8_t)a;
+    return (uint8_t)(pb <= pc ? b : c);
+}
+
+// Decode an 8-bit RGB PNG into rgb (width * height * 3). Every chunk's CRC
+// must match; IDAT chunks are joined and inflated as one zlib stream.
+static bool DecodePNG(const EncodedImage* image, int width, int height, uint8_t* rgb, int* idatCount) {
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    if (image->size < 8 || memcmp(image->data, signature, 8) != 0) return false;
+
+    uint8_t* zdata = (uint8_t*)malloc(image->size);
+    size_t zsize = 0;
+    bool header = false, end = false, ok = true;
+    *idatCount = 0;
+    size_t pos = 8;
+    while (ok && !end && pos + 12 <= image->size) {
+        uint32_t len = ReadBE32(image->data + pos);
+        const uint8_t* type = image->data + pos + 4;
+        const uint8_t* body = type + 4;
+        if (pos + 12 + len > image->size || Crc32(type, len + 4) != ReadBE32(body + len)) {
+            ok = false;
+            break;
+        }
+        if (memcmp(type, "IHDR", 4) == 0) {
+            // 8-bit truecolor, deflate, adaptive filtering, no interlace
+            header = len == 13 && ReadBE32(body) == (uint32_t)width && ReadBE32(body + 4) == (uint32_t)height &&
+                     body[8] == 8 && body[9] == 2 && body[10] == 0 && body[11] == 0 && body[12] == 0;
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            memcpy(zdata + zsize, body, len);
+            zsize += len;
+            (*idatCount)++;
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            end = true;
+        }
+        pos += 12 + len;
+    }
+    ok = ok && header && end && pos == image->size;
+
+    size_t stride = (size_t)width * 3 + 1;
+    uint8_t* raw = (uint8_t*)malloc(stride * height);
+    ok = ok && ZlibInflate(zdata, zsize, raw, stride * height);
+
+    for (int y = 0; ok && y < height; y++) {
+        uint8_t filter = raw[y * stride];
+        const uint8_t* cur = raw + y * stride + 1;
+        uint8_t* dst = rgb + (size_t)y * width * 3;
+        const uint8_t* up = y > 0 ? dst - (size_t)width * 3 : NULL;
+        for (int i = 0; i < width * 3; i++) {
+            int a = i >= 3 ? dst[i - 3] : 0;
+            int b = up ? up[i] : 0;
+            int c = up && i >= 3 ? up[i - 3] : 0;
+            switch (filter) {
+            case 0: dst[i] = cur[i]; break;
+            case 1: dst[i] = (uint8_t)(cur[i] + a); break;
+            case 2: dst[i] = (uint8_t)(cur[i] + b); break;
+            case 3: dst[i] = (uint8_t)(cur[i] + (a + b) / 2); break;
+            case 4: dst[i] = (uint8_t)(cur[i] + PaethPredict(a, b, c)); break;
+            default: ok = false; break;
+            }
+        }
+    }
+    free(raw);
+    free(zdata);
+    return ok;
+}
+
+// ============================================================================
+// QOI
+// ============================================================================
+
+static bool DecodeQOI(const EncodedImage* image, int width, int height, uint8_t* rgb) {
+    const uint8_t* p = image->data;
+    size_t size = image->size;
+    if (size < 14 + 8 || memcmp(p, "qoif", 4) != 0) return false;
+    if (ReadBE32(p + 4) != (uint32_t)width || ReadBE32(p + 8) != (uint32_t)height || p[12] != 3) return false;
+
+    uint8_t index[64][4];
+    memset(index, 0, sizeof(index));
+    uint8_t px[4] = { 0, 0, 0, 255 };
+    size_t pos = 14;
+    size_t end = size - 8;
+    int run = 0;
+    size_t pixels = (size_t)width * height;
+    for (size_t n = 0; n < pixels; n++) {
+        if (run > 0) {
+            run--;
+        } else {
+            if (pos >= end) return false;
+            uint8_t op = p[pos++];
+            if (op == 0xFE) {
+                if (pos + 3 > end) return false;
+                memcpy(px, p + pos, 3);
+                pos += 3;
+            } else if (op == 0xFF) {
+                if (pos + 4 > end) return false;
+                memcpy(px, p + pos, 4);
+                pos += 4;
+            } else if ((op & 0xC0) == 0x00) {
+                memcpy(px, index[op], 4);
+            } else if ((op & 0xC0) == 0x40) {
+                px[0] = (uint8_t)(px[0] + ((op >> 4) & 3) - 2);
+                px[1] = (uint8_t)(px[1] + ((op >> 2) & 3) - 2);
+                px[2] = (uint8_t)(px[2] + (op & 3) - 2);
+            } else if ((op & 0xC0) == 0x80) {
+                if (pos >= end) return false;
+                int dg = (op & 0x3F) - 32;
+                uint8_t next = p[pos++];
+                px[0] = (uint8_t)(px[0] + dg - 8 + (next >> 4));
+                px[1] = (uint8_t)(px[1] + dg);
+                px[2] = (uint8_t)(px[2] + dg - 8 + (next & 0x0F));
+            } else {
+                run = op & 0x3F;
+            }
+            memcpy(index[(px[0] * 3 + px[1] * 5 + px[2] * 7 + px[3] * 11) % 64], px, 4);
+        }
+        memcpy(rgb + n * 3, px, 3);
+    }
+
+    static const uint8_t padding[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+    return run == 0 && pos == end && memcmp(p + end, padding, 8) == 0;
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+static void TestPNG(int width, int height, int threads) {
+    int pitch = width * 4 + 12;
+    uint8_t* bgra = MakeFrame(width, height, pitch, (uint32_t)(width + threads));
+    uint8_t* rgb = (uint8_t*)malloc((size_t)width * height * 3);
+
+    EncodedImage image;
+    CHECK(ImageEncoder_EncodePNG(bgra, width, height, pitch, threads, &image));
+    int idatCount = 0;
+    CHECK(DecodePNG(&image, width, height, rgb, &idatCount));
+    CHECK(SamePixels(rgb, bgra, width, height, pitch));
+    CHECK(idatCount >= 1);
+    ImageEncoder_Free(&image);
+    CHECK(image.data == NULL);
+
+    free(rgb);
+    free(bgra);
+}
+
+static void TestQOI(int width, int height) {
+    int pitch = width * 4 + 12;
+    uint8_t* bgra = MakeFrame(width, height, pitch, (uint32_t)width);
+    uint8_t* rgb = (uint8_t*)malloc((size_t)width * height * 3);
+
+    EncodedImage image;
+    CHECK(ImageEncoder_EncodeQOI(bgra, width, height, pitch, &image));
+    CHECK(DecodeQOI(&image, width, height, rgb));
+    CHECK(SamePixels(rgb, bgra, width, height, pitch));
+    // The flat third is long runs: under raw RGB once past the header
+    if (width * height >= 64) CHECK(image.size < (size_t)width * height * 3);
+    ImageEncoder_Free(&image);
+
+    free(rgb);
+    free(bgra);
+}
+
+static void TestFormatFromPath(void) {
+    CHECK_EQ(ImageEncoder_FormatFromPath("shot.qoi"), IMAGE_FORMAT_QOI);
+    CHECK_EQ(ImageEncoder_FormatFromPath("C:\\shots\\shot.QOI"), IMAGE_FORMAT_QOI);
+    CHECK_EQ(ImageEncoder_FormatFromPath("shot.png"), IMAGE_FORMAT_PNG);
+    CHECK_EQ(ImageEncoder_FormatFromPath("shot"), IMAGE_FORMAT_PNG);
+}
+
+int main(void) {
+    TestPNG(97, 61, 1);         // One strip
+    TestPNG(97, 61, 4);         // Parallel strips, each its own IDAT
+    TestPNG(1, 1, 0);
+    TestPNG(300, 7, 3);         // Fewer rows than strips
+    TestQOI(97, 61);
+    TestQOI(1, 1);
+    TestFormatFromPath();
+    return TEST_RESULT();
+}
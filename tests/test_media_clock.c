@@ -0,0 +1,130 @@
+/*
+ * Media Clock tests - 100-ns conversions, pause/resume, fake-source
+ * stepping and the drift check the AAC encoder resyncs on
+ */
+
+#include "test.h"
+#include "media_clock.h"
+#include "frame_pacer.h"
+#include "platform.h"
+
+#define UNITS MEDIA_CLOCK_UNITS_PER_SECOND
+
+// The AAC encoder's resync threshold (aac_encoder.c)
+#define AAC_RESYNC_THRESHOLD (40 * MEDIA_CLOCK_UNITS_PER_SECOND / 1000)
+
+// System source: starts at 0, never goes backwards, and moves with the
+// frame pacer's clock in 100-ns units
+static void TestSystemClock(void) {
+    MediaClock clock;
+    MediaClock_Init(&clock, NULL, NULL);
+    int64_t first = MediaClock_Now(&clock);
+    CHECK(first >= 0 && first < UNITS);
+
+    bool monotonic = true;
+    int64_t last = first;
+    for (int i = 0; i < 10000; i++) {
+        int64_t now = MediaClock_Now(&clock);
+        if (now < last) monotonic = false;
+        last = now;
+    }
+    CHECK(monotonic);
+
+    int64_t before = MediaClock_Now(&clock);
+    Platform_SleepMs(20);
+    int64_t slept = MediaClock_Now(&clock) - before;
+    CHECK(slept >= 19 * UNITS / 1000);
+    CHECK(slept < UNITS);           // Loose: a loaded machine can oversleep
+
+    // Hub tick times are on the same clock
+    int64_t tick = FramePacer_Now();
+    CHECK(MediaClock_FromSource(&clock, tick) >= last);
+    CHECK_EQ(MediaClock_ToSource(&clock, MediaClock_FromSource(&clock, tick)), tick);
+}
+
+static void TestFromSamples(void) {
+    CHECK_EQ(MediaClock_FromSamples(48000, 48000), UNITS);
+    CHECK_EQ(MediaClock_FromSamples(1024, 48000), 213333);     // One AAC frame, rounded down
+    CHECK_EQ(MediaClock_FromSamples(1, 48000), 208);
+    CHECK_EQ(MediaClock_FromSamples(0, 48000), 0);
+    CHECK_EQ(MediaClock_FromSamples(100, 0), 0);
+
+    // A year of 48 kHz audio: samples * units would overflow 64 bits
+    int64_t year = 365LL * 24 * 3600;
+    CHECK_EQ(MediaClock_FromSamples(year * 48000 + 24000, 48000), year * UNITS + UNITS / 2);
+
+    // Consecutive frames tile the timeline with no accumulated rounding
+    int64_t total = 0;
+    for (int i = 0; i < 46875; i++) {
+        total = MediaClock_FromSamples((int64_t)(i + 1) * 1024, 48000);
+    }
+    CHECK_EQ(total, 1000 * UNITS);
+}
+
+// Fake source: media time follows the injected time exactly
+static void TestFakeSource(void) {
+    int64_t fake = 123456789;
+    MediaClock clock;
+    MediaClock_Init(&clock, MediaClock_FakeSource, &fake);
+    CHECK_EQ(MediaClock_Now(&clock), 0);
+
+    fake += UNITS / 60;
+    CHECK_EQ(MediaClock_Now(&clock), UNITS / 60);
+    fake += 1;
+    CHECK_EQ(MediaClock_Now(&clock), UNITS / 60 + 1);
+
+    CHECK_EQ(MediaClock_FromSource(&clock, 123456789 + 5 * UNITS), 5 * UNITS);
+    CHECK_EQ(MediaClock_ToSource(&clock, 5 * UNITS), 123456789 + 5 * UNITS);
+    CHECK_EQ(MediaClock_FromSource(&clock, 123456789 - 10), -10);     // Before the origin
+    CHECK_EQ(MediaClock_FakeSource(NULL), 0);
+}
+
+static void TestPauseResume(void) {
+    int64_t fake = 0;
+    MediaClock clock;
+    MediaClock_Init(&clock, MediaClock_FakeSource, &fake);
+
+    fake = 2 * UNITS;
+    MediaClock_Pause(&clock);
+    fake = 7 * UNITS;
+    CHECK_EQ(MediaClock_Now(&clock), 2 * UNITS);      // Held while paused
+    MediaClock_Pause(&clock);                          // Already paused: no effect
+    fake = 8 * UNITS;
+    CHECK_EQ(MediaClock_Now(&clock), 2 * UNITS);
+
+    // Resume continues from the held time; the 6 s pause leaves no gap
+    MediaClock_Resume(&clock);
+    CHECK_EQ(MediaClock_Now(&clock), 2 * UNITS);
+    fake += UNITS;
+    CHECK_EQ(MediaClock_Now(&clock), 3 * UNITS);
+    CHECK_EQ(MediaClock_FromSource(&clock, fake), 3 * UNITS);
+
+    MediaClock_Resume(&clock);                         // Not paused: no effect
+    CHECK_EQ(MediaClock_Now(&clock), 3 * UNITS);
+}
+
+// Input within the threshold either way keeps the sample-count timeline;
+// one tick past it re-anchors
+static void TestResyncBoundary(void) {
+    CHECK_EQ(AAC_RESYNC_THRESHOLD, 400000);
+    int64_t expected = 10 * UNITS;
+    CHECK(!MediaClock_Drifted(expected, expected, AAC_RESYNC_THRESHOLD));
+    CHECK(!MediaClock_Drifted(expected, expected + AAC_RESYNC_THRESHOLD, AAC_RESYNC_THRESHOLD));
+    CHECK(!MediaClock_Drifted(expected, expected - AAC_RESYNC_THRESHOLD, AAC_RESYNC_THRESHOLD));
+    CHECK(MediaClock_Drifted(expected, expected + AAC_RESYNC_THRESHOLD + 1, AAC_RESYNC_THRESHOLD));
+    CHECK(MediaClock_Drifted(expected, expected - AAC_RESYNC_THRESHOLD - 1, AAC_RESYNC_THRESHOLD));
+
+    // A capture chunk one AAC frame late is jitter, a dropped 50 ms read is not
+    int64_t frame = MediaClock_FromSamples(1024, 48000);
+    CHECK(!MediaClock_Drifted(expected, expected + frame, AAC_RESYNC_THRESHOLD));
+    CHECK(MediaClock_Drifted(expected, expected + MediaClock_FromSamples(2400, 48000), AAC_RESYNC_THRESHOLD));
+}
+
+int main(void) {
+    TestSystemClock();
+    TestFromSamples();
+    TestFakeSource();
+    TestPauseResume();
+    TestResyncBoundary();
+    return TEST_RESULT();
+}
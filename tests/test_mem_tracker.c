@@ -0,0 +1,156 @@
+/*
+ * Memory Tracker tests - per-tag accounting, retagging and window peaks
+ *
+ * The counters are process-wide and start at zero; nothing else in this
+ * executable allocates through the tracker.
+ */
+
+#include "test.h"
+#include "mem_tracker.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+static int64_t Current(MemTag tag) {
+    MemTagStats stats;
+    MemTracker_GetStats(tag, &stats);
+    return stats.current;
+}
+
+static void TestAllocFree(void) {
+    MemTagStats stats, total;
+    uint8_t* a = (uint8_t*)MemTracker_Alloc(MEM_TAG_VIDEO_SAMPLES, 1000);
+    uint8_t* b = (uint8_t*)MemTracker_Calloc(MEM_TAG_AUDIO_SAMPLES, 10, 30);
+    CHECK(a != NULL && b != NULL);
+    CHECK(((uintptr_t)a & 15) == 0);
+    memset(a, 0xAB, 1000);
+    bool zeroed = true;
+    for (int i = 0; i < 300; i++) zeroed = zeroed && b[i] == 0;
+    CHECK(zeroed);
+
+    MemTracker_GetStats(MEM_TAG_VIDEO_SAMPLES, &stats);
+    CHECK_EQ(stats.current, 1000);
+    CHECK_EQ(stats.peak, 1000);
+    CHECK_EQ(stats.allocations, 1);
+    CHECK_EQ(Current(MEM_TAG_AUDIO_SAMPLES), 300);
+    MemTracker_GetTotal(&total);
+    CHECK_EQ(total.current, 1300);
+    CHECK_EQ(total.allocations, 2);
+
+    // Growing keeps the contents and moves the block to the tag asked for
+    a = (uint8_t*)MemTracker_Realloc(MEM_TAG_SAVE, a, 4000);
+    CHECK(a != NULL && a[999] == 0xAB);
+    CHECK_EQ(Current(MEM_TAG_VIDEO_SAMPLES), 0);
+    CHECK_EQ(Current(MEM_TAG_SAVE), 4000);
+    MemTracker_GetTotal(&total);
+    CHECK_EQ(total.current, 4300);
+    CHECK_EQ(total.peak, 4300);
+
+    a = (uint8_t*)MemTracker_Realloc(MEM_TAG_SAVE, a, 100);
+    CHECK_EQ(Current(MEM_TAG_SAVE), 100);
+    MemTracker_GetStats(MEM_TAG_SAVE, &stats);
+    CHECK_EQ(stats.peak, 4000);
+
+    MemTracker_Free(a);
+    MemTracker_Free(b);
+    MemTracker_Free(NULL);
+    MemTracker_GetTotal(&total);
+    CHECK_EQ(total.current, 0);
+    CHECK_EQ(total.peak, 4300);
+    CHECK_EQ(Current(MEM_TAG_AUDIO_SAMPLES), 0);
+
+    // Realloc of NULL is an allocation
+    void* c = MemTracker_Realloc(MEM_TAG_CAPTURE, NULL, 64);
+    CHECK_EQ(Current(MEM_TAG_CAPTURE), 64);
+    MemTracker_Free(c);
+    CHECK_EQ(Current(MEM_TAG_CAPTURE), 0);
+}
+
+// Retag moves current bytes between tags; the total doesn't change
+static void TestRetag(void) {
+    MemTagStats total, before;
+    MemTracker_GetTotal(&before);
+
+    void* frame = MemTracker_Alloc(MEM_TAG_VIDEO_ENCODER, 5000);
+    CHECK_EQ(Current(MEM_TAG_VIDEO_ENCODER), 5000);
+    MemTracker_Retag(frame, MEM_TAG_VIDEO_SAMPLES);
+    CHECK_EQ(Current(MEM_TAG_VIDEO_ENCODER), 0);
+    CHECK_EQ(Current(MEM_TAG_VIDEO_SAMPLES), 5000);
+    MemTracker_GetTotal(&total);
+    CHECK_EQ(total.current, before.current + 5000);
+
+    MemTracker_Retag(frame, MEM_TAG_VIDEO_SAMPLES);     // Same tag: no change
+    CHECK_EQ(Current(MEM_TAG_VIDEO_SAMPLES), 5000);
+    MemTracker_Retag(NULL, MEM_TAG_SAVE);
+
+    // Freeing subtracts from the tag the block moved to
+    MemTracker_Free(frame);
+    CHECK_EQ(Current(MEM_TAG_VIDEO_SAMPLES), 0);
+    CHECK_EQ(Current(MEM_TAG_VIDEO_ENCODER), 0);
+
+    // Out-of-range tags land on diagnostics
+    void* stray = MemTracker_Alloc((MemTag)99, 10);
+    CHECK_EQ(Current(MEM_TAG_DIAGNOSTICS), 10);
+    MemTracker_Free(stray);
+    CHECK_EQ(Current(MEM_TAG_DIAGNOSTICS), 0);
+}
+
+// windowPeak restarts from the current bytes on every reset; peak doesn't
+static void TestWindow(void) {
+    MemTagStats stats, total;
+    void* ring = MemTracker_Alloc(MEM_TAG_VIDEO_SAMPLES, 20000);
+    MemTracker_ResetWindow();
+    MemTracker_GetStats(MEM_TAG_VIDEO_SAMPLES, &stats);
+    CHECK_EQ(stats.windowPeak, 20000);
+    CHECK_EQ(Current(MEM_TAG_SAVE), 0);
+
+    // A save's deep copies rise and fall inside the window
+    void* copy = MemTracker_Alloc(MEM_TAG_SAVE, 8000);
+    MemTracker_Free(copy);
+    MemTracker_GetStats(MEM_TAG_SAVE, &stats);
+    CHECK_EQ(stats.current, 0);
+    CHECK_EQ(stats.windowPeak, 8000);
+    MemTracker_GetTotal(&total);
+    CHECK_EQ(total.windowPeak, 28000);
+
+    MemTracker_ResetWindow();
+    MemTracker_GetStats(MEM_TAG_SAVE, &stats);
+    CHECK_EQ(stats.windowPeak, 0);
+    CHECK_EQ(stats.peak, 8000);
+    MemTracker_GetTotal(&total);
+    CHECK_EQ(total.windowPeak, 20000);
+    CHECK(total.peak >= 28000);
+
+    // Static buffers counted by hand behave the same
+    MemTracker_Account(MEM_TAG_AUDIO_CAPTURE, 4096);
+    MemTracker_Account(MEM_TAG_AUDIO_CAPTURE, -4096);
+    MemTracker_GetStats(MEM_TAG_AUDIO_CAPTURE, &stats);
+    CHECK_EQ(stats.current, 0);
+    CHECK_EQ(stats.windowPeak, 4096);
+
+    MemTracker_Free(ring);
+}
+
+static void TestFormat(void) {
+    void* ring = MemTracker_Alloc(MEM_TAG_VIDEO_SAMPLES, 3 * 1024 * 1024);
+    char line[256];
+    int written = MemTracker_Format(line, sizeof(line));
+    CHECK_EQ(written, (int)strlen(line));
+    CHECK(strncmp(line, "total 3.0MB", 11) == 0);
+    CHECK(strstr(line, "video 3.0MB/") != NULL);
+    MemTracker_Free(ring);
+
+    char small[8];
+    MemTracker_Format(small, sizeof(small));
+    CHECK_EQ(strlen(small), sizeof(small) - 1);         // Truncated, terminated
+    CHECK_EQ(strcmp(MemTracker_TagName(MEM_TAG_SAVE), "save"), 0);
+    CHECK_EQ(strcmp(MemTracker_TagName(MEM_TAG_COUNT), "?"), 0);
+}
+
+int main(void) {
+    TestAllocFree();
+    TestRetag();
+    TestWindow();
+    TestFormat();
+    return TEST_RESULT();
+}
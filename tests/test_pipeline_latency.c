@@ -0,0 +1,117 @@
+/*
+ * Pipeline Latency tests - histogram accuracy and frame tags
+ */
+
+#include "test.h"
+#include "pipeline_latency.h"
+#include <string.h>
+
+// Exact below 32 units; above, within one sub-bucket (6.25%)
+static void TestPercentiles(void) {
+    LatencyHistogram hist;
+    LatencyHistogram_Reset(&hist);
+    CHECK_EQ(LatencyHistogram_Percentile(&hist, 50), 0);
+
+    for (int v = 1; v <= 31; v++) LatencyHistogram_Record(&hist, v);
+    CHECK_EQ(hist.count, 31);
+    CHECK_EQ(hist.min, 1);
+    CHECK_EQ(hist.max, 31);
+    CHECK_EQ(LatencyHistogram_Percentile(&hist, 50), 16);
+    CHECK_EQ(LatencyHistogram_Percentile(&hist, 100), 31);
+    CHECK_EQ(LatencyHistogram_Percentile(&hist, 0), 1);
+
+    LatencyHistogram_Reset(&hist);
+    for (int v = 1; v <= 100000; v++) LatencyHistogram_Record(&hist, v);
+    int64_t p50 = LatencyHistogram_Percentile(&hist, 50);
+    int64_t p99 = LatencyHistogram_Percentile(&hist, 99);
+    int64_t p999 = LatencyHistogram_Percentile(&hist, 99.9);
+    CHECK(p50 >= 50000 && p50 <= 50000 * 1.0625);
+    CHECK(p99 >= 99000 && p99 <= 99000 * 1.0625);
+    CHECK(p999 >= 99900 && p999 <= 100000);     // Clamped to the max
+    CHECK_EQ(LatencyHistogram_Percentile(&hist, 100), 100000);
+    CHECK_EQ(hist.total, 100000LL * 100001 / 2);
+
+    // Out-of-range values clamp, negatives count as 0
+    LatencyHistogram_Reset(&hist);
+    LatencyHistogram_Record(&hist, -5);
+    LatencyHistogram_Record(&hist, (int64_t)1 << 50);
+    CHECK_EQ(hist.count, 2);
+    CHECK_EQ(LatencyHistogram_Percentile(&hist, 50), 0);
+    CHECK(LatencyHistogram_Percentile(&hist, 100) > 0);
+}
+
+static void TestMerge(void) {
+    LatencyHistogram a, b;
+    LatencyHistogram_Reset(&a);
+    LatencyHistogram_Reset(&b);
+    for (int v = 0; v < 100; v++) LatencyHistogram_Record(&a, 10);
+    for (int v = 0; v < 100; v++) LatencyHistogram_Record(&b, 1000);
+    LatencyHistogram_Merge(&a, &b);
+    CHECK_EQ(a.count, 200);
+    CHECK_EQ(a.min, 10);
+    CHECK_EQ(a.max, 1000);
+    CHECK_EQ(LatencyHistogram_Percentile(&a, 50), 10);
+    CHECK(LatencyHistogram_Percentile(&a, 51) >= 1000);
+}
+
+static void TestStages(void) {
+    PipelineLatency* pl = PipelineLatency_Create();
+    CHECK(pl != NULL);
+    for (int v = 1; v <= 1000; v++) PipelineLatency_Record(pl, LATENCY_ENCODE, v * 100);
+
+    LatencySummary summary;
+    PipelineLatency_GetSummary(pl, LATENCY_ENCODE, &summary);
+    CHECK_EQ(summary.count, 1000);
+    CHECK_EQ(summary.max, 100000);
+    CHECK_NEAR(summary.mean, 50050.0, 0.5);
+    CHECK(summary.p50 <= summary.p99 && summary.p99 <= summary.p999 && summary.p999 <= summary.max);
+
+    PipelineLatency_GetSummary(pl, LATENCY_SAVE, &summary);
+    CHECK_EQ(summary.count, 0);
+
+    char line[128];
+    PipelineLatency_GetSummary(pl, LATENCY_ENCODE, &summary);
+    PipelineLatency_FormatSummary(LATENCY_ENCODE, &summary, line, sizeof(line));
+    CHECK(strncmp(line, PipelineLatency_StageName(LATENCY_ENCODE), strlen(PipelineLatency_StageName(LATENCY_ENCODE))) == 0);
+
+    PipelineLatency_Reset(pl);
+    PipelineLatency_GetSummary(pl, LATENCY_ENCODE, &summary);
+    CHECK_EQ(summary.count, 0);
+    PipelineLatency_Destroy(pl);
+}
+
+// Tags come back by timestamp; older ones the encoder skipped are dropped,
+// and the ring keeps only the newest LATENCY_TAG_CAPACITY
+static void TestTags(void) {
+    PipelineLatency* pl = PipelineLatency_Create();
+    for (int i = 1; i <= 3; i++) {
+        LatencyTag tag = { i * 10, i * 100, i * 1000 };
+        PipelineLatency_TagFrame(pl, &tag);
+    }
+
+    LatencyTag tag;
+    CHECK(PipelineLatency_TakeTag(pl, 20, &tag));
+    CHECK_EQ(tag.grabTime, 200);
+    CHECK_EQ(tag.submitTime, 2000);
+    CHECK(!PipelineLatency_TakeTag(pl, 10, &tag));     // Skipped, discarded
+    CHECK(!PipelineLatency_TakeTag(pl, 25, &tag));     // Never tagged
+    CHECK(PipelineLatency_TakeTag(pl, 30, &tag));
+    CHECK_EQ(tag.grabTime, 300);
+
+    for (int i = 0; i < LATENCY_TAG_CAPACITY + 4; i++) {
+        LatencyTag t = { 1000 + i, 0, 0 };
+        PipelineLatency_TagFrame(pl, &t);
+    }
+    CHECK(!PipelineLatency_TakeTag(pl, 1003, &tag));
+    CHECK(PipelineLatency_TakeTag(pl, 1004, &tag));
+    CHECK(PipelineLatency_TakeTag(pl, 1000 + LATENCY_TAG_CAPACITY + 3, &tag));
+    PipelineLatency_Destroy(pl);
+}
+
+int main(void) {
+    TestPercentiles();
+    TestMerge();
+    TestStages();
+    TestTags();
+    return TEST_RESULT();
+}
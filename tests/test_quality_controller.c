@@ -0,0 +1,205 @@
+/*
+ * Quality Controller tests - closed loop against QP-driven rate models
+ */
+
+#include "test.h"
+#include "quality_controller.h"
+#include "stream_model.h"
+#include <math.h>
+
+#define FPS         60
+#define FRAME_UNITS (10000000LL / FPS)
+#define TARGET      (1024 * 1024)   // Bytes/s
+#define INITIAL_QP  20
+#define KEYFRAME_MS 2000
+
+// Content whose rate at INITIAL_QP is 'baseRate', halving every 6 QP
+typedef struct {
+    double baseRate;
+    int qp;
+    int keyframeMs;
+    int64_t now;
+    int changes;
+} Session;
+
+static void Run(QualityController* qc, Session* s, int seconds) {
+    for (int i = 0; i < seconds * FPS; i++) {
+        double rate = s->baseRate * pow(2.0, (INITIAL_QP - s->qp) / 6.0);
+        QualityController_Record(qc, s->now, (size_t)(rate / FPS));
+        s->now += FRAME_UNITS;
+
+        int qp, keyframeMs;
+        if (QualityController_Poll(qc, &qp, &keyframeMs)) {
+            s->qp = qp;
+            s->keyframeMs = keyframeMs;
+            s->changes++;
+        }
+    }
+}
+
+// 4x over budget: QP rises until the rate is inside the hysteresis band,
+// then holds; easy content later gives the quality back, never past the start
+static void TestConverges(void) {
+    QualityControllerConfig config;
+    QualityController_DefaultConfig(&config, TARGET, INITIAL_QP, KEYFRAME_MS);
+    QualityController* qc = QualityController_Create(&config);
+    CHECK(qc != NULL);
+    Session s = { 4.0 * TARGET, INITIAL_QP, KEYFRAME_MS, 0, 0 };
+
+    Run(qc, &s, 60);
+    double rate = s.baseRate * pow(2.0, (INITIAL_QP - s.qp) / 6.0);
+    CHECK(rate <= TARGET * config.overThreshold);
+    CHECK(rate >= TARGET * config.underThreshold);
+    CHECK(s.qp > INITIAL_QP && s.qp <= config.maxQp);
+    CHECK_EQ(s.keyframeMs, KEYFRAME_MS);
+
+    // Stable: no further changes
+    int settled = s.changes;
+    Run(qc, &s, 30);
+    CHECK_EQ(s.changes, settled);
+
+    QualityControllerStats stats;
+    QualityController_GetStats(qc, &stats);
+    CHECK_EQ(stats.qp, s.qp);
+    CHECK(stats.raises >= 1);
+    CHECK_EQ(stats.relaxes, 0);
+
+    s.baseRate = 0.2 * TARGET;
+    Run(qc, &s, 120);
+    CHECK_EQ(s.qp, INITIAL_QP);
+    QualityController_GetStats(qc, &stats);
+    CHECK(stats.relaxes >= 1);
+    QualityController_Destroy(qc);
+}
+
+// At the QP ceiling the keyframe interval stretches instead
+static void TestKeyframeFallback(void) {
+    QualityControllerConfig config;
+    QualityController_DefaultConfig(&config, TARGET, INITIAL_QP, KEYFRAME_MS);
+    config.maxQp = INITIAL_QP;
+    QualityController* qc = QualityController_Create(&config);
+    Session s = { 2.0 * TARGET, INITIAL_QP, KEYFRAME_MS, 0, 0 };
+
+    Run(qc, &s, 60);
+    CHECK_EQ(s.qp, INITIAL_QP);
+    CHECK(s.keyframeMs > KEYFRAME_MS);
+    CHECK(s.keyframeMs <= config.maxKeyframeMs);
+    QualityController_Destroy(qc);
+}
+
+// Stand-in encoder from the stream model: frame sizes respond to QP and the
+// keyframe interval as the real backends do, with log-normal noise, IDR
+// spikes and static scenes. Returns the bytes encoded.
+static int64_t RunModel(QualityController* qc, StreamModel* model, int64_t* frame, int seconds) {
+    int64_t bytes = 0;
+    for (int i = 0; i < seconds * FPS; i++, (*frame)++) {
+        int64_t timestamp = *frame * FRAME_UNITS;
+        bool keyframe = false;
+        bool changed = StreamModel_ContentChanged(model, timestamp);
+        uint32_t size = StreamModel_NextFrame(model, timestamp, changed, &keyframe);
+        QualityController_Record(qc, timestamp, size);
+        bytes += size;
+
+        int qp, keyframeMs;
+        if (QualityController_Poll(qc, &qp, &keyframeMs)) StreamModel_SetParams(model, qp, keyframeMs);
+    }
+    return bytes;
+}
+
+static QualityController* CreateFor(const StreamModel* model, double budgetFactor, QualityControllerConfig* config) {
+    QualityController_DefaultConfig(config, (int64_t)(StreamModel_ExpectedRate(model) * budgetFactor),
+                                    model->qp, model->keyframeMs);
+    return QualityController_Create(config);
+}
+
+// A 1440p60 stream at three times the budget: in motion it settles inside
+// the band without hunting; with static scenes mixed in it still averages
+// at or under budget
+static void TestStreamModel(void) {
+    StreamModelConfig modelConfig;
+    StreamModel_DefaultConfig(&modelConfig, 2560, 1440, FPS, QUALITY_HIGH);
+    modelConfig.staticFraction = 0;
+    StreamModel model;
+    StreamModel_Init(&model, &modelConfig);
+    int presetQp = model.qp;
+
+    QualityControllerConfig config;
+    QualityController* qc = CreateFor(&model, 1.0 / 3, &config);
+    CHECK(qc != NULL);
+    int64_t frame = 0;
+    RunModel(qc, &model, &frame, 60);
+    CHECK(model.qp > presetQp && model.qp <= config.maxQp);
+    QualityControllerStats stats;
+    QualityController_GetStats(qc, &stats);
+    CHECK_EQ(stats.qp, model.qp);
+    CHECK_EQ(stats.keyframeMs, model.keyframeMs);
+
+    uint64_t settled = stats.raises + stats.relaxes;
+    double rate = RunModel(qc, &model, &frame, 120) / 120.0;
+    CHECK(rate <= config.targetBytesPerSec * config.overThreshold);
+    CHECK(rate >= config.targetBytesPerSec * config.underThreshold);
+    QualityController_GetStats(qc, &stats);
+    CHECK(stats.raises + stats.relaxes <= settled + 4);
+    QualityController_Destroy(qc);
+
+    // Static scenes: relaxes while they last, raises again after
+    StreamModel_DefaultConfig(&modelConfig, 2560, 1440, FPS, QUALITY_HIGH);
+    for (uint64_t seed = 1; seed <= 4; seed++) {
+        modelConfig.seed = seed;
+        StreamModel_Init(&model, &modelConfig);
+        qc = CreateFor(&model, 1.0 / 3, &config);
+        frame = 0;
+        RunModel(qc, &model, &frame, 60);
+        rate = RunModel(qc, &model, &frame, 240) / 240.0;
+        CHECK(rate <= config.targetBytesPerSec * config.overThreshold);
+        QualityController_Destroy(qc);
+    }
+
+    // Under budget at the preset: left alone
+    modelConfig.staticFraction = 0;
+    StreamModel_Init(&model, &modelConfig);
+    qc = CreateFor(&model, 2.0, &config);
+    frame = 0;
+    RunModel(qc, &model, &frame, 60);
+    CHECK_EQ(model.qp, presetQp);
+    QualityController_GetStats(qc, &stats);
+    CHECK_EQ(stats.raises, 0);
+    QualityController_Destroy(qc);
+}
+
+// A change the encoder refused is rolled back
+static void TestRejected(void) {
+    QualityControllerConfig config;
+    QualityController_DefaultConfig(&config, TARGET, INITIAL_QP, KEYFRAME_MS);
+    QualityController* qc = QualityController_Create(&config);
+
+    int64_t now = 0;
+    int qp = 0, keyframeMs = 0;
+    bool changed = false;
+    for (int i = 0; i < 10 * FPS && !changed; i++, now += FRAME_UNITS) {
+        QualityController_Record(qc, now, (size_t)(3.0 * TARGET / FPS));
+        changed = QualityController_Poll(qc, &qp, &keyframeMs);
+    }
+    CHECK(changed);
+    CHECK(qp > INITIAL_QP);
+    QualityController_Rejected(qc);
+
+    QualityControllerStats stats;
+    QualityController_GetStats(qc, &stats);
+    CHECK_EQ(stats.qp, INITIAL_QP);
+    CHECK_EQ(stats.keyframeMs, KEYFRAME_MS);
+    CHECK(!QualityController_Poll(qc, &qp, &keyframeMs));
+    QualityController_Destroy(qc);
+}
+
+int main(void) {
+    TestConverges();
+    TestKeyframeFallback();
+    TestStreamModel();
+    TestRejected();
+
+    QualityControllerConfig bad;
+    QualityController_DefaultConfig(&bad, 0, INITIAL_QP, KEYFRAME_MS);
+    CHECK(QualityController_Create(&bad) == NULL);
+    return TEST_RESULT();
+}
@@ -0,0 +1,168 @@
+/*
+ * RAM Estimator tests - windowed rate learning, prediction and the
+ * lwsr_ram_profiles.txt round trip
+ *
+ * Frames are fed at 60 fps on an exact 100-ns timeline, so every window is
+ * 240 frames over exactly RAM_ESTIMATOR_WINDOW_SECONDS.
+ */
+
+#include "test.h"
+#include "ram_estimator.h"
+#include <stdio.h>
+#include <string.h>
+
+#define UNITS 10000000LL
+#define FPS 60
+#define WINDOW_FRAMES (FPS * RAM_ESTIMATOR_WINDOW_SECONDS)
+#define PROFILE_PATH "lwsr-test-ram-profiles.txt"
+
+static const RamProfileKey k1080 = { 1920, 1080, FPS, 1 };
+static const RamProfileKey k2160 = { 3840, 2160, FPS, 1 };
+
+// Feed 'windows' windows whose rate (bytes/s) is rates[i % rateCount],
+// continuing from frame *frame. A window is counted when the next one's
+// first frame arrives: the closing empty frame opens the window the next
+// Feed fills.
+static void Feed(RamEstimator* est, int64_t* frame, int windows, const double* rates, int rateCount) {
+    for (int w = 0; w < windows; w++) {
+        uint32_t bytes = (uint32_t)(rates[w % rateCount] / FPS);
+        for (int i = 0; i < WINDOW_FRAMES; i++, (*frame)++) {
+            RamEstimator_Record(est, *frame * UNITS / FPS, bytes);
+        }
+    }
+    RamEstimator_Record(est, *frame * UNITS / FPS, 0);   // Closes the last window
+}
+
+static void TestLearning(void) {
+    RamEstimator* est = RamEstimator_Create();
+    RamEstimate estimate;
+    CHECK(!RamEstimator_Predict(est, &k1080, 60, &estimate));     // Nothing learned
+
+    // Rates alternating 1.2 and 3.6 MB/s: mean 2.4, population sd 1.2
+    const double rates[2] = { 1200000, 3600000 };
+    RamEstimator_Begin(est, &k1080);
+    int64_t frame = 0;
+    CHECK_EQ(RamEstimator_GetLiveRate(est), 0);
+    Feed(est, &frame, 10, rates, 2);
+    CHECK_NEAR(RamEstimator_GetLiveRate(est), 2400000, 1);
+
+    CHECK(RamEstimator_Predict(est, &k1080, 60, &estimate));
+    CHECK(!estimate.tentative);
+    CHECK_EQ(estimate.windows, 10);
+    CHECK_NEAR(estimate.bytesPerSecond, 2400000, 1);
+    CHECK_NEAR(estimate.expectedBytes, 2400000.0 * 60, 60);
+    CHECK_NEAR(estimate.highBytes, (2400000 + 1.645 * 1200000) * 60, 600);
+    CHECK_NEAR(estimate.lowBytes, (2400000 - 1.645 * 1200000) * 60, 600);
+
+    // A new timeline (timestamps going back) drops the partial window
+    RamEstimator_Record(est, 0, 999999);
+    CHECK(RamEstimator_Predict(est, &k1080, 60, &estimate));
+    CHECK_EQ(estimate.windows, 10);
+    RamEstimator_End(est);
+    RamEstimator_Record(est, frame * UNITS / FPS, 999999);        // Not learning
+    CHECK(RamEstimator_Predict(est, &k1080, 60, &estimate));
+    CHECK_EQ(estimate.windows, 10);
+
+    // Unseen profile: scaled by pixel rate^0.75 from the nearest, wider range
+    CHECK(RamEstimator_Predict(est, &k2160, 60, &estimate));
+    CHECK(estimate.tentative);
+    CHECK_NEAR(estimate.bytesPerSecond, 2400000 * 2.8284271, 10);
+    CHECK(estimate.highBytes - estimate.expectedBytes >= estimate.expectedBytes / 2 - 1);
+    RamEstimator_Destroy(est);
+}
+
+// Past RAM_ESTIMATOR_HORIZON windows the average moves: after another
+// horizon at a new rate, the old rate's weight is (1 - 1/horizon)^horizon
+static void TestHorizon(void) {
+    RamEstimator* est = RamEstimator_Create();
+    const double before = 1000000, after = 2000000;
+    RamEstimator_Begin(est, &k1080);
+    int64_t frame = 0;
+    Feed(est, &frame, RAM_ESTIMATOR_HORIZON, &before, 1);
+    Feed(est, &frame, RAM_ESTIMATOR_HORIZON, &after, 1);
+    RamEstimator_End(est);
+
+    double weight = 1.0;
+    for (int i = 0; i < RAM_ESTIMATOR_HORIZON; i++) weight *= 1.0 - 1.0 / RAM_ESTIMATOR_HORIZON;
+    RamEstimate estimate;
+    CHECK(RamEstimator_Predict(est, &k1080, 1, &estimate));
+    CHECK_NEAR(estimate.bytesPerSecond, after + (before - after) * weight, 1000);
+    CHECK(estimate.bytesPerSecond > 1600000 && estimate.bytesPerSecond < 1700000);
+
+    // A profile with few windows is tentative, even on its own key
+    RamEstimator* fresh = RamEstimator_Create();
+    RamEstimator_Begin(fresh, &k2160);
+    frame = 0;
+    Feed(fresh, &frame, 2, &after, 1);
+    CHECK(RamEstimator_Predict(fresh, &k2160, 1, &estimate));
+    CHECK(estimate.tentative);
+    CHECK_EQ(estimate.windows, 2);
+    RamEstimator_Destroy(fresh);
+    RamEstimator_Destroy(est);
+}
+
+static void TestSaveLoad(void) {
+    RamEstimator* est = RamEstimator_Create();
+    const double rates[2] = { 1000000, 3000000 };
+    RamEstimator_Begin(est, &k1080);
+    int64_t frame = 0;
+    Feed(est, &frame, 12, rates, 2);
+    RamEstimator_End(est);
+    CHECK(RamEstimator_Save(est, PROFILE_PATH));
+
+    RamEstimator* loaded = RamEstimator_Create();
+    CHECK(RamEstimator_Load(loaded, PROFILE_PATH));
+    RamEstimate a, b;
+    CHECK(RamEstimator_Predict(est, &k1080, 120, &a));
+    CHECK(RamEstimator_Predict(loaded, &k1080, 120, &b));
+    CHECK_EQ(b.windows, 12);
+    CHECK(!b.tentative);
+    CHECK_NEAR(b.expectedBytes, a.expectedBytes, 120);
+    CHECK_NEAR(b.highBytes, a.highBytes, 120);
+    RamEstimator_Destroy(loaded);
+    RamEstimator_Destroy(est);
+
+    // One good line among malformed and foreign ones
+    FILE* file = fopen(PROFILE_PATH, "w");
+    CHECK(file != NULL);
+    if (!file) return;
+    fputs("# lwsr replay RAM profiles v1: width height fps quality windows bytesPerSec variance framesPerSec\n"
+          "1920 1080 60 1 20 2000000.0 0.0 60.000\n"
+          "garbage\n"
+          "2560 1440 60 1\n"
+          "0 1080 60 1 20 2000000.0 0.0 60.000\n"
+          "2560 1440 60 1 0 2000000.0 0.0 60.000\n"
+          "2560 1440 60 1 20 -5.0 0.0 60.000\n"
+          "2560 1440 60 1 20 nan 0.0 60.000\n"
+          "2560 1440 60 1 20 inf 0.0 60.000\n"
+          "2560 1440 60 1 20 2000000.0 -1.0 60.000\n"
+          "2560 1440 60 1 20 2000000.0 0.0 60.000 7 hevc\n"
+          "2560 1440 60 1 20 2000000.0 0.0", file);
+    fclose(file);
+
+    est = RamEstimator_Create();
+    CHECK(RamEstimator_Load(est, PROFILE_PATH));
+    CHECK(RamEstimator_Predict(est, &k1080, 10, &a));
+    CHECK(!a.tentative);
+    CHECK_EQ(a.windows, 20);
+    CHECK_EQ(a.expectedBytes, 20000000);
+
+    // 1440p only ever came from rejected lines: extrapolated from 1080p
+    RamProfileKey k1440 = { 2560, 1440, 60, 1 };
+    CHECK(RamEstimator_Predict(est, &k1440, 10, &b));
+    CHECK(b.tentative);
+    CHECK_EQ(b.windows, 20);
+    RamEstimator_Destroy(est);
+
+    remove(PROFILE_PATH);
+    est = RamEstimator_Create();
+    CHECK(!RamEstimator_Load(est, PROFILE_PATH));      // Missing file
+    RamEstimator_Destroy(est);
+}
+
+int main(void) {
+    TestLearning();
+    TestHorizon();
+    TestSaveLoad();
+    return TEST_RESULT();
+}
@@ -0,0 +1,143 @@
+/*
+ * Sample Buffer tests - eviction, durations and clip snapshots
+ */
+
+#include "test.h"
+#include "sample_buffer.h"
+#include "mem_tracker.h"
+#include "util.h"
+#include <string.h>
+
+#define FPS         25          // Whole 100-ns units per frame
+#define FRAME_UNITS (MF_UNITS_PER_SECOND / FPS)
+#define GOP         FPS
+
+static BOOL AddFrame(SampleBuffer* buf, LONGLONG timestamp, DWORD size, BOOL keyframe) {
+    EncodedFrame frame;
+    frame.data = (BYTE*)MemTracker_Alloc(MEM_TAG_VIDEO_ENCODER, size);
+    if (!frame.data) return FALSE;
+    memset(frame.data, keyframe ? 0x65 : 0x41, size);
+    frame.size = size;
+    frame.timestamp = timestamp;
+    frame.duration = FRAME_UNITS;
+    frame.isKeyframe = keyframe;
+    BOOL ok = SampleBuffer_Add(buf, &frame);
+    if (frame.data) MemTracker_Free(frame.data);
+    return ok;
+}
+
+static void FreeSamples(MuxerSample* samples, int count) {
+    for (int i = 0; i < count; i++) MemTracker_Free(samples[i].data);
+    MemTracker_Free(samples);
+}
+
+// Twice the duration in: the ring keeps the newest 10s and frees the rest
+static void TestEviction(void) {
+    SampleBuffer buf;
+    CHECK(SampleBuffer_Init(&buf, 10, FPS, 1280, 720, QUALITY_MEDIUM, VIDEO_CODEC_HEVC));
+
+    int frames = 20 * FPS;
+    int evicted = 0;
+    for (int i = 0; i < frames; i++) {
+        CHECK(AddFrame(&buf, (LONGLONG)i * FRAME_UNITS, 1000, i % GOP == 0));
+        evicted += buf.lastEvicted;
+        if (buf.lastEvicted == 0) CHECK_EQ(buf.lastEvictNs, 0);
+    }
+
+    CHECK_NEAR(SampleBuffer_GetDuration(&buf), 10.0, 1e-6);
+    CHECK_EQ(SampleBuffer_GetCount(&buf), 10 * FPS + 1);
+    CHECK_EQ(evicted, frames - (10 * FPS + 1));
+    CHECK_EQ(SampleBuffer_GetMemoryUsage(&buf), (10 * FPS + 1) * 1000);
+
+    SampleBuffer_Clear(&buf);
+    CHECK_EQ(SampleBuffer_GetCount(&buf), 0);
+    CHECK_NEAR(SampleBuffer_GetDuration(&buf), 0.0, 0);
+    SampleBuffer_Shutdown(&buf);
+}
+
+// A sample lasts until the next one starts (VFR ticks, drops), never less
+// than its own duration; ExtendLastSample stretches the newest
+static void TestDurations(void) {
+    SampleBuffer buf;
+    CHECK(SampleBuffer_Init(&buf, 10, FPS, 1280, 720, QUALITY_MEDIUM, VIDEO_CODEC_HEVC));
+
+    AddFrame(&buf, 0, 100, TRUE);
+    AddFrame(&buf, MF_UNITS_PER_SECOND, 100, FALSE);
+    SampleBuffer_ExtendLastSample(&buf, 3 * MF_UNITS_PER_SECOND);
+    SampleBuffer_ExtendLastSample(&buf, 2 * MF_UNITS_PER_SECOND);   // Never shortens
+
+    MuxerSample* samples = NULL;
+    int count = 0;
+    LONGLONG base = -1;
+    CHECK(SampleBuffer_GetSamplesForMuxing(&buf, &samples, &count, &base));
+    CHECK_EQ(count, 2);
+    CHECK_EQ(base, 0);
+    if (count == 2) {
+        CHECK_EQ(samples[0].duration, MF_UNITS_PER_SECOND);
+        CHECK_EQ(samples[1].duration, 2 * MF_UNITS_PER_SECOND);
+    }
+    FreeSamples(samples, count);
+    SampleBuffer_Shutdown(&buf);
+}
+
+// A clip starts at the newest keyframe at or before (end - seconds) and is
+// rebased to 0
+static void TestRecentClip(void) {
+    SampleBuffer buf;
+    CHECK(SampleBuffer_Init(&buf, 30, FPS, 1280, 720, QUALITY_MEDIUM, VIDEO_CODEC_HEVC));
+    LONGLONG origin = 5 * MF_UNITS_PER_SECOND;
+    int frames = 20 * FPS;
+    for (int i = 0; i < frames; i++) {
+        AddFrame(&buf, origin + (LONGLONG)i * FRAME_UNITS, 500, i % GOP == 0);
+    }
+
+    MuxerSample* samples = NULL;
+    int count = 0;
+    LONGLONG base = 0;
+    CHECK(SampleBuffer_GetRecentSamplesForMuxing(&buf, 3 * MF_UNITS_PER_SECOND, &samples, &count, &base));
+    CHECK(count > 0);
+    if (count > 0) {
+        // The last frame ends at 20s; 17s is a keyframe
+        int first = 17 * FPS;
+        CHECK(samples[0].isKeyframe);
+        CHECK_EQ(samples[0].timestamp, 0);
+        CHECK_EQ(base, origin + (LONGLONG)first * FRAME_UNITS);
+        CHECK_EQ(count, frames - first);
+        CHECK_EQ(samples[count - 1].timestamp, (LONGLONG)(frames - 1 - first) * FRAME_UNITS);
+    }
+    FreeSamples(samples, count);
+
+    // Between keyframes: back to the one before, so the clip is longer
+    CHECK(SampleBuffer_GetRecentSamplesForMuxing(&buf, 3 * MF_UNITS_PER_SECOND + FRAME_UNITS,
+                                                 &samples, &count, &base));
+    if (count > 0) {
+        CHECK(samples[0].isKeyframe);
+        CHECK_EQ(count, frames - 16 * FPS);
+    }
+    FreeSamples(samples, count);
+
+    // Longer than the buffer: everything
+    CHECK(SampleBuffer_GetRecentSamplesForMuxing(&buf, 60 * MF_UNITS_PER_SECOND, &samples, &count, &base));
+    CHECK_EQ(count, frames);
+    CHECK_EQ(base, origin);
+    FreeSamples(samples, count);
+
+    SampleBuffer_Shutdown(&buf);
+
+    SampleBuffer empty;
+    CHECK(SampleBuffer_Init(&empty, 10, FPS, 1280, 720, QUALITY_MEDIUM, VIDEO_CODEC_HEVC));
+    CHECK(!SampleBuffer_GetSamplesForMuxing(&empty, &samples, &count, NULL));
+    CHECK_EQ(count, 0);
+    SampleBuffer_Shutdown(&empty);
+}
+
+int main(void) {
+    TestEviction();
+    TestDurations();
+    TestRecentClip();
+
+    MemTagStats save;
+    MemTracker_GetStats(MEM_TAG_SAVE, &save);
+    CHECK_EQ(save.current, 0);
+    return TEST_RESULT();
+}
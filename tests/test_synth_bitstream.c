@@ -0,0 +1,110 @@
+/*
+ * Synth Bitstream tests - HEVC access unit layout and AAC framing
+ */
+
+#include "test.h"
+#include "synth_bitstream.h"
+#include <stdlib.h>
+#include <string.h>
+
+// NAL unit types of an Annex-B buffer, in order. Returns how many.
+static int NalTypes(const uint8_t* data, uint32_t size, int* types, int maxTypes) {
+    int count = 0;
+    for (uint32_t i = 0; i + 3 < size; i++) {
+        if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+            if (count < maxTypes) types[count] = (data[i + 3] >> 1) & 0x3F;
+            count++;
+            i += 2;
+        }
+    }
+    return count;
+}
+
+static void TestHevc(void) {
+    SynthHevcConfig config = { 1920, 1080, 60, 24, true, 7 };
+    SynthHevc gen;
+    SynthHevc_Init(&gen, &config);
+
+    uint32_t paramSize = 0;
+    const uint8_t* params = SynthHevc_GetParamSets(&gen, &paramSize);
+    int types[8];
+    CHECK(paramSize > 0 && paramSize <= SYNTH_HEVC_MAX_PARAM_SETS);
+    CHECK_EQ(NalTypes(params, paramSize, types, 8), 3);
+    CHECK_EQ(types[0], 32);     // VPS
+    CHECK_EQ(types[1], 33);     // SPS
+    CHECK_EQ(types[2], 34);     // PPS
+
+    uint32_t capacity = 64 * 1024;
+    uint8_t* frame = (uint8_t*)malloc(capacity);
+
+    // IDR: parameter sets, then an IDR_W_RADL slice; exactly the size asked
+    CHECK_EQ(SynthHevc_WriteFrame(&gen, true, frame, capacity, 20000), 20000);
+    CHECK(memcmp(frame, params, paramSize) == 0);
+    CHECK_EQ(NalTypes(frame, 20000, types, 8), 4);
+    CHECK_EQ(types[3], 19);
+    CHECK_EQ(frame[19999], 0x80);   // rbsp trailing bits
+
+    // P: one TRAIL_R slice, no start code inside the slice data
+    CHECK_EQ(SynthHevc_WriteFrame(&gen, false, frame, capacity, 5000), 5000);
+    CHECK_EQ(NalTypes(frame, 5000, types, 8), 1);
+    CHECK_EQ(types[0], 1);
+
+    // Too small is raised to the minimum; too little room writes nothing
+    uint32_t minP = SynthHevc_MinFrameSize(&gen, false);
+    CHECK(minP > 0 && minP < SynthHevc_MinFrameSize(&gen, true));
+    CHECK_EQ(SynthHevc_WriteFrame(&gen, false, frame, capacity, 1), minP);
+    CHECK_EQ(SynthHevc_WriteFrame(&gen, false, frame, 10, 5000), 0);
+
+    // Deterministic for a seed
+    SynthHevc a, b;
+    SynthHevc_Init(&a, &config);
+    SynthHevc_Init(&b, &config);
+    uint8_t* other = (uint8_t*)malloc(capacity);
+    SynthHevc_WriteFrame(&a, true, frame, capacity, 30000);
+    SynthHevc_WriteFrame(&b, true, other, capacity, 30000);
+    CHECK(memcmp(frame, other, 30000) == 0);
+
+    // Without repeated parameter sets an IDR is just the slice
+    config.repeatParamSets = false;
+    SynthHevc_Init(&gen, &config);
+    SynthHevc_WriteFrame(&gen, true, frame, capacity, 8000);
+    CHECK_EQ(NalTypes(frame, 8000, types, 8), 1);
+    CHECK_EQ(types[0], 19);
+
+    free(other);
+    free(frame);
+}
+
+static void TestAac(void) {
+    uint8_t config[SYNTH_AAC_CONFIG_SIZE];
+    CHECK_EQ(SynthAac_WriteConfig(48000, 2, config, sizeof(config)), 2);
+    CHECK_EQ(config[0], 0x11);      // AAC-LC, 48 kHz
+    CHECK_EQ(config[1], 0x90);      // Stereo
+    CHECK_EQ(SynthAac_WriteConfig(44100, 1, config, sizeof(config)), 2);
+    CHECK_EQ(config[0], 0x12);
+    CHECK_EQ(config[1], 0x08);
+    CHECK_EQ(SynthAac_WriteConfig(12345, 2, config, sizeof(config)), 0);
+    CHECK_EQ(SynthAac_WriteConfig(48000, 3, config, sizeof(config)), 0);
+
+    uint8_t frame[1024];
+    uint32_t minStereo = SynthAac_MinFrameSize(2);
+    CHECK(SynthAac_MinFrameSize(1) < minStereo);
+    CHECK_EQ(SynthAac_WriteFrame(2, frame, minStereo - 1), 0);
+    CHECK_EQ(SynthAac_WriteFrame(2, frame, minStereo), minStereo);
+    CHECK_EQ(SynthAac_WriteFrame(2, frame, 768), 768);
+    CHECK_EQ(frame[0] >> 5, 1);     // First element is a CPE
+
+    uint8_t adts[SYNTH_AAC_ADTS_HEADER_SIZE];
+    CHECK_EQ(SynthAac_WriteAdtsHeader(48000, 2, 768, adts), SYNTH_AAC_ADTS_HEADER_SIZE);
+    CHECK_EQ(adts[0], 0xFF);
+    CHECK_EQ(adts[1] & 0xF0, 0xF0);
+    uint32_t length = ((adts[3] & 0x03) << 11) | (adts[4] << 3) | (adts[5] >> 5);
+    CHECK_EQ(length, 768 + SYNTH_AAC_ADTS_HEADER_SIZE);
+    CHECK_EQ(SynthAac_WriteAdtsHeader(48000, 2, 0x2000, adts), 0);
+}
+
+int main(void) {
+    TestHevc();
+    TestAac();
+    return TEST_RESULT();
+}
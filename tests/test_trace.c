@@ -0,0 +1,276 @@
+/*
+ * Trace tests - Chrome JSON export from several threads, ring wrap-around
+ * and rings surviving Trace_Shutdown
+ *
+ * The export writes one event object per line; the test reads it back
+ * line by line.
+ */
+
+#include "test.h"
+#include "trace.h"
+#include "platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_PATH "lwsr-test-trace.json"
+#define MAX_TIDS 8
+
+typedef struct {
+    int tid;
+    int events;                 // Not counting the thread_name record
+    int depth;                  // Open B without E
+    bool named;
+    bool ordered;               // ts never decreased
+    double lastTs;
+    unsigned long long firstId;
+    unsigned long long lastId;
+    char name[64];
+} TidSummary;
+
+typedef struct {
+    TidSummary tids[MAX_TIDS];
+    int tidCount;
+    int badLines;
+    bool wrapped;               // Opening and closing lines present
+} TraceSummary;
+
+typedef struct {
+    const char* name;
+    int spans;
+    PlatformEvent* emitted;     // Set after the first batch
+    PlatformEvent* resume;      // Waited on before releasing the ring
+    bool again;                 // Emit a second batch after resuming
+} EmitterArgs;
+
+// ============================================================================
+// Reading the export
+// ============================================================================
+
+static const char* Field(const char* line, const char* key) {
+    const char* p = strstr(line, key);
+    return p ? p + strlen(key) : NULL;
+}
+
+static TidSummary* FindTid(TraceSummary* s, int tid) {
+    for (int i = 0; i < s->tidCount; i++) {
+        if (s->tids[i].tid == tid) return &s->tids[i];
+    }
+    if (s->tidCount == MAX_TIDS) return NULL;
+    TidSummary* t = &s->tids[s->tidCount++];
+    memset(t, 0, sizeof(*t));
+    t->tid = tid;
+    t->ordered = true;
+    t->lastTs = -1e300;
+    return t;
+}
+
+static bool ReadTrace(const char* path, TraceSummary* s) {
+    memset(s, 0, sizeof(*s));
+    FILE* f = fopen(path, "r");
+    if (!f) return false;
+
+    static char line[512];
+    bool opened = false, closed = false;
+    while (fgets(line, sizeof(line), f)) {
+        if (strncmp(line, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 39) == 0) {
+            opened = true;
+            continue;
+        }
+        if (strcmp(line, "]}\n") == 0) {
+            closed = true;
+            continue;
+        }
+
+        // Every record: {...} with a separating comma on all but the last
+        size_t len = strlen(line);
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == ',')) line[--len] = '\0';
+        const char* ph = Field(line, "\"ph\":\"");
+        const char* tidField = Field(line, "\"tid\":");
+        if (line[0] != '{' || line[len - 1] != '}' || !ph || !tidField) {
+            s->badLines++;
+            continue;
+        }
+        TidSummary* t = FindTid(s, atoi(tidField));
+        if (!t) {
+            s->badLines++;
+            continue;
+        }
+
+        if (ph[0] == 'M') {
+            const char* name = Field(line, "\"args\":{\"name\":\"");
+            if (!name) s->badLines++;
+            else sscanf(name, "%63[^\"]", t->name);
+            t->named = true;
+            continue;
+        }
+
+        const char* ts = Field(line, "\"ts\":");
+        const char* id = Field(line, "\"args\":{\"id\":");
+        if (!ts || !id || (ph[0] != 'B' && ph[0] != 'E' && ph[0] != 'i') || ph[1] != '"') {
+            s->badLines++;
+            continue;
+        }
+        if (ph[0] == 'i' && !strstr(line, "\"s\":\"t\"")) s->badLines++;
+        if (ph[0] == 'B') t->depth++;
+        if (ph[0] == 'E' && --t->depth < 0) s->badLines++;
+
+        double time = atof(ts);
+        if (time < t->lastTs) t->ordered = false;
+        t->lastTs = time;
+        unsigned long long value = strtoull(id, NULL, 10);
+        if (t->events == 0) t->firstId = value;
+        t->lastId = value;
+        t->events++;
+    }
+    fclose(f);
+    s->wrapped = opened && closed;
+    return true;
+}
+
+static TidSummary* FindNamed(TraceSummary* s, const char* prefix) {
+    for (int i = 0; i < s->tidCount; i++) {
+        if (strncmp(s->tids[i].name, prefix, strlen(prefix)) == 0) return &s->tids[i];
+    }
+    return NULL;
+}
+
+// ============================================================================
+// Emitters
+// ============================================================================
+
+static void EmitSpans(int spans) {
+    for (int i = 0; i < spans; i++) {
+        TRACE_BEGIN(TRACE_CONVERT, i);
+        TRACE_BEGIN(TRACE_SUBMIT, i);
+        TRACE_END(TRACE_SUBMIT, i);
+        TRACE_END(TRACE_CONVERT, i);
+        TRACE_INSTANT(TRACE_DROP, i);
+    }
+}
+
+static void EmitterThread(void* param) {
+    EmitterArgs* args = (EmitterArgs*)param;
+    Trace_SetThreadName(args->name);
+    EmitSpans(args->spans);
+    Platform_EventSet(args->emitted);
+    Platform_EventWait(args->resume, 5000);
+    if (args->again) EmitSpans(args->spans);
+    Trace_ReleaseThread();
+}
+
+// ============================================================================
+// Tests
+// ============================================================================
+
+// Both threads hold their rings while the export runs (a released ring is
+// handed to the next thread that needs one)
+static void TestTwoThreads(void) {
+    Trace_Enable(true);
+    PlatformEvent emitted[2], resume;
+    Platform_EventCreate(&resume, true, false);
+    PlatformThread threads[2];
+    EmitterArgs args[2] = { { "Capture", 100, &emitted[0], &resume, false },
+                            { "Encoder output", 50, &emitted[1], &resume, false } };
+    for (int i = 0; i < 2; i++) {
+        Platform_EventCreate(&emitted[i], true, false);
+        CHECK(Platform_ThreadCreate(&threads[i], EmitterThread, &args[i]));
+    }
+    for (int i = 0; i < 2; i++) CHECK(Platform_EventWait(&emitted[i], 5000));
+
+    CHECK(Trace_ExportChrome(TRACE_PATH));
+    Platform_EventSet(&resume);
+    for (int i = 0; i < 2; i++) {
+        Platform_ThreadJoin(&threads[i]);
+        Platform_EventDestroy(&emitted[i]);
+    }
+    Platform_EventDestroy(&resume);
+    TraceSummary s;
+    CHECK(ReadTrace(TRACE_PATH, &s));
+    CHECK(s.wrapped);
+    CHECK_EQ(s.badLines, 0);
+    CHECK_EQ(s.tidCount, 2);
+
+    TidSummary* capture = FindNamed(&s, "Capture (");
+    TidSummary* output = FindNamed(&s, "Encoder output (");
+    CHECK(capture != NULL && output != NULL);
+    if (!capture || !output) {
+        Trace_Shutdown();
+        return;
+    }
+    CHECK(capture->tid != output->tid);
+    CHECK(capture->named && output->named);
+    CHECK_EQ(capture->events, 100 * 5);
+    CHECK_EQ(output->events, 50 * 5);
+    CHECK_EQ(capture->depth, 0);
+    CHECK_EQ(output->depth, 0);
+    CHECK(capture->ordered && output->ordered);
+    CHECK_EQ(capture->lastId, 99);
+    Trace_Shutdown();
+}
+
+// More events than the ring holds: the oldest fall off, an E whose B was
+// overwritten is dropped, and what's left is the latest history in order
+static void TestWrap(void) {
+    Trace_Enable(true);
+    int spans = TRACE_RING_EVENTS / 2 + 101;
+    for (int i = 0; i < spans; i++) {
+        TRACE_BEGIN(TRACE_ENCODE, i);
+        TRACE_END(TRACE_ENCODE, i);
+    }
+    TRACE_END(TRACE_SAVE, 0);           // Unmatched: never exported
+
+    CHECK(Trace_ExportChrome(TRACE_PATH));
+    TraceSummary s;
+    CHECK(ReadTrace(TRACE_PATH, &s));
+    CHECK(s.wrapped);
+    CHECK_EQ(s.badLines, 0);
+    CHECK_EQ(s.tidCount, 1);
+    TidSummary* t = &s.tids[0];
+    // The oldest event left is span 101's E; it and the unmatched E are dropped
+    CHECK_EQ(t->events, TRACE_RING_EVENTS - 2);
+    CHECK_EQ(t->firstId, (unsigned long long)(spans - TRACE_RING_EVENTS / 2 + 1));
+    CHECK_EQ(t->lastId, (unsigned long long)(spans - 1));
+    CHECK_EQ(t->depth, 0);
+    CHECK(t->ordered);
+    Trace_Shutdown();
+}
+
+// A thread that held a ring across Trace_Shutdown gets a fresh one instead
+// of writing into the freed ring
+static void TestShutdownWhileAttached(void) {
+    Trace_Enable(true);
+    PlatformEvent emitted, resume;
+    Platform_EventCreate(&emitted, true, false);
+    Platform_EventCreate(&resume, true, false);
+    EmitterArgs args = { "Audio", 10, &emitted, &resume, true };
+    PlatformThread thread;
+    CHECK(Platform_ThreadCreate(&thread, EmitterThread, &args));
+    CHECK(Platform_EventWait(&emitted, 5000));
+
+    Trace_Shutdown();
+    Trace_Enable(true);
+    TRACE_INSTANT(TRACE_EVICT, 7);      // Attaches as before
+    Platform_EventSet(&resume);
+    Platform_ThreadJoin(&thread);
+
+    CHECK(Trace_ExportChrome(TRACE_PATH));
+    TraceSummary s;
+    CHECK(ReadTrace(TRACE_PATH, &s));
+    CHECK_EQ(s.badLines, 0);
+    CHECK_EQ(s.tidCount, 2);
+    TidSummary* audio = FindNamed(&s, "Audio (");
+    CHECK(audio != NULL);
+    if (audio) CHECK_EQ(audio->events, 10 * 5);    // Only the batch after shutdown
+    Trace_Shutdown();
+
+    Platform_EventDestroy(&emitted);
+    Platform_EventDestroy(&resume);
+}
+
+int main(void) {
+    TestTwoThreads();
+    TestWrap();
+    TestShutdownWhileAttached();
+    remove(TRACE_PATH);
+    return TEST_RESULT();
+}
@@ -0,0 +1,263 @@
+/*
+ * Frame Pacer Bench - Frame-start jitter and wakeup rate of the pacer
+ * Portable C; one JSON object per line, so runs diff across commits
+ *
+ * Cases:
+ * - pacer: FramePacer_Wait on a kernel timer at the given rate. Reports
+ *   ticks, missed deadlines, wakeups per second, wake lateness percentiles
+ *   and the pacer's own jitter histogram, plus drift (the next deadline
+ *   against start + frames / fps, which the integer grid keeps at 0)
+ * - pacer_role: the same on a thread registered under --role, so it runs
+ *   with that role's priority and affinity policy (the level the OS granted
+ *   is reported; raising it may need CAP_SYS_NICE on Linux)
+ * - poll_1ms: the loop the pacer replaced, sleeping 1 ms and comparing the
+ *   clock against a floating-point next-frame time, for comparison
+ *
+ * --hog N runs N threads spinning at normal priority for the whole run, so
+ * pacer and pacer_role compare jitter under CPU load without and with the
+ * role policy.
+ *
+ * Lateness is how long after its deadline a frame started, in nanoseconds.
+ *
+ *   lwsr-bench-frame-pacer --fps 60 --seconds 10 --hog 8 > before.jsonl
+ */
+
+#include "platform.h"
+#include "frame_pacer.h"
+#include "pipeline_latency.h"
+#include "thread_registry.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_HOGS 256
+#define PACER_THREAD_NAME "Bench pacer"
+
+typedef struct {
+    int fps;
+    int seconds;
+    int hogs;                   // Spinning threads
+    ThreadRole role;            // Policy for pacer_role
+    const char* only;           // Run just this case (NULL = all)
+} BenchOptions;
+
+typedef struct {
+    const BenchOptions* opt;
+    const char* name;
+    bool registered;            // Take opt->role's policy
+} PacerRun;
+
+typedef struct {
+    PlatformAtomic64 stop;
+    PlatformAtomic64 spins;
+} HogShared;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static void PrintLatency(const LatencyHistogram* hist) {
+    printf("\"p50_ns\":%lld,\"p99_ns\":%lld,\"p999_ns\":%lld,\"max_ns\":%lld,\"mean_ns\":%.0f",
+           (long long)LatencyHistogram_Percentile(hist, 50), (long long)LatencyHistogram_Percentile(hist, 99),
+           (long long)LatencyHistogram_Percentile(hist, 99.9), (long long)hist->max,
+           hist->count ? (double)hist->total / hist->count : 0.0);
+}
+
+static bool Selected(const BenchOptions* opt, const char* name) {
+    return !opt->only || strcmp(opt->only, name) == 0;
+}
+
+// ============================================================================
+// Pacer
+// ============================================================================
+
+static void PacerThread(void* param) {
+    PacerRun* run = (PacerRun*)param;
+    const BenchOptions* opt = run->opt;
+    FramePacer* pacer = FramePacer_Create(opt->fps, 1);
+    if (!pacer) return;
+
+    const char* level = "default";
+    if (run->registered) {
+        ThreadRegistry_Register(PACER_THREAD_NAME, opt->role);
+        ThreadStats threads[THREAD_REGISTRY_MAX];
+        int count = ThreadRegistry_Sample(threads, THREAD_REGISTRY_MAX);
+        for (int i = 0; i < count; i++) {
+            if (strcmp(threads[i].name, PACER_THREAD_NAME) == 0) level = ThreadRegistry_LevelName(threads[i].level);
+        }
+    }
+
+    static LatencyHistogram hist;
+    LatencyHistogram_Reset(&hist);
+    int64_t start = FramePacer_Now() + FRAME_PACER_UNITS_PER_SECOND / 10;
+    int64_t end = start + (int64_t)opt->seconds * FRAME_PACER_UNITS_PER_SECOND;
+    FramePacer_Reset(pacer, start);
+
+    int64_t wakeups = 0;
+    int64_t deadline = start;
+    while (deadline < end) {
+        wakeups++;
+        if (!FramePacer_Wait(pacer, &deadline)) continue;
+        LatencyHistogram_Record(&hist, (FramePacer_Now() - deadline) * 100);
+    }
+    int64_t elapsed = FramePacer_Now() - start;
+
+    FramePacerStats stats;
+    FramePacer_GetStats(pacer, &stats);
+
+    // Deadline k is start + k / fps exactly; any other value is drift
+    int64_t frames = (int64_t)(stats.ticks + stats.missed);
+    int64_t onGrid = start + frames * FRAME_PACER_UNITS_PER_SECOND / opt->fps;
+
+    printf("{\"bench\":\"%s\",\"fps\":%d,\"seconds\":%d,\"hogs\":%d,\"role\":\"%s\",\"level\":\"%s\","
+           "\"ticks\":%llu,\"missed\":%llu,\"wakeups_per_sec\":%.1f,\"drift_us\":%.1f,",
+           run->name, opt->fps, opt->seconds, opt->hogs,
+           run->registered ? ThreadRegistry_RoleName(opt->role) : "none", level,
+           (unsigned long long)stats.ticks, (unsigned long long)stats.missed,
+           elapsed > 0 ? wakeups * (double)FRAME_PACER_UNITS_PER_SECOND / elapsed : 0.0,
+           (FramePacer_NextDeadline(pacer) - onGrid) / 10.0);
+    PrintLatency(&hist);
+    printf(",\"histogram\":{");
+    for (int i = 0; i < FRAME_PACER_JITTER_BUCKETS; i++) {
+        int limit = FramePacer_BucketLimitUs(i);
+        if (limit >= 0) printf("%s\"<%dus\":%llu", i ? "," : "", limit, (unsigned long long)stats.histogram[i]);
+        else printf("%s\"more\":%llu", i ? "," : "", (unsigned long long)stats.histogram[i]);
+    }
+    printf("}}\n");
+    fflush(stdout);
+
+    FramePacer_Destroy(pacer);
+    if (run->registered) ThreadRegistry_Unregister();
+}
+
+// On its own thread, so a role's policy doesn't outlive the case
+static void BenchPacer(const BenchOptions* opt, const char* name, bool registered) {
+    PacerRun run = { opt, name, registered };
+    PlatformThread thread;
+    if (!Platform_ThreadCreate(&thread, PacerThread, &run)) return;
+    Platform_ThreadJoin(&thread);
+}
+
+// ============================================================================
+// CPU hog
+// ============================================================================
+
+static void HogThread(void* param) {
+    HogShared* shared = (HogShared*)param;
+    volatile uint64_t x = 1;
+    int64_t spins = 0;
+    while (!Platform_AtomicLoad64(&shared->stop)) {
+        for (int i = 0; i < 100000; i++) x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        spins++;
+    }
+    Platform_AtomicAdd64(&shared->spins, spins);
+}
+
+// ============================================================================
+// 1 ms polling (the old loop)
+// ============================================================================
+
+static void BenchPoll(const BenchOptions* opt) {
+    static LatencyHistogram hist;
+    LatencyHistogram_Reset(&hist);
+    double interval = 1e9 / opt->fps;
+    int64_t start = Platform_SystemNowNs();
+    int64_t end = start + (int64_t)opt->seconds * 1000000000LL;
+    double next = (double)start;
+
+    int64_t wakeups = 0;
+    int64_t ticks = 0;
+    int64_t now = start;
+    while (now < end) {
+        now = Platform_SystemNowNs();
+        if (now >= next) {
+            LatencyHistogram_Record(&hist, now - (int64_t)next);
+            ticks++;
+            next += interval;
+            continue;
+        }
+        Platform_SleepMs(1);
+        wakeups++;
+    }
+    int64_t elapsed = Platform_SystemNowNs() - start;
+
+    printf("{\"bench\":\"poll_1ms\",\"fps\":%d,\"seconds\":%d,\"hogs\":%d,\"ticks\":%lld,\"wakeups_per_sec\":%.1f,",
+           opt->fps, opt->seconds, opt->hogs, (long long)ticks, elapsed > 0 ? wakeups * 1e9 / elapsed : 0.0);
+    PrintLatency(&hist);
+    printf("}\n");
+    fflush(stdout);
+}
+
+// ============================================================================
+// Command line
+// ============================================================================
+
+static void Usage(void) {
+    fprintf(stderr,
+        "usage: lwsr-bench-frame-pacer [options]\n"
+        "  --fps N              frame rate (60)\n"
+        "  --seconds N          length of each case (5)\n"
+        "  --hog N              threads spinning during every case (0)\n"
+        "  --role NAME          policy for pacer_role: capture | encode | encoder output |\n"
+        "                       audio capture | mixer | save | logger (capture)\n"
+        "  --only NAME          pacer | pacer_role | poll_1ms\n");
+}
+
+static bool ParseRole(const char* name, ThreadRole* role) {
+    for (int i = 0; i < THREAD_ROLE_COUNT; i++) {
+        if (strcmp(name, ThreadRegistry_RoleName((ThreadRole)i)) == 0) {
+            *role = (ThreadRole)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ParseArgs(int argc, char** argv, BenchOptions* opt) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[++i] : NULL;
+        if (!value) return false;
+
+        if (strcmp(arg, "--fps") == 0) opt->fps = atoi(value);
+        else if (strcmp(arg, "--seconds") == 0) opt->seconds = atoi(value);
+        else if (strcmp(arg, "--hog") == 0) opt->hogs = atoi(value);
+        else if (strcmp(arg, "--role") == 0) { if (!ParseRole(value, &opt->role)) return false; }
+        else if (strcmp(arg, "--only") == 0) opt->only = value;
+        else return false;
+    }
+
+    if (opt->hogs > MAX_HOGS) opt->hogs = MAX_HOGS;
+    return opt->fps > 0 && opt->seconds > 0 && opt->hogs >= 0;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    memset(&opt, 0, sizeof(opt));
+    opt.fps = 60;
+    opt.seconds = 5;
+    opt.role = THREAD_ROLE_CAPTURE;
+
+    if (!ParseArgs(argc, argv, &opt)) {
+        Usage();
+        return 2;
+    }
+
+    static HogShared hog;
+    static PlatformThread hogs[MAX_HOGS];
+    Platform_AtomicStore64(&hog.stop, 0);
+    Platform_AtomicStore64(&hog.spins, 0);
+    int started = 0;
+    for (int i = 0; i < opt.hogs; i++) {
+        if (Platform_ThreadCreate(&hogs[started], HogThread, &hog)) started++;
+    }
+    opt.hogs = started;
+
+    if (Selected(&opt, "pacer")) BenchPacer(&opt, "pacer", false);
+    if (Selected(&opt, "pacer_role")) BenchPacer(&opt, "pacer_role", true);
+    if (Selected(&opt, "poll_1ms")) BenchPoll(&opt);
+
+    Platform_AtomicStore64(&hog.stop, 1);
+    for (int i = 0; i < started; i++) Platform_ThreadJoin(&hogs[i]);
+    return 0;
+}
@@ -0,0 +1,227 @@
+/*
+ * Image Encoder Bench - Screenshot encode time and size, PNG and QOI
+ * Portable C; one JSON object per line, so runs diff across commits
+ *
+ * Cases, each on every content kind:
+ * - png: ImageEncoder_EncodePNG with --threads strips workers (0 = one
+ *   per CPU, as the Save button does)
+ * - png_single: the same on one thread, the cost of the filter and deflate
+ *   code itself
+ * - qoi: ImageEncoder_EncodeQOI
+ *
+ * Content kinds:
+ * - desktop: flat windows, title bars and rows of text-like glyph runs
+ * - gradient: smooth two-axis gradient (long matches for PNG, few QOI runs)
+ * - noise: random bytes, the incompressible worst case (PNG falls back to
+ *   stored blocks)
+ *
+ * Encode latencies are in nanoseconds on the system clock; bytes is the
+ * encoded file size and ratio is the raw BGRA size over it.
+ *
+ *   lwsr-bench-image-encoder --width 5120 --height 1440 > before.jsonl
+ */
+
+#include "platform.h"
+#include "image_encoder.h"
+#include "pipeline_latency.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    int width;
+    int height;
+    int iterations;
+    int threads;                // PNG workers for the png case (0 = one per CPU)
+    const char* content;        // Run just this content kind (NULL = all)
+    const char* only;           // Run just this case (NULL = all)
+} BenchOptions;
+
+typedef void (*FillFunc)(uint8_t* bgra, int width, int height, int pitch);
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static void PrintLatency(const LatencyHistogram* hist) {
+    printf("\"p50_ns\":%lld,\"p99_ns\":%lld,\"p999_ns\":%lld,\"max_ns\":%lld,\"mean_ns\":%.0f",
+           (long long)LatencyHistogram_Percentile(hist, 50), (long long)LatencyHistogram_Percentile(hist, 99),
+           (long long)LatencyHistogram_Percentile(hist, 99.9), (long long)hist->max,
+           hist->count ? (double)hist->total / hist->count : 0.0);
+}
+
+static bool Selected(const BenchOptions* opt, const char* name) {
+    return !opt->only || strcmp(opt->only, name) == 0;
+}
+
+static uint32_t NextRandom(uint32_t* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state >> 8;
+}
+
+// ============================================================================
+// Content
+// ============================================================================
+
+static void FillRect(uint8_t* bgra, int pitch, int x0, int y0, int x1, int y1, uint32_t color) {
+    for (int y = y0; y < y1; y++) {
+        uint32_t* row = (uint32_t*)(bgra + (size_t)y * pitch);
+        for (int x = x0; x < x1; x++) row[x] = color;
+    }
+}
+
+static void FillDesktop(uint8_t* bgra, int width, int height, int pitch) {
+    uint32_t seed = 1;
+    FillRect(bgra, pitch, 0, 0, width, height, 0xFF2D5A88);
+
+    // Overlapping windows: title bar, white client area, lines of "text"
+    for (int w = 0; w < 12; w++) {
+        int x0 = (int)(NextRandom(&seed) % (uint32_t)(width * 3 / 4));
+        int y0 = (int)(NextRandom(&seed) % (uint32_t)(height * 3 / 4));
+        int x1 = x0 + width / 6 + (int)(NextRandom(&seed) % (uint32_t)(width / 4));
+        int y1 = y0 + height / 5 + (int)(NextRandom(&seed) % (uint32_t)(height / 3));
+        if (x1 > width) x1 = width;
+        if (y1 > height) y1 = height;
+        int bar = y0 + 30 < y1 ? y0 + 30 : y1;
+        FillRect(bgra, pitch, x0, y0, x1, bar, 0xFF3C3C3C);
+        FillRect(bgra, pitch, x0, bar, x1, y1, 0xFFFFFFFF);
+
+        for (int line = bar + 8; line + 12 < y1; line += 18) {
+            int x = x0 + 8;
+            while (x + 8 < x1 - 8) {
+                int word = 3 + (int)(NextRandom(&seed) % 8);
+                for (int c = 0; c < word && x + 8 < x1 - 8; c++, x += 8) {
+                    uint32_t glyph = NextRandom(&seed);
+                    for (int gy = 0; gy < 12; gy++) {
+                        uint32_t* row = (uint32_t*)(bgra + (size_t)(line + gy) * pitch);
+                        for (int gx = 0; gx < 6; gx++) {
+                            if (glyph >> ((gy * 6 + gx) % 24) & 1) row[x + gx] = 0xFF202020;
+                        }
+                    }
+                }
+                x += 8;
+            }
+        }
+    }
+}
+
+static void FillGradient(uint8_t* bgra, int width, int height, int pitch) {
+    for (int y = 0; y < height; y++) {
+        uint8_t* row = bgra + (size_t)y * pitch;
+        for (int x = 0; x < width; x++) {
+            row[x * 4 + 0] = (uint8_t)((x + y) * 255 / (width + height));
+            row[x * 4 + 1] = (uint8_t)(y * 255 / height);
+            row[x * 4 + 2] = (uint8_t)(x * 255 / width);
+            row[x * 4 + 3] = 255;
+        }
+    }
+}
+
+static void FillNoise(uint8_t* bgra, int width, int height, int pitch) {
+    uint32_t seed = 7;
+    for (int y = 0; y < height; y++) {
+        uint8_t* row = bgra + (size_t)y * pitch;
+        for (int x = 0; x < width * 4; x++) row[x] = (uint8_t)NextRandom(&seed);
+    }
+}
+
+// ============================================================================
+// Encode
+// ============================================================================
+
+static void BenchEncode(const BenchOptions* opt, const char* name, const char* content,
+                        const uint8_t* bgra, int pitch, int threads) {
+    static LatencyHistogram hist;
+    LatencyHistogram_Reset(&hist);
+    size_t bytes = 0;
+    bool ok = true;
+
+    for (int i = 0; i < opt->iterations && ok; i++) {
+        EncodedImage image;
+        int64_t t0 = Platform_SystemNowNs();
+        if (threads < 0) ok = ImageEncoder_EncodeQOI(bgra, opt->width, opt->height, pitch, &image);
+        else ok = ImageEncoder_EncodePNG(bgra, opt->width, opt->height, pitch, threads, &image);
+        LatencyHistogram_Record(&hist, Platform_SystemNowNs() - t0);
+        if (!ok) break;
+        bytes = image.size;
+        ImageEncoder_Free(&image);
+    }
+
+    double raw = (double)opt->width * opt->height * 4;
+    double mean = hist.count ? (double)hist.total / hist.count : 0.0;
+    printf("{\"bench\":\"%s\",\"content\":\"%s\",\"width\":%d,\"height\":%d,\"threads\":%d,\"ok\":%s,"
+           "\"iterations\":%llu,\"bytes\":%zu,\"ratio\":%.2f,\"mpix_per_sec\":%.1f,",
+           name, content, opt->width, opt->height, threads < 0 ? 1 : threads, ok ? "true" : "false",
+           (unsigned long long)hist.count, bytes, bytes ? raw / bytes : 0.0,
+           mean > 0 ? (double)opt->width * opt->height * 1e3 / mean : 0.0);
+    PrintLatency(&hist);
+    printf("}\n");
+    fflush(stdout);
+}
+
+static void BenchContent(const BenchOptions* opt, const char* content, FillFunc fill) {
+    if (opt->content && strcmp(opt->content, content) != 0) return;
+
+    // Pitch wider than the row, as a GetDIBits or mapped texture readback may be
+    int pitch = opt->width * 4 + 64;
+    uint8_t* bgra = (uint8_t*)malloc((size_t)pitch * opt->height);
+    if (!bgra) return;
+    fill(bgra, opt->width, opt->height, pitch);
+
+    if (Selected(opt, "png")) BenchEncode(opt, "png", content, bgra, pitch, opt->threads);
+    if (Selected(opt, "png_single")) BenchEncode(opt, "png_single", content, bgra, pitch, 1);
+    if (Selected(opt, "qoi")) BenchEncode(opt, "qoi", content, bgra, pitch, -1);
+    free(bgra);
+}
+
+// ============================================================================
+// Command line
+// ============================================================================
+
+static void Usage(void) {
+    fprintf(stderr,
+        "usage: lwsr-bench-image-encoder [options]\n"
+        "  --width N            frame width (5120)\n"
+        "  --height N           frame height (1440)\n"
+        "  --iterations N       encodes per case (5)\n"
+        "  --threads N          PNG workers in the png case, 0 = one per CPU (0)\n"
+        "  --content NAME       desktop | gradient | noise\n"
+        "  --only NAME          png | png_single | qoi\n");
+}
+
+static bool ParseArgs(int argc, char** argv, BenchOptions* opt) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[++i] : NULL;
+        if (!value) return false;
+
+        if (strcmp(arg, "--width") == 0) opt->width = atoi(value);
+        else if (strcmp(arg, "--height") == 0) opt->height = atoi(value);
+        else if (strcmp(arg, "--iterations") == 0) opt->iterations = atoi(value);
+        else if (strcmp(arg, "--threads") == 0) opt->threads = atoi(value);
+        else if (strcmp(arg, "--content") == 0) opt->content = value;
+        else if (strcmp(arg, "--only") == 0) opt->only = value;
+        else return false;
+    }
+
+    // The desktop content draws windows and glyphs of fixed size
+    return opt->width >= 256 && opt->height >= 256 && opt->iterations > 0 && opt->threads >= 0;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    memset(&opt, 0, sizeof(opt));
+    opt.width = 5120;
+    opt.height = 1440;
+    opt.iterations = 5;
+
+    if (!ParseArgs(argc, argv, &opt)) {
+        Usage();
+        return 2;
+    }
+
+    BenchContent(&opt, "desktop", FillDesktop);
+    BenchContent(&opt, "gradient", FillGradient);
+    BenchContent(&opt, "noise", FillNoise);
+    return 0;
+}
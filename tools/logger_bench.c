@@ -0,0 +1,234 @@
+/*
+ * Logger Bench - Throughput and producer latency of the async logger
+ * Portable C; one JSON object per line, so runs diff across commits
+ *
+ * Cases (each with --producers threads logging at once):
+ * - burst: every producer logs flat out. Reports producer-side throughput,
+ *   drops, the latency of each Logger_Log call and the rate lines reached
+ *   the file (until Logger_Flush returns). The queue is full most of the
+ *   time, so that rate is the writer's worst case: it competes with
+ *   producers retrying on the same queue slots
+ * - paced: each producer logs one message a millisecond, as the pipeline
+ *   threads do; the queue never fills, so this is the steady-state cost
+ * - filtered: LOG_DEBUG with the runtime level at warnings
+ * - sync: the logger this replaced (lock, vfprintf, fflush per call) on
+ *   the same messages, for comparison
+ *
+ * Messages look like the encoder's per-frame lines (an int, a 64-bit
+ * value, a double and a short string). Latencies are in nanoseconds on
+ * the system clock.
+ *
+ *   lwsr-bench-logger --producers 4 > before.jsonl
+ */
+
+#include "platform.h"
+#include "logger.h"
+#include "pipeline_latency.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_PRODUCERS 32
+
+typedef struct {
+    int producers;
+    int messages;               // Per producer, burst / filtered / sync
+    int pacedMessages;          // Per producer, paced
+    const char* file;
+    const char* only;           // Run just this case (NULL = all)
+} BenchOptions;
+
+typedef enum {
+    MODE_ASYNC,
+    MODE_FILTERED,
+    MODE_SYNC
+} LogMode;
+
+typedef struct {
+    int index;
+    int messages;
+    int pauseMs;                // Between messages (0 = flat out)
+    LogMode mode;
+    LatencyHistogram hist;
+} Producer;
+
+// Shared by the sync case
+static PlatformMutex g_syncLock;
+static FILE* g_syncFile;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static void PrintLatency(const LatencyHistogram* hist) {
+    printf("\"p50_ns\":%lld,\"p99_ns\":%lld,\"p999_ns\":%lld,\"max_ns\":%lld,\"mean_ns\":%.0f",
+           (long long)LatencyHistogram_Percentile(hist, 50), (long long)LatencyHistogram_Percentile(hist, 99),
+           (long long)LatencyHistogram_Percentile(hist, 99.9), (long long)hist->max,
+           hist->count ? (double)hist->total / hist->count : 0.0);
+}
+
+static bool Selected(const BenchOptions* opt, const char* name) {
+    return !opt->only || strcmp(opt->only, name) == 0;
+}
+
+static long long FileSize(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+    fseek(f, 0, SEEK_END);
+    long long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+// The old Logger_Log: one lock, format and flush per call
+static void SyncLog(const char* fmt, ...) {
+    Platform_MutexLock(&g_syncLock);
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(g_syncFile, fmt, args);
+    va_end(args);
+    fputc('\n', g_syncFile);
+    fflush(g_syncFile);
+    Platform_MutexUnlock(&g_syncLock);
+}
+
+// ============================================================================
+// Producers
+// ============================================================================
+
+static void ProducerThread(void* param) {
+    Producer* p = (Producer*)param;
+    static const char* stages[] = { "submit", "output", "mux" };
+    for (int i = 0; i < p->messages; i++) {
+        long long timestamp = (long long)i * 166667;
+        double ms = i * 0.016;
+        const char* stage = stages[i % 3];
+
+        int64_t t0 = Platform_SystemNowNs();
+        switch (p->mode) {
+        case MODE_ASYNC:
+            Logger_Log("Producer %d: frame %d ts=%lld took %.3fms (%s)", p->index, i, timestamp, ms, stage);
+            break;
+        case MODE_FILTERED:
+            LOG_DEBUG("Producer %d: frame %d ts=%lld took %.3fms (%s)", p->index, i, timestamp, ms, stage);
+            break;
+        case MODE_SYNC:
+            SyncLog("Producer %d: frame %d ts=%lld took %.3fms (%s)", p->index, i, timestamp, ms, stage);
+            break;
+        }
+        LatencyHistogram_Record(&p->hist, Platform_SystemNowNs() - t0);
+
+        if (p->pauseMs > 0) Platform_SleepMs(p->pauseMs);
+    }
+}
+
+static void BenchCase(const BenchOptions* opt, const char* name, LogMode mode, int messages, int pauseMs) {
+    if (mode == MODE_SYNC) {
+        g_syncFile = fopen(opt->file, "w");
+        if (!g_syncFile) return;
+        Platform_MutexInit(&g_syncLock);
+    } else {
+        Logger_Init(opt->file, "w");
+        if (!Logger_IsInitialized()) return;
+        Logger_SetLevel(mode == MODE_FILTERED ? LOG_LEVEL_WARN : LOG_LEVEL_DEBUG);
+    }
+
+    static Producer producers[MAX_PRODUCERS];
+    PlatformThread threads[MAX_PRODUCERS];
+    for (int i = 0; i < opt->producers; i++) {
+        producers[i].index = i;
+        producers[i].messages = messages;
+        producers[i].pauseMs = pauseMs;
+        producers[i].mode = mode;
+        LatencyHistogram_Reset(&producers[i].hist);
+    }
+
+    int started = 0;
+    int64_t start = Platform_SystemNowNs();
+    for (int i = 0; i < opt->producers; i++) {
+        if (Platform_ThreadCreate(&threads[started], ProducerThread, &producers[started])) started++;
+    }
+    for (int i = 0; i < started; i++) Platform_ThreadJoin(&threads[i]);
+    int64_t produced = Platform_SystemNowNs() - start;
+
+    unsigned long long dropped = 0;
+    bool flushed = true;
+    if (mode == MODE_SYNC) {
+        fclose(g_syncFile);
+        g_syncFile = NULL;
+        Platform_MutexDestroy(&g_syncLock);
+    } else {
+        flushed = Logger_Flush(30000);
+        dropped = Logger_GetDropped();
+    }
+    int64_t written = Platform_SystemNowNs() - start;
+    if (mode != MODE_SYNC) Logger_Shutdown();
+
+    static LatencyHistogram hist;
+    LatencyHistogram_Reset(&hist);
+    for (int i = 0; i < started; i++) LatencyHistogram_Merge(&hist, &producers[i].hist);
+
+    long long bytes = FileSize(opt->file);
+    printf("{\"bench\":\"%s\",\"producers\":%d,\"messages\":%llu,\"dropped\":%llu,\"flushed\":%s,"
+           "\"produce_msgs_per_sec\":%.0f,\"written_msgs_per_sec\":%.0f,\"file_bytes\":%lld,",
+           name, started, (unsigned long long)hist.count, dropped, flushed ? "true" : "false",
+           produced > 0 ? hist.count * 1e9 / produced : 0.0,
+           written > 0 && mode != MODE_FILTERED ? (hist.count - dropped) * 1e9 / written : 0.0, bytes);
+    PrintLatency(&hist);
+    printf("}\n");
+    fflush(stdout);
+}
+
+// ============================================================================
+// Command line
+// ============================================================================
+
+static void Usage(void) {
+    fprintf(stderr,
+        "usage: lwsr-bench-logger [options]\n"
+        "  --producers N        concurrent logging threads (4)\n"
+        "  --messages N         messages per producer in burst, filtered and sync (200000)\n"
+        "  --paced N            messages per producer in paced, one per ms (2000)\n"
+        "  --file PATH          log file, removed afterwards (lwsr-bench-logger.log)\n"
+        "  --only NAME          burst | paced | filtered | sync\n");
+}
+
+static bool ParseArgs(int argc, char** argv, BenchOptions* opt) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[++i] : NULL;
+        if (!value) return false;
+
+        if (strcmp(arg, "--producers") == 0) opt->producers = atoi(value);
+        else if (strcmp(arg, "--messages") == 0) opt->messages = atoi(value);
+        else if (strcmp(arg, "--paced") == 0) opt->pacedMessages = atoi(value);
+        else if (strcmp(arg, "--file") == 0) opt->file = value;
+        else if (strcmp(arg, "--only") == 0) opt->only = value;
+        else return false;
+    }
+
+    if (opt->producers > MAX_PRODUCERS) opt->producers = MAX_PRODUCERS;
+    return opt->producers > 0 && opt->messages > 0 && opt->pacedMessages > 0;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    memset(&opt, 0, sizeof(opt));
+    opt.producers = 4;
+    opt.messages = 200000;
+    opt.pacedMessages = 2000;
+    opt.file = "lwsr-bench-logger.log";
+
+    if (!ParseArgs(argc, argv, &opt)) {
+        Usage();
+        return 2;
+    }
+
+    if (Selected(&opt, "burst")) BenchCase(&opt, "burst", MODE_ASYNC, opt.messages, 0);
+    if (Selected(&opt, "paced")) BenchCase(&opt, "paced", MODE_ASYNC, opt.pacedMessages, 1);
+    if (Selected(&opt, "filtered")) BenchCase(&opt, "filtered", MODE_FILTERED, opt.messages, 0);
+    if (Selected(&opt, "sync")) BenchCase(&opt, "sync", MODE_SYNC, opt.messages, 0);
+    remove(opt.file);
+    return 0;
+}
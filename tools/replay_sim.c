@@ -0,0 +1,782 @@
+/*
+ * Replay Sim - Deterministic simulation of the replay engine
+ * Portable C; runs the engine's portable core on a virtual clock
+ *
+ * The buffer thread in replay_buffer.c is bound to D3D11, NVENC and WASAPI,
+ * so this drives the same components it drives - SampleBuffer, AudioStore,
+ * Backpressure, QualityController, PipelineLatency, MemTracker - from
+ * stand-in sources instead:
+ * - Capture: ticks on the exact frame grid, content from a StreamModel
+ *   (motion and static scenes, optional VFR coalescing as in the engine),
+ *   or with --source real frames from a FrameSource (pattern, Y4M or raw
+ *   file) converted to NV12 on the CPU, their change flags driving the
+ *   encoder model and VFR
+ * - Encoder: a serial service-time model (log-normal, with occasional
+ *   stalls) and the backend's in-flight limit; completions
+ *   produce StreamModel-sized HEVC access units (SynthHevc) in tracked memory
+ * - Audio: 1024-sample AAC-LC frames at 48 kHz / 192 kbps (SynthAac)
+ * - Saves: the engine's copy step on a schedule, plus a pass over the copies
+ *   in place of the muxer, or with --save-dir the copies written out as
+ *   .hevc / .aac (ADTS) elementary streams any demuxer can check
+ *
+ * Time is a discrete-event clock installed with Platform_SetClockSource,
+ * so a 20-minute session runs in seconds and the same seed always makes the
+ * same decisions (drops, QP changes, buffer contents). Costs - add/evict,
+ * save copies - are real work on the real allocator and are measured with
+ * the system clock. A save takes no virtual time here; in the engine it
+ * blocks the buffer thread and queued ticks can drop. With --source, reading
+ * and converting each frame is real work too, so the run is only as fast
+ * as the CPU converts (use a smaller size or fewer minutes).
+ *
+ *   lwsr-replay-sim --minutes 20 --width 2560 --height 1440 --fps 60
+ */
+
+#include "platform.h"
+#include "sample_buffer.h"
+#include "audio_store.h"
+#include "stream_model.h"
+#include "synth_bitstream.h"
+#include "frame_source.h"
+#include "cpu_converter.h"
+#include "backpressure.h"
+#include "quality_controller.h"
+#include "pipeline_latency.h"
+#include "media_clock.h"
+#include "mem_tracker.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#define UNITS_PER_MS 10000LL
+
+// AAC output as configured in aac_encoder.h
+#define SIM_AAC_SAMPLE_RATE     48000
+#define SIM_AAC_FRAME_SAMPLES   1024
+#define SIM_AAC_BITRATE         192000
+#define SIM_AAC_CHANNELS        2
+
+// As replay_buffer.h
+#define SIM_VFR_MAX_FRAME_GAP_MS 1000
+
+#define SIM_MAX_IN_FLIGHT BACKPRESSURE_MAX_IN_FLIGHT
+
+typedef struct {
+    int minutes;
+    int width;
+    int height;
+    int fps;
+    QualityPreset quality;
+    int bufferSeconds;
+    int memoryMB;               // Replay memory budget (0 = fixed quality)
+    int saveEverySeconds;       // 0 = no saves
+    bool vfr;
+    bool audio;
+    bool fill;                  // Write every payload byte, like an encoder
+    const char* saveDir;        // Write saves as elementary streams (NULL = don't)
+    const char* source;         // Frame source: "pattern", .y4m, .bgra or .nv12 (NULL = content model)
+    int inFlight;               // Encoder ring (NVENC_NUM_BUFFERS)
+    double encodeMs;            // Mean encoder service time per frame
+    double stallEverySeconds;   // Mean time between encoder stalls (0 = none)
+    double stallMs;
+    double staticFraction;
+    uint64_t seed;
+    bool json;
+} SimOptions;
+
+// Admitted frame waiting in the encoder
+typedef struct {
+    int64_t timestamp;          // Media time
+    int64_t done;               // Completion on the virtual clock
+    bool changed;
+} SimJob;
+
+typedef struct {
+    SimOptions opt;
+
+    int64_t now;                // Virtual clock (installed as the platform clock)
+    MediaClock clock;
+
+    StreamModel video;
+    SynthHevc hevc;
+    FrameSource* source;        // NULL = StreamModel decides what changed
+    uint8_t* frame;             // Last frame read from the source
+    CPUConverter converter;     // BGRA sources only
+    uint64_t sourceRewinds;
+    StreamRandom encoderRng;
+    SampleBuffer buffer;
+    AudioStore audio;
+    Backpressure* bp;
+    QualityController* qc;
+    PipelineLatency* latency;
+
+    SimJob jobs[SIM_MAX_IN_FLIGHT];
+    int jobHead;
+    int jobCount;
+    int64_t encoderFree;        // When the encoder finishes its queue
+    int64_t nextStall;
+
+    int64_t lastSubmit;
+    uint64_t ticks;
+    uint64_t coalesced;
+    uint64_t encoded;
+    uint64_t qualityChanges;
+    int64_t videoBytes;
+
+    // Real costs (nanoseconds) once the buffer has reached its duration
+    LatencyHistogram captureCost;   // Source read + NV12 conversion
+    LatencyHistogram addCost;
+    LatencyHistogram evictCost;
+    LatencyHistogram audioAddCost;
+    LatencyHistogram saveCost;      // 100-ns units
+    uint64_t evicted;
+    int saves;
+    int64_t saveBytesMax;
+    int64_t savePeakMax;            // Tracked memory during the worst save
+} Sim;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static int64_t PeakRssBytes(void) {
+#ifdef _WIN32
+    return 0;   // Not tracked here; see MemTracker peak
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return (int64_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+static int64_t ServiceTime(Sim* sim) {
+    double ms = sim->opt.encodeMs * StreamRandom_LogNormal(&sim->encoderRng, 0.3);
+    return (int64_t)(ms * UNITS_PER_MS);
+}
+
+// ============================================================================
+// Stand-in encoder
+// ============================================================================
+
+static void SubmitFrame(Sim* sim, int64_t timestamp, bool changed) {
+    bool accepted = sim->jobCount < sim->opt.inFlight;
+    if (accepted) {
+        int64_t start = sim->encoderFree > sim->now ? sim->encoderFree : sim->now;
+
+        // Occasional stall (GPU contention, driver hiccup) delays the queue
+        if (sim->opt.stallEverySeconds > 0 && start >= sim->nextStall) {
+            start += (int64_t)(sim->opt.stallMs * UNITS_PER_MS);
+            double gap = -sim->opt.stallEverySeconds * log(1.0 - StreamRandom_Uniform(&sim->encoderRng));
+            sim->nextStall = start + (int64_t)(gap * PLATFORM_UNITS_PER_SECOND);
+        }
+
+        SimJob* job = &sim->jobs[(sim->jobHead + sim->jobCount) % SIM_MAX_IN_FLIGHT];
+        job->timestamp = timestamp;
+        job->changed = changed;
+        job->done = start + ServiceTime(sim);
+        sim->encoderFree = job->done;
+        sim->jobCount++;
+
+        LatencyTag tag = { timestamp, sim->now, sim->now };
+        PipelineLatency_TagFrame(sim->latency, &tag);
+        sim->lastSubmit = timestamp;
+    }
+    Backpressure_SubmitResult(sim->bp, timestamp, sim->now, accepted);
+}
+
+// Encoder output: the engine's DrainCallback
+static void CompleteFrame(Sim* sim) {
+    SimJob job = sim->jobs[sim->jobHead];
+    sim->jobHead = (sim->jobHead + 1) % SIM_MAX_IN_FLIGHT;
+    sim->jobCount--;
+
+    Backpressure_Completed(sim->bp, job.timestamp, sim->now);
+
+    bool keyframe = false;
+    uint32_t size = StreamModel_NextFrame(&sim->video, job.timestamp, job.changed, &keyframe);
+    if (sim->opt.fill) {
+        uint32_t minSize = SynthHevc_MinFrameSize(&sim->hevc, keyframe);
+        if (size < minSize) size = minSize;
+    }
+    QualityController_Record(sim->qc, job.timestamp, size);
+
+    LatencyTag tag;
+    if (PipelineLatency_TakeTag(sim->latency, job.timestamp, &tag)) {
+        PipelineLatency_Record(sim->latency, LATENCY_ENCODE, sim->now - tag.submitTime);
+    }
+
+    EncodedFrame frame;
+    frame.data = (BYTE*)MemTracker_Alloc(MEM_TAG_VIDEO_ENCODER, size);
+    if (!frame.data) return;
+    if (sim->opt.fill) {
+        SynthHevc_WriteFrame(&sim->hevc, keyframe, frame.data, size, size);
+    } else {
+        frame.data[0] = 0;
+    }
+    frame.size = size;
+    frame.timestamp = job.timestamp;
+    frame.duration = MF_UNITS_PER_SECOND / sim->opt.fps;
+    frame.isKeyframe = keyframe;
+
+    bool full = SampleBuffer_GetDuration(&sim->buffer) >= sim->opt.bufferSeconds - 1;
+    int64_t t0 = Platform_SystemNowNs();
+    SampleBuffer_Add(&sim->buffer, &frame);
+    int64_t cost = Platform_SystemNowNs() - t0;
+    if (frame.data) MemTracker_Free(frame.data);
+
+    // Eviction is timed inside Add, so it is also part of the add cost
+    int removed = sim->buffer.lastEvicted;
+    if (full) {
+        LatencyHistogram_Record(&sim->addCost, cost);
+        if (removed > 0) LatencyHistogram_Record(&sim->evictCost, sim->buffer.lastEvictNs);
+    }
+    if (removed > 0) sim->evicted += removed;
+
+    sim->encoded++;
+    sim->videoBytes += size;
+}
+
+// ============================================================================
+// Stand-in capture, audio and saves
+// ============================================================================
+
+// Read and convert the next source frame, as capture and the color
+// converter would; finite sources loop. Returns whether the content changed.
+static bool CaptureFrame(Sim* sim) {
+    SourceFrame frame;
+    int64_t t0 = Platform_SystemNowNs();
+    bool ok = FrameSource_Read(sim->source, sim->frame, 0, &frame);
+    if (!ok && FrameSource_Rewind(sim->source)) {
+        sim->sourceRewinds++;
+        ok = FrameSource_Read(sim->source, sim->frame, 0, &frame);
+    }
+    if (!ok) return false;
+    if (sim->converter.initialized) {
+        CPUConverter_Convert(&sim->converter, sim->frame, FrameSource_DefaultPitch(&sim->source->info));
+    }
+    LatencyHistogram_Record(&sim->captureCost, Platform_SystemNowNs() - t0);
+    return frame.changed;
+}
+
+// One tick of the buffer thread's capture loop
+static void CaptureTick(Sim* sim, int64_t tickTime) {
+    int64_t frameDuration = MF_UNITS_PER_SECOND / sim->opt.fps;
+    int64_t timestamp = MediaClock_FromSource(&sim->clock, tickTime);
+    sim->ticks++;
+
+    // Budget decisions are applied on the submitting thread
+    int newQp, newKeyframeMs;
+    if (QualityController_Poll(sim->qc, &newQp, &newKeyframeMs)) {
+        StreamModel_SetParams(&sim->video, newQp, newKeyframeMs);
+        SynthHevc_SetQP(&sim->hevc, newQp);
+        sim->qualityChanges++;
+    }
+
+    bool changed = sim->source ? CaptureFrame(sim) : StreamModel_ContentChanged(&sim->video, timestamp);
+    if (sim->opt.vfr && !changed && sim->encoded > 0 &&
+        timestamp - sim->lastSubmit < SIM_VFR_MAX_FRAME_GAP_MS * UNITS_PER_MS) {
+        SampleBuffer_ExtendLastSample(&sim->buffer, timestamp + frameDuration);
+        sim->coalesced++;
+    } else if (Backpressure_Admit(sim->bp, timestamp, sim->now) == DROP_NONE) {
+        SubmitFrame(sim, timestamp, changed);
+    }
+}
+
+static void AudioFrame(Sim* sim, int64_t timestamp, int64_t duration) {
+    BYTE data[2048];
+    int size = SIM_AAC_BITRATE / 8 * SIM_AAC_FRAME_SAMPLES / SIM_AAC_SAMPLE_RATE - 32 +
+               (int)(StreamRandom_Uniform(&sim->encoderRng) * 64);
+    SynthAac_WriteFrame(SIM_AAC_CHANNELS, data, (uint32_t)size);
+
+    bool full = AudioStore_GetDuration(&sim->audio) >= sim->opt.bufferSeconds - 1;
+    int64_t t0 = Platform_SystemNowNs();
+    AudioStore_Add(&sim->audio, data, (DWORD)size, timestamp, duration);
+    int64_t cost = Platform_SystemNowNs() - t0;
+    if (full) LatencyHistogram_Record(&sim->audioAddCost, cost);
+}
+
+// Elementary streams where the muxer would write an MP4: Annex-B from the
+// first IDR (parameter sets are in band), ADTS-framed AAC
+static void WriteSaveFiles(Sim* sim, const MuxerSample* video, int videoCount,
+                           const MuxerAudioSample* audio, int audioCount) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/save-%d.hevc", sim->opt.saveDir, sim->saves + 1);
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "can't write %s\n", path);
+        return;
+    }
+    int first = 0;
+    while (first < videoCount && !video[first].isKeyframe) first++;
+    for (int i = first; i < videoCount; i++) fwrite(video[i].data, 1, video[i].size, file);
+    fclose(file);
+
+    if (audioCount == 0) return;
+    snprintf(path, sizeof(path), "%s/save-%d.aac", sim->opt.saveDir, sim->saves + 1);
+    file = fopen(path, "wb");
+    if (!file) {
+        fprintf(stderr, "can't write %s\n", path);
+        return;
+    }
+    for (int i = 0; i < audioCount; i++) {
+        BYTE header[SYNTH_AAC_ADTS_HEADER_SIZE];
+        SynthAac_WriteAdtsHeader(SIM_AAC_SAMPLE_RATE, SIM_AAC_CHANNELS, audio[i].size, header);
+        fwrite(header, 1, sizeof(header), file);
+        fwrite(audio[i].data, 1, audio[i].size, file);
+    }
+    fclose(file);
+}
+
+// The buffer thread's save: copy video and audio, then a pass over the
+// copies where the muxer would write them
+static void Save(Sim* sim) {
+    MemTagStats before, during;
+    MemTracker_GetTotal(&before);
+    MemTracker_ResetWindow();
+
+    int64_t start = Platform_SystemNow();
+    MuxerSample* videoSamples = NULL;
+    MuxerAudioSample* audioSamples = NULL;
+    int videoCount = 0, audioCount = 0;
+    LONGLONG base = 0;
+    int64_t bytes = 0;
+    uint32_t checksum = 0;
+
+    if (SampleBuffer_GetSamplesForMuxing(&sim->buffer, &videoSamples, &videoCount, &base)) {
+        AudioStore_GetSamplesForMuxing(&sim->audio, base, &audioSamples, &audioCount);
+    }
+    if (sim->opt.saveDir) WriteSaveFiles(sim, videoSamples, videoCount, audioSamples, audioCount);
+    for (int i = 0; i < videoCount; i++) {
+        for (DWORD j = 0; j < videoSamples[i].size; j += 4096) checksum += videoSamples[i].data[j];
+        bytes += videoSamples[i].size;
+        MemTracker_Free(videoSamples[i].data);
+    }
+    for (int i = 0; i < audioCount; i++) {
+        checksum += audioSamples[i].data[0];
+        bytes += audioSamples[i].size;
+        MemTracker_Free(audioSamples[i].data);
+    }
+    if (videoSamples) MemTracker_Free(videoSamples);
+    if (audioSamples) MemTracker_Free(audioSamples);
+    int64_t elapsed = Platform_SystemNow() - start;
+    (void)checksum;
+
+    MemTracker_GetTotal(&during);
+    LatencyHistogram_Record(&sim->saveCost, elapsed);
+    PipelineLatency_Record(sim->latency, LATENCY_SAVE, elapsed);
+    if (bytes > sim->saveBytesMax) sim->saveBytesMax = bytes;
+    if (during.windowPeak > sim->savePeakMax) sim->savePeakMax = during.windowPeak;
+    sim->saves++;
+
+    if (!sim->opt.json) {
+        printf("save %d at %.0fs: %d video + %d audio samples, %.1f MB, %.1f ms, peak %.1f MB (+%.1f MB)\n",
+               sim->saves, (double)MediaClock_Now(&sim->clock) / MF_UNITS_PER_SECOND, videoCount, audioCount,
+               bytes / (1024.0 * 1024.0), elapsed / 10000.0, during.windowPeak / (1024.0 * 1024.0),
+               (during.windowPeak - before.current) / (1024.0 * 1024.0));
+    }
+}
+
+// ============================================================================
+// Session
+// ============================================================================
+
+static bool EndsWith(const char* text, const char* suffix) {
+    size_t length = strlen(text), suffixLength = strlen(suffix);
+    return length >= suffixLength && strcmp(text + length - suffixLength, suffix) == 0;
+}
+
+// Open --source; the capture profile follows a file's size and rate
+static FrameSource* OpenSource(SimOptions* opt) {
+    FrameSource* source = NULL;
+    if (strcmp(opt->source, "pattern") == 0) {
+        // 10s scene cycle split like the content model's static share
+        PatternConfig pattern = {0};
+        pattern.width = opt->width;
+        pattern.height = opt->height;
+        pattern.format = FRAME_FORMAT_BGRA;
+        pattern.fps = opt->fps;
+        pattern.motionSpeed = 8;
+        pattern.staticFrames = (int)(opt->staticFraction * 10 * opt->fps);
+        pattern.motionFrames = pattern.staticFrames > 0 ? 10 * opt->fps - pattern.staticFrames : 0;
+        source = FrameSource_CreatePattern(&pattern);
+    } else if (EndsWith(opt->source, ".y4m")) {
+        source = FrameSource_OpenY4M(opt->source, FRAME_FORMAT_BGRA);
+    } else if (EndsWith(opt->source, ".bgra") || EndsWith(opt->source, ".nv12")) {
+        FrameFormat format = EndsWith(opt->source, ".nv12") ? FRAME_FORMAT_NV12 : FRAME_FORMAT_BGRA;
+        source = FrameSource_OpenRaw(opt->source, opt->width, opt->height, format, opt->fps);
+    }
+    if (!source) return NULL;
+
+    opt->width = source->info.width;
+    opt->height = source->info.height;
+    opt->fps = (source->info.fpsNum + source->info.fpsDen / 2) / source->info.fpsDen;
+    if (opt->fps < 1) opt->fps = 1;
+    return source;
+}
+
+static bool Sim_Init(Sim* sim, const SimOptions* opt) {
+    memset(sim, 0, sizeof(*sim));
+    sim->opt = *opt;
+
+    if (opt->source) {
+        sim->source = OpenSource(&sim->opt);
+        if (!sim->source) {
+            fprintf(stderr, "can't open frame source %s\n", opt->source);
+            return false;
+        }
+        sim->frame = (uint8_t*)malloc(FrameSource_FrameSize(&sim->source->info, 0));
+        if (!sim->frame) return false;
+        if (sim->source->info.format == FRAME_FORMAT_BGRA &&
+            !CPUConverter_Init(&sim->converter, sim->opt.width, sim->opt.height)) {
+            return false;
+        }
+        opt = &sim->opt;
+    }
+
+    // Arbitrary nonzero epoch, so media time really is relative to the clock
+    sim->now = 1000 * PLATFORM_UNITS_PER_SECOND;
+    Platform_SetClockSource(MediaClock_FakeSource, &sim->now);
+    MediaClock_Init(&sim->clock, NULL, NULL);
+
+    StreamModelConfig video;
+    StreamModel_DefaultConfig(&video, opt->width, opt->height, opt->fps, opt->quality);
+    video.staticFraction = opt->staticFraction;
+    video.seed = opt->seed;
+    StreamModel_Init(&sim->video, &video);
+    StreamRandom_Seed(&sim->encoderRng, opt->seed ^ 0x5EED);
+
+    SynthHevcConfig hevc = {0};
+    hevc.width = opt->width;
+    hevc.height = opt->height;
+    hevc.fps = opt->fps;
+    hevc.qp = sim->video.qp;
+    hevc.repeatParamSets = true;
+    hevc.seed = opt->seed;
+    SynthHevc_Init(&sim->hevc, &hevc);
+
+    if (!SampleBuffer_Init(&sim->buffer, opt->bufferSeconds, opt->fps, opt->width, opt->height,
+                           opt->quality, VIDEO_CODEC_HEVC)) {
+        return false;
+    }
+    uint32_t paramSetsSize = 0;
+    const uint8_t* paramSets = SynthHevc_GetParamSets(&sim->hevc, &paramSetsSize);
+    SampleBuffer_SetSequenceHeader(&sim->buffer, paramSets, paramSetsSize);
+    AudioStore_Init(&sim->audio);
+    AudioStore_SetMaxDuration(&sim->audio, (LONGLONG)opt->bufferSeconds * MF_UNITS_PER_SECOND);
+
+    sim->bp = Backpressure_Create(opt->inFlight, MF_UNITS_PER_SECOND / opt->fps);
+    sim->latency = PipelineLatency_Create();
+    if (!sim->bp || !sim->latency) return false;
+
+    // Memory budget as in the engine: audio's share comes off the top
+    if (opt->memoryMB > 0) {
+        int64_t budget = (int64_t)opt->memoryMB * 1024 * 1024;
+        if (opt->audio) budget -= (int64_t)(SIM_AAC_BITRATE / 8) * opt->bufferSeconds;
+        QualityControllerConfig qcConfig;
+        QualityController_DefaultConfig(&qcConfig, budget / opt->bufferSeconds,
+                                        Util_QualityToQP(opt->quality), VIDEO_ENCODER_KEYFRAME_MS);
+        sim->qc = QualityController_Create(&qcConfig);
+        if (!sim->qc) {
+            fprintf(stderr, "memory budget %dMB too small for %ds, keeping fixed quality\n",
+                    opt->memoryMB, opt->bufferSeconds);
+        }
+    }
+
+    sim->nextStall = sim->now;
+    LatencyHistogram_Reset(&sim->captureCost);
+    LatencyHistogram_Reset(&sim->addCost);
+    LatencyHistogram_Reset(&sim->evictCost);
+    LatencyHistogram_Reset(&sim->audioAddCost);
+    LatencyHistogram_Reset(&sim->saveCost);
+    return true;
+}
+
+static void Sim_Shutdown(Sim* sim) {
+    SampleBuffer_Shutdown(&sim->buffer);
+    AudioStore_Shutdown(&sim->audio);
+    Backpressure_Destroy(sim->bp);
+    QualityController_Destroy(sim->qc);
+    PipelineLatency_Destroy(sim->latency);
+    CPUConverter_Shutdown(&sim->converter);
+    FrameSource_Destroy(sim->source);
+    free(sim->frame);
+    Platform_SetClockSource(NULL, NULL);
+}
+
+// Advance the virtual clock event by event until the session ends
+static void Sim_Run(Sim* sim) {
+    int64_t origin = MediaClock_ToSource(&sim->clock, 0);
+    int64_t end = origin + (int64_t)sim->opt.minutes * 60 * PLATFORM_UNITS_PER_SECOND;
+    int64_t saveInterval = (int64_t)sim->opt.saveEverySeconds * PLATFORM_UNITS_PER_SECOND;
+    int64_t audioDuration = MediaClock_FromSamples(SIM_AAC_FRAME_SAMPLES, SIM_AAC_SAMPLE_RATE);
+
+    int frame = 0;
+    int64_t audioFrames = 0;
+    int64_t nextTick = origin;
+    int64_t nextAudio = sim->opt.audio ? origin : INT64_MAX;
+    int64_t nextSave = saveInterval > 0 ? origin + saveInterval : INT64_MAX;
+
+    for (;;) {
+        // Earliest event; ties go completions, audio, capture, save
+        int64_t nextDone = sim->jobCount > 0 ? sim->jobs[sim->jobHead].done : INT64_MAX;
+        int64_t next = nextDone;
+        if (nextAudio < next) next = nextAudio;
+        if (nextTick < next) next = nextTick;
+        if (nextSave < next) next = nextSave;
+        if (next >= end) break;
+        sim->now = next;
+
+        if (next == nextDone) {
+            CompleteFrame(sim);
+        } else if (next == nextAudio) {
+            int64_t timestamp = MediaClock_FromSource(&sim->clock, nextAudio);
+            AudioFrame(sim, timestamp, audioDuration);
+            audioFrames++;
+            nextAudio = origin + MediaClock_FromSamples(audioFrames * SIM_AAC_FRAME_SAMPLES, SIM_AAC_SAMPLE_RATE);
+        } else if (next == nextTick) {
+            CaptureTick(sim, nextTick);
+            frame++;
+            nextTick = origin + Util_CalculateTimestamp(frame, sim->opt.fps);
+        } else {
+            Save(sim);
+            nextSave += saveInterval;
+        }
+    }
+}
+
+// ============================================================================
+// Report
+// ============================================================================
+
+static double Us(int64_t ns) { return ns / 1000.0; }
+static double Mb(int64_t bytes) { return bytes / (1024.0 * 1024.0); }
+
+static void Sim_Report(Sim* sim, double wallSeconds) {
+    BackpressureStats bp;
+    Backpressure_GetStats(sim->bp, &bp);
+    MemTagStats total, video, audio, save;
+    MemTracker_GetTotal(&total);
+    MemTracker_GetStats(MEM_TAG_VIDEO_SAMPLES, &video);
+    MemTracker_GetStats(MEM_TAG_AUDIO_SAMPLES, &audio);
+    MemTracker_GetStats(MEM_TAG_SAVE, &save);
+    LatencySummary encode;
+    PipelineLatency_GetSummary(sim->latency, LATENCY_ENCODE, &encode);
+    QualityControllerStats qc = {0};
+    if (sim->qc) QualityController_GetStats(sim->qc, &qc);
+
+    double simSeconds = sim->opt.minutes * 60.0;
+    uint64_t dropped = bp.dropped[DROP_PACED] + bp.dropped[DROP_FULL] + bp.dropped[DROP_REJECTED];
+    const LatencyHistogram* capture = &sim->captureCost;
+    const LatencyHistogram* add = &sim->addCost;
+    const LatencyHistogram* evict = &sim->evictCost;
+    const LatencyHistogram* audioAdd = &sim->audioAddCost;
+    const LatencyHistogram* saves = &sim->saveCost;
+
+    if (sim->opt.json) {
+        printf("{\"session\":{\"seconds\":%.0f,\"width\":%d,\"height\":%d,\"fps\":%d,\"buffer_seconds\":%d,"
+               "\"memory_mb\":%d,\"vfr\":%s,\"seed\":%llu,\"wall_seconds\":%.3f,\"speedup\":%.1f},",
+               simSeconds, sim->opt.width, sim->opt.height, sim->opt.fps, sim->opt.bufferSeconds,
+               sim->opt.memoryMB, sim->opt.vfr ? "true" : "false", (unsigned long long)sim->opt.seed,
+               wallSeconds, wallSeconds > 0 ? simSeconds / wallSeconds : 0);
+        printf("\"ticks\":{\"total\":%llu,\"encoded\":%llu,\"coalesced\":%llu,\"dropped\":%llu,"
+               "\"paced\":%llu,\"full\":%llu,\"rejected\":%llu,\"gaps\":%llu,\"gap_ms\":%.1f},",
+               (unsigned long long)sim->ticks, (unsigned long long)sim->encoded, (unsigned long long)sim->coalesced,
+               (unsigned long long)dropped, (unsigned long long)bp.dropped[DROP_PACED],
+               (unsigned long long)bp.dropped[DROP_FULL], (unsigned long long)bp.dropped[DROP_REJECTED],
+               (unsigned long long)bp.gaps, bp.gapTime / 10000.0);
+        if (sim->source) {
+            printf("\"capture_us\":{\"source\":\"%s\",\"count\":%llu,\"rewinds\":%llu,\"p50\":%.2f,\"p99\":%.2f,\"max\":%.2f},",
+                   sim->source->ops->name, (unsigned long long)capture->count,
+                   (unsigned long long)sim->sourceRewinds, Us(LatencyHistogram_Percentile(capture, 50)),
+                   Us(LatencyHistogram_Percentile(capture, 99)), Us(capture->max));
+        }
+        printf("\"encode_ms\":{\"p50\":%.2f,\"p99\":%.2f,\"max\":%.2f},",
+               encode.p50 / 10000.0, encode.p99 / 10000.0, encode.max / 10000.0);
+        printf("\"add_us\":{\"count\":%llu,\"p50\":%.2f,\"p99\":%.2f,\"p999\":%.2f,\"max\":%.2f},",
+               (unsigned long long)add->count, Us(LatencyHistogram_Percentile(add, 50)),
+               Us(LatencyHistogram_Percentile(add, 99)), Us(LatencyHistogram_Percentile(add, 99.9)), Us(add->max));
+        printf("\"evict_us\":{\"count\":%llu,\"samples\":%llu,\"p50\":%.2f,\"p99\":%.2f,\"p999\":%.2f,\"max\":%.2f},",
+               (unsigned long long)evict->count, (unsigned long long)sim->evicted,
+               Us(LatencyHistogram_Percentile(evict, 50)), Us(LatencyHistogram_Percentile(evict, 99)),
+               Us(LatencyHistogram_Percentile(evict, 99.9)), Us(evict->max));
+        printf("\"audio_add_us\":{\"count\":%llu,\"p50\":%.2f,\"p99\":%.2f,\"max\":%.2f},",
+               (unsigned long long)audioAdd->count, Us(LatencyHistogram_Percentile(audioAdd, 50)),
+               Us(LatencyHistogram_Percentile(audioAdd, 99)), Us(audioAdd->max));
+        printf("\"save_ms\":{\"count\":%d,\"p50\":%.1f,\"max\":%.1f,\"bytes_max\":%lld},",
+               sim->saves, LatencyHistogram_Percentile(saves, 50) / 10000.0, saves->max / 10000.0,
+               (long long)sim->saveBytesMax);
+        printf("\"memory\":{\"peak\":%lld,\"video_peak\":%lld,\"audio_peak\":%lld,\"save_peak\":%lld,"
+               "\"peak_during_save\":%lld,\"rss_peak\":%lld},",
+               (long long)total.peak, (long long)video.peak, (long long)audio.peak, (long long)save.peak,
+               (long long)sim->savePeakMax, (long long)PeakRssBytes());
+        printf("\"video\":{\"bytes_per_sec\":%.0f,\"expected_bytes_per_sec\":%.0f,\"qp\":%d,\"keyframe_ms\":%d,"
+               "\"quality_changes\":%llu}}\n",
+               sim->videoBytes / simSeconds, StreamModel_ExpectedRate(&sim->video), sim->video.qp,
+               sim->video.keyframeMs, (unsigned long long)sim->qualityChanges);
+        return;
+    }
+
+    printf("session: %.0fs %dx%d@%d, buffer %ds, budget %dMB, vfr %s, seed %llu\n",
+           simSeconds, sim->opt.width, sim->opt.height, sim->opt.fps, sim->opt.bufferSeconds,
+           sim->opt.memoryMB, sim->opt.vfr ? "on" : "off", (unsigned long long)sim->opt.seed);
+    printf("wall: %.2fs (%.0fx real time)\n", wallSeconds, wallSeconds > 0 ? simSeconds / wallSeconds : 0);
+    printf("ticks: %llu, encoded %llu, coalesced %llu, dropped %llu (paced %llu, full %llu, rejected %llu), "
+           "%llu gaps covering %.1fms\n",
+           (unsigned long long)sim->ticks, (unsigned long long)sim->encoded, (unsigned long long)sim->coalesced,
+           (unsigned long long)dropped, (unsigned long long)bp.dropped[DROP_PACED],
+           (unsigned long long)bp.dropped[DROP_FULL], (unsigned long long)bp.dropped[DROP_REJECTED],
+           (unsigned long long)bp.gaps, bp.gapTime / 10000.0);
+    if (sim->source) {
+        printf("capture (%s, read + convert): n=%llu p50 %.2fus p99 %.2fus max %.2fus, %llu rewinds\n",
+               sim->source->ops->name, (unsigned long long)capture->count,
+               Us(LatencyHistogram_Percentile(capture, 50)), Us(LatencyHistogram_Percentile(capture, 99)),
+               Us(capture->max), (unsigned long long)sim->sourceRewinds);
+    }
+    printf("encode (virtual): p50 %.2fms p99 %.2fms max %.2fms\n",
+           encode.p50 / 10000.0, encode.p99 / 10000.0, encode.max / 10000.0);
+    printf("add (buffer full): n=%llu p50 %.2fus p99 %.2fus p99.9 %.2fus max %.2fus\n",
+           (unsigned long long)add->count, Us(LatencyHistogram_Percentile(add, 50)),
+           Us(LatencyHistogram_Percentile(add, 99)), Us(LatencyHistogram_Percentile(add, 99.9)), Us(add->max));
+    printf("evict: n=%llu (%llu samples) p50 %.2fus p99 %.2fus p99.9 %.2fus max %.2fus\n",
+           (unsigned long long)evict->count, (unsigned long long)sim->evicted,
+           Us(LatencyHistogram_Percentile(evict, 50)), Us(LatencyHistogram_Percentile(evict, 99)),
+           Us(LatencyHistogram_Percentile(evict, 99.9)), Us(evict->max));
+    printf("audio add (store full): n=%llu p50 %.2fus p99 %.2fus max %.2fus\n",
+           (unsigned long long)audioAdd->count, Us(LatencyHistogram_Percentile(audioAdd, 50)),
+           Us(LatencyHistogram_Percentile(audioAdd, 99)), Us(audioAdd->max));
+    printf("saves: %d, p50 %.1fms max %.1fms, largest %.1fMB\n",
+           sim->saves, LatencyHistogram_Percentile(saves, 50) / 10000.0, saves->max / 10000.0,
+           Mb(sim->saveBytesMax));
+    printf("memory: peak %.1fMB (video %.1fMB, audio %.1fMB, save copies %.1fMB), during saves %.1fMB, rss %.1fMB\n",
+           Mb(total.peak), Mb(video.peak), Mb(audio.peak), Mb(save.peak), Mb(sim->savePeakMax),
+           Mb(PeakRssBytes()));
+    printf("video: %.0f KB/s (model %.0f KB/s at QP %d, keyframe %dms), %llu quality changes\n",
+           sim->videoBytes / simSeconds / 1024.0, StreamModel_ExpectedRate(&sim->video) / 1024.0,
+           sim->video.qp, sim->video.keyframeMs, (unsigned long long)sim->qualityChanges);
+    if (sim->qc) {
+        printf("budget: target %.0f KB/s, last window %.0f KB/s, %llu raises, %llu relaxes\n",
+               qc.targetBytesPerSec / 1024.0, qc.lastWindowRate / 1024.0,
+               (unsigned long long)qc.raises, (unsigned long long)qc.relaxes);
+    }
+}
+
+// ============================================================================
+// Command line
+// ============================================================================
+
+static void Usage(void) {
+    fprintf(stderr,
+        "usage: lwsr-replay-sim [options]\n"
+        "  --minutes N          session length (20)\n"
+        "  --width N --height N --fps N   capture profile (2560x1440@60)\n"
+        "  --quality NAME       low | medium | high | lossless (high)\n"
+        "  --buffer-seconds N   replay duration (60)\n"
+        "  --memory-mb N        replay memory budget, 0 = fixed quality (0)\n"
+        "  --save-every N       seconds between saves, 0 = none (300)\n"
+        "  --vfr                coalesce unchanged ticks\n"
+        "  --static F           share of static scenes, 0-0.95 (0.3)\n"
+        "  --no-audio           no AAC stream\n"
+        "  --no-fill            don't write frame payloads\n"
+        "  --save-dir DIR       write each save as save-N.hevc / save-N.aac\n"
+        "  --source SRC         capture frames from 'pattern', FILE.y4m, or raw FILE.bgra / FILE.nv12\n"
+        "                       (raw files use --width/--height/--fps)\n"
+        "  --in-flight N        encoder ring depth (8)\n"
+        "  --encode-ms F        mean encoder service time (5)\n"
+        "  --stall-every F      mean seconds between encoder stalls, 0 = none (30)\n"
+        "  --stall-ms F         encoder stall length (80)\n"
+        "  --seed N             random seed (1)\n"
+        "  --json               one JSON object instead of text\n");
+}
+
+static bool ParseQuality(const char* name, QualityPreset* quality) {
+    static const char* names[] = { "low", "medium", "high", "lossless" };
+    for (int i = 0; i < 4; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            *quality = (QualityPreset)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ParseArgs(int argc, char** argv, SimOptions* opt) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool takesValue = true;
+
+        if (strcmp(arg, "--vfr") == 0) { opt->vfr = true; takesValue = false; }
+        else if (strcmp(arg, "--no-audio") == 0) { opt->audio = false; takesValue = false; }
+        else if (strcmp(arg, "--no-fill") == 0) { opt->fill = false; takesValue = false; }
+        else if (strcmp(arg, "--json") == 0) { opt->json = true; takesValue = false; }
+        else if (!value) return false;
+        else if (strcmp(arg, "--minutes") == 0) opt->minutes = atoi(value);
+        else if (strcmp(arg, "--width") == 0) opt->width = atoi(value);
+        else if (strcmp(arg, "--height") == 0) opt->height = atoi(value);
+        else if (strcmp(arg, "--fps") == 0) opt->fps = atoi(value);
+        else if (strcmp(arg, "--quality") == 0) { if (!ParseQuality(value, &opt->quality)) return false; }
+        else if (strcmp(arg, "--buffer-seconds") == 0) opt->bufferSeconds = atoi(value);
+        else if (strcmp(arg, "--memory-mb") == 0) opt->memoryMB = atoi(value);
+        else if (strcmp(arg, "--save-every") == 0) opt->saveEverySeconds = atoi(value);
+        else if (strcmp(arg, "--static") == 0) opt->staticFraction = atof(value);
+        else if (strcmp(arg, "--in-flight") == 0) opt->inFlight = atoi(value);
+        else if (strcmp(arg, "--encode-ms") == 0) opt->encodeMs = atof(value);
+        else if (strcmp(arg, "--stall-every") == 0) opt->stallEverySeconds = atof(value);
+        else if (strcmp(arg, "--stall-ms") == 0) opt->stallMs = atof(value);
+        else if (strcmp(arg, "--seed") == 0) opt->seed = strtoull(value, NULL, 0);
+        else if (strcmp(arg, "--save-dir") == 0) opt->saveDir = value;
+        else if (strcmp(arg, "--source") == 0) opt->source = value;
+        else return false;
+
+        if (takesValue) i++;
+    }
+
+    if (opt->inFlight > SIM_MAX_IN_FLIGHT) opt->inFlight = SIM_MAX_IN_FLIGHT;
+    if (opt->saveDir && !opt->fill) return false;   // Nothing valid to write
+    return opt->minutes > 0 && opt->width > 0 && opt->height > 0 && opt->fps > 0 &&
+           opt->bufferSeconds > 0 && opt->inFlight > 0 && opt->encodeMs > 0;
+}
+
+int main(int argc, char** argv) {
+    SimOptions opt;
+    memset(&opt, 0, sizeof(opt));
+    opt.minutes = 20;
+    opt.width = 2560;
+    opt.height = 1440;
+    opt.fps = 60;
+    opt.quality = QUALITY_HIGH;
+    opt.bufferSeconds = 60;
+    opt.saveEverySeconds = 300;
+    opt.audio = true;
+    opt.fill = true;
+    opt.inFlight = 8;
+    opt.encodeMs = 5.0;
+    opt.stallEverySeconds = 30.0;
+    opt.stallMs = 80.0;
+    opt.staticFraction = 0.3;
+    opt.seed = 1;
+
+    if (!ParseArgs(argc, argv, &opt)) {
+        Usage();
+        return 2;
+    }
+
+    static Sim sim;
+    if (!Sim_Init(&sim, &opt)) {
+        fprintf(stderr, "failed to initialize the simulation\n");
+        return 1;
+    }
+
+    int64_t start = Platform_SystemNow();
+    Sim_Run(&sim);
+    double wallSeconds = (double)(Platform_SystemNow() - start) / PLATFORM_UNITS_PER_SECOND;
+
+    Sim_Report(&sim, wallSeconds);
+    Sim_Shutdown(&sim);
+    return 0;
+}
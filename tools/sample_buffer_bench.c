@@ -0,0 +1,432 @@
+/*
+ * Sample Buffer Bench - Microbenchmarks for the replay sample ring
+ * Portable C; one JSON object per line, so runs diff across commits
+ *
+ * Cases:
+ * - add_steady: SampleBuffer_Add on a ring at its full duration, so every
+ *   add also evicts (throughput and per-add latency)
+ * - add_contended: the same while reader threads call GetDuration,
+ *   GetCount and GetMemoryUsage in a loop, as status and metrics do
+ * - snapshot: SampleBuffer_GetSamplesForMuxing (the save copy) and freeing
+ *   the copies, for several buffer durations
+ * - clear / shutdown: SampleBuffer_Clear and SampleBuffer_Shutdown with
+ *   100k samples held
+ *
+ * Frames come from a StreamModel for the capture profile (IDR every GOP,
+ * log-normal P frames), allocated and written outside the timed region.
+ * Latencies are in nanoseconds on the system clock.
+ *
+ *   lwsr-bench-sample-buffer > before.jsonl
+ */
+
+#include "platform.h"
+#include "sample_buffer.h"
+#include "stream_model.h"
+#include "pipeline_latency.h"
+#include "mem_tracker.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_READERS 16
+#define MAX_SNAPSHOTS 8
+#define CLEAR_SAMPLES 100000
+
+typedef struct {
+    int width;
+    int height;
+    int fps;
+    QualityPreset quality;
+    int bufferSeconds;
+    int adds;                   // Timed adds per add case
+    int readers;
+    int snapshotSeconds[MAX_SNAPSHOTS];
+    int snapshotCount;
+    int repeat;                 // Snapshot / clear runs (median reported)
+    int clearMB;                // Payload cap for the 100k-sample cases
+    double staticFraction;
+    uint64_t seed;
+    const char* only;           // Run just this case (NULL = all)
+} BenchOptions;
+
+// Synthetic encoder output on the profile's frame grid
+typedef struct {
+    StreamModel model;
+    int fps;
+    int64_t frame;
+    double scale;               // Payload size factor (1 = as modeled)
+} FrameGen;
+
+typedef struct {
+    SampleBuffer* buf;
+    PlatformAtomic64 stop;
+    PlatformAtomic64 calls;
+} ReaderShared;
+
+// ============================================================================
+// Helpers
+// ============================================================================
+
+static void FrameGen_Init(FrameGen* gen, const BenchOptions* opt, double scale) {
+    StreamModelConfig config;
+    StreamModel_DefaultConfig(&config, opt->width, opt->height, opt->fps, opt->quality);
+    config.staticFraction = opt->staticFraction;
+    config.seed = opt->seed;
+    StreamModel_Init(&gen->model, &config);
+    gen->fps = opt->fps;
+    gen->frame = 0;
+    gen->scale = scale;
+}
+
+// Next frame in tracked memory, every byte written like an encoder would
+static bool FrameGen_Next(FrameGen* gen, EncodedFrame* frame) {
+    LONGLONG timestamp = Util_CalculateTimestamp((int)gen->frame, gen->fps);
+    bool changed = StreamModel_ContentChanged(&gen->model, timestamp);
+    bool keyframe = false;
+    uint32_t size = StreamModel_NextFrame(&gen->model, timestamp, changed, &keyframe);
+    size = (uint32_t)(size * gen->scale);
+    if (size < 16) size = 16;
+
+    frame->data = (BYTE*)MemTracker_Alloc(MEM_TAG_VIDEO_ENCODER, size);
+    if (!frame->data) return false;
+    memset(frame->data, (int)(gen->frame & 0xFF), size);
+    frame->size = size;
+    frame->timestamp = timestamp;
+    frame->duration = MF_UNITS_PER_SECOND / gen->fps;
+    frame->isKeyframe = keyframe;
+    gen->frame++;
+    return true;
+}
+
+// Add 'count' frames (older ones are evicted as the ring fills)
+static bool Fill(SampleBuffer* buf, FrameGen* gen, int count) {
+    for (int i = 0; i < count; i++) {
+        EncodedFrame frame;
+        if (!FrameGen_Next(gen, &frame)) return false;
+        SampleBuffer_Add(buf, &frame);
+        if (frame.data) MemTracker_Free(frame.data);
+    }
+    return true;
+}
+
+static int CompareInt64(const void* a, const void* b) {
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static int64_t Median(int64_t* values, int count) {
+    qsort(values, count, sizeof(int64_t), CompareInt64);
+    return values[count / 2];
+}
+
+static void PrintLatency(const LatencyHistogram* hist) {
+    printf("\"p50_ns\":%lld,\"p99_ns\":%lld,\"p999_ns\":%lld,\"max_ns\":%lld,\"mean_ns\":%.0f",
+           (long long)LatencyHistogram_Percentile(hist, 50), (long long)LatencyHistogram_Percentile(hist, 99),
+           (long long)LatencyHistogram_Percentile(hist, 99.9), (long long)hist->max,
+           hist->count ? (double)hist->total / hist->count : 0.0);
+}
+
+static bool Selected(const BenchOptions* opt, const char* name) {
+    return !opt->only || strcmp(opt->only, name) == 0;
+}
+
+// ============================================================================
+// Add
+// ============================================================================
+
+static void ReaderThread(void* param) {
+    ReaderShared* shared = (ReaderShared*)param;
+    int64_t calls = 0;
+    while (!Platform_AtomicLoad64(&shared->stop)) {
+        volatile double duration = SampleBuffer_GetDuration(shared->buf);
+        volatile int count = SampleBuffer_GetCount(shared->buf);
+        volatile size_t bytes = SampleBuffer_GetMemoryUsage(shared->buf);
+        (void)duration; (void)count; (void)bytes;
+        calls += 3;
+    }
+    Platform_AtomicAdd64(&shared->calls, calls);
+}
+
+static void BenchAdd(const BenchOptions* opt, const char* name, int readers) {
+    SampleBuffer buf;
+    FrameGen gen;
+    FrameGen_Init(&gen, opt, 1.0);
+    if (!SampleBuffer_Init(&buf, opt->bufferSeconds, opt->fps, opt->width, opt->height,
+                           opt->quality, VIDEO_CODEC_HEVC)) {
+        return;
+    }
+
+    // Steady state: a full duration plus one frame, so each add evicts
+    if (!Fill(&buf, &gen, opt->bufferSeconds * opt->fps + 1)) {
+        SampleBuffer_Shutdown(&buf);
+        return;
+    }
+    int samples = SampleBuffer_GetCount(&buf);
+
+    ReaderShared shared;
+    shared.buf = &buf;
+    Platform_AtomicStore64(&shared.stop, 0);
+    Platform_AtomicStore64(&shared.calls, 0);
+    PlatformThread threads[MAX_READERS];
+    int started = 0;
+    for (int i = 0; i < readers; i++) {
+        if (Platform_ThreadCreate(&threads[started], ReaderThread, &shared)) started++;
+    }
+
+    static LatencyHistogram hist;
+    LatencyHistogram_Reset(&hist);
+    int64_t evicted = 0;
+    int64_t bytes = 0;
+    int64_t readStart = Platform_SystemNowNs();
+    for (int i = 0; i < opt->adds; i++) {
+        EncodedFrame frame;
+        if (!FrameGen_Next(&gen, &frame)) break;
+        int before = buf.count;
+        bytes += frame.size;
+
+        int64_t t0 = Platform_SystemNowNs();
+        SampleBuffer_Add(&buf, &frame);
+        LatencyHistogram_Record(&hist, Platform_SystemNowNs() - t0);
+
+        evicted += before + 1 - buf.count;
+        if (frame.data) MemTracker_Free(frame.data);
+    }
+    int64_t readElapsed = Platform_SystemNowNs() - readStart;
+
+    Platform_AtomicStore64(&shared.stop, 1);
+    for (int i = 0; i < started; i++) Platform_ThreadJoin(&threads[i]);
+    int64_t calls = Platform_AtomicLoad64(&shared.calls);
+
+    printf("{\"bench\":\"%s\",\"samples\":%d,\"adds\":%llu,\"readers\":%d,\"adds_per_sec\":%.0f,"
+           "\"evicted_per_add\":%.3f,\"mean_frame_bytes\":%.0f,",
+           name, samples, (unsigned long long)hist.count, started,
+           hist.total > 0 ? hist.count * 1e9 / hist.total : 0.0,
+           hist.count ? (double)evicted / hist.count : 0.0, hist.count ? (double)bytes / hist.count : 0.0);
+    PrintLatency(&hist);
+    if (readers > 0) {
+        printf(",\"reader_calls_per_sec\":%.0f", readElapsed > 0 ? calls * 1e9 / readElapsed : 0.0);
+    }
+    printf("}\n");
+    fflush(stdout);
+
+    SampleBuffer_Shutdown(&buf);
+}
+
+// ============================================================================
+// Snapshot
+// ============================================================================
+
+static void BenchSnapshot(const BenchOptions* opt, int seconds) {
+    SampleBuffer buf;
+    FrameGen gen;
+    FrameGen_Init(&gen, opt, 1.0);
+    if (!SampleBuffer_Init(&buf, seconds, opt->fps, opt->width, opt->height,
+                           opt->quality, VIDEO_CODEC_HEVC)) {
+        return;
+    }
+    if (!Fill(&buf, &gen, seconds * opt->fps + 1)) {
+        SampleBuffer_Shutdown(&buf);
+        return;
+    }
+
+    int64_t copyNs[16], freeNs[16];
+    int runs = opt->repeat < 16 ? opt->repeat : 16;
+    int count = 0;
+    int64_t bytes = 0;
+    for (int r = 0; r < runs; r++) {
+        MuxerSample* samples = NULL;
+        bytes = 0;
+        int64_t t0 = Platform_SystemNowNs();
+        SampleBuffer_GetSamplesForMuxing(&buf, &samples, &count, NULL);
+        int64_t t1 = Platform_SystemNowNs();
+        for (int i = 0; i < count; i++) {
+            bytes += samples[i].size;
+            MemTracker_Free(samples[i].data);
+        }
+        MemTracker_Free(samples);
+        int64_t t2 = Platform_SystemNowNs();
+        copyNs[r] = t1 - t0;
+        freeNs[r] = t2 - t1;
+    }
+    int64_t copy = Median(copyNs, runs);
+    int64_t release = Median(freeNs, runs);
+
+    printf("{\"bench\":\"snapshot\",\"seconds\":%d,\"samples\":%d,\"bytes\":%lld,\"runs\":%d,"
+           "\"copy_ns\":%lld,\"free_ns\":%lld,\"copy_gb_per_sec\":%.2f,\"copy_ns_per_sample\":%.0f}\n",
+           seconds, count, (long long)bytes, runs, (long long)copy, (long long)release,
+           copy > 0 ? bytes / (double)copy : 0.0, count ? (double)copy / count : 0.0);
+    fflush(stdout);
+
+    SampleBuffer_Shutdown(&buf);
+}
+
+// ============================================================================
+// Clear / Shutdown
+// ============================================================================
+
+static void BenchClearShutdown(const BenchOptions* opt) {
+    // 100k samples need fps * duration * 1.5 >= 100k slots and a duration
+    // longer than the samples span, so this ring runs at 100 fps / 1200 s.
+    // Payloads are scaled down to fit the memory cap.
+    BenchOptions profile = *opt;
+    profile.fps = 100;
+    FrameGen probe;
+    FrameGen_Init(&probe, &profile, 1.0);
+    double meanBytes = StreamModel_ExpectedRate(&probe.model) / profile.fps;
+    double scale = (double)opt->clearMB * 1024 * 1024 / (meanBytes * CLEAR_SAMPLES);
+    if (scale > 1.0) scale = 1.0;
+
+    int64_t clearNs[16], shutdownNs[16];
+    int runs = opt->repeat < 16 ? opt->repeat : 16;
+    int done = 0;
+    int samples = 0;
+    size_t bytes = 0;
+    for (int r = 0; r < runs; r++) {
+        SampleBuffer buf;
+        FrameGen gen;
+        FrameGen_Init(&gen, &profile, scale);
+        if (!SampleBuffer_Init(&buf, 1200, profile.fps, opt->width, opt->height,
+                               opt->quality, VIDEO_CODEC_HEVC)) {
+            return;
+        }
+
+        if (!Fill(&buf, &gen, CLEAR_SAMPLES)) {
+            SampleBuffer_Shutdown(&buf);
+            break;
+        }
+        samples = SampleBuffer_GetCount(&buf);
+        bytes = SampleBuffer_GetMemoryUsage(&buf);
+        int64_t t0 = Platform_SystemNowNs();
+        SampleBuffer_Clear(&buf);
+        clearNs[r] = Platform_SystemNowNs() - t0;
+
+        Fill(&buf, &gen, CLEAR_SAMPLES);
+        t0 = Platform_SystemNowNs();
+        SampleBuffer_Shutdown(&buf);
+        shutdownNs[r] = Platform_SystemNowNs() - t0;
+        done++;
+    }
+    if (done == 0) return;
+    int64_t clear = Median(clearNs, done);
+    int64_t shutdown = Median(shutdownNs, done);
+
+    printf("{\"bench\":\"clear\",\"samples\":%d,\"bytes\":%llu,\"runs\":%d,\"ns\":%lld,\"ns_per_sample\":%.1f}\n",
+           samples, (unsigned long long)bytes, done, (long long)clear, samples ? (double)clear / samples : 0.0);
+    printf("{\"bench\":\"shutdown\",\"samples\":%d,\"bytes\":%llu,\"runs\":%d,\"ns\":%lld,\"ns_per_sample\":%.1f}\n",
+           samples, (unsigned long long)bytes, done, (long long)shutdown, samples ? (double)shutdown / samples : 0.0);
+    fflush(stdout);
+}
+
+// ============================================================================
+// Command line
+// ============================================================================
+
+static void Usage(void) {
+    fprintf(stderr,
+        "usage: lwsr-bench-sample-buffer [options]\n"
+        "  --width N --height N --fps N   capture profile (2560x1440@60)\n"
+        "  --quality NAME       low | medium | high | lossless (high)\n"
+        "  --buffer-seconds N   ring duration for the add cases (60)\n"
+        "  --adds N             timed adds per add case (20000)\n"
+        "  --readers N          status reader threads in add_contended (3)\n"
+        "  --snapshot LIST      buffer durations for snapshot, e.g. 5,15,30,60 (default)\n"
+        "  --repeat N           snapshot and clear runs, median reported (3)\n"
+        "  --clear-mb N         payload cap for the 100k-sample cases (1024)\n"
+        "  --static F           share of static scenes, 0-0.95 (0)\n"
+        "  --seed N             random seed (1)\n"
+        "  --only NAME          add_steady | add_contended | snapshot | clear\n");
+}
+
+static bool ParseQuality(const char* name, QualityPreset* quality) {
+    static const char* names[] = { "low", "medium", "high", "lossless" };
+    for (int i = 0; i < 4; i++) {
+        if (strcmp(name, names[i]) == 0) {
+            *quality = (QualityPreset)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool ParseList(const char* value, BenchOptions* opt) {
+    opt->snapshotCount = 0;
+    const char* p = value;
+    while (*p && opt->snapshotCount < MAX_SNAPSHOTS) {
+        int seconds = atoi(p);
+        if (seconds <= 0) return false;
+        opt->snapshotSeconds[opt->snapshotCount++] = seconds;
+        p = strchr(p, ',');
+        if (!p) break;
+        p++;
+    }
+    return opt->snapshotCount > 0;
+}
+
+static bool ParseArgs(int argc, char** argv, BenchOptions* opt) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[++i] : NULL;
+        if (!value) return false;
+
+        if (strcmp(arg, "--width") == 0) opt->width = atoi(value);
+        else if (strcmp(arg, "--height") == 0) opt->height = atoi(value);
+        else if (strcmp(arg, "--fps") == 0) opt->fps = atoi(value);
+        else if (strcmp(arg, "--quality") == 0) { if (!ParseQuality(value, &opt->quality)) return false; }
+        else if (strcmp(arg, "--buffer-seconds") == 0) opt->bufferSeconds = atoi(value);
+        else if (strcmp(arg, "--adds") == 0) opt->adds = atoi(value);
+        else if (strcmp(arg, "--readers") == 0) opt->readers = atoi(value);
+        else if (strcmp(arg, "--snapshot") == 0) { if (!ParseList(value, opt)) return false; }
+        else if (strcmp(arg, "--repeat") == 0) opt->repeat = atoi(value);
+        else if (strcmp(arg, "--clear-mb") == 0) opt->clearMB = atoi(value);
+        else if (strcmp(arg, "--static") == 0) opt->staticFraction = atof(value);
+        else if (strcmp(arg, "--seed") == 0) opt->seed = strtoull(value, NULL, 0);
+        else if (strcmp(arg, "--only") == 0) opt->only = value;
+        else return false;
+    }
+
+    if (opt->readers > MAX_READERS) opt->readers = MAX_READERS;
+    return opt->width > 0 && opt->height > 0 && opt->fps > 0 && opt->bufferSeconds > 0 &&
+           opt->adds > 0 && opt->readers >= 0 && opt->repeat > 0 && opt->clearMB > 0;
+}
+
+int main(int argc, char** argv) {
+    BenchOptions opt;
+    memset(&opt, 0, sizeof(opt));
+    opt.width = 2560;
+    opt.height = 1440;
+    opt.fps = 60;
+    opt.quality = QUALITY_HIGH;
+    opt.bufferSeconds = 60;
+    opt.adds = 20000;
+    opt.readers = 3;
+    opt.snapshotSeconds[0] = 5;
+    opt.snapshotSeconds[1] = 15;
+    opt.snapshotSeconds[2] = 30;
+    opt.snapshotSeconds[3] = 60;
+    opt.snapshotCount = 4;
+    opt.repeat = 3;
+    opt.clearMB = 1024;
+    opt.seed = 1;
+
+    if (!ParseArgs(argc, argv, &opt)) {
+        Usage();
+        return 2;
+    }
+
+    FrameGen probe;
+    FrameGen_Init(&probe, &opt, 1.0);
+    printf("{\"bench\":\"profile\",\"width\":%d,\"height\":%d,\"fps\":%d,\"quality\":%d,\"buffer_seconds\":%d,"
+           "\"static\":%.2f,\"seed\":%llu,\"expected_bytes_per_sec\":%.0f,\"keyframe_ms\":%d}\n",
+           opt.width, opt.height, opt.fps, (int)opt.quality, opt.bufferSeconds, opt.staticFraction,
+           (unsigned long long)opt.seed, StreamModel_ExpectedRate(&probe.model), probe.model.keyframeMs);
+    fflush(stdout);
+
+    if (Selected(&opt, "add_steady")) BenchAdd(&opt, "add_steady", 0);
+    if (Selected(&opt, "add_contended")) BenchAdd(&opt, "add_contended", opt.readers);
+    if (Selected(&opt, "snapshot")) {
+        for (int i = 0; i < opt.snapshotCount; i++) BenchSnapshot(&opt, opt.snapshotSeconds[i]);
+    }
+    if (Selected(&opt, "clear")) BenchClearShutdown(&opt);
+    return 0;
+}